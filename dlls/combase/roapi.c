@@ -26,7 +26,9 @@
 
 #include "combase_private.h"
 
+#include "wine/appxindex.h"
 #include "wine/debug.h"
+#include "wine/rbtree.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(combase);
 
@@ -39,9 +41,152 @@ struct activatable_class_data
     DWORD threading_model;
 };
 
-static HRESULT get_library_for_classid(const WCHAR *classid, WCHAR **out)
+enum activation_source
+{
+    ACTIVATION_SOURCE_ACTCTX,
+    ACTIVATION_SOURCE_PACKAGE,
+    ACTIVATION_SOURCE_REGISTRY,
+};
+
+/* Resolved activatable classes, keyed by class id. Entries are never removed,
+ * stale ones are refreshed in place and their modules stay loaded. Entries
+ * are only valid in the activation context they were resolved in, and those
+ * resolved through the registry are also tagged with the generation they were
+ * read in, which is bumped whenever the ActivatableClassId key changes. */
+struct activation_entry
+{
+    struct rb_entry entry;
+    WCHAR *classid;
+    WCHAR *library;
+    enum activation_source source;
+    HANDLE actctx;
+    LONG generation;
+    HMODULE module;
+    PFNGETACTIVATIONFACTORY get_factory;
+};
+
+static int activation_entry_compare(const void *key, const struct rb_entry *entry)
+{
+    const struct activation_entry *class = RB_ENTRY_VALUE(entry, struct activation_entry, entry);
+    return wcscmp(key, class->classid);
+}
+
+static struct rb_tree activation_cache = { activation_entry_compare };
+static SRWLOCK activation_cache_lock = SRWLOCK_INIT;
+
+static LONG activation_cache_generation;
+static HKEY activatable_classes_key;
+static HANDLE activatable_classes_event;
+static HANDLE activatable_classes_wait;
+
+static BOOL watch_activatable_classes(void)
+{
+    return !RegNotifyChangeKeyValue(activatable_classes_key, TRUE,
+                                    REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC,
+                                    activatable_classes_event, TRUE);
+}
+
+static void CALLBACK activatable_classes_changed(void *context, BOOLEAN timeout)
+{
+    /* re-arm before invalidating, so that no change can slip in between */
+    if (!watch_activatable_classes()) ERR("Failed to re-arm ActivatableClassId notification\n");
+    InterlockedIncrement(&activation_cache_generation);
+}
+
+/* failures are final, registry lookups are then simply never cached */
+static BOOL WINAPI init_activation_cache(INIT_ONCE *once, void *param, void **context)
+{
+    if (RegOpenKeyExW(HKEY_LOCAL_MACHINE, L"Software\\Microsoft\\WindowsRuntime\\ActivatableClassId",
+                      0, KEY_READ | KEY_NOTIFY, &activatable_classes_key))
+    {
+        WARN("ActivatableClassId key not found, registry lookups won't be cached\n");
+        activatable_classes_key = NULL;
+        return TRUE;
+    }
+
+    if (!(activatable_classes_event = CreateEventW(NULL, FALSE, FALSE, NULL)))
+        goto failed;
+    if (!watch_activatable_classes())
+        goto failed;
+    if (!RegisterWaitForSingleObject(&activatable_classes_wait, activatable_classes_event,
+                                     activatable_classes_changed, NULL, INFINITE, WT_EXECUTEDEFAULT))
+        goto failed;
+    return TRUE;
+
+failed:
+    ERR("Failed to watch ActivatableClassId, registry lookups won't be cached\n");
+    if (activatable_classes_event) CloseHandle(activatable_classes_event);
+    activatable_classes_event = NULL;
+    RegCloseKey(activatable_classes_key);
+    activatable_classes_key = NULL;
+    return TRUE;
+}
+
+/* index of the in-package classes, compiled from the AppxManifest.xml next to the main executable */
+static struct appx_index_header *package_index;
+static WCHAR package_dir[MAX_PATH];
+
+static BOOL WINAPI init_package_index(INIT_ONCE *once, void *param, void **context)
+{
+    struct appx_index_header * (WINAPI *load_index)(const WCHAR *package_dir);
+    WCHAR manifest[MAX_PATH], *p;
+    HMODULE module;
+
+    /* failures are final, processes without a usable manifest just don't have package classes */
+    if (!GetModuleFileNameW(NULL, package_dir, ARRAY_SIZE(package_dir)) || !(p = wcsrchr(package_dir, '\\')))
+        return TRUE;
+    *p = 0;
+
+    if (swprintf(manifest, ARRAY_SIZE(manifest), L"%s\\AppxManifest.xml", package_dir) < 0 ||
+        GetFileAttributesW(manifest) == INVALID_FILE_ATTRIBUTES)
+        return TRUE;
+
+    /* the index is read, and compiled if needed, by windows.applicationmodel; it is allocated
+     * from the process heap and kept for the lifetime of the process */
+    if (!(module = LoadLibraryW(L"windows.applicationmodel.dll")))
+        return TRUE;
+    if ((load_index = (void *)GetProcAddress(module, "__wine_load_appx_index")))
+        package_index = load_index(package_dir);
+    FreeLibrary(module);
+
+    if (package_index)
+        TRACE("Found package index for %s with %lu classes\n", debugstr_w(package_dir), package_index->class_count);
+    return TRUE;
+}
+
+static WCHAR *find_package_library(const WCHAR *classid)
+{
+    static INIT_ONCE init_once = INIT_ONCE_STATIC_INIT;
+    const struct appx_index_class *class;
+    const WCHAR *path;
+    WCHAR *library;
+    SIZE_T len;
+
+    InitOnceExecuteOnce(&init_once, init_package_index, NULL, NULL);
+    if (!package_index || !(class = appx_index_find_class(package_index, classid))) return NULL;
+
+    path = appx_index_string(package_index, class->path);
+    len = wcslen(package_dir) + wcslen(path) + 2;
+    if (!(library = malloc(len * sizeof(WCHAR)))) return NULL;
+    swprintf(library, len, L"%s\\%s", package_dir, path);
+    return library;
+}
+
+static const WCHAR *find_actctx_library(const WCHAR *classid)
 {
     ACTCTX_SECTION_KEYED_DATA data;
+    struct activatable_class_data *activatable_class;
+
+    data.cbSize = sizeof(data);
+    if (!FindActCtxSectionStringW(0, NULL, ACTIVATION_CONTEXT_SECTION_WINRT_ACTIVATABLE_CLASSES, classid, &data))
+        return NULL;
+
+    activatable_class = (struct activatable_class_data *)data.lpData;
+    return (const WCHAR *)((BYTE *)data.lpSectionBase + activatable_class->module_offset);
+}
+
+static HRESULT get_library_from_registry(const WCHAR *classid, WCHAR **out)
+{
     HKEY hkey_root, hkey_class;
     DWORD type, size;
     HRESULT hr;
@@ -49,17 +194,6 @@ static HRESULT get_library_for_classid(const WCHAR *classid, WCHAR **out)
 
     *out = NULL;
 
-    /* search activation context first */
-    data.cbSize = sizeof(data);
-    if (FindActCtxSectionStringW(FIND_ACTCTX_SECTION_KEY_RETURN_HACTCTX, NULL,
-            ACTIVATION_CONTEXT_SECTION_WINRT_ACTIVATABLE_CLASSES, classid, &data))
-    {
-        struct activatable_class_data *activatable_class = (struct activatable_class_data *)data.lpData;
-        void *ptr = (BYTE *)data.lpSectionBase + activatable_class->module_offset;
-        *out = wcsdup(ptr);
-        return S_OK;
-    }
-
     /* load class registry key */
     if (RegOpenKeyExW(HKEY_LOCAL_MACHINE, L"Software\\Microsoft\\WindowsRuntime\\ActivatableClassId",
                       0, KEY_READ, &hkey_root))
@@ -110,6 +244,7 @@ static HRESULT get_library_for_classid(const WCHAR *classid, WCHAR **out)
         buf = expanded;
     }
 
+    RegCloseKey(hkey_class);
     *out = buf;
     return S_OK;
 
@@ -119,6 +254,134 @@ done:
     return hr;
 }
 
+/* activation contexts are immutable, so lookups only depend on which one is active */
+static HANDLE get_active_actctx(void)
+{
+    ACTIVATION_CONTEXT_STACK *stack = NtCurrentTeb()->ActivationContextStackPointer;
+
+    if (!stack || !stack->ActiveFrame) return NULL;
+    return stack->ActiveFrame->ActivationContext;
+}
+
+static BOOL activation_entry_is_current(const struct activation_entry *entry, HANDLE actctx)
+{
+    if (entry->actctx != actctx) return FALSE;
+    /* the package index is only read once, package classes can't go away */
+    if (entry->source != ACTIVATION_SOURCE_REGISTRY) return TRUE;
+    return activatable_classes_key && entry->generation == ReadNoFence(&activation_cache_generation);
+}
+
+static HRESULT get_activation_factory_entry(const WCHAR *classid, PFNGETACTIVATIONFACTORY *get_factory)
+{
+    static INIT_ONCE init_once = INIT_ONCE_STATIC_INIT;
+    struct activation_entry *entry;
+    enum activation_source source;
+    const WCHAR *actctx_library;
+    PFNGETACTIVATIONFACTORY func;
+    struct rb_entry *rb;
+    HANDLE actctx;
+    WCHAR *library;
+    HMODULE module;
+    LONG generation;
+    HRESULT hr;
+
+    InitOnceExecuteOnce(&init_once, init_activation_cache, NULL, NULL);
+
+    AcquireSRWLockShared(&activation_cache_lock);
+    if ((rb = rb_get(&activation_cache, classid)))
+    {
+        entry = RB_ENTRY_VALUE(rb, struct activation_entry, entry);
+        if (activation_entry_is_current(entry, get_active_actctx())) *get_factory = entry->get_factory;
+        else rb = NULL;
+    }
+    ReleaseSRWLockShared(&activation_cache_lock);
+    if (rb) return S_OK;
+
+    /* keep the activation context alive, so that it can't be reused while the entry refers to it */
+    if (!GetCurrentActCtx(&actctx)) actctx = NULL;
+
+    /* the activation context is searched first, it only involves in-process lookups */
+    actctx_library = find_actctx_library(classid);
+
+    generation = ReadNoFence(&activation_cache_generation);
+    if (actctx_library)
+    {
+        source = ACTIVATION_SOURCE_ACTCTX;
+        if (!(library = wcsdup(actctx_library)))
+        {
+            hr = E_OUTOFMEMORY;
+            goto failed;
+        }
+    }
+    else if ((library = find_package_library(classid)))
+        source = ACTIVATION_SOURCE_PACKAGE;
+    else if (FAILED(hr = get_library_from_registry(classid, &library)))
+    {
+        ERR("Failed to find library for %s\n", debugstr_w(classid));
+        goto failed;
+    }
+    else source = ACTIVATION_SOURCE_REGISTRY;
+
+    if (!(module = LoadLibraryW(library)))
+    {
+        ERR("Failed to load module %s\n", debugstr_w(library));
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        free(library);
+        goto failed;
+    }
+
+    if (!(func = (void *)GetProcAddress(module, "DllGetActivationFactory")))
+    {
+        ERR("Module %s does not implement DllGetActivationFactory\n", debugstr_w(library));
+        FreeLibrary(module);
+        free(library);
+        hr = E_FAIL;
+        goto failed;
+    }
+
+    TRACE("Found library %s for class %s\n", debugstr_w(library), debugstr_w(classid));
+
+    AcquireSRWLockExclusive(&activation_cache_lock);
+    if ((rb = rb_get(&activation_cache, classid)))
+    {
+        entry = RB_ENTRY_VALUE(rb, struct activation_entry, entry);
+        /* the previous module stays loaded, factories handed out from it may still be alive */
+        if (entry->module == module) FreeLibrary(module);
+        if (entry->actctx) ReleaseActCtx(entry->actctx);
+        free(entry->library);
+    }
+    else if ((entry = calloc(1, sizeof(*entry))) && (entry->classid = wcsdup(classid)))
+        rb_put(&activation_cache, classid, &entry->entry);
+    else
+    {
+        /* keep the module loaded as if it was cached, and just don't remember it */
+        free(entry);
+        entry = NULL;
+    }
+    if (entry)
+    {
+        entry->library = library;
+        entry->source = source;
+        entry->actctx = actctx;
+        entry->generation = generation;
+        entry->module = module;
+        entry->get_factory = func;
+    }
+    else
+    {
+        if (actctx) ReleaseActCtx(actctx);
+        free(library);
+    }
+    ReleaseSRWLockExclusive(&activation_cache_lock);
+
+    *get_factory = func;
+    return S_OK;
+
+failed:
+    if (actctx) ReleaseActCtx(actctx);
+    return hr;
+}
+
 
 /***********************************************************************
  *      RoInitialize (combase.@)
@@ -150,11 +413,9 @@ HRESULT WINAPI DECLSPEC_HOTPATCH RoGetActivationFactory(HSTRING classid, REFIID
 {
     PFNGETACTIVATIONFACTORY pDllGetActivationFactory;
     IActivationFactory *factory;
-    WCHAR *library;
-    HMODULE module;
     HRESULT hr;
 
-    FIXME("(%s, %s, %p): semi-stub\n", debugstr_hstring(classid), debugstr_guid(iid), class_factory);
+    TRACE("(%s, %s, %p)\n", debugstr_hstring(classid), debugstr_guid(iid), class_factory);
 
     if (!iid || !class_factory)
         return E_INVALIDARG;
@@ -162,49 +423,23 @@ HRESULT WINAPI DECLSPEC_HOTPATCH RoGetActivationFactory(HSTRING classid, REFIID
     if (FAILED(hr = ensure_mta()))
         return hr;
 
-    hr = get_library_for_classid(WindowsGetStringRawBuffer(classid, NULL), &library);
+    hr = get_activation_factory_entry(WindowsGetStringRawBuffer(classid, NULL), &pDllGetActivationFactory);
     if (FAILED(hr))
-    {
-        ERR("Failed to find library for %s\n", debugstr_hstring(classid));
         return hr;
-    }
-
-    if (!(module = LoadLibraryW(library)))
-    {
-        ERR("Failed to load module %s\n", debugstr_w(library));
-        hr = HRESULT_FROM_WIN32(GetLastError());
-        goto done;
-    }
-
-    if (!(pDllGetActivationFactory = (void *)GetProcAddress(module, "DllGetActivationFactory")))
-    {
-        ERR("Module %s does not implement DllGetActivationFactory\n", debugstr_w(library));
-        hr = E_FAIL;
-        goto done;
-    }
-
-    TRACE("Found library %s for class %s\n", debugstr_w(library), debugstr_hstring(classid));
 
+    /* factories are not cached, the module decides about their lifetime and apartment */
     hr = pDllGetActivationFactory(classid, &factory);
     if (SUCCEEDED(hr))
     {
         hr = IActivationFactory_QueryInterface(factory, iid, class_factory);
-        if (SUCCEEDED(hr))
-        {
-            ERR("Created interface %p\n", *class_factory);
-            module = NULL;
-        } else {
-            ERR("Module %s QueryInterface failed!\n", debugstr_w(library));
-        }
+        if (FAILED(hr))
+            ERR("Class %s QueryInterface failed!\n", debugstr_hstring(classid));
 
         IActivationFactory_Release(factory);
     } else {
-        ERR("Module %s DllGetActivationFactory failed!\n", debugstr_w(library));
+        ERR("Class %s DllGetActivationFactory failed!\n", debugstr_hstring(classid));
     }
 
-done:
-    free(library);
-    if (module) FreeLibrary(module);
     return hr;
 }
 
@@ -18,6 +18,9 @@
 
 #include <string.h>
 #include <wchar.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "windows.h"
 #include "winerror.h"
@@ -28,12 +31,15 @@ WINE_DEFAULT_DEBUG_CHANNEL(winstring);
 
 #define HSTRING_REFERENCE_FLAG 1
 
+#define HSTRING_STORAGE_SLAB_MASK 0x0f   /* slab size class + 1, 0 if allocated from the heap */
+#define HSTRING_STORAGE_INTERNED  0x10   /* stored in the intern table */
+
 struct hstring_header
 {
     UINT32 flags;
     UINT32 length;
-    UINT32 padding1;
-    UINT32 padding2;
+    UINT32 hash;      /* hash of the contents, valid for interned strings */
+    UINT32 storage;   /* HSTRING_STORAGE_* flags, unused for references */
     const WCHAR *str;
 };
 
@@ -63,15 +69,60 @@ static inline struct hstring_private *impl_from_HSTRING_BUFFER(HSTRING_BUFFER bu
     return CONTAINING_RECORD(buffer, struct hstring_private, buffer);
 }
 
+/* Small strings are carved out of fixed size blocks kept on lock-free free lists,
+ * the blocks are never given back to the heap. */
+#define HSTRING_SLAB_CLASSES 3
+#define HSTRING_SLAB_CHUNK   64
+
+static SLIST_HEADER slab_free_lists[HSTRING_SLAB_CLASSES];
+
+static inline UINT32 slab_class_chars(unsigned int class)
+{
+    return 16 << class;
+}
+
+static inline SIZE_T slab_block_size(unsigned int class)
+{
+    SIZE_T size = offsetof(struct hstring_private, buffer[slab_class_chars(class)]);
+    return (size + MEMORY_ALLOCATION_ALIGNMENT - 1) & ~(SIZE_T)(MEMORY_ALLOCATION_ALIGNMENT - 1);
+}
+
+static struct hstring_private *slab_alloc(unsigned int class)
+{
+    SIZE_T size = slab_block_size(class);
+    SLIST_ENTRY *entry;
+    unsigned int i;
+    BYTE *chunk;
+
+    if ((entry = InterlockedPopEntrySList(&slab_free_lists[class])))
+        return (struct hstring_private *)entry;
+
+    if (!(chunk = malloc(size * HSTRING_SLAB_CHUNK)))
+        return NULL;
+    for (i = 1; i < HSTRING_SLAB_CHUNK; i++)
+        InterlockedPushEntrySList(&slab_free_lists[class], (SLIST_ENTRY *)(chunk + i * size));
+    return (struct hstring_private *)chunk;
+}
+
 static BOOL alloc_string(UINT32 len, HSTRING *out)
 {
-    struct hstring_private *priv;
-    priv = malloc(offsetof(struct hstring_private, buffer[len+1]));
+    struct hstring_private *priv = NULL;
+    unsigned int class;
+
+    for (class = 0; class < HSTRING_SLAB_CLASSES; class++)
+        if (len < slab_class_chars(class)) break;
+
+    if (class < HSTRING_SLAB_CLASSES)
+        priv = slab_alloc(class);
+    else
+        priv = malloc(offsetof(struct hstring_private, buffer[len+1]));
     if (!priv)
         return FALSE;
 
     priv->header.flags = 0;
     priv->header.length = len;
+    priv->header.hash = 0;
+    priv->header.storage = class < HSTRING_SLAB_CLASSES ? class + 1 : 0;
     priv->header.str = priv->buffer;
 
     priv->refcount = 1;
@@ -81,6 +132,168 @@ static BOOL alloc_string(UINT32 len, HSTRING *out)
     return TRUE;
 }
 
+static void free_string(struct hstring_private *priv)
+{
+    UINT32 slab = priv->header.storage & HSTRING_STORAGE_SLAB_MASK;
+
+    if (slab)
+        InterlockedPushEntrySList(&slab_free_lists[slab - 1], (SLIST_ENTRY *)priv);
+    else
+        free(priv);
+}
+
+/* Short strings duplicated from string references (typically runtime class
+ * names and property keys passed as fast-pass strings) are interned, so that
+ * repeated duplicates share one allocation and compare equal by pointer.
+ * The table uses linear probing; once it is mostly full, strings are simply
+ * not interned anymore until some are released. */
+#define HSTRING_INTERN_MAX_LEN 63
+#define HSTRING_INTERN_SIZE    4096
+
+static struct hstring_private *intern_table[HSTRING_INTERN_SIZE];
+static unsigned int intern_count;
+static SRWLOCK intern_lock = SRWLOCK_INIT;
+
+static UINT32 hash_string(const WCHAR *str, UINT32 len)
+{
+    UINT32 i, hash = 2166136261u;
+
+    for (i = 0; i < len; i++) hash = (hash ^ str[i]) * 16777619u;
+    return hash;
+}
+
+static struct hstring_private *find_interned(const WCHAR *str, UINT32 len, UINT32 hash)
+{
+    unsigned int i = hash % HSTRING_INTERN_SIZE;
+    struct hstring_private *priv;
+    LONG ref;
+
+    for (; (priv = intern_table[i]); i = (i + 1) % HSTRING_INTERN_SIZE)
+    {
+        if (priv->header.hash != hash || priv->header.length != len) continue;
+        if (memcmp(priv->buffer, str, len * sizeof(WCHAR))) continue;
+
+        /* a string whose last reference is being released can't be revived */
+        while ((ref = ReadNoFence(&priv->refcount)))
+            if (InterlockedCompareExchange(&priv->refcount, ref + 1, ref) == ref) return priv;
+    }
+
+    return NULL;
+}
+
+static BOOL intern_string(const WCHAR *str, UINT32 len, HSTRING *out)
+{
+    UINT32 hash = hash_string(str, len);
+    struct hstring_private *priv;
+    unsigned int i;
+
+    AcquireSRWLockShared(&intern_lock);
+    priv = find_interned(str, len, hash);
+    ReleaseSRWLockShared(&intern_lock);
+    if (priv)
+    {
+        *out = (HSTRING)priv;
+        return TRUE;
+    }
+
+    AcquireSRWLockExclusive(&intern_lock);
+    if ((priv = find_interned(str, len, hash)))
+        *out = (HSTRING)priv;
+    else if (intern_count >= HSTRING_INTERN_SIZE * 3 / 4)
+        priv = NULL;
+    else if (alloc_string(len, out))
+    {
+        priv = impl_from_HSTRING(*out);
+        memcpy(priv->buffer, str, len * sizeof(*priv->buffer));
+        priv->header.hash = hash;
+        priv->header.storage |= HSTRING_STORAGE_INTERNED;
+
+        for (i = hash % HSTRING_INTERN_SIZE; intern_table[i]; i = (i + 1) % HSTRING_INTERN_SIZE) ;
+        intern_table[i] = priv;
+        intern_count++;
+    }
+    else
+    {
+        ReleaseSRWLockExclusive(&intern_lock);
+        return FALSE;
+    }
+    ReleaseSRWLockExclusive(&intern_lock);
+
+    if (!priv)
+    {
+        if (!alloc_string(len, out)) return FALSE;
+        memcpy(impl_from_HSTRING(*out)->buffer, str, len * sizeof(WCHAR));
+    }
+    return TRUE;
+}
+
+static inline BOOL is_interned(const struct hstring_private *priv)
+{
+    return !(priv->header.flags & HSTRING_REFERENCE_FLAG) && (priv->header.storage & HSTRING_STORAGE_INTERNED);
+}
+
+static void release_interned(struct hstring_private *priv)
+{
+    unsigned int i, j, home;
+
+    AcquireSRWLockExclusive(&intern_lock);
+    for (i = priv->header.hash % HSTRING_INTERN_SIZE; intern_table[i] && intern_table[i] != priv; i = (i + 1) % HSTRING_INTERN_SIZE) ;
+    if (!intern_table[i])
+    {
+        ERR("String %p not found in the intern table\n", priv);
+        ReleaseSRWLockExclusive(&intern_lock);
+        free_string(priv);
+        return;
+    }
+
+    /* backward shift deletion, keeps probe sequences intact without tombstones */
+    for (j = (i + 1) % HSTRING_INTERN_SIZE; intern_table[j]; j = (j + 1) % HSTRING_INTERN_SIZE)
+    {
+        home = intern_table[j]->header.hash % HSTRING_INTERN_SIZE;
+        if ((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j))
+        {
+            intern_table[i] = intern_table[j];
+            i = j;
+        }
+    }
+    intern_table[i] = NULL;
+    intern_count--;
+    ReleaseSRWLockExclusive(&intern_lock);
+
+    free_string(priv);
+}
+
+/* index of the first differing character, or len if there is none */
+static UINT32 ordinal_mismatch(const WCHAR *str1, const WCHAR *str2, UINT32 len)
+{
+    UINT32 i = 0;
+
+#ifdef __SSE2__
+    for (; i + 8 <= len; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(str1 + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(str2 + i));
+        DWORD index, mask = ~_mm_movemask_epi8(_mm_cmpeq_epi16(a, b)) & 0xffff;
+
+        if (!mask) continue;
+        BitScanForward(&index, mask);
+        return i + index / sizeof(WCHAR);
+    }
+#else
+    for (; i + 4 <= len; i += 4)
+    {
+        UINT64 a, b;
+
+        memcpy(&a, str1 + i, sizeof(a));
+        memcpy(&b, str2 + i, sizeof(b));
+        if (a != b) break;
+    }
+#endif
+    for (; i < len; i++)
+        if (str1[i] != str2[i]) break;
+    return i;
+}
+
 /***********************************************************************
  *      WindowsCreateString (combase.@)
  */
@@ -151,7 +364,10 @@ HRESULT WINAPI WindowsDeleteString(HSTRING str)
     if (priv->header.flags & HSTRING_REFERENCE_FLAG)
         return S_OK;
     if (InterlockedDecrement(&priv->refcount) == 0)
-        free(priv);
+    {
+        if (is_interned(priv)) release_interned(priv);
+        else free_string(priv);
+    }
     return S_OK;
 }
 
@@ -172,7 +388,11 @@ HRESULT WINAPI WindowsDuplicateString(HSTRING str, HSTRING *out)
         return S_OK;
     }
     if (priv->header.flags & HSTRING_REFERENCE_FLAG)
-        return WindowsCreateString(priv->header.str, priv->header.length, out);
+    {
+        if (priv->header.length > HSTRING_INTERN_MAX_LEN)
+            return WindowsCreateString(priv->header.str, priv->header.length, out);
+        return intern_string(priv->header.str, priv->header.length, out) ? S_OK : E_OUTOFMEMORY;
+    }
     InterlockedIncrement(&priv->refcount);
     *out = str;
     return S_OK;
@@ -402,7 +622,7 @@ HRESULT WINAPI WindowsCompareStringOrdinal(HSTRING str1, HSTRING str2, INT32 *re
     struct hstring_private *priv1 = impl_from_HSTRING(str1);
     struct hstring_private *priv2 = impl_from_HSTRING(str2);
     const WCHAR *buf1 = empty, *buf2 = empty;
-    UINT32 len1 = 0, len2 = 0;
+    UINT32 i, len1 = 0, len2 = 0;
 
     TRACE("(%p, %p, %p)\n", str1, str2, res);
 
@@ -423,7 +643,10 @@ HRESULT WINAPI WindowsCompareStringOrdinal(HSTRING str1, HSTRING str2, INT32 *re
         buf2 = priv2->header.str;
         len2 = priv2->header.length;
     }
-    *res = CompareStringOrdinal(buf1, len1, buf2, len2, FALSE) - CSTR_EQUAL;
+    if ((i = ordinal_mismatch(buf1, buf2, min(len1, len2))) < min(len1, len2))
+        *res = buf1[i] < buf2[i] ? -1 : 1;
+    else
+        *res = len1 < len2 ? -1 : len1 > len2 ? 1 : 0;
     return S_OK;
 }
 
@@ -21,6 +21,7 @@
 #include "windef.h"
 #include "winbase.h"
 #include "winerror.h"
+#include "winreg.h"
 #include "winstring.h"
 
 #include "initguid.h"
@@ -116,6 +117,162 @@ static void test_ActivationFactories(void)
     RoUninitialize();
 }
 
+static void test_activation_factory_cache(void)
+{
+    LARGE_INTEGER frequency, start, end;
+    IActivationFactory *factory;
+    double cold, warm;
+    unsigned int i, count = 10000, failures = 0;
+    HSTRING str;
+    HRESULT hr;
+    ULONG ref;
+
+    hr = RoInitialize(RO_INIT_MULTITHREADED);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+
+    hr = WindowsCreateString(L"Wine.Test.Trusted", ARRAY_SIZE(L"Wine.Test.Trusted") - 1, &str);
+    ok(hr == S_OK, "WindowsCreateString returned %#lx.\n", hr);
+
+    QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&start);
+    factory = NULL;
+    hr = RoGetActivationFactory(str, &IID_IActivationFactory, (void **)&factory);
+    QueryPerformanceCounter(&end);
+    ok(hr == S_OK || broken(hr == REGDB_E_CLASSNOTREG) /* <= w1064v1809 */,
+            "RoGetActivationFactory returned %#lx.\n", hr);
+    if (FAILED(hr))
+    {
+        win_skip("Wine.Test.Trusted is not available, skipping cache tests.\n");
+        WindowsDeleteString(str);
+        RoUninitialize();
+        return;
+    }
+    ref = IActivationFactory_Release(factory);
+    ok(ref == 0, "Release returned %lu\n", ref);
+    cold = (double)frequency.QuadPart / max(end.QuadPart - start.QuadPart, 1);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++)
+    {
+        factory = NULL;
+        hr = RoGetActivationFactory(str, &IID_IActivationFactory, (void **)&factory);
+        if (FAILED(hr)) failures++;
+        else IActivationFactory_Release(factory);
+    }
+    QueryPerformanceCounter(&end);
+    ok(!failures, "%u RoGetActivationFactory calls failed.\n", failures);
+    warm = (double)count * frequency.QuadPart / max(end.QuadPart - start.QuadPart, 1);
+
+    trace("RoGetActivationFactory: cold %.0f calls/s, warm %.0f calls/s.\n", cold, warm);
+
+    /* the factory is still handed out by the module, not kept alive by combase */
+    hr = RoGetActivationFactory(str, &IID_IActivationFactory, (void **)&factory);
+    ok(hr == S_OK, "RoGetActivationFactory returned %#lx.\n", hr);
+    ref = IActivationFactory_Release(factory);
+    ok(ref == 0, "Release returned %lu\n", ref);
+
+    WindowsDeleteString(str);
+    RoUninitialize();
+}
+
+#define TEST_CLASS_KEY L"Software\\Microsoft\\WindowsRuntime\\ActivatableClassId\\Wine.Test.Registry"
+
+static LSTATUS register_test_class(const WCHAR *library)
+{
+    DWORD type = 0;
+    LSTATUS ret;
+    HKEY key;
+
+    ret = RegCreateKeyExW(HKEY_LOCAL_MACHINE, TEST_CLASS_KEY, 0, NULL, 0, KEY_WRITE, NULL, &key, NULL);
+    if (ret) return ret;
+    ret = RegSetValueExW(key, L"DllPath", 0, REG_SZ, (const BYTE *)library, (lstrlenW(library) + 1) * sizeof(WCHAR));
+    if (!ret) ret = RegSetValueExW(key, L"ActivationType", 0, REG_DWORD, (const BYTE *)&type, sizeof(type));
+    RegCloseKey(key);
+    return ret;
+}
+
+static HRESULT wait_activation_factory(HSTRING str, HRESULT expect)
+{
+    IActivationFactory *factory;
+    unsigned int i;
+    HRESULT hr;
+
+    /* key changes are noticed asynchronously */
+    for (i = 0; i < 50; i++)
+    {
+        factory = NULL;
+        hr = RoGetActivationFactory(str, &IID_IActivationFactory, (void **)&factory);
+        if (factory) IActivationFactory_Release(factory);
+        if (hr == expect) break;
+        Sleep(100);
+    }
+    return hr;
+}
+
+static void test_activation_factory_registry(void)
+{
+    WCHAR library[MAX_PATH], missing[MAX_PATH];
+    IActivationFactory *factory;
+    unsigned int i, failures = 0;
+    LSTATUS ret;
+    HSTRING str;
+    HRESULT hr;
+
+    GetFullPathNameW(L"wine.combase.test.dll", ARRAY_SIZE(library), library, NULL);
+    GetFullPathNameW(L"wine.combase.missing.dll", ARRAY_SIZE(missing), missing, NULL);
+
+    hr = RoInitialize(RO_INIT_MULTITHREADED);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+    hr = WindowsCreateString(L"Wine.Test.Registry", ARRAY_SIZE(L"Wine.Test.Registry") - 1, &str);
+    ok(hr == S_OK, "WindowsCreateString returned %#lx.\n", hr);
+
+    hr = RoGetActivationFactory(str, &IID_IActivationFactory, (void **)&factory);
+    ok(hr == REGDB_E_CLASSNOTREG, "RoGetActivationFactory returned %#lx.\n", hr);
+
+    if ((ret = register_test_class(library)))
+    {
+        ok(ret == ERROR_ACCESS_DENIED, "Failed to register class, error %lu.\n", ret);
+        skip("Not enough permissions to register classes.\n");
+        goto done;
+    }
+
+    hr = wait_activation_factory(str, S_OK);
+    ok(hr == S_OK, "RoGetActivationFactory returned %#lx.\n", hr);
+
+    for (i = 0; i < 100; i++)
+    {
+        factory = NULL;
+        hr = RoGetActivationFactory(str, &IID_IActivationFactory, (void **)&factory);
+        if (FAILED(hr)) failures++;
+        else IActivationFactory_Release(factory);
+    }
+    ok(!failures, "%u RoGetActivationFactory calls failed.\n", failures);
+
+    /* a changed DllPath is used for later activations */
+    ret = register_test_class(missing);
+    ok(!ret, "Failed to register class, error %lu.\n", ret);
+    hr = wait_activation_factory(str, HRESULT_FROM_WIN32(ERROR_MOD_NOT_FOUND));
+    ok(hr == HRESULT_FROM_WIN32(ERROR_MOD_NOT_FOUND), "RoGetActivationFactory returned %#lx.\n", hr);
+
+    ret = register_test_class(library);
+    ok(!ret, "Failed to register class, error %lu.\n", ret);
+    hr = wait_activation_factory(str, S_OK);
+    ok(hr == S_OK, "RoGetActivationFactory returned %#lx.\n", hr);
+
+    /* and so is a removed class */
+    ret = RegDeleteKeyW(HKEY_LOCAL_MACHINE, TEST_CLASS_KEY);
+    ok(!ret, "Failed to delete class key, error %lu.\n", ret);
+    hr = wait_activation_factory(str, REGDB_E_CLASSNOTREG);
+    ok(hr == REGDB_E_CLASSNOTREG, "RoGetActivationFactory returned %#lx.\n", hr);
+
+done:
+    /* don't leave the class behind if any of the above failed */
+    RegDeleteKeyW(HKEY_LOCAL_MACHINE, TEST_CLASS_KEY);
+    WindowsDeleteString(str);
+    RoUninitialize();
+}
+
 static APTTYPE check_thread_apttype;
 static APTTYPEQUALIFIER check_thread_aptqualifier;
 static HRESULT check_thread_hr;
@@ -318,6 +475,8 @@ START_TEST(roapi)
     load_resource(L"wine.combase.test.dll");
 
     test_implicit_mta();
+    test_activation_factory_cache();
+    test_activation_factory_registry();
     test_ActivationFactories();
 
     SetLastError(0xdeadbeef);
@@ -118,8 +118,9 @@ static void test_create_delete(void)
 
 static void test_duplicate(void)
 {
-    HSTRING str, str2;
+    HSTRING str, str2, str3;
     HSTRING_HEADER header;
+    INT32 res;
     ok(WindowsCreateString(input_string, 6, &str) == S_OK, "Failed to create string\n");
     ok(WindowsDuplicateString(str, NULL) == E_INVALIDARG, "Incorrect error handling\n");
     ok(WindowsDuplicateString(str, &str2) == S_OK, "Failed to duplicate string\n");
@@ -133,6 +134,26 @@ static void test_duplicate(void)
     ok(WindowsDeleteString(str) == S_OK, "Failed to delete string\n");
     ok(WindowsDeleteString(str2) == S_OK, "Failed to delete string ref\n");
 
+    /* Duplicates of string references outlive each other and the reference */
+    ok(WindowsCreateStringReference(input_string, 6, &header, &str) == S_OK, "Failed to create string ref\n");
+    ok(WindowsDuplicateString(str, &str2) == S_OK, "Failed to duplicate string\n");
+    ok(WindowsDuplicateString(str, &str3) == S_OK, "Failed to duplicate string\n");
+    ok(str3 != str, "Duplicated string ref didn't create new string\n");
+    ok(WindowsGetStringRawBuffer(str2, NULL) == WindowsGetStringRawBuffer(str3, NULL)
+            || broken(WindowsGetStringRawBuffer(str2, NULL) != WindowsGetStringRawBuffer(str3, NULL)) /* native */,
+            "Duplicates of a string ref don't share storage\n");
+    ok(WindowsCompareStringOrdinal(str2, str3, &res) == S_OK, "Failed to compare string\n");
+    ok(res == 0, "Expected 0, got %d\n", res);
+    ok(WindowsDeleteString(str) == S_OK, "Failed to delete string ref\n");
+    ok(WindowsDeleteString(str2) == S_OK, "Failed to delete string\n");
+    check_string(str3, input_string, 6, FALSE);
+    ok(WindowsCreateStringReference(input_string, 6, &header, &str) == S_OK, "Failed to create string ref\n");
+    ok(WindowsDuplicateString(str, &str2) == S_OK, "Failed to duplicate string\n");
+    ok(WindowsDeleteString(str3) == S_OK, "Failed to delete string\n");
+    check_string(str2, input_string, 6, FALSE);
+    ok(WindowsDeleteString(str2) == S_OK, "Failed to delete string\n");
+    ok(WindowsDeleteString(str) == S_OK, "Failed to delete string ref\n");
+
     ok(WindowsDuplicateString(NULL, &str2) == S_OK, "Failed to duplicate NULL string\n");
     ok(str2 == NULL, "Duplicated string created new string\n");
     ok(WindowsDeleteString(str2) == S_OK, "Failed to delete string\n");
@@ -349,6 +370,8 @@ static void test_concat(void)
 
 static void test_compare(void)
 {
+    WCHAR long_string1[37], long_string2[37];
+    unsigned int i;
     HSTRING str1, str2;
     HSTRING_HEADER header1, header2;
     INT32 res;
@@ -405,6 +428,45 @@ static void test_compare(void)
     ok(WindowsCompareStringOrdinal(NULL, NULL, NULL) == E_INVALIDARG, "Incorrect error handling\n");
     ok(WindowsCompareStringOrdinal(NULL, NULL, &res) == S_OK, "Failed to compare NULL string\n");
     ok(res == 0, "Expected 0, got %d\n", res);
+
+    /* Test comparison of longer strings, differing at every position */
+    for (i = 0; i < ARRAY_SIZE(long_string1); i++)
+    {
+        long_string1[i] = long_string2[i] = 'a' + i % 26;
+    }
+    ok(WindowsCreateString(long_string1, ARRAY_SIZE(long_string1), &str1) == S_OK, "Failed to create string\n");
+    for (i = 0; i < ARRAY_SIZE(long_string2); i++)
+    {
+        long_string2[i] = 0xfffe;
+        ok(WindowsCreateString(long_string2, ARRAY_SIZE(long_string2), &str2) == S_OK, "Failed to create string\n");
+        ok(WindowsCompareStringOrdinal(str1, str2, &res) == S_OK, "Failed to compare string\n");
+        ok(res == -1, "%u: Expected -1, got %d\n", i, res);
+        ok(WindowsCompareStringOrdinal(str2, str1, &res) == S_OK, "Failed to compare string\n");
+        ok(res == 1, "%u: Expected 1, got %d\n", i, res);
+        ok(WindowsDeleteString(str2) == S_OK, "Failed to delete string\n");
+        long_string2[i] = long_string1[i];
+    }
+    ok(WindowsCreateString(long_string2, ARRAY_SIZE(long_string2), &str2) == S_OK, "Failed to create string\n");
+    ok(WindowsCompareStringOrdinal(str1, str2, &res) == S_OK, "Failed to compare string\n");
+    ok(res == 0, "Expected 0, got %d\n", res);
+    ok(WindowsDeleteString(str2) == S_OK, "Failed to delete string\n");
+    ok(WindowsCreateString(long_string2, ARRAY_SIZE(long_string2) - 1, &str2) == S_OK, "Failed to create string\n");
+    ok(WindowsCompareStringOrdinal(str1, str2, &res) == S_OK, "Failed to compare string\n");
+    ok(res == 1, "Expected 1, got %d\n", res);
+    ok(WindowsDeleteString(str2) == S_OK, "Failed to delete string\n");
+    ok(WindowsDeleteString(str1) == S_OK, "Failed to delete string\n");
+
+    /* Test comparison of duplicated string refs */
+    ok(WindowsCreateStringReference(long_string1, 6, &header1, &str1) == S_OK, "Failed to create string ref\n");
+    ok(WindowsCreateStringReference(long_string1, 7, &header2, &str2) == S_OK, "Failed to create string ref\n");
+    ok(WindowsDuplicateString(str1, &str1) == S_OK, "Failed to duplicate string\n");
+    ok(WindowsDuplicateString(str2, &str2) == S_OK, "Failed to duplicate string\n");
+    ok(WindowsCompareStringOrdinal(str1, str2, &res) == S_OK, "Failed to compare string\n");
+    ok(res == -1, "Expected -1, got %d\n", res);
+    ok(WindowsCompareStringOrdinal(str2, str1, &res) == S_OK, "Failed to compare string\n");
+    ok(res == 1, "Expected 1, got %d\n", res);
+    ok(WindowsDeleteString(str2) == S_OK, "Failed to delete string\n");
+    ok(WindowsDeleteString(str1) == S_OK, "Failed to delete string\n");
 }
 
 static void test_trim(void)
@@ -147,7 +147,7 @@ HRESULT WINAPI DllGetActivationFactory(HSTRING classid, IActivationFactory **fac
         IActivationFactory_AddRef((*factory = &class_factory.IActivationFactory_iface));
         return S_OK;
     }
-    if (!wcscmp(buffer, L"Wine.Test.Trusted"))
+    if (!wcscmp(buffer, L"Wine.Test.Trusted") || !wcscmp(buffer, L"Wine.Test.Registry"))
     {
         IActivationFactory_AddRef((*factory = &trusted_factory.IActivationFactory_iface));
         return S_OK;
@@ -118,17 +118,16 @@ static const struct IActivationFactoryVtbl factory_vtbl =
 
 DEFINE_IINSPECTABLE( credentials_statics, IKeyCredentialManagerStatics, struct credentials_statics, IActivationFactory_iface );
 
-static HRESULT WINAPI is_supported_async( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+static HRESULT WINAPI is_supported_async( IUnknown *invoker, IUnknown *param, BOOLEAN *result )
 {
-    result->vt = VT_BOOL;
-    result->boolVal = FALSE;
+    *result = FALSE;
     return S_OK;
 }
 
 static HRESULT WINAPI credentials_statics_IsSupportedAsync( IKeyCredentialManagerStatics *iface, IAsyncOperation_boolean **value )
 {
     TRACE( "iface %p, value %p.\n", iface, value );
-    return async_operation_boolean_create( (IUnknown *)iface, NULL, is_supported_async, value );
+    return async_operation_boolean_create( (IUnknown *)iface, NULL, is_supported_async, ASYNC_RUN_INLINE, value );
 }
 
 static HRESULT WINAPI credentials_statics_RenewAttestationAsync( IKeyCredentialManagerStatics *iface, IAsyncAction **operation )
@@ -37,7 +37,7 @@
 #define WIDL_using_Windows_Security_Credentials
 #include "windows.security.credentials.h"
 
-#include "provider.h"
+#include "wine/winrtasync.h"
 
 struct buffer_impl
 {
@@ -50,10 +50,6 @@ struct buffer_impl
 
 extern IActivationFactory *credentials_activation_factory;
 
-typedef HRESULT (WINAPI *async_operation_callback)( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
-extern HRESULT async_operation_boolean_create( IUnknown *invoker, IUnknown *param, async_operation_callback callback,
-                                               IAsyncOperation_boolean **out );
-
 extern struct buffer_impl* alloc_buffer(UINT32 length);
 
 #define DEFINE_IINSPECTABLE_( pfx, iface_type, impl_type, impl_from, iface_mem, expr )             \
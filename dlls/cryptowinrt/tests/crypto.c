@@ -320,6 +320,64 @@ static void test_Credentials_Statics(void)
     IActivationFactory_Release( factory );
 }
 
+static void test_async_throughput(void)
+{
+    static const WCHAR *credentials_statics_name = L"Windows.Security.Credentials.KeyCredentialManager";
+    IKeyCredentialManagerStatics *credentials_statics;
+    LARGE_INTEGER frequency, start, end;
+    unsigned int i, count = 10000, failures = 0;
+    IAsyncOperation_boolean *bool_async;
+    IActivationFactory *factory;
+    AsyncStatus status;
+    IAsyncInfo *async_info;
+    BOOLEAN result;
+    double elapsed;
+    HSTRING str;
+    HRESULT hr;
+
+    hr = WindowsCreateString( credentials_statics_name, wcslen( credentials_statics_name ), &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = RoGetActivationFactory( str, &IID_IActivationFactory, (void **)&factory );
+    WindowsDeleteString( str );
+    ok( hr == S_OK || broken( hr == REGDB_E_CLASSNOTREG ), "got hr %#lx.\n", hr );
+    if (hr == REGDB_E_CLASSNOTREG)
+    {
+        win_skip( "%s runtimeclass not registered, skipping tests.\n", wine_dbgstr_w( credentials_statics_name ) );
+        return;
+    }
+
+    hr = IActivationFactory_QueryInterface( factory, &IID_IKeyCredentialManagerStatics, (void **)&credentials_statics );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < count; i++)
+    {
+        if (FAILED(hr = IKeyCredentialManagerStatics_IsSupportedAsync( credentials_statics, &bool_async )))
+        {
+            failures++;
+            continue;
+        }
+
+        hr = IAsyncOperation_boolean_QueryInterface( bool_async, &IID_IAsyncInfo, (void **)&async_info );
+        ok( hr == S_OK, "QueryInterface returned %#lx\n", hr );
+        while (SUCCEEDED(hr = IAsyncInfo_get_Status( async_info, &status )) && status == Started) YieldProcessor();
+        if (FAILED(hr) || status != Completed) failures++;
+        else if (FAILED(IAsyncOperation_boolean_GetResults( bool_async, &result ))) failures++;
+        IAsyncInfo_Release( async_info );
+
+        IAsyncOperation_boolean_Release( bool_async );
+    }
+    QueryPerformanceCounter( &end );
+    ok( !failures, "%u asynchronous operations failed.\n", failures );
+
+    elapsed = (double)max( end.QuadPart - start.QuadPart, 1 ) / frequency.QuadPart;
+    trace( "IsSupportedAsync: %.0f operations/s, %.2f us per operation.\n", count / elapsed, elapsed * 1000000 / count );
+
+    IKeyCredentialManagerStatics_Release( credentials_statics );
+    IActivationFactory_Release( factory );
+}
+
 START_TEST(crypto)
 {
     HRESULT hr;
@@ -329,6 +387,7 @@ START_TEST(crypto)
 
     test_CryptobufferStatics();
     test_Credentials_Statics();
+    test_async_throughput();
 
     RoUninitialize();
 }
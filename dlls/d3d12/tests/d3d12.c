@@ -22,6 +22,7 @@
 #include "initguid.h"
 #include "d3d12.h"
 #include "d3d12sdklayers.h"
+#include "d3dcompiler.h"
 #include "dxgi1_6.h"
 #include "wine/test.h"
 
@@ -154,6 +155,23 @@ static void print_adapter_info(void)
             adapter_desc.VendorId, adapter_desc.DeviceId);
 }
 
+static ID3DBlob *compile_shader(const char *source, size_t len, const char *profile)
+{
+    ID3DBlob *bytecode = NULL, *errors = NULL;
+    HRESULT hr;
+
+    hr = D3DCompile(source, len, NULL, NULL, NULL, "main", profile, 0, 0, &bytecode, &errors);
+    ok(hr == S_OK, "Cannot compile shader, hr %#lx.\n", hr);
+    ok(!!bytecode, "Compilation didn't produce any bytecode.\n");
+    if (errors)
+    {
+        trace("Compilation errors:\n%s\n", (char *)ID3D10Blob_GetBufferPointer(errors));
+        ID3D10Blob_Release(errors);
+    }
+
+    return bytecode;
+}
+
 static ULONG get_refcount(void *iface)
 {
     IUnknown *unknown = iface;
@@ -1497,6 +1515,262 @@ static void test_invalid_command_queue_types(void)
     ok(!refcount, "Device has %lu references left.\n", refcount);
 }
 
+struct shader_cache_state
+{
+    unsigned int generation;
+    UINT64 data_end;
+};
+
+static BOOL read_file_head(const char *path, void *data, DWORD size)
+{
+    HANDLE file;
+    DWORD count;
+    BOOL ret;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return FALSE;
+    ret = ReadFile(file, data, size, &count, NULL) && count == size;
+    CloseHandle(file);
+    return ret;
+}
+
+/* vkd3d keeps the current generation of its shader cache in a root file, and
+ * appends the compiled shaders to the file of that generation. */
+static void get_shader_cache_state(struct shader_cache_state *state)
+{
+    char dir[MAX_PATH], path[MAX_PATH];
+    UINT64 header[2];
+    DWORD root[4];
+    BOOL ret;
+
+    GetEnvironmentVariableA("VKD3D_SHADER_CACHE_PATH", dir, sizeof(dir));
+    sprintf(path, "%s\\vkd3d-shader.cache", dir);
+    ret = read_file_head(path, root, sizeof(root));
+    ok(ret, "Failed to read %s.\n", path);
+    state->generation = ret ? root[2] : 0;
+    sprintf(path, "%s\\vkd3d-shader.cache.%u", dir, state->generation);
+    ret = read_file_head(path, header, sizeof(header));
+    ok(ret, "Failed to read %s.\n", path);
+    state->data_end = ret ? header[1] : 0;
+}
+
+static ID3D12RootSignature *create_uav_root_signature(ID3D12Device *device, BOOL root_constants)
+{
+    D3D12_ROOT_SIGNATURE_DESC root_signature_desc;
+    ID3D12RootSignature *root_signature = NULL;
+    D3D12_DESCRIPTOR_RANGE descriptor_range;
+    D3D12_ROOT_PARAMETER root_parameters[2];
+    HRESULT hr;
+
+    descriptor_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+    descriptor_range.NumDescriptors = 1;
+    descriptor_range.BaseShaderRegister = 0;
+    descriptor_range.RegisterSpace = 0;
+    descriptor_range.OffsetInDescriptorsFromTableStart = 0;
+    root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    root_parameters[0].DescriptorTable.NumDescriptorRanges = 1;
+    root_parameters[0].DescriptorTable.pDescriptorRanges = &descriptor_range;
+    root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    root_parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    root_parameters[1].Constants.ShaderRegister = 0;
+    root_parameters[1].Constants.RegisterSpace = 0;
+    root_parameters[1].Constants.Num32BitValues = 4;
+    root_parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+    root_signature_desc.NumParameters = root_constants ? 2 : 1;
+    root_signature_desc.pParameters = root_parameters;
+    root_signature_desc.NumStaticSamplers = 0;
+    root_signature_desc.pStaticSamplers = NULL;
+    root_signature_desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+    hr = create_root_signature(device, &root_signature_desc, &root_signature);
+    ok(hr == S_OK, "Got unexpected hr %#lx.\n", hr);
+
+    return root_signature;
+}
+
+/* Create a pipeline state with a compute shader of a few KiB, which differs
+ * for each id, and return whether its SPIR-V was found in the shader cache. */
+static BOOL create_cached_pipeline_state(ID3D12Device *device, ID3D12RootSignature *root_signature,
+        unsigned int id)
+{
+    D3D12_COMPUTE_PIPELINE_STATE_DESC pipeline_state_desc;
+    struct shader_cache_state state, state2;
+    ID3D12PipelineState *pipeline_state;
+    char source[16384], *p;
+    ID3DBlob *bytecode;
+    unsigned int i;
+    HRESULT hr;
+
+    p = source + sprintf(source, "RWBuffer<uint> u;\n\n[numthreads(1, 1, 1)]\nvoid main()\n{\n    uint x = u[0];\n");
+    for (i = 0; i < 256; ++i)
+        p += sprintf(p, "    x = x * 3 + %u;\n", id * 256 + i);
+    p += sprintf(p, "    u[0] = x;\n}\n");
+    bytecode = compile_shader(source, p - source, "cs_5_0");
+
+    get_shader_cache_state(&state);
+    memset(&pipeline_state_desc, 0, sizeof(pipeline_state_desc));
+    pipeline_state_desc.pRootSignature = root_signature;
+    pipeline_state_desc.CS.pShaderBytecode = ID3D10Blob_GetBufferPointer(bytecode);
+    pipeline_state_desc.CS.BytecodeLength = ID3D10Blob_GetBufferSize(bytecode);
+    hr = ID3D12Device_CreateComputePipelineState(device, &pipeline_state_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to create compute pipeline state, hr %#lx.\n", hr);
+    get_shader_cache_state(&state2);
+
+    ID3D12PipelineState_Release(pipeline_state);
+    ID3D10Blob_Release(bytecode);
+    return state2.generation == state.generation && state2.data_end == state.data_end;
+}
+
+static void test_shader_cache_child(const char *step)
+{
+    ID3D12RootSignature *root_signature, *root_signature2;
+    struct shader_cache_state state, state2;
+    unsigned int i, hits;
+    ID3D12Device *device;
+    ULONG refcount;
+    BOOL hit;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+    root_signature = create_uav_root_signature(device, FALSE);
+    root_signature2 = create_uav_root_signature(device, TRUE);
+
+    if (!strcmp(step, "store"))
+    {
+        hit = create_cached_pipeline_state(device, root_signature, 0);
+        ok(!hit, "Expected a cache miss.\n");
+        hit = create_cached_pipeline_state(device, root_signature, 0);
+        ok(hit, "Expected a cache hit.\n");
+    }
+    else if (!strcmp(step, "load"))
+    {
+        hit = create_cached_pipeline_state(device, root_signature, 0);
+        ok(hit, "Expected a cache hit.\n");
+        /* the key covers the shader interface */
+        hit = create_cached_pipeline_state(device, root_signature2, 0);
+        ok(!hit, "Expected a cache miss.\n");
+        hit = create_cached_pipeline_state(device, root_signature2, 0);
+        ok(hit, "Expected a cache hit.\n");
+    }
+    else if (!strcmp(step, "fill"))
+    {
+        /* compaction switches to the next generation of the cache file */
+        get_shader_cache_state(&state);
+        for (i = 1; i < 500; ++i)
+        {
+            create_cached_pipeline_state(device, root_signature, i);
+            get_shader_cache_state(&state2);
+            if (state2.generation != state.generation)
+                break;
+        }
+        ok(state2.generation > state.generation, "The shader cache was not compacted.\n");
+    }
+    else if (!strcmp(step, "evict"))
+    {
+        /* the shader last used before filling the cache was evicted first */
+        hit = create_cached_pipeline_state(device, root_signature, 0);
+        ok(!hit, "Expected a cache miss.\n");
+        get_shader_cache_state(&state);
+        for (i = 1, hits = 0; i < 500; ++i)
+        {
+            hits += create_cached_pipeline_state(device, root_signature, i);
+            get_shader_cache_state(&state2);
+            if (state2.generation != state.generation)
+                break;
+        }
+        ok(hits, "Expected cache hits.\n");
+    }
+
+    ID3D12RootSignature_Release(root_signature2);
+    ID3D12RootSignature_Release(root_signature);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %lu references left.\n", refcount);
+}
+
+static void run_shader_cache_child(const char *step)
+{
+    PROCESS_INFORMATION pi;
+    char cmdline[MAX_PATH * 2];
+    STARTUPINFOA si = {0};
+    char **argv;
+    BOOL ret;
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" d3d12 shader_cache %s", argv[0], step);
+    si.cb = sizeof(si);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "Failed to create process, error %lu.\n", GetLastError());
+    if (!ret)
+        return;
+    wait_child_process(pi.hProcess);
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+}
+
+static void test_shader_cache(void)
+{
+    char temp_path[MAX_PATH], cache_dir[MAX_PATH], path[MAX_PATH];
+    struct shader_cache_state state;
+    WIN32_FIND_DATAA find_data;
+    ID3D12Device *device;
+    HANDLE find;
+    BOOL ret;
+
+    if (strcmp(winetest_platform, "wine"))
+    {
+        skip("The shader cache is specific to vkd3d.\n");
+        return;
+    }
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+    ID3D12Device_Release(device);
+
+    GetTempPathA(ARRAY_SIZE(temp_path), temp_path);
+    GetTempFileNameA(temp_path, "vkd", 0, cache_dir);
+    DeleteFileA(cache_dir);
+    ret = CreateDirectoryA(cache_dir, NULL);
+    ok(ret, "Failed to create %s, error %lu.\n", cache_dir, GetLastError());
+    /* vkd3d reads these when creating a device, in the child processes */
+    SetEnvironmentVariableA("VKD3D_SHADER_CACHE_PATH", cache_dir);
+    SetEnvironmentVariableA("VKD3D_SHADER_CACHE_SIZE", "1");
+
+    run_shader_cache_child("store");
+    run_shader_cache_child("load");
+    run_shader_cache_child("fill");
+    get_shader_cache_state(&state);
+    ok(state.generation > 1, "Got generation %u.\n", state.generation);
+    ok(state.data_end <= 1 << 20, "Got size %s.\n", wine_dbgstr_longlong(state.data_end));
+    run_shader_cache_child("evict");
+
+    /* retired generations are deleted once no process maps them */
+    sprintf(path, "%s\\vkd3d-shader.cache.1", cache_dir);
+    ok(GetFileAttributesA(path) == INVALID_FILE_ATTRIBUTES, "%s was not deleted.\n", path);
+
+    SetEnvironmentVariableA("VKD3D_SHADER_CACHE_SIZE", NULL);
+    SetEnvironmentVariableA("VKD3D_SHADER_CACHE_PATH", NULL);
+    sprintf(path, "%s\\*", cache_dir);
+    if ((find = FindFirstFileA(path, &find_data)) != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            sprintf(path, "%s\\%s", cache_dir, find_data.cFileName);
+            DeleteFileA(path);
+        } while (FindNextFileA(find, &find_data));
+        FindClose(find);
+    }
+    ret = RemoveDirectoryA(cache_dir);
+    ok(ret, "Failed to remove %s, error %lu.\n", cache_dir, GetLastError());
+}
+
 START_TEST(d3d12)
 {
     BOOL enable_debug_layer = FALSE;
@@ -1505,6 +1779,11 @@ START_TEST(d3d12)
     char **argv;
 
     argc = winetest_get_mainargs(&argv);
+    if (argc >= 4 && !strcmp(argv[2], "shader_cache"))
+    {
+        test_shader_cache_child(argv[3]);
+        return;
+    }
     for (i = 2; i < argc; ++i)
     {
         if (!strcmp(argv[i], "--validate"))
@@ -1533,4 +1812,5 @@ START_TEST(d3d12)
     test_swapchain_backbuffer_index();
     test_desktop_window();
     test_invalid_command_queue_types();
+    test_shader_cache();
 }
@@ -3856,6 +3856,145 @@ static void test_GdiAlphaBlend(void)
     free(bmi);
 }
 
+static BYTE blend_channel(BYTE dst, BYTE src, BYTE src_alpha, BLENDFUNCTION blend)
+{
+    if (blend.AlphaFormat & AC_SRC_ALPHA)
+    {
+        src = (src * blend.SourceConstantAlpha + 127) / 255;
+        src_alpha = (src_alpha * blend.SourceConstantAlpha + 127) / 255;
+        return src + (dst * (255 - src_alpha) + 127) / 255;
+    }
+    return (src * blend.SourceConstantAlpha + dst * (255 - blend.SourceConstantAlpha) + 127) / 255;
+}
+
+static void test_GdiAlphaBlend_pixels(void)
+{
+    static const BLENDFUNCTION blends[] =
+    {
+        { AC_SRC_OVER, 0, 128, 0 },
+        { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA },
+        { AC_SRC_OVER, 0, 100, AC_SRC_ALPHA },
+    };
+    static const WORD bpps[] = { 32, 24 };
+    const int width = 67, height = 13;
+    LARGE_INTEGER freq, start, end;
+    BITMAPINFO bmi = {{ sizeof(bmi.bmiHeader) }};
+    BYTE *src_bits, *dst_bits, *expect;
+    HBITMAP src_bmp, dst_bmp, old_src, old_dst;
+    HDC src_dc, dst_dc;
+    int i, j, x, y, c, bad, count;
+    UINT stride;
+    BOOL ret;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip("GdiAlphaBlend() is not implemented\n");
+        return;
+    }
+
+    src_dc = CreateCompatibleDC(NULL);
+    dst_dc = CreateCompatibleDC(NULL);
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biBitCount = 32;
+    src_bmp = CreateDIBSection(src_dc, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0);
+    ok(src_bmp != NULL, "Couldn't create source bitmap\n");
+    old_src = SelectObject(src_dc, src_bmp);
+
+    /* premultiplied source pixels */
+    srand(1234);
+    for (i = 0; i < width * height; i++)
+    {
+        BYTE alpha = rand() & 0xff;
+        for (c = 0; c < 3; c++) src_bits[i * 4 + c] = (rand() & 0xff) * alpha / 255;
+        src_bits[i * 4 + 3] = alpha;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(bpps); i++)
+    {
+        stride = ((width * bpps[i] / 8) + 3) & ~3;
+        bmi.bmiHeader.biBitCount = bpps[i];
+        dst_bmp = CreateDIBSection(dst_dc, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0);
+        ok(dst_bmp != NULL, "Couldn't create destination bitmap\n");
+        old_dst = SelectObject(dst_dc, dst_bmp);
+        expect = malloc(stride * height);
+
+        for (j = 0; j < ARRAY_SIZE(blends); j++)
+        {
+            winetest_push_context("bpp %u, blend %u", bpps[i], j);
+
+            for (y = 0; y < height; y++)
+                for (x = 0; x < stride; x++)
+                    expect[y * stride + x] = dst_bits[y * stride + x] = rand() & 0xff;
+            for (y = 0; y < height; y++)
+            {
+                for (x = 0; x < width; x++)
+                {
+                    const BYTE *src = src_bits + (y * width + x) * 4;
+                    BYTE *dst = expect + y * stride + x * bpps[i] / 8;
+                    BYTE src_alpha = (blends[j].AlphaFormat & AC_SRC_ALPHA) ? src[3] : 0;
+
+                    for (c = 0; c < 3; c++) dst[c] = blend_channel(dst[c], src[c], src_alpha, blends[j]);
+                    if (bpps[i] == 32) dst[3] = blend_channel(dst[3], src[3], src_alpha, blends[j]);
+                }
+            }
+
+            ret = pGdiAlphaBlend(dst_dc, 0, 0, width, height, src_dc, 0, 0, width, height, blends[j]);
+            ok(ret, "GdiAlphaBlend failed err %lu\n", GetLastError());
+
+            for (y = bad = 0; y < height; y++)
+                for (x = 0; x < width * bpps[i] / 8; x++)
+                    if (dst_bits[y * stride + x] != expect[y * stride + x] &&
+                        !broken(abs(dst_bits[y * stride + x] - expect[y * stride + x]) <= 1 ||
+                                (bpps[i] == 32 && x % 4 == 3)))
+                        bad++;
+            ok(!bad, "got %u unexpected values\n", bad);
+
+            winetest_pop_context();
+        }
+
+        free(expect);
+        SelectObject(dst_dc, old_dst);
+        DeleteObject(dst_bmp);
+    }
+
+    /* throughput of large blends */
+    SelectObject(src_dc, old_src);
+    DeleteObject(src_bmp);
+    bmi.bmiHeader.biWidth = 1024;
+    bmi.bmiHeader.biHeight = -1024;
+    bmi.bmiHeader.biBitCount = 32;
+    src_bmp = CreateDIBSection(src_dc, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0);
+    old_src = SelectObject(src_dc, src_bmp);
+    memset(src_bits, 0x80, 1024 * 1024 * 4);
+    QueryPerformanceFrequency(&freq);
+
+    for (i = 0; i < ARRAY_SIZE(bpps); i++)
+    {
+        bmi.bmiHeader.biBitCount = bpps[i];
+        dst_bmp = CreateDIBSection(dst_dc, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0);
+        old_dst = SelectObject(dst_dc, dst_bmp);
+
+        QueryPerformanceCounter(&start);
+        for (count = 0; count < 20; count++)
+            pGdiAlphaBlend(dst_dc, 0, 0, 1024, 1024, src_dc, 0, 0, 1024, 1024, blends[1]);
+        QueryPerformanceCounter(&end);
+        trace("%u bpp: %.1f megapixels/s\n", bpps[i],
+              count * 1024.0 * 1024.0 / 1000000.0 * freq.QuadPart / max(end.QuadPart - start.QuadPart, 1));
+
+        SelectObject(dst_dc, old_dst);
+        DeleteObject(dst_bmp);
+    }
+
+    SelectObject(src_dc, old_src);
+    DeleteDC(dst_dc);
+    DeleteDC(src_dc);
+    DeleteObject(src_bmp);
+}
+
 static void test_GdiGradientFill(void)
 {
     HDC hdc;
@@ -6011,6 +6150,7 @@ START_TEST(bitmap)
     test_StretchBlt();
     test_StretchDIBits();
     test_GdiAlphaBlend();
+    test_GdiAlphaBlend_pixels();
     test_GdiGradientFill();
     test_32bit_ddb();
     test_bitmapinfoheadersize();
@@ -5785,6 +5785,182 @@ static void test_overlapped_read(void)
     ok(ret, "Unexpected error %lu.\n", GetLastError());
 }
 
+static BOOL queue_depth_read(HANDLE file, OVERLAPPED *ov, void *buffer, DWORD size, unsigned int chunk)
+{
+    BOOL ret;
+
+    memset(ov, 0, sizeof(*ov));
+    ov->Offset = chunk * size;
+    ret = ReadFile(file, buffer, size, NULL, ov);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "ReadFile failed, error %lu.\n", GetLastError());
+    return ret || GetLastError() == ERROR_IO_PENDING;
+}
+
+static void test_overlapped_queue_depth(void)
+{
+    static const unsigned int depths[] = {1, 8, 32, 128};
+    static const char prefix[] = "pfx";
+    unsigned int i, j, slot, depth, chunk_count = 256, chunk_size = 0x10000, next, done, outstanding;
+    LARGE_INTEGER freq, start, end;
+    char temp_path[MAX_PATH];
+    char file_name[MAX_PATH];
+    OVERLAPPED *ov, *overlapped;
+    DWORD *data, bytes_count;
+    HANDLE hfile, port;
+    ULONG_PTR key;
+    double seconds;
+    BOOL ret;
+
+    ret = GetTempPathA(MAX_PATH, temp_path);
+    ok(ret, "Unexpected error %lu.\n", GetLastError());
+    ret = GetTempFileNameA(temp_path, prefix, 0, file_name);
+    ok(ret, "Unexpected error %lu.\n", GetLastError());
+
+    data = malloc(128 * chunk_size);
+    ov = calloc(128, sizeof(*ov));
+
+    hfile = CreateFileA(file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(hfile != INVALID_HANDLE_VALUE, "Failed to create file, GetLastError() %lu.\n", GetLastError());
+    for (i = 0; i < chunk_count; i++)
+    {
+        for (j = 0; j < chunk_size / sizeof(DWORD); j++) data[j] = i * chunk_size + j;
+        ret = WriteFile(hfile, data, chunk_size, &bytes_count, NULL);
+        ok(ret && bytes_count == chunk_size, "WriteFile failed, error %lu.\n", GetLastError());
+    }
+    CloseHandle(hfile);
+
+    QueryPerformanceFrequency(&freq);
+    for (i = 0; i < ARRAY_SIZE(depths); i++)
+    {
+        depth = depths[i];
+        hfile = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                FILE_FLAG_OVERLAPPED, NULL);
+        ok(hfile != INVALID_HANDLE_VALUE, "Failed to open file, GetLastError() %lu.\n", GetLastError());
+        port = CreateIoCompletionPort(hfile, NULL, 0xdead, 0);
+        ok(port != NULL, "CreateIoCompletionPort failed, error %lu.\n", GetLastError());
+
+        QueryPerformanceCounter(&start);
+        next = done = outstanding = 0;
+        for (slot = 0; slot < depth; slot++)
+            if (!queue_depth_read(hfile, &ov[slot], (char *)data + slot * chunk_size, chunk_size, next++)) break;
+        outstanding = slot;
+        while (outstanding)
+        {
+            ret = GetQueuedCompletionStatus(port, &bytes_count, &key, &overlapped, 5000);
+            ok(ret, "GetQueuedCompletionStatus failed, error %lu.\n", GetLastError());
+            if (!ret) break;
+            ok(key == 0xdead, "Got key %#Ix.\n", key);
+            ok(bytes_count == chunk_size, "Got %lu bytes.\n", bytes_count);
+            slot = overlapped - ov;
+            j = overlapped->Offset / chunk_size;
+            ok(data[slot * chunk_size / sizeof(DWORD)] == j * chunk_size &&
+                    data[(slot + 1) * chunk_size / sizeof(DWORD) - 1] == j * chunk_size + chunk_size / sizeof(DWORD) - 1,
+                    "Got unexpected data for chunk %u at depth %u.\n", j, depth);
+            outstanding--;
+            done++;
+
+            if (next < chunk_count &&
+                    queue_depth_read(hfile, overlapped, (char *)data + slot * chunk_size, chunk_size, next++))
+                outstanding++;
+        }
+        QueryPerformanceCounter(&end);
+        ok(done == chunk_count, "Completed %u of %u reads at depth %u.\n", done, chunk_count, depth);
+
+        seconds = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+        if (seconds > 0.0)
+            trace("queue depth %u: %.1f MB/s.\n", depth, chunk_count * (double)chunk_size / seconds / (1024 * 1024));
+
+        CloseHandle(port);
+        CloseHandle(hfile);
+    }
+
+    free(ov);
+    free(data);
+    ret = DeleteFileA(file_name);
+    ok(ret, "Unexpected error %lu.\n", GetLastError());
+}
+
+static void test_overlapped_cancel(void)
+{
+    static const char prefix[] = "pfx";
+    unsigned int i, j, count = 64, chunk_size = 0x10000, canceled = 0;
+    char temp_path[MAX_PATH];
+    char file_name[MAX_PATH];
+    DWORD *data, bytes_count;
+    OVERLAPPED *ov;
+    HANDLE hfile;
+    BOOL ret;
+
+    ret = GetTempPathA(MAX_PATH, temp_path);
+    ok(ret, "Unexpected error %lu.\n", GetLastError());
+    ret = GetTempFileNameA(temp_path, prefix, 0, file_name);
+    ok(ret, "Unexpected error %lu.\n", GetLastError());
+
+    data = malloc(count * chunk_size);
+    ov = calloc(count, sizeof(*ov));
+
+    hfile = CreateFileA(file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(hfile != INVALID_HANDLE_VALUE, "Failed to create file, GetLastError() %lu.\n", GetLastError());
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < chunk_size / sizeof(DWORD); j++) data[j] = i * chunk_size + j;
+        ret = WriteFile(hfile, data, chunk_size, &bytes_count, NULL);
+        ok(ret && bytes_count == chunk_size, "WriteFile failed, error %lu.\n", GetLastError());
+    }
+    CloseHandle(hfile);
+
+    hfile = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_FLAG_OVERLAPPED, NULL);
+    ok(hfile != INVALID_HANDLE_VALUE, "Failed to open file, GetLastError() %lu.\n", GetLastError());
+
+    for (i = 0; i < count; i++)
+    {
+        ov[i].Offset = i * chunk_size;
+        ov[i].hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+        ret = ReadFile(hfile, (char *)data + i * chunk_size, chunk_size, NULL, &ov[i]);
+        ok(ret || GetLastError() == ERROR_IO_PENDING, "ReadFile failed, error %lu.\n", GetLastError());
+    }
+
+    /* reads that already completed are not found, nor are those too far along to be canceled,
+     * which are complete by the time CancelIoEx returns */
+    ret = CancelIoEx(hfile, &ov[count - 1]);
+    ok(ret || GetLastError() == ERROR_NOT_FOUND, "CancelIoEx failed, error %lu.\n", GetLastError());
+    if (!ret) ok(HasOverlappedIoCompleted(&ov[count - 1]), "Read is still pending.\n");
+    ret = CancelIoEx(hfile, NULL);
+    ok(ret || GetLastError() == ERROR_NOT_FOUND, "CancelIoEx failed, error %lu.\n", GetLastError());
+
+    for (i = 0; i < count; i++)
+    {
+        ret = WaitForSingleObject(ov[i].hEvent, 5000);
+        ok(!ret, "Read %u was not completed, ret %#x.\n", i, ret);
+        ret = GetOverlappedResult(hfile, &ov[i], &bytes_count, FALSE);
+        if (!ret)
+        {
+            ok(GetLastError() == ERROR_OPERATION_ABORTED, "Got error %lu for read %u.\n", GetLastError(), i);
+            ok(!bytes_count, "Got %lu bytes for canceled read %u.\n", bytes_count, i);
+            canceled++;
+        }
+        else
+        {
+            ok(bytes_count == chunk_size, "Got %lu bytes for read %u.\n", bytes_count, i);
+            ok(data[i * chunk_size / sizeof(DWORD)] == i * chunk_size, "Got unexpected data for read %u.\n", i);
+        }
+        CloseHandle(ov[i].hEvent);
+    }
+    trace("%u of %u reads canceled.\n", canceled, count);
+
+    /* nothing is left to cancel */
+    SetLastError(0xdeadbeef);
+    ret = CancelIoEx(hfile, &ov[0]);
+    ok(!ret && GetLastError() == ERROR_NOT_FOUND, "Got ret %d, error %lu.\n", ret, GetLastError());
+
+    CloseHandle(hfile);
+    free(ov);
+    free(data);
+    ret = DeleteFileA(file_name);
+    ok(ret, "Unexpected error %lu.\n", GetLastError());
+}
+
 static void test_file_readonly_access(void)
 {
     static const DWORD default_sharing = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
@@ -6363,6 +6539,8 @@ START_TEST(file)
     test_GetFileAttributesExW();
     test_post_completion();
     test_overlapped_read();
+    test_overlapped_queue_depth();
+    test_overlapped_cancel();
     test_file_readonly_access();
     test_find_file_stream();
     test_SetFileTime();
@@ -1674,6 +1674,74 @@ static void test_tls_links(void)
     CloseHandle(test_tls_links_done);
 }
 
+static void test_module_lookups(void)
+{
+    static const char *dlls[] =
+    {
+        "advapi32.dll", "comctl32.dll", "comdlg32.dll", "crypt32.dll", "gdi32.dll", "imm32.dll",
+        "msvcrt.dll", "ole32.dll", "oleaut32.dll", "rpcrt4.dll", "setupapi.dll", "shell32.dll",
+        "shlwapi.dll", "user32.dll", "uxtheme.dll", "version.dll", "winmm.dll", "ws2_32.dll",
+        "wininet.dll", "winspool.drv", "combase.dll", "dbghelp.dll", "iphlpapi.dll", "secur32.dll",
+    };
+    HMODULE kernel32 = GetModuleHandleA("kernel32.dll"), mods[ARRAY_SIZE(dlls)], mod;
+    const IMAGE_NT_HEADERS *nt;
+    const IMAGE_EXPORT_DIRECTORY *exports;
+    const DWORD *names;
+    const WORD *ordinals;
+    char path[MAX_PATH];
+    LARGE_INTEGER freq, start, end;
+    FARPROC proc;
+    unsigned int i, count;
+
+    /* every exported name resolves to the same address as its ordinal */
+    nt = (const IMAGE_NT_HEADERS *)((const char *)kernel32 + ((const IMAGE_DOS_HEADER *)kernel32)->e_lfanew);
+    exports = (const IMAGE_EXPORT_DIRECTORY *)((const char *)kernel32 +
+              nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress);
+    names = (const DWORD *)((const char *)kernel32 + exports->AddressOfNames);
+    ordinals = (const WORD *)((const char *)kernel32 + exports->AddressOfNameOrdinals);
+    ok(exports->NumberOfNames > 1000, "got %lu names.\n", exports->NumberOfNames);
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        const char *name = (const char *)kernel32 + names[i];
+        proc = GetProcAddress(kernel32, name);
+        ok(proc == GetProcAddress(kernel32, MAKEINTRESOURCEA(ordinals[i] + exports->Base)),
+           "got %p for %s.\n", proc, name);
+    }
+    proc = GetProcAddress(kernel32, "getprocaddress");
+    ok(!proc, "got %p.\n", proc);
+    proc = GetProcAddress(kernel32, "GetProcAddressX");
+    ok(!proc, "got %p.\n", proc);
+
+    /* module names are case-insensitive, both as base names and full paths */
+    mod = GetModuleHandleA("KERNEL32.DLL");
+    ok(mod == kernel32, "got %p.\n", mod);
+    GetModuleFileNameA(kernel32, path, MAX_PATH);
+    for (i = 0; path[i]; i++) if (path[i] >= 'a' && path[i] <= 'z') path[i] += 'A' - 'a';
+    mod = GetModuleHandleA(path);
+    ok(mod == kernel32, "got %p.\n", mod);
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = count = 0; i < ARRAY_SIZE(dlls); i++)
+        if ((mods[i] = LoadLibraryA(dlls[i]))) count++;
+    QueryPerformanceCounter(&end);
+    trace("loaded %u dlls in %.2f ms.\n", count, (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < 100000; i++)
+    {
+        mod = GetModuleHandleA(dlls[i % ARRAY_SIZE(dlls)]);
+        if (mod != mods[i % ARRAY_SIZE(dlls)]) break;
+        GetProcAddress(kernel32, (const char *)kernel32 + names[i % exports->NumberOfNames]);
+    }
+    QueryPerformanceCounter(&end);
+    ok(i == 100000, "got %p for %s.\n", mod, dlls[i % ARRAY_SIZE(dlls)]);
+    trace("100000 module and export lookups in %.2f ms.\n", (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart);
+
+    for (i = 0; i < ARRAY_SIZE(dlls); i++)
+        if (mods[i]) FreeLibrary(mods[i]);
+}
+
 START_TEST(module)
 {
     WCHAR filenameW[MAX_PATH];
@@ -1711,4 +1779,5 @@ START_TEST(module)
     test_apisets();
     test_ddag_node();
     test_tls_links();
+    test_module_lookups();
 }
@@ -16,233 +16,236 @@
     SYSCALL_ENTRY( 0x000c, NtAllocateVirtualMemoryEx, 28 ) \
     SYSCALL_ENTRY( 0x000d, NtAreMappedFilesTheSame, 8 ) \
     SYSCALL_ENTRY( 0x000e, NtAssignProcessToJobObject, 8 ) \
-    SYSCALL_ENTRY( 0x000f, NtCallbackReturn, 12 ) \
-    SYSCALL_ENTRY( 0x0010, NtCancelIoFile, 8 ) \
-    SYSCALL_ENTRY( 0x0011, NtCancelIoFileEx, 12 ) \
-    SYSCALL_ENTRY( 0x0012, NtCancelSynchronousIoFile, 12 ) \
-    SYSCALL_ENTRY( 0x0013, NtCancelTimer, 8 ) \
-    SYSCALL_ENTRY( 0x0014, NtClearEvent, 4 ) \
-    SYSCALL_ENTRY( 0x0015, NtClose, 4 ) \
-    SYSCALL_ENTRY( 0x0016, NtCommitTransaction, 8 ) \
-    SYSCALL_ENTRY( 0x0017, NtCompareObjects, 8 ) \
-    SYSCALL_ENTRY( 0x0018, NtCompareTokens, 12 ) \
-    SYSCALL_ENTRY( 0x0019, NtCompleteConnectPort, 4 ) \
-    SYSCALL_ENTRY( 0x001a, NtConnectPort, 32 ) \
-    SYSCALL_ENTRY( 0x001b, NtContinue, 8 ) \
-    SYSCALL_ENTRY( 0x001c, NtCreateDebugObject, 16 ) \
-    SYSCALL_ENTRY( 0x001d, NtCreateDirectoryObject, 12 ) \
-    SYSCALL_ENTRY( 0x001e, NtCreateEvent, 20 ) \
-    SYSCALL_ENTRY( 0x001f, NtCreateFile, 44 ) \
-    SYSCALL_ENTRY( 0x0020, NtCreateIoCompletion, 16 ) \
-    SYSCALL_ENTRY( 0x0021, NtCreateJobObject, 12 ) \
-    SYSCALL_ENTRY( 0x0022, NtCreateKey, 28 ) \
-    SYSCALL_ENTRY( 0x0023, NtCreateKeyTransacted, 32 ) \
-    SYSCALL_ENTRY( 0x0024, NtCreateKeyedEvent, 16 ) \
-    SYSCALL_ENTRY( 0x0025, NtCreateLowBoxToken, 36 ) \
-    SYSCALL_ENTRY( 0x0026, NtCreateMailslotFile, 32 ) \
-    SYSCALL_ENTRY( 0x0027, NtCreateMutant, 16 ) \
-    SYSCALL_ENTRY( 0x0028, NtCreateNamedPipeFile, 56 ) \
-    SYSCALL_ENTRY( 0x0029, NtCreatePagingFile, 16 ) \
-    SYSCALL_ENTRY( 0x002a, NtCreatePort, 20 ) \
-    SYSCALL_ENTRY( 0x002b, NtCreateSection, 28 ) \
-    SYSCALL_ENTRY( 0x002c, NtCreateSemaphore, 20 ) \
-    SYSCALL_ENTRY( 0x002d, NtCreateSymbolicLinkObject, 16 ) \
-    SYSCALL_ENTRY( 0x002e, NtCreateThread, 32 ) \
-    SYSCALL_ENTRY( 0x002f, NtCreateThreadEx, 44 ) \
-    SYSCALL_ENTRY( 0x0030, NtCreateTimer, 16 ) \
-    SYSCALL_ENTRY( 0x0031, NtCreateToken, 52 ) \
-    SYSCALL_ENTRY( 0x0032, NtCreateTransaction, 40 ) \
-    SYSCALL_ENTRY( 0x0033, NtCreateUserProcess, 44 ) \
-    SYSCALL_ENTRY( 0x0034, NtDebugActiveProcess, 8 ) \
-    SYSCALL_ENTRY( 0x0035, NtDebugContinue, 12 ) \
-    SYSCALL_ENTRY( 0x0036, NtDelayExecution, 8 ) \
-    SYSCALL_ENTRY( 0x0037, NtDeleteAtom, 4 ) \
-    SYSCALL_ENTRY( 0x0038, NtDeleteFile, 4 ) \
-    SYSCALL_ENTRY( 0x0039, NtDeleteKey, 4 ) \
-    SYSCALL_ENTRY( 0x003a, NtDeleteValueKey, 8 ) \
-    SYSCALL_ENTRY( 0x003b, NtDeviceIoControlFile, 40 ) \
-    SYSCALL_ENTRY( 0x003c, NtDisplayString, 4 ) \
-    SYSCALL_ENTRY( 0x003d, NtDuplicateObject, 28 ) \
-    SYSCALL_ENTRY( 0x003e, NtDuplicateToken, 24 ) \
-    SYSCALL_ENTRY( 0x003f, NtEnumerateKey, 24 ) \
-    SYSCALL_ENTRY( 0x0040, NtEnumerateValueKey, 24 ) \
-    SYSCALL_ENTRY( 0x0041, NtFilterToken, 24 ) \
-    SYSCALL_ENTRY( 0x0042, NtFindAtom, 12 ) \
-    SYSCALL_ENTRY( 0x0043, NtFlushBuffersFile, 8 ) \
-    SYSCALL_ENTRY( 0x0044, NtFlushInstructionCache, 12 ) \
-    SYSCALL_ENTRY( 0x0045, NtFlushKey, 4 ) \
-    SYSCALL_ENTRY( 0x0046, NtFlushProcessWriteBuffers, 0 ) \
-    SYSCALL_ENTRY( 0x0047, NtFlushVirtualMemory, 16 ) \
-    SYSCALL_ENTRY( 0x0048, NtFreeVirtualMemory, 16 ) \
-    SYSCALL_ENTRY( 0x0049, NtFsControlFile, 40 ) \
-    SYSCALL_ENTRY( 0x004a, NtGetContextThread, 8 ) \
-    SYSCALL_ENTRY( 0x004b, NtGetCurrentProcessorNumber, 0 ) \
-    SYSCALL_ENTRY( 0x004c, NtGetNextThread, 24 ) \
-    SYSCALL_ENTRY( 0x004d, NtGetNlsSectionPtr, 20 ) \
-    SYSCALL_ENTRY( 0x004e, NtGetWriteWatch, 28 ) \
-    SYSCALL_ENTRY( 0x004f, NtImpersonateAnonymousToken, 4 ) \
-    SYSCALL_ENTRY( 0x0050, NtInitializeNlsFiles, 12 ) \
-    SYSCALL_ENTRY( 0x0051, NtInitiatePowerAction, 16 ) \
-    SYSCALL_ENTRY( 0x0052, NtIsProcessInJob, 8 ) \
-    SYSCALL_ENTRY( 0x0053, NtListenPort, 8 ) \
-    SYSCALL_ENTRY( 0x0054, NtLoadDriver, 4 ) \
-    SYSCALL_ENTRY( 0x0055, NtLoadKey, 8 ) \
-    SYSCALL_ENTRY( 0x0056, NtLoadKey2, 12 ) \
-    SYSCALL_ENTRY( 0x0057, NtLoadKeyEx, 32 ) \
-    SYSCALL_ENTRY( 0x0058, NtLockFile, 40 ) \
-    SYSCALL_ENTRY( 0x0059, NtLockVirtualMemory, 16 ) \
-    SYSCALL_ENTRY( 0x005a, NtMakePermanentObject, 4 ) \
-    SYSCALL_ENTRY( 0x005b, NtMakeTemporaryObject, 4 ) \
-    SYSCALL_ENTRY( 0x005c, NtMapViewOfSection, 40 ) \
-    SYSCALL_ENTRY( 0x005d, NtMapViewOfSectionEx, 36 ) \
-    SYSCALL_ENTRY( 0x005e, NtNotifyChangeDirectoryFile, 36 ) \
-    SYSCALL_ENTRY( 0x005f, NtNotifyChangeKey, 40 ) \
-    SYSCALL_ENTRY( 0x0060, NtNotifyChangeMultipleKeys, 48 ) \
-    SYSCALL_ENTRY( 0x0061, NtOpenDirectoryObject, 12 ) \
-    SYSCALL_ENTRY( 0x0062, NtOpenEvent, 12 ) \
-    SYSCALL_ENTRY( 0x0063, NtOpenFile, 24 ) \
-    SYSCALL_ENTRY( 0x0064, NtOpenIoCompletion, 12 ) \
-    SYSCALL_ENTRY( 0x0065, NtOpenJobObject, 12 ) \
-    SYSCALL_ENTRY( 0x0066, NtOpenKey, 12 ) \
-    SYSCALL_ENTRY( 0x0067, NtOpenKeyEx, 16 ) \
-    SYSCALL_ENTRY( 0x0068, NtOpenKeyTransacted, 16 ) \
-    SYSCALL_ENTRY( 0x0069, NtOpenKeyTransactedEx, 20 ) \
-    SYSCALL_ENTRY( 0x006a, NtOpenKeyedEvent, 12 ) \
-    SYSCALL_ENTRY( 0x006b, NtOpenMutant, 12 ) \
-    SYSCALL_ENTRY( 0x006c, NtOpenProcess, 16 ) \
-    SYSCALL_ENTRY( 0x006d, NtOpenProcessToken, 12 ) \
-    SYSCALL_ENTRY( 0x006e, NtOpenProcessTokenEx, 16 ) \
-    SYSCALL_ENTRY( 0x006f, NtOpenSection, 12 ) \
-    SYSCALL_ENTRY( 0x0070, NtOpenSemaphore, 12 ) \
-    SYSCALL_ENTRY( 0x0071, NtOpenSymbolicLinkObject, 12 ) \
-    SYSCALL_ENTRY( 0x0072, NtOpenThread, 16 ) \
-    SYSCALL_ENTRY( 0x0073, NtOpenThreadToken, 16 ) \
-    SYSCALL_ENTRY( 0x0074, NtOpenThreadTokenEx, 20 ) \
-    SYSCALL_ENTRY( 0x0075, NtOpenTimer, 12 ) \
-    SYSCALL_ENTRY( 0x0076, NtPowerInformation, 20 ) \
-    SYSCALL_ENTRY( 0x0077, NtPrivilegeCheck, 12 ) \
-    SYSCALL_ENTRY( 0x0078, NtProtectVirtualMemory, 20 ) \
-    SYSCALL_ENTRY( 0x0079, NtPulseEvent, 8 ) \
-    SYSCALL_ENTRY( 0x007a, NtQueryAttributesFile, 8 ) \
-    SYSCALL_ENTRY( 0x007b, NtQueryDefaultLocale, 8 ) \
-    SYSCALL_ENTRY( 0x007c, NtQueryDefaultUILanguage, 4 ) \
-    SYSCALL_ENTRY( 0x007d, NtQueryDirectoryFile, 44 ) \
-    SYSCALL_ENTRY( 0x007e, NtQueryDirectoryObject, 28 ) \
-    SYSCALL_ENTRY( 0x007f, NtQueryEaFile, 36 ) \
-    SYSCALL_ENTRY( 0x0080, NtQueryEvent, 20 ) \
-    SYSCALL_ENTRY( 0x0081, NtQueryFullAttributesFile, 8 ) \
-    SYSCALL_ENTRY( 0x0082, NtQueryInformationAtom, 20 ) \
-    SYSCALL_ENTRY( 0x0083, NtQueryInformationFile, 20 ) \
-    SYSCALL_ENTRY( 0x0084, NtQueryInformationJobObject, 20 ) \
-    SYSCALL_ENTRY( 0x0085, NtQueryInformationProcess, 20 ) \
-    SYSCALL_ENTRY( 0x0086, NtQueryInformationThread, 20 ) \
-    SYSCALL_ENTRY( 0x0087, NtQueryInformationToken, 20 ) \
-    SYSCALL_ENTRY( 0x0088, NtQueryInstallUILanguage, 4 ) \
-    SYSCALL_ENTRY( 0x0089, NtQueryIoCompletion, 20 ) \
-    SYSCALL_ENTRY( 0x008a, NtQueryKey, 20 ) \
-    SYSCALL_ENTRY( 0x008b, NtQueryLicenseValue, 20 ) \
-    SYSCALL_ENTRY( 0x008c, NtQueryMultipleValueKey, 24 ) \
-    SYSCALL_ENTRY( 0x008d, NtQueryMutant, 20 ) \
-    SYSCALL_ENTRY( 0x008e, NtQueryObject, 20 ) \
-    SYSCALL_ENTRY( 0x008f, NtQueryPerformanceCounter, 8 ) \
-    SYSCALL_ENTRY( 0x0090, NtQuerySection, 20 ) \
-    SYSCALL_ENTRY( 0x0091, NtQuerySecurityObject, 20 ) \
-    SYSCALL_ENTRY( 0x0092, NtQuerySemaphore, 20 ) \
-    SYSCALL_ENTRY( 0x0093, NtQuerySymbolicLinkObject, 12 ) \
-    SYSCALL_ENTRY( 0x0094, NtQuerySystemEnvironmentValue, 16 ) \
-    SYSCALL_ENTRY( 0x0095, NtQuerySystemEnvironmentValueEx, 20 ) \
-    SYSCALL_ENTRY( 0x0096, NtQuerySystemInformation, 16 ) \
-    SYSCALL_ENTRY( 0x0097, NtQuerySystemInformationEx, 24 ) \
-    SYSCALL_ENTRY( 0x0098, NtQuerySystemTime, 4 ) \
-    SYSCALL_ENTRY( 0x0099, NtQueryTimer, 20 ) \
-    SYSCALL_ENTRY( 0x009a, NtQueryTimerResolution, 12 ) \
-    SYSCALL_ENTRY( 0x009b, NtQueryValueKey, 24 ) \
-    SYSCALL_ENTRY( 0x009c, NtQueryVirtualMemory, 24 ) \
-    SYSCALL_ENTRY( 0x009d, NtQueryVolumeInformationFile, 20 ) \
-    SYSCALL_ENTRY( 0x009e, NtQueueApcThread, 20 ) \
-    SYSCALL_ENTRY( 0x009f, NtQueueApcThreadEx, 24 ) \
-    SYSCALL_ENTRY( 0x00a0, NtRaiseException, 12 ) \
-    SYSCALL_ENTRY( 0x00a1, NtRaiseHardError, 24 ) \
-    SYSCALL_ENTRY( 0x00a2, NtReadFile, 36 ) \
-    SYSCALL_ENTRY( 0x00a3, NtReadFileScatter, 36 ) \
-    SYSCALL_ENTRY( 0x00a4, NtReadVirtualMemory, 20 ) \
-    SYSCALL_ENTRY( 0x00a5, NtRegisterThreadTerminatePort, 4 ) \
-    SYSCALL_ENTRY( 0x00a6, NtReleaseKeyedEvent, 16 ) \
-    SYSCALL_ENTRY( 0x00a7, NtReleaseMutant, 8 ) \
-    SYSCALL_ENTRY( 0x00a8, NtReleaseSemaphore, 12 ) \
-    SYSCALL_ENTRY( 0x00a9, NtRemoveIoCompletion, 20 ) \
-    SYSCALL_ENTRY( 0x00aa, NtRemoveIoCompletionEx, 24 ) \
-    SYSCALL_ENTRY( 0x00ab, NtRemoveProcessDebug, 8 ) \
-    SYSCALL_ENTRY( 0x00ac, NtRenameKey, 8 ) \
-    SYSCALL_ENTRY( 0x00ad, NtReplaceKey, 12 ) \
-    SYSCALL_ENTRY( 0x00ae, NtReplyWaitReceivePort, 16 ) \
-    SYSCALL_ENTRY( 0x00af, NtRequestWaitReplyPort, 12 ) \
-    SYSCALL_ENTRY( 0x00b0, NtResetEvent, 8 ) \
-    SYSCALL_ENTRY( 0x00b1, NtResetWriteWatch, 12 ) \
-    SYSCALL_ENTRY( 0x00b2, NtRestoreKey, 12 ) \
-    SYSCALL_ENTRY( 0x00b3, NtResumeProcess, 4 ) \
-    SYSCALL_ENTRY( 0x00b4, NtResumeThread, 8 ) \
-    SYSCALL_ENTRY( 0x00b5, NtRollbackTransaction, 8 ) \
-    SYSCALL_ENTRY( 0x00b6, NtSaveKey, 8 ) \
-    SYSCALL_ENTRY( 0x00b7, NtSecureConnectPort, 36 ) \
-    SYSCALL_ENTRY( 0x00b8, NtSetContextThread, 8 ) \
-    SYSCALL_ENTRY( 0x00b9, NtSetDebugFilterState, 12 ) \
-    SYSCALL_ENTRY( 0x00ba, NtSetDefaultLocale, 8 ) \
-    SYSCALL_ENTRY( 0x00bb, NtSetDefaultUILanguage, 4 ) \
-    SYSCALL_ENTRY( 0x00bc, NtSetEaFile, 16 ) \
-    SYSCALL_ENTRY( 0x00bd, NtSetEvent, 8 ) \
-    SYSCALL_ENTRY( 0x00be, NtSetInformationDebugObject, 20 ) \
-    SYSCALL_ENTRY( 0x00bf, NtSetInformationFile, 20 ) \
-    SYSCALL_ENTRY( 0x00c0, NtSetInformationJobObject, 16 ) \
-    SYSCALL_ENTRY( 0x00c1, NtSetInformationKey, 16 ) \
-    SYSCALL_ENTRY( 0x00c2, NtSetInformationObject, 16 ) \
-    SYSCALL_ENTRY( 0x00c3, NtSetInformationProcess, 16 ) \
-    SYSCALL_ENTRY( 0x00c4, NtSetInformationThread, 16 ) \
-    SYSCALL_ENTRY( 0x00c5, NtSetInformationToken, 16 ) \
-    SYSCALL_ENTRY( 0x00c6, NtSetInformationVirtualMemory, 24 ) \
-    SYSCALL_ENTRY( 0x00c7, NtSetIntervalProfile, 8 ) \
-    SYSCALL_ENTRY( 0x00c8, NtSetIoCompletion, 20 ) \
-    SYSCALL_ENTRY( 0x00c9, NtSetLdtEntries, 24 ) \
-    SYSCALL_ENTRY( 0x00ca, NtSetSecurityObject, 12 ) \
-    SYSCALL_ENTRY( 0x00cb, NtSetSystemInformation, 12 ) \
-    SYSCALL_ENTRY( 0x00cc, NtSetSystemTime, 8 ) \
-    SYSCALL_ENTRY( 0x00cd, NtSetThreadExecutionState, 8 ) \
-    SYSCALL_ENTRY( 0x00ce, NtSetTimer, 28 ) \
-    SYSCALL_ENTRY( 0x00cf, NtSetTimerResolution, 12 ) \
-    SYSCALL_ENTRY( 0x00d0, NtSetValueKey, 24 ) \
-    SYSCALL_ENTRY( 0x00d1, NtSetVolumeInformationFile, 20 ) \
-    SYSCALL_ENTRY( 0x00d2, NtShutdownSystem, 4 ) \
-    SYSCALL_ENTRY( 0x00d3, NtSignalAndWaitForSingleObject, 16 ) \
-    SYSCALL_ENTRY( 0x00d4, NtSuspendProcess, 4 ) \
-    SYSCALL_ENTRY( 0x00d5, NtSuspendThread, 8 ) \
-    SYSCALL_ENTRY( 0x00d6, NtSystemDebugControl, 24 ) \
-    SYSCALL_ENTRY( 0x00d7, NtTerminateJobObject, 8 ) \
-    SYSCALL_ENTRY( 0x00d8, NtTerminateProcess, 8 ) \
-    SYSCALL_ENTRY( 0x00d9, NtTerminateThread, 8 ) \
-    SYSCALL_ENTRY( 0x00da, NtTestAlert, 0 ) \
-    SYSCALL_ENTRY( 0x00db, NtTraceControl, 24 ) \
-    SYSCALL_ENTRY( 0x00dc, NtUnloadDriver, 4 ) \
-    SYSCALL_ENTRY( 0x00dd, NtUnloadKey, 4 ) \
-    SYSCALL_ENTRY( 0x00de, NtUnlockFile, 20 ) \
-    SYSCALL_ENTRY( 0x00df, NtUnlockVirtualMemory, 16 ) \
-    SYSCALL_ENTRY( 0x00e0, NtUnmapViewOfSection, 8 ) \
-    SYSCALL_ENTRY( 0x00e1, NtUnmapViewOfSectionEx, 12 ) \
-    SYSCALL_ENTRY( 0x00e2, NtWaitForAlertByThreadId, 8 ) \
-    SYSCALL_ENTRY( 0x00e3, NtWaitForDebugEvent, 16 ) \
-    SYSCALL_ENTRY( 0x00e4, NtWaitForKeyedEvent, 16 ) \
-    SYSCALL_ENTRY( 0x00e5, NtWaitForMultipleObjects, 20 ) \
-    SYSCALL_ENTRY( 0x00e6, NtWaitForSingleObject, 12 ) \
-    SYSCALL_ENTRY( 0x00e7, NtWow64AllocateVirtualMemory64, 28 ) \
-    SYSCALL_ENTRY( 0x00e8, NtWow64GetNativeSystemInformation, 16 ) \
-    SYSCALL_ENTRY( 0x00e9, NtWow64IsProcessorFeaturePresent, 4 ) \
-    SYSCALL_ENTRY( 0x00ea, NtWow64ReadVirtualMemory64, 28 ) \
-    SYSCALL_ENTRY( 0x00eb, NtWow64WriteVirtualMemory64, 28 ) \
-    SYSCALL_ENTRY( 0x00ec, NtWriteFile, 36 ) \
-    SYSCALL_ENTRY( 0x00ed, NtWriteFileGather, 36 ) \
-    SYSCALL_ENTRY( 0x00ee, NtWriteVirtualMemory, 20 ) \
-    SYSCALL_ENTRY( 0x00ef, NtYieldExecution, 0 ) \
-    SYSCALL_ENTRY( 0x00f0, wine_nt_to_unix_file_name, 16 ) \
-    SYSCALL_ENTRY( 0x00f1, wine_unix_to_nt_file_name, 12 )
+    SYSCALL_ENTRY( 0x000f, NtAssociateWaitCompletionPacket, 32 ) \
+    SYSCALL_ENTRY( 0x0010, NtCallbackReturn, 12 ) \
+    SYSCALL_ENTRY( 0x0011, NtCancelIoFile, 8 ) \
+    SYSCALL_ENTRY( 0x0012, NtCancelIoFileEx, 12 ) \
+    SYSCALL_ENTRY( 0x0013, NtCancelSynchronousIoFile, 12 ) \
+    SYSCALL_ENTRY( 0x0014, NtCancelTimer, 8 ) \
+    SYSCALL_ENTRY( 0x0015, NtCancelWaitCompletionPacket, 8 ) \
+    SYSCALL_ENTRY( 0x0016, NtClearEvent, 4 ) \
+    SYSCALL_ENTRY( 0x0017, NtClose, 4 ) \
+    SYSCALL_ENTRY( 0x0018, NtCommitTransaction, 8 ) \
+    SYSCALL_ENTRY( 0x0019, NtCompareObjects, 8 ) \
+    SYSCALL_ENTRY( 0x001a, NtCompareTokens, 12 ) \
+    SYSCALL_ENTRY( 0x001b, NtCompleteConnectPort, 4 ) \
+    SYSCALL_ENTRY( 0x001c, NtConnectPort, 32 ) \
+    SYSCALL_ENTRY( 0x001d, NtContinue, 8 ) \
+    SYSCALL_ENTRY( 0x001e, NtCreateDebugObject, 16 ) \
+    SYSCALL_ENTRY( 0x001f, NtCreateDirectoryObject, 12 ) \
+    SYSCALL_ENTRY( 0x0020, NtCreateEvent, 20 ) \
+    SYSCALL_ENTRY( 0x0021, NtCreateFile, 44 ) \
+    SYSCALL_ENTRY( 0x0022, NtCreateIoCompletion, 16 ) \
+    SYSCALL_ENTRY( 0x0023, NtCreateJobObject, 12 ) \
+    SYSCALL_ENTRY( 0x0024, NtCreateKey, 28 ) \
+    SYSCALL_ENTRY( 0x0025, NtCreateKeyTransacted, 32 ) \
+    SYSCALL_ENTRY( 0x0026, NtCreateKeyedEvent, 16 ) \
+    SYSCALL_ENTRY( 0x0027, NtCreateLowBoxToken, 36 ) \
+    SYSCALL_ENTRY( 0x0028, NtCreateMailslotFile, 32 ) \
+    SYSCALL_ENTRY( 0x0029, NtCreateMutant, 16 ) \
+    SYSCALL_ENTRY( 0x002a, NtCreateNamedPipeFile, 56 ) \
+    SYSCALL_ENTRY( 0x002b, NtCreatePagingFile, 16 ) \
+    SYSCALL_ENTRY( 0x002c, NtCreatePort, 20 ) \
+    SYSCALL_ENTRY( 0x002d, NtCreateSection, 28 ) \
+    SYSCALL_ENTRY( 0x002e, NtCreateSemaphore, 20 ) \
+    SYSCALL_ENTRY( 0x002f, NtCreateSymbolicLinkObject, 16 ) \
+    SYSCALL_ENTRY( 0x0030, NtCreateThread, 32 ) \
+    SYSCALL_ENTRY( 0x0031, NtCreateThreadEx, 44 ) \
+    SYSCALL_ENTRY( 0x0032, NtCreateTimer, 16 ) \
+    SYSCALL_ENTRY( 0x0033, NtCreateToken, 52 ) \
+    SYSCALL_ENTRY( 0x0034, NtCreateTransaction, 40 ) \
+    SYSCALL_ENTRY( 0x0035, NtCreateUserProcess, 44 ) \
+    SYSCALL_ENTRY( 0x0036, NtCreateWaitCompletionPacket, 12 ) \
+    SYSCALL_ENTRY( 0x0037, NtDebugActiveProcess, 8 ) \
+    SYSCALL_ENTRY( 0x0038, NtDebugContinue, 12 ) \
+    SYSCALL_ENTRY( 0x0039, NtDelayExecution, 8 ) \
+    SYSCALL_ENTRY( 0x003a, NtDeleteAtom, 4 ) \
+    SYSCALL_ENTRY( 0x003b, NtDeleteFile, 4 ) \
+    SYSCALL_ENTRY( 0x003c, NtDeleteKey, 4 ) \
+    SYSCALL_ENTRY( 0x003d, NtDeleteValueKey, 8 ) \
+    SYSCALL_ENTRY( 0x003e, NtDeviceIoControlFile, 40 ) \
+    SYSCALL_ENTRY( 0x003f, NtDisplayString, 4 ) \
+    SYSCALL_ENTRY( 0x0040, NtDuplicateObject, 28 ) \
+    SYSCALL_ENTRY( 0x0041, NtDuplicateToken, 24 ) \
+    SYSCALL_ENTRY( 0x0042, NtEnumerateKey, 24 ) \
+    SYSCALL_ENTRY( 0x0043, NtEnumerateValueKey, 24 ) \
+    SYSCALL_ENTRY( 0x0044, NtFilterToken, 24 ) \
+    SYSCALL_ENTRY( 0x0045, NtFindAtom, 12 ) \
+    SYSCALL_ENTRY( 0x0046, NtFlushBuffersFile, 8 ) \
+    SYSCALL_ENTRY( 0x0047, NtFlushInstructionCache, 12 ) \
+    SYSCALL_ENTRY( 0x0048, NtFlushKey, 4 ) \
+    SYSCALL_ENTRY( 0x0049, NtFlushProcessWriteBuffers, 0 ) \
+    SYSCALL_ENTRY( 0x004a, NtFlushVirtualMemory, 16 ) \
+    SYSCALL_ENTRY( 0x004b, NtFreeVirtualMemory, 16 ) \
+    SYSCALL_ENTRY( 0x004c, NtFsControlFile, 40 ) \
+    SYSCALL_ENTRY( 0x004d, NtGetContextThread, 8 ) \
+    SYSCALL_ENTRY( 0x004e, NtGetCurrentProcessorNumber, 0 ) \
+    SYSCALL_ENTRY( 0x004f, NtGetNextThread, 24 ) \
+    SYSCALL_ENTRY( 0x0050, NtGetNlsSectionPtr, 20 ) \
+    SYSCALL_ENTRY( 0x0051, NtGetWriteWatch, 28 ) \
+    SYSCALL_ENTRY( 0x0052, NtImpersonateAnonymousToken, 4 ) \
+    SYSCALL_ENTRY( 0x0053, NtInitializeNlsFiles, 12 ) \
+    SYSCALL_ENTRY( 0x0054, NtInitiatePowerAction, 16 ) \
+    SYSCALL_ENTRY( 0x0055, NtIsProcessInJob, 8 ) \
+    SYSCALL_ENTRY( 0x0056, NtListenPort, 8 ) \
+    SYSCALL_ENTRY( 0x0057, NtLoadDriver, 4 ) \
+    SYSCALL_ENTRY( 0x0058, NtLoadKey, 8 ) \
+    SYSCALL_ENTRY( 0x0059, NtLoadKey2, 12 ) \
+    SYSCALL_ENTRY( 0x005a, NtLoadKeyEx, 32 ) \
+    SYSCALL_ENTRY( 0x005b, NtLockFile, 40 ) \
+    SYSCALL_ENTRY( 0x005c, NtLockVirtualMemory, 16 ) \
+    SYSCALL_ENTRY( 0x005d, NtMakePermanentObject, 4 ) \
+    SYSCALL_ENTRY( 0x005e, NtMakeTemporaryObject, 4 ) \
+    SYSCALL_ENTRY( 0x005f, NtMapViewOfSection, 40 ) \
+    SYSCALL_ENTRY( 0x0060, NtMapViewOfSectionEx, 36 ) \
+    SYSCALL_ENTRY( 0x0061, NtNotifyChangeDirectoryFile, 36 ) \
+    SYSCALL_ENTRY( 0x0062, NtNotifyChangeKey, 40 ) \
+    SYSCALL_ENTRY( 0x0063, NtNotifyChangeMultipleKeys, 48 ) \
+    SYSCALL_ENTRY( 0x0064, NtOpenDirectoryObject, 12 ) \
+    SYSCALL_ENTRY( 0x0065, NtOpenEvent, 12 ) \
+    SYSCALL_ENTRY( 0x0066, NtOpenFile, 24 ) \
+    SYSCALL_ENTRY( 0x0067, NtOpenIoCompletion, 12 ) \
+    SYSCALL_ENTRY( 0x0068, NtOpenJobObject, 12 ) \
+    SYSCALL_ENTRY( 0x0069, NtOpenKey, 12 ) \
+    SYSCALL_ENTRY( 0x006a, NtOpenKeyEx, 16 ) \
+    SYSCALL_ENTRY( 0x006b, NtOpenKeyTransacted, 16 ) \
+    SYSCALL_ENTRY( 0x006c, NtOpenKeyTransactedEx, 20 ) \
+    SYSCALL_ENTRY( 0x006d, NtOpenKeyedEvent, 12 ) \
+    SYSCALL_ENTRY( 0x006e, NtOpenMutant, 12 ) \
+    SYSCALL_ENTRY( 0x006f, NtOpenProcess, 16 ) \
+    SYSCALL_ENTRY( 0x0070, NtOpenProcessToken, 12 ) \
+    SYSCALL_ENTRY( 0x0071, NtOpenProcessTokenEx, 16 ) \
+    SYSCALL_ENTRY( 0x0072, NtOpenSection, 12 ) \
+    SYSCALL_ENTRY( 0x0073, NtOpenSemaphore, 12 ) \
+    SYSCALL_ENTRY( 0x0074, NtOpenSymbolicLinkObject, 12 ) \
+    SYSCALL_ENTRY( 0x0075, NtOpenThread, 16 ) \
+    SYSCALL_ENTRY( 0x0076, NtOpenThreadToken, 16 ) \
+    SYSCALL_ENTRY( 0x0077, NtOpenThreadTokenEx, 20 ) \
+    SYSCALL_ENTRY( 0x0078, NtOpenTimer, 12 ) \
+    SYSCALL_ENTRY( 0x0079, NtPowerInformation, 20 ) \
+    SYSCALL_ENTRY( 0x007a, NtPrivilegeCheck, 12 ) \
+    SYSCALL_ENTRY( 0x007b, NtProtectVirtualMemory, 20 ) \
+    SYSCALL_ENTRY( 0x007c, NtPulseEvent, 8 ) \
+    SYSCALL_ENTRY( 0x007d, NtQueryAttributesFile, 8 ) \
+    SYSCALL_ENTRY( 0x007e, NtQueryDefaultLocale, 8 ) \
+    SYSCALL_ENTRY( 0x007f, NtQueryDefaultUILanguage, 4 ) \
+    SYSCALL_ENTRY( 0x0080, NtQueryDirectoryFile, 44 ) \
+    SYSCALL_ENTRY( 0x0081, NtQueryDirectoryObject, 28 ) \
+    SYSCALL_ENTRY( 0x0082, NtQueryEaFile, 36 ) \
+    SYSCALL_ENTRY( 0x0083, NtQueryEvent, 20 ) \
+    SYSCALL_ENTRY( 0x0084, NtQueryFullAttributesFile, 8 ) \
+    SYSCALL_ENTRY( 0x0085, NtQueryInformationAtom, 20 ) \
+    SYSCALL_ENTRY( 0x0086, NtQueryInformationFile, 20 ) \
+    SYSCALL_ENTRY( 0x0087, NtQueryInformationJobObject, 20 ) \
+    SYSCALL_ENTRY( 0x0088, NtQueryInformationProcess, 20 ) \
+    SYSCALL_ENTRY( 0x0089, NtQueryInformationThread, 20 ) \
+    SYSCALL_ENTRY( 0x008a, NtQueryInformationToken, 20 ) \
+    SYSCALL_ENTRY( 0x008b, NtQueryInstallUILanguage, 4 ) \
+    SYSCALL_ENTRY( 0x008c, NtQueryIoCompletion, 20 ) \
+    SYSCALL_ENTRY( 0x008d, NtQueryKey, 20 ) \
+    SYSCALL_ENTRY( 0x008e, NtQueryLicenseValue, 20 ) \
+    SYSCALL_ENTRY( 0x008f, NtQueryMultipleValueKey, 24 ) \
+    SYSCALL_ENTRY( 0x0090, NtQueryMutant, 20 ) \
+    SYSCALL_ENTRY( 0x0091, NtQueryObject, 20 ) \
+    SYSCALL_ENTRY( 0x0092, NtQueryPerformanceCounter, 8 ) \
+    SYSCALL_ENTRY( 0x0093, NtQuerySection, 20 ) \
+    SYSCALL_ENTRY( 0x0094, NtQuerySecurityObject, 20 ) \
+    SYSCALL_ENTRY( 0x0095, NtQuerySemaphore, 20 ) \
+    SYSCALL_ENTRY( 0x0096, NtQuerySymbolicLinkObject, 12 ) \
+    SYSCALL_ENTRY( 0x0097, NtQuerySystemEnvironmentValue, 16 ) \
+    SYSCALL_ENTRY( 0x0098, NtQuerySystemEnvironmentValueEx, 20 ) \
+    SYSCALL_ENTRY( 0x0099, NtQuerySystemInformation, 16 ) \
+    SYSCALL_ENTRY( 0x009a, NtQuerySystemInformationEx, 24 ) \
+    SYSCALL_ENTRY( 0x009b, NtQuerySystemTime, 4 ) \
+    SYSCALL_ENTRY( 0x009c, NtQueryTimer, 20 ) \
+    SYSCALL_ENTRY( 0x009d, NtQueryTimerResolution, 12 ) \
+    SYSCALL_ENTRY( 0x009e, NtQueryValueKey, 24 ) \
+    SYSCALL_ENTRY( 0x009f, NtQueryVirtualMemory, 24 ) \
+    SYSCALL_ENTRY( 0x00a0, NtQueryVolumeInformationFile, 20 ) \
+    SYSCALL_ENTRY( 0x00a1, NtQueueApcThread, 20 ) \
+    SYSCALL_ENTRY( 0x00a2, NtQueueApcThreadEx, 24 ) \
+    SYSCALL_ENTRY( 0x00a3, NtRaiseException, 12 ) \
+    SYSCALL_ENTRY( 0x00a4, NtRaiseHardError, 24 ) \
+    SYSCALL_ENTRY( 0x00a5, NtReadFile, 36 ) \
+    SYSCALL_ENTRY( 0x00a6, NtReadFileScatter, 36 ) \
+    SYSCALL_ENTRY( 0x00a7, NtReadVirtualMemory, 20 ) \
+    SYSCALL_ENTRY( 0x00a8, NtRegisterThreadTerminatePort, 4 ) \
+    SYSCALL_ENTRY( 0x00a9, NtReleaseKeyedEvent, 16 ) \
+    SYSCALL_ENTRY( 0x00aa, NtReleaseMutant, 8 ) \
+    SYSCALL_ENTRY( 0x00ab, NtReleaseSemaphore, 12 ) \
+    SYSCALL_ENTRY( 0x00ac, NtRemoveIoCompletion, 20 ) \
+    SYSCALL_ENTRY( 0x00ad, NtRemoveIoCompletionEx, 24 ) \
+    SYSCALL_ENTRY( 0x00ae, NtRemoveProcessDebug, 8 ) \
+    SYSCALL_ENTRY( 0x00af, NtRenameKey, 8 ) \
+    SYSCALL_ENTRY( 0x00b0, NtReplaceKey, 12 ) \
+    SYSCALL_ENTRY( 0x00b1, NtReplyWaitReceivePort, 16 ) \
+    SYSCALL_ENTRY( 0x00b2, NtRequestWaitReplyPort, 12 ) \
+    SYSCALL_ENTRY( 0x00b3, NtResetEvent, 8 ) \
+    SYSCALL_ENTRY( 0x00b4, NtResetWriteWatch, 12 ) \
+    SYSCALL_ENTRY( 0x00b5, NtRestoreKey, 12 ) \
+    SYSCALL_ENTRY( 0x00b6, NtResumeProcess, 4 ) \
+    SYSCALL_ENTRY( 0x00b7, NtResumeThread, 8 ) \
+    SYSCALL_ENTRY( 0x00b8, NtRollbackTransaction, 8 ) \
+    SYSCALL_ENTRY( 0x00b9, NtSaveKey, 8 ) \
+    SYSCALL_ENTRY( 0x00ba, NtSecureConnectPort, 36 ) \
+    SYSCALL_ENTRY( 0x00bb, NtSetContextThread, 8 ) \
+    SYSCALL_ENTRY( 0x00bc, NtSetDebugFilterState, 12 ) \
+    SYSCALL_ENTRY( 0x00bd, NtSetDefaultLocale, 8 ) \
+    SYSCALL_ENTRY( 0x00be, NtSetDefaultUILanguage, 4 ) \
+    SYSCALL_ENTRY( 0x00bf, NtSetEaFile, 16 ) \
+    SYSCALL_ENTRY( 0x00c0, NtSetEvent, 8 ) \
+    SYSCALL_ENTRY( 0x00c1, NtSetInformationDebugObject, 20 ) \
+    SYSCALL_ENTRY( 0x00c2, NtSetInformationFile, 20 ) \
+    SYSCALL_ENTRY( 0x00c3, NtSetInformationJobObject, 16 ) \
+    SYSCALL_ENTRY( 0x00c4, NtSetInformationKey, 16 ) \
+    SYSCALL_ENTRY( 0x00c5, NtSetInformationObject, 16 ) \
+    SYSCALL_ENTRY( 0x00c6, NtSetInformationProcess, 16 ) \
+    SYSCALL_ENTRY( 0x00c7, NtSetInformationThread, 16 ) \
+    SYSCALL_ENTRY( 0x00c8, NtSetInformationToken, 16 ) \
+    SYSCALL_ENTRY( 0x00c9, NtSetInformationVirtualMemory, 24 ) \
+    SYSCALL_ENTRY( 0x00ca, NtSetIntervalProfile, 8 ) \
+    SYSCALL_ENTRY( 0x00cb, NtSetIoCompletion, 20 ) \
+    SYSCALL_ENTRY( 0x00cc, NtSetLdtEntries, 24 ) \
+    SYSCALL_ENTRY( 0x00cd, NtSetSecurityObject, 12 ) \
+    SYSCALL_ENTRY( 0x00ce, NtSetSystemInformation, 12 ) \
+    SYSCALL_ENTRY( 0x00cf, NtSetSystemTime, 8 ) \
+    SYSCALL_ENTRY( 0x00d0, NtSetThreadExecutionState, 8 ) \
+    SYSCALL_ENTRY( 0x00d1, NtSetTimer, 28 ) \
+    SYSCALL_ENTRY( 0x00d2, NtSetTimerResolution, 12 ) \
+    SYSCALL_ENTRY( 0x00d3, NtSetValueKey, 24 ) \
+    SYSCALL_ENTRY( 0x00d4, NtSetVolumeInformationFile, 20 ) \
+    SYSCALL_ENTRY( 0x00d5, NtShutdownSystem, 4 ) \
+    SYSCALL_ENTRY( 0x00d6, NtSignalAndWaitForSingleObject, 16 ) \
+    SYSCALL_ENTRY( 0x00d7, NtSuspendProcess, 4 ) \
+    SYSCALL_ENTRY( 0x00d8, NtSuspendThread, 8 ) \
+    SYSCALL_ENTRY( 0x00d9, NtSystemDebugControl, 24 ) \
+    SYSCALL_ENTRY( 0x00da, NtTerminateJobObject, 8 ) \
+    SYSCALL_ENTRY( 0x00db, NtTerminateProcess, 8 ) \
+    SYSCALL_ENTRY( 0x00dc, NtTerminateThread, 8 ) \
+    SYSCALL_ENTRY( 0x00dd, NtTestAlert, 0 ) \
+    SYSCALL_ENTRY( 0x00de, NtTraceControl, 24 ) \
+    SYSCALL_ENTRY( 0x00df, NtUnloadDriver, 4 ) \
+    SYSCALL_ENTRY( 0x00e0, NtUnloadKey, 4 ) \
+    SYSCALL_ENTRY( 0x00e1, NtUnlockFile, 20 ) \
+    SYSCALL_ENTRY( 0x00e2, NtUnlockVirtualMemory, 16 ) \
+    SYSCALL_ENTRY( 0x00e3, NtUnmapViewOfSection, 8 ) \
+    SYSCALL_ENTRY( 0x00e4, NtUnmapViewOfSectionEx, 12 ) \
+    SYSCALL_ENTRY( 0x00e5, NtWaitForAlertByThreadId, 8 ) \
+    SYSCALL_ENTRY( 0x00e6, NtWaitForDebugEvent, 16 ) \
+    SYSCALL_ENTRY( 0x00e7, NtWaitForKeyedEvent, 16 ) \
+    SYSCALL_ENTRY( 0x00e8, NtWaitForMultipleObjects, 20 ) \
+    SYSCALL_ENTRY( 0x00e9, NtWaitForSingleObject, 12 ) \
+    SYSCALL_ENTRY( 0x00ea, NtWow64AllocateVirtualMemory64, 28 ) \
+    SYSCALL_ENTRY( 0x00eb, NtWow64GetNativeSystemInformation, 16 ) \
+    SYSCALL_ENTRY( 0x00ec, NtWow64IsProcessorFeaturePresent, 4 ) \
+    SYSCALL_ENTRY( 0x00ed, NtWow64ReadVirtualMemory64, 28 ) \
+    SYSCALL_ENTRY( 0x00ee, NtWow64WriteVirtualMemory64, 28 ) \
+    SYSCALL_ENTRY( 0x00ef, NtWriteFile, 36 ) \
+    SYSCALL_ENTRY( 0x00f0, NtWriteFileGather, 36 ) \
+    SYSCALL_ENTRY( 0x00f1, NtWriteVirtualMemory, 20 ) \
+    SYSCALL_ENTRY( 0x00f2, NtYieldExecution, 0 ) \
+    SYSCALL_ENTRY( 0x00f3, wine_nt_to_unix_file_name, 16 ) \
+    SYSCALL_ENTRY( 0x00f4, wine_unix_to_nt_file_name, 12 )
 
 #define ALL_SYSCALLS64 \
     SYSCALL_ENTRY( 0x0000, NtAcceptConnectPort, 48 ) \
@@ -260,225 +263,228 @@
     SYSCALL_ENTRY( 0x000c, NtAllocateVirtualMemoryEx, 56 ) \
     SYSCALL_ENTRY( 0x000d, NtAreMappedFilesTheSame, 16 ) \
     SYSCALL_ENTRY( 0x000e, NtAssignProcessToJobObject, 16 ) \
-    SYSCALL_ENTRY( 0x000f, NtCallbackReturn, 24 ) \
-    SYSCALL_ENTRY( 0x0010, NtCancelIoFile, 16 ) \
-    SYSCALL_ENTRY( 0x0011, NtCancelIoFileEx, 24 ) \
-    SYSCALL_ENTRY( 0x0012, NtCancelSynchronousIoFile, 24 ) \
-    SYSCALL_ENTRY( 0x0013, NtCancelTimer, 16 ) \
-    SYSCALL_ENTRY( 0x0014, NtClearEvent, 8 ) \
-    SYSCALL_ENTRY( 0x0015, NtClose, 8 ) \
-    SYSCALL_ENTRY( 0x0016, NtCommitTransaction, 16 ) \
-    SYSCALL_ENTRY( 0x0017, NtCompareObjects, 16 ) \
-    SYSCALL_ENTRY( 0x0018, NtCompareTokens, 24 ) \
-    SYSCALL_ENTRY( 0x0019, NtCompleteConnectPort, 8 ) \
-    SYSCALL_ENTRY( 0x001a, NtConnectPort, 64 ) \
-    SYSCALL_ENTRY( 0x001b, NtContinue, 16 ) \
-    SYSCALL_ENTRY( 0x001c, NtCreateDebugObject, 32 ) \
-    SYSCALL_ENTRY( 0x001d, NtCreateDirectoryObject, 24 ) \
-    SYSCALL_ENTRY( 0x001e, NtCreateEvent, 40 ) \
-    SYSCALL_ENTRY( 0x001f, NtCreateFile, 88 ) \
-    SYSCALL_ENTRY( 0x0020, NtCreateIoCompletion, 32 ) \
-    SYSCALL_ENTRY( 0x0021, NtCreateJobObject, 24 ) \
-    SYSCALL_ENTRY( 0x0022, NtCreateKey, 56 ) \
-    SYSCALL_ENTRY( 0x0023, NtCreateKeyTransacted, 64 ) \
-    SYSCALL_ENTRY( 0x0024, NtCreateKeyedEvent, 32 ) \
-    SYSCALL_ENTRY( 0x0025, NtCreateLowBoxToken, 72 ) \
-    SYSCALL_ENTRY( 0x0026, NtCreateMailslotFile, 64 ) \
-    SYSCALL_ENTRY( 0x0027, NtCreateMutant, 32 ) \
-    SYSCALL_ENTRY( 0x0028, NtCreateNamedPipeFile, 112 ) \
-    SYSCALL_ENTRY( 0x0029, NtCreatePagingFile, 32 ) \
-    SYSCALL_ENTRY( 0x002a, NtCreatePort, 40 ) \
-    SYSCALL_ENTRY( 0x002b, NtCreateSection, 56 ) \
-    SYSCALL_ENTRY( 0x002c, NtCreateSemaphore, 40 ) \
-    SYSCALL_ENTRY( 0x002d, NtCreateSymbolicLinkObject, 32 ) \
-    SYSCALL_ENTRY( 0x002e, NtCreateThread, 64 ) \
-    SYSCALL_ENTRY( 0x002f, NtCreateThreadEx, 88 ) \
-    SYSCALL_ENTRY( 0x0030, NtCreateTimer, 32 ) \
-    SYSCALL_ENTRY( 0x0031, NtCreateToken, 104 ) \
-    SYSCALL_ENTRY( 0x0032, NtCreateTransaction, 80 ) \
-    SYSCALL_ENTRY( 0x0033, NtCreateUserProcess, 88 ) \
-    SYSCALL_ENTRY( 0x0034, NtDebugActiveProcess, 16 ) \
-    SYSCALL_ENTRY( 0x0035, NtDebugContinue, 24 ) \
-    SYSCALL_ENTRY( 0x0036, NtDelayExecution, 16 ) \
-    SYSCALL_ENTRY( 0x0037, NtDeleteAtom, 8 ) \
-    SYSCALL_ENTRY( 0x0038, NtDeleteFile, 8 ) \
-    SYSCALL_ENTRY( 0x0039, NtDeleteKey, 8 ) \
-    SYSCALL_ENTRY( 0x003a, NtDeleteValueKey, 16 ) \
-    SYSCALL_ENTRY( 0x003b, NtDeviceIoControlFile, 80 ) \
-    SYSCALL_ENTRY( 0x003c, NtDisplayString, 8 ) \
-    SYSCALL_ENTRY( 0x003d, NtDuplicateObject, 56 ) \
-    SYSCALL_ENTRY( 0x003e, NtDuplicateToken, 48 ) \
-    SYSCALL_ENTRY( 0x003f, NtEnumerateKey, 48 ) \
-    SYSCALL_ENTRY( 0x0040, NtEnumerateValueKey, 48 ) \
-    SYSCALL_ENTRY( 0x0041, NtFilterToken, 48 ) \
-    SYSCALL_ENTRY( 0x0042, NtFindAtom, 24 ) \
-    SYSCALL_ENTRY( 0x0043, NtFlushBuffersFile, 16 ) \
-    SYSCALL_ENTRY( 0x0044, NtFlushInstructionCache, 24 ) \
-    SYSCALL_ENTRY( 0x0045, NtFlushKey, 8 ) \
-    SYSCALL_ENTRY( 0x0046, NtFlushProcessWriteBuffers, 0 ) \
-    SYSCALL_ENTRY( 0x0047, NtFlushVirtualMemory, 32 ) \
-    SYSCALL_ENTRY( 0x0048, NtFreeVirtualMemory, 32 ) \
-    SYSCALL_ENTRY( 0x0049, NtFsControlFile, 80 ) \
-    SYSCALL_ENTRY( 0x004a, NtGetContextThread, 16 ) \
-    SYSCALL_ENTRY( 0x004b, NtGetCurrentProcessorNumber, 0 ) \
-    SYSCALL_ENTRY( 0x004c, NtGetNextThread, 48 ) \
-    SYSCALL_ENTRY( 0x004d, NtGetNlsSectionPtr, 40 ) \
-    SYSCALL_ENTRY( 0x004e, NtGetWriteWatch, 56 ) \
-    SYSCALL_ENTRY( 0x004f, NtImpersonateAnonymousToken, 8 ) \
-    SYSCALL_ENTRY( 0x0050, NtInitializeNlsFiles, 24 ) \
-    SYSCALL_ENTRY( 0x0051, NtInitiatePowerAction, 32 ) \
-    SYSCALL_ENTRY( 0x0052, NtIsProcessInJob, 16 ) \
-    SYSCALL_ENTRY( 0x0053, NtListenPort, 16 ) \
-    SYSCALL_ENTRY( 0x0054, NtLoadDriver, 8 ) \
-    SYSCALL_ENTRY( 0x0055, NtLoadKey, 16 ) \
-    SYSCALL_ENTRY( 0x0056, NtLoadKey2, 24 ) \
-    SYSCALL_ENTRY( 0x0057, NtLoadKeyEx, 64 ) \
-    SYSCALL_ENTRY( 0x0058, NtLockFile, 80 ) \
-    SYSCALL_ENTRY( 0x0059, NtLockVirtualMemory, 32 ) \
-    SYSCALL_ENTRY( 0x005a, NtMakePermanentObject, 8 ) \
-    SYSCALL_ENTRY( 0x005b, NtMakeTemporaryObject, 8 ) \
-    SYSCALL_ENTRY( 0x005c, NtMapViewOfSection, 80 ) \
-    SYSCALL_ENTRY( 0x005d, NtMapViewOfSectionEx, 72 ) \
-    SYSCALL_ENTRY( 0x005e, NtNotifyChangeDirectoryFile, 72 ) \
-    SYSCALL_ENTRY( 0x005f, NtNotifyChangeKey, 80 ) \
-    SYSCALL_ENTRY( 0x0060, NtNotifyChangeMultipleKeys, 96 ) \
-    SYSCALL_ENTRY( 0x0061, NtOpenDirectoryObject, 24 ) \
-    SYSCALL_ENTRY( 0x0062, NtOpenEvent, 24 ) \
-    SYSCALL_ENTRY( 0x0063, NtOpenFile, 48 ) \
-    SYSCALL_ENTRY( 0x0064, NtOpenIoCompletion, 24 ) \
-    SYSCALL_ENTRY( 0x0065, NtOpenJobObject, 24 ) \
-    SYSCALL_ENTRY( 0x0066, NtOpenKey, 24 ) \
-    SYSCALL_ENTRY( 0x0067, NtOpenKeyEx, 32 ) \
-    SYSCALL_ENTRY( 0x0068, NtOpenKeyTransacted, 32 ) \
-    SYSCALL_ENTRY( 0x0069, NtOpenKeyTransactedEx, 40 ) \
-    SYSCALL_ENTRY( 0x006a, NtOpenKeyedEvent, 24 ) \
-    SYSCALL_ENTRY( 0x006b, NtOpenMutant, 24 ) \
-    SYSCALL_ENTRY( 0x006c, NtOpenProcess, 32 ) \
-    SYSCALL_ENTRY( 0x006d, NtOpenProcessToken, 24 ) \
-    SYSCALL_ENTRY( 0x006e, NtOpenProcessTokenEx, 32 ) \
-    SYSCALL_ENTRY( 0x006f, NtOpenSection, 24 ) \
-    SYSCALL_ENTRY( 0x0070, NtOpenSemaphore, 24 ) \
-    SYSCALL_ENTRY( 0x0071, NtOpenSymbolicLinkObject, 24 ) \
-    SYSCALL_ENTRY( 0x0072, NtOpenThread, 32 ) \
-    SYSCALL_ENTRY( 0x0073, NtOpenThreadToken, 32 ) \
-    SYSCALL_ENTRY( 0x0074, NtOpenThreadTokenEx, 40 ) \
-    SYSCALL_ENTRY( 0x0075, NtOpenTimer, 24 ) \
-    SYSCALL_ENTRY( 0x0076, NtPowerInformation, 40 ) \
-    SYSCALL_ENTRY( 0x0077, NtPrivilegeCheck, 24 ) \
-    SYSCALL_ENTRY( 0x0078, NtProtectVirtualMemory, 40 ) \
-    SYSCALL_ENTRY( 0x0079, NtPulseEvent, 16 ) \
-    SYSCALL_ENTRY( 0x007a, NtQueryAttributesFile, 16 ) \
-    SYSCALL_ENTRY( 0x007b, NtQueryDefaultLocale, 16 ) \
-    SYSCALL_ENTRY( 0x007c, NtQueryDefaultUILanguage, 8 ) \
-    SYSCALL_ENTRY( 0x007d, NtQueryDirectoryFile, 88 ) \
-    SYSCALL_ENTRY( 0x007e, NtQueryDirectoryObject, 56 ) \
-    SYSCALL_ENTRY( 0x007f, NtQueryEaFile, 72 ) \
-    SYSCALL_ENTRY( 0x0080, NtQueryEvent, 40 ) \
-    SYSCALL_ENTRY( 0x0081, NtQueryFullAttributesFile, 16 ) \
-    SYSCALL_ENTRY( 0x0082, NtQueryInformationAtom, 40 ) \
-    SYSCALL_ENTRY( 0x0083, NtQueryInformationFile, 40 ) \
-    SYSCALL_ENTRY( 0x0084, NtQueryInformationJobObject, 40 ) \
-    SYSCALL_ENTRY( 0x0085, NtQueryInformationProcess, 40 ) \
-    SYSCALL_ENTRY( 0x0086, NtQueryInformationThread, 40 ) \
-    SYSCALL_ENTRY( 0x0087, NtQueryInformationToken, 40 ) \
-    SYSCALL_ENTRY( 0x0088, NtQueryInstallUILanguage, 8 ) \
-    SYSCALL_ENTRY( 0x0089, NtQueryIoCompletion, 40 ) \
-    SYSCALL_ENTRY( 0x008a, NtQueryKey, 40 ) \
-    SYSCALL_ENTRY( 0x008b, NtQueryLicenseValue, 40 ) \
-    SYSCALL_ENTRY( 0x008c, NtQueryMultipleValueKey, 48 ) \
-    SYSCALL_ENTRY( 0x008d, NtQueryMutant, 40 ) \
-    SYSCALL_ENTRY( 0x008e, NtQueryObject, 40 ) \
-    SYSCALL_ENTRY( 0x008f, NtQueryPerformanceCounter, 16 ) \
-    SYSCALL_ENTRY( 0x0090, NtQuerySection, 40 ) \
-    SYSCALL_ENTRY( 0x0091, NtQuerySecurityObject, 40 ) \
-    SYSCALL_ENTRY( 0x0092, NtQuerySemaphore, 40 ) \
-    SYSCALL_ENTRY( 0x0093, NtQuerySymbolicLinkObject, 24 ) \
-    SYSCALL_ENTRY( 0x0094, NtQuerySystemEnvironmentValue, 32 ) \
-    SYSCALL_ENTRY( 0x0095, NtQuerySystemEnvironmentValueEx, 40 ) \
-    SYSCALL_ENTRY( 0x0096, NtQuerySystemInformation, 32 ) \
-    SYSCALL_ENTRY( 0x0097, NtQuerySystemInformationEx, 48 ) \
-    SYSCALL_ENTRY( 0x0098, NtQuerySystemTime, 8 ) \
-    SYSCALL_ENTRY( 0x0099, NtQueryTimer, 40 ) \
-    SYSCALL_ENTRY( 0x009a, NtQueryTimerResolution, 24 ) \
-    SYSCALL_ENTRY( 0x009b, NtQueryValueKey, 48 ) \
-    SYSCALL_ENTRY( 0x009c, NtQueryVirtualMemory, 48 ) \
-    SYSCALL_ENTRY( 0x009d, NtQueryVolumeInformationFile, 40 ) \
-    SYSCALL_ENTRY( 0x009e, NtQueueApcThread, 40 ) \
-    SYSCALL_ENTRY( 0x009f, NtQueueApcThreadEx, 48 ) \
-    SYSCALL_ENTRY( 0x00a0, NtRaiseException, 24 ) \
-    SYSCALL_ENTRY( 0x00a1, NtRaiseHardError, 48 ) \
-    SYSCALL_ENTRY( 0x00a2, NtReadFile, 72 ) \
-    SYSCALL_ENTRY( 0x00a3, NtReadFileScatter, 72 ) \
-    SYSCALL_ENTRY( 0x00a4, NtReadVirtualMemory, 40 ) \
-    SYSCALL_ENTRY( 0x00a5, NtRegisterThreadTerminatePort, 8 ) \
-    SYSCALL_ENTRY( 0x00a6, NtReleaseKeyedEvent, 32 ) \
-    SYSCALL_ENTRY( 0x00a7, NtReleaseMutant, 16 ) \
-    SYSCALL_ENTRY( 0x00a8, NtReleaseSemaphore, 24 ) \
-    SYSCALL_ENTRY( 0x00a9, NtRemoveIoCompletion, 40 ) \
-    SYSCALL_ENTRY( 0x00aa, NtRemoveIoCompletionEx, 48 ) \
-    SYSCALL_ENTRY( 0x00ab, NtRemoveProcessDebug, 16 ) \
-    SYSCALL_ENTRY( 0x00ac, NtRenameKey, 16 ) \
-    SYSCALL_ENTRY( 0x00ad, NtReplaceKey, 24 ) \
-    SYSCALL_ENTRY( 0x00ae, NtReplyWaitReceivePort, 32 ) \
-    SYSCALL_ENTRY( 0x00af, NtRequestWaitReplyPort, 24 ) \
-    SYSCALL_ENTRY( 0x00b0, NtResetEvent, 16 ) \
-    SYSCALL_ENTRY( 0x00b1, NtResetWriteWatch, 24 ) \
-    SYSCALL_ENTRY( 0x00b2, NtRestoreKey, 24 ) \
-    SYSCALL_ENTRY( 0x00b3, NtResumeProcess, 8 ) \
-    SYSCALL_ENTRY( 0x00b4, NtResumeThread, 16 ) \
-    SYSCALL_ENTRY( 0x00b5, NtRollbackTransaction, 16 ) \
-    SYSCALL_ENTRY( 0x00b6, NtSaveKey, 16 ) \
-    SYSCALL_ENTRY( 0x00b7, NtSecureConnectPort, 72 ) \
-    SYSCALL_ENTRY( 0x00b8, NtSetContextThread, 16 ) \
-    SYSCALL_ENTRY( 0x00b9, NtSetDebugFilterState, 24 ) \
-    SYSCALL_ENTRY( 0x00ba, NtSetDefaultLocale, 16 ) \
-    SYSCALL_ENTRY( 0x00bb, NtSetDefaultUILanguage, 8 ) \
-    SYSCALL_ENTRY( 0x00bc, NtSetEaFile, 32 ) \
-    SYSCALL_ENTRY( 0x00bd, NtSetEvent, 16 ) \
-    SYSCALL_ENTRY( 0x00be, NtSetInformationDebugObject, 40 ) \
-    SYSCALL_ENTRY( 0x00bf, NtSetInformationFile, 40 ) \
-    SYSCALL_ENTRY( 0x00c0, NtSetInformationJobObject, 32 ) \
-    SYSCALL_ENTRY( 0x00c1, NtSetInformationKey, 32 ) \
-    SYSCALL_ENTRY( 0x00c2, NtSetInformationObject, 32 ) \
-    SYSCALL_ENTRY( 0x00c3, NtSetInformationProcess, 32 ) \
-    SYSCALL_ENTRY( 0x00c4, NtSetInformationThread, 32 ) \
-    SYSCALL_ENTRY( 0x00c5, NtSetInformationToken, 32 ) \
-    SYSCALL_ENTRY( 0x00c6, NtSetInformationVirtualMemory, 48 ) \
-    SYSCALL_ENTRY( 0x00c7, NtSetIntervalProfile, 16 ) \
-    SYSCALL_ENTRY( 0x00c8, NtSetIoCompletion, 40 ) \
-    SYSCALL_ENTRY( 0x00c9, NtSetLdtEntries, 32 ) \
-    SYSCALL_ENTRY( 0x00ca, NtSetSecurityObject, 24 ) \
-    SYSCALL_ENTRY( 0x00cb, NtSetSystemInformation, 24 ) \
-    SYSCALL_ENTRY( 0x00cc, NtSetSystemTime, 16 ) \
-    SYSCALL_ENTRY( 0x00cd, NtSetThreadExecutionState, 16 ) \
-    SYSCALL_ENTRY( 0x00ce, NtSetTimer, 56 ) \
-    SYSCALL_ENTRY( 0x00cf, NtSetTimerResolution, 24 ) \
-    SYSCALL_ENTRY( 0x00d0, NtSetValueKey, 48 ) \
-    SYSCALL_ENTRY( 0x00d1, NtSetVolumeInformationFile, 40 ) \
-    SYSCALL_ENTRY( 0x00d2, NtShutdownSystem, 8 ) \
-    SYSCALL_ENTRY( 0x00d3, NtSignalAndWaitForSingleObject, 32 ) \
-    SYSCALL_ENTRY( 0x00d4, NtSuspendProcess, 8 ) \
-    SYSCALL_ENTRY( 0x00d5, NtSuspendThread, 16 ) \
-    SYSCALL_ENTRY( 0x00d6, NtSystemDebugControl, 48 ) \
-    SYSCALL_ENTRY( 0x00d7, NtTerminateJobObject, 16 ) \
-    SYSCALL_ENTRY( 0x00d8, NtTerminateProcess, 16 ) \
-    SYSCALL_ENTRY( 0x00d9, NtTerminateThread, 16 ) \
-    SYSCALL_ENTRY( 0x00da, NtTestAlert, 0 ) \
-    SYSCALL_ENTRY( 0x00db, NtTraceControl, 48 ) \
-    SYSCALL_ENTRY( 0x00dc, NtUnloadDriver, 8 ) \
-    SYSCALL_ENTRY( 0x00dd, NtUnloadKey, 8 ) \
-    SYSCALL_ENTRY( 0x00de, NtUnlockFile, 40 ) \
-    SYSCALL_ENTRY( 0x00df, NtUnlockVirtualMemory, 32 ) \
-    SYSCALL_ENTRY( 0x00e0, NtUnmapViewOfSection, 16 ) \
-    SYSCALL_ENTRY( 0x00e1, NtUnmapViewOfSectionEx, 24 ) \
-    SYSCALL_ENTRY( 0x00e2, NtWaitForAlertByThreadId, 16 ) \
-    SYSCALL_ENTRY( 0x00e3, NtWaitForDebugEvent, 32 ) \
-    SYSCALL_ENTRY( 0x00e4, NtWaitForKeyedEvent, 32 ) \
-    SYSCALL_ENTRY( 0x00e5, NtWaitForMultipleObjects, 40 ) \
-    SYSCALL_ENTRY( 0x00e6, NtWaitForSingleObject, 24 ) \
-    SYSCALL_ENTRY( 0x00e7, NtWriteFile, 72 ) \
-    SYSCALL_ENTRY( 0x00e8, NtWriteFileGather, 72 ) \
-    SYSCALL_ENTRY( 0x00e9, NtWriteVirtualMemory, 40 ) \
-    SYSCALL_ENTRY( 0x00ea, NtYieldExecution, 0 ) \
-    SYSCALL_ENTRY( 0x00eb, wine_nt_to_unix_file_name, 32 ) \
-    SYSCALL_ENTRY( 0x00ec, wine_unix_to_nt_file_name, 24 )
+    SYSCALL_ENTRY( 0x000f, NtAssociateWaitCompletionPacket, 64 ) \
+    SYSCALL_ENTRY( 0x0010, NtCallbackReturn, 24 ) \
+    SYSCALL_ENTRY( 0x0011, NtCancelIoFile, 16 ) \
+    SYSCALL_ENTRY( 0x0012, NtCancelIoFileEx, 24 ) \
+    SYSCALL_ENTRY( 0x0013, NtCancelSynchronousIoFile, 24 ) \
+    SYSCALL_ENTRY( 0x0014, NtCancelTimer, 16 ) \
+    SYSCALL_ENTRY( 0x0015, NtCancelWaitCompletionPacket, 16 ) \
+    SYSCALL_ENTRY( 0x0016, NtClearEvent, 8 ) \
+    SYSCALL_ENTRY( 0x0017, NtClose, 8 ) \
+    SYSCALL_ENTRY( 0x0018, NtCommitTransaction, 16 ) \
+    SYSCALL_ENTRY( 0x0019, NtCompareObjects, 16 ) \
+    SYSCALL_ENTRY( 0x001a, NtCompareTokens, 24 ) \
+    SYSCALL_ENTRY( 0x001b, NtCompleteConnectPort, 8 ) \
+    SYSCALL_ENTRY( 0x001c, NtConnectPort, 64 ) \
+    SYSCALL_ENTRY( 0x001d, NtContinue, 16 ) \
+    SYSCALL_ENTRY( 0x001e, NtCreateDebugObject, 32 ) \
+    SYSCALL_ENTRY( 0x001f, NtCreateDirectoryObject, 24 ) \
+    SYSCALL_ENTRY( 0x0020, NtCreateEvent, 40 ) \
+    SYSCALL_ENTRY( 0x0021, NtCreateFile, 88 ) \
+    SYSCALL_ENTRY( 0x0022, NtCreateIoCompletion, 32 ) \
+    SYSCALL_ENTRY( 0x0023, NtCreateJobObject, 24 ) \
+    SYSCALL_ENTRY( 0x0024, NtCreateKey, 56 ) \
+    SYSCALL_ENTRY( 0x0025, NtCreateKeyTransacted, 64 ) \
+    SYSCALL_ENTRY( 0x0026, NtCreateKeyedEvent, 32 ) \
+    SYSCALL_ENTRY( 0x0027, NtCreateLowBoxToken, 72 ) \
+    SYSCALL_ENTRY( 0x0028, NtCreateMailslotFile, 64 ) \
+    SYSCALL_ENTRY( 0x0029, NtCreateMutant, 32 ) \
+    SYSCALL_ENTRY( 0x002a, NtCreateNamedPipeFile, 112 ) \
+    SYSCALL_ENTRY( 0x002b, NtCreatePagingFile, 32 ) \
+    SYSCALL_ENTRY( 0x002c, NtCreatePort, 40 ) \
+    SYSCALL_ENTRY( 0x002d, NtCreateSection, 56 ) \
+    SYSCALL_ENTRY( 0x002e, NtCreateSemaphore, 40 ) \
+    SYSCALL_ENTRY( 0x002f, NtCreateSymbolicLinkObject, 32 ) \
+    SYSCALL_ENTRY( 0x0030, NtCreateThread, 64 ) \
+    SYSCALL_ENTRY( 0x0031, NtCreateThreadEx, 88 ) \
+    SYSCALL_ENTRY( 0x0032, NtCreateTimer, 32 ) \
+    SYSCALL_ENTRY( 0x0033, NtCreateToken, 104 ) \
+    SYSCALL_ENTRY( 0x0034, NtCreateTransaction, 80 ) \
+    SYSCALL_ENTRY( 0x0035, NtCreateUserProcess, 88 ) \
+    SYSCALL_ENTRY( 0x0036, NtCreateWaitCompletionPacket, 24 ) \
+    SYSCALL_ENTRY( 0x0037, NtDebugActiveProcess, 16 ) \
+    SYSCALL_ENTRY( 0x0038, NtDebugContinue, 24 ) \
+    SYSCALL_ENTRY( 0x0039, NtDelayExecution, 16 ) \
+    SYSCALL_ENTRY( 0x003a, NtDeleteAtom, 8 ) \
+    SYSCALL_ENTRY( 0x003b, NtDeleteFile, 8 ) \
+    SYSCALL_ENTRY( 0x003c, NtDeleteKey, 8 ) \
+    SYSCALL_ENTRY( 0x003d, NtDeleteValueKey, 16 ) \
+    SYSCALL_ENTRY( 0x003e, NtDeviceIoControlFile, 80 ) \
+    SYSCALL_ENTRY( 0x003f, NtDisplayString, 8 ) \
+    SYSCALL_ENTRY( 0x0040, NtDuplicateObject, 56 ) \
+    SYSCALL_ENTRY( 0x0041, NtDuplicateToken, 48 ) \
+    SYSCALL_ENTRY( 0x0042, NtEnumerateKey, 48 ) \
+    SYSCALL_ENTRY( 0x0043, NtEnumerateValueKey, 48 ) \
+    SYSCALL_ENTRY( 0x0044, NtFilterToken, 48 ) \
+    SYSCALL_ENTRY( 0x0045, NtFindAtom, 24 ) \
+    SYSCALL_ENTRY( 0x0046, NtFlushBuffersFile, 16 ) \
+    SYSCALL_ENTRY( 0x0047, NtFlushInstructionCache, 24 ) \
+    SYSCALL_ENTRY( 0x0048, NtFlushKey, 8 ) \
+    SYSCALL_ENTRY( 0x0049, NtFlushProcessWriteBuffers, 0 ) \
+    SYSCALL_ENTRY( 0x004a, NtFlushVirtualMemory, 32 ) \
+    SYSCALL_ENTRY( 0x004b, NtFreeVirtualMemory, 32 ) \
+    SYSCALL_ENTRY( 0x004c, NtFsControlFile, 80 ) \
+    SYSCALL_ENTRY( 0x004d, NtGetContextThread, 16 ) \
+    SYSCALL_ENTRY( 0x004e, NtGetCurrentProcessorNumber, 0 ) \
+    SYSCALL_ENTRY( 0x004f, NtGetNextThread, 48 ) \
+    SYSCALL_ENTRY( 0x0050, NtGetNlsSectionPtr, 40 ) \
+    SYSCALL_ENTRY( 0x0051, NtGetWriteWatch, 56 ) \
+    SYSCALL_ENTRY( 0x0052, NtImpersonateAnonymousToken, 8 ) \
+    SYSCALL_ENTRY( 0x0053, NtInitializeNlsFiles, 24 ) \
+    SYSCALL_ENTRY( 0x0054, NtInitiatePowerAction, 32 ) \
+    SYSCALL_ENTRY( 0x0055, NtIsProcessInJob, 16 ) \
+    SYSCALL_ENTRY( 0x0056, NtListenPort, 16 ) \
+    SYSCALL_ENTRY( 0x0057, NtLoadDriver, 8 ) \
+    SYSCALL_ENTRY( 0x0058, NtLoadKey, 16 ) \
+    SYSCALL_ENTRY( 0x0059, NtLoadKey2, 24 ) \
+    SYSCALL_ENTRY( 0x005a, NtLoadKeyEx, 64 ) \
+    SYSCALL_ENTRY( 0x005b, NtLockFile, 80 ) \
+    SYSCALL_ENTRY( 0x005c, NtLockVirtualMemory, 32 ) \
+    SYSCALL_ENTRY( 0x005d, NtMakePermanentObject, 8 ) \
+    SYSCALL_ENTRY( 0x005e, NtMakeTemporaryObject, 8 ) \
+    SYSCALL_ENTRY( 0x005f, NtMapViewOfSection, 80 ) \
+    SYSCALL_ENTRY( 0x0060, NtMapViewOfSectionEx, 72 ) \
+    SYSCALL_ENTRY( 0x0061, NtNotifyChangeDirectoryFile, 72 ) \
+    SYSCALL_ENTRY( 0x0062, NtNotifyChangeKey, 80 ) \
+    SYSCALL_ENTRY( 0x0063, NtNotifyChangeMultipleKeys, 96 ) \
+    SYSCALL_ENTRY( 0x0064, NtOpenDirectoryObject, 24 ) \
+    SYSCALL_ENTRY( 0x0065, NtOpenEvent, 24 ) \
+    SYSCALL_ENTRY( 0x0066, NtOpenFile, 48 ) \
+    SYSCALL_ENTRY( 0x0067, NtOpenIoCompletion, 24 ) \
+    SYSCALL_ENTRY( 0x0068, NtOpenJobObject, 24 ) \
+    SYSCALL_ENTRY( 0x0069, NtOpenKey, 24 ) \
+    SYSCALL_ENTRY( 0x006a, NtOpenKeyEx, 32 ) \
+    SYSCALL_ENTRY( 0x006b, NtOpenKeyTransacted, 32 ) \
+    SYSCALL_ENTRY( 0x006c, NtOpenKeyTransactedEx, 40 ) \
+    SYSCALL_ENTRY( 0x006d, NtOpenKeyedEvent, 24 ) \
+    SYSCALL_ENTRY( 0x006e, NtOpenMutant, 24 ) \
+    SYSCALL_ENTRY( 0x006f, NtOpenProcess, 32 ) \
+    SYSCALL_ENTRY( 0x0070, NtOpenProcessToken, 24 ) \
+    SYSCALL_ENTRY( 0x0071, NtOpenProcessTokenEx, 32 ) \
+    SYSCALL_ENTRY( 0x0072, NtOpenSection, 24 ) \
+    SYSCALL_ENTRY( 0x0073, NtOpenSemaphore, 24 ) \
+    SYSCALL_ENTRY( 0x0074, NtOpenSymbolicLinkObject, 24 ) \
+    SYSCALL_ENTRY( 0x0075, NtOpenThread, 32 ) \
+    SYSCALL_ENTRY( 0x0076, NtOpenThreadToken, 32 ) \
+    SYSCALL_ENTRY( 0x0077, NtOpenThreadTokenEx, 40 ) \
+    SYSCALL_ENTRY( 0x0078, NtOpenTimer, 24 ) \
+    SYSCALL_ENTRY( 0x0079, NtPowerInformation, 40 ) \
+    SYSCALL_ENTRY( 0x007a, NtPrivilegeCheck, 24 ) \
+    SYSCALL_ENTRY( 0x007b, NtProtectVirtualMemory, 40 ) \
+    SYSCALL_ENTRY( 0x007c, NtPulseEvent, 16 ) \
+    SYSCALL_ENTRY( 0x007d, NtQueryAttributesFile, 16 ) \
+    SYSCALL_ENTRY( 0x007e, NtQueryDefaultLocale, 16 ) \
+    SYSCALL_ENTRY( 0x007f, NtQueryDefaultUILanguage, 8 ) \
+    SYSCALL_ENTRY( 0x0080, NtQueryDirectoryFile, 88 ) \
+    SYSCALL_ENTRY( 0x0081, NtQueryDirectoryObject, 56 ) \
+    SYSCALL_ENTRY( 0x0082, NtQueryEaFile, 72 ) \
+    SYSCALL_ENTRY( 0x0083, NtQueryEvent, 40 ) \
+    SYSCALL_ENTRY( 0x0084, NtQueryFullAttributesFile, 16 ) \
+    SYSCALL_ENTRY( 0x0085, NtQueryInformationAtom, 40 ) \
+    SYSCALL_ENTRY( 0x0086, NtQueryInformationFile, 40 ) \
+    SYSCALL_ENTRY( 0x0087, NtQueryInformationJobObject, 40 ) \
+    SYSCALL_ENTRY( 0x0088, NtQueryInformationProcess, 40 ) \
+    SYSCALL_ENTRY( 0x0089, NtQueryInformationThread, 40 ) \
+    SYSCALL_ENTRY( 0x008a, NtQueryInformationToken, 40 ) \
+    SYSCALL_ENTRY( 0x008b, NtQueryInstallUILanguage, 8 ) \
+    SYSCALL_ENTRY( 0x008c, NtQueryIoCompletion, 40 ) \
+    SYSCALL_ENTRY( 0x008d, NtQueryKey, 40 ) \
+    SYSCALL_ENTRY( 0x008e, NtQueryLicenseValue, 40 ) \
+    SYSCALL_ENTRY( 0x008f, NtQueryMultipleValueKey, 48 ) \
+    SYSCALL_ENTRY( 0x0090, NtQueryMutant, 40 ) \
+    SYSCALL_ENTRY( 0x0091, NtQueryObject, 40 ) \
+    SYSCALL_ENTRY( 0x0092, NtQueryPerformanceCounter, 16 ) \
+    SYSCALL_ENTRY( 0x0093, NtQuerySection, 40 ) \
+    SYSCALL_ENTRY( 0x0094, NtQuerySecurityObject, 40 ) \
+    SYSCALL_ENTRY( 0x0095, NtQuerySemaphore, 40 ) \
+    SYSCALL_ENTRY( 0x0096, NtQuerySymbolicLinkObject, 24 ) \
+    SYSCALL_ENTRY( 0x0097, NtQuerySystemEnvironmentValue, 32 ) \
+    SYSCALL_ENTRY( 0x0098, NtQuerySystemEnvironmentValueEx, 40 ) \
+    SYSCALL_ENTRY( 0x0099, NtQuerySystemInformation, 32 ) \
+    SYSCALL_ENTRY( 0x009a, NtQuerySystemInformationEx, 48 ) \
+    SYSCALL_ENTRY( 0x009b, NtQuerySystemTime, 8 ) \
+    SYSCALL_ENTRY( 0x009c, NtQueryTimer, 40 ) \
+    SYSCALL_ENTRY( 0x009d, NtQueryTimerResolution, 24 ) \
+    SYSCALL_ENTRY( 0x009e, NtQueryValueKey, 48 ) \
+    SYSCALL_ENTRY( 0x009f, NtQueryVirtualMemory, 48 ) \
+    SYSCALL_ENTRY( 0x00a0, NtQueryVolumeInformationFile, 40 ) \
+    SYSCALL_ENTRY( 0x00a1, NtQueueApcThread, 40 ) \
+    SYSCALL_ENTRY( 0x00a2, NtQueueApcThreadEx, 48 ) \
+    SYSCALL_ENTRY( 0x00a3, NtRaiseException, 24 ) \
+    SYSCALL_ENTRY( 0x00a4, NtRaiseHardError, 48 ) \
+    SYSCALL_ENTRY( 0x00a5, NtReadFile, 72 ) \
+    SYSCALL_ENTRY( 0x00a6, NtReadFileScatter, 72 ) \
+    SYSCALL_ENTRY( 0x00a7, NtReadVirtualMemory, 40 ) \
+    SYSCALL_ENTRY( 0x00a8, NtRegisterThreadTerminatePort, 8 ) \
+    SYSCALL_ENTRY( 0x00a9, NtReleaseKeyedEvent, 32 ) \
+    SYSCALL_ENTRY( 0x00aa, NtReleaseMutant, 16 ) \
+    SYSCALL_ENTRY( 0x00ab, NtReleaseSemaphore, 24 ) \
+    SYSCALL_ENTRY( 0x00ac, NtRemoveIoCompletion, 40 ) \
+    SYSCALL_ENTRY( 0x00ad, NtRemoveIoCompletionEx, 48 ) \
+    SYSCALL_ENTRY( 0x00ae, NtRemoveProcessDebug, 16 ) \
+    SYSCALL_ENTRY( 0x00af, NtRenameKey, 16 ) \
+    SYSCALL_ENTRY( 0x00b0, NtReplaceKey, 24 ) \
+    SYSCALL_ENTRY( 0x00b1, NtReplyWaitReceivePort, 32 ) \
+    SYSCALL_ENTRY( 0x00b2, NtRequestWaitReplyPort, 24 ) \
+    SYSCALL_ENTRY( 0x00b3, NtResetEvent, 16 ) \
+    SYSCALL_ENTRY( 0x00b4, NtResetWriteWatch, 24 ) \
+    SYSCALL_ENTRY( 0x00b5, NtRestoreKey, 24 ) \
+    SYSCALL_ENTRY( 0x00b6, NtResumeProcess, 8 ) \
+    SYSCALL_ENTRY( 0x00b7, NtResumeThread, 16 ) \
+    SYSCALL_ENTRY( 0x00b8, NtRollbackTransaction, 16 ) \
+    SYSCALL_ENTRY( 0x00b9, NtSaveKey, 16 ) \
+    SYSCALL_ENTRY( 0x00ba, NtSecureConnectPort, 72 ) \
+    SYSCALL_ENTRY( 0x00bb, NtSetContextThread, 16 ) \
+    SYSCALL_ENTRY( 0x00bc, NtSetDebugFilterState, 24 ) \
+    SYSCALL_ENTRY( 0x00bd, NtSetDefaultLocale, 16 ) \
+    SYSCALL_ENTRY( 0x00be, NtSetDefaultUILanguage, 8 ) \
+    SYSCALL_ENTRY( 0x00bf, NtSetEaFile, 32 ) \
+    SYSCALL_ENTRY( 0x00c0, NtSetEvent, 16 ) \
+    SYSCALL_ENTRY( 0x00c1, NtSetInformationDebugObject, 40 ) \
+    SYSCALL_ENTRY( 0x00c2, NtSetInformationFile, 40 ) \
+    SYSCALL_ENTRY( 0x00c3, NtSetInformationJobObject, 32 ) \
+    SYSCALL_ENTRY( 0x00c4, NtSetInformationKey, 32 ) \
+    SYSCALL_ENTRY( 0x00c5, NtSetInformationObject, 32 ) \
+    SYSCALL_ENTRY( 0x00c6, NtSetInformationProcess, 32 ) \
+    SYSCALL_ENTRY( 0x00c7, NtSetInformationThread, 32 ) \
+    SYSCALL_ENTRY( 0x00c8, NtSetInformationToken, 32 ) \
+    SYSCALL_ENTRY( 0x00c9, NtSetInformationVirtualMemory, 48 ) \
+    SYSCALL_ENTRY( 0x00ca, NtSetIntervalProfile, 16 ) \
+    SYSCALL_ENTRY( 0x00cb, NtSetIoCompletion, 40 ) \
+    SYSCALL_ENTRY( 0x00cc, NtSetLdtEntries, 32 ) \
+    SYSCALL_ENTRY( 0x00cd, NtSetSecurityObject, 24 ) \
+    SYSCALL_ENTRY( 0x00ce, NtSetSystemInformation, 24 ) \
+    SYSCALL_ENTRY( 0x00cf, NtSetSystemTime, 16 ) \
+    SYSCALL_ENTRY( 0x00d0, NtSetThreadExecutionState, 16 ) \
+    SYSCALL_ENTRY( 0x00d1, NtSetTimer, 56 ) \
+    SYSCALL_ENTRY( 0x00d2, NtSetTimerResolution, 24 ) \
+    SYSCALL_ENTRY( 0x00d3, NtSetValueKey, 48 ) \
+    SYSCALL_ENTRY( 0x00d4, NtSetVolumeInformationFile, 40 ) \
+    SYSCALL_ENTRY( 0x00d5, NtShutdownSystem, 8 ) \
+    SYSCALL_ENTRY( 0x00d6, NtSignalAndWaitForSingleObject, 32 ) \
+    SYSCALL_ENTRY( 0x00d7, NtSuspendProcess, 8 ) \
+    SYSCALL_ENTRY( 0x00d8, NtSuspendThread, 16 ) \
+    SYSCALL_ENTRY( 0x00d9, NtSystemDebugControl, 48 ) \
+    SYSCALL_ENTRY( 0x00da, NtTerminateJobObject, 16 ) \
+    SYSCALL_ENTRY( 0x00db, NtTerminateProcess, 16 ) \
+    SYSCALL_ENTRY( 0x00dc, NtTerminateThread, 16 ) \
+    SYSCALL_ENTRY( 0x00dd, NtTestAlert, 0 ) \
+    SYSCALL_ENTRY( 0x00de, NtTraceControl, 48 ) \
+    SYSCALL_ENTRY( 0x00df, NtUnloadDriver, 8 ) \
+    SYSCALL_ENTRY( 0x00e0, NtUnloadKey, 8 ) \
+    SYSCALL_ENTRY( 0x00e1, NtUnlockFile, 40 ) \
+    SYSCALL_ENTRY( 0x00e2, NtUnlockVirtualMemory, 32 ) \
+    SYSCALL_ENTRY( 0x00e3, NtUnmapViewOfSection, 16 ) \
+    SYSCALL_ENTRY( 0x00e4, NtUnmapViewOfSectionEx, 24 ) \
+    SYSCALL_ENTRY( 0x00e5, NtWaitForAlertByThreadId, 16 ) \
+    SYSCALL_ENTRY( 0x00e6, NtWaitForDebugEvent, 32 ) \
+    SYSCALL_ENTRY( 0x00e7, NtWaitForKeyedEvent, 32 ) \
+    SYSCALL_ENTRY( 0x00e8, NtWaitForMultipleObjects, 40 ) \
+    SYSCALL_ENTRY( 0x00e9, NtWaitForSingleObject, 24 ) \
+    SYSCALL_ENTRY( 0x00ea, NtWriteFile, 72 ) \
+    SYSCALL_ENTRY( 0x00eb, NtWriteFileGather, 72 ) \
+    SYSCALL_ENTRY( 0x00ec, NtWriteVirtualMemory, 40 ) \
+    SYSCALL_ENTRY( 0x00ed, NtYieldExecution, 0 ) \
+    SYSCALL_ENTRY( 0x00ee, wine_nt_to_unix_file_name, 32 ) \
+    SYSCALL_ENTRY( 0x00ef, wine_unix_to_nt_file_name, 24 )
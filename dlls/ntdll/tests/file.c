@@ -4650,6 +4650,79 @@ static void test_query_volume_information_file(void)
     CloseHandle( dir );
 }
 
+static void open_mismatched_case_files( const WCHAR *dir, unsigned int count, const char *pass )
+{
+    LARGE_INTEGER frequency, start, end;
+    WCHAR path[MAX_PATH];
+    unsigned int i, failed = 0;
+    HANDLE handle;
+
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < count; i++)
+    {
+        swprintf( path, ARRAY_SIZE(path), L"%s\\fILE%05u.TXT", dir, i );
+        handle = CreateFileW( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0 );
+        if (handle == INVALID_HANDLE_VALUE) failed++;
+        else CloseHandle( handle );
+    }
+    QueryPerformanceCounter( &end );
+    ok( !failed, "failed to open %u files\n", failed );
+    trace( "%u entries, %s: opened files with mismatched case in %.2f ms\n", count, pass,
+           (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart );
+}
+
+static void test_case_insensitive_lookup(void)
+{
+    WCHAR dir[MAX_PATH], path[MAX_PATH];
+    unsigned int i, count;
+    HANDLE handle;
+    BOOL ret;
+
+    GetTempPathW( ARRAY_SIZE(dir), dir );
+    wcscat( dir, L"caselookup" );
+    ret = CreateDirectoryW( dir, NULL );
+    ok( ret, "CreateDirectoryW failed, error %lu\n", GetLastError() );
+
+    for (count = 0; count < 300; count++)
+    {
+        swprintf( path, ARRAY_SIZE(path), L"%s\\File%05u.txt", dir, count );
+        handle = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+        if (handle == INVALID_HANDLE_VALUE) break;
+        CloseHandle( handle );
+    }
+    ok( count == 300, "created %u files, error %lu\n", count, GetLastError() );
+
+    /* a directory modified within the last second isn't indexed */
+    open_mismatched_case_files( dir, count, "just modified" );
+    Sleep( 2000 );
+    open_mismatched_case_files( dir, count, "first pass" );
+    open_mismatched_case_files( dir, count, "second pass" );
+
+    /* new and deleted entries are seen with a warm index */
+    swprintf( path, ARRAY_SIZE(path), L"%s\\NewFile.txt", dir );
+    handle = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+    ok( handle != INVALID_HANDLE_VALUE, "CreateFileW failed, error %lu\n", GetLastError() );
+    CloseHandle( handle );
+    swprintf( path, ARRAY_SIZE(path), L"%s\\nEWfILE.TXT", dir );
+    handle = CreateFileW( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0 );
+    ok( handle != INVALID_HANDLE_VALUE, "CreateFileW failed, error %lu\n", GetLastError() );
+    CloseHandle( handle );
+    ret = DeleteFileW( path );
+    ok( ret, "DeleteFileW failed, error %lu\n", GetLastError() );
+    handle = CreateFileW( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0 );
+    ok( handle == INVALID_HANDLE_VALUE, "expected failure\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "got error %lu\n", GetLastError() );
+
+    for (i = 0; i < count; i++)
+    {
+        swprintf( path, ARRAY_SIZE(path), L"%s\\File%05u.txt", dir, i );
+        DeleteFileW( path );
+    }
+    ret = RemoveDirectoryW( dir );
+    ok( ret, "RemoveDirectoryW failed, error %lu\n", GetLastError() );
+}
+
 static void test_query_attribute_information_file(void)
 {
     NTSTATUS status;
@@ -5966,6 +6039,7 @@ START_TEST(file)
     test_file_readonly_access();
     test_query_volume_information_file();
     test_query_attribute_information_file();
+    test_case_insensitive_lookup();
     test_ioctl();
     test_query_ea();
     test_flush_buffers_file();
@@ -27,11 +27,14 @@
 #include "wine/test.h"
 
 static NTSTATUS (WINAPI *pNtAlertThreadByThreadId)( HANDLE );
+static NTSTATUS (WINAPI *pNtAssociateWaitCompletionPacket)( HANDLE, HANDLE, HANDLE, void *, void *, NTSTATUS, ULONG_PTR, BOOLEAN * );
+static NTSTATUS (WINAPI *pNtCancelWaitCompletionPacket)( HANDLE, BOOLEAN );
 static NTSTATUS (WINAPI *pNtClose)( HANDLE );
 static NTSTATUS (WINAPI *pNtCreateEvent) ( PHANDLE, ACCESS_MASK, const OBJECT_ATTRIBUTES *, EVENT_TYPE, BOOLEAN);
 static NTSTATUS (WINAPI *pNtCreateKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, ULONG );
 static NTSTATUS (WINAPI *pNtCreateMutant)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, BOOLEAN );
 static NTSTATUS (WINAPI *pNtCreateSemaphore)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, LONG, LONG );
+static NTSTATUS (WINAPI *pNtCreateWaitCompletionPacket)( HANDLE *, ACCESS_MASK, OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtOpenEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtOpenKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtPulseEvent)( HANDLE, LONG * );
@@ -837,6 +840,176 @@ static void test_tid_alert( char **argv )
     CloseHandle( pi.hThread );
 }
 
+struct ping_pong
+{
+    HANDLE ping, pong, mutex;
+    unsigned int count;
+};
+
+static DWORD WINAPI ping_pong_thread( void *arg )
+{
+    struct ping_pong *params = arg;
+    unsigned int i;
+    DWORD ret;
+
+    for (i = 0; i < params->count; i++)
+    {
+        ret = WaitForSingleObject( params->ping, 5000 );
+        if (ret) break;
+        ret = WaitForSingleObject( params->mutex, 0 );
+        if (ret) break;
+        ReleaseMutex( params->mutex );
+        SetEvent( params->pong );
+    }
+    ok(i == params->count, "got %u iterations, ret %lu\n", i, ret);
+    return 0;
+}
+
+/* Both threads pass the ball with auto-reset events, run it with and without WINEFASTSYNC
+ * set when starting the wineserver to compare the throughput. */
+static void test_signal_wait_throughput(void)
+{
+    struct ping_pong params;
+    LARGE_INTEGER freq, start, end;
+    HANDLE thread, sem;
+    unsigned int i;
+    LONG prev;
+    DWORD ret;
+
+    params.ping = CreateEventW( NULL, FALSE, FALSE, NULL );
+    params.pong = CreateEventW( NULL, FALSE, FALSE, NULL );
+    params.mutex = CreateMutexW( NULL, FALSE, NULL );
+    params.count = 20000;
+    thread = CreateThread( NULL, 0, ping_pong_thread, &params, 0, NULL );
+
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < params.count; i++)
+    {
+        SetEvent( params.ping );
+        ret = WaitForSingleObject( params.pong, 5000 );
+        if (ret) break;
+    }
+    QueryPerformanceCounter( &end );
+    ok(i == params.count, "got %u iterations, ret %lu\n", i, ret);
+
+    trace( "%u signal/wait pairs per second\n",
+           (unsigned int)(2 * i * freq.QuadPart / max( end.QuadPart - start.QuadPart, 1 )) );
+
+    ret = WaitForSingleObject( thread, 5000 );
+    ok(!ret, "got %lu\n", ret);
+    CloseHandle( thread );
+
+    /* the mutex is released and reacquirable after the other thread is done with it */
+    ret = WaitForSingleObject( params.mutex, 0 );
+    ok(!ret, "got %lu\n", ret);
+    ret = WaitForSingleObject( params.mutex, 0 );
+    ok(!ret, "got %lu\n", ret);
+    ret = pNtReleaseMutant( params.mutex, &prev );
+    ok(!ret, "got %#lx\n", ret);
+    ok(prev == -1, "got prev %ld\n", prev);
+    ret = pNtReleaseMutant( params.mutex, &prev );
+    ok(!ret, "got %#lx\n", ret);
+    ok(prev == 0, "got prev %ld\n", prev);
+    ret = pNtReleaseMutant( params.mutex, &prev );
+    ok(ret == STATUS_MUTANT_NOT_OWNED, "got %#lx\n", ret);
+
+    /* mixing objects in a wait all still works */
+    sem = CreateSemaphoreW( NULL, 1, 1, NULL );
+    SetEvent( params.ping );
+    ret = WaitForMultipleObjects( 2, (HANDLE[]){params.ping, sem}, TRUE, 0 );
+    ok(!ret, "got %lu\n", ret);
+    ret = WaitForSingleObject( params.ping, 0 );
+    ok(ret == WAIT_TIMEOUT, "got %lu\n", ret);
+    ret = WaitForSingleObject( sem, 0 );
+    ok(ret == WAIT_TIMEOUT, "got %lu\n", ret);
+    ret = WaitForMultipleObjects( 2, (HANDLE[]){params.ping, sem}, FALSE, 10 );
+    ok(ret == WAIT_TIMEOUT, "got %lu\n", ret);
+
+    CloseHandle( sem );
+    CloseHandle( params.mutex );
+    CloseHandle( params.pong );
+    CloseHandle( params.ping );
+}
+
+struct packet_race
+{
+    HANDLE event;
+    LONG acquired;
+    BOOL done;
+};
+
+static DWORD WINAPI packet_race_thread( void *arg )
+{
+    struct packet_race *params = arg;
+
+    while (!ReadAcquire( (LONG *)&params->done ))
+        if (!WaitForSingleObject( params->event, 0 )) InterlockedIncrement( &params->acquired );
+    return 0;
+}
+
+/* Wait completion packets compete with a thread for an auto-reset event, each
+ * SetEvent must be consumed by exactly one of them. With WINEFASTSYNC, the
+ * thread acquires the event without the server, which can then lose it. */
+static void test_wait_completion_packet_race(void)
+{
+    struct packet_race params = {0};
+    HANDLE packets[100], port, thread;
+    unsigned int i, count = 0, received = 0;
+    OVERLAPPED *overlapped;
+    ULONG_PTR key;
+    NTSTATUS status;
+    BOOLEAN signaled;
+    DWORD size, start;
+
+    if (!pNtCreateWaitCompletionPacket)
+    {
+        win_skip( "wait completion packets are not supported\n" );
+        return;
+    }
+
+    params.event = CreateEventW( NULL, FALSE, FALSE, NULL );
+    port = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, 0 );
+    for (i = 0; i < ARRAY_SIZE(packets); i++)
+    {
+        status = pNtCreateWaitCompletionPacket( &packets[i], GENERIC_ALL, NULL );
+        ok( !status, "got %#lx\n", status );
+        status = pNtAssociateWaitCompletionPacket( packets[i], port, params.event, (void *)(ULONG_PTR)i,
+                                                   NULL, 0, 0, &signaled );
+        ok( !status, "got %#lx\n", status );
+        ok( !signaled, "got signaled %u\n", signaled );
+    }
+    thread = CreateThread( NULL, 0, packet_race_thread, &params, 0, NULL );
+
+    for (count = 0; count < ARRAY_SIZE(packets); count++)
+    {
+        SetEvent( params.event );
+        /* wait for the event to be consumed before setting it again */
+        start = GetTickCount();
+        while (received + ReadAcquire( &params.acquired ) <= count && GetTickCount() - start < 5000)
+            if (GetQueuedCompletionStatus( port, &size, &key, &overlapped, 1 )) received++;
+        if (received + params.acquired <= count) break;
+    }
+
+    WriteRelease( (LONG *)&params.done, TRUE );
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+    while (GetQueuedCompletionStatus( port, &size, &key, &overlapped, 100 )) received++;
+
+    ok( count == ARRAY_SIZE(packets), "event wasn't consumed after %u signals\n", count );
+    ok( received + params.acquired == count, "got %u packets and %lu thread waits for %u signals\n",
+        received, params.acquired, count );
+    trace( "%u packets, %lu thread waits\n", received, params.acquired );
+
+    for (i = 0; i < ARRAY_SIZE(packets); i++)
+    {
+        pNtCancelWaitCompletionPacket( packets[i], TRUE );
+        CloseHandle( packets[i] );
+    }
+    CloseHandle( port );
+    CloseHandle( params.event );
+}
+
 START_TEST(sync)
 {
     HMODULE module = GetModuleHandleA("ntdll.dll");
@@ -848,11 +1021,14 @@ START_TEST(sync)
     if (argc > 2) return;
 
     pNtAlertThreadByThreadId        = (void *)GetProcAddress(module, "NtAlertThreadByThreadId");
+    pNtAssociateWaitCompletionPacket = (void *)GetProcAddress(module, "NtAssociateWaitCompletionPacket");
+    pNtCancelWaitCompletionPacket   = (void *)GetProcAddress(module, "NtCancelWaitCompletionPacket");
     pNtClose                        = (void *)GetProcAddress(module, "NtClose");
     pNtCreateEvent                  = (void *)GetProcAddress(module, "NtCreateEvent");
     pNtCreateKeyedEvent             = (void *)GetProcAddress(module, "NtCreateKeyedEvent");
     pNtCreateMutant                 = (void *)GetProcAddress(module, "NtCreateMutant");
     pNtCreateSemaphore              = (void *)GetProcAddress(module, "NtCreateSemaphore");
+    pNtCreateWaitCompletionPacket   = (void *)GetProcAddress(module, "NtCreateWaitCompletionPacket");
     pNtOpenEvent                    = (void *)GetProcAddress(module, "NtOpenEvent");
     pNtOpenKeyedEvent               = (void *)GetProcAddress(module, "NtOpenKeyedEvent");
     pNtPulseEvent                   = (void *)GetProcAddress(module, "NtPulseEvent");
@@ -884,4 +1060,6 @@ START_TEST(sync)
     test_keyed_events();
     test_resource();
     test_tid_alert( argv );
+    test_signal_wait_throughput();
+    test_wait_completion_packet_race();
 }
@@ -570,6 +570,58 @@ static void test_RtlRegisterWait(void)
     CloseHandle(event);
 }
 
+static void CALLBACK rtl_periodic_wait_cb(void *userdata, BOOLEAN timeout)
+{
+    LONG *count = userdata;
+
+    ok(timeout, "expected a timeout\n");
+    InterlockedIncrement(count);
+}
+
+static void test_RtlRegisterWait_periodic(void)
+{
+    static const struct
+    {
+        BOOL mutex;
+        ULONG flags;
+    }
+    tests[] =
+    {
+        /* events are waited for through wait completion packets, mutexes and
+         * WT_EXECUTEINWAITTHREAD waits through wait threads */
+        { FALSE, WT_EXECUTEDEFAULT },
+        { TRUE, WT_EXECUTEDEFAULT },
+        { FALSE, WT_EXECUTEINWAITTHREAD },
+    };
+    unsigned int i;
+    NTSTATUS status;
+    HANDLE handle;
+    HANDLE wait;
+    LONG count;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        winetest_push_context("%u", i);
+
+        /* the wait threads never get the mutex */
+        if (tests[i].mutex) handle = CreateMutexW(NULL, TRUE, NULL);
+        else handle = CreateEventW(NULL, FALSE, FALSE, NULL);
+        ok(handle != NULL, "failed to create object\n");
+
+        /* the relative timeout restarts each time it expires */
+        count = 0;
+        status = RtlRegisterWait(&wait, handle, rtl_periodic_wait_cb, &count, 100, tests[i].flags);
+        ok(!status, "RtlRegisterWait failed with status %lx\n", status);
+        Sleep(550);
+        status = RtlDeregisterWaitEx(wait, INVALID_HANDLE_VALUE);
+        ok(!status, "RtlDeregisterWaitEx failed with status %lx\n", status);
+        ok(count >= 3 && count <= 6, "got %ld timeouts\n", count);
+
+        CloseHandle(handle);
+        winetest_pop_context();
+    }
+}
+
 static void CALLBACK simple_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
 {
     HANDLE semaphore = userdata;
@@ -838,6 +890,102 @@ static void test_tp_work_scheduler(void)
     pTpReleasePool(pool);
 }
 
+struct scaling_data
+{
+    LONG count;
+    LONG total;
+    HANDLE done;
+};
+
+static void CALLBACK scaling_simple_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
+{
+    struct scaling_data *data = userdata;
+    if (InterlockedIncrement(&data->count) == data->total)
+        SetEvent(data->done);
+}
+
+static void CALLBACK scaling_work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    scaling_simple_cb(instance, userdata);
+}
+
+static void test_tp_work_scaling(void)
+{
+    static const DWORD thread_counts[] = {1, 2, 4, 8, 16};
+    static const LONG item_count = 20000;
+    LARGE_INTEGER frequency, start, end;
+    TP_CALLBACK_ENVIRON environment;
+    struct scaling_data data;
+    TP_WORK *work[16];
+    NTSTATUS status;
+    TP_POOL *pool;
+    unsigned int i, j;
+    DWORD result;
+    double ms;
+
+    QueryPerformanceFrequency(&frequency);
+    data.done = CreateEventW(NULL, FALSE, FALSE, NULL);
+
+    for (i = 0; i < ARRAY_SIZE(thread_counts); i++)
+    {
+        pool = NULL;
+        status = pTpAllocPool(&pool, NULL);
+        ok(!status, "TpAllocPool failed with status %lx\n", status);
+        ok(pool != NULL, "expected pool != NULL\n");
+        pTpSetPoolMaxThreads(pool, thread_counts[i]);
+
+        memset(&environment, 0, sizeof(environment));
+        environment.Version = 1;
+        environment.Pool = pool;
+
+        /* simple callbacks, each post allocates a new object */
+        data.count = 0;
+        data.total = item_count;
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < item_count; j++)
+        {
+            status = pTpSimpleTryPost(scaling_simple_cb, &data, &environment);
+            if (status) break;
+        }
+        ok(!status, "TpSimpleTryPost failed with status %lx\n", status);
+        result = WaitForSingleObject(data.done, 30000);
+        QueryPerformanceCounter(&end);
+        ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", result);
+        ms = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+        trace("%lu threads: %ld simple callbacks in %.2f ms, %.0f items/s\n", thread_counts[i],
+              item_count, ms, ms ? item_count * 1000.0 / ms : 0.0);
+
+        /* work objects posted repeatedly, spread over several objects */
+        for (j = 0; j < ARRAY_SIZE(work); j++)
+        {
+            work[j] = NULL;
+            status = pTpAllocWork(&work[j], scaling_work_cb, &data, &environment);
+            ok(!status, "TpAllocWork failed with status %lx\n", status);
+        }
+        data.count = 0;
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < item_count; j++)
+            pTpPostWork(work[j % ARRAY_SIZE(work)]);
+        result = WaitForSingleObject(data.done, 30000);
+        QueryPerformanceCounter(&end);
+        ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", result);
+        ms = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+        trace("%lu threads: %ld work callbacks in %.2f ms, %.0f items/s\n", thread_counts[i],
+              item_count, ms, ms ? item_count * 1000.0 / ms : 0.0);
+
+        for (j = 0; j < ARRAY_SIZE(work); j++)
+        {
+            pTpWaitForWork(work[j], FALSE);
+            pTpReleaseWork(work[j]);
+        }
+        ok(data.count == item_count, "expected %ld callbacks, got %ld\n", item_count, data.count);
+
+        pTpReleasePool(pool);
+    }
+
+    CloseHandle(data.done);
+}
+
 static void CALLBACK simple_release_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
 {
     HANDLE *semaphores = userdata;
@@ -2008,6 +2156,99 @@ static void test_tp_multi_wait(void)
     CloseHandle(semaphore);
 }
 
+static void CALLBACK scaling_wait_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WAIT *wait, TP_WAIT_RESULT result)
+{
+    ok(result == WAIT_OBJECT_0, "expected WAIT_OBJECT_0, got %lu\n", result);
+    scaling_simple_cb(instance, userdata);
+}
+
+static void test_tp_wait_scaling(void)
+{
+    static const LONG wait_counts[] = {1, 64, 1000, 10000};
+    LARGE_INTEGER frequency, start, end, timeout;
+    TP_CALLBACK_ENVIRON environment;
+    struct scaling_data data;
+    HANDLE *events;
+    TP_WAIT **waits;
+    NTSTATUS status;
+    TP_POOL *pool;
+    unsigned int i;
+    LONG j, count;
+    DWORD result;
+    double ms;
+
+    QueryPerformanceFrequency(&frequency);
+    data.done = CreateEventW(NULL, FALSE, FALSE, NULL);
+
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %lx\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+
+    events = HeapAlloc(GetProcessHeap(), 0, wait_counts[ARRAY_SIZE(wait_counts) - 1] * sizeof(*events));
+    waits = HeapAlloc(GetProcessHeap(), 0, wait_counts[ARRAY_SIZE(wait_counts) - 1] * sizeof(*waits));
+
+    /* the timeouts are never reached, but have to be tracked */
+    timeout.QuadPart = (ULONGLONG)60 * -10000000;
+
+    for (i = 0; i < ARRAY_SIZE(wait_counts); i++)
+    {
+        count = wait_counts[i];
+
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < count; j++)
+        {
+            events[j] = CreateEventW(NULL, FALSE, FALSE, NULL);
+            if (!events[j]) break;
+            waits[j] = NULL;
+            status = pTpAllocWait(&waits[j], scaling_wait_cb, &data, &environment);
+            if (status) break;
+            pTpSetWait(waits[j], events[j], &timeout);
+        }
+        QueryPerformanceCounter(&end);
+        if (j < count)
+        {
+            skip("failed to register %ld waits, status %lx\n", count, status);
+            count = j;
+            if (events[j]) CloseHandle(events[j]);
+            goto cleanup;
+        }
+        ms = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+        trace("%ld waits: registered in %.2f ms\n", count, ms);
+
+        /* signal the waits in reverse order of registration */
+        data.count = 0;
+        data.total = count;
+        QueryPerformanceCounter(&start);
+        for (j = count - 1; j >= 0; j--)
+            SetEvent(events[j]);
+        result = WaitForSingleObject(data.done, 60000);
+        QueryPerformanceCounter(&end);
+        ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", result);
+        ok(data.count == count, "expected %ld callbacks, got %ld\n", count, data.count);
+        ms = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+        trace("%ld waits: all signaled in %.2f ms, %.2f us per signal\n", count, ms,
+              ms * 1000.0 / count);
+
+cleanup:
+        for (j = 0; j < count; j++)
+        {
+            pTpWaitForWait(waits[j], FALSE);
+            pTpReleaseWait(waits[j]);
+            CloseHandle(events[j]);
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, waits);
+    HeapFree(GetProcessHeap(), 0, events);
+    pTpReleasePool(pool);
+    CloseHandle(data.done);
+}
+
 struct io_cb_ctx
 {
     unsigned int count;
@@ -2391,6 +2632,7 @@ START_TEST(threadpool)
 {
     test_RtlQueueWorkItem();
     test_RtlRegisterWait();
+    test_RtlRegisterWait_periodic();
 
     if (!init_threadpool())
         return;
@@ -2398,6 +2640,7 @@ START_TEST(threadpool)
     test_tp_simple();
     test_tp_work();
     test_tp_work_scheduler();
+    test_tp_work_scaling();
     test_tp_group_wait();
     test_tp_group_cancel();
     test_tp_instance();
@@ -2406,6 +2649,7 @@ START_TEST(threadpool)
     test_tp_window_length();
     test_tp_wait();
     test_tp_multi_wait();
+    test_tp_wait_scaling();
     test_tp_io();
     test_kernel32_tp_io();
 }
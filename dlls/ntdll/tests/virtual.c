@@ -2734,6 +2734,63 @@ static LONG CALLBACK exec_write_handler( EXCEPTION_POINTERS *ptrs )
     return EXCEPTION_CONTINUE_EXECUTION;
 }
 
+static void test_image_mapping_contents(void)
+{
+    IMAGE_SECTION_HEADER *sec;
+    IMAGE_NT_HEADERS *nt;
+    LARGE_INTEGER offset;
+    HANDLE file, mapping;
+    void *ptr, *first = NULL;
+    char *copy = NULL;
+    NTSTATUS status;
+    DWORD start;
+    SIZE_T size;
+    UINT i, j;
+
+    /* the image is relocated the same way every time it is mapped at the same address */
+
+    file = CreateFileA( "c:\\windows\\system32\\kernel32.dll", GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed, error %lu\n", GetLastError() );
+    mapping = CreateFileMappingA( file, NULL, SEC_IMAGE | PAGE_READONLY, 0, 0, NULL );
+    ok( mapping != 0, "CreateFileMapping failed\n" );
+    CloseHandle( file );
+
+    start = GetTickCount();
+    for (i = 0; i < 100; i++)
+    {
+        ptr = NULL;
+        size = 0;
+        offset.QuadPart = 0;
+        status = NtMapViewOfSection( mapping, NtCurrentProcess(), &ptr, 0, 0, &offset, &size, 1, 0, PAGE_READONLY );
+        ok( status == STATUS_IMAGE_NOT_AT_BASE, "Unexpected status %08lx\n", status );
+        if (!NT_SUCCESS(status)) break;
+
+        if (!i)
+        {
+            first = ptr;
+            copy = VirtualAlloc( NULL, size, MEM_COMMIT, PAGE_READWRITE );
+            memcpy( copy, ptr, page_size );
+        }
+        nt = RtlImageNtHeader( ptr );
+        sec = IMAGE_FIRST_SECTION( nt );
+        for (j = 0; j < nt->FileHeader.NumberOfSections; j++, sec++)
+        {
+            if (!(sec->Characteristics & IMAGE_SCN_MEM_READ)) continue;
+            if (!i) memcpy( copy + sec->VirtualAddress, (char *)ptr + sec->VirtualAddress, sec->Misc.VirtualSize );
+            else if (ptr == first)
+                ok( !memcmp( copy + sec->VirtualAddress, (char *)ptr + sec->VirtualAddress, sec->Misc.VirtualSize ),
+                    "%u: section %.8s differs\n", i, sec->Name );
+        }
+        if (i && ptr == first) ok( !memcmp( copy, ptr, page_size ), "%u: headers differ\n", i );
+        NtUnmapViewOfSection( NtCurrentProcess(), ptr );
+    }
+    trace( "%u image mappings in %lu ms\n", i, GetTickCount() - start );
+
+    if (copy) VirtualFree( copy, 0, MEM_RELEASE );
+    NtClose( mapping );
+}
+
 static void test_exec_memory_writes(void)
 {
     NTSTATUS status;
@@ -3029,5 +3086,6 @@ START_TEST(virtual)
     test_syscalls();
     test_query_region_information();
     test_query_image_information();
+    test_image_mapping_contents();
     test_exec_memory_writes();
 }
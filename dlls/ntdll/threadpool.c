@@ -99,6 +99,16 @@ struct timer_queue
 #define THREADPOOL_WORKER_TIMEOUT 5000
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
 
+#define THREADPOOL_MAX_QUEUES 64
+
+/* per-worker queue of pending objects, objects are bound to one queue when allocated */
+struct threadpool_queue
+{
+    CRITICAL_SECTION        cs;
+    /* Pools of work items, locked via .cs, order matches TP_CALLBACK_PRIORITY - high, normal, low. */
+    struct list             pools[3];
+};
+
 /* internal threadpool representation */
 struct threadpool
 {
@@ -106,14 +116,20 @@ struct threadpool
     LONG                    objcount;
     BOOL                    shutdown;
     CRITICAL_SECTION        cs;
-    /* Pools of work items, locked via .cs, order matches TP_CALLBACK_PRIORITY - high, normal, low. */
-    struct list             pools[3];
-    RTL_CONDITION_VARIABLE  update_event;
-    /* information about worker threads, locked via .cs */
-    int                     max_workers;
-    int                     min_workers;
-    int                     num_workers;
-    int                     num_busy_workers;
+    /* Work queues, workers take items from their own queue first and steal from the others. */
+    struct threadpool_queue *queues;
+    unsigned int            num_queues;
+    LONG                    next_queue;
+    /* number of queued objects per priority, over all queues */
+    LONG                    num_queued[3];
+    /* idle workers wait for this value to change */
+    LONG                    worker_serial;
+    LONG                    num_idle_workers;
+    /* information about worker threads, modified under .cs */
+    LONG                    max_workers;
+    LONG                    min_workers;
+    LONG                    num_workers;
+    LONG                    num_busy_workers;
     HANDLE                  compl_port;
     TP_POOL_STACK_INFORMATION stack_info;
 };
@@ -143,6 +159,7 @@ struct threadpool_object
     enum threadpool_objtype type;
     struct threadpool       *pool;
     struct threadpool_group *group;
+    struct threadpool_queue *queue;
     PVOID                   userdata;
     PTP_CLEANUP_GROUP_CANCEL_CALLBACK group_cancel_callback;
     PTP_SIMPLE_CALLBACK     finalization_callback;
@@ -152,7 +169,7 @@ struct threadpool_object
     /* information about the group, locked via .group->cs */
     struct list             group_entry;
     BOOL                    is_group_member;
-    /* information about the pool, locked via .pool->cs */
+    /* information about the pool, locked via .queue->cs */
     struct list             pool_entry;
     RTL_CONDITION_VARIABLE  finished_event;
     RTL_CONDITION_VARIABLE  group_finished_event;
@@ -196,11 +213,16 @@ struct threadpool_object
             HANDLE          handle;
             DWORD           flags;
             RTL_WAITORTIMERCALLBACKFUNC rtl_callback;
+            /* wait completion packet, used instead of a bucket when not NULL */
+            HANDLE          packet;
+            BOOL            associated;
+            unsigned int    heap_index;
+            LONGLONG        interval;
         } wait;
         struct
         {
             PTP_IO_CALLBACK callback;
-            /* locked via .pool->cs */
+            /* locked via .queue->cs */
             unsigned int    pending_count, skipped_count, completion_count, completion_max;
             BOOL            shutting_down;
             struct io_completion *completions;
@@ -271,6 +293,13 @@ static struct
     CRITICAL_SECTION        cs;
     LONG                    num_buckets;
     struct list             buckets;
+    /* wait objects serviced through wait completion packets */
+    LONG                    objcount;
+    BOOL                    thread_running;
+    HANDLE                  port;
+    struct threadpool_object **heap;
+    unsigned int            heap_count;
+    unsigned int            heap_size;
 }
 waitqueue =
 {
@@ -1158,12 +1187,55 @@ static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
     if (status == STATUS_SUCCESS)
     {
         InterlockedIncrement( &pool->refcount );
-        pool->num_workers++;
+        InterlockedIncrement( &pool->num_workers );
         NtClose( thread );
     }
     return status;
 }
 
+/***********************************************************************
+ *           tp_threadpool_has_work    (internal)
+ */
+static BOOL tp_threadpool_has_work( struct threadpool *pool )
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(pool->num_queued); ++i)
+        if (ReadNoFence( &pool->num_queued[i] )) return TRUE;
+
+    return FALSE;
+}
+
+/***********************************************************************
+ *           tp_threadpool_wake    (internal)
+ *
+ * Makes sure a worker thread picks up newly queued work, either by
+ * starting a new one, or by waking up an idle one.
+ */
+static void tp_threadpool_wake( struct threadpool *pool )
+{
+    NTSTATUS status = STATUS_UNSUCCESSFUL;
+
+    /* Start new worker threads if required. */
+    if (ReadNoFence( &pool->num_busy_workers ) >= ReadNoFence( &pool->num_workers ) &&
+        ReadNoFence( &pool->num_workers ) < ReadNoFence( &pool->max_workers ))
+    {
+        RtlEnterCriticalSection( &pool->cs );
+        if (pool->num_busy_workers >= pool->num_workers &&
+            pool->num_workers < pool->max_workers)
+            status = tp_new_worker_thread( pool );
+        RtlLeaveCriticalSection( &pool->cs );
+    }
+
+    /* No new thread started - wake up one existing thread. */
+    if (status != STATUS_SUCCESS)
+    {
+        InterlockedIncrement( &pool->worker_serial );
+        if (ReadNoFence( &pool->num_idle_workers ))
+            RtlWakeAddressSingle( &pool->worker_serial );
+    }
+}
+
 /***********************************************************************
  *           tp_timerqueue_lock    (internal)
  *
@@ -1238,6 +1310,24 @@ static void tp_timerqueue_unlock( struct threadpool_object *timer )
     RtlLeaveCriticalSection( &timerqueue.cs );
 }
 
+/***********************************************************************
+ *           waitqueue_rearm    (internal)
+ *
+ * Restarts the timeout of a wait object without WT_EXECUTEONLYONCE once it
+ * was triggered. Relative timeouts restart, absolute timeouts only expire once.
+ * waitqueue.cs has to be held.
+ */
+static void waitqueue_rearm( struct threadpool_object *wait, BOOL signaled )
+{
+    if (wait->u.wait.interval)
+    {
+        LARGE_INTEGER now;
+        NtQuerySystemTime( &now );
+        wait->u.wait.timeout = now.QuadPart + wait->u.wait.interval;
+    }
+    else if (!signaled) wait->u.wait.timeout = MAXLONGLONG;
+}
+
 /***********************************************************************
  *           waitqueue_thread_proc    (internal)
  */
@@ -1247,7 +1337,7 @@ static void CALLBACK waitqueue_thread_proc( void *param )
     LONG update_serials[MAXIMUM_WAITQUEUE_OBJECTS];
     HANDLE handles[MAXIMUM_WAITQUEUE_OBJECTS + 1];
     struct waitqueue_bucket *bucket = param;
-    struct threadpool_object *wait, *next;
+    struct threadpool_object *wait, *next, *executed;
     LARGE_INTEGER now, timeout;
     DWORD num_handles;
     NTSTATUS status;
@@ -1268,6 +1358,7 @@ static void CALLBACK waitqueue_thread_proc( void *param )
         {
             assert( wait->type == TP_OBJECT_TYPE_WAIT );
             assert( wait->u.wait.wait_pending );
+            executed = NULL;
             if (wait->u.wait.timeout <= now.QuadPart)
             {
                 /* Wait object timed out. */
@@ -1277,18 +1368,23 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                     list_add_tail( &bucket->reserved, &wait->u.wait.wait_entry );
                     wait->u.wait.wait_pending = FALSE;
                 }
+                else waitqueue_rearm( wait, FALSE );
                 if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
                 {
                     InterlockedIncrement( &wait->refcount );
                     wait->num_pending_callbacks++;
-                    RtlEnterCriticalSection( &wait->pool->cs );
+                    RtlEnterCriticalSection( &wait->queue->cs );
                     tp_object_execute( wait, TRUE );
-                    RtlLeaveCriticalSection( &wait->pool->cs );
-                    tp_object_release( wait );
+                    RtlLeaveCriticalSection( &wait->queue->cs );
+                    /* the callback may have changed the wait, keep it alive until it was checked */
+                    executed = wait;
                 }
                 else tp_object_submit( wait, FALSE );
             }
-            else
+
+            /* A re-armed wait object keeps waiting for its handle. */
+            if (wait->u.wait.bucket == bucket && wait->u.wait.wait_pending &&
+                wait->u.wait.timeout > now.QuadPart)
             {
                 if (wait->u.wait.timeout < timeout.QuadPart)
                     timeout.QuadPart = wait->u.wait.timeout;
@@ -1300,6 +1396,7 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                 update_serials[num_handles] = wait->update_serial;
                 num_handles++;
             }
+            if (executed) tp_object_release( executed );
         }
 
         if (!bucket->objcount)
@@ -1336,13 +1433,14 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                         list_add_tail( &bucket->reserved, &wait->u.wait.wait_entry );
                         wait->u.wait.wait_pending = FALSE;
                     }
+                    else waitqueue_rearm( wait, TRUE );
                     if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
                     {
                         wait->u.wait.signaled++;
                         wait->num_pending_callbacks++;
-                        RtlEnterCriticalSection( &wait->pool->cs );
+                        RtlEnterCriticalSection( &wait->queue->cs );
                         tp_object_execute( wait, TRUE );
-                        RtlLeaveCriticalSection( &wait->pool->cs );
+                        RtlLeaveCriticalSection( &wait->queue->cs );
                     }
                     else tp_object_submit( wait, TRUE );
                 }
@@ -1422,24 +1520,315 @@ static void CALLBACK waitqueue_thread_proc( void *param )
 }
 
 /***********************************************************************
- *           tp_waitqueue_lock    (internal)
+ *           waitqueue_heap_swap    (internal)
  */
-static NTSTATUS tp_waitqueue_lock( struct threadpool_object *wait )
+static void waitqueue_heap_swap( unsigned int a, unsigned int b )
+{
+    struct threadpool_object *tmp = waitqueue.heap[a];
+
+    waitqueue.heap[a] = waitqueue.heap[b];
+    waitqueue.heap[a]->u.wait.heap_index = a;
+    waitqueue.heap[b] = tmp;
+    waitqueue.heap[b]->u.wait.heap_index = b;
+}
+
+/***********************************************************************
+ *           waitqueue_heap_fixup    (internal)
+ *
+ * Restores the heap ordering after the timeout of the element at
+ * index has changed.
+ */
+static void waitqueue_heap_fixup( unsigned int index )
+{
+    struct threadpool_object **heap = waitqueue.heap;
+    unsigned int child;
+
+    while (index && heap[index]->u.wait.timeout < heap[(index - 1) / 2]->u.wait.timeout)
+    {
+        waitqueue_heap_swap( index, (index - 1) / 2 );
+        index = (index - 1) / 2;
+    }
+
+    while ((child = 2 * index + 1) < waitqueue.heap_count)
+    {
+        if (child + 1 < waitqueue.heap_count && heap[child + 1]->u.wait.timeout < heap[child]->u.wait.timeout)
+            child++;
+        if (heap[index]->u.wait.timeout <= heap[child]->u.wait.timeout) break;
+        waitqueue_heap_swap( index, child );
+        index = child;
+    }
+}
+
+/***********************************************************************
+ *           waitqueue_heap_remove    (internal)
+ */
+static void waitqueue_heap_remove( struct threadpool_object *wait )
+{
+    unsigned int index = wait->u.wait.heap_index;
+
+    if (index == ~0u) return;
+    wait->u.wait.heap_index = ~0u;
+
+    if (index != --waitqueue.heap_count)
+    {
+        waitqueue.heap[index] = waitqueue.heap[waitqueue.heap_count];
+        waitqueue.heap[index]->u.wait.heap_index = index;
+        waitqueue_heap_fixup( index );
+    }
+}
+
+/***********************************************************************
+ *           waitqueue_heap_update    (internal)
+ *
+ * Moves the wait object to its place in the timeout heap, space for it
+ * has been reserved by tp_waitqueue_lock. Returns TRUE if the earliest
+ * timeout has changed.
+ */
+static BOOL waitqueue_heap_update( struct threadpool_object *wait )
+{
+    struct threadpool_object *first = waitqueue.heap_count ? waitqueue.heap[0] : NULL;
+
+    if (wait->u.wait.timeout == MAXLONGLONG)
+        waitqueue_heap_remove( wait );
+    else
+    {
+        if (wait->u.wait.heap_index == ~0u)
+        {
+            assert( waitqueue.heap_count < waitqueue.heap_size );
+            wait->u.wait.heap_index = waitqueue.heap_count;
+            waitqueue.heap[waitqueue.heap_count++] = wait;
+        }
+        waitqueue_heap_fixup( wait->u.wait.heap_index );
+    }
+
+    return waitqueue.heap_count && (waitqueue.heap[0] != first || first == wait);
+}
+
+/***********************************************************************
+ *           waitqueue_wake    (internal)
+ *
+ * Wakes up the wait completion port thread to recompute its timeout.
+ */
+static void waitqueue_wake(void)
+{
+    NtSetIoCompletion( waitqueue.port, 0, 0, STATUS_SUCCESS, 0 );
+}
+
+/***********************************************************************
+ *           waitqueue_associate_packet    (internal)
+ *
+ * Queues a completion to the waitqueue port once the wait object handle
+ * is signaled. The completion holds a reference to the wait object.
+ */
+static NTSTATUS waitqueue_associate_packet( struct threadpool_object *wait )
 {
-    struct waitqueue_bucket *bucket;
     NTSTATUS status;
-    HANDLE thread;
-    BOOL alertable = (wait->u.wait.flags & WT_EXECUTEINIOTHREAD) != 0;
-    assert( wait->type == TP_OBJECT_TYPE_WAIT );
 
-    wait->u.wait.signaled       = 0;
-    wait->u.wait.bucket         = NULL;
-    wait->u.wait.wait_pending   = FALSE;
-    wait->u.wait.timeout        = 0;
-    wait->u.wait.handle         = INVALID_HANDLE_VALUE;
+    assert( !wait->u.wait.associated );
+
+    InterlockedIncrement( &wait->refcount );
+    status = NtAssociateWaitCompletionPacket( wait->u.wait.packet, waitqueue.port, wait->u.wait.handle,
+                                              wait, (void *)(LONG_PTR)wait->update_serial,
+                                              STATUS_SUCCESS, 0, NULL );
+    if (status)
+    {
+        InterlockedDecrement( &wait->refcount );
+        return status;
+    }
+
+    wait->u.wait.associated = TRUE;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           waitqueue_cancel_packet    (internal)
+ */
+static void waitqueue_cancel_packet( struct threadpool_object *wait )
+{
+    if (!wait->u.wait.associated) return;
+
+    /* A completion already removed from the port is ignored by the thread. */
+    wait->u.wait.associated = FALSE;
+    ++wait->update_serial;
+    if (NtCancelWaitCompletionPacket( wait->u.wait.packet, TRUE ) == STATUS_SUCCESS)
+        tp_object_release( wait );
+}
+
+/***********************************************************************
+ *           waitqueue_trigger    (internal)
+ *
+ * Runs or submits the callback of a signaled or timed out wait object
+ * serviced through the waitqueue port, waitqueue.cs has to be held.
+ */
+static void waitqueue_trigger( struct threadpool_object *wait, BOOL signaled )
+{
+    assert( wait->u.wait.wait_pending );
+
+    if ((wait->u.wait.flags & WT_EXECUTEONLYONCE))
+    {
+        waitqueue_cancel_packet( wait );
+        waitqueue_heap_remove( wait );
+        wait->u.wait.wait_pending = FALSE;
+    }
+    else
+    {
+        waitqueue_rearm( wait, signaled );
+        waitqueue_heap_update( wait );
+
+        if (!wait->u.wait.associated && waitqueue_associate_packet( wait ))
+            WARN( "failed to wait again for %p\n", wait->u.wait.handle );
+    }
+
+    /* WT_EXECUTEINWAITTHREAD waits always use a bucket, the callbacks of
+     * packet waits run in the pool. */
+    tp_object_submit( wait, signaled );
+}
+
+/***********************************************************************
+ *           waitqueue_port_thread_proc    (internal)
+ *
+ * Services the wait objects associated with wait completion packets. The
+ * server queues a completion for each signaled object, and timeouts are
+ * kept in a heap, so the cost per event doesn't grow with the number of
+ * wait objects.
+ */
+static void CALLBACK waitqueue_port_thread_proc( void *param )
+{
+    FILE_IO_COMPLETION_INFORMATION entries[64];
+    struct threadpool_object *wait;
+    LARGE_INTEGER now, timeout;
+    ULONG i, count;
+    NTSTATUS status;
+
+    TRACE( "starting wait queue port thread\n" );
+    set_thread_name(L"wine_threadpool_waitqueue");
 
     RtlEnterCriticalSection( &waitqueue.cs );
 
+    for (;;)
+    {
+        NtQuerySystemTime( &now );
+        while (waitqueue.heap_count && waitqueue.heap[0]->u.wait.timeout <= now.QuadPart)
+            waitqueue_trigger( waitqueue.heap[0], FALSE );
+
+        if (waitqueue.heap_count) timeout.QuadPart = waitqueue.heap[0]->u.wait.timeout;
+        else if (waitqueue.objcount) timeout.QuadPart = MAXLONGLONG;
+        else timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
+
+        RtlLeaveCriticalSection( &waitqueue.cs );
+        status = NtRemoveIoCompletionEx( waitqueue.port, entries, ARRAY_SIZE(entries), &count,
+                                         timeout.QuadPart == MAXLONGLONG ? NULL : &timeout, FALSE );
+        RtlEnterCriticalSection( &waitqueue.cs );
+
+        if (status == STATUS_TIMEOUT && !waitqueue.objcount) break;
+        if (status) continue;
+
+        for (i = 0; i < count; i++)
+        {
+            if (!(wait = (struct threadpool_object *)entries[i].CompletionKey)) continue;
+            assert( wait->type == TP_OBJECT_TYPE_WAIT );
+
+            if (wait->u.wait.associated && (LONG)entries[i].CompletionValue == wait->update_serial)
+            {
+                /* Wait object signaled. */
+                wait->u.wait.associated = FALSE;
+                waitqueue_trigger( wait, TRUE );
+            }
+            else TRACE( "ignoring completion for updated wait object %p\n", wait );
+
+            /* Release the reference held by the completion. */
+            tp_object_release( wait );
+        }
+    }
+
+    waitqueue.thread_running = FALSE;
+    RtlLeaveCriticalSection( &waitqueue.cs );
+
+    TRACE( "terminating wait queue port thread\n" );
+    RtlExitUserThread( 0 );
+}
+
+/***********************************************************************
+ *           tp_waitqueue_reserve_packet    (internal)
+ *
+ * Sets up a wait object to be serviced through the waitqueue port,
+ * waitqueue.cs has to be held.
+ */
+static NTSTATUS tp_waitqueue_reserve_packet( struct threadpool_object *wait )
+{
+    NTSTATUS status;
+    HANDLE thread;
+
+    if (waitqueue.objcount >= waitqueue.heap_size)
+    {
+        unsigned int new_size = max( 16, waitqueue.heap_size * 2 );
+        struct threadpool_object **heap;
+
+        if (waitqueue.heap)
+            heap = RtlReAllocateHeap( GetProcessHeap(), 0, waitqueue.heap, new_size * sizeof(*heap) );
+        else
+            heap = RtlAllocateHeap( GetProcessHeap(), 0, new_size * sizeof(*heap) );
+        if (!heap) return STATUS_NO_MEMORY;
+
+        waitqueue.heap = heap;
+        waitqueue.heap_size = new_size;
+    }
+
+    if (!waitqueue.port && (status = NtCreateIoCompletion( &waitqueue.port, IO_COMPLETION_ALL_ACCESS, NULL, 0 )))
+        return status;
+
+    if ((status = NtCreateWaitCompletionPacket( &wait->u.wait.packet, GENERIC_ALL, NULL )))
+    {
+        wait->u.wait.packet = NULL;
+        return status;
+    }
+
+    if (!waitqueue.thread_running)
+    {
+        status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0, 0, 0,
+                                      waitqueue_port_thread_proc, NULL, &thread, NULL );
+        if (status)
+        {
+            NtClose( wait->u.wait.packet );
+            wait->u.wait.packet = NULL;
+            return status;
+        }
+        waitqueue.thread_running = TRUE;
+        NtClose( thread );
+    }
+
+    waitqueue.objcount++;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           tp_waitqueue_release_packet    (internal)
+ */
+static void tp_waitqueue_release_packet( struct threadpool_object *wait )
+{
+    waitqueue_cancel_packet( wait );
+    waitqueue_heap_remove( wait );
+    wait->u.wait.wait_pending = FALSE;
+
+    NtClose( wait->u.wait.packet );
+    wait->u.wait.packet = NULL;
+
+    /* Let the thread start its idle timeout. */
+    if (!--waitqueue.objcount) waitqueue_wake();
+}
+
+/***********************************************************************
+ *           tp_waitqueue_reserve_bucket    (internal)
+ *
+ * Assigns a wait object to a bucket thread, waitqueue.cs has to be held.
+ */
+static NTSTATUS tp_waitqueue_reserve_bucket( struct threadpool_object *wait )
+{
+    struct waitqueue_bucket *bucket;
+    NTSTATUS status;
+    HANDLE thread;
+    BOOL alertable = (wait->u.wait.flags & WT_EXECUTEINIOTHREAD) != 0;
+
     /* Try to assign to existing bucket if possible. */
     LIST_FOR_EACH_ENTRY( bucket, &waitqueue.buckets, struct waitqueue_bucket, bucket_entry )
     {
@@ -1449,18 +1838,14 @@ static NTSTATUS tp_waitqueue_lock( struct threadpool_object *wait )
             wait->u.wait.bucket = bucket;
             bucket->objcount++;
 
-            status = STATUS_SUCCESS;
-            goto out;
+            return STATUS_SUCCESS;
         }
     }
 
     /* Create a new bucket and corresponding worker thread. */
     bucket = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*bucket) );
     if (!bucket)
-    {
-        status = STATUS_NO_MEMORY;
-        goto out;
-    }
+        return STATUS_NO_MEMORY;
 
     bucket->objcount = 0;
     bucket->alertable = alertable;
@@ -1472,7 +1857,7 @@ static NTSTATUS tp_waitqueue_lock( struct threadpool_object *wait )
     if (status)
     {
         RtlFreeHeap( GetProcessHeap(), 0, bucket );
-        goto out;
+        return status;
     }
 
     status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0, 0, 0,
@@ -1494,7 +1879,37 @@ static NTSTATUS tp_waitqueue_lock( struct threadpool_object *wait )
         RtlFreeHeap( GetProcessHeap(), 0, bucket );
     }
 
-out:
+    return status;
+}
+
+/***********************************************************************
+ *           tp_waitqueue_lock    (internal)
+ */
+static NTSTATUS tp_waitqueue_lock( struct threadpool_object *wait )
+{
+    NTSTATUS status;
+    assert( wait->type == TP_OBJECT_TYPE_WAIT );
+
+    wait->u.wait.signaled       = 0;
+    wait->u.wait.bucket         = NULL;
+    wait->u.wait.wait_pending   = FALSE;
+    wait->u.wait.timeout        = 0;
+    wait->u.wait.handle         = INVALID_HANDLE_VALUE;
+    wait->u.wait.packet         = NULL;
+    wait->u.wait.associated     = FALSE;
+    wait->u.wait.heap_index     = ~0u;
+    wait->u.wait.interval       = 0;
+
+    RtlEnterCriticalSection( &waitqueue.cs );
+
+    /* Alertable waits need a bucket thread of their own to run APCs, and callbacks
+     * run in the wait thread would all be serialized on the single port thread. */
+    if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)) ||
+        tp_waitqueue_reserve_packet( wait ))
+        status = tp_waitqueue_reserve_bucket( wait );
+    else
+        status = STATUS_SUCCESS;
+
     RtlLeaveCriticalSection( &waitqueue.cs );
     return status;
 }
@@ -1507,7 +1922,9 @@ static void tp_waitqueue_unlock( struct threadpool_object *wait )
     assert( wait->type == TP_OBJECT_TYPE_WAIT );
 
     RtlEnterCriticalSection( &waitqueue.cs );
-    if (wait->u.wait.bucket)
+    if (wait->u.wait.packet)
+        tp_waitqueue_release_packet( wait );
+    else if (wait->u.wait.bucket)
     {
         struct waitqueue_bucket *bucket = wait->u.wait.bucket;
         assert( bucket->objcount > 0 );
@@ -1549,7 +1966,7 @@ static void CALLBACK ioqueue_thread_proc( void *param )
 
         if (io && (io->shutdown || io->u.io.shutting_down))
         {
-            RtlEnterCriticalSection( &io->pool->cs );
+            RtlEnterCriticalSection( &io->queue->cs );
             if (!io->u.io.pending_count)
             {
                 if (io->u.io.skipped_count)
@@ -1560,7 +1977,7 @@ static void CALLBACK ioqueue_thread_proc( void *param )
                 else
                     destroy = TRUE;
             }
-            RtlLeaveCriticalSection( &io->pool->cs );
+            RtlLeaveCriticalSection( &io->queue->cs );
             if (skip) continue;
         }
 
@@ -1573,7 +1990,7 @@ static void CALLBACK ioqueue_thread_proc( void *param )
         }
         else if (io)
         {
-            RtlEnterCriticalSection( &io->pool->cs );
+            RtlEnterCriticalSection( &io->queue->cs );
 
             TRACE( "pending_count %u.\n", io->u.io.pending_count );
 
@@ -1584,7 +2001,7 @@ static void CALLBACK ioqueue_thread_proc( void *param )
                         io->u.io.completion_count + 1, sizeof(*io->u.io.completions)))
                 {
                     ERR( "Failed to allocate memory.\n" );
-                    RtlLeaveCriticalSection( &io->pool->cs );
+                    RtlLeaveCriticalSection( &io->queue->cs );
                     continue;
                 }
 
@@ -1594,7 +2011,7 @@ static void CALLBACK ioqueue_thread_proc( void *param )
 
                 tp_object_submit( io, FALSE );
             }
-            RtlLeaveCriticalSection( &io->pool->cs );
+            RtlLeaveCriticalSection( &io->queue->cs );
         }
 
         if (!ioqueue.objcount)
@@ -1673,13 +2090,23 @@ static NTSTATUS tp_ioqueue_lock( struct threadpool_object *io, HANDLE file )
 static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
 {
     IMAGE_NT_HEADERS *nt = RtlImageNtHeader( NtCurrentTeb()->Peb->ImageBaseAddress );
+    unsigned int num_queues = NtCurrentTeb()->Peb->NumberOfProcessors;
     struct threadpool *pool;
-    unsigned int i;
+    unsigned int i, j;
+
+    num_queues = max( 1, min( num_queues, THREADPOOL_MAX_QUEUES ) );
 
     pool = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*pool) );
     if (!pool)
         return STATUS_NO_MEMORY;
 
+    pool->queues = RtlAllocateHeap( GetProcessHeap(), 0, num_queues * sizeof(*pool->queues) );
+    if (!pool->queues)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, pool );
+        return STATUS_NO_MEMORY;
+    }
+
     pool->refcount              = 1;
     pool->objcount              = 0;
     pool->shutdown              = FALSE;
@@ -1687,9 +2114,21 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     RtlInitializeCriticalSectionEx( &pool->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
     pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool.cs");
 
-    for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
-        list_init( &pool->pools[i] );
-    RtlInitializeConditionVariable( &pool->update_event );
+    pool->num_queues = num_queues;
+    pool->next_queue = 0;
+    for (i = 0; i < num_queues; ++i)
+    {
+        struct threadpool_queue *queue = &pool->queues[i];
+
+        RtlInitializeCriticalSectionEx( &queue->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+        queue->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool_queue.cs");
+        for (j = 0; j < ARRAY_SIZE(queue->pools); ++j)
+            list_init( &queue->pools[j] );
+    }
+    for (i = 0; i < ARRAY_SIZE(pool->num_queued); ++i)
+        pool->num_queued[i] = 0;
+    pool->worker_serial = 0;
+    pool->num_idle_workers = 0;
 
     pool->max_workers             = 500;
     pool->min_workers             = 0;
@@ -1716,7 +2155,8 @@ static void tp_threadpool_shutdown( struct threadpool *pool )
     assert( pool != default_threadpool );
 
     pool->shutdown = TRUE;
-    RtlWakeAllConditionVariable( &pool->update_event );
+    InterlockedIncrement( &pool->worker_serial );
+    RtlWakeAddressAll( &pool->worker_serial );
 }
 
 /***********************************************************************
@@ -1726,7 +2166,7 @@ static void tp_threadpool_shutdown( struct threadpool *pool )
  */
 static BOOL tp_threadpool_release( struct threadpool *pool )
 {
-    unsigned int i;
+    unsigned int i, j;
 
     if (InterlockedDecrement( &pool->refcount ))
         return FALSE;
@@ -1735,12 +2175,21 @@ static BOOL tp_threadpool_release( struct threadpool *pool )
 
     assert( pool->shutdown );
     assert( !pool->objcount );
-    for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
-        assert( list_empty( &pool->pools[i] ) );
+    for (i = 0; i < pool->num_queues; ++i)
+    {
+        struct threadpool_queue *queue = &pool->queues[i];
+
+        for (j = 0; j < ARRAY_SIZE(queue->pools); ++j)
+            assert( list_empty( &queue->pools[j] ) );
+
+        queue->cs.DebugInfo->Spare[0] = 0;
+        RtlDeleteCriticalSection( &queue->cs );
+    }
 
     pool->cs.DebugInfo->Spare[0] = 0;
     RtlDeleteCriticalSection( &pool->cs );
 
+    RtlFreeHeap( GetProcessHeap(), 0, pool->queues );
     RtlFreeHeap( GetProcessHeap(), 0, pool );
     return TRUE;
 }
@@ -1905,6 +2354,7 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
     object->shutdown                = FALSE;
 
     object->pool                    = pool;
+    object->queue                   = &pool->queues[(ULONG)InterlockedIncrement( &pool->next_queue ) % pool->num_queues];
     object->group                   = NULL;
     object->userdata                = userdata;
     object->group_cancel_callback   = NULL;
@@ -1940,7 +2390,7 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
             TP_CALLBACK_ENVIRON_V3 *environment_v3 = (TP_CALLBACK_ENVIRON_V3 *)environment;
 
             object->priority = environment_v3->CallbackPriority;
-            assert( object->priority < ARRAY_SIZE(pool->pools) );
+            assert( object->priority < ARRAY_SIZE(pool->num_queued) );
         }
 
         if (environment->ActivationContext)
@@ -1979,8 +2429,9 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
 
 static void tp_object_prio_queue( struct threadpool_object *object )
 {
-    ++object->pool->num_busy_workers;
-    list_add_tail( &object->pool->pools[object->priority], &object->pool_entry );
+    InterlockedIncrement( &object->pool->num_busy_workers );
+    list_add_tail( &object->queue->pools[object->priority], &object->pool_entry );
+    InterlockedIncrement( &object->pool->num_queued[object->priority] );
 }
 
 /***********************************************************************
@@ -1992,17 +2443,12 @@ static void tp_object_prio_queue( struct threadpool_object *object )
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
-    NTSTATUS status = STATUS_UNSUCCESSFUL;
+    struct threadpool_queue *queue = object->queue;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
-    RtlEnterCriticalSection( &pool->cs );
-
-    /* Start new worker threads if required. */
-    if (pool->num_busy_workers >= pool->num_workers &&
-        pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
+    RtlEnterCriticalSection( &queue->cs );
 
     /* Queue work item and increment refcount. */
     InterlockedIncrement( &object->refcount );
@@ -2013,14 +2459,9 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
     if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
         object->u.wait.signaled++;
 
-    /* No new thread started - wake up one existing thread. */
-    if (status != STATUS_SUCCESS)
-    {
-        assert( pool->num_workers > 0 );
-        RtlWakeConditionVariable( &pool->update_event );
-    }
+    RtlLeaveCriticalSection( &queue->cs );
 
-    RtlLeaveCriticalSection( &pool->cs );
+    tp_threadpool_wake( pool );
 }
 
 /***********************************************************************
@@ -2030,15 +2471,16 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
  */
 static void tp_object_cancel( struct threadpool_object *object )
 {
-    struct threadpool *pool = object->pool;
+    struct threadpool_queue *queue = object->queue;
     LONG pending_callbacks = 0;
 
-    RtlEnterCriticalSection( &pool->cs );
+    RtlEnterCriticalSection( &queue->cs );
     if (object->num_pending_callbacks)
     {
         pending_callbacks = object->num_pending_callbacks;
         object->num_pending_callbacks = 0;
         list_remove( &object->pool_entry );
+        InterlockedDecrement( &object->pool->num_queued[object->priority] );
 
         if (object->type == TP_OBJECT_TYPE_WAIT)
             object->u.wait.signaled = 0;
@@ -2048,7 +2490,7 @@ static void tp_object_cancel( struct threadpool_object *object )
         object->u.io.skipped_count += object->u.io.pending_count;
         object->u.io.pending_count = 0;
     }
-    RtlLeaveCriticalSection( &pool->cs );
+    RtlLeaveCriticalSection( &queue->cs );
 
     while (pending_callbacks--)
         tp_object_release( object );
@@ -2075,17 +2517,17 @@ static BOOL object_is_finished( struct threadpool_object *object, BOOL group )
  */
 static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
 {
-    struct threadpool *pool = object->pool;
+    struct threadpool_queue *queue = object->queue;
 
-    RtlEnterCriticalSection( &pool->cs );
+    RtlEnterCriticalSection( &queue->cs );
     while (!object_is_finished( object, group_wait ))
     {
         if (group_wait)
-            RtlSleepConditionVariableCS( &object->group_finished_event, &pool->cs, NULL );
+            RtlSleepConditionVariableCS( &object->group_finished_event, &queue->cs, NULL );
         else
-            RtlSleepConditionVariableCS( &object->finished_event, &pool->cs, NULL );
+            RtlSleepConditionVariableCS( &object->finished_event, &queue->cs, NULL );
     }
-    RtlLeaveCriticalSection( &pool->cs );
+    RtlLeaveCriticalSection( &queue->cs );
 }
 
 static void tp_ioqueue_unlock( struct threadpool_object *io )
@@ -2162,24 +2604,53 @@ static BOOL tp_object_release( struct threadpool_object *object )
     return TRUE;
 }
 
-static struct list *threadpool_get_next_item( const struct threadpool *pool )
+/***********************************************************************
+ *           threadpool_get_next_item    (internal)
+ *
+ * Dequeues the next object to execute, looking at the worker's own queue
+ * first and stealing from the other queues otherwise, while still honoring
+ * the callback priorities. Returns with object->queue->cs held.
+ */
+static struct threadpool_object *threadpool_get_next_item( struct threadpool *pool, unsigned int home )
 {
+    struct threadpool_object *object;
+    struct threadpool_queue *queue;
+    unsigned int i, priority;
     struct list *ptr;
-    unsigned int i;
 
-    for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
+    for (priority = 0; priority < ARRAY_SIZE(pool->num_queued); ++priority)
     {
-        if ((ptr = list_head( &pool->pools[i] )))
-            break;
+        for (i = 0; i < pool->num_queues; ++i)
+        {
+            if (!ReadNoFence( &pool->num_queued[priority] )) break;
+
+            queue = &pool->queues[(home + i) % pool->num_queues];
+            RtlEnterCriticalSection( &queue->cs );
+            if ((ptr = list_head( &queue->pools[priority] )))
+            {
+                object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
+                assert( object->num_pending_callbacks > 0 );
+
+                /* If further pending callbacks are queued, move the work item to
+                 * the end of the pool list. Otherwise remove it from the pool. */
+                list_remove( &object->pool_entry );
+                InterlockedDecrement( &pool->num_queued[priority] );
+                if (object->num_pending_callbacks > 1)
+                    tp_object_prio_queue( object );
+
+                return object;
+            }
+            RtlLeaveCriticalSection( &queue->cs );
+        }
     }
 
-    return ptr;
+    return NULL;
 }
 
 /***********************************************************************
  *           tp_object_execute    (internal)
  *
- * Executes a threadpool object callback, object->pool->cs has to be
+ * Executes a threadpool object callback, object->queue->cs has to be
  * held.
  */
 static void tp_object_execute( struct threadpool_object *object, BOOL wait_thread )
@@ -2187,7 +2658,7 @@ static void tp_object_execute( struct threadpool_object *object, BOOL wait_threa
     TP_CALLBACK_INSTANCE *callback_instance;
     struct threadpool_instance instance;
     struct io_completion completion;
-    struct threadpool *pool = object->pool;
+    struct threadpool_queue *queue = object->queue;
     TP_WAIT_RESULT wait_result = 0;
     NTSTATUS status;
 
@@ -2208,7 +2679,7 @@ static void tp_object_execute( struct threadpool_object *object, BOOL wait_threa
     /* Leave critical section and do the actual callback. */
     object->num_associated_callbacks++;
     object->num_running_callbacks++;
-    RtlLeaveCriticalSection( &pool->cs );
+    RtlLeaveCriticalSection( &queue->cs );
     if (wait_thread) RtlLeaveCriticalSection( &waitqueue.cs );
 
     /* Initialize threadpool instance struct. */
@@ -2314,7 +2785,7 @@ static void tp_object_execute( struct threadpool_object *object, BOOL wait_threa
 
 skip_cleanup:
     if (wait_thread) RtlEnterCriticalSection( &waitqueue.cs );
-    RtlEnterCriticalSection( &pool->cs );
+    RtlEnterCriticalSection( &queue->cs );
 
     /* Simple callbacks are automatically shutdown after execution. */
     if (object->type == TP_OBJECT_TYPE_SIMPLE)
@@ -2341,53 +2812,74 @@ skip_cleanup:
 static void CALLBACK threadpool_worker_proc( void *param )
 {
     struct threadpool *pool = param;
+    struct threadpool_object *object;
     LARGE_INTEGER timeout;
-    struct list *ptr;
+    unsigned int home;
+    NTSTATUS status;
+    LONG serial;
 
     TRACE( "starting worker thread for pool %p\n", pool );
     set_thread_name(L"wine_threadpool_worker");
 
-    RtlEnterCriticalSection( &pool->cs );
+    home = (ULONG)InterlockedIncrement( &pool->next_queue ) % pool->num_queues;
+
     for (;;)
     {
-        while ((ptr = threadpool_get_next_item( pool )))
+        while ((object = threadpool_get_next_item( pool, home )))
         {
-            struct threadpool_object *object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
-            assert( object->num_pending_callbacks > 0 );
-
-            /* If further pending callbacks are queued, move the work item to
-             * the end of the pool list. Otherwise remove it from the pool. */
-            list_remove( &object->pool_entry );
-            if (object->num_pending_callbacks > 1)
-                tp_object_prio_queue( object );
-
             tp_object_execute( object, FALSE );
+            RtlLeaveCriticalSection( &object->queue->cs );
 
             assert(pool->num_busy_workers);
-            pool->num_busy_workers--;
+            InterlockedDecrement( &pool->num_busy_workers );
 
             tp_object_release( object );
         }
 
         /* Shutdown worker thread if requested. */
         if (pool->shutdown)
+        {
+            RtlEnterCriticalSection( &pool->cs );
+            InterlockedDecrement( &pool->num_workers );
+            RtlLeaveCriticalSection( &pool->cs );
             break;
+        }
+
+        /* Park until new tasks are queued. Submitters bump worker_serial after
+         * queuing, so either the checks below see the new task or the wait
+         * returns immediately. */
+        serial = ReadNoFence( &pool->worker_serial );
+        InterlockedIncrement( &pool->num_idle_workers );
+        if (tp_threadpool_has_work( pool ) || pool->shutdown)
+        {
+            InterlockedDecrement( &pool->num_idle_workers );
+            continue;
+        }
 
-        /* Wait for new tasks or until the timeout expires. A thread only terminates
-         * when no new tasks are available, and the number of threads can be
-         * decreased without violating the min_workers limit. An exception is when
-         * min_workers == 0, then objcount is used to detect if the last thread
-         * can be terminated. */
         timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
-        if (RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout ) == STATUS_TIMEOUT &&
-            !threadpool_get_next_item( pool ) && (pool->num_workers > max( pool->min_workers, 1 ) ||
-            (!pool->min_workers && !pool->objcount)))
+        status = RtlWaitOnAddress( &pool->worker_serial, &serial, sizeof(serial), &timeout );
+        InterlockedDecrement( &pool->num_idle_workers );
+        if (status != STATUS_TIMEOUT) continue;
+
+        /* A thread only terminates when no new tasks are available, and the number of
+         * threads can be decreased without violating the min_workers limit. An exception
+         * is when min_workers == 0, then objcount is used to detect if the last thread
+         * can be terminated. The worker count is decreased before looking for work, so
+         * that concurrent submitters either see it gone or their task is found here. */
+        RtlEnterCriticalSection( &pool->cs );
+        if (pool->num_workers > max( pool->min_workers, 1 ) ||
+            (!pool->min_workers && !pool->objcount))
         {
-            break;
+            InterlockedDecrement( &pool->num_workers );
+            if (!tp_threadpool_has_work( pool ))
+            {
+                RtlLeaveCriticalSection( &pool->cs );
+                break;
+            }
+            InterlockedIncrement( &pool->num_workers );
         }
+        RtlLeaveCriticalSection( &pool->cs );
     }
-    pool->num_workers--;
-    RtlLeaveCriticalSection( &pool->cs );
 
     TRACE( "terminating worker thread for pool %p\n", pool );
     tp_threadpool_release( pool );
@@ -2587,7 +3079,7 @@ void WINAPI TpCancelAsyncIoOperation( TP_IO *io )
 
     TRACE( "%p\n", io );
 
-    RtlEnterCriticalSection( &this->pool->cs );
+    RtlEnterCriticalSection( &this->queue->cs );
 
     TRACE("pending_count %u.\n", this->u.io.pending_count);
 
@@ -2597,7 +3089,7 @@ void WINAPI TpCancelAsyncIoOperation( TP_IO *io )
     if (object_is_finished( this, FALSE ))
         RtlWakeAllConditionVariable( &this->finished_event );
 
-    RtlLeaveCriticalSection( &this->pool->cs );
+    RtlLeaveCriticalSection( &this->queue->cs );
 }
 
 /***********************************************************************
@@ -2717,7 +3209,7 @@ VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
 {
     struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
     struct threadpool_object *object = this->object;
-    struct threadpool *pool;
+    struct threadpool_queue *queue;
 
     TRACE( "%p\n", instance );
 
@@ -2730,14 +3222,14 @@ VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
     if (!this->associated)
         return;
 
-    pool = object->pool;
-    RtlEnterCriticalSection( &pool->cs );
+    queue = object->queue;
+    RtlEnterCriticalSection( &queue->cs );
 
     object->num_associated_callbacks--;
     if (object_is_finished( object, FALSE ))
         RtlWakeAllConditionVariable( &object->finished_event );
 
-    RtlLeaveCriticalSection( &pool->cs );
+    RtlLeaveCriticalSection( &queue->cs );
     this->associated = FALSE;
 }
 
@@ -2861,10 +3353,10 @@ void WINAPI TpReleaseIoCompletion( TP_IO *io )
 
     TRACE( "%p\n", io );
 
-    RtlEnterCriticalSection( &this->pool->cs );
+    RtlEnterCriticalSection( &this->queue->cs );
     this->u.io.shutting_down = TRUE;
     can_destroy = !this->u.io.pending_count && !this->u.io.skipped_count;
-    RtlLeaveCriticalSection( &this->pool->cs );
+    RtlLeaveCriticalSection( &this->queue->cs );
 
     if (can_destroy)
     {
@@ -3058,40 +3550,70 @@ VOID WINAPI TpSetWait( TP_WAIT *wait, HANDLE handle, LARGE_INTEGER *timeout )
 {
     struct threadpool_object *this = impl_from_TP_WAIT( wait );
     ULONGLONG timestamp = MAXLONGLONG;
+    LONGLONG interval = 0;
     BOOL same_handle;
 
     TRACE( "%p %p %p\n", wait, handle, timeout );
 
     RtlEnterCriticalSection( &waitqueue.cs );
 
-    assert( this->u.wait.bucket );
+    /* Convert relative timeout to absolute timestamp. */
+    if (handle && timeout)
+    {
+        timestamp = timeout->QuadPart;
+        if ((LONGLONG)timestamp < 0)
+        {
+            LARGE_INTEGER now;
+            NtQuerySystemTime( &now );
+            interval = -timeout->QuadPart;
+            timestamp = now.QuadPart - timestamp;
+        }
+    }
 
     same_handle = this->u.wait.handle == handle;
     this->u.wait.handle = handle;
 
-    if (handle || this->u.wait.wait_pending)
+    if (this->u.wait.packet && (handle || this->u.wait.wait_pending))
     {
-        struct waitqueue_bucket *bucket = this->u.wait.bucket;
-        list_remove( &this->u.wait.wait_entry );
+        if (!same_handle || !handle) waitqueue_cancel_packet( this );
 
-        /* Convert relative timeout to absolute timestamp. */
-        if (handle && timeout)
+        this->u.wait.wait_pending = handle != NULL;
+        this->u.wait.timeout = handle ? timestamp : MAXLONGLONG;
+        this->u.wait.interval = interval;
+
+        if (!handle || this->u.wait.associated || !waitqueue_associate_packet( this ))
         {
-            timestamp = timeout->QuadPart;
-            if ((LONGLONG)timestamp < 0)
-            {
-                LARGE_INTEGER now;
-                NtQuerySystemTime( &now );
-                timestamp = now.QuadPart - timestamp;
-            }
+            /* Wake up the wait queue thread if the next timeout changed. */
+            if (waitqueue_heap_update( this ))
+                waitqueue_wake();
+            goto done;
         }
 
+        /* The object can't be waited for through a packet, fall back to a bucket thread. */
+        TRACE( "using a bucket thread for %p\n", handle );
+        tp_waitqueue_release_packet( this );
+        if (tp_waitqueue_reserve_bucket( this ))
+        {
+            ERR( "failed to reserve a wait bucket for %p\n", this );
+            goto done;
+        }
+    }
+
+    if (!this->u.wait.bucket)
+        goto done;
+
+    if (handle || this->u.wait.wait_pending)
+    {
+        struct waitqueue_bucket *bucket = this->u.wait.bucket;
+        list_remove( &this->u.wait.wait_entry );
+
         /* Add wait object back into one of the queues. */
         if (handle)
         {
             list_add_tail( &bucket->waiting, &this->u.wait.wait_entry );
             this->u.wait.wait_pending = TRUE;
             this->u.wait.timeout = timestamp;
+            this->u.wait.interval = interval;
         }
         else
         {
@@ -3105,6 +3627,7 @@ VOID WINAPI TpSetWait( TP_WAIT *wait, HANDLE handle, LARGE_INTEGER *timeout )
         NtSetEvent( bucket->update_event, NULL );
     }
 
+done:
     RtlLeaveCriticalSection( &waitqueue.cs );
 }
 
@@ -3147,11 +3670,11 @@ void WINAPI TpStartAsyncIoOperation( TP_IO *io )
 
     TRACE( "%p\n", io );
 
-    RtlEnterCriticalSection( &this->pool->cs );
+    RtlEnterCriticalSection( &this->queue->cs );
 
     this->u.io.pending_count++;
 
-    RtlLeaveCriticalSection( &this->pool->cs );
+    RtlLeaveCriticalSection( &this->queue->cs );
 }
 
 /***********************************************************************
@@ -3343,11 +3866,11 @@ NTSTATUS WINAPI RtlDeregisterWaitEx( HANDLE handle, HANDLE event )
         object->completed_event = event;
     }
 
-    RtlEnterCriticalSection( &object->pool->cs );
+    RtlEnterCriticalSection( &object->queue->cs );
     if (object->num_pending_callbacks + object->num_running_callbacks
         + object->num_associated_callbacks) status = STATUS_PENDING;
     else status = STATUS_SUCCESS;
-    RtlLeaveCriticalSection( &object->pool->cs );
+    RtlLeaveCriticalSection( &object->queue->cs );
 
     TpReleaseWait( (TP_WAIT *)object );
     return status;
@@ -0,0 +1,494 @@
+/*
+ * Fast synchronization objects
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * When the server has been started with WINEFASTSYNC set, the events, semaphores and
+ * mutexes created by the process keep their state in a section only shared with the
+ * server. Signaling them and waiting on them is then done here with atomic operations
+ * and futexes, without any server round trip. The server is only told when one of its
+ * own waits needs to be woken up. Every function returns STATUS_NOT_IMPLEMENTED when the
+ * operation has to go through the server instead, which is always the case for the
+ * objects created by other processes.
+ */
+
+#if 0
+#pragma makedep unix
+#endif
+
+#include "config.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef __linux__
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+#include "wine/server.h"
+#include "wine/debug.h"
+#include "unix_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(sync);
+
+#ifdef __linux__
+
+#ifndef __NR_futex_waitv
+#define __NR_futex_waitv 449
+#endif
+
+#ifndef FUTEX2_SIZE_U32
+#define FUTEX2_SIZE_U32 0x02
+#endif
+
+/* struct futex_waitv, which older kernel headers don't have */
+struct futex_waiter
+{
+    ULONG64 val;
+    ULONG64 uaddr;
+    UINT    flags;
+    UINT    reserved;
+};
+
+struct futex_timespec
+{
+    LONGLONG tv_sec;
+    LONGLONG tv_nsec;
+};
+
+/* section of the process objects, set once at startup before any other thread runs */
+static fast_sync_shm_t *fast_sync_objects;
+
+/***********************************************************************
+ *           fast_sync_init
+ */
+void fast_sync_init(void)
+{
+    if (syscall( __NR_futex_waitv, NULL, 0, 0, NULL, 0 ) == -1 && errno == ENOSYS)
+    {
+        WARN( "futex_waitv not supported, fast sync disabled\n" );
+        return;
+    }
+    fast_sync_objects = server_map_fast_sync();
+    TRACE( "objects at %p\n", fast_sync_objects );
+}
+
+static inline void futex_wake_all( fast_sync_shm_t *obj )
+{
+    /* the futex is shared between processes, it can't be private */
+    syscall( __NR_futex, &obj->state, FUTEX_WAKE, INT_MAX, NULL, 0, 0 );
+}
+
+struct fast_sync_obj
+{
+    HANDLE           handle;
+    fast_sync_shm_t *shm;
+    int              type;
+    unsigned int     access;
+};
+
+static NTSTATUS get_fast_sync_obj( HANDLE handle, struct fast_sync_obj *obj )
+{
+    unsigned int index;
+    NTSTATUS status;
+
+    if (!fast_sync_objects) return STATUS_NOT_IMPLEMENTED;
+
+    if ((status = server_get_fast_sync_obj( handle, fast_sync_objects, &index, &obj->type, &obj->access )))
+        return status;
+    obj->handle = handle;
+    obj->shm = fast_sync_objects + index;
+
+    /* the object has been destroyed under us, let the server report the closed handle */
+    if (obj->shm->type != obj->type) return STATUS_NOT_IMPLEMENTED;
+    return STATUS_SUCCESS;
+}
+
+/* wake up the server side waits on an object, if there's any */
+static void wake_server_waiters( struct fast_sync_obj *obj )
+{
+    if (!__atomic_load_n( &obj->shm->waiters, __ATOMIC_SEQ_CST )) return;
+
+    SERVER_START_REQ( wake_fast_sync_obj )
+    {
+        req->handle = wine_server_obj_handle( obj->handle );
+        wine_server_call( req );
+    }
+    SERVER_END_REQ;
+}
+
+static inline unsigned int current_tid(void)
+{
+    return HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+}
+
+static int is_signaled( fast_sync_shm_t *shm, int state, unsigned int tid )
+{
+    if (shm->type == FAST_SYNC_MUTEX) return !state || state == (int)tid;
+    return state > 0;
+}
+
+/* try to acquire an object, state being its last known state */
+static NTSTATUS try_acquire( fast_sync_shm_t *shm, int state, unsigned int tid )
+{
+    switch (shm->type)
+    {
+    case FAST_SYNC_EVENT:
+        if (state <= 0) return STATUS_PENDING;
+        if (shm->param) return STATUS_SUCCESS;
+        if (__atomic_compare_exchange_n( &shm->state, &state, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ))
+            return STATUS_SUCCESS;
+        return STATUS_PENDING;
+
+    case FAST_SYNC_SEMAPHORE:
+        while (state > 0)
+        {
+            if (__atomic_compare_exchange_n( &shm->state, &state, state - 1, 0,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ))
+                return STATUS_SUCCESS;
+        }
+        return STATUS_PENDING;
+
+    case FAST_SYNC_MUTEX:
+        if (state == (int)tid)
+        {
+            if (__atomic_load_n( &shm->param, __ATOMIC_SEQ_CST ) == INT_MAX) return STATUS_MUTANT_LIMIT_EXCEEDED;
+            __atomic_fetch_add( &shm->param, 1, __ATOMIC_SEQ_CST );
+            return STATUS_SUCCESS;
+        }
+        if (state || !__atomic_compare_exchange_n( &shm->state, &state, (int)tid, 0,
+                                                   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ))
+            return STATUS_PENDING;
+        __atomic_store_n( &shm->param, 1, __ATOMIC_SEQ_CST );
+        if (__atomic_exchange_n( &shm->abandoned, 0, __ATOMIC_SEQ_CST )) return STATUS_ABANDONED;
+        return STATUS_SUCCESS;
+    }
+    return STATUS_INVALID_HANDLE;
+}
+
+/* check if an event pulse releases the wait, an auto-reset event only releases one */
+static BOOL claim_pulse( fast_sync_shm_t *shm )
+{
+    int wake = 1;
+
+    if (shm->param) return TRUE;
+    return __atomic_compare_exchange_n( &shm->pulse_wake, &wake, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+}
+
+/* undo try_acquire, when a wait all couldn't acquire all its objects */
+static void release_acquired( struct fast_sync_obj *obj )
+{
+    fast_sync_shm_t *shm = obj->shm;
+
+    switch (shm->type)
+    {
+    case FAST_SYNC_EVENT:
+        if (shm->param) return;
+        __atomic_store_n( &shm->state, 1, __ATOMIC_SEQ_CST );
+        break;
+    case FAST_SYNC_SEMAPHORE:
+        __atomic_fetch_add( &shm->state, 1, __ATOMIC_SEQ_CST );
+        break;
+    case FAST_SYNC_MUTEX:
+        if (__atomic_sub_fetch( &shm->param, 1, __ATOMIC_SEQ_CST )) return;
+        __atomic_store_n( &shm->state, 0, __ATOMIC_SEQ_CST );
+        break;
+    }
+    futex_wake_all( shm );
+    wake_server_waiters( obj );
+}
+
+/* convert an NT timeout to an absolute futex timeout, returns the futex clock flag */
+static int get_futex_timeout( const LARGE_INTEGER *timeout, struct futex_timespec *ts )
+{
+    LONGLONG ticks = timeout->QuadPart;
+    struct timespec now;
+    int clock;
+
+    if (ticks < 0)
+    {
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        ticks = now.tv_sec * (LONGLONG)TICKSPERSEC + now.tv_nsec / 100 - ticks;
+        clock = CLOCK_MONOTONIC;
+    }
+    else
+    {
+        ticks = max( ticks - SECS_1601_TO_1970 * TICKSPERSEC, 0 );
+        clock = CLOCK_REALTIME;
+    }
+    ts->tv_sec = ticks / TICKSPERSEC;
+    ts->tv_nsec = (ticks % TICKSPERSEC) * 100;
+    return clock;
+}
+
+static NTSTATUS wait_objects( DWORD count, struct fast_sync_obj *objs, BOOLEAN wait_any,
+                              const LARGE_INTEGER *timeout )
+{
+    /* events are also waited on through their pulse count, as a pulse doesn't leave them signaled */
+    struct futex_waiter futexes[2 * MAXIMUM_WAIT_OBJECTS];
+    int states[MAXIMUM_WAIT_OBJECTS], pulses[MAXIMUM_WAIT_OBJECTS];
+    struct futex_timespec ts;
+    unsigned int tid = current_tid();
+    int clock = CLOCK_MONOTONIC, pulse;
+    DWORD i, j, nr_futexes;
+    BOOL abandoned;
+    NTSTATUS status;
+
+    if (timeout && timeout->QuadPart) clock = get_futex_timeout( timeout, &ts );
+
+    for (i = 0; i < count; i++) pulses[i] = __atomic_load_n( &objs[i].shm->pulse, __ATOMIC_SEQ_CST );
+
+    for (;;)
+    {
+        for (i = nr_futexes = 0; i < count; i++)
+        {
+            /* pulses are only seen by wait any, we can't tell if the other objects of a wait all
+             * were signaled at the time of the pulse */
+            if (wait_any && objs[i].type == FAST_SYNC_EVENT)
+            {
+                pulse = __atomic_load_n( &objs[i].shm->pulse, __ATOMIC_SEQ_CST );
+                if (pulse != pulses[i] && claim_pulse( objs[i].shm )) return STATUS_WAIT_0 + i;
+                pulses[i] = pulse;
+                futexes[nr_futexes].val = pulse;
+                futexes[nr_futexes].uaddr = (ULONG_PTR)&objs[i].shm->pulse;
+                futexes[nr_futexes].flags = FUTEX2_SIZE_U32;
+                futexes[nr_futexes].reserved = 0;
+                nr_futexes++;
+            }
+            states[i] = __atomic_load_n( &objs[i].shm->state, __ATOMIC_SEQ_CST );
+            futexes[nr_futexes].val = states[i];
+            futexes[nr_futexes].uaddr = (ULONG_PTR)&objs[i].shm->state;
+            futexes[nr_futexes].flags = FUTEX2_SIZE_U32;
+            futexes[nr_futexes].reserved = 0;
+            nr_futexes++;
+            if (objs[i].shm->type != objs[i].type) return STATUS_NOT_IMPLEMENTED;
+        }
+
+        if (wait_any)
+        {
+            for (i = 0; i < count; i++)
+            {
+                status = try_acquire( objs[i].shm, states[i], tid );
+                if (status == STATUS_SUCCESS) return STATUS_WAIT_0 + i;
+                if (status == STATUS_ABANDONED) return STATUS_ABANDONED_WAIT_0 + i;
+                if (status != STATUS_PENDING) return status;
+            }
+        }
+        else
+        {
+            for (i = 0; i < count; i++)
+                if (!is_signaled( objs[i].shm, states[i], tid )) break;
+
+            if (i == count)
+            {
+                abandoned = FALSE;
+                for (i = 0; i < count; i++)
+                {
+                    status = try_acquire( objs[i].shm, states[i], tid );
+                    if (status == STATUS_ABANDONED) abandoned = TRUE;
+                    else if (status) break;
+                }
+                if (i == count) return abandoned ? STATUS_ABANDONED_WAIT_0 : STATUS_WAIT_0;
+
+                /* someone else grabbed one of the objects, give back the others and retry */
+                for (j = 0; j < i; j++) release_acquired( &objs[j] );
+                if (status != STATUS_PENDING) return status;
+                continue;
+            }
+        }
+
+        if (timeout && !timeout->QuadPart) return STATUS_TIMEOUT;
+
+        if (syscall( __NR_futex_waitv, futexes, nr_futexes, 0, timeout ? &ts : NULL, clock ) == -1)
+        {
+            if (errno == ETIMEDOUT) return STATUS_TIMEOUT;
+            if (errno != EAGAIN && errno != EINTR) return errno_to_status( errno );
+        }
+    }
+}
+
+/***********************************************************************
+ *           fast_sync_wait
+ */
+NTSTATUS fast_sync_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any, BOOLEAN alertable,
+                         const LARGE_INTEGER *timeout )
+{
+    struct fast_sync_obj objs[MAXIMUM_WAIT_OBJECTS];
+    NTSTATUS status;
+    DWORD i, j;
+
+    /* user APCs can only be delivered by the server */
+    if (alertable) return STATUS_NOT_IMPLEMENTED;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((status = get_fast_sync_obj( handles[i], &objs[i] ))) return status;
+        if (!(objs[i].access & SYNCHRONIZE)) return STATUS_ACCESS_DENIED;
+        /* let the server report duplicate objects in a wait all */
+        for (j = 0; !wait_any && j < i; j++)
+            if (objs[j].shm == objs[i].shm) return STATUS_NOT_IMPLEMENTED;
+    }
+
+    TRACE( "%u objects, wait_any %u, timeout %s\n", (int)count, wait_any,
+           timeout ? wine_dbgstr_longlong( timeout->QuadPart ) : "(infinite)" );
+    return wait_objects( count, objs, wait_any, timeout );
+}
+
+static NTSTATUS set_event_state( HANDLE handle, int state, LONG *prev_state )
+{
+    struct fast_sync_obj obj;
+    NTSTATUS status;
+    int prev;
+
+    if ((status = get_fast_sync_obj( handle, &obj ))) return status;
+    if (obj.type != FAST_SYNC_EVENT) return STATUS_OBJECT_TYPE_MISMATCH;
+    if (!(obj.access & EVENT_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+
+    prev = __atomic_exchange_n( &obj.shm->state, state, __ATOMIC_SEQ_CST );
+    if (state && !prev)
+    {
+        futex_wake_all( obj.shm );
+        wake_server_waiters( &obj );
+    }
+    if (prev_state) *prev_state = prev;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           fast_sync_set_event
+ */
+NTSTATUS fast_sync_set_event( HANDLE handle, LONG *prev_state )
+{
+    return set_event_state( handle, 1, prev_state );
+}
+
+/***********************************************************************
+ *           fast_sync_reset_event
+ */
+NTSTATUS fast_sync_reset_event( HANDLE handle, LONG *prev_state )
+{
+    return set_event_state( handle, 0, prev_state );
+}
+
+/***********************************************************************
+ *           fast_sync_release_semaphore
+ */
+NTSTATUS fast_sync_release_semaphore( HANDLE handle, ULONG count, ULONG *prev_count )
+{
+    struct fast_sync_obj obj;
+    NTSTATUS status;
+    int state;
+
+    if ((status = get_fast_sync_obj( handle, &obj ))) return status;
+    if (obj.type != FAST_SYNC_SEMAPHORE) return STATUS_OBJECT_TYPE_MISMATCH;
+    if (!(obj.access & SEMAPHORE_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+
+    state = __atomic_load_n( &obj.shm->state, __ATOMIC_SEQ_CST );
+    do
+    {
+        if ((unsigned int)state + count < (unsigned int)state ||
+            (unsigned int)state + count > (unsigned int)obj.shm->param)
+            return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+    }
+    while (!__atomic_compare_exchange_n( &obj.shm->state, &state, state + count, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+
+    if (!state)
+    {
+        futex_wake_all( obj.shm );
+        wake_server_waiters( &obj );
+    }
+    if (prev_count) *prev_count = state;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           fast_sync_release_mutex
+ */
+NTSTATUS fast_sync_release_mutex( HANDLE handle, LONG *prev_count )
+{
+    struct fast_sync_obj obj;
+    NTSTATUS status;
+    int count;
+
+    if ((status = get_fast_sync_obj( handle, &obj ))) return status;
+    if (obj.type != FAST_SYNC_MUTEX) return STATUS_OBJECT_TYPE_MISMATCH;
+
+    if (__atomic_load_n( &obj.shm->state, __ATOMIC_SEQ_CST ) != (int)current_tid()) return STATUS_MUTANT_NOT_OWNED;
+
+    /* the server can still abandon the mutex if the owner is being terminated */
+    count = __atomic_load_n( &obj.shm->param, __ATOMIC_SEQ_CST );
+    do
+    {
+        if (!count) return STATUS_MUTANT_NOT_OWNED;
+    }
+    while (!__atomic_compare_exchange_n( &obj.shm->param, &count, count - 1, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+    if (count == 1)
+    {
+        __atomic_store_n( &obj.shm->state, 0, __ATOMIC_SEQ_CST );
+        futex_wake_all( obj.shm );
+        wake_server_waiters( &obj );
+    }
+    if (prev_count) *prev_count = 1 - count;
+    return STATUS_SUCCESS;
+}
+
+#else  /* __linux__ */
+
+void fast_sync_init(void)
+{
+}
+
+NTSTATUS fast_sync_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any, BOOLEAN alertable,
+                         const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+NTSTATUS fast_sync_set_event( HANDLE handle, LONG *prev_state )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+NTSTATUS fast_sync_reset_event( HANDLE handle, LONG *prev_state )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+NTSTATUS fast_sync_release_semaphore( HANDLE handle, ULONG count, ULONG *prev_count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+NTSTATUS fast_sync_release_mutex( HANDLE handle, LONG *prev_count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif  /* __linux__ */
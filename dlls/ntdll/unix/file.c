@@ -42,6 +42,7 @@
 #include <mntent.h>
 #endif
 #include <poll.h>
+#include <signal.h>
 #include <sys/stat.h>
 #ifdef HAVE_SYS_STATVFS_H
 # include <sys/statvfs.h>
@@ -336,9 +337,9 @@ static inline BOOL has_wildcard( const UNICODE_STRING *mask )
     return FALSE;
 }
 
-NTSTATUS errno_to_status( int err )
+/* no debug output here, it is used by threads that don't have a TEB */
+static NTSTATUS map_errno( int err )
 {
-    TRACE( "errno = %d\n", err );
     switch (err)
     {
     case EAGAIN:    return STATUS_SHARING_VIOLATION;
@@ -372,12 +373,19 @@ NTSTATUS errno_to_status( int err )
 #endif
     case ENOEXEC:   /* ?? */
     case EEXIST:    /* ?? */
-    default:
-        FIXME( "Converting errno %d to STATUS_UNSUCCESSFUL\n", err );
-        return STATUS_UNSUCCESSFUL;
+    default:        return STATUS_UNSUCCESSFUL;
     }
 }
 
+NTSTATUS errno_to_status( int err )
+{
+    NTSTATUS status = map_errno( err );
+
+    TRACE( "errno = %d\n", err );
+    if (status == STATUS_UNSUCCESSFUL) FIXME( "Converting errno %d to STATUS_UNSUCCESSFUL\n", err );
+    return status;
+}
+
 
 static int xattr_fremove( int filedes, const char *name )
 {
@@ -2780,6 +2788,265 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* case-insensitive index of the names in a directory, to avoid scanning it on every lookup */
+struct dir_index_entry
+{
+    unsigned int next;               /* next entry in the hash chain, or ~0u */
+    unsigned int hash;               /* hash of the upper-cased name */
+    unsigned int name_pos;           /* offset of the upper-cased name in the names buffer */
+    unsigned int name_len;           /* length of the name in chars */
+    unsigned int unix_pos;           /* offset of the Unix name in the unix_names buffer */
+};
+
+struct dir_index
+{
+    struct list             entry;       /* entry in the dir_index_lru list */
+    struct list             hash_entry;  /* entry in the dir_index_hash chain */
+    struct file_identity    id;          /* directory file identity */
+    LONGLONG                mtime;       /* directory modification time when the index was built */
+    size_t                  mem_size;    /* total memory used by the index */
+    unsigned int            count;       /* number of entries */
+    unsigned int            hash_mask;   /* number of hash buckets - 1 */
+    unsigned int           *buckets;     /* heads of the hash chains */
+    struct dir_index_entry *entries;     /* index entries */
+    WCHAR                  *names;       /* upper-cased Unicode names */
+    char                   *unix_names;  /* Unix names in host encoding */
+};
+
+#define DIR_INDEX_HASH_SIZE  64
+#define DIR_INDEX_MAX_MEMORY (16 * 1024 * 1024)
+
+static struct list dir_index_lru = LIST_INIT( dir_index_lru );
+static struct list dir_index_hash[DIR_INDEX_HASH_SIZE];
+static size_t dir_index_mem_size;
+static pthread_mutex_t dir_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int hash_dir_index_name( const WCHAR *name, unsigned int len )
+{
+    unsigned int i, hash = 2166136261u;
+    for (i = 0; i < len; i++) hash = (hash ^ ntdll_towupper( name[i] )) * 16777619;
+    return hash;
+}
+
+static unsigned int hash_dir_index_id( dev_t dev, ino_t ino )
+{
+    return ((unsigned int)dev * 31 + (unsigned int)ino) % DIR_INDEX_HASH_SIZE;
+}
+
+static void free_dir_index( struct dir_index *index )
+{
+    free( index->buckets );
+    free( index->entries );
+    free( index->names );
+    free( index->unix_names );
+    free( index );
+}
+
+/* grow an index buffer so that it can hold at least size more bytes past used */
+static BOOL grow_dir_index_buffer( void **buffer, size_t *buffer_size, size_t used, size_t size )
+{
+    size_t new_size = max( *buffer_size, 1024 );
+    void *new_buffer;
+
+    if (used + size <= *buffer_size) return TRUE;
+    while (new_size < used + size) new_size *= 2;
+    if (!(new_buffer = realloc( *buffer, new_size ))) return FALSE;
+    *buffer = new_buffer;
+    *buffer_size = new_size;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           build_dir_index
+ *
+ * Read all the names of a directory into a hashed index.
+ */
+static NTSTATUS build_dir_index( const char *unix_name, const struct stat *st, struct dir_index **ret )
+{
+    size_t entries_size = 0, names_size = 0, unix_names_size = 0, names_used = 0, unix_used = 0;
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    LARGE_INTEGER mtime, dummy;
+    struct dir_index *index;
+    struct dirent *de;
+    unsigned int i, len;
+    size_t unix_len;
+    DIR *dir;
+    int ret_len;
+
+    if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
+    if (!(index = calloc( 1, sizeof(*index) )))
+    {
+        closedir( dir );
+        return STATUS_NO_MEMORY;
+    }
+
+    while ((de = readdir( dir )))
+    {
+        if (!strcmp( de->d_name, "." ) || !strcmp( de->d_name, ".." )) continue;
+        if ((ret_len = ntdll_umbstowcs( de->d_name, strlen(de->d_name), buffer, MAX_DIR_ENTRY_LEN )) <= 0)
+            continue;
+        len = ret_len;
+        unix_len = strlen( de->d_name ) + 1;
+
+        if (!grow_dir_index_buffer( (void **)&index->entries, &entries_size,
+                                    index->count * sizeof(*index->entries), sizeof(*index->entries) ) ||
+            !grow_dir_index_buffer( (void **)&index->names, &names_size,
+                                    names_used * sizeof(WCHAR), len * sizeof(WCHAR) ) ||
+            !grow_dir_index_buffer( (void **)&index->unix_names, &unix_names_size, unix_used, unix_len ))
+        {
+            closedir( dir );
+            free_dir_index( index );
+            return STATUS_NO_MEMORY;
+        }
+
+        index->entries[index->count].hash     = hash_dir_index_name( buffer, len );
+        index->entries[index->count].name_pos = names_used;
+        index->entries[index->count].name_len = len;
+        index->entries[index->count].unix_pos = unix_used;
+        for (i = 0; i < len; i++) index->names[names_used + i] = ntdll_towupper( buffer[i] );
+        memcpy( index->unix_names + unix_used, de->d_name, unix_len );
+        names_used += len;
+        unix_used += unix_len;
+        index->count++;
+    }
+    closedir( dir );
+
+    for (index->hash_mask = 15; index->hash_mask < index->count; index->hash_mask = index->hash_mask * 2 + 1)
+        ;
+    if (!(index->buckets = malloc( (index->hash_mask + 1) * sizeof(*index->buckets) )))
+    {
+        free_dir_index( index );
+        return STATUS_NO_MEMORY;
+    }
+    memset( index->buckets, 0xff, (index->hash_mask + 1) * sizeof(*index->buckets) );
+    for (i = 0; i < index->count; i++)
+    {
+        unsigned int bucket = index->entries[i].hash & index->hash_mask;
+        index->entries[i].next = index->buckets[bucket];
+        index->buckets[bucket] = i;
+    }
+
+    get_file_times( st, &mtime, &dummy, &dummy, &dummy );
+    index->id.dev   = st->st_dev;
+    index->id.ino   = st->st_ino;
+    index->mtime    = mtime.QuadPart;
+    index->mem_size = sizeof(*index) + entries_size + names_size + unix_names_size +
+                      (index->hash_mask + 1) * sizeof(*index->buckets);
+    *ret = index;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           lookup_dir_index
+ *
+ * Find a name in a directory index, and append the Unix name to unix_name at pos.
+ */
+static BOOL lookup_dir_index( const struct dir_index *index, char *unix_name, int pos,
+                              const WCHAR *name, unsigned int length )
+{
+    unsigned int hash = hash_dir_index_name( name, length ), i, j;
+    const struct dir_index_entry *entry;
+
+    for (i = index->buckets[hash & index->hash_mask]; i != ~0u; i = entry->next)
+    {
+        entry = &index->entries[i];
+        if (entry->hash != hash || entry->name_len != length) continue;
+        for (j = 0; j < length; j++)
+            if (index->names[entry->name_pos + j] != ntdll_towupper( name[j] )) break;
+        if (j < length) continue;
+
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, index->unix_names + entry->unix_pos );
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/***********************************************************************
+ *           find_file_in_dir_index
+ *
+ * Look for a file using the cached index of the directory in unix_name, rebuilding
+ * it if the directory has been modified. The file found is appended to unix_name at pos.
+ */
+static NTSTATUS find_file_in_dir_index( char *unix_name, int pos, const WCHAR *name, int length )
+{
+    struct dir_index *index, *next;
+    LARGE_INTEGER mtime, dummy;
+    struct list *chain;
+    NTSTATUS status;
+    struct stat st;
+    BOOL found;
+
+    if (stat( unix_name, &st ) == -1) return errno_to_status( errno );
+    get_file_times( &st, &mtime, &dummy, &dummy, &dummy );
+    chain = &dir_index_hash[hash_dir_index_id( st.st_dev, st.st_ino )];
+
+    mutex_lock( &dir_index_mutex );
+    if (!chain->next) list_init( chain );
+    LIST_FOR_EACH_ENTRY( index, chain, struct dir_index, hash_entry )
+    {
+        if (index->id.dev != st.st_dev || index->id.ino != st.st_ino) continue;
+        if (index->mtime == mtime.QuadPart)
+        {
+            found = lookup_dir_index( index, unix_name, pos, name, length );
+            list_remove( &index->entry );
+            list_add_head( &dir_index_lru, &index->entry );
+            mutex_unlock( &dir_index_mutex );
+            return found ? STATUS_SUCCESS : STATUS_OBJECT_NAME_NOT_FOUND;
+        }
+        /* the directory has been modified */
+        list_remove( &index->entry );
+        list_remove( &index->hash_entry );
+        dir_index_mem_size -= index->mem_size;
+        free_dir_index( index );
+        break;
+    }
+    mutex_unlock( &dir_index_mutex );
+
+    /* Modifications within the same second may not change the modification
+     * time, so don't index a directory that was just modified, let the caller
+     * scan it instead. */
+    if (st.st_mtime >= time( NULL ) - 1) return STATUS_NOT_SUPPORTED;
+
+    if ((status = build_dir_index( unix_name, &st, &index ))) return status;
+    found = lookup_dir_index( index, unix_name, pos, name, length );
+
+    if (index->mem_size > DIR_INDEX_MAX_MEMORY)
+    {
+        free_dir_index( index );
+        return found ? STATUS_SUCCESS : STATUS_OBJECT_NAME_NOT_FOUND;
+    }
+
+    mutex_lock( &dir_index_mutex );
+    LIST_FOR_EACH_ENTRY( next, chain, struct dir_index, hash_entry )
+    {
+        /* another thread may have added it meanwhile */
+        if (next->id.dev != st.st_dev || next->id.ino != st.st_ino) continue;
+        list_remove( &next->entry );
+        list_remove( &next->hash_entry );
+        dir_index_mem_size -= next->mem_size;
+        free_dir_index( next );
+        break;
+    }
+    list_add_head( &dir_index_lru, &index->entry );
+    list_add_head( chain, &index->hash_entry );
+    dir_index_mem_size += index->mem_size;
+
+    /* evict the least recently used indexes */
+    while (dir_index_mem_size > DIR_INDEX_MAX_MEMORY)
+    {
+        next = LIST_ENTRY( list_tail( &dir_index_lru ), struct dir_index, entry );
+        list_remove( &next->entry );
+        list_remove( &next->hash_entry );
+        dir_index_mem_size -= next->mem_size;
+        free_dir_index( next );
+    }
+    mutex_unlock( &dir_index_mutex );
+
+    return found ? STATUS_SUCCESS : STATUS_OBJECT_NAME_NOT_FOUND;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2792,6 +3059,7 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 {
     WCHAR buffer[MAX_DIR_ENTRY_LEN];
     BOOLEAN is_name_8_dot_3;
+    NTSTATUS status;
     DIR *dir;
     struct dirent *de;
     struct stat st;
@@ -2820,7 +3088,14 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 
     if (!is_name_8_dot_3 && !get_dir_case_sensitivity( unix_name )) goto not_found;
 
-    /* now look for it through the directory */
+    /* look for the long name in the directory index */
+
+    status = find_file_in_dir_index( unix_name, pos, name, length );
+    if (!status) return STATUS_SUCCESS;
+    if (status == STATUS_OBJECT_NAME_NOT_FOUND && !is_name_8_dot_3) goto not_found;
+
+    /* now look for the short name, or for any name if the index couldn't be used,
+     * through the directory */
 
 #ifdef VFAT_IOCTL_READDIR_BOTH
     if (is_name_8_dot_3)
@@ -5469,6 +5744,303 @@ void file_complete_async( HANDLE handle, unsigned int options, HANDLE event, PIO
 }
 
 
+/*
+ * Overlapped I/O on regular files can't be waited for with poll(), so it used to be done
+ * synchronously by the calling thread. When WINEFILEIOTHREADS is set to a thread count,
+ * it is queued to a bounded pool of unix worker threads instead, after handing the async
+ * off to the server with create_file_async. The workers have no server connection; they
+ * fill the IOSB and write the result to a pipe that the server reads, which then signals
+ * the event, queues the APC or posts the completion like for any other async.
+ */
+
+struct file_io_request
+{
+    struct list      entry;
+    int              fd;          /* private duplicate of the unix fd */
+    BOOL             write;
+    void            *buffer;
+    ULONG            length;
+    off_t            offset;
+    void            *iosb;        /* IO_STATUS_BLOCK, or IO_STATUS_BLOCK32 if iosb32 */
+    BOOL             iosb32;
+    obj_handle_t     wait;        /* async wait handle */
+    BOOL             cancel_wait; /* a cancel is waiting for the request to complete */
+};
+
+#define MAX_FILE_IO_THREADS 64
+
+static pthread_once_t file_io_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t file_io_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t file_io_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t file_io_done_cond = PTHREAD_COND_INITIALIZER;
+static struct list file_io_queue = LIST_INIT( file_io_queue );
+static struct list file_io_active = LIST_INIT( file_io_active );  /* requests picked up by a worker */
+static unsigned int file_io_max_threads;  /* 0 if disabled */
+static unsigned int file_io_threads;      /* number of worker threads */
+static unsigned int file_io_idle;         /* number of workers waiting for a request */
+static int file_io_results_fd = -1;       /* write end of the async results pipe */
+
+static void file_io_init_once(void)
+{
+    const char *env = getenv( "WINEFILEIOTHREADS" );
+    unsigned int count = env ? atoi( env ) : 0;
+    int fds[2];
+    NTSTATUS status;
+
+    if (!count) return;
+
+    if (pipe2( fds, O_CLOEXEC ) == -1) return;
+    wine_server_send_fd( fds[0] );
+    SERVER_START_REQ( set_async_results_fd )
+    {
+        req->fd = fds[0];
+        status = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+    close( fds[0] );
+
+    if (status)
+    {
+        WARN( "server doesn't support background file I/O, status %#x\n", (int)status );
+        close( fds[1] );
+        return;
+    }
+    file_io_results_fd = fds[1];
+    file_io_max_threads = min( count, MAX_FILE_IO_THREADS );
+    TRACE( "background file I/O enabled, %u threads\n", file_io_max_threads );
+}
+
+static void file_io_complete( struct file_io_request *req, NTSTATUS status, ULONG_PTR total )
+{
+    async_result_t result;
+
+    /* the status must only become visible once the information is set */
+    if (req->iosb32)
+    {
+        IO_STATUS_BLOCK32 *io32 = req->iosb;
+        io32->Information = total;
+        __atomic_store_n( &io32->Status, status, __ATOMIC_RELEASE );
+    }
+    else
+    {
+        IO_STATUS_BLOCK *io = req->iosb;
+        io->Information = total;
+        __atomic_store_n( &io->Status, status, __ATOMIC_RELEASE );
+    }
+
+    result.wait = req->wait;
+    result.status = status;
+    result.information = total;
+    while (write( file_io_results_fd, &result, sizeof(result) ) == -1 && errno == EINTR);
+}
+
+static void file_io_process( struct file_io_request *req )
+{
+    NTSTATUS status;
+    ssize_t result;
+
+    if (req->write)
+    {
+        while ((result = pwrite( req->fd, req->buffer, req->length, req->offset )) == -1 && errno == EINTR);
+        if (result >= 0) status = STATUS_SUCCESS;
+        else status = errno == EFAULT ? STATUS_INVALID_USER_BUFFER : map_errno( errno );
+    }
+    else
+    {
+        /* the buffer has been made writable by queue_file_io, virtual_locked_pread
+         * can't be used here as it may need to update write watches */
+        while ((result = pread( req->fd, req->buffer, req->length, req->offset )) == -1 && errno == EINTR);
+        if (result >= 0) status = (result || !req->length) ? STATUS_SUCCESS : STATUS_END_OF_FILE;
+        else status = map_errno( errno );
+    }
+    file_io_complete( req, status, max( result, 0 ));
+}
+
+static void free_file_io_request( struct file_io_request *req )
+{
+    close( req->fd );
+    free( req );
+}
+
+static void *file_io_thread( void *arg )
+{
+    struct file_io_request *req;
+    struct list *entry;
+
+    for (;;)
+    {
+        pthread_mutex_lock( &file_io_mutex );
+        while (!(entry = list_head( &file_io_queue )))
+        {
+            file_io_idle++;
+            pthread_cond_wait( &file_io_cond, &file_io_mutex );
+            file_io_idle--;
+        }
+        list_remove( entry );
+        list_add_tail( &file_io_active, entry );
+        pthread_mutex_unlock( &file_io_mutex );
+
+        req = LIST_ENTRY( entry, struct file_io_request, entry );
+        file_io_process( req );
+
+        pthread_mutex_lock( &file_io_mutex );
+        list_remove( &req->entry );
+        if (req->cancel_wait) pthread_cond_broadcast( &file_io_done_cond );
+        pthread_mutex_unlock( &file_io_mutex );
+        free_file_io_request( req );
+    }
+    return NULL;
+}
+
+/* queue a regular file read or write to the worker threads, returns STATUS_PENDING on success */
+static NTSTATUS queue_file_io( HANDLE handle, int unix_fd, BOOL write, void *buffer, ULONG length,
+                               off_t offset, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                               IO_STATUS_BLOCK *io )
+{
+    struct file_io_request *request;
+    sigset_t sigset, old_sigset;
+    pthread_attr_t attr;
+    pthread_t thread;
+    NTSTATUS status;
+    BOOL new_thread, failed = FALSE;
+
+    pthread_once( &file_io_once, file_io_init_once );
+    if (!file_io_max_threads) return STATUS_NOT_SUPPORTED;
+
+    /* trigger the write watches here, the workers can't handle the faults */
+    if (!write && !virtual_check_buffer_for_write( buffer, length )) return STATUS_NOT_SUPPORTED;
+
+    if (!(request = malloc( sizeof(*request) ))) return STATUS_NOT_SUPPORTED;
+    if ((request->fd = dup( unix_fd )) == -1)
+    {
+        free( request );
+        return STATUS_NOT_SUPPORTED;
+    }
+    request->write  = write;
+    request->buffer = buffer;
+    request->length = length;
+    request->offset = offset;
+    request->iosb32 = in_wow64_call();
+    request->iosb   = request->iosb32 ? io->Pointer : io;
+    request->cancel_wait = FALSE;
+
+    SERVER_START_REQ( create_file_async )
+    {
+        req->type  = write ? ASYNC_TYPE_WRITE : ASYNC_TYPE_READ;
+        req->async = server_async( handle, NULL, event, apc, apc_user, iosb_client_ptr(io) );
+        status = wine_server_call( req );
+        request->wait = reply->wait;
+    }
+    SERVER_END_REQ;
+
+    if (status != STATUS_ALERTED)
+    {
+        close( request->fd );
+        free( request );
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    server_enter_uninterrupted_section( &file_io_mutex, &sigset );
+    list_add_tail( &file_io_queue, &request->entry );
+    new_thread = !file_io_idle && file_io_threads < file_io_max_threads;
+    if (new_thread) file_io_threads++;
+    else pthread_cond_signal( &file_io_cond );
+    server_leave_uninterrupted_section( &file_io_mutex, &sigset );
+
+    if (new_thread)
+    {
+        /* the workers can't handle signals, they don't have a TEB */
+        sigfillset( &sigset );
+        pthread_sigmask( SIG_BLOCK, &sigset, &old_sigset );
+        pthread_attr_init( &attr );
+        pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+        pthread_attr_setstacksize( &attr, 0x10000 );
+        if (pthread_create( &thread, &attr, file_io_thread, NULL ))
+        {
+            ERR( "failed to start a file I/O thread\n" );
+            pthread_mutex_lock( &file_io_mutex );
+            file_io_threads--;
+            /* nobody else is going to pick up the request */
+            if ((failed = !file_io_threads)) list_remove( &request->entry );
+            pthread_mutex_unlock( &file_io_mutex );
+        }
+        pthread_attr_destroy( &attr );
+        pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+    }
+    if (failed)
+    {
+        file_io_process( request );
+        free_file_io_request( request );
+    }
+    return STATUS_PENDING;
+}
+
+
+/* cancel the asyncs of a file, completing the background I/O requests that haven't been
+ * picked up by a worker yet with STATUS_CANCELLED. The requests that a worker has already
+ * started can't be interrupted; they are waited for, and don't count as canceled. */
+static unsigned int cancel_file_asyncs( HANDLE handle, IO_STATUS_BLOCK *io, BOOL only_thread )
+{
+    struct file_io_request *request, *next;
+    struct list canceled = LIST_INIT( canceled );
+    obj_handle_t waits[64];
+    unsigned int i, count, status, ret = ~0u;
+    BOOL started = FALSE;
+    sigset_t sigset;
+
+    /* keep the workers from dequeuing requests until the reported ones are dropped, so
+     * that their wait handles can't have been closed and reused in the meantime */
+    server_enter_uninterrupted_section( &file_io_mutex, &sigset );
+    do
+    {
+        SERVER_START_REQ( cancel_async )
+        {
+            req->handle      = wine_server_obj_handle( handle );
+            req->iosb        = wine_server_client_ptr( io );
+            req->only_thread = only_thread;
+            if (file_io_max_threads) wine_server_set_reply( req, waits, sizeof(waits) );
+            status = wine_server_call( req );
+            count = wine_server_reply_size( reply ) / sizeof(waits[0]);
+        }
+        SERVER_END_REQ;
+        /* the server cancels all its own asyncs on the first call */
+        if (ret == ~0u) ret = status;
+
+        LIST_FOR_EACH_ENTRY_SAFE( request, next, &file_io_queue, struct file_io_request, entry )
+        {
+            for (i = 0; i < count; i++) if (request->wait == waits[i]) break;
+            if (i == count) continue;
+            list_remove( &request->entry );
+            list_add_tail( &canceled, &request->entry );
+            ret = STATUS_SUCCESS;
+        }
+        LIST_FOR_EACH_ENTRY( request, &file_io_active, struct file_io_request, entry )
+        {
+            for (i = 0; i < count; i++) if (request->wait == waits[i]) break;
+            if (i == count) continue;
+            request->cancel_wait = started = TRUE;
+        }
+    } while (count == ARRAY_SIZE(waits));
+
+    while (started)
+    {
+        started = FALSE;
+        LIST_FOR_EACH_ENTRY( request, &file_io_active, struct file_io_request, entry )
+            if (request->cancel_wait) started = TRUE;
+        if (started) pthread_cond_wait( &file_io_done_cond, &file_io_mutex );
+    }
+    server_leave_uninterrupted_section( &file_io_mutex, &sigset );
+
+    LIST_FOR_EACH_ENTRY_SAFE( request, next, &canceled, struct file_io_request, entry )
+    {
+        list_remove( &request->entry );
+        file_io_complete( request, STATUS_CANCELLED, 0 );
+        free_file_io_request( request );
+    }
+    return ret;
+}
+
+
 static unsigned int set_pending_write( HANDLE device )
 {
     unsigned int status;
@@ -5526,7 +6098,14 @@ NTSTATUS WINAPI NtReadFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
 
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
-            /* async I/O doesn't make sense on regular files */
+            if (async_read && queue_file_io( handle, unix_handle, FALSE, buffer, length, offset->QuadPart,
+                                             event, apc, apc_user, io ) == STATUS_PENDING)
+            {
+                if (needs_close) close( unix_handle );
+                return STATUS_PENDING;
+            }
+
+            /* no background I/O, read synchronously */
             while ((result = virtual_locked_pread( unix_handle, buffer, length, offset->QuadPart )) == -1)
             {
                 if (errno != EINTR)
@@ -5553,7 +6132,7 @@ NTSTATUS WINAPI NtReadFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
     }
     else if (type == FD_TYPE_SOCKET)
     {
-        status = sock_read( handle, unix_handle, event, apc, apc_user, io, buffer, length );
+        status = sock_read( handle, unix_handle, options, event, apc, apc_user, io, buffer, length );
         if (needs_close) close( unix_handle );
         return status;
     }
@@ -5840,8 +6419,16 @@ NTSTATUS WINAPI NtWriteFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, v
                 status = STATUS_INVALID_PARAMETER;
                 goto done;
             }
+            /* writes to the end of file are kept in order by doing them synchronously */
+            else if (async_write &&
+                     queue_file_io( handle, unix_handle, TRUE, (void *)buffer, length, off,
+                                    event, apc, apc_user, io ) == STATUS_PENDING)
+            {
+                if (needs_close) close( unix_handle );
+                return STATUS_PENDING;
+            }
 
-            /* async I/O doesn't make sense on regular files */
+            /* no background I/O, write synchronously */
             while ((result = pwrite( unix_handle, buffer, length, off )) == -1)
             {
                 if (errno != EINTR)
@@ -5871,7 +6458,7 @@ NTSTATUS WINAPI NtWriteFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, v
     }
     else if (type == FD_TYPE_SOCKET)
     {
-        status = sock_write( handle, unix_handle, event, apc, apc_user, io, buffer, length );
+        status = sock_write( handle, unix_handle, options, event, apc, apc_user, io, buffer, length );
         if (needs_close) close( unix_handle );
         return status;
     }
@@ -6331,18 +6918,11 @@ NTSTATUS WINAPI NtCancelIoFile( HANDLE handle, IO_STATUS_BLOCK *io_status )
 
     TRACE( "%p %p\n", handle, io_status );
 
-    SERVER_START_REQ( cancel_async )
+    if (!(status = cancel_file_asyncs( handle, NULL, TRUE )))
     {
-        req->handle      = wine_server_obj_handle( handle );
-        req->only_thread = TRUE;
-        if (!(status = wine_server_call( req )))
-        {
-            io_status->Status = status;
-            io_status->Information = 0;
-        }
+        io_status->Status = status;
+        io_status->Information = 0;
     }
-    SERVER_END_REQ;
-
     return status;
 }
 
@@ -6356,18 +6936,11 @@ NTSTATUS WINAPI NtCancelIoFileEx( HANDLE handle, IO_STATUS_BLOCK *io, IO_STATUS_
 
     TRACE( "%p %p %p\n", handle, io, io_status );
 
-    SERVER_START_REQ( cancel_async )
+    if (!(status = cancel_file_asyncs( handle, io, FALSE )))
     {
-        req->handle = wine_server_obj_handle( handle );
-        req->iosb   = wine_server_client_ptr( io );
-        if (!(status = wine_server_call( req )))
-        {
-            io_status->Status = status;
-            io_status->Information = 0;
-        }
+        io_status->Status = status;
+        io_status->Information = 0;
     }
-    SERVER_END_REQ;
-
     return status;
 }
 
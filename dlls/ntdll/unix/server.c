@@ -56,6 +56,10 @@
 #ifdef HAVE_SYS_SYSCALL_H
 # include <sys/syscall.h>
 #endif
+#ifdef __linux__
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif
 #ifdef HAVE_SYS_UIO_H
 #include <sys/uio.h>
 #endif
@@ -63,6 +67,7 @@
 #include <sys/thr.h>
 #endif
 #include <unistd.h>
+#include <poll.h>
 #ifdef __APPLE__
 #include <crt_externs.h>
 #include <spawn.h>
@@ -104,6 +109,8 @@ static int fd_socket = -1;  /* socket to exchange file descriptors with the serv
 static int initial_cwd = -1;
 static pid_t server_pid;
 static pthread_mutex_t fd_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static void *request_shm;            /* shared memory request slots of the process */
+static int request_shm_doorbell = -1;
 
 /* atomically exchange a 64-bit value */
 static inline LONG64 interlocked_xchg64( LONG64 *dest, LONG64 val )
@@ -253,6 +260,66 @@ static inline unsigned int wait_reply( struct __server_request_info *req )
 }
 
 
+#ifdef __linux__
+
+/***********************************************************************
+ *           server_call_shm
+ *
+ * Perform a server call through the shared memory slot of the thread.
+ */
+static unsigned int server_call_shm( struct __server_request_info *req, request_shm_slot_t *slot )
+{
+    request_shm_header_t *header = request_shm;
+    struct timespec timeout = { 1, 0 };
+    ULONG64 ring = 1;
+    unsigned int i;
+
+    memcpy( (void *)&slot->request, &req->u.req, sizeof(req->u.req) );
+    __atomic_store_n( &slot->state, REQUEST_SHM_REQUEST, __ATOMIC_SEQ_CST );
+    __atomic_fetch_or( &header->ready[slot->index / 32], 1u << (slot->index % 32), __ATOMIC_SEQ_CST );
+    /* only ring the doorbell if the server isn't already going to look at the slots */
+    if (!__atomic_fetch_add( &header->pending, 1, __ATOMIC_SEQ_CST ))
+        write( request_shm_doorbell, &ring, sizeof(ring) );
+
+    for (i = 0; i < 200; i++)
+    {
+        if (__atomic_load_n( &slot->state, __ATOMIC_ACQUIRE ) == REQUEST_SHM_REPLY) goto done;
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    /* the server stores the state before loading client_waiting, and we store client_waiting
+     * before loading the state, both need to be sequentially consistent so that one of us
+     * always sees the other's store */
+    __atomic_store_n( &slot->client_waiting, 1, __ATOMIC_SEQ_CST );
+    while (__atomic_load_n( &slot->state, __ATOMIC_SEQ_CST ) == REQUEST_SHM_REQUEST)
+    {
+        struct pollfd pfd;
+
+        /* the futex is shared with the server, it can't be private */
+        if (syscall( __NR_futex, &slot->state, FUTEX_WAIT, REQUEST_SHM_REQUEST, &timeout, 0, 0 ) == -1 &&
+            errno == ETIMEDOUT)
+        {
+            /* make sure the server is still there */
+            pfd.fd = ntdll_get_thread_data()->reply_fd;
+            pfd.events = POLLIN;
+            if (poll( &pfd, 1, 0 ) == 1 && (pfd.revents & (POLLHUP | POLLERR))) abort_thread(0);
+        }
+    }
+    __atomic_store_n( &slot->client_waiting, 0, __ATOMIC_SEQ_CST );
+
+done:
+    memcpy( &req->u.reply, (void *)&slot->reply, sizeof(req->u.reply) );
+    if (req->u.reply.reply_header.reply_size)
+        memcpy( req->reply_data, (void *)slot->data, req->u.reply.reply_header.reply_size );
+    slot->state = REQUEST_SHM_IDLE;
+    return req->u.reply.reply_header.error;
+}
+
+#endif  /* __linux__ */
+
+
 /***********************************************************************
  *           server_call_unlocked
  */
@@ -261,6 +328,16 @@ unsigned int server_call_unlocked( void *req_ptr )
     struct __server_request_info * const req = req_ptr;
     unsigned int ret;
 
+#ifdef __linux__
+    request_shm_slot_t *slot = ntdll_get_thread_data()->request_slot;
+
+    /* requests with data still go through the pipe, so that invalid client
+     * pointers are reported as access violations by the kernel */
+    if (slot && !req->u.req.request_header.request_size &&
+        req->u.req.request_header.reply_size <= sizeof(slot->data))
+        return server_call_shm( req, slot );
+#endif
+
     if ((ret = send_request( req ))) return ret;
     return wait_reply( req );
 }
@@ -1080,6 +1157,279 @@ static int remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************/
+/* fast sync objects cache */
+
+union fast_sync_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        unsigned int index : 16;       /* object index in the shared mapping */
+        unsigned int type : 4;         /* object type, never 0 for a used entry */
+        unsigned int generation : 12;  /* low bits of the mapping entry generation */
+        unsigned int access;
+    } s;
+};
+
+C_ASSERT( sizeof(union fast_sync_cache_entry) == sizeof(LONG64) );
+
+static union fast_sync_cache_entry *fast_sync_cache[FD_CACHE_ENTRIES];
+
+/* the cached objects that aren't fast sync objects, so that we don't ask the server again */
+#define FAST_SYNC_CACHE_NONE 0xf
+#define FAST_SYNC_GENERATION_MASK 0xfff
+
+/***********************************************************************
+ *           add_fast_sync_to_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static void add_fast_sync_to_cache( HANDLE handle, unsigned int index, int type, unsigned int access,
+                                    unsigned int generation )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fast_sync_cache_entry cache;
+
+    if (entry >= FD_CACHE_ENTRIES) return;
+
+    if (!fast_sync_cache[entry])  /* do we need to allocate a new block of entries? */
+    {
+        void *ptr = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(union fast_sync_cache_entry),
+                                     PROT_READ | PROT_WRITE );
+        if (ptr == MAP_FAILED) return;
+        fast_sync_cache[entry] = ptr;
+    }
+
+    cache.s.index = index;
+    cache.s.type = type;
+    cache.s.generation = generation & FAST_SYNC_GENERATION_MASK;
+    cache.s.access = access;
+    interlocked_xchg64( &fast_sync_cache[entry][idx].data, cache.data );
+}
+
+
+/***********************************************************************
+ *           get_cached_fast_sync
+ *
+ * The handle may have been closed by another process and reused since it has been
+ * cached, so the entry is only used if the mapping entry hasn't been reused too.
+ */
+static inline NTSTATUS get_cached_fast_sync( HANDLE handle, const fast_sync_shm_t *objects,
+                                             unsigned int *index, int *type, unsigned int *access )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fast_sync_cache_entry cache;
+
+    if (entry >= FD_CACHE_ENTRIES || !fast_sync_cache[entry]) return STATUS_INVALID_HANDLE;
+
+    cache.data = InterlockedCompareExchange64( &fast_sync_cache[entry][idx].data, 0, 0 );
+    if (!cache.data) return STATUS_INVALID_HANDLE;
+    if (cache.s.type == FAST_SYNC_CACHE_NONE) return STATUS_NOT_IMPLEMENTED;
+    if (cache.s.generation != (objects[cache.s.index].generation & FAST_SYNC_GENERATION_MASK))
+        return STATUS_INVALID_HANDLE;
+
+    *index = cache.s.index;
+    *type = cache.s.type;
+    *access = cache.s.access;
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           remove_fast_sync_from_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static void remove_fast_sync_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < FD_CACHE_ENTRIES && fast_sync_cache[entry])
+        interlocked_xchg64( &fast_sync_cache[entry][idx].data, 0 );
+}
+
+
+/***********************************************************************
+ *           server_map_fast_sync
+ *
+ * Map the fast sync objects section of the process, returns NULL if the server doesn't support it.
+ */
+fast_sync_shm_t *server_map_fast_sync(void)
+{
+#ifdef __linux__
+    fast_sync_shm_t *objects = NULL;
+    sigset_t sigset;
+    unsigned int status;
+    mem_size_t size = 0;
+    obj_handle_t handle;
+    void *ptr;
+    int fd;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    SERVER_START_REQ( init_fast_sync )
+    {
+        if (!(status = wine_server_call( req ))) size = reply->size;
+    }
+    SERVER_END_REQ;
+
+    if (!status)
+    {
+        if ((fd = receive_fd( &handle )) == -1 ||
+            (ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+            ERR( "failed to map the fast sync objects\n" );
+        else objects = ptr;
+        if (fd != -1) close( fd );
+    }
+
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return objects;
+#else
+    return NULL;
+#endif
+}
+
+
+/***********************************************************************
+ *           server_get_fast_sync_obj
+ *
+ * Get the index and type of a fast sync object in the shared objects mapping.
+ * Returns STATUS_NOT_IMPLEMENTED if the handle isn't a fast sync object.
+ */
+NTSTATUS server_get_fast_sync_obj( HANDLE handle, const fast_sync_shm_t *objects, unsigned int *index,
+                                   int *type, unsigned int *access )
+{
+    sigset_t sigset;
+    NTSTATUS ret;
+
+    /* pseudo handles are never fast sync objects */
+    if (!handle || HandleToLong( handle ) < 0) return STATUS_NOT_IMPLEMENTED;
+
+    ret = get_cached_fast_sync( handle, objects, index, type, access );
+    if (ret != STATUS_INVALID_HANDLE) return ret;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    ret = get_cached_fast_sync( handle, objects, index, type, access );
+    if (ret == STATUS_INVALID_HANDLE)
+    {
+        SERVER_START_REQ( get_fast_sync_obj )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            if (!(ret = wine_server_call( req )))
+            {
+                *index = reply->index;
+                *type = reply->type;
+                *access = reply->access;
+                add_fast_sync_to_cache( handle, reply->index, reply->type, reply->access,
+                                        reply->generation );
+            }
+            else if (ret == STATUS_NOT_IMPLEMENTED)
+                add_fast_sync_to_cache( handle, 0, FAST_SYNC_CACHE_NONE, 0, 0 );
+        }
+        SERVER_END_REQ;
+    }
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return ret;
+}
+
+
+/***********************************************************************/
+/* socket shared state cache */
+
+/* socket index + 1, or SOCK_SHM_CACHE_NONE if the server has no shared state for the handle */
+static LONG *sock_shm_cache[FD_CACHE_ENTRIES];
+
+#define SOCK_SHM_CACHE_NONE (~0u)
+
+/***********************************************************************
+ *           add_sock_shm_to_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static void add_sock_shm_to_cache( HANDLE handle, unsigned int value )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry >= FD_CACHE_ENTRIES) return;
+
+    if (!sock_shm_cache[entry])  /* do we need to allocate a new block of entries? */
+    {
+        void *ptr = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(LONG), PROT_READ | PROT_WRITE );
+        if (ptr == MAP_FAILED) return;
+        sock_shm_cache[entry] = ptr;
+    }
+    InterlockedExchange( &sock_shm_cache[entry][idx], value );
+}
+
+
+/***********************************************************************
+ *           get_cached_sock_shm
+ */
+static inline NTSTATUS get_cached_sock_shm( HANDLE handle, unsigned int *index )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    unsigned int value;
+
+    if (entry >= FD_CACHE_ENTRIES || !sock_shm_cache[entry]) return STATUS_INVALID_HANDLE;
+
+    if (!(value = ReadAcquire( &sock_shm_cache[entry][idx] ))) return STATUS_INVALID_HANDLE;
+    if (value == SOCK_SHM_CACHE_NONE) return STATUS_NOT_IMPLEMENTED;
+    *index = value - 1;
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           remove_sock_shm_from_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static void remove_sock_shm_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < FD_CACHE_ENTRIES && sock_shm_cache[entry])
+        InterlockedExchange( &sock_shm_cache[entry][idx], 0 );
+}
+
+
+/***********************************************************************
+ *           server_get_socket_shm
+ *
+ * Get the index of a socket in the socket shared mapping.
+ * Returns STATUS_NOT_IMPLEMENTED if the socket doesn't have shared state.
+ */
+NTSTATUS server_get_socket_shm( HANDLE handle, unsigned int *index )
+{
+    sigset_t sigset;
+    NTSTATUS ret;
+
+    ret = get_cached_sock_shm( handle, index );
+    if (ret != STATUS_INVALID_HANDLE) return ret;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    ret = get_cached_sock_shm( handle, index );
+    if (ret == STATUS_INVALID_HANDLE)
+    {
+        SERVER_START_REQ( get_socket_shm )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            if (!(ret = wine_server_call( req )))
+            {
+                *index = reply->index;
+                add_sock_shm_to_cache( handle, reply->index + 1 );
+            }
+            else if (ret == STATUS_NOT_IMPLEMENTED)
+                add_sock_shm_to_cache( handle, SOCK_SHM_CACHE_NONE );
+        }
+        SERVER_END_REQ;
+    }
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return ret;
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -1141,6 +1491,56 @@ done:
 }
 
 
+/***********************************************************************
+ *           server_init_request_shm
+ *
+ * Get a shared memory request slot for the current thread, if the server supports it.
+ */
+static void server_init_request_shm(void)
+{
+#ifdef __linux__
+    sigset_t sigset;
+    unsigned int status, slot = 0;
+    mem_size_t size = 0;
+    obj_handle_t handle;
+    void *ptr;
+    int fd;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    SERVER_START_REQ( init_request_shm )
+    {
+        req->mapped = request_shm != NULL;
+        if (!(status = wine_server_call( req )))
+        {
+            slot = reply->slot;
+            size = reply->size;
+        }
+    }
+    SERVER_END_REQ;
+
+    if (!status && !request_shm)
+    {
+        fd = receive_fd( &handle );
+        request_shm_doorbell = receive_fd( &handle );
+        if (fd == -1 || request_shm_doorbell == -1 ||
+            (ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+        {
+            ERR( "failed to map shared memory request slots\n" );
+            status = STATUS_NO_MEMORY;
+        }
+        else request_shm = ptr;
+        if (fd != -1) close( fd );
+    }
+    if (!status)
+        ntdll_get_thread_data()->request_slot = (request_shm_slot_t *)((char *)request_shm + REQUEST_SHM_HEADER_SIZE +
+                                                                       slot * REQUEST_SHM_SLOT_SIZE);
+
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+#endif
+}
+
+
 /***********************************************************************
  *           wine_server_fd_to_handle
  */
@@ -1688,6 +2088,8 @@ void server_init_process_done(void)
     SERVER_END_REQ;
 
     assert( !status );
+    server_init_request_shm();
+    fast_sync_init();
     signal_start_thread( main_image_info.TransferAddress, peb, suspend, NtCurrentTeb() );
 }
 
@@ -1717,6 +2119,7 @@ void server_init_thread( void *entry_point, BOOL *suspend )
     }
     SERVER_END_REQ;
     close( reply_pipe );
+    server_init_request_shm();
 }
 
 
@@ -1758,7 +2161,11 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     if (options & DUPLICATE_CLOSE_SOURCE)
+    {
         fd = remove_fd_from_cache( source );
+        remove_fast_sync_from_cache( source );
+        remove_sock_shm_from_cache( source );
+    }
 
     SERVER_START_REQ( dup_handle )
     {
@@ -1829,6 +2236,8 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     fd = remove_fd_from_cache( handle );
+    remove_fast_sync_from_cache( handle );
+    remove_sock_shm_from_cache( handle );
 
     SERVER_START_REQ( close_handle )
     {
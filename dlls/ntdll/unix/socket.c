@@ -25,6 +25,7 @@
 #include "config.h"
 #include <assert.h>
 #include <errno.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
@@ -836,13 +837,95 @@ static BOOL is_icmp_over_dgram( int fd )
 #endif
 }
 
+/* socket state shared with the server, see server/sock.c */
+static const sock_shm_t *sock_shm_objects;
+static pthread_once_t sock_shm_once = PTHREAD_ONCE_INIT;
+
+/* A direct call must not overtake an async that another thread queues after the flags
+ * check, so the check and the direct call, and the requests that queue asyncs on the
+ * socket, are all made under the lock of the socket. */
+#define SOCK_SHM_LOCKS 64
+static pthread_mutex_t sock_shm_locks[SOCK_SHM_LOCKS];
+
+static void sock_shm_init_once(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s','\\',
+                                  '_','_','w','i','n','e','_','s','o','c','k','_','s','h','m',0};
+    const char *env = getenv( "WINEFASTSOCK" );
+    UNICODE_STRING name;
+    OBJECT_ATTRIBUTES attr;
+    SIZE_T size = 0;
+    void *ptr = NULL;
+    HANDLE handle;
+
+    if (!env || !atoi( env )) return;
+
+    init_unicode_string( &name, nameW );
+    InitializeObjectAttributes( &attr, &name, 0, 0, NULL );
+    if (NtOpenSection( &handle, SECTION_MAP_READ, &attr ))
+    {
+        WARN( "server doesn't support direct socket I/O\n" );
+        return;
+    }
+    if (!map_section( handle, &ptr, &size, PAGE_READONLY ))
+    {
+        unsigned int i;
+
+        for (i = 0; i < SOCK_SHM_LOCKS; i++) pthread_mutex_init( &sock_shm_locks[i], NULL );
+        sock_shm_objects = ptr;
+    }
+    NtClose( handle );
+
+    TRACE( "direct socket I/O enabled, state at %p\n", sock_shm_objects );
+}
+
+/* lock the socket and get the flags telling if we may send or receive directly,
+ * returns NULL without locking if the server doesn't share the socket state */
+static pthread_mutex_t *sock_shm_lock( HANDLE handle, unsigned int *flags, sigset_t *sigset )
+{
+    pthread_mutex_t *mutex;
+    unsigned int index;
+
+    pthread_once( &sock_shm_once, sock_shm_init_once );
+    if (!sock_shm_objects) return NULL;
+    if (server_get_socket_shm( handle, &index )) return NULL;
+
+    mutex = &sock_shm_locks[index % SOCK_SHM_LOCKS];
+    server_enter_uninterrupted_section( mutex, sigset );
+    *flags = __atomic_load_n( &sock_shm_objects[index].flags, __ATOMIC_SEQ_CST );
+    return mutex;
+}
+
+static void sock_shm_unlock( pthread_mutex_t *mutex, sigset_t *sigset )
+{
+    if (mutex) server_leave_uninterrupted_section( mutex, sigset );
+}
+
+/* the direct calls are made with the lock held, so they must not fault on the caller's pointers */
+static BOOL recv_params_valid( struct async_recv_ioctl *async )
+{
+    if (async->control) return FALSE;
+    if (async->ret_flags && !virtual_check_buffer_for_write( async->ret_flags, sizeof(*async->ret_flags) ))
+        return FALSE;
+    if (!async->addr) return TRUE;
+    return async->addr_len && virtual_check_buffer_for_write( async->addr_len, sizeof(*async->addr_len) ) &&
+           virtual_check_buffer_for_write( async->addr, max( *async->addr_len, 0 ) );
+}
+
+static BOOL send_params_valid( struct async_send_ioctl *async )
+{
+    return !async->addr || virtual_check_buffer_for_read( async->addr, async->addr_len );
+}
+
 static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user, IO_STATUS_BLOCK *io,
-                           int fd, struct async_recv_ioctl *async, int force_async )
+                           int fd, ULONG options, struct async_recv_ioctl *async, int force_async )
 {
+    pthread_mutex_t *shm_mutex;
+    unsigned int shm_flags;
     HANDLE wait_handle;
+    sigset_t sigset;
     BOOL nonblocking;
     unsigned int i, status;
-    ULONG options;
 
     for (i = 0; i < async->count; ++i)
     {
@@ -853,6 +936,25 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
         }
     }
 
+    /* Nothing is queued on the socket, so the data can't be meant for another request;
+     * only go to the server if the receive has to wait. */
+    shm_mutex = sock_shm_lock( handle, &shm_flags, &sigset );
+    if (shm_mutex && (shm_flags & SOCK_SHM_FAST_RECV) && !(async->unix_flags & MSG_OOB) &&
+        !async->icmp_over_dgram && recv_params_valid( async ))
+    {
+        ULONG_PTR information;
+
+        status = try_recv( fd, async, &information );
+        if (status != STATUS_DEVICE_NOT_READY)
+        {
+            sock_shm_unlock( shm_mutex, &sigset );
+            if (!NT_ERROR(status))
+                file_complete_async( handle, options, event, apc, apc_user, io, status, information );
+            release_fileio( &async->io );
+            return status;
+        }
+    }
+
     SERVER_START_REQ( recv_socket )
     {
         req->force_async = force_async;
@@ -864,6 +966,7 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
         nonblocking = reply->nonblocking;
     }
     SERVER_END_REQ;
+    sock_shm_unlock( shm_mutex, &sigset );
 
     /* the server currently will never succeed immediately */
     assert(status == STATUS_ALERTED || status == STATUS_PENDING || NT_ERROR(status));
@@ -887,7 +990,7 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
 
 
 static NTSTATUS sock_ioctl_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user, IO_STATUS_BLOCK *io,
-                                 int fd, const void *buffers_ptr, unsigned int count, WSABUF *control,
+                                 int fd, ULONG options, const void *buffers_ptr, unsigned int count, WSABUF *control,
                                  struct WS_sockaddr *addr, int *addr_len, unsigned int *ret_flags, int unix_flags, int force_async )
 {
     struct async_recv_ioctl *async;
@@ -935,11 +1038,11 @@ static NTSTATUS sock_ioctl_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
     async->ret_flags = ret_flags;
     async->icmp_over_dgram = is_icmp_over_dgram( fd );
 
-    return sock_recv( handle, event, apc, apc_user, io, fd, async, force_async );
+    return sock_recv( handle, event, apc, apc_user, io, fd, options, async, force_async );
 }
 
 
-NTSTATUS sock_read( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
+NTSTATUS sock_read( HANDLE handle, int fd, ULONG options, HANDLE event, PIO_APC_ROUTINE apc,
                     void *apc_user, IO_STATUS_BLOCK *io, void *buffer, ULONG length )
 {
     static const DWORD async_size = offsetof( struct async_recv_ioctl, iov[1] );
@@ -958,7 +1061,7 @@ NTSTATUS sock_read( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
     async->ret_flags = NULL;
     async->icmp_over_dgram = is_icmp_over_dgram( fd );
 
-    return sock_recv( handle, event, apc, apc_user, io, fd, async, 1 );
+    return sock_recv( handle, event, apc, apc_user, io, fd, options, async, 1 );
 }
 
 
@@ -1094,12 +1197,30 @@ static void sock_save_icmp_id( struct async_send_ioctl *async )
 }
 
 static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
-                           IO_STATUS_BLOCK *io, int fd, struct async_send_ioctl *async, int force_async )
+                           IO_STATUS_BLOCK *io, int fd, ULONG options, struct async_send_ioctl *async,
+                           int force_async )
 {
+    pthread_mutex_t *shm_mutex;
+    unsigned int shm_flags;
     HANDLE wait_handle;
+    sigset_t sigset;
     BOOL nonblocking;
     unsigned int status;
-    ULONG options;
+
+    /* a short write continues through the server, with the remaining buffers */
+    shm_mutex = sock_shm_lock( handle, &shm_flags, &sigset );
+    if (shm_mutex && (shm_flags & SOCK_SHM_FAST_SEND) && send_params_valid( async ))
+    {
+        status = try_send( fd, async );
+        if (status != STATUS_DEVICE_NOT_READY)
+        {
+            sock_shm_unlock( shm_mutex, &sigset );
+            if (!NT_ERROR(status))
+                file_complete_async( handle, options, event, apc, apc_user, io, status, async->sent_len );
+            release_fileio( &async->io );
+            return status;
+        }
+    }
 
     SERVER_START_REQ( send_socket )
     {
@@ -1111,6 +1232,7 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
         nonblocking = reply->nonblocking;
     }
     SERVER_END_REQ;
+    sock_shm_unlock( shm_mutex, &sigset );
 
     /* the server currently will never succeed immediately */
     assert(status == STATUS_ALERTED || status == STATUS_PENDING || NT_ERROR(status));
@@ -1142,7 +1264,7 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
 }
 
 static NTSTATUS sock_ioctl_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
-                                 IO_STATUS_BLOCK *io, int fd, const void *buffers_ptr, unsigned int count,
+                                 IO_STATUS_BLOCK *io, int fd, ULONG options, const void *buffers_ptr, unsigned int count,
                                  const struct WS_sockaddr *addr, unsigned int addr_len, int unix_flags, int force_async )
 {
     struct async_send_ioctl *async;
@@ -1181,11 +1303,11 @@ static NTSTATUS sock_ioctl_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
     async->iov_cursor = 0;
     async->sent_len = 0;
 
-    return sock_send( handle, event, apc, apc_user, io, fd, async, force_async );
+    return sock_send( handle, event, apc, apc_user, io, fd, options, async, force_async );
 }
 
 
-NTSTATUS sock_write( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
+NTSTATUS sock_write( HANDLE handle, int fd, ULONG options, HANDLE event, PIO_APC_ROUTINE apc,
                      void *apc_user, IO_STATUS_BLOCK *io, const void *buffer, ULONG length )
 {
     static const DWORD async_size = offsetof( struct async_send_ioctl, iov[1] );
@@ -1203,7 +1325,7 @@ NTSTATUS sock_write( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
     async->iov_cursor = 0;
     async->sent_len = 0;
 
-    return sock_send( handle, event, apc, apc_user, io, fd, async, 1 );
+    return sock_send( handle, event, apc, apc_user, io, fd, options, async, 1 );
 }
 
 
@@ -1319,10 +1441,13 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
     int file_fd, file_needs_close = FALSE;
     struct async_transmit_ioctl *async;
     enum server_fd_type file_type;
+    pthread_mutex_t *shm_mutex;
     union unix_sockaddr addr;
+    unsigned int shm_flags;
     socklen_t addr_len;
     HANDLE wait_handle;
     unsigned int status;
+    sigset_t sigset;
     ULONG options;
 
     addr_len = sizeof(addr);
@@ -1365,6 +1490,7 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
     async->tail_len = params->tail_len;
     async->offset = params->offset;
 
+    shm_mutex = sock_shm_lock( handle, &shm_flags, &sigset );
     SERVER_START_REQ( send_socket )
     {
         req->force_async = 1;
@@ -1374,6 +1500,7 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
         options     = reply->options;
     }
     SERVER_END_REQ;
+    sock_shm_unlock( shm_mutex, &sigset );
 
     /* the server currently will never succeed immediately */
     assert(status == STATUS_ALERTED || status == STATUS_PENDING || NT_ERROR(status));
@@ -1553,7 +1680,7 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
             struct afd_recv_params params;
             int unix_flags = 0;
 
-            if ((status = server_get_unix_fd( handle, 0, &fd, &needs_close, NULL, NULL )))
+            if ((status = server_get_unix_fd( handle, 0, &fd, &needs_close, NULL, &options )))
                 return status;
 
             if (out_size) FIXME( "unexpected output size %u\n", out_size );
@@ -1602,7 +1729,7 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
                 unix_flags |= MSG_PEEK;
             if (params.msg_flags & AFD_MSG_WAITALL)
                 FIXME( "MSG_WAITALL is not supported\n" );
-            status = sock_ioctl_recv( handle, event, apc, apc_user, io, fd, params.buffers, params.count, NULL,
+            status = sock_ioctl_recv( handle, event, apc, apc_user, io, fd, options, params.buffers, params.count, NULL,
                                       NULL, NULL, NULL, unix_flags, !!(params.recv_flags & AFD_RECV_FORCE_ASYNC) );
             if (needs_close) close( fd );
             return status;
@@ -1614,7 +1741,7 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
             unsigned int *ws_flags = u64_to_user_ptr(params->ws_flags_ptr);
             int unix_flags = 0;
 
-            if ((status = server_get_unix_fd( handle, 0, &fd, &needs_close, NULL, NULL )))
+            if ((status = server_get_unix_fd( handle, 0, &fd, &needs_close, NULL, &options )))
                 return status;
 
             if (in_size < sizeof(*params))
@@ -1629,7 +1756,7 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
                 unix_flags |= MSG_PEEK;
             if (*ws_flags & WS_MSG_WAITALL)
                 FIXME( "MSG_WAITALL is not supported\n" );
-            status = sock_ioctl_recv( handle, event, apc, apc_user, io, fd, u64_to_user_ptr(params->buffers_ptr),
+            status = sock_ioctl_recv( handle, event, apc, apc_user, io, fd, options, u64_to_user_ptr(params->buffers_ptr),
                                       params->count, u64_to_user_ptr(params->control_ptr),
                                       u64_to_user_ptr(params->addr_ptr), u64_to_user_ptr(params->addr_len_ptr),
                                       ws_flags, unix_flags, params->force_async );
@@ -1642,7 +1769,7 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
             const struct afd_sendmsg_params *params = in_buffer;
             int unix_flags = 0;
 
-            if ((status = server_get_unix_fd( handle, 0, &fd, &needs_close, NULL, NULL )))
+            if ((status = server_get_unix_fd( handle, 0, &fd, &needs_close, NULL, &options )))
                 return status;
 
             if (in_size < sizeof(*params))
@@ -1657,7 +1784,7 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
                 WARN( "ignoring MSG_PARTIAL\n" );
             if (params->ws_flags & ~(WS_MSG_OOB | WS_MSG_PARTIAL))
                 FIXME( "unknown flags %#x\n", params->ws_flags );
-            status = sock_ioctl_send( handle, event, apc, apc_user, io, fd, u64_to_user_ptr( params->buffers_ptr ),
+            status = sock_ioctl_send( handle, event, apc, apc_user, io, fd, options, u64_to_user_ptr( params->buffers_ptr ),
                                       params->count, u64_to_user_ptr( params->addr_ptr ), params->addr_len,
                                       unix_flags, params->force_async );
             if (needs_close) close( fd );
@@ -112,6 +112,7 @@ struct ntdll_thread_data
     PRTL_THREAD_START_ROUTINE start;  /* thread entry point */
     void              *param;         /* thread entry point parameter */
     void              *jmp_buf;       /* setjmp buffer for exception handling */
+    request_shm_slot_t *request_slot; /* shared memory request slot, if any */
 };
 
 C_ASSERT( sizeof(struct ntdll_thread_data) <= sizeof(((TEB *)0)->GdiTebBatch) );
@@ -216,6 +217,10 @@ extern unsigned int server_queue_process_apc( HANDLE process, const apc_call_t *
                                               apc_result_t *result );
 extern int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
                                int *needs_close, enum server_fd_type *type, unsigned int *options );
+extern fast_sync_shm_t *server_map_fast_sync(void);
+extern NTSTATUS server_get_fast_sync_obj( HANDLE handle, const fast_sync_shm_t *objects,
+                                          unsigned int *index, int *type, unsigned int *access );
+extern NTSTATUS server_get_socket_shm( HANDLE handle, unsigned int *index );
 extern void wine_server_send_fd( int fd );
 extern void process_exit_wrapper( int status ) DECLSPEC_NORETURN;
 extern size_t server_init_process(void);
@@ -335,9 +340,9 @@ extern NTSTATUS serial_DeviceIoControl( HANDLE device, HANDLE event, PIO_APC_ROU
 extern NTSTATUS serial_FlushBuffersFile( int fd );
 extern NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user, IO_STATUS_BLOCK *io,
                             UINT code, void *in_buffer, UINT in_size, void *out_buffer, UINT out_size );
-extern NTSTATUS sock_read( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+extern NTSTATUS sock_read( HANDLE handle, int fd, ULONG options, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
                            IO_STATUS_BLOCK *io, void *buffer, ULONG length );
-extern NTSTATUS sock_write( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+extern NTSTATUS sock_write( HANDLE handle, int fd, ULONG options, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
                             IO_STATUS_BLOCK *io, const void *buffer, ULONG length );
 extern NTSTATUS tape_DeviceIoControl( HANDLE device, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
                                       IO_STATUS_BLOCK *io, UINT code, void *in_buffer,
@@ -361,6 +366,14 @@ extern void file_complete_async( HANDLE handle, unsigned int options, HANDLE eve
 extern void set_async_direct_result( HANDLE *async_handle, unsigned int options, IO_STATUS_BLOCK *io,
                                      NTSTATUS status, ULONG_PTR information, BOOL mark_pending );
 
+extern void fast_sync_init(void);
+extern NTSTATUS fast_sync_set_event( HANDLE handle, LONG *prev_state );
+extern NTSTATUS fast_sync_reset_event( HANDLE handle, LONG *prev_state );
+extern NTSTATUS fast_sync_release_semaphore( HANDLE handle, ULONG count, ULONG *prev_count );
+extern NTSTATUS fast_sync_release_mutex( HANDLE handle, LONG *prev_count );
+extern NTSTATUS fast_sync_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any, BOOLEAN alertable,
+                                const LARGE_INTEGER *timeout );
+
 extern NTSTATUS unixcall_wine_dbg_write( void *args );
 extern NTSTATUS unixcall_wine_server_call( void *args );
 extern NTSTATUS unixcall_wine_server_fd_to_handle( void *args );
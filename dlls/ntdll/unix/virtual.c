@@ -2730,11 +2730,13 @@ static IMAGE_BASE_RELOCATION *process_relocation_block( char *page, IMAGE_BASE_R
  *           map_image_into_view
  *
  * Map an executable (PE format) image into an existing view.
+ * If reloc_fd is valid, it contains the pages changed by the relocation, as built by the server.
  * virtual_mutex must be held by caller.
  */
 static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filename, int fd,
-                                     pe_image_info_t *image_info, USHORT machine,
-                                     int shared_fd, BOOL removable )
+                                     pe_image_info_t *image_info, USHORT machine, int shared_fd,
+                                     int reloc_fd, const unsigned int *reloc_pages, unsigned int reloc_count,
+                                     BOOL removable )
 {
     IMAGE_DOS_HEADER *dos;
     IMAGE_NT_HEADERS *nt;
@@ -2799,7 +2801,6 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
         return STATUS_SUCCESS;
     }
 
-
     /* map all the sections */
 
     for (i = pos = 0; i < nt->FileHeader.NumberOfSections; i++, sec++)
@@ -2914,18 +2915,38 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
         TRACE_(module)( "relocating %s dynamic base %lx -> %lx mapped at %p\n", debugstr_w(filename),
                         (ULONG_PTR)image_info->base, (ULONG_PTR)image_info->map_addr, ptr );
 
-        if (nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
-            ((IMAGE_NT_HEADERS64 *)nt)->OptionalHeader.ImageBase = image_info->map_addr;
-        else
-            ((IMAGE_NT_HEADERS32 *)nt)->OptionalHeader.ImageBase = image_info->map_addr;
+        if (reloc_fd != -1)
+        {
+            unsigned int first, count;
 
-        if ((dir = get_data_dir( nt, total_size, IMAGE_DIRECTORY_ENTRY_BASERELOC )))
+            /* map the pages relocated by the server over the sections, in runs of consecutive pages */
+            for (first = 0; first < reloc_count; first += count)
+            {
+                for (count = 1; first + count < reloc_count; count++)
+                    if (reloc_pages[first + count] != reloc_pages[first] + (count << page_shift)) break;
+                if (reloc_pages[first] >= total_size || (count << page_shift) > total_size - reloc_pages[first])
+                    return status;
+                if (map_file_into_view( view, reloc_fd, reloc_pages[first], count << page_shift,
+                                        (off_t)first << page_shift,
+                                        VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE ) != STATUS_SUCCESS)
+                    return status;
+            }
+        }
+        else
         {
-            IMAGE_BASE_RELOCATION *rel = (IMAGE_BASE_RELOCATION *)(ptr + dir->VirtualAddress);
-            IMAGE_BASE_RELOCATION *end = (IMAGE_BASE_RELOCATION *)((char *)rel + dir->Size);
+            if (nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+                ((IMAGE_NT_HEADERS64 *)nt)->OptionalHeader.ImageBase = image_info->map_addr;
+            else
+                ((IMAGE_NT_HEADERS32 *)nt)->OptionalHeader.ImageBase = image_info->map_addr;
 
-            while (rel && rel < end - 1 && rel->SizeOfBlock && rel->VirtualAddress < total_size)
-                rel = process_relocation_block( ptr + rel->VirtualAddress, rel, delta );
+            if ((dir = get_data_dir( nt, total_size, IMAGE_DIRECTORY_ENTRY_BASERELOC )))
+            {
+                IMAGE_BASE_RELOCATION *rel = (IMAGE_BASE_RELOCATION *)(ptr + dir->VirtualAddress);
+                IMAGE_BASE_RELOCATION *end = (IMAGE_BASE_RELOCATION *)((char *)rel + dir->Size);
+
+                while (rel && rel < end - 1 && rel->SizeOfBlock && rel->VirtualAddress < total_size)
+                    rel = process_relocation_block( ptr + rel->VirtualAddress, rel, delta );
+            }
         }
     }
 
@@ -3068,6 +3089,56 @@ static NTSTATUS map_image_view( struct file_view **view_ret, pe_image_info_t *im
 }
 
 
+/***********************************************************************
+ *             get_reloc_image
+ *
+ * Get the pages of the image relocated by the server, if the image can be shared.
+ * Returns the unix fd of the file holding the pages, or -1.
+ */
+static int get_reloc_image( HANDLE mapping, const pe_image_info_t *image_info, HANDLE shared_file,
+                            int *needs_close, unsigned int **pages, unsigned int *count )
+{
+    static BOOL disabled;
+    unsigned int status, size;
+    HANDLE data = 0;
+    int fd;
+
+    if (disabled) return -1;
+    if (shared_file) return -1;
+    if (image_info->image_flags & IMAGE_FLAGS_ImageMappedFlat) return -1;
+    if (!image_info->map_addr || image_info->map_addr == image_info->base) return -1;
+#ifdef __aarch64__
+    /* ARM64X and ARM64EC fixups depend on the process machine */
+    if (image_info->machine == IMAGE_FILE_MACHINE_ARM64 || image_info->machine == IMAGE_FILE_MACHINE_AMD64)
+        return -1;
+#endif
+
+    size = ROUND_SIZE( 0, image_info->map_size ) >> page_shift;
+    if (!(*pages = malloc( size * sizeof(**pages) ))) return -1;
+
+    SERVER_START_REQ( get_image_reloc_data )
+    {
+        req->handle = wine_server_obj_handle( mapping );
+        req->base   = image_info->map_addr;
+        wine_server_set_reply( req, *pages, size * sizeof(**pages) );
+        status = wine_server_call( req );
+        data   = wine_server_ptr_handle( reply->data );
+        *count = wine_server_reply_size( reply ) / sizeof(**pages);
+    }
+    SERVER_END_REQ;
+    if (status == STATUS_NOT_SUPPORTED) disabled = TRUE;
+
+    if (!data || server_get_unix_fd( data, FILE_READ_DATA, &fd, needs_close, NULL, NULL )) fd = -1;
+    if (data) NtClose( data );
+    if (fd == -1)
+    {
+        free( *pages );
+        *pages = NULL;
+    }
+    return fd;
+}
+
+
 /***********************************************************************
  *             virtual_map_image
  *
@@ -3080,6 +3151,8 @@ static NTSTATUS virtual_map_image( HANDLE mapping, void **addr_ptr, SIZE_T *size
 {
     int unix_fd = -1, needs_close;
     int shared_fd = -1, shared_needs_close = 0;
+    int reloc_fd, reloc_needs_close = 0;
+    unsigned int *reloc_pages = NULL, reloc_count = 0;
     SIZE_T size = image_info->map_size;
     struct file_view *view;
     unsigned int status;
@@ -3107,12 +3180,15 @@ static NTSTATUS virtual_map_image( HANDLE mapping, void **addr_ptr, SIZE_T *size
         SERVER_END_REQ;
     }
 
+    reloc_fd = get_reloc_image( mapping, image_info, shared_file, &reloc_needs_close, &reloc_pages, &reloc_count );
+
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
     status = map_image_view( &view, image_info, size, limit_low, limit_high, alloc_type );
     if (status) goto done;
 
-    status = map_image_into_view( view, filename, unix_fd, image_info, machine, shared_fd, needs_close );
+    status = map_image_into_view( view, filename, unix_fd, image_info, machine, shared_fd,
+                                  reloc_fd, reloc_pages, reloc_count, needs_close );
     if (status == STATUS_SUCCESS)
     {
         SERVER_START_REQ( map_image_view )
@@ -3139,6 +3215,8 @@ done:
     server_leave_uninterrupted_section( &virtual_mutex, &sigset );
     if (needs_close) close( unix_fd );
     if (shared_needs_close) close( shared_fd );
+    if (reloc_needs_close) close( reloc_fd );
+    free( reloc_pages );
     return status;
 }
 
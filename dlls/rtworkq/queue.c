@@ -125,10 +125,17 @@ enum work_item_type
     WORK_ITEM_WAIT,
 };
 
+struct work_node
+{
+    struct work_node *volatile next;
+};
+
 struct work_item
 {
     IUnknown IUnknown_iface;
     LONG refcount;
+    SLIST_ENTRY pool_entry;
+    struct work_node node;
     struct list entry;
     IRtwqAsyncResult *result;
     IRtwqAsyncResult *reply_result;
@@ -136,16 +143,19 @@ struct work_item
     RTWQWORKITEM_KEY key;
     LONG priority;
     DWORD flags;
-    PTP_SIMPLE_CALLBACK finalization_callback;
+    void (*completed)(struct work_item *item);
     enum work_item_type type;
     union
     {
-        TP_WORK *work_object;
         TP_WAIT *wait_object;
         TP_TIMER *timer_object;
     } u;
 };
 
+/* Released work items are kept around for reuse, up to this count. */
+#define MAX_POOLED_WORK_ITEMS 256
+static SLIST_HEADER work_item_pool;
+
 static struct work_item *work_item_impl_from_IUnknown(IUnknown *iface)
 {
     return CONTAINING_RECORD(iface, struct work_item, IUnknown_iface);
@@ -175,17 +185,30 @@ struct queue_desc
     DWORD target_queue;
 };
 
+/* Multiple producer, single consumer list of submitted work items. Producers never block, a
+ * single threadpool work object per priority runs one callback for each submitted item, and the
+ * callbacks take turns at the consumer end. */
+struct work_queue
+{
+    struct work_node *volatile tail;
+    struct work_node *head;
+    struct work_node stub;
+    SRWLOCK consumer_lock;
+    TP_WORK *work;
+};
+
 struct queue
 {
     IRtwqAsyncCallback IRtwqAsyncCallback_iface;
     const struct queue_ops *ops;
     TP_POOL *pool;
     TP_CALLBACK_ENVIRON_V3 envs[ARRAY_SIZE(priorities)];
+    struct work_queue work_queues[ARRAY_SIZE(priorities)];
     CRITICAL_SECTION cs;
     struct list pending_items;
     DWORD id;
     /* Data used for serial queues only. */
-    PTP_SIMPLE_CALLBACK finalization_callback;
+    void (*completed)(struct work_item *item);
     DWORD target_queue;
 };
 
@@ -312,10 +335,78 @@ static struct queue *get_system_queue(DWORD queue_id)
 
 static HRESULT grab_queue(DWORD queue_id, struct queue **ret);
 
+static void work_queue_init(struct work_queue *queue)
+{
+    queue->stub.next = NULL;
+    queue->head = queue->tail = &queue->stub;
+    InitializeSRWLock(&queue->consumer_lock);
+}
+
+static void work_queue_push(struct work_queue *queue, struct work_node *node)
+{
+    struct work_node *prev;
+
+    node->next = NULL;
+    prev = InterlockedExchangePointer((void *volatile *)&queue->tail, node);
+    InterlockedExchangePointer((void *volatile *)&prev->next, node);
+}
+
+/* Must be called by a single consumer at a time. Returns NULL if the queue is empty, or if the
+ * next node is still being linked by its producer. */
+static struct work_node *work_queue_try_pop(struct work_queue *queue)
+{
+    struct work_node *head = queue->head, *next = head->next;
+
+    if (head == &queue->stub)
+    {
+        if (!next) return NULL;
+        queue->head = head = next;
+        next = head->next;
+    }
+
+    if (next)
+    {
+        queue->head = next;
+        return head;
+    }
+
+    if (head != queue->tail) return NULL;
+
+    /* The last node can only be removed once the stub is queued behind it. */
+    work_queue_push(queue, &queue->stub);
+    if ((next = head->next))
+    {
+        queue->head = next;
+        return head;
+    }
+
+    return NULL;
+}
+
+static struct work_item *work_queue_pop(struct work_queue *queue)
+{
+    struct work_node *node;
+    unsigned int spin = 0;
+
+    AcquireSRWLockExclusive(&queue->consumer_lock);
+    /* Callbacks are submitted after their item is pushed, there's always one for us, but its
+     * producer may have been preempted before linking it. */
+    while (!(node = work_queue_try_pop(queue)))
+    {
+        if (++spin < 64) YieldProcessor();
+        else SwitchToThread();
+    }
+    ReleaseSRWLockExclusive(&queue->consumer_lock);
+
+    return CONTAINING_RECORD(node, struct work_item, node);
+}
+
 static void CALLBACK standard_queue_cleanup_callback(void *object_data, void *group_data)
 {
 }
 
+static void CALLBACK standard_queue_worker(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work);
+
 static HRESULT pool_queue_init(const struct queue_desc *desc, struct queue *queue)
 {
     TP_CALLBACK_ENVIRON_V3 env;
@@ -338,6 +429,13 @@ static HRESULT pool_queue_init(const struct queue_desc *desc, struct queue *queu
     list_init(&queue->pending_items);
     InitializeCriticalSection(&queue->cs);
 
+    for (i = 0; i < ARRAY_SIZE(queue->work_queues); ++i)
+    {
+        work_queue_init(&queue->work_queues[i]);
+        queue->work_queues[i].work = CreateThreadpoolWork(standard_queue_worker, &queue->work_queues[i],
+                (TP_CALLBACK_ENVIRON *)&queue->envs[i]);
+    }
+
     max_thread = (desc->queue_type == RTWQ_STANDARD_WORKQUEUE || desc->queue_type == RTWQ_WINDOW_WORKQUEUE) ? 1 : 4;
 
     SetThreadpoolThreadMinimum(queue->pool, 1);
@@ -351,6 +449,9 @@ static HRESULT pool_queue_init(const struct queue_desc *desc, struct queue *queu
 
 static BOOL pool_queue_shutdown(struct queue *queue)
 {
+    struct work_node *node;
+    unsigned int i;
+
     if (!queue->pool)
         return FALSE;
 
@@ -358,12 +459,19 @@ static BOOL pool_queue_shutdown(struct queue *queue)
     CloseThreadpool(queue->pool);
     queue->pool = NULL;
 
+    /* Release items which callbacks have been canceled. */
+    for (i = 0; i < ARRAY_SIZE(queue->work_queues); ++i)
+    {
+        while ((node = work_queue_try_pop(&queue->work_queues[i])))
+            IUnknown_Release(&CONTAINING_RECORD(node, struct work_item, node)->IUnknown_iface);
+    }
+
     return TRUE;
 }
 
 static void CALLBACK standard_queue_worker(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work)
 {
-    struct work_item *item = context;
+    struct work_item *item = work_queue_pop(context);
     RTWQASYNCRESULT *result = (RTWQASYNCRESULT *)item->result;
 
     TRACE("result object %p.\n", result);
@@ -374,13 +482,17 @@ static void CALLBACK standard_queue_worker(TP_CALLBACK_INSTANCE *instance, void
 
     IRtwqAsyncCallback_Invoke(result->pCallback, item->reply_result ? item->reply_result : item->result);
 
+    /* Serial queues are advanced right from the worker. */
+    if (item->completed)
+        item->completed(item);
+
     IUnknown_Release(&item->IUnknown_iface);
 }
 
 static void pool_queue_submit(struct queue *queue, struct work_item *item)
 {
     TP_CALLBACK_PRIORITY callback_priority;
-    TP_CALLBACK_ENVIRON_V3 env;
+    struct work_queue *work_queue;
 
     if (item->priority == 0)
         callback_priority = TP_CALLBACK_PRIORITY_NORMAL;
@@ -389,15 +501,10 @@ static void pool_queue_submit(struct queue *queue, struct work_item *item)
     else
         callback_priority = TP_CALLBACK_PRIORITY_HIGH;
 
-    env = queue->envs[callback_priority];
-    env.FinalizationCallback = item->finalization_callback;
-    /* Worker pool callback will release one reference. Grab one more to keep object alive when
-       we need finalization callback. */
-    if (item->finalization_callback)
-        IUnknown_AddRef(&item->IUnknown_iface);
-    item->u.work_object = CreateThreadpoolWork(standard_queue_worker, item, (TP_CALLBACK_ENVIRON *)&env);
+    work_queue = &queue->work_queues[callback_priority];
     item->type = WORK_ITEM_WORK;
-    SubmitThreadpoolWork(item->u.work_object);
+    work_queue_push(work_queue, &item->node);
+    SubmitThreadpoolWork(work_queue->work);
 
     TRACE("dispatched %p.\n", item->result);
 }
@@ -420,10 +527,10 @@ static struct work_item * serial_queue_get_next(struct queue *queue, struct work
     return next_item;
 }
 
-static void CALLBACK serial_queue_finalization_callback(PTP_CALLBACK_INSTANCE instance, void *user_data)
+static void serial_queue_item_completed(struct work_item *item)
 {
-    struct work_item *item = (struct work_item *)user_data, *next_item;
     struct queue *target_queue, *queue = item->queue;
+    struct work_item *next_item;
     HRESULT hr;
 
     EnterCriticalSection(&queue->cs);
@@ -437,8 +544,6 @@ static void CALLBACK serial_queue_finalization_callback(PTP_CALLBACK_INSTANCE in
     }
 
     LeaveCriticalSection(&queue->cs);
-
-    IUnknown_Release(&item->IUnknown_iface);
 }
 
 static HRESULT serial_queue_init(const struct queue_desc *desc, struct queue *queue)
@@ -446,7 +551,7 @@ static HRESULT serial_queue_init(const struct queue_desc *desc, struct queue *qu
     queue->IRtwqAsyncCallback_iface.lpVtbl = &queue_serial_callback_vtbl;
     queue->target_queue = desc->target_queue;
     lock_user_queue(queue->target_queue);
-    queue->finalization_callback = serial_queue_finalization_callback;
+    queue->completed = serial_queue_item_completed;
 
     return S_OK;
 }
@@ -480,7 +585,7 @@ static void serial_queue_submit(struct queue *queue, struct work_item *item)
     HRESULT hr;
 
     /* In reply mode queue will advance when 'reply_result' is invoked, in regular mode it will advance automatically,
-       via finalization callback. */
+       once the item has been executed. */
 
     if (item->flags & RTWQ_REPLY_CALLBACK)
     {
@@ -488,7 +593,7 @@ static void serial_queue_submit(struct queue *queue, struct work_item *item)
             WARN("Failed to create reply object, hr %#lx.\n", hr);
     }
     else
-        item->finalization_callback = queue->finalization_callback;
+        item->completed = queue->completed;
 
     /* Serial queues could be chained together, detach from current queue before transitioning item to this one.
        Items are not detached when submitted to pool queues, because pool queues won't forward them further. */
@@ -561,7 +666,6 @@ static ULONG WINAPI work_item_Release(IUnknown *iface)
         switch (item->type)
         {
             case WORK_ITEM_WORK:
-                if (item->u.work_object) CloseThreadpoolWork(item->u.work_object);
                 break;
             case WORK_ITEM_WAIT:
                 if (item->u.wait_object) CloseThreadpoolWait(item->u.wait_object);
@@ -573,7 +677,11 @@ static ULONG WINAPI work_item_Release(IUnknown *iface)
         if (item->reply_result)
             IRtwqAsyncResult_Release(item->reply_result);
         IRtwqAsyncResult_Release(item->result);
-        free(item);
+
+        if (QueryDepthSList(&work_item_pool) < MAX_POOLED_WORK_ITEMS)
+            InterlockedPushEntrySList(&work_item_pool, &item->pool_entry);
+        else
+            free(item);
     }
 
     return refcount;
@@ -591,8 +699,13 @@ static struct work_item * alloc_work_item(struct queue *queue, LONG priority, IR
     RTWQASYNCRESULT *async_result = (RTWQASYNCRESULT *)result;
     DWORD flags = 0, queue_id = 0;
     struct work_item *item;
+    SLIST_ENTRY *entry;
 
-    item = calloc(1, sizeof(*item));
+    if ((entry = InterlockedPopEntrySList(&work_item_pool)))
+        item = CONTAINING_RECORD(entry, struct work_item, pool_entry);
+    else if (!(item = malloc(sizeof(*item))))
+        return NULL;
+    memset(item, 0, sizeof(*item));
 
     item->IUnknown_iface.lpVtbl = &work_item_vtbl;
     item->result = result;
@@ -1216,6 +1329,7 @@ HRESULT WINAPI RtwqStartup(void)
 
 static void shutdown_system_queues(void)
 {
+    SLIST_ENTRY *entry, *next;
     unsigned int i;
     HRESULT hr;
 
@@ -1226,6 +1340,12 @@ static void shutdown_system_queues(void)
         shutdown_queue(&system_queues[i]);
     }
 
+    for (entry = InterlockedFlushSList(&work_item_pool); entry; entry = next)
+    {
+        next = entry->Next;
+        free(CONTAINING_RECORD(entry, struct work_item, pool_entry));
+    }
+
     if (FAILED(hr = CoDecrementMTAUsage(mta_cookie)))
         WARN("Failed to uninitialize MTA, hr %#lx.\n", hr);
 
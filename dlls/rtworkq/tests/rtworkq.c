@@ -19,8 +19,11 @@
 #include <stdarg.h>
 #include <string.h>
 
+#define COBJMACROS
+
 #include "windef.h"
 #include "winbase.h"
+#include "initguid.h"
 #include "rtworkq.h"
 
 #include "wine/test.h"
@@ -101,7 +104,176 @@ static void test_platform_init(void)
     ok(hr == S_OK, "Failed to shut down, hr %#lx.\n", hr);
 }
 
+struct test_callback
+{
+    IRtwqAsyncCallback IRtwqAsyncCallback_iface;
+    LONG refcount;
+    LONG count;
+    LONG expected;
+    LONG concurrent;
+    BOOL overlapped;
+    HANDLE event;
+};
+
+static struct test_callback *impl_from_IRtwqAsyncCallback(IRtwqAsyncCallback *iface)
+{
+    return CONTAINING_RECORD(iface, struct test_callback, IRtwqAsyncCallback_iface);
+}
+
+static HRESULT WINAPI test_callback_QueryInterface(IRtwqAsyncCallback *iface, REFIID riid, void **obj)
+{
+    if (IsEqualIID(riid, &IID_IRtwqAsyncCallback) ||
+            IsEqualIID(riid, &IID_IUnknown))
+    {
+        *obj = iface;
+        IRtwqAsyncCallback_AddRef(iface);
+        return S_OK;
+    }
+
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI test_callback_AddRef(IRtwqAsyncCallback *iface)
+{
+    struct test_callback *callback = impl_from_IRtwqAsyncCallback(iface);
+    return InterlockedIncrement(&callback->refcount);
+}
+
+static ULONG WINAPI test_callback_Release(IRtwqAsyncCallback *iface)
+{
+    struct test_callback *callback = impl_from_IRtwqAsyncCallback(iface);
+    return InterlockedDecrement(&callback->refcount);
+}
+
+static HRESULT WINAPI test_callback_GetParameters(IRtwqAsyncCallback *iface, DWORD *flags, DWORD *queue)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI test_callback_Invoke(IRtwqAsyncCallback *iface, IRtwqAsyncResult *result)
+{
+    struct test_callback *callback = impl_from_IRtwqAsyncCallback(iface);
+    unsigned int i;
+
+    if (InterlockedIncrement(&callback->concurrent) > 1)
+        callback->overlapped = TRUE;
+    /* Stay in the callback for a while, so that an overlapping one has a chance to see the count. */
+    for (i = 0; i < 2000; ++i)
+        YieldProcessor();
+    InterlockedDecrement(&callback->concurrent);
+
+    if (InterlockedIncrement(&callback->count) == callback->expected)
+        SetEvent(callback->event);
+
+    return S_OK;
+}
+
+static const IRtwqAsyncCallbackVtbl test_callback_vtbl =
+{
+    test_callback_QueryInterface,
+    test_callback_AddRef,
+    test_callback_Release,
+    test_callback_GetParameters,
+    test_callback_Invoke,
+};
+
+static void init_test_callback(struct test_callback *callback)
+{
+    memset(callback, 0, sizeof(*callback));
+    callback->IRtwqAsyncCallback_iface.lpVtbl = &test_callback_vtbl;
+    callback->refcount = 1;
+    callback->event = CreateEventW(NULL, FALSE, FALSE, NULL);
+}
+
+static void run_queue_benchmark(const char *name, DWORD queue, BOOL serial)
+{
+    static const unsigned int item_count = 10000, round_trips = 200;
+    LARGE_INTEGER frequency, start, end;
+    struct test_callback callback;
+    IRtwqAsyncResult *result;
+    unsigned int i;
+    HRESULT hr;
+    DWORD ret;
+
+    QueryPerformanceFrequency(&frequency);
+    init_test_callback(&callback);
+
+    hr = RtwqCreateAsyncResult(NULL, &callback.IRtwqAsyncCallback_iface, NULL, &result);
+    ok(hr == S_OK, "Failed to create result object, hr %#lx.\n", hr);
+
+    /* Throughput, all items queued at once. */
+    callback.expected = item_count;
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < item_count; ++i)
+    {
+        hr = RtwqPutWorkItem(queue, 0, result);
+        if (FAILED(hr)) break;
+    }
+    ok(hr == S_OK, "Failed to submit item %u, hr %#lx.\n", i, hr);
+    ret = WaitForSingleObject(callback.event, 30000);
+    QueryPerformanceCounter(&end);
+    ok(ret == WAIT_OBJECT_0, "Unexpected wait result %#lx.\n", ret);
+    ok(callback.count == item_count, "Unexpected invocation count %ld.\n", callback.count);
+    if (serial)
+        ok(!callback.overlapped, "Serial queue items were executed concurrently.\n");
+    trace("%s queue: %u items in %.2f ms.\n", name, item_count,
+            (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart);
+
+    /* Latency, single round trips. */
+    callback.expected = 1;
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < round_trips; ++i)
+    {
+        callback.count = 0;
+        hr = RtwqPutWorkItem(queue, 0, result);
+        ok(hr == S_OK, "Failed to submit item, hr %#lx.\n", hr);
+        ret = WaitForSingleObject(callback.event, 1000);
+        if (ret != WAIT_OBJECT_0) break;
+    }
+    QueryPerformanceCounter(&end);
+    ok(ret == WAIT_OBJECT_0, "Unexpected wait result %#lx.\n", ret);
+    trace("%s queue: %.2f us average round trip.\n", name,
+            (end.QuadPart - start.QuadPart) * 1000000.0 / frequency.QuadPart / round_trips);
+
+    IRtwqAsyncResult_Release(result);
+    CloseHandle(callback.event);
+}
+
+static void test_queue_throughput(void)
+{
+    DWORD queue, serial_queue;
+    HRESULT hr;
+
+    hr = RtwqStartup();
+    ok(hr == S_OK, "Failed to start up, hr %#lx.\n", hr);
+
+    hr = RtwqAllocateWorkQueue(RTWQ_STANDARD_WORKQUEUE, &queue);
+    ok(hr == S_OK, "Failed to allocate a queue, hr %#lx.\n", hr);
+    run_queue_benchmark("standard", queue, TRUE);
+
+    hr = RtwqAllocateSerialWorkQueue(queue, &serial_queue);
+    ok(hr == S_OK, "Failed to allocate a queue, hr %#lx.\n", hr);
+    run_queue_benchmark("serial", serial_queue, TRUE);
+
+    hr = RtwqUnlockWorkQueue(serial_queue);
+    ok(hr == S_OK, "Failed to unlock the queue, hr %#lx.\n", hr);
+    hr = RtwqUnlockWorkQueue(queue);
+    ok(hr == S_OK, "Failed to unlock the queue, hr %#lx.\n", hr);
+
+    hr = RtwqAllocateWorkQueue(RTWQ_MULTITHREADED_WORKQUEUE, &queue);
+    ok(hr == S_OK, "Failed to allocate a queue, hr %#lx.\n", hr);
+    run_queue_benchmark("multithreaded", queue, FALSE);
+
+    hr = RtwqUnlockWorkQueue(queue);
+    ok(hr == S_OK, "Failed to unlock the queue, hr %#lx.\n", hr);
+
+    hr = RtwqShutdown();
+    ok(hr == S_OK, "Failed to shut down, hr %#lx.\n", hr);
+}
+
 START_TEST(rtworkq)
 {
     test_platform_init();
+    test_queue_throughput();
 }
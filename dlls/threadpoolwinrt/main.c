@@ -24,6 +24,7 @@
 #include "winbase.h"
 #include "winstring.h"
 #include "wine/debug.h"
+#include "wine/list.h"
 #include "objbase.h"
 
 #include "initguid.h"
@@ -284,6 +285,7 @@ static HRESULT async_action_create(IAsyncAction **ret)
 
 struct work_item
 {
+    struct list entry;
     IWorkItemHandler *handler;
     IAsyncAction *action;
 };
@@ -324,79 +326,227 @@ static void work_item_invoke_release(struct work_item *item)
     release_work_item(item);
 }
 
-static DWORD WINAPI sliced_thread_proc(void *arg)
+/* Items are queued per priority, and each priority has its own pool of workers
+ * so that queued or running lower priority items never delay more urgent ones.
+ * A queue is drained by a single TP_WORK object that is created once and
+ * submitted once per queued item. Workers are bumped to the item priority
+ * while running it, so that the scheduler can preempt lower priority items.
+ *
+ * Pools start with a fixed number of workers. Items may block for a long time,
+ * or wait for other queued items, so while items are pending a timer checks
+ * that workers keep picking them up, and adds a worker when they don't. The
+ * extra workers are given back once the queue is empty. */
+#define WORK_QUEUE_MAX_THREADS 500 /* same as the default thread pool */
+#define WORK_QUEUE_STARVATION_MS 100
+
+struct work_queue
 {
-    struct work_item *item = arg;
-    work_item_invoke_release(item);
-    return 0;
-}
+    SRWLOCK lock;
+    struct list items;
+    TP_POOL *pool;
+    TP_WORK *work;
+    TP_TIMER *timer;
+    BOOL timer_armed;
+    int thread_priority;
+    DWORD min_threads;
+    DWORD max_threads;
+    DWORD thread_count; /* current maximum, grows while items are starving */
+    LONG started;       /* number of items picked up by workers */
+    LONG last_started;
+};
 
 struct thread_pool
 {
     INIT_ONCE init_once;
-    TP_POOL *pool;
+    struct work_queue queues[3]; /* indexed by WorkItemPriority + 1 */
+};
+
+enum thread_pool_type
+{
+    THREAD_POOL_DEFAULT,
+    THREAD_POOL_TIME_SLICED,
 };
 
-static struct thread_pool pools[3];
+static struct thread_pool pools[2];
 
-static BOOL CALLBACK pool_init_once(INIT_ONCE *init_once, void *param, void **context)
+static void set_work_queue_timer(struct work_queue *queue)
 {
-    struct thread_pool *pool = param;
+    LARGE_INTEGER timeout = {.QuadPart = -(LONGLONG)WORK_QUEUE_STARVATION_MS * 10000};
+    FILETIME due;
 
-    if (!(pool->pool = CreateThreadpool(NULL))) return FALSE;
+    due.dwLowDateTime = timeout.u.LowPart;
+    due.dwHighDateTime = timeout.u.HighPart;
+    SetThreadpoolTimer(queue->timer, &due, 0, 0);
+}
 
-    SetThreadpoolThreadMaximum(pool->pool, 10);
+static void CALLBACK work_queue_timer_callback(TP_CALLBACK_INSTANCE *instance, void *context, TP_TIMER *timer)
+{
+    struct work_queue *queue = context;
+    LONG started = ReadNoFence(&queue->started);
 
-    return TRUE;
+    AcquireSRWLockExclusive(&queue->lock);
+    if (list_empty(&queue->items))
+    {
+        if (queue->thread_count != queue->max_threads)
+        {
+            TRACE("Queue %p drained, shrinking pool back to %lu threads.\n", queue, queue->max_threads);
+            queue->thread_count = queue->max_threads;
+            SetThreadpoolThreadMinimum(queue->pool, queue->min_threads);
+            SetThreadpoolThreadMaximum(queue->pool, queue->thread_count);
+        }
+        queue->timer_armed = FALSE;
+    }
+    else
+    {
+        /* no item was picked up since the last check, all workers are busy */
+        if (started == queue->last_started && queue->thread_count < WORK_QUEUE_MAX_THREADS)
+        {
+            queue->thread_count++;
+            TRACE("Queue %p is starving, growing pool to %lu threads.\n", queue, queue->thread_count);
+            SetThreadpoolThreadMaximum(queue->pool, queue->thread_count);
+            /* the pool only starts new workers on submission, force one now */
+            if (!SetThreadpoolThreadMinimum(queue->pool, queue->thread_count))
+                WARN("Failed to add a worker, error %lu.\n", GetLastError());
+        }
+        queue->last_started = started;
+        set_work_queue_timer(queue);
+    }
+    ReleaseSRWLockExclusive(&queue->lock);
 }
 
 static void CALLBACK pool_work_callback(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work)
 {
-    struct work_item *item = context;
+    struct work_queue *queue = context;
+    struct work_item *item;
+    struct list *entry;
+
+    AcquireSRWLockExclusive(&queue->lock);
+    if ((entry = list_head(&queue->items))) list_remove(entry);
+    ReleaseSRWLockExclusive(&queue->lock);
+
+    if (!entry)
+    {
+        ERR("Work submitted without a queued item.\n");
+        return;
+    }
+    item = LIST_ENTRY(entry, struct work_item, entry);
+    InterlockedIncrement(&queue->started);
+
+    if (queue->thread_priority != THREAD_PRIORITY_NORMAL)
+        SetThreadPriority(GetCurrentThread(), queue->thread_priority);
+
     work_item_invoke_release(item);
+
+    if (queue->thread_priority != THREAD_PRIORITY_NORMAL)
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
 }
 
-static HRESULT submit_threadpool_work(struct work_item *item, WorkItemPriority priority, IAsyncAction **action)
+static void destroy_work_queue(struct work_queue *queue)
 {
-    struct thread_pool *pool;
-    TP_WORK *work;
+    if (queue->timer) CloseThreadpoolTimer(queue->timer);
+    if (queue->work) CloseThreadpoolWork(queue->work);
+    if (queue->pool) CloseThreadpool(queue->pool);
+    memset(queue, 0, sizeof(*queue));
+}
 
-    assert(priority == WorkItemPriority_Low
-            || priority == WorkItemPriority_Normal
-            || priority == WorkItemPriority_High);
+static BOOL init_work_queue(struct work_queue *queue, int thread_priority, TP_CALLBACK_PRIORITY callback_priority,
+        BOOL time_sliced, DWORD cpu_count)
+{
+    TP_CALLBACK_ENVIRON_V3 environment;
 
-    pool = &pools[priority + 1];
+    InitializeSRWLock(&queue->lock);
+    list_init(&queue->items);
+    queue->thread_priority = thread_priority;
 
-    if (!InitOnceExecuteOnce(&pool->init_once, pool_init_once, pool, NULL))
-        return E_FAIL;
+    if (time_sliced)
+    {
+        /* Time-sliced items are expected to run for a long time, keep a few
+         * threads alive for them instead of spawning one thread per item. */
+        queue->min_threads = 2;
+        queue->max_threads = max(cpu_count, 4);
+    }
+    else
+    {
+        queue->min_threads = 1;
+        queue->max_threads = cpu_count;
+    }
+    queue->thread_count = queue->max_threads;
 
-    if (!(work = CreateThreadpoolWork(pool_work_callback, item, NULL)))
-        return E_FAIL;
+    if (!(queue->pool = CreateThreadpool(NULL))) return FALSE;
+    SetThreadpoolThreadMaximum(queue->pool, queue->max_threads);
+    SetThreadpoolThreadMinimum(queue->pool, queue->min_threads);
 
-    IAsyncAction_AddRef((*action = item->action));
-    SubmitThreadpoolWork(work);
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 3;
+    environment.Pool = queue->pool;
+    environment.CallbackPriority = callback_priority;
+    environment.Size = sizeof(environment);
+    environment.u.s.LongFunction = time_sliced;
 
-    return S_OK;
+    if (!(queue->work = CreateThreadpoolWork(pool_work_callback, queue, (TP_CALLBACK_ENVIRON *)&environment)))
+        return FALSE;
+    /* the timer runs on the default pool, it has to make progress while this one is stuck */
+    if (!(queue->timer = CreateThreadpoolTimer(work_queue_timer_callback, queue, NULL)))
+        return FALSE;
+
+    return TRUE;
 }
 
-static HRESULT submit_standalone_thread_work(struct work_item *item, WorkItemPriority priority, IAsyncAction **action)
+static BOOL CALLBACK pool_init_once(INIT_ONCE *init_once, void *param, void **context)
 {
-    HANDLE thread;
+    static const int thread_priorities[] = {THREAD_PRIORITY_LOWEST, THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_HIGHEST};
+    static const TP_CALLBACK_PRIORITY callback_priorities[] =
+            {TP_CALLBACK_PRIORITY_LOW, TP_CALLBACK_PRIORITY_NORMAL, TP_CALLBACK_PRIORITY_HIGH};
+    DWORD cpu_count = max(1, GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+    struct thread_pool *pool = param;
+    unsigned int i;
 
-    if (!(thread = CreateThread(NULL, 0, sliced_thread_proc, item, priority == WorkItemPriority_Normal ?
-            0 : CREATE_SUSPENDED, NULL)))
+    for (i = 0; i < ARRAY_SIZE(pool->queues); i++)
     {
-        WARN("Failed to create a thread, error %ld.\n", GetLastError());
-        return HRESULT_FROM_WIN32(GetLastError());
+        if (!init_work_queue(&pool->queues[i], thread_priorities[i], callback_priorities[i],
+                pool == &pools[THREAD_POOL_TIME_SLICED], cpu_count))
+        {
+            WARN("Failed to create work queue, error %ld.\n", GetLastError());
+            do destroy_work_queue(&pool->queues[i]); while (i--);
+            return FALSE;
+        }
     }
 
+    TRACE("Created pool %p, cpu count %lu.\n", pool, cpu_count);
+
+    return TRUE;
+}
+
+static HRESULT submit_threadpool_work(struct work_item *item, WorkItemPriority priority, WorkItemOptions options,
+        IAsyncAction **action)
+{
+    struct thread_pool *pool;
+    struct work_queue *queue;
+
+    assert(priority == WorkItemPriority_Low
+            || priority == WorkItemPriority_Normal
+            || priority == WorkItemPriority_High);
+
+    pool = &pools[options == WorkItemOptions_TimeSliced ? THREAD_POOL_TIME_SLICED : THREAD_POOL_DEFAULT];
+
+    if (!InitOnceExecuteOnce(&pool->init_once, pool_init_once, pool, NULL))
+        return E_FAIL;
+
+    queue = &pool->queues[priority + 1];
+
     IAsyncAction_AddRef((*action = item->action));
-    if (priority != WorkItemPriority_Normal)
+
+    AcquireSRWLockExclusive(&queue->lock);
+    list_add_tail(&queue->items, &item->entry);
+    if (!queue->timer_armed)
     {
-        SetThreadPriority(thread, priority == WorkItemPriority_High ? THREAD_PRIORITY_HIGHEST : THREAD_PRIORITY_LOWEST);
-        ResumeThread(thread);
+        queue->timer_armed = TRUE;
+        queue->last_started = ReadNoFence(&queue->started);
+        set_work_queue_timer(queue);
     }
-    CloseHandle(thread);
+    ReleaseSRWLockExclusive(&queue->lock);
+
+    SubmitThreadpoolWork(queue->work);
 
     return S_OK;
 }
@@ -418,12 +568,7 @@ static HRESULT run_async(IWorkItemHandler *handler, WorkItemPriority priority, W
     if (FAILED(hr = alloc_work_item(handler, &item)))
         return hr;
 
-    if (options == WorkItemOptions_TimeSliced)
-        hr = submit_standalone_thread_work(item, priority, action);
-    else
-        hr = submit_threadpool_work(item, priority, action);
-
-    if (FAILED(hr))
+    if (FAILED(hr = submit_threadpool_work(item, priority, options, action)))
         release_work_item(item);
 
     return hr;
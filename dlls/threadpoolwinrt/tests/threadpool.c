@@ -285,8 +285,220 @@ static void test_RunAsync(void)
     RoUninitialize();
 }
 
+struct counting_work_item
+{
+    IWorkItemHandler IWorkItemHandler_iface;
+    LONG refcount;
+    LONG remaining;
+    HANDLE event;
+    HANDLE wait;
+};
+
+static struct counting_work_item *impl_from_counting_IWorkItemHandler(IWorkItemHandler *iface)
+{
+    return CONTAINING_RECORD(iface, struct counting_work_item, IWorkItemHandler_iface);
+}
+
+static HRESULT STDMETHODCALLTYPE counting_work_item_QueryInterface(IWorkItemHandler *iface, REFIID riid, void **obj)
+{
+    if (IsEqualIID(riid, &IID_IWorkItemHandler)
+        || IsEqualIID(riid, &IID_IUnknown))
+    {
+        *obj = iface;
+        IWorkItemHandler_AddRef(iface);
+        return S_OK;
+    }
+
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE counting_work_item_AddRef(IWorkItemHandler *iface)
+{
+    struct counting_work_item *item = impl_from_counting_IWorkItemHandler(iface);
+    return InterlockedIncrement(&item->refcount);
+}
+
+static ULONG STDMETHODCALLTYPE counting_work_item_Release(IWorkItemHandler *iface)
+{
+    struct counting_work_item *item = impl_from_counting_IWorkItemHandler(iface);
+    return InterlockedDecrement(&item->refcount);
+}
+
+static HRESULT STDMETHODCALLTYPE counting_work_item_Invoke(IWorkItemHandler *iface, IAsyncAction *action)
+{
+    struct counting_work_item *item = impl_from_counting_IWorkItemHandler(iface);
+
+    if (item->wait)
+        WaitForSingleObject(item->wait, 10000);
+    if (!InterlockedDecrement(&item->remaining))
+        SetEvent(item->event);
+
+    return S_OK;
+}
+
+static const IWorkItemHandlerVtbl counting_work_item_vtbl =
+{
+    counting_work_item_QueryInterface,
+    counting_work_item_AddRef,
+    counting_work_item_Release,
+    counting_work_item_Invoke,
+};
+
+static void test_RunAsync_many(void)
+{
+    static const WorkItemPriority priorities[] = {WorkItemPriority_Low, WorkItemPriority_Normal, WorkItemPriority_High};
+    struct counting_work_item item = {{&counting_work_item_vtbl}, 1};
+    IActivationFactory *factory = NULL;
+    IThreadPoolStatics *threadpool_statics;
+    LARGE_INTEGER frequency, start, end;
+    unsigned int i, count = 1000;
+    IAsyncAction *action;
+    HSTRING classid;
+    HRESULT hr;
+    DWORD ret;
+
+    hr = RoInitialize(RO_INIT_MULTITHREADED);
+    ok(SUCCEEDED(hr), "Unexpected hr %#lx.\n", hr);
+
+    hr = WindowsCreateString(threadpool_class_name, wcslen(threadpool_class_name), &classid);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+
+    hr = RoGetActivationFactory(classid, &IID_IActivationFactory, (void **)&factory);
+    WindowsDeleteString(classid);
+    ok(hr == S_OK || broken(hr == REGDB_E_CLASSNOTREG), "Unexpected hr %#lx.\n", hr);
+    if (hr == REGDB_E_CLASSNOTREG)
+    {
+        RoUninitialize();
+        return;
+    }
+
+    hr = IActivationFactory_QueryInterface(factory, &IID_IThreadPoolStatics, (void **)&threadpool_statics);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+
+    item.event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    item.remaining = count * 2;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++)
+    {
+        hr = IThreadPoolStatics_RunWithPriorityAsync(threadpool_statics, &item.IWorkItemHandler_iface,
+                priorities[i % ARRAY_SIZE(priorities)], &action);
+        ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+        IAsyncAction_Release(action);
+
+        hr = IThreadPoolStatics_RunWithPriorityAndOptionsAsync(threadpool_statics, &item.IWorkItemHandler_iface,
+                priorities[i % ARRAY_SIZE(priorities)], WorkItemOptions_TimeSliced, &action);
+        ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+        IAsyncAction_Release(action);
+    }
+    ret = WaitForSingleObject(item.event, 10000);
+    ok(!ret, "Unexpected wait result %lu.\n", ret);
+    QueryPerformanceCounter(&end);
+
+    trace("Ran %u work items in %.2f ms.\n", count * 2,
+            (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart);
+
+    /* work items release their handler reference after running */
+    for (i = 0; i < 1000 && item.refcount > 1; i++) Sleep(10);
+    ok(item.refcount == 1, "Got refcount %ld.\n", item.refcount);
+    CloseHandle(item.event);
+
+    IThreadPoolStatics_Release(threadpool_statics);
+    IActivationFactory_Release(factory);
+
+    RoUninitialize();
+}
+
+static void test_RunAsync_blocking(void)
+{
+    struct counting_work_item blocking = {{&counting_work_item_vtbl}, 1};
+    struct counting_work_item release = {{&counting_work_item_vtbl}, 1};
+    struct counting_work_item high = {{&counting_work_item_vtbl}, 1};
+    IActivationFactory *factory = NULL;
+    IThreadPoolStatics *threadpool_statics;
+    unsigned int i, count;
+    IAsyncAction *action;
+    SYSTEM_INFO info;
+    HSTRING classid;
+    HRESULT hr;
+    DWORD ret;
+
+    hr = RoInitialize(RO_INIT_MULTITHREADED);
+    ok(SUCCEEDED(hr), "Unexpected hr %#lx.\n", hr);
+
+    hr = WindowsCreateString(threadpool_class_name, wcslen(threadpool_class_name), &classid);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+
+    hr = RoGetActivationFactory(classid, &IID_IActivationFactory, (void **)&factory);
+    WindowsDeleteString(classid);
+    ok(hr == S_OK || broken(hr == REGDB_E_CLASSNOTREG), "Unexpected hr %#lx.\n", hr);
+    if (hr == REGDB_E_CLASSNOTREG)
+    {
+        RoUninitialize();
+        return;
+    }
+
+    hr = IActivationFactory_QueryInterface(factory, &IID_IThreadPoolStatics, (void **)&threadpool_statics);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+
+    /* more items than CPUs, all waiting for an item queued after them */
+    GetSystemInfo(&info);
+    count = info.dwNumberOfProcessors + 1;
+
+    release.event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    release.remaining = 1;
+    blocking.event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    blocking.wait = release.event;
+    blocking.remaining = count;
+    high.event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    high.remaining = 1;
+
+    for (i = 0; i < count; i++)
+    {
+        hr = IThreadPoolStatics_RunWithPriorityAsync(threadpool_statics, &blocking.IWorkItemHandler_iface,
+                WorkItemPriority_Normal, &action);
+        ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+        IAsyncAction_Release(action);
+    }
+
+    /* a high priority item isn't held back by busy normal priority workers */
+    hr = IThreadPoolStatics_RunWithPriorityAsync(threadpool_statics, &high.IWorkItemHandler_iface,
+            WorkItemPriority_High, &action);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+    IAsyncAction_Release(action);
+    ret = WaitForSingleObject(high.event, 2000);
+    ok(!ret, "Unexpected wait result %lu.\n", ret);
+
+    /* and the pool grows until the releasing item gets to run */
+    hr = IThreadPoolStatics_RunWithPriorityAsync(threadpool_statics, &release.IWorkItemHandler_iface,
+            WorkItemPriority_Normal, &action);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+    IAsyncAction_Release(action);
+    ret = WaitForSingleObject(release.event, 5000);
+    ok(!ret, "Unexpected wait result %lu.\n", ret);
+    ret = WaitForSingleObject(blocking.event, 5000);
+    ok(!ret, "Unexpected wait result %lu.\n", ret);
+
+    for (i = 0; i < 1000 && (blocking.refcount > 1 || release.refcount > 1 || high.refcount > 1); i++) Sleep(10);
+    ok(blocking.refcount == 1, "Got refcount %ld.\n", blocking.refcount);
+    ok(release.refcount == 1, "Got refcount %ld.\n", release.refcount);
+    ok(high.refcount == 1, "Got refcount %ld.\n", high.refcount);
+    CloseHandle(blocking.event);
+    CloseHandle(release.event);
+    CloseHandle(high.event);
+
+    IThreadPoolStatics_Release(threadpool_statics);
+    IActivationFactory_Release(factory);
+
+    RoUninitialize();
+}
+
 START_TEST(threadpool)
 {
     test_interfaces();
     test_RunAsync();
+    test_RunAsync_many();
+    test_RunAsync_blocking();
 }
@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -2219,6 +2222,48 @@ static inline BOOL bit_fields_match(const dib_info *d1, const dib_info *d2)
            d1->blue_mask  == d2->blue_mask;
 }
 
+/* expand 24-bpp pixels to 32-bpp with a zero top byte, four pixels at a time */
+static void expand_row_24_to_32( DWORD *dst, const BYTE *src, int count )
+{
+    DWORD d0, d1, d2;
+    int x;
+
+    for (x = 0; x + 4 <= count; x += 4, src += 12)
+    {
+        memcpy( &d0, src, 4 );
+        memcpy( &d1, src + 4, 4 );
+        memcpy( &d2, src + 8, 4 );
+        *dst++ = d0 & 0xffffff;
+        *dst++ = ((d0 >> 24) | (d1 << 8)) & 0xffffff;
+        *dst++ = ((d1 >> 16) | (d2 << 16)) & 0xffffff;
+        *dst++ = d2 >> 8;
+    }
+    for (; x < count; x++, src += 3) *dst++ = src[0] | (src[1] << 8) | (src[2] << 16);
+}
+
+/* pack 32-bpp pixels to 24-bpp, dropping the top byte, four pixels at a time */
+static void pack_row_32_to_24( BYTE *dst, const DWORD *src, int count )
+{
+    DWORD d0, d1, d2;
+    int x;
+
+    for (x = 0; x + 4 <= count; x += 4, src += 4, dst += 12)
+    {
+        d0 = (src[0] & 0xffffff) | (src[1] << 24);
+        d1 = ((src[1] >> 8) & 0xffff) | (src[2] << 16);
+        d2 = ((src[2] >> 16) & 0xff) | (src[3] << 8);
+        memcpy( dst, &d0, 4 );
+        memcpy( dst + 4, &d1, 4 );
+        memcpy( dst + 8, &d2, 4 );
+    }
+    for (; x < count; x++, src++)
+    {
+        *dst++ = *src;
+        *dst++ = *src >> 8;
+        *dst++ = *src >> 16;
+    }
+}
+
 static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
 {
     DWORD *dst_start = get_pixel_ptr_32(dst, 0, 0), *dst_pixel, src_val;
@@ -2285,22 +2330,12 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
 
     case 24:
     {
-        BYTE *src_start = get_pixel_ptr_24(src, src_rect->left, src_rect->top), *src_pixel;
+        BYTE *src_start = get_pixel_ptr_24(src, src_rect->left, src_rect->top);
 
         for(y = src_rect->top; y < src_rect->bottom; y++)
         {
-            dst_pixel = dst_start;
-            src_pixel = src_start;
-            for(x = src_rect->left; x < src_rect->right; x++)
-            {
-                RGBQUAD rgb;
-                rgb.rgbBlue  = *src_pixel++;
-                rgb.rgbGreen = *src_pixel++;
-                rgb.rgbRed   = *src_pixel++;
-
-                *dst_pixel++ = ((rgb.rgbRed << 16) & 0xff0000) | ((rgb.rgbGreen << 8) & 0x00ff00) | (rgb.rgbBlue & 0x0000ff);
-            }
-            if(pad_size) memset(dst_pixel, 0, pad_size);
+            expand_row_24_to_32( dst_start, src_start, src_rect->right - src_rect->left );
+            if(pad_size) memset(dst_start + (src_rect->right - src_rect->left), 0, pad_size);
             dst_start += dst->stride / 4;
             src_start += src->stride;
         }
@@ -2749,16 +2784,8 @@ static void convert_to_24(dib_info *dst, const dib_info *src, const RECT *src_re
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
-                {
-                    src_val = *src_pixel++;
-                    *dst_pixel++ =  src_val        & 0xff;
-                    *dst_pixel++ = (src_val >>  8) & 0xff;
-                    *dst_pixel++ = (src_val >> 16) & 0xff;
-                }
-                if(pad_size) memset(dst_pixel, 0, pad_size);
+                pack_row_32_to_24( dst_start, src_start, src_rect->right - src_rect->left );
+                if(pad_size) memset(dst_start + (src_rect->right - src_rect->left) * 3, 0, pad_size);
                 dst_start += dst->stride;
                 src_start += src->stride / 4;
             }
@@ -4682,6 +4709,128 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+/* The row blending helpers process the pixels four at a time with SSE2, and return how many
+ * pixels they handled, the callers take care of the remaining ones. The results are exactly
+ * the same as the per-pixel functions above, including for invalid premultiplied pixels. */
+
+#ifdef __SSE2__
+
+/* (val + 127) / 255 in each 16-bit lane, exact for val <= 255 * 255 */
+static inline __m128i div255_epu16( __m128i val )
+{
+    val = _mm_add_epi16( val, _mm_set1_epi16( 128 ));
+    return _mm_srli_epi16( _mm_add_epi16( val, _mm_srli_epi16( val, 8 )), 8 );
+}
+
+/* 255 - alpha of each pixel, in all its 16-bit lanes */
+static inline __m128i inv_alpha_epu16( __m128i val )
+{
+    val = _mm_shufflehi_epi16( _mm_shufflelo_epi16( val, 0xff ), 0xff );
+    return _mm_sub_epi16( _mm_set1_epi16( 255 ), val );
+}
+
+/* src + (dst * (255 - src alpha) + 127) / 255 on 16-bit lanes, returns FALSE on overflow */
+static inline BOOL blend_argb_sse2( __m128i *dst, __m128i src )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i src_lo = _mm_unpacklo_epi8( src, zero ), src_hi = _mm_unpackhi_epi8( src, zero );
+    __m128i dst_lo = _mm_unpacklo_epi8( *dst, zero ), dst_hi = _mm_unpackhi_epi8( *dst, zero );
+
+    dst_lo = _mm_add_epi16( src_lo, div255_epu16( _mm_mullo_epi16( dst_lo, inv_alpha_epu16( src_lo ))));
+    dst_hi = _mm_add_epi16( src_hi, div255_epu16( _mm_mullo_epi16( dst_hi, inv_alpha_epu16( src_hi ))));
+    /* the channels of invalid premultiplied pixels bleed into each other */
+    if (_mm_movemask_epi8( _mm_cmpeq_epi16( _mm_srli_epi16( _mm_or_si128( dst_lo, dst_hi ), 8 ), zero )) != 0xffff)
+        return FALSE;
+    *dst = _mm_packus_epi16( dst_lo, dst_hi );
+    return TRUE;
+}
+
+static int blend_argb_row( DWORD *dst, const DWORD *src, int count )
+{
+    __m128i val;
+    int x;
+
+    for (x = 0; x + 4 <= count; x += 4)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        if (blend_argb_sse2( &val, _mm_loadu_si128( (const __m128i *)(src + x) )))
+            _mm_storeu_si128( (__m128i *)(dst + x), val );
+        else
+        {
+            dst[x]     = blend_argb( dst[x],     src[x] );
+            dst[x + 1] = blend_argb( dst[x + 1], src[x + 1] );
+            dst[x + 2] = blend_argb( dst[x + 2], src[x + 2] );
+            dst[x + 3] = blend_argb( dst[x + 3], src[x + 3] );
+        }
+    }
+    return x;
+}
+
+static int blend_argb_alpha_row( DWORD *dst, const DWORD *src, int count, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128(), alpha16 = _mm_set1_epi16( alpha );
+    __m128i val, src_val;
+    int x;
+
+    for (x = 0; x + 4 <= count; x += 4)
+    {
+        src_val = _mm_loadu_si128( (const __m128i *)(src + x) );
+        src_val = _mm_packus_epi16( div255_epu16( _mm_mullo_epi16( _mm_unpacklo_epi8( src_val, zero ), alpha16 )),
+                                    div255_epu16( _mm_mullo_epi16( _mm_unpackhi_epi8( src_val, zero ), alpha16 )));
+        val = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        if (blend_argb_sse2( &val, src_val ))
+            _mm_storeu_si128( (__m128i *)(dst + x), val );
+        else
+        {
+            dst[x]     = blend_argb_alpha( dst[x],     src[x],     alpha );
+            dst[x + 1] = blend_argb_alpha( dst[x + 1], src[x + 1], alpha );
+            dst[x + 2] = blend_argb_alpha( dst[x + 2], src[x + 2], alpha );
+            dst[x + 3] = blend_argb_alpha( dst[x + 3], src[x + 3], alpha );
+        }
+    }
+    return x;
+}
+
+/* blend_color() on all the channels, with src_mask or'ed into the source pixels */
+static int blend_constant_alpha_row( DWORD *dst, const DWORD *src, int count, DWORD alpha, DWORD src_mask )
+{
+    const __m128i zero = _mm_setzero_si128(), mask = _mm_set1_epi32( src_mask );
+    const __m128i alpha16 = _mm_set1_epi16( alpha ), inv16 = _mm_set1_epi16( 255 - alpha );
+    __m128i src_val, dst_val, lo, hi;
+    int x;
+
+    for (x = 0; x + 4 <= count; x += 4)
+    {
+        src_val = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), mask );
+        dst_val = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( src_val, zero ), alpha16 ),
+                            _mm_mullo_epi16( _mm_unpacklo_epi8( dst_val, zero ), inv16 ));
+        hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( src_val, zero ), alpha16 ),
+                            _mm_mullo_epi16( _mm_unpackhi_epi8( dst_val, zero ), inv16 ));
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( div255_epu16( lo ), div255_epu16( hi )));
+    }
+    return x;
+}
+
+#else  /* __SSE2__ */
+
+static inline int blend_argb_row( DWORD *dst, const DWORD *src, int count )
+{
+    return 0;
+}
+
+static inline int blend_argb_alpha_row( DWORD *dst, const DWORD *src, int count, DWORD alpha )
+{
+    return 0;
+}
+
+static inline int blend_constant_alpha_row( DWORD *dst, const DWORD *src, int count, DWORD alpha, DWORD src_mask )
+{
+    return 0;
+}
+
+#endif  /* __SSE2__ */
+
 static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
                              const dib_info *src, const POINT *offset, BLENDFUNCTION blend)
 {
@@ -4691,25 +4840,26 @@ static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
     {
         DWORD *src_ptr = get_pixel_ptr_32( src, rc->left + offset->x, rc->top + offset->y );
         DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
+        int width = rc->right - rc->left;
 
         if (blend.AlphaFormat & AC_SRC_ALPHA)
         {
             if (blend.SourceConstantAlpha == 255)
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
+                    for (x = blend_argb_row( dst_ptr, src_ptr, width ); x < width; x++)
                         dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
             else
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
+                    for (x = blend_argb_alpha_row( dst_ptr, src_ptr, width, blend.SourceConstantAlpha ); x < width; x++)
                         dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
         }
         else if (src->compression == BI_RGB)
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
+                for (x = blend_constant_alpha_row( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, 0 ); x < width; x++)
                     dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
         else
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
+                for (x = blend_constant_alpha_row( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, 0xff000000 ); x < width; x++)
                     dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     }
 }
@@ -4769,6 +4919,28 @@ static void blend_rects_24(const dib_info *dst, int num, const RECT *rc,
 
         for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride, src_ptr += src->stride / 4)
         {
+#ifdef __SSE2__
+            /* blend_rgb() gives the same three bytes as the 32-bpp blending, expand chunks of
+             * the row to use the vector helpers */
+            DWORD buffer[64];
+            int width = rc->right - rc->left, count, done;
+
+            for (x = 0; x < width; x += count)
+            {
+                count = min( width - x, ARRAY_SIZE(buffer) );
+                expand_row_24_to_32( buffer, dst_ptr + x * 3, count );
+                if (!(blend.AlphaFormat & AC_SRC_ALPHA))
+                    done = blend_constant_alpha_row( buffer, src_ptr + x, count, blend.SourceConstantAlpha, 0 );
+                else if (blend.SourceConstantAlpha == 255)
+                    done = blend_argb_row( buffer, src_ptr + x, count );
+                else
+                    done = blend_argb_alpha_row( buffer, src_ptr + x, count, blend.SourceConstantAlpha );
+                for (; done < count; done++)
+                    buffer[done] = blend_rgb( buffer[done] >> 16, buffer[done] >> 8, buffer[done],
+                                              src_ptr[x + done], blend );
+                pack_row_32_to_24( dst_ptr + x * 3, buffer, count );
+            }
+#else
             for (x = 0; x < rc->right - rc->left; x++)
             {
                 DWORD val = blend_rgb( dst_ptr[x * 3 + 2], dst_ptr[x * 3 + 1], dst_ptr[x * 3],
@@ -4777,6 +4949,7 @@ static void blend_rects_24(const dib_info *dst, int num, const RECT *rc,
                 dst_ptr[x * 3 + 1] = val >> 8;
                 dst_ptr[x * 3 + 2] = val >> 16;
             }
+#endif
         }
     }
 }
@@ -6133,17 +6306,46 @@ static inline DWORD aa_rgb( BYTE r_dst, BYTE g_dst, BYTE b_dst, DWORD text, cons
             aa_color( r_dst, text >> 16, range->r_min, range->r_max ) << 16);
 }
 
+/* skip or fill the runs of 16 transparent or opaque glyph pixels, returns the number of
+ * pixels handled */
+static inline int glyph_run_32( DWORD *dst, const BYTE *glyph, int count, DWORD text_pixel )
+{
+#ifdef __SSE2__
+    const __m128i one = _mm_set1_epi8( 1 ), sixteen = _mm_set1_epi8( 16 );
+    __m128i val, text;
+
+    if (count < 16) return 0;
+    val = _mm_loadu_si128( (const __m128i *)glyph );
+    if (_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_max_epu8( val, one ), one )) == 0xffff) return 16;
+    if (_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_min_epu8( val, sixteen ), sixteen )) == 0xffff)
+    {
+        text = _mm_set1_epi32( text_pixel );
+        _mm_storeu_si128( (__m128i *)dst, text );
+        _mm_storeu_si128( (__m128i *)(dst + 4), text );
+        _mm_storeu_si128( (__m128i *)(dst + 8), text );
+        _mm_storeu_si128( (__m128i *)(dst + 12), text );
+        return 16;
+    }
+#endif
+    return 0;
+}
+
 static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_info *glyph,
                              const POINT *origin, DWORD text_pixel, const struct intensity_range *ranges )
 {
     DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, run, width = rect->right - rect->left;
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        for (x = 0; x < width; x++)
         {
+            if (!(x & 15) && (run = glyph_run_32( dst_ptr + x, glyph_ptr + x, width - x, text_pixel )))
+            {
+                x += run - 1;
+                continue;
+            }
             if (glyph_ptr[x] <= 1) continue;
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
             dst_ptr[x] = aa_rgb( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x], text_pixel, ranges + glyph_ptr[x] );
@@ -6365,17 +6567,47 @@ static inline DWORD blend_subpixel( BYTE r, BYTE g, BYTE b, DWORD text, DWORD al
            blend_color( b, text,       (BYTE) alpha );
 }
 
+/* blend_subpixel() without gamma correction, returns the number of pixels handled */
+static inline int blend_subpixel_row( DWORD *dst, const DWORD *glyph, int count, DWORD text )
+{
+    int x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128(), rgb_mask = _mm_set1_epi32( 0xffffff );
+    const __m128i text16 = _mm_unpacklo_epi8( _mm_set1_epi32( text ), zero ), max16 = _mm_set1_epi16( 255 );
+    __m128i dst_val, alpha, lo, hi, a;
+
+    for (; x + 4 <= count; x += 4)
+    {
+        alpha = _mm_loadu_si128( (const __m128i *)(glyph + x) );
+        dst_val = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        a = _mm_unpacklo_epi8( alpha, zero );
+        lo = _mm_add_epi16( _mm_mullo_epi16( text16, a ),
+                            _mm_mullo_epi16( _mm_unpacklo_epi8( dst_val, zero ), _mm_sub_epi16( max16, a )));
+        a = _mm_unpackhi_epi8( alpha, zero );
+        hi = _mm_add_epi16( _mm_mullo_epi16( text16, a ),
+                            _mm_mullo_epi16( _mm_unpackhi_epi8( dst_val, zero ), _mm_sub_epi16( max16, a )));
+        lo = _mm_and_si128( _mm_packus_epi16( div255_epu16( lo ), div255_epu16( hi )), rgb_mask );
+        /* pixels with an empty glyph are left untouched */
+        alpha = _mm_cmpeq_epi32( alpha, zero );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_or_si128( _mm_and_si128( alpha, dst_val ),
+                                                                _mm_andnot_si128( alpha, lo )));
+    }
+#endif
+    return x;
+}
+
 static void draw_subpixel_glyph_8888( const dib_info *dib, const RECT *rect, const dib_info *glyph,
                                       const POINT *origin, DWORD text_pixel,
                                       const struct font_gamma_ramp *gamma_ramp )
 {
     DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
     const DWORD *glyph_ptr = get_pixel_ptr_32( glyph, origin->x, origin->y );
-    int x, y;
+    BOOL gamma = gamma_ramp != NULL && gamma_ramp->gamma != 1000;
+    int x, y, width = rect->right - rect->left;
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        for (x = gamma ? 0 : blend_subpixel_row( dst_ptr, glyph_ptr, width, text_pixel ); x < width; x++)
         {
             if (glyph_ptr[x] == 0) continue;
             dst_ptr[x] = blend_subpixel( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x],
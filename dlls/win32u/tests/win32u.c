@@ -1030,6 +1030,100 @@ static void test_inter_process_messages( const char *argv0 )
     UnregisterClassW( L"TestIPCClass", NULL );
 }
 
+static void test_inter_process_window_state( const char *argv0 )
+{
+    char path[MAX_PATH];
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA startup;
+    HWND hwnd, child;
+    MSG msg;
+    BOOL ret;
+
+    hwnd = CreateWindowExW( 0, L"static", NULL, WS_POPUP, 100, 100, 200, 100, 0, 0, 0, NULL );
+    ok( hwnd != NULL, "CreateWindowEx failed err %lu.\n", GetLastError() );
+    child = CreateWindowExW( 0, L"static", NULL, WS_CHILD | WS_VISIBLE, 10, 20, 50, 30, hwnd,
+                             (HMENU)0x1234, 0, NULL );
+    ok( child != NULL, "CreateWindowEx failed err %lu.\n", GetLastError() );
+    SetWindowLongPtrW( child, GWLP_USERDATA, 0xdeadbeef );
+
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    sprintf( path, "%s win32u winstate %Ix %Ix", argv0, (INT_PTR)hwnd, (INT_PTR)child );
+    ret = CreateProcessA( NULL, path, NULL, NULL, TRUE, 0, NULL, NULL, &startup, &pi );
+    ok( ret, "CreateProcess '%s' failed err %lu.\n", path, GetLastError() );
+
+    do
+    {
+        GetMessageW( &msg, NULL, 0, 0 );
+        TranslateMessage( &msg );
+        DispatchMessageW( &msg );
+    } while (msg.message != WM_USER);
+
+    wait_child_process( pi.hProcess );
+
+    CloseHandle( pi.hThread );
+    CloseHandle( pi.hProcess );
+
+    DestroyWindow( hwnd );
+}
+
+static void test_inter_process_window_state_child( HWND hwnd, HWND child )
+{
+    LARGE_INTEGER frequency, start, end;
+    RECT rect, expect;
+    LONG style;
+    int i;
+
+    style = GetWindowLongW( hwnd, GWL_STYLE );
+    ok( style & WS_POPUP, "got style %#lx\n", style );
+    ok( !(style & WS_VISIBLE), "got style %#lx\n", style );
+    style = GetWindowLongW( child, GWL_STYLE );
+    ok( (style & (WS_CHILD | WS_VISIBLE)) == (WS_CHILD | WS_VISIBLE), "got style %#lx\n", style );
+    ok( GetWindowLongW( child, GWLP_ID ) == 0x1234, "got id %#lx\n", GetWindowLongW( child, GWLP_ID ) );
+    ok( GetWindowLongW( child, GWLP_USERDATA ) == (LONG)0xdeadbeef, "got user data %#lx\n",
+        GetWindowLongW( child, GWLP_USERDATA ) );
+
+    ok( GetAncestor( child, GA_PARENT ) == hwnd, "got parent %p\n", GetAncestor( child, GA_PARENT ) );
+    ok( GetAncestor( hwnd, GA_PARENT ) == GetDesktopWindow(), "got parent %p\n", GetAncestor( hwnd, GA_PARENT ) );
+    ok( GetParent( child ) == hwnd, "got parent %p\n", GetParent( child ) );
+    ok( !IsWindowVisible( child ), "child is visible\n" );
+
+    GetWindowRect( hwnd, &rect );
+    SetRect( &expect, 100, 100, 300, 200 );
+    ok( EqualRect( &rect, &expect ), "got window rect %s\n", wine_dbgstr_rect( &rect ) );
+    GetWindowRect( child, &rect );
+    SetRect( &expect, 110, 120, 160, 150 );
+    ok( EqualRect( &rect, &expect ), "got window rect %s\n", wine_dbgstr_rect( &rect ) );
+    GetClientRect( child, &rect );
+    SetRect( &expect, 0, 0, 50, 30 );
+    ok( EqualRect( &rect, &expect ), "got client rect %s\n", wine_dbgstr_rect( &rect ) );
+
+    /* changes made by the owner process are visible right away */
+    SetWindowPos( hwnd, 0, 50, 60, 0, 0, SWP_SHOWWINDOW | SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE );
+    ok( IsWindowVisible( child ), "child isn't visible\n" );
+    GetWindowRect( child, &rect );
+    SetRect( &expect, 60, 80, 110, 110 );
+    ok( EqualRect( &rect, &expect ), "got window rect %s\n", wine_dbgstr_rect( &rect ) );
+    SetWindowLongPtrW( child, GWLP_USERDATA, 0x1337 );
+    ok( GetWindowLongW( child, GWLP_USERDATA ) == 0x1337, "got user data %#lx\n",
+        GetWindowLongW( child, GWLP_USERDATA ) );
+
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < 10000; i++)
+    {
+        GetWindowLongW( child, GWL_STYLE );
+        GetWindowRect( child, &rect );
+        GetClientRect( child, &rect );
+        IsWindowVisible( child );
+        GetAncestor( child, GA_PARENT );
+    }
+    QueryPerformanceCounter( &end );
+    trace( "%.3f us per call\n", (end.QuadPart - start.QuadPart) * 1e6 / frequency.QuadPart / (5 * 10000) );
+
+    PostMessageW( hwnd, WM_USER, 0, 0 );
+}
+
 static void test_inter_process_child( HWND hwnd )
 {
     MDICREATESTRUCTA mdi;
@@ -2177,6 +2271,13 @@ START_TEST(win32u)
         return;
     }
 
+    if (argc > 4 && !strcmp( argv[2], "winstate" ))
+    {
+        test_inter_process_window_state_child( LongToHandle( strtol( argv[3], NULL, 16 )),
+                                               LongToHandle( strtol( argv[4], NULL, 16 )));
+        return;
+    }
+
     if (argc > 3 && !strcmp( argv[2], "NtUserEnableMouseInPointer" ))
     {
         winetest_push_context( "enable %s", argv[3] );
@@ -2204,6 +2305,7 @@ START_TEST(win32u)
     test_message_filter();
     test_timer();
     test_inter_process_messages( argv[0] );
+    test_inter_process_window_state( argv[0] );
     test_wndproc_hook();
 
     test_NtUserCloseWindowStation();
@@ -253,6 +253,48 @@ WND *get_win_ptr( HWND hwnd )
     return win;
 }
 
+/* state of a window read from session shared memory */
+struct shared_window_data
+{
+    HWND      parent;
+    HWND      owner;
+    DWORD     style;
+    DWORD     ex_style;
+    ULONG_PTR id;
+    HINSTANCE instance;
+    ULONG_PTR user_data;
+    UINT      dpi_context;
+    RECT      window_rect;
+    RECT      client_rect;
+};
+
+/***********************************************************************
+ *           get_shared_window_data
+ *
+ * Read the state of a window, usually belonging to another process, without a server call.
+ */
+static BOOL get_shared_window_data( HWND hwnd, struct shared_window_data *data )
+{
+    struct object_lock lock = OBJECT_LOCK_INIT;
+    const window_shm_t *window_shm;
+    NTSTATUS status;
+
+    while ((status = get_shared_window( hwnd, &lock, &window_shm )) == STATUS_PENDING)
+    {
+        data->parent      = wine_server_ptr_handle( window_shm->parent );
+        data->owner       = wine_server_ptr_handle( window_shm->owner );
+        data->style       = window_shm->style;
+        data->ex_style    = window_shm->ex_style;
+        data->id          = window_shm->id;
+        data->instance    = wine_server_get_ptr( window_shm->instance );
+        data->user_data   = window_shm->user_data;
+        data->dpi_context = window_shm->dpi_context;
+        data->window_rect = wine_server_get_rect( window_shm->window_rect );
+        data->client_rect = wine_server_get_rect( window_shm->client_rect );
+    }
+    return !status;
+}
+
 /***********************************************************************
  *           is_current_thread_window
  *
@@ -349,6 +391,7 @@ DWORD get_window_thread( HWND hwnd, DWORD *process )
 /* see GetParent */
 HWND get_parent( HWND hwnd )
 {
+    struct shared_window_data data;
     HWND retval = 0;
     WND *win;
 
@@ -360,7 +403,16 @@ HWND get_parent( HWND hwnd )
     if (win == WND_DESKTOP) return 0;
     if (win == WND_OTHER_PROCESS)
     {
-        LONG style = get_window_long( hwnd, GWL_STYLE );
+        LONG style;
+
+        if (get_shared_window_data( hwnd, &data ))
+        {
+            if (data.style & WS_POPUP) retval = data.owner;
+            else if (data.style & WS_CHILD) retval = data.parent;
+            return retval;
+        }
+
+        style = get_window_long( hwnd, GWL_STYLE );
         if (style & (WS_POPUP | WS_CHILD))
         {
             SERVER_START_REQ( get_window_tree )
@@ -483,6 +535,7 @@ HWND WINAPI NtUserSetParent( HWND hwnd, HWND parent )
 /* see GetWindow */
 HWND get_window_relative( HWND hwnd, UINT rel )
 {
+    struct shared_window_data data;
     HWND retval = 0;
 
     if (rel == GW_OWNER)  /* this one may be available locally */
@@ -500,6 +553,7 @@ HWND get_window_relative( HWND hwnd, UINT rel )
             release_win_ptr( win );
             return retval;
         }
+        if (get_shared_window_data( hwnd, &data )) return data.owner;
         /* else fall through to server call */
     }
 
@@ -656,6 +710,7 @@ HWND *list_window_children( HDESK desktop, HWND hwnd, UNICODE_STRING *class, DWO
  */
 HWND WINAPI NtUserGetAncestor( HWND hwnd, UINT type )
 {
+    struct shared_window_data data;
     HWND *list, ret = 0;
     WND *win;
 
@@ -673,6 +728,7 @@ HWND WINAPI NtUserGetAncestor( HWND hwnd, UINT type )
             ret = win->parent;
             release_win_ptr( win );
         }
+        else if (get_shared_window_data( hwnd, &data )) ret = data.parent;
         else /* need to query the server */
         {
             SERVER_START_REQ( get_window_tree )
@@ -737,20 +793,18 @@ BOOL is_child( HWND parent, HWND child )
 /* see IsWindowVisible */
 BOOL is_window_visible( HWND hwnd )
 {
-    HWND *list;
-    BOOL retval = TRUE;
-    int i;
+    HWND parent, next;
 
     if (!(get_window_long( hwnd, GWL_STYLE ) & WS_VISIBLE)) return FALSE;
-    if (!(list = list_window_parents( hwnd ))) return TRUE;
-    if (list[0])
+    if (!(parent = NtUserGetAncestor( hwnd, GA_PARENT ))) return TRUE;
+
+    /* walk the parents one at a time, they are read from shared memory for other processes */
+    while ((next = NtUserGetAncestor( parent, GA_PARENT )))
     {
-        for (i = 0; list[i+1]; i++)
-            if (!(get_window_long( list[i], GWL_STYLE ) & WS_VISIBLE)) break;
-        retval = !list[i+1] && (list[i] == get_desktop_window());  /* top message window isn't visible */
+        if (!(get_window_long( parent, GWL_STYLE ) & WS_VISIBLE)) return FALSE;
+        parent = next;
     }
-    free( list );
-    return retval;
+    return parent == get_desktop_window();  /* top message window isn't visible */
 }
 
 /***********************************************************************
@@ -864,6 +918,7 @@ BOOL is_window_enabled( HWND hwnd )
 /* see GetWindowDpiAwarenessContext */
 UINT get_window_dpi_awareness_context( HWND hwnd )
 {
+    struct shared_window_data data;
     UINT ret = 0;
     WND *win;
 
@@ -878,6 +933,7 @@ UINT get_window_dpi_awareness_context( HWND hwnd )
         ret = win->dpi_context;
         release_win_ptr( win );
     }
+    else if (get_shared_window_data( hwnd, &data )) ret = data.dpi_context;
     else
     {
         SERVER_START_REQ( get_window_info )
@@ -893,6 +949,7 @@ UINT get_window_dpi_awareness_context( HWND hwnd )
 /* see GetDpiForWindow */
 UINT get_dpi_for_window( HWND hwnd )
 {
+    struct shared_window_data data;
     WND *win;
     UINT context = 0;
 
@@ -911,6 +968,7 @@ UINT get_dpi_for_window( HWND hwnd )
         context = win->dpi_context;
         release_win_ptr( win );
     }
+    else if (get_shared_window_data( hwnd, &data )) context = data.dpi_context;
     else
     {
         SERVER_START_REQ( get_window_info )
@@ -978,6 +1036,7 @@ BOOL is_zoomed( HWND hwnd )
 
 static LONG_PTR get_window_long_size( HWND hwnd, INT offset, UINT size, BOOL ansi )
 {
+    struct shared_window_data data;
     LONG_PTR retval = 0;
     WND *win;
 
@@ -1024,6 +1083,17 @@ static LONG_PTR get_window_long_size( HWND hwnd, INT offset, UINT size, BOOL ans
             RtlSetLastWin32Error( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if (offset < 0 && get_shared_window_data( hwnd, &data ))
+        {
+            switch (offset)
+            {
+            case GWL_STYLE:      return data.style;
+            case GWL_EXSTYLE:    return data.ex_style;
+            case GWLP_ID:        return data.id;
+            case GWLP_HINSTANCE: return (ULONG_PTR)data.instance;
+            case GWLP_USERDATA:  return data.user_data;
+            }
+        }
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -1557,6 +1627,75 @@ static void mirror_rect( const RECT *window_rect, RECT *rect )
     rect->right = width - tmp;
 }
 
+/***********************************************************************
+ *           get_shared_window_rects
+ *
+ * Get the window and client rectangles of a window belonging to another process, without
+ * a server call, following what the server does for the get_window_rectangles request.
+ */
+static BOOL get_shared_window_rects( HWND hwnd, enum coords_relative relative,
+                                     struct window_rects *rects, UINT dpi )
+{
+    struct shared_window_data data, parent;
+    UINT window_dpi;
+    HWND next;
+
+    if (!get_shared_window_data( hwnd, &data )) return FALSE;
+    if (!(window_dpi = NTUSER_DPI_CONTEXT_GET_DPI( data.dpi_context ))) window_dpi = USER_DEFAULT_SCREEN_DPI;
+
+    rects->window = data.window_rect;
+    rects->client = data.client_rect;
+
+    switch (relative)
+    {
+    case COORDS_CLIENT:
+        OffsetRect( &rects->window, -data.client_rect.left, -data.client_rect.top );
+        OffsetRect( &rects->client, -data.client_rect.left, -data.client_rect.top );
+        if (data.ex_style & WS_EX_LAYOUTRTL) mirror_rect( &data.client_rect, &rects->window );
+        break;
+    case COORDS_WINDOW:
+        OffsetRect( &rects->window, -data.window_rect.left, -data.window_rect.top );
+        OffsetRect( &rects->client, -data.window_rect.left, -data.window_rect.top );
+        if (data.ex_style & WS_EX_LAYOUTRTL) mirror_rect( &data.window_rect, &rects->client );
+        break;
+    case COORDS_PARENT:
+        if (!data.parent) break;
+        if (!get_shared_window_data( data.parent, &parent )) return FALSE;
+        if (parent.ex_style & WS_EX_LAYOUTRTL)
+        {
+            mirror_rect( &parent.client_rect, &rects->window );
+            mirror_rect( &parent.client_rect, &rects->client );
+        }
+        break;
+    case COORDS_SCREEN:
+        break;
+    default:
+        return FALSE;
+    }
+
+    /* the desktop window DPI is used when no DPI is requested */
+    if (!data.parent && !dpi) dpi = window_dpi;
+
+    for (next = data.parent; next && (relative == COORDS_SCREEN || !dpi); next = parent.parent)
+    {
+        if (!get_shared_window_data( next, &parent )) return FALSE;
+        if (!parent.parent)  /* desktop window */
+        {
+            if (!dpi && !(dpi = NTUSER_DPI_CONTEXT_GET_DPI( parent.dpi_context )))
+                dpi = USER_DEFAULT_SCREEN_DPI;
+            break;
+        }
+        if (relative != COORDS_SCREEN) continue;
+        OffsetRect( &rects->window, parent.client_rect.left, parent.client_rect.top );
+        OffsetRect( &rects->client, parent.client_rect.left, parent.client_rect.top );
+    }
+
+    rects->window = map_dpi_rect( rects->window, window_dpi, dpi );
+    rects->client = map_dpi_rect( rects->client, window_dpi, dpi );
+    rects->visible = rects->window;
+    return TRUE;
+}
+
 /***********************************************************************
  *           get_window_rects
  *
@@ -1677,6 +1816,8 @@ BOOL get_window_rects( HWND hwnd, enum coords_relative relative, struct window_r
     }
 
 other_process:
+    if (get_shared_window_rects( hwnd, relative, rects, dpi )) return TRUE;
+
     SERVER_START_REQ( get_window_rectangles )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -52,6 +52,15 @@ struct shared_input_cache
     DWORD tid;
 };
 
+struct shared_window_cache
+{
+    const shared_object_t *object;
+    UINT64 id;
+    UINT handle;
+};
+
+#define SHARED_WINDOW_CACHE_SIZE 16
+
 struct session_thread_data
 {
     const shared_object_t *shared_desktop;         /* thread desktop shared session cached object */
@@ -59,6 +68,7 @@ struct session_thread_data
     struct shared_input_cache shared_input;        /* current thread input shared session cached object */
     struct shared_input_cache shared_foreground;   /* foreground thread input shared session cached object */
     struct shared_input_cache other_thread_input;  /* other thread input shared session cached object */
+    struct shared_window_cache shared_windows[SHARED_WINDOW_CACHE_SIZE]; /* other process windows shared session cached objects */
 };
 
 struct session_block
@@ -328,6 +338,68 @@ NTSTATUS get_shared_input( UINT tid, struct object_lock *lock, const input_shm_t
     return status;
 }
 
+static NTSTATUS try_get_shared_window( HWND hwnd, struct object_lock *lock, const window_shm_t **window_shm,
+                                       struct shared_window_cache *cache )
+{
+    const shared_object_t *object;
+    BOOL valid = TRUE;
+
+    if (!(object = cache->object))
+    {
+        obj_locator_t locator;
+
+        SERVER_START_REQ( get_window_info )
+        {
+            req->handle = wine_server_user_handle( hwnd );
+            wine_server_call( req );
+            locator = reply->locator;
+        }
+        SERVER_END_REQ;
+
+        cache->id = locator.id;
+        cache->object = find_shared_session_object( locator );
+        if (!(object = cache->object)) return STATUS_INVALID_HANDLE;
+        memset( lock, 0, sizeof(*lock) );
+    }
+
+    /* check object validity by comparing ids, within the object seqlock */
+    valid = cache->id == object->id;
+
+    if (!lock->id || !shared_object_release_seqlock( object, lock->seq ))
+    {
+        shared_object_acquire_seqlock( object, &lock->seq );
+        if (!(lock->id = object->id)) lock->id = -1;
+        *window_shm = &object->shm.window;
+        return STATUS_PENDING;
+    }
+
+    if (!valid) /* window has been destroyed, clear the cache and start over */
+    {
+        cache->object = NULL;
+        cache->id = 0;
+    }
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS get_shared_window( HWND hwnd, struct object_lock *lock, const window_shm_t **window_shm )
+{
+    struct session_thread_data *data = get_session_thread_data();
+    struct shared_window_cache *cache;
+    UINT handle = HandleToUlong( hwnd );
+    UINT status;
+
+    TRACE( "hwnd %p, lock %p, window_shm %p\n", hwnd, lock, window_shm );
+
+    cache = &data->shared_windows[(LOWORD(handle) >> 1) % SHARED_WINDOW_CACHE_SIZE];
+    if (handle != cache->handle) memset( cache, 0, sizeof(*cache) );
+    cache->handle = handle;
+
+    do { status = try_get_shared_window( hwnd, lock, window_shm, cache ); }
+    while (!status && !cache->id);
+
+    return status;
+}
+
 BOOL is_virtual_desktop(void)
 {
     struct object_lock lock = OBJECT_LOCK_INIT;
@@ -20,12 +20,9 @@
 #include "private.h"
 #include <assert.h>
 #include <winuser.h>
-#include <libxml/parser.h>
-#include <libxml/xmlerror.h>
-#include <libxml/xpath.h>
 #include <pathcch.h>
-#include <shlwapi.h>
 
+#include "wine/appxindex.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(coreapp);
@@ -36,9 +33,9 @@ struct coreapp_impl
     ICoreApplication ICoreApplication_iface;
     ICoreApplicationView ICoreApplicationView_iface;
     IFrameworkView *current_view;
-    xmlDocPtr appx_manifest;
-    char *display_name;
-    char *identity_name;
+    struct appx_index_header *manifest_index;
+    const WCHAR *display_name;
+    const WCHAR *identity_name;
     LONG ref;
 };
 
@@ -242,32 +239,13 @@ static HRESULT WINAPI coreapp_impl_GetCurrentView( ICoreApplication *iface, ICor
     return E_NOTIMPL;
 }
 
-static xmlNodePtr find_xml_child(xmlNodePtr node, const char* node_name) {
-    xmlNodePtr cur_node;
-
-    if (node == NULL) {
-        return NULL;
-    }
-
-    for (cur_node = node; cur_node; cur_node = cur_node->next) {
-        if (xmlStrcmp(cur_node->name, (const xmlChar *)node_name) == 0) {
-            return cur_node;
-        }
-    }
-    
-    return NULL;
-}
-
 static BOOL try_parse_appxmanifest( struct coreapp_impl *impl ) 
 {
     WCHAR wpath[MAX_PATH];
-    char *path;
     HRESULT ret;
     DWORD gmfl_ret;
-    xmlNodePtr rootElem;
-    xmlNodePtr subElem;
 
-    impl->appx_manifest = NULL;
+    if (impl->manifest_index) return TRUE;
 
     gmfl_ret = GetModuleFileNameW(NULL, wpath, MAX_PATH);
     if (gmfl_ret == 0) {
@@ -284,65 +262,22 @@ static BOOL try_parse_appxmanifest( struct coreapp_impl *impl )
     // This shouldn't be here, but it's fine.
     SetCurrentDirectoryW(wpath);
 
-    ret = PathCchAppend(wpath, MAX_PATH, L"appxmanifest.xml");
-    if (!SUCCEEDED(ret)) {
-        ERR("PathCchAppend failed\n");
-        return FALSE;
-    }
-
-    if (PathFileExistsW(wpath)) {
-        path = malloc(wcstombs(NULL, wpath, MAX_PATH)+1);
-        if (wcstombs(path, wpath, MAX_PATH) == -1) {
-            ERR("wcstombs failed for %s\n", debugstr_w(wpath));
-        } else {
-            impl->appx_manifest = xmlReadFile(path, NULL, 0);
-            if (impl->appx_manifest == NULL) {
-                ERR("xmlReadFile failed for %s\n", debugstr_a(path));
-            }
-        }
-
-        free(path);
-    } else {
-        ERR("AppxManifest.xml: Not found at %s\n", debugstr_w(wpath));
-    }
-
-    if (impl->appx_manifest == NULL) {
+    /* the manifest is only parsed when its compiled index is missing or out of date */
+    if (!(impl->manifest_index = __wine_load_appx_index(wpath))) {
         return FALSE;
     }
 
-    rootElem = xmlDocGetRootElement(impl->appx_manifest);
-    if (rootElem == NULL) {
-        return FALSE;
-    }
+    impl->display_name = appx_index_string(impl->manifest_index, impl->manifest_index->display_name);
+    TRACE("Got display name %s\n", debugstr_w(impl->display_name));
 
-    if (strcmp((char*)rootElem->name, "Package") != 0) {
-        ERR("AppxManifest.xml: Invalid root key '%s', expected 'Package'\n", rootElem->name);
+    impl->identity_name = appx_index_string(impl->manifest_index, impl->manifest_index->identity_name);
+    if (impl->identity_name == NULL) {
+        ERR("AppxManifest.xml: No Identity Name defined!\n");
+        HeapFree(GetProcessHeap(), 0, impl->manifest_index);
+        impl->manifest_index = NULL;
         return FALSE;
     }
-
-    subElem = find_xml_child(rootElem->children, "Properties");
-    if (subElem == NULL) {
-        ERR("AppxManifest.xml: No Properties defined!\n");
-        return FALSE;
-    }
-
-    subElem = find_xml_child(subElem->children, "DisplayName");
-    if (subElem == NULL) {
-        ERR("AppxManifest.xml: No DisplayName defined!\n");
-        return FALSE;
-    }
-
-    impl->display_name = (char*)subElem->children->content;
-    TRACE("Got display name %s\n", impl->display_name);
-
-    subElem = find_xml_child(rootElem->children, "Identity");
-    if (subElem == NULL) {
-        ERR("AppxManifest.xml: No Identity defined!\n");
-        return FALSE;
-    }
-
-    impl->identity_name = (char*)xmlGetProp(subElem, (const xmlChar *)"Name");
-    TRACE("Got identity name %s\n", impl->identity_name);
+    TRACE("Got identity name %s\n", debugstr_w(impl->identity_name));
 
     return TRUE;
 }
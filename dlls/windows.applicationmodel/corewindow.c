@@ -265,6 +265,16 @@ static HRESULT WINAPI corewindow_interop_impl_QueryInterface( ICoreWindowInterop
     return E_NOINTERFACE;
 }
 
+static void corewindow_destroy( struct corewindow_impl *impl )
+{
+    if (impl->dispatcher)
+    {
+        impl->dispatcher->for_window = NULL;
+        ICoreDispatcher_Release( &impl->dispatcher->ICoreDispatcher_iface );
+    }
+    free( impl );
+}
+
 static ULONG WINAPI corewindow_interop_impl_AddRef( ICoreWindowInterop *iface )
 {
     struct corewindow_impl *impl = impl_from_ICoreWindowInterop( iface );
@@ -280,7 +290,7 @@ static ULONG WINAPI corewindow_interop_impl_Release( ICoreWindowInterop *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref) corewindow_destroy( impl );
     return ref;
 }
 
@@ -357,7 +367,7 @@ static ULONG WINAPI corewindow_impl_Release( ICoreWindow *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref) corewindow_destroy( impl );
     return ref;
 }
 
@@ -414,6 +424,7 @@ static HRESULT WINAPI corewindow_impl_get_Dispatcher( ICoreWindow *iface, ICoreD
 {
     struct corewindow_impl *impl = impl_from_ICoreWindow( iface );
     *value = &impl->dispatcher->ICoreDispatcher_iface;
+    ICoreDispatcher_AddRef( *value );
     return S_OK;
 }
 
@@ -654,7 +665,7 @@ static ULONG WINAPI corewindow4_impl_Release( ICoreWindow4 *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref) corewindow_destroy( impl );
     return ref;
 }
 
@@ -716,7 +727,7 @@ static const struct ICoreWindow4Vtbl corewindow4_impl_vtbl =
     corewindow4_impl_remove_ResizeCompleted
 };
 
-struct corewindow_impl *create_corewindow(IFrameworkView *for_view, char *identity_name, char *display_name) {
+struct corewindow_impl *create_corewindow(IFrameworkView *for_view, const WCHAR *identity_name, const WCHAR *display_name) {
     struct corewindow_impl *object;
     struct corewindow_tls *tls;
 
@@ -25,14 +25,259 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(dispatcher);
 
-struct dispatcher_queued_task {
-    dispatcher_func func;
-    void* return_value;
+/* Tasks are posted to the lock-free incoming list from any thread, and a
+ * single wake message is posted to the window until the dispatcher thread
+ * picks them up. The dispatcher thread then sorts them into the per-priority
+ * queues, which it owns, and runs them in batches. */
+struct dispatcher_task
+{
+    IUnknown IUnknown_iface;   /* parameter of the async action */
+    LONG ref;
+    SLIST_ENTRY entry;
+    struct list pending_entry;
+    CoreDispatcherPriority priority;
+    IAsyncAction *action;
+    IUnknown *handler;
+    struct dispatcher_impl *dispatcher; /* not referenced, queued tasks are canceled when it is released */
+};
+
+static inline struct dispatcher_task *impl_from_IUnknown( IUnknown *iface )
+{
+    return CONTAINING_RECORD( iface, struct dispatcher_task, IUnknown_iface );
+}
+
+static HRESULT WINAPI task_QueryInterface( IUnknown *iface, REFIID iid, void **out )
+{
+    if (IsEqualGUID( iid, &IID_IUnknown ))
+    {
+        *out = iface;
+        IUnknown_AddRef( iface );
+        return S_OK;
+    }
+
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI task_AddRef( IUnknown *iface )
+{
+    struct dispatcher_task *task = impl_from_IUnknown( iface );
+    return InterlockedIncrement( &task->ref );
+}
+
+static ULONG WINAPI task_Release( IUnknown *iface )
+{
+    struct dispatcher_task *task = impl_from_IUnknown( iface );
+    ULONG ref = InterlockedDecrement( &task->ref );
+
+    if (!ref)
+    {
+        IUnknown_Release( task->handler );
+        free( task );
+    }
+    return ref;
+}
+
+static const IUnknownVtbl task_vtbl =
+{
+    task_QueryInterface,
+    task_AddRef,
+    task_Release,
 };
 
+static UINT dispatcher_wake_message;
+
+/* wake message parameter for the final release from another thread, lParam is the dispatcher */
+#define DISPATCHER_WAKE_DESTROY 1
+
+static void dispatcher_collect_tasks( struct dispatcher_impl *impl )
+{
+    SLIST_ENTRY *entry, *next, *reversed = NULL;
+    struct dispatcher_task *task;
+
+    /* clear the flag first, tasks posted after the flush will need another wake message */
+    InterlockedExchange( &impl->wake_pending, 0 );
+    entry = InterlockedFlushSList( &impl->incoming );
+
+    /* the list is in reverse posting order */
+    for (; entry; entry = next)
+    {
+        next = entry->Next;
+        entry->Next = reversed;
+        reversed = entry;
+    }
+
+    for (entry = reversed; entry; entry = next)
+    {
+        next = entry->Next;
+        task = CONTAINING_RECORD( entry, struct dispatcher_task, entry );
+        list_add_tail( &impl->pending[task->priority - CoreDispatcherPriority_Idle], &task->pending_entry );
+    }
+}
+
+/* returns the oldest task of the highest priority, without dequeuing it */
+static struct dispatcher_task *dispatcher_peek_task( struct dispatcher_impl *impl, BOOL idle )
+{
+    int i, min = idle ? CoreDispatcherPriority_Idle : CoreDispatcherPriority_Low;
+    struct list *ptr;
+
+    for (i = CoreDispatcherPriority_High; i >= min; i--)
+        if ((ptr = list_head( &impl->pending[i - CoreDispatcherPriority_Idle] )))
+            return LIST_ENTRY( ptr, struct dispatcher_task, pending_entry );
+
+    return NULL;
+}
+
+/* the action keeps a reference on the task, so the task must drop its own on the action */
+static void dispatcher_run_task( struct dispatcher_task *task )
+{
+    IAsyncAction *action = task->action;
+
+    TRACE( "task %p, priority %d, action %p.\n", task, task->priority, action );
+
+    list_remove( &task->pending_entry );
+    task->action = NULL;
+    async_operation_run_deferred( (IInspectable *)action );
+    IAsyncAction_Release( action );
+    IUnknown_Release( &task->IUnknown_iface );
+}
+
+/* complete all the queued tasks as canceled, without running their handlers */
+static void dispatcher_cancel_tasks( struct dispatcher_impl *impl )
+{
+    struct dispatcher_task *task;
+    IAsyncInfo *info;
+
+    dispatcher_collect_tasks( impl );
+    while ((task = dispatcher_peek_task( impl, TRUE )))
+    {
+        if (SUCCEEDED(IAsyncAction_QueryInterface( task->action, &IID_IAsyncInfo, (void **)&info )))
+        {
+            IAsyncInfo_Cancel( info );
+            IAsyncInfo_Release( info );
+        }
+        dispatcher_run_task( task );
+    }
+}
+
+static void dispatcher_destroy( struct dispatcher_impl *impl )
+{
+    TRACE( "impl %p.\n", impl );
+
+    dispatcher_cancel_tasks( impl );
+    free( impl );
+}
+
+static BOOL input_is_pending(void)
+{
+    return HIWORD( GetQueueStatus( QS_INPUT ) ) != 0;
+}
+
+/* run the non-idle tasks posted so far, higher priorities first, tasks posted
+ * while running them are left for the next batch */
+static BOOL dispatcher_run_tasks( struct dispatcher_impl *impl, BOOL all )
+{
+    struct dispatcher_task *task;
+    BOOL ret = FALSE;
+
+    dispatcher_collect_tasks( impl );
+    while ((task = dispatcher_peek_task( impl, FALSE )))
+    {
+        dispatcher_run_task( task );
+        ret = TRUE;
+        if (!all) break;
+    }
+
+    return ret;
+}
+
+/* idle tasks only run when there's no other task and no input to process */
+static BOOL dispatcher_run_idle_tasks( struct dispatcher_impl *impl, BOOL all )
+{
+    struct dispatcher_task *task;
+    BOOL ret = FALSE;
+
+    dispatcher_collect_tasks( impl );
+    while ((task = dispatcher_peek_task( impl, TRUE )) && task->priority == CoreDispatcherPriority_Idle
+           && !input_is_pending())
+    {
+        dispatcher_run_task( task );
+        ret = TRUE;
+        if (!all) break;
+        dispatcher_collect_tasks( impl );
+    }
+
+    return ret;
+}
+
+static BOOL dispatcher_process_messages( struct dispatcher_impl *impl, BOOL all )
+{
+    BOOL ret = FALSE;
+    MSG msg;
+
+    while (!impl->quit && PeekMessageW( &msg, NULL, 0, 0, PM_REMOVE ))
+    {
+        if (msg.message == WM_QUIT) impl->quit = TRUE;
+        else
+        {
+            TranslateMessage( &msg );
+            DispatchMessageW( &msg );
+        }
+        ret = TRUE;
+        if (!all) break;
+    }
+
+    return ret;
+}
+
+static BOOL dispatcher_process_all( struct dispatcher_impl *impl )
+{
+    BOOL ret;
+
+    ret = dispatcher_run_tasks( impl, TRUE );
+    ret |= dispatcher_process_messages( impl, TRUE );
+    if (!impl->quit) ret |= dispatcher_run_tasks( impl, TRUE );
+    if (!impl->quit) ret |= dispatcher_run_idle_tasks( impl, TRUE );
+
+    return ret;
+}
+
+static BOOL dispatcher_process_one( struct dispatcher_impl *impl )
+{
+    if (dispatcher_process_messages( impl, FALSE )) return TRUE;
+    if (dispatcher_run_tasks( impl, FALSE )) return TRUE;
+    return dispatcher_run_idle_tasks( impl, FALSE );
+}
+
+static void dispatcher_wait( struct dispatcher_impl *impl )
+{
+    struct dispatcher_task *task;
+
+    if (impl->quit) return;
+    dispatcher_collect_tasks( impl );
+    if ((task = dispatcher_peek_task( impl, TRUE )))
+    {
+        if (task->priority != CoreDispatcherPriority_Idle) return;
+        if (!input_is_pending()) return;
+    }
+    /* new tasks come with a wake message */
+    MsgWaitForMultipleObjectsEx( 0, NULL, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE );
+}
+
 // this is the main message handler for the program
 static LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
+    struct dispatcher_impl *impl;
+
+    if (message == dispatcher_wake_message)
+    {
+        if (wParam == DISPATCHER_WAKE_DESTROY)
+            dispatcher_destroy( (struct dispatcher_impl *)lParam );
+        else if ((impl = (struct dispatcher_impl *)GetWindowLongPtrW( hWnd, GWLP_USERDATA )))
+            dispatcher_run_tasks( impl, TRUE );
+        return 0;
+    }
+
     // sort through and find what code to run for the message given
     switch(message)
     {
@@ -92,7 +337,15 @@ static ULONG WINAPI dispatcher_impl_Release( ICoreDispatcher *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        if (GetWindowLongPtrW( impl->window, GWLP_USERDATA ) == (LONG_PTR)impl)
+            SetWindowLongPtrW( impl->window, GWLP_USERDATA, 0 );
+        /* the queues belong to the dispatcher thread, cancel the tasks there if it still runs */
+        if (GetCurrentThreadId() == impl->thread_id ||
+            !PostMessageW( impl->window, dispatcher_wake_message, DISPATCHER_WAKE_DESTROY, (LPARAM)impl ))
+            dispatcher_destroy( impl );
+    }
     return ref;
 }
 
@@ -116,54 +369,203 @@ static HRESULT WINAPI dispatcher_impl_GetTrustLevel( ICoreDispatcher *iface, Tru
 
 static HRESULT WINAPI dispatcher_impl_get_HasThreadAccess( ICoreDispatcher *iface, boolean *value)
 {
-    FIXME("iface %p, value %p stub.\n", iface, value);
-    *value = TRUE;
+    struct dispatcher_impl *impl = impl_from_ICoreDispatcher( iface );
+
+    TRACE("iface %p, value %p.\n", iface, value);
+
+    *value = GetCurrentThreadId() == impl->thread_id;
     return S_OK;
 }
 
 static HRESULT WINAPI dispatcher_impl_ProcessEvents( ICoreDispatcher *iface, CoreProcessEventsOption options)
 {
-    MSG msg;
     struct dispatcher_impl *impl = impl_from_ICoreDispatcher( iface );
 
-    if (options == CoreProcessEventsOption_ProcessUntilQuit) {
-        while(GetMessageW(&msg, impl->for_window->window_handle, 0, 0))
-        {
-            TranslateMessage(&msg);
-            DispatchMessageW(&msg);
-        }
-    } else if (options == CoreProcessEventsOption_ProcessAllIfPresent) {
-        while(PeekMessageW(&msg, impl->for_window->window_handle, 0, 0, PM_REMOVE)) {
-            TranslateMessage(&msg);
-            DispatchMessageW(&msg);
-        }
-    } else if (options == CoreProcessEventsOption_ProcessOneIfPresent) {
-        PeekMessageW(&msg, impl->for_window->window_handle, 0, 0, PM_REMOVE);
-        TranslateMessage(&msg);
-        DispatchMessageW(&msg);
-    } else if (options == CoreProcessEventsOption_ProcessOneAndAllPending) {
-        GetMessageW(&msg, impl->for_window->window_handle, 0, 0);
-        TranslateMessage(&msg);
-        DispatchMessageW(&msg);
-    } 
-    
-   
+    TRACE("iface %p, options %d.\n", iface, options);
+
+    if (GetCurrentThreadId() != impl->thread_id) return RPC_E_WRONG_THREAD;
+
+    /* WM_QUIT only ends the loop that received it */
+    impl->quit = FALSE;
+
+    switch (options)
+    {
+    case CoreProcessEventsOption_ProcessOneAndAllPending:
+        while (!dispatcher_process_all( impl ) && !impl->quit) dispatcher_wait( impl );
+        break;
+    case CoreProcessEventsOption_ProcessOneIfPresent:
+        dispatcher_process_one( impl );
+        break;
+    case CoreProcessEventsOption_ProcessUntilQuit:
+        while (!impl->quit) if (!dispatcher_process_all( impl )) dispatcher_wait( impl );
+        break;
+    case CoreProcessEventsOption_ProcessAllIfPresent:
+        dispatcher_process_all( impl );
+        break;
+    default:
+        return E_INVALIDARG;
+    }
 
     return S_OK;
 }
 
-static HRESULT WINAPI dispatcher_impl_RunAsync( ICoreDispatcher *iface, CoreDispatcherPriority priority, IDispatchedHandler *callback, IAsyncAction **action)
+static HRESULT WINAPI dispatched_handler_run( IUnknown *invoker, IUnknown *param )
 {
-    FIXME("iface %p, priority %d, callback %p, action %p, stub.\n", iface, priority, callback, action);
+    struct dispatcher_task *task = impl_from_IUnknown( param );
+    return IDispatchedHandler_Invoke( (IDispatchedHandler *)task->handler );
+}
+
+struct idle_dispatched_args
+{
+    IIdleDispatchedHandlerArgs IIdleDispatchedHandlerArgs_iface;
+    struct dispatcher_impl *dispatcher;
+};
+
+static inline struct idle_dispatched_args *impl_from_IIdleDispatchedHandlerArgs( IIdleDispatchedHandlerArgs *iface )
+{
+    return CONTAINING_RECORD( iface, struct idle_dispatched_args, IIdleDispatchedHandlerArgs_iface );
+}
+
+static HRESULT WINAPI idle_args_QueryInterface( IIdleDispatchedHandlerArgs *iface, REFIID iid, void **out )
+{
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IIdleDispatchedHandlerArgs ))
+    {
+        *out = iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+/* the arguments only live for the duration of the handler call */
+static ULONG WINAPI idle_args_AddRef( IIdleDispatchedHandlerArgs *iface )
+{
+    return 2;
+}
+
+static ULONG WINAPI idle_args_Release( IIdleDispatchedHandlerArgs *iface )
+{
+    return 1;
+}
+
+static HRESULT WINAPI idle_args_GetIids( IIdleDispatchedHandlerArgs *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
     return E_NOTIMPL;
 }
 
-static HRESULT WINAPI dispatcher_impl_RunIdleAsync( ICoreDispatcher *iface, IIdleDispatchedHandler *callback, IAsyncAction **action)
+static HRESULT WINAPI idle_args_GetRuntimeClassName( IIdleDispatchedHandlerArgs *iface, HSTRING *class_name )
 {
-    FIXME("iface %p, callback %p, action %p, stub.\n", iface, callback, action);
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
     return E_NOTIMPL;
 }
 
+static HRESULT WINAPI idle_args_GetTrustLevel( IIdleDispatchedHandlerArgs *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI idle_args_get_IsDispatcherIdle( IIdleDispatchedHandlerArgs *iface, boolean *value )
+{
+    struct idle_dispatched_args *impl = impl_from_IIdleDispatchedHandlerArgs( iface );
+    struct dispatcher_impl *dispatcher = impl->dispatcher;
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    dispatcher_collect_tasks( dispatcher );
+    *value = !dispatcher_peek_task( dispatcher, FALSE ) && !input_is_pending();
+    return S_OK;
+}
+
+static const struct IIdleDispatchedHandlerArgsVtbl idle_args_vtbl =
+{
+    /* IUnknown methods */
+    idle_args_QueryInterface,
+    idle_args_AddRef,
+    idle_args_Release,
+    /* IInspectable methods */
+    idle_args_GetIids,
+    idle_args_GetRuntimeClassName,
+    idle_args_GetTrustLevel,
+    /* IIdleDispatchedHandlerArgs methods */
+    idle_args_get_IsDispatcherIdle,
+};
+
+static HRESULT WINAPI idle_dispatched_handler_run( IUnknown *invoker, IUnknown *param )
+{
+    struct dispatcher_task *task = impl_from_IUnknown( param );
+    struct idle_dispatched_args args = {{&idle_args_vtbl}};
+
+    /* handlers only run from the dispatcher thread, while the dispatcher is alive */
+    args.dispatcher = task->dispatcher;
+    return IIdleDispatchedHandler_Invoke( (IIdleDispatchedHandler *)task->handler, &args.IIdleDispatchedHandlerArgs_iface );
+}
+
+static HRESULT dispatcher_post( struct dispatcher_impl *impl, CoreDispatcherPriority priority, IUnknown *handler,
+                                async_action_callback callback, IAsyncAction **action )
+{
+    struct dispatcher_task *task;
+    HRESULT hr;
+
+    if (!(task = calloc( 1, sizeof(*task) ))) return E_OUTOFMEMORY;
+    task->IUnknown_iface.lpVtbl = &task_vtbl;
+    task->ref = 1;
+    task->priority = priority;
+    task->dispatcher = impl;
+    IUnknown_AddRef( (task->handler = handler) );
+
+    /* the dispatcher isn't the invoker, queued tasks must not keep it alive */
+    if (FAILED(hr = async_action_create( NULL, &task->IUnknown_iface, callback, ASYNC_RUN_DEFERRED, &task->action )))
+    {
+        IUnknown_Release( &task->IUnknown_iface );
+        return hr;
+    }
+
+    *action = task->action;
+    IAsyncAction_AddRef( *action );
+
+    InterlockedPushEntrySList( &impl->incoming, &task->entry );
+    if (!InterlockedExchange( &impl->wake_pending, 1 ) &&
+        !PostMessageW( impl->window, dispatcher_wake_message, 0, 0 ))
+    {
+        /* let the next task try again, the dispatcher still collects this one when it gets to run */
+        WARN( "Failed to post wake message, error %lu.\n", GetLastError() );
+        InterlockedExchange( &impl->wake_pending, 0 );
+    }
+
+    return S_OK;
+}
+
+static HRESULT WINAPI dispatcher_impl_RunAsync( ICoreDispatcher *iface, CoreDispatcherPriority priority, IDispatchedHandler *callback, IAsyncAction **action)
+{
+    struct dispatcher_impl *impl = impl_from_ICoreDispatcher( iface );
+
+    TRACE("iface %p, priority %d, callback %p, action %p.\n", iface, priority, callback, action);
+
+    if (!callback || !action) return E_POINTER;
+    if (priority < CoreDispatcherPriority_Idle || priority > CoreDispatcherPriority_High) return E_INVALIDARG;
+    return dispatcher_post( impl, priority, (IUnknown *)callback, dispatched_handler_run, action );
+}
+
+static HRESULT WINAPI dispatcher_impl_RunIdleAsync( ICoreDispatcher *iface, IIdleDispatchedHandler *callback, IAsyncAction **action)
+{
+    struct dispatcher_impl *impl = impl_from_ICoreDispatcher( iface );
+
+    TRACE("iface %p, callback %p, action %p.\n", iface, callback, action);
+
+    if (!callback || !action) return E_POINTER;
+    return dispatcher_post( impl, CoreDispatcherPriority_Idle, (IUnknown *)callback, idle_dispatched_handler_run, action );
+}
+
 static const struct ICoreDispatcherVtbl dispatcher_impl_vtbl =
 {
     /* IUnknown methods */
@@ -181,33 +583,24 @@ static const struct ICoreDispatcherVtbl dispatcher_impl_vtbl =
     dispatcher_impl_RunIdleAsync,
 };
 
-LPWSTR create_wide_string(char* regular_string) {
-    LPWSTR widestr;
-
-    int count = MultiByteToWideChar(CP_ACP, 0, regular_string, -1, NULL, 0);
-    widestr = calloc(1, count * sizeof(WCHAR) + 1);
-    MultiByteToWideChar(CP_ACP, 0, regular_string, -1, widestr, count);
-    return widestr;
-}
-
-struct dispatcher_impl *create_dispatcher(struct corewindow_impl *for_window, char *identity_name, char *display_name) {
+struct dispatcher_impl *create_dispatcher(struct corewindow_impl *for_window, const WCHAR *identity_name, const WCHAR *display_name) {
     struct dispatcher_impl *object;
     WNDCLASSEXW wc;
-    LPWSTR widentity_name;
-    LPWSTR wdisplay_name;
+    UINT i;
     
     TRACE("for_view %p.\n", for_window);
 
-    widentity_name = create_wide_string(identity_name);
-    wdisplay_name = create_wide_string(display_name);
-
     if (!(object = calloc(1, sizeof(*object))))
         return NULL;
 
-    list_init( &object->queued_tasks );
     object->ICoreDispatcher_iface.lpVtbl = &dispatcher_impl_vtbl;
     object->for_window = for_window;
+    object->thread_id = GetCurrentThreadId();
+    InitializeSListHead( &object->incoming );
+    for (i = 0; i < ARRAY_SIZE(object->pending); i++) list_init( &object->pending[i] );
     object->ref = 1;
+
+    if (!dispatcher_wake_message) dispatcher_wake_message = RegisterWindowMessageW( L"__wine_core_dispatcher_wake" );
     
     
     ZeroMemory(&wc, sizeof(WNDCLASSEXW));
@@ -219,12 +612,14 @@ struct dispatcher_impl *create_dispatcher(struct corewindow_impl *for_window, ch
     wc.hInstance = NULL;
     wc.hCursor = LoadCursorW(NULL, (LPCWSTR)IDC_ARROW);
     wc.hbrBackground = (HBRUSH)COLOR_WINDOW;
-    wc.lpszClassName = widentity_name;
+    wc.lpszClassName = identity_name;
 
     // register the window class
     RegisterClassExW(&wc);
 
-    object->for_window->window_handle = CreateWindowExW(WS_EX_APPWINDOW, widentity_name, wdisplay_name, WS_OVERLAPPEDWINDOW, 0, 0, 1920, 1080, NULL, NULL, NULL, NULL);
+    object->for_window->window_handle = CreateWindowExW(WS_EX_APPWINDOW, identity_name, display_name, WS_OVERLAPPEDWINDOW, 0, 0, 1920, 1080, NULL, NULL, NULL, NULL);
+    object->window = object->for_window->window_handle;
+    SetWindowLongPtrW(object->for_window->window_handle, GWLP_USERDATA, (LONG_PTR)object);
     ShowWindow(object->for_window->window_handle, SW_SHOW);
 
     return object;
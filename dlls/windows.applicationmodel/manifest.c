@@ -0,0 +1,590 @@
+/* AppxManifest.xml compiler
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "private.h"
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+
+#include "wine/appxindex.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(coreapp);
+
+struct index_builder
+{
+    struct appx_index_header header;
+    WCHAR *strings;  /* string pool, offsets into it are in WCHARs until the index is written */
+    SIZE_T strings_len;
+    SIZE_T strings_size;
+    DWORD *capabilities;
+    SIZE_T capabilities_size;
+    struct appx_index_application *applications;
+    SIZE_T applications_size;
+    struct appx_index_class *classes;
+    SIZE_T classes_size;
+    BOOL failed;
+};
+
+static BOOL array_reserve( void **elements, SIZE_T *capacity, SIZE_T count, SIZE_T size )
+{
+    SIZE_T new_capacity, max_capacity = ~(SIZE_T)0 / size;
+    void *new_elements;
+
+    if (count <= *capacity) return TRUE;
+    if (count > max_capacity) return FALSE;
+
+    new_capacity = max( *capacity, 4 );
+    while (new_capacity < count && new_capacity <= max_capacity / 2) new_capacity *= 2;
+    if (new_capacity < count) new_capacity = count;
+
+    if (!(new_elements = realloc( *elements, new_capacity * size ))) return FALSE;
+    *elements = new_elements;
+    *capacity = new_capacity;
+    return TRUE;
+}
+
+/* returns the pool offset of the string, 0 for a missing one */
+static DWORD builder_add_string( struct index_builder *builder, const xmlChar *str )
+{
+    SIZE_T offset = builder->strings_len;
+    int len;
+
+    if (!str) return 0;
+    if (!(len = MultiByteToWideChar( CP_UTF8, 0, (const char *)str, -1, NULL, 0 ))) return 0;
+    if (!array_reserve( (void **)&builder->strings, &builder->strings_size, offset + len, sizeof(WCHAR) ))
+    {
+        builder->failed = TRUE;
+        return 0;
+    }
+    MultiByteToWideChar( CP_UTF8, 0, (const char *)str, -1, builder->strings + offset, len );
+    builder->strings_len += len;
+    return offset;
+}
+
+static DWORD builder_add_prop( struct index_builder *builder, xmlNodePtr node, const char *name )
+{
+    xmlChar *value = xmlGetProp( node, (const xmlChar *)name );
+    DWORD offset = builder_add_string( builder, value );
+    xmlFree( value );
+    return offset;
+}
+
+static DWORD builder_add_content( struct index_builder *builder, xmlNodePtr node )
+{
+    xmlChar *value = xmlNodeGetContent( node );
+    DWORD offset = builder_add_string( builder, value );
+    xmlFree( value );
+    return offset;
+}
+
+static xmlNodePtr next_element( xmlNodePtr node, const char *name )
+{
+    for (; node; node = node->next)
+    {
+        if (node->type != XML_ELEMENT_NODE) continue;
+        if (!name || !xmlStrcmp( node->name, (const xmlChar *)name )) return node;
+    }
+    return NULL;
+}
+
+#define LIST_FOR_EACH_ELEMENT( node, parent, name ) \
+    for (node = next_element( (parent)->children, name ); node; node = next_element( node->next, name ))
+
+static xmlNodePtr find_element( xmlNodePtr parent, const char *name )
+{
+    return parent ? next_element( parent->children, name ) : NULL;
+}
+
+static enum appx_threading_model parse_threading_model( const xmlChar *value )
+{
+    if (!value || !xmlStrcasecmp( value, (const xmlChar *)"both" )) return APPX_THREADING_BOTH;
+    if (!xmlStrcasecmp( value, (const xmlChar *)"sta" )) return APPX_THREADING_STA;
+    if (!xmlStrcasecmp( value, (const xmlChar *)"mta" )) return APPX_THREADING_MTA;
+    WARN( "Unknown threading model %s\n", debugstr_a((const char *)value) );
+    return APPX_THREADING_BOTH;
+}
+
+static void compile_in_process_server( struct index_builder *builder, xmlNodePtr server )
+{
+    struct appx_index_class *class;
+    xmlNodePtr node;
+    xmlChar *value;
+    DWORD path;
+
+    if (!(path = builder_add_content( builder, find_element( server, "Path" ) )))
+    {
+        WARN( "InProcessServer without a Path, ignoring\n" );
+        return;
+    }
+
+    LIST_FOR_EACH_ELEMENT( node, server, "ActivatableClass" )
+    {
+        if (!array_reserve( (void **)&builder->classes, &builder->classes_size,
+                            builder->header.class_count + 1, sizeof(*builder->classes) ))
+        {
+            builder->failed = TRUE;
+            return;
+        }
+        class = &builder->classes[builder->header.class_count];
+        if (!(class->id = builder_add_prop( builder, node, "ActivatableClassId" ))) continue;
+        class->path = path;
+        value = xmlGetProp( node, (const xmlChar *)"ThreadingModel" );
+        class->threading_model = parse_threading_model( value );
+        xmlFree( value );
+        builder->header.class_count++;
+    }
+}
+
+static void compile_extensions( struct index_builder *builder, xmlNodePtr extensions )
+{
+    xmlNodePtr node, server;
+    xmlChar *category;
+
+    if (!extensions) return;
+
+    LIST_FOR_EACH_ELEMENT( node, extensions, "Extension" )
+    {
+        category = xmlGetProp( node, (const xmlChar *)"Category" );
+        if (category && !xmlStrcmp( category, (const xmlChar *)"windows.activatableClass.inProcessServer" ))
+        {
+            if ((server = find_element( node, "InProcessServer" ))) compile_in_process_server( builder, server );
+        }
+        else if (category && !xmlStrncmp( category, (const xmlChar *)"windows.activatableClass.", 25 ))
+            FIXME( "Extension category %s not supported\n", debugstr_a((const char *)category) );
+        xmlFree( category );
+    }
+}
+
+static void compile_applications( struct index_builder *builder, xmlNodePtr applications )
+{
+    struct appx_index_application *application;
+    xmlNodePtr node;
+
+    if (!applications) return;
+
+    LIST_FOR_EACH_ELEMENT( node, applications, "Application" )
+    {
+        if (!array_reserve( (void **)&builder->applications, &builder->applications_size,
+                            builder->header.application_count + 1, sizeof(*builder->applications) ))
+        {
+            builder->failed = TRUE;
+            return;
+        }
+        application = &builder->applications[builder->header.application_count++];
+        application->id = builder_add_prop( builder, node, "Id" );
+        application->executable = builder_add_prop( builder, node, "Executable" );
+        application->entry_point = builder_add_prop( builder, node, "EntryPoint" );
+
+        compile_extensions( builder, find_element( node, "Extensions" ) );
+    }
+}
+
+static void compile_capabilities( struct index_builder *builder, xmlNodePtr capabilities )
+{
+    xmlNodePtr node;
+    DWORD name;
+
+    if (!capabilities) return;
+
+    /* Capability, DeviceCapability and their namespaced variants all have a Name */
+    LIST_FOR_EACH_ELEMENT( node, capabilities, NULL )
+    {
+        if (!(name = builder_add_prop( builder, node, "Name" ))) continue;
+        if (!array_reserve( (void **)&builder->capabilities, &builder->capabilities_size,
+                            builder->header.capability_count + 1, sizeof(*builder->capabilities) ))
+        {
+            builder->failed = TRUE;
+            return;
+        }
+        builder->capabilities[builder->header.capability_count++] = name;
+    }
+}
+
+static BOOL compile_manifest( struct index_builder *builder, xmlDocPtr doc )
+{
+    xmlNodePtr root, node;
+
+    root = xmlDocGetRootElement( doc );
+    if (!root || xmlStrcmp( root->name, (const xmlChar *)"Package" ))
+    {
+        ERR( "AppxManifest.xml: Invalid root key '%s', expected 'Package'\n", root ? (char *)root->name : "" );
+        return FALSE;
+    }
+
+    /* keep offset 0 for missing strings */
+    builder_add_string( builder, (const xmlChar *)"" );
+
+    if (!(node = find_element( root, "Identity" )))
+    {
+        ERR( "AppxManifest.xml: No Identity defined!\n" );
+        return FALSE;
+    }
+    builder->header.identity_name = builder_add_prop( builder, node, "Name" );
+    builder->header.identity_publisher = builder_add_prop( builder, node, "Publisher" );
+    builder->header.identity_version = builder_add_prop( builder, node, "Version" );
+    builder->header.identity_architecture = builder_add_prop( builder, node, "ProcessorArchitecture" );
+
+    if (!(node = find_element( find_element( root, "Properties" ), "DisplayName" )))
+    {
+        ERR( "AppxManifest.xml: No DisplayName defined!\n" );
+        return FALSE;
+    }
+    builder->header.display_name = builder_add_content( builder, node );
+    node = find_element( find_element( root, "Properties" ), "PublisherDisplayName" );
+    if (node) builder->header.publisher_display_name = builder_add_content( builder, node );
+
+    compile_capabilities( builder, find_element( root, "Capabilities" ) );
+    compile_applications( builder, find_element( root, "Applications" ) );
+    compile_extensions( builder, find_element( root, "Extensions" ) );
+
+    return !builder->failed;
+}
+
+static int __cdecl class_compare( void *context, const void *a, const void *b )
+{
+    const struct appx_index_class *class_a = a, *class_b = b;
+    const WCHAR *strings = context;
+    int ret;
+
+    /* strings are added in declaration order, keep duplicates in that order too */
+    if ((ret = wcscmp( strings + class_a->id, strings + class_b->id ))) return ret;
+    return class_a->id < class_b->id ? -1 : class_a->id > class_b->id;
+}
+
+static inline DWORD string_offset( DWORD strings, DWORD offset )
+{
+    return offset ? strings + offset * sizeof(WCHAR) : 0;
+}
+
+/* lays out the index in a single buffer, converting pool offsets to index offsets */
+static struct appx_index_header *builder_finish( struct index_builder *builder, const WIN32_FILE_ATTRIBUTE_DATA *manifest )
+{
+    struct appx_index_header *index, *header = &builder->header;
+    struct appx_index_application *applications;
+    struct appx_index_class *classes;
+    DWORD *capabilities, strings, size, i, j;
+
+    if (builder->strings_len > 0x400000) return NULL;
+
+    /* duplicate ids would make the lookups ambiguous, the first declaration wins */
+    qsort_s( builder->classes, header->class_count, sizeof(*builder->classes), class_compare, builder->strings );
+    for (i = j = 0; i < header->class_count; i++)
+    {
+        if (j && !wcscmp( builder->strings + builder->classes[j - 1].id, builder->strings + builder->classes[i].id ))
+        {
+            WARN( "Duplicate activatable class %s\n", debugstr_w(builder->strings + builder->classes[i].id) );
+            continue;
+        }
+        builder->classes[j++] = builder->classes[i];
+    }
+    header->class_count = j;
+
+    header->magic = APPX_INDEX_MAGIC;
+    header->version = APPX_INDEX_VERSION;
+    header->manifest_time = manifest->ftLastWriteTime;
+    header->manifest_size = ((ULONGLONG)manifest->nFileSizeHigh << 32) | manifest->nFileSizeLow;
+    header->capabilities = sizeof(*header);
+    header->applications = header->capabilities + header->capability_count * sizeof(*capabilities);
+    header->classes = header->applications + header->application_count * sizeof(*applications);
+    strings = header->classes + header->class_count * sizeof(*classes);
+    header->size = size = strings + builder->strings_len * sizeof(WCHAR);
+
+    if (!(index = calloc( 1, size ))) return NULL;
+
+    header->identity_name = string_offset( strings, header->identity_name );
+    header->identity_publisher = string_offset( strings, header->identity_publisher );
+    header->identity_version = string_offset( strings, header->identity_version );
+    header->identity_architecture = string_offset( strings, header->identity_architecture );
+    header->display_name = string_offset( strings, header->display_name );
+    header->publisher_display_name = string_offset( strings, header->publisher_display_name );
+    *index = *header;
+
+    capabilities = (DWORD *)((char *)index + header->capabilities);
+    for (i = 0; i < header->capability_count; i++)
+        capabilities[i] = string_offset( strings, builder->capabilities[i] );
+
+    applications = (struct appx_index_application *)((char *)index + header->applications);
+    for (i = 0; i < header->application_count; i++)
+    {
+        applications[i].id = string_offset( strings, builder->applications[i].id );
+        applications[i].executable = string_offset( strings, builder->applications[i].executable );
+        applications[i].entry_point = string_offset( strings, builder->applications[i].entry_point );
+    }
+
+    classes = (struct appx_index_class *)((char *)index + header->classes);
+    for (i = 0; i < header->class_count; i++)
+    {
+        classes[i].id = string_offset( strings, builder->classes[i].id );
+        classes[i].path = string_offset( strings, builder->classes[i].path );
+        classes[i].threading_model = builder->classes[i].threading_model;
+    }
+
+    memcpy( (char *)index + strings, builder->strings, builder->strings_len * sizeof(WCHAR) );
+    return index;
+}
+
+static void create_parent_directories( const WCHAR *path )
+{
+    WCHAR buffer[MAX_PATH], *p;
+
+    lstrcpynW( buffer, path, ARRAY_SIZE(buffer) );
+    for (p = buffer + 3; (p = wcschr( p, '\\' )); p++)
+    {
+        *p = 0;
+        CreateDirectoryW( buffer, NULL );
+        *p = '\\';
+    }
+}
+
+static BOOL check_index_string( const struct appx_index_header *index, DWORD offset )
+{
+    /* the index always ends with a null WCHAR, so any in-bounds string is terminated */
+    return !offset || (offset >= sizeof(*index) && offset < index->size && !(offset % sizeof(WCHAR)));
+}
+
+static BOOL check_index_array( const struct appx_index_header *index, DWORD offset, DWORD count, DWORD size )
+{
+    return offset >= sizeof(*index) && !(offset % sizeof(DWORD)) && offset <= index->size &&
+           count <= (index->size - offset) / size;
+}
+
+static BOOL validate_index( const struct appx_index_header *index, DWORD size )
+{
+    const struct appx_index_application *applications;
+    const struct appx_index_class *classes;
+    const DWORD *capabilities;
+    DWORD i;
+
+    if (size < sizeof(*index) + sizeof(WCHAR)) return FALSE;
+    if (index->magic != APPX_INDEX_MAGIC || index->version != APPX_INDEX_VERSION) return FALSE;
+    if (index->size != size || *(const WCHAR *)((const char *)index + size - sizeof(WCHAR))) return FALSE;
+
+    if (!check_index_string( index, index->identity_name ) ||
+        !check_index_string( index, index->identity_publisher ) ||
+        !check_index_string( index, index->identity_version ) ||
+        !check_index_string( index, index->identity_architecture ) ||
+        !check_index_string( index, index->display_name ) ||
+        !check_index_string( index, index->publisher_display_name ))
+        return FALSE;
+
+    if (!check_index_array( index, index->capabilities, index->capability_count, sizeof(DWORD) ))
+        return FALSE;
+    capabilities = appx_index_array( index, index->capabilities );
+    for (i = 0; i < index->capability_count; i++)
+        if (!capabilities[i] || !check_index_string( index, capabilities[i] )) return FALSE;
+
+    if (!check_index_array( index, index->applications, index->application_count, sizeof(*applications) ))
+        return FALSE;
+    applications = appx_index_array( index, index->applications );
+    for (i = 0; i < index->application_count; i++)
+    {
+        if (!check_index_string( index, applications[i].id ) ||
+            !check_index_string( index, applications[i].executable ) ||
+            !check_index_string( index, applications[i].entry_point ))
+            return FALSE;
+    }
+
+    if (!check_index_array( index, index->classes, index->class_count, sizeof(*classes) ))
+        return FALSE;
+    classes = appx_index_array( index, index->classes );
+    for (i = 0; i < index->class_count; i++)
+    {
+        if (!classes[i].id || !check_index_string( index, classes[i].id ) ||
+            !classes[i].path || !check_index_string( index, classes[i].path ))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static BOOL get_manifest_path( const WCHAR *package_dir, WCHAR *buffer, DWORD size )
+{
+    return _snwprintf( buffer, size, L"%s\\AppxManifest.xml", package_dir ) > 0;
+}
+
+/* Path of the index for the package, either in the package directory itself or, if cache
+ * is set, in the prefix cache, named after a hash of the package directory. */
+static BOOL get_index_path( const WCHAR *package_dir, BOOL cache, WCHAR *buffer, DWORD size )
+{
+    ULONGLONG hash = 0xcbf29ce484222325ull;
+    WCHAR local[MAX_PATH];
+    const WCHAR *p;
+
+    if (!cache) return _snwprintf( buffer, size, L"%s\\%s", package_dir, APPX_INDEX_NAME ) > 0;
+
+    if (!GetEnvironmentVariableW( L"LOCALAPPDATA", local, ARRAY_SIZE(local) )) return FALSE;
+    for (p = package_dir; *p; p++) hash = (hash ^ towupper( *p )) * 0x100000001b3ull;
+    return _snwprintf( buffer, size, L"%s\\wine\\appxindex\\%08lx%08lx.idx", local,
+                       (DWORD)(hash >> 32), (DWORD)hash ) > 0;
+}
+
+static struct appx_index_header *read_index_file( const WCHAR *path, const WIN32_FILE_ATTRIBUTE_DATA *manifest )
+{
+    struct appx_index_header *index = NULL;
+    LARGE_INTEGER size;
+    HANDLE file;
+    DWORD read;
+
+    file = CreateFileW( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL );
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    if (GetFileSizeEx( file, &size ) && size.QuadPart >= sizeof(*index) && size.QuadPart < 0x1000000 &&
+        (index = HeapAlloc( GetProcessHeap(), 0, size.LowPart )))
+    {
+        if (!ReadFile( file, index, size.LowPart, &read, NULL ) || read != size.LowPart ||
+            !validate_index( index, size.LowPart ) ||
+            CompareFileTime( &index->manifest_time, &manifest->ftLastWriteTime ) ||
+            index->manifest_size != (((ULONGLONG)manifest->nFileSizeHigh << 32) | manifest->nFileSizeLow))
+        {
+            HeapFree( GetProcessHeap(), 0, index );
+            index = NULL;
+        }
+    }
+
+    CloseHandle( file );
+    return index;
+}
+
+/* Reads the index of the package, returns NULL if it is missing, invalid or out of date, in which
+ * case the manifest needs to be compiled again. */
+static struct appx_index_header *read_index( const WCHAR *package_dir )
+{
+    WIN32_FILE_ATTRIBUTE_DATA manifest;
+    struct appx_index_header *index;
+    WCHAR path[MAX_PATH];
+
+    if (!get_manifest_path( package_dir, path, ARRAY_SIZE(path) )) return NULL;
+    if (!GetFileAttributesExW( path, GetFileExInfoStandard, &manifest )) return NULL;
+
+    if (get_index_path( package_dir, FALSE, path, ARRAY_SIZE(path) ) &&
+        (index = read_index_file( path, &manifest )))
+        return index;
+    if (get_index_path( package_dir, TRUE, path, ARRAY_SIZE(path) ) &&
+        (index = read_index_file( path, &manifest )))
+        return index;
+    return NULL;
+}
+
+/* the index is written to a temporary file and renamed, so readers never see a partial one */
+static BOOL write_index( const WCHAR *path, const struct appx_index_header *index )
+{
+    WCHAR tmp[MAX_PATH + 16];
+    DWORD written;
+    HANDLE file;
+    BOOL ret;
+
+    swprintf( tmp, ARRAY_SIZE(tmp), L"%s.%lx.tmp", path, GetCurrentProcessId() );
+    file = CreateFileW( tmp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL );
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+
+    ret = WriteFile( file, index, index->size, &written, NULL ) && written == index->size;
+    CloseHandle( file );
+    if (ret) ret = MoveFileExW( tmp, path, MOVEFILE_REPLACE_EXISTING );
+    if (!ret) DeleteFileW( tmp );
+    return ret;
+}
+
+/***********************************************************************
+ *      __wine_compile_appx_manifest (windows.applicationmodel.@)
+ *
+ * Compiles the AppxManifest.xml of the package into its index, unless the
+ * index is already up to date, in which case S_FALSE is returned.
+ */
+HRESULT WINAPI __wine_compile_appx_manifest( const WCHAR *package_dir )
+{
+    struct index_builder builder = {{0}};
+    struct appx_index_header *index;
+    WIN32_FILE_ATTRIBUTE_DATA manifest;
+    WCHAR path[MAX_PATH];
+    HRESULT hr = S_OK;
+    xmlDocPtr doc;
+    char *file;
+    int len;
+
+    TRACE( "package_dir %s.\n", debugstr_w(package_dir) );
+
+    if ((index = read_index( package_dir )))
+    {
+        HeapFree( GetProcessHeap(), 0, index );
+        return S_FALSE;
+    }
+
+    if (!get_manifest_path( package_dir, path, ARRAY_SIZE(path) )) return E_INVALIDARG;
+    if (!GetFileAttributesExW( path, GetFileExInfoStandard, &manifest ))
+    {
+        ERR( "AppxManifest.xml: Not found at %s\n", debugstr_w(path) );
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    len = WideCharToMultiByte( CP_UTF8, 0, path, -1, NULL, 0, NULL, NULL );
+    if (!(file = malloc( len ))) return E_OUTOFMEMORY;
+    WideCharToMultiByte( CP_UTF8, 0, path, -1, file, len, NULL, NULL );
+    doc = xmlReadFile( file, NULL, XML_PARSE_NONET );
+    free( file );
+    if (!doc)
+    {
+        ERR( "xmlReadFile failed for %s\n", debugstr_w(path) );
+        return APPX_E_INVALID_MANIFEST;
+    }
+
+    if (!compile_manifest( &builder, doc )) hr = builder.failed ? E_OUTOFMEMORY : APPX_E_INVALID_MANIFEST;
+    else if (!(index = builder_finish( &builder, &manifest ))) hr = E_OUTOFMEMORY;
+    xmlFreeDoc( doc );
+
+    if (index)
+    {
+        TRACE( "Compiled %s, %lu capabilities, %lu applications, %lu classes, %lu bytes\n", debugstr_w(path),
+               index->capability_count, index->application_count, index->class_count, index->size );
+
+        if (get_index_path( package_dir, FALSE, path, ARRAY_SIZE(path) ) && write_index( path, index ))
+            TRACE( "Wrote index to %s\n", debugstr_w(path) );
+        else if (get_index_path( package_dir, TRUE, path, ARRAY_SIZE(path) ) &&
+                 (create_parent_directories( path ), write_index( path, index )))
+            TRACE( "Wrote index to %s\n", debugstr_w(path) );
+        else
+        {
+            ERR( "Failed to write the manifest index for %s\n", debugstr_w(package_dir) );
+            hr = HRESULT_FROM_WIN32( GetLastError() );
+        }
+        free( index );
+    }
+
+    free( builder.strings );
+    free( builder.capabilities );
+    free( builder.applications );
+    free( builder.classes );
+    return hr;
+}
+
+/***********************************************************************
+ *      __wine_load_appx_index (windows.applicationmodel.@)
+ *
+ * Reads the index of the package, compiling the manifest first if needed.
+ * The index is allocated from the process heap, so that any module can free it.
+ */
+struct appx_index_header * WINAPI __wine_load_appx_index( const WCHAR *package_dir )
+{
+    struct appx_index_header *index;
+
+    TRACE( "package_dir %s.\n", debugstr_w(package_dir) );
+
+    if ((index = read_index( package_dir ))) return index;
+    if (FAILED(__wine_compile_appx_manifest( package_dir ))) return NULL;
+    return read_index( package_dir );
+}
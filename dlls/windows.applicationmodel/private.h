@@ -44,6 +44,7 @@
 #include "windows.applicationmodel.h"
 
 #include "wine/list.h"
+#include "wine/winrtasync.h"
 
 struct corewindow_impl {
     ICoreWindow ICoreWindow_iface;
@@ -55,10 +56,17 @@ struct corewindow_impl {
     LONG ref;
 };
 
+#define DISPATCHER_PRIORITY_COUNT (CoreDispatcherPriority_High - CoreDispatcherPriority_Idle + 1)
+
 struct dispatcher_impl {
     ICoreDispatcher ICoreDispatcher_iface;
     struct corewindow_impl *for_window;
-    struct list queued_tasks;
+    HWND window; /* outlives for_window if the dispatcher is still referenced */
+    DWORD thread_id;
+    SLIST_HEADER incoming; /* tasks posted from any thread, in reverse order */
+    LONG wake_pending; /* a wake message has been posted and not yet handled */
+    struct list pending[DISPATCHER_PRIORITY_COUNT]; /* per-priority FIFO queues, only used by the dispatcher thread */
+    BOOL quit;
     LONG ref;
 };
 
@@ -66,14 +74,12 @@ struct corewindow_tls {
     struct corewindow_impl *window;
 };
 
-extern struct corewindow_impl *create_corewindow(IFrameworkView *for_view, char *identity_name, char *display_name);
-extern struct dispatcher_impl *create_dispatcher(struct corewindow_impl *for_window, char *identity_name, char *display_name);
+extern struct corewindow_impl *create_corewindow(IFrameworkView *for_view, const WCHAR *identity_name, const WCHAR *display_name);
+extern struct dispatcher_impl *create_dispatcher(struct corewindow_impl *for_window, const WCHAR *identity_name, const WCHAR *display_name);
 extern ICoreCursor *create_cursor(UINT32 id, CoreCursorType type);    
 
-typedef HRESULT (*dispatcher_func)( IInspectable *invoker );
-
-extern void *dispatcher_run_and_wait(dispatcher_func func);
-extern void dispatcher_add_queue(dispatcher_func func);
+struct appx_index_header;
+extern struct appx_index_header * WINAPI __wine_load_appx_index(const WCHAR *package_dir);
 
 extern DWORD corewindow_tls;
 extern IActivationFactory *package_factory;
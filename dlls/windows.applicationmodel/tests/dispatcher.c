@@ -0,0 +1,603 @@
+/*
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define COBJMACROS
+#include <stddef.h>
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "winuser.h"
+#include "initguid.h"
+#include "winstring.h"
+
+#include "roapi.h"
+
+#define WIDL_using_Windows_Foundation
+#define WIDL_using_Windows_Foundation_Collections
+#include "windows.foundation.h"
+#define WIDL_using_Windows_UI_Core
+#include "windows.ui.core.h"
+#define WIDL_using_Windows_ApplicationModel_Core
+#include "windows.applicationmodel.core.h"
+
+#include "wine/test.h"
+
+#define LATENCY_ITERATIONS 1000
+
+static char dispatch_order[16];
+static LONG dispatch_count;
+
+struct dispatched_handler
+{
+    IDispatchedHandler IDispatchedHandler_iface;
+    IIdleDispatchedHandler IIdleDispatchedHandler_iface;
+    char tag;
+    LARGE_INTEGER posted;
+    LONGLONG latency;
+    HANDLE event;
+    BOOL done;
+};
+
+static HRESULT WINAPI dispatched_handler_QueryInterface( IDispatchedHandler *iface, REFIID iid, void **out )
+{
+    if (IsEqualGUID( iid, &IID_IUnknown ) || IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IDispatchedHandler ))
+    {
+        IUnknown_AddRef( iface );
+        *out = iface;
+        return S_OK;
+    }
+
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI dispatched_handler_AddRef( IDispatchedHandler *iface )
+{
+    return 2;
+}
+
+static ULONG WINAPI dispatched_handler_Release( IDispatchedHandler *iface )
+{
+    return 1;
+}
+
+static HRESULT WINAPI dispatched_handler_Invoke( IDispatchedHandler *iface )
+{
+    struct dispatched_handler *impl = CONTAINING_RECORD( iface, struct dispatched_handler, IDispatchedHandler_iface );
+    LARGE_INTEGER now;
+
+    if (impl->event)
+    {
+        QueryPerformanceCounter( &now );
+        impl->latency += now.QuadPart - impl->posted.QuadPart;
+        SetEvent( impl->event );
+    }
+    else if (dispatch_count < ARRAY_SIZE(dispatch_order) - 1)
+        dispatch_order[dispatch_count++] = impl->tag;
+    impl->done = TRUE;
+
+    return S_OK;
+}
+
+static const IDispatchedHandlerVtbl dispatched_handler_vtbl =
+{
+    dispatched_handler_QueryInterface,
+    dispatched_handler_AddRef,
+    dispatched_handler_Release,
+    dispatched_handler_Invoke,
+};
+
+static HRESULT WINAPI idle_handler_QueryInterface( IIdleDispatchedHandler *iface, REFIID iid, void **out )
+{
+    if (IsEqualGUID( iid, &IID_IUnknown ) || IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IIdleDispatchedHandler ))
+    {
+        IUnknown_AddRef( iface );
+        *out = iface;
+        return S_OK;
+    }
+
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI idle_handler_AddRef( IIdleDispatchedHandler *iface )
+{
+    return 2;
+}
+
+static ULONG WINAPI idle_handler_Release( IIdleDispatchedHandler *iface )
+{
+    return 1;
+}
+
+static HRESULT WINAPI idle_handler_Invoke( IIdleDispatchedHandler *iface, IIdleDispatchedHandlerArgs *args )
+{
+    struct dispatched_handler *impl = CONTAINING_RECORD( iface, struct dispatched_handler, IIdleDispatchedHandler_iface );
+    boolean idle = FALSE;
+    HRESULT hr;
+
+    hr = IIdleDispatchedHandlerArgs_get_IsDispatcherIdle( args, &idle );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( idle == TRUE, "got idle %u.\n", idle );
+
+    if (dispatch_count < ARRAY_SIZE(dispatch_order) - 1)
+        dispatch_order[dispatch_count++] = impl->tag;
+    impl->done = TRUE;
+
+    return S_OK;
+}
+
+static const IIdleDispatchedHandlerVtbl idle_handler_vtbl =
+{
+    idle_handler_QueryInterface,
+    idle_handler_AddRef,
+    idle_handler_Release,
+    idle_handler_Invoke,
+};
+
+static void init_handler( struct dispatched_handler *handler, char tag )
+{
+    memset( handler, 0, sizeof(*handler) );
+    handler->IDispatchedHandler_iface.lpVtbl = &dispatched_handler_vtbl;
+    handler->IIdleDispatchedHandler_iface.lpVtbl = &idle_handler_vtbl;
+    handler->tag = tag;
+}
+
+#define check_action_status( action, expect ) check_action_status_( __LINE__, action, expect )
+static void check_action_status_( int line, IAsyncAction *action, AsyncStatus expect )
+{
+    AsyncStatus status;
+    IAsyncInfo *info;
+    HRESULT hr;
+
+    hr = IAsyncAction_QueryInterface( action, &IID_IAsyncInfo, (void **)&info );
+    ok_(__FILE__, line)( hr == S_OK, "QueryInterface returned %#lx\n", hr );
+    hr = IAsyncInfo_get_Status( info, &status );
+    ok_(__FILE__, line)( hr == S_OK, "get_Status returned %#lx\n", hr );
+    ok_(__FILE__, line)( status == expect, "got status %u\n", status );
+    IAsyncInfo_Release( info );
+}
+
+static void test_dispatch_order( ICoreDispatcher *dispatcher )
+{
+    struct dispatched_handler low, normal, high, idle;
+    IAsyncAction *actions[4];
+    boolean access;
+    HRESULT hr;
+    int i;
+
+    hr = ICoreDispatcher_get_HasThreadAccess( dispatcher, &access );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( access == TRUE, "got access %u.\n", access );
+
+    init_handler( &low, 'L' );
+    init_handler( &normal, 'N' );
+    init_handler( &high, 'H' );
+    init_handler( &idle, 'I' );
+    dispatch_count = 0;
+
+    hr = ICoreDispatcher_RunIdleAsync( dispatcher, &idle.IIdleDispatchedHandler_iface, &actions[0] );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = ICoreDispatcher_RunAsync( dispatcher, CoreDispatcherPriority_Low, &low.IDispatchedHandler_iface, &actions[1] );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = ICoreDispatcher_RunAsync( dispatcher, CoreDispatcherPriority_Normal, &normal.IDispatchedHandler_iface, &actions[2] );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = ICoreDispatcher_RunAsync( dispatcher, CoreDispatcherPriority_High, &high.IDispatchedHandler_iface, &actions[3] );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+
+    /* tasks are always queued, even from the dispatcher thread */
+    ok( !dispatch_count, "got %lu dispatched tasks.\n", dispatch_count );
+    for (i = 0; i < ARRAY_SIZE(actions); i++) check_action_status( actions[i], Started );
+
+    for (i = 0; i < 100 && !idle.done; i++)
+    {
+        hr = ICoreDispatcher_ProcessEvents( dispatcher, CoreProcessEventsOption_ProcessAllIfPresent );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        if (!idle.done) Sleep( 10 );
+    }
+    ok( !strcmp( dispatch_order, "HNLI" ), "got order %s.\n", debugstr_a(dispatch_order) );
+
+    for (i = 0; i < ARRAY_SIZE(actions); i++)
+    {
+        check_action_status( actions[i], Completed );
+        IAsyncAction_Release( actions[i] );
+    }
+
+    hr = ICoreDispatcher_RunAsync( dispatcher, CoreDispatcherPriority_High + 1, &high.IDispatchedHandler_iface, &actions[0] );
+    ok( hr == E_INVALIDARG, "got hr %#lx.\n", hr );
+}
+
+struct latency_params
+{
+    ICoreDispatcher *dispatcher;
+    struct dispatched_handler *done;
+};
+
+static DWORD WINAPI latency_thread( void *arg )
+{
+    struct latency_params *params = arg;
+    struct dispatched_handler handler;
+    LARGE_INTEGER frequency;
+    IAsyncAction *action;
+    boolean access;
+    HRESULT hr;
+    DWORD ret;
+    UINT i;
+
+    init_handler( &handler, 0 );
+    handler.event = CreateEventW( NULL, FALSE, FALSE, NULL );
+
+    hr = ICoreDispatcher_get_HasThreadAccess( params->dispatcher, &access );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( access == FALSE, "got access %u.\n", access );
+    hr = ICoreDispatcher_ProcessEvents( params->dispatcher, CoreProcessEventsOption_ProcessAllIfPresent );
+    ok( hr == RPC_E_WRONG_THREAD, "got hr %#lx.\n", hr );
+
+    for (i = 0; i < LATENCY_ITERATIONS; i++)
+    {
+        QueryPerformanceCounter( &handler.posted );
+        hr = ICoreDispatcher_RunAsync( params->dispatcher, CoreDispatcherPriority_Normal,
+                                       &handler.IDispatchedHandler_iface, &action );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        if (FAILED(hr)) break;
+        ret = WaitForSingleObject( handler.event, 5000 );
+        ok( !ret, "WaitForSingleObject returned %#lx\n", ret );
+        IAsyncAction_Release( action );
+        if (ret) break;
+    }
+
+    QueryPerformanceFrequency( &frequency );
+    if (i) trace( "average dispatch latency %.2f us over %u tasks\n",
+                  (double)handler.latency * 1000000 / frequency.QuadPart / i, i );
+    CloseHandle( handler.event );
+
+    hr = ICoreDispatcher_RunAsync( params->dispatcher, CoreDispatcherPriority_Low,
+                                   &params->done->IDispatchedHandler_iface, &action );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    if (SUCCEEDED(hr)) IAsyncAction_Release( action );
+    return 0;
+}
+
+static void test_dispatch_latency( ICoreDispatcher *dispatcher )
+{
+    struct latency_params params = {dispatcher};
+    struct dispatched_handler done;
+    HANDLE thread;
+    HRESULT hr;
+
+    init_handler( &done, 'D' );
+    params.done = &done;
+
+    thread = CreateThread( NULL, 0, latency_thread, &params, 0, NULL );
+    ok( !!thread, "CreateThread failed, error %lu\n", GetLastError() );
+
+    while (!done.done)
+    {
+        hr = ICoreDispatcher_ProcessEvents( dispatcher, CoreProcessEventsOption_ProcessOneAndAllPending );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        if (FAILED(hr)) break;
+    }
+
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+}
+
+static HRESULT WINAPI quit_handler_Invoke( IDispatchedHandler *iface )
+{
+    struct dispatched_handler *handler = CONTAINING_RECORD( iface, struct dispatched_handler, IDispatchedHandler_iface );
+
+    handler->done = TRUE;
+    PostQuitMessage( 0 );
+    return S_OK;
+}
+
+static const IDispatchedHandlerVtbl quit_handler_vtbl =
+{
+    dispatched_handler_QueryInterface,
+    dispatched_handler_AddRef,
+    dispatched_handler_Release,
+    quit_handler_Invoke,
+};
+
+static void test_dispatch_quit( ICoreDispatcher *dispatcher )
+{
+    struct dispatched_handler handler;
+    IAsyncAction *action;
+    HRESULT hr;
+    int i;
+
+    init_handler( &handler, 'Q' );
+    handler.IDispatchedHandler_iface.lpVtbl = &quit_handler_vtbl;
+
+    /* every loop runs until its own WM_QUIT */
+    for (i = 0; i < 2; i++)
+    {
+        winetest_push_context( "loop %d", i );
+        handler.done = FALSE;
+        hr = ICoreDispatcher_RunAsync( dispatcher, CoreDispatcherPriority_Normal, &handler.IDispatchedHandler_iface, &action );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        hr = ICoreDispatcher_ProcessEvents( dispatcher, CoreProcessEventsOption_ProcessUntilQuit );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        ok( handler.done, "task didn't run.\n" );
+        check_action_status( action, Completed );
+        IAsyncAction_Release( action );
+        winetest_pop_context();
+    }
+}
+
+struct framework_view
+{
+    IFrameworkView IFrameworkView_iface;
+    IFrameworkViewSource IFrameworkViewSource_iface;
+    ICoreWindow *window;
+    BOOL ran;
+};
+
+static HRESULT WINAPI view_QueryInterface( IFrameworkView *iface, REFIID iid, void **out )
+{
+    if (IsEqualGUID( iid, &IID_IUnknown ) || IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IFrameworkView ))
+    {
+        IUnknown_AddRef( iface );
+        *out = iface;
+        return S_OK;
+    }
+
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI view_AddRef( IFrameworkView *iface )
+{
+    return 2;
+}
+
+static ULONG WINAPI view_Release( IFrameworkView *iface )
+{
+    return 1;
+}
+
+static HRESULT WINAPI view_GetIids( IFrameworkView *iface, ULONG *iid_count, IID **iids )
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI view_GetRuntimeClassName( IFrameworkView *iface, HSTRING *class_name )
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI view_GetTrustLevel( IFrameworkView *iface, TrustLevel *trust_level )
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI view_Initialize( IFrameworkView *iface, ICoreApplicationView *application_view )
+{
+    return S_OK;
+}
+
+static HRESULT WINAPI view_SetWindow( IFrameworkView *iface, ICoreWindow *window )
+{
+    struct framework_view *impl = CONTAINING_RECORD( iface, struct framework_view, IFrameworkView_iface );
+    impl->window = window;
+    return S_OK;
+}
+
+static HRESULT WINAPI view_Load( IFrameworkView *iface, HSTRING entry_point )
+{
+    return S_OK;
+}
+
+static HRESULT WINAPI view_Run( IFrameworkView *iface )
+{
+    struct framework_view *impl = CONTAINING_RECORD( iface, struct framework_view, IFrameworkView_iface );
+    ICoreDispatcher *dispatcher;
+    HRESULT hr;
+
+    impl->ran = TRUE;
+    ok( !!impl->window, "got no window.\n" );
+    if (!impl->window) return E_FAIL;
+
+    hr = ICoreWindow_get_Dispatcher( impl->window, &dispatcher );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    if (FAILED(hr)) return hr;
+
+    test_dispatch_order( dispatcher );
+    test_dispatch_latency( dispatcher );
+    test_dispatch_quit( dispatcher );
+
+    ICoreDispatcher_Release( dispatcher );
+    return S_OK;
+}
+
+static HRESULT WINAPI view_Uninitialize( IFrameworkView *iface )
+{
+    return S_OK;
+}
+
+static const IFrameworkViewVtbl view_vtbl =
+{
+    view_QueryInterface,
+    view_AddRef,
+    view_Release,
+    view_GetIids,
+    view_GetRuntimeClassName,
+    view_GetTrustLevel,
+    view_Initialize,
+    view_SetWindow,
+    view_Load,
+    view_Run,
+    view_Uninitialize,
+};
+
+static HRESULT WINAPI view_source_QueryInterface( IFrameworkViewSource *iface, REFIID iid, void **out )
+{
+    if (IsEqualGUID( iid, &IID_IUnknown ) || IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IFrameworkViewSource ))
+    {
+        IUnknown_AddRef( iface );
+        *out = iface;
+        return S_OK;
+    }
+
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI view_source_AddRef( IFrameworkViewSource *iface )
+{
+    return 2;
+}
+
+static ULONG WINAPI view_source_Release( IFrameworkViewSource *iface )
+{
+    return 1;
+}
+
+static HRESULT WINAPI view_source_GetIids( IFrameworkViewSource *iface, ULONG *iid_count, IID **iids )
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI view_source_GetRuntimeClassName( IFrameworkViewSource *iface, HSTRING *class_name )
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI view_source_GetTrustLevel( IFrameworkViewSource *iface, TrustLevel *trust_level )
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI view_source_CreateView( IFrameworkViewSource *iface, IFrameworkView **view )
+{
+    struct framework_view *impl = CONTAINING_RECORD( iface, struct framework_view, IFrameworkViewSource_iface );
+    *view = &impl->IFrameworkView_iface;
+    return S_OK;
+}
+
+static const IFrameworkViewSourceVtbl view_source_vtbl =
+{
+    view_source_QueryInterface,
+    view_source_AddRef,
+    view_source_Release,
+    view_source_GetIids,
+    view_source_GetRuntimeClassName,
+    view_source_GetTrustLevel,
+    view_source_CreateView,
+};
+
+static void write_manifest( const WCHAR *path )
+{
+    DWORD written, size;
+    HANDLE file;
+    HRSRC res;
+    void *ptr;
+
+    file = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "failed to create %s, error %lu\n", debugstr_w(path), GetLastError() );
+
+    res = FindResourceW( NULL, L"appxmanifest.xml", (const WCHAR *)RT_RCDATA );
+    ok( res != 0, "couldn't find resource\n" );
+    ptr = LockResource( LoadResource( GetModuleHandleW( NULL ), res ) );
+    size = SizeofResource( GetModuleHandleW( NULL ), res );
+    WriteFile( file, ptr, size, &written, NULL );
+    ok( written == size, "couldn't write resource\n" );
+    CloseHandle( file );
+}
+
+static void run_CoreDispatcher(void)
+{
+    static const WCHAR *core_application_name = L"Windows.ApplicationModel.Core.CoreApplication";
+    struct framework_view view = {{&view_vtbl}, {&view_source_vtbl}};
+    ICoreApplication *application;
+    HSTRING str;
+    HRESULT hr;
+
+    hr = WindowsCreateString( core_application_name, wcslen( core_application_name ), &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = RoGetActivationFactory( str, &IID_ICoreApplication, (void **)&application );
+    WindowsDeleteString( str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    if (FAILED(hr)) return;
+
+    hr = ICoreApplication_Run( application, &view.IFrameworkViewSource_iface );
+    ok( hr == S_OK || broken(FAILED(hr)) /* not a packaged application */, "got hr %#lx.\n", hr );
+    ok( view.ran || broken(FAILED(hr)), "view didn't run.\n" );
+    if (FAILED(hr)) win_skip( "CoreApplication.Run requires a packaged application.\n" );
+
+    ICoreApplication_Release( application );
+}
+
+static void test_CoreDispatcher(void)
+{
+    WCHAR temp[MAX_PATH], dir[MAX_PATH], exe[MAX_PATH], path[MAX_PATH], cmdline[MAX_PATH * 2];
+    PROCESS_INFORMATION info;
+    STARTUPINFOW startup;
+    BOOL ret;
+
+    /* the manifest is read from the directory of the main executable, run a copy in a temp directory */
+    GetTempPathW( ARRAY_SIZE(temp), temp );
+    GetTempFileNameW( temp, L"wdt", 0, dir );
+    DeleteFileW( dir );
+    ret = CreateDirectoryW( dir, NULL );
+    ok( ret, "failed to create %s, error %lu\n", debugstr_w(dir), GetLastError() );
+
+    GetModuleFileNameW( NULL, path, ARRAY_SIZE(path) );
+    swprintf( exe, ARRAY_SIZE(exe), L"%s\\%s", dir, wcsrchr( path, '\\' ) + 1 );
+    ret = CopyFileW( path, exe, FALSE );
+    ok( ret, "failed to copy %s, error %lu\n", debugstr_w(path), GetLastError() );
+    swprintf( path, ARRAY_SIZE(path), L"%s\\appxmanifest.xml", dir );
+    write_manifest( path );
+
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    swprintf( cmdline, ARRAY_SIZE(cmdline), L"\"%s\" dispatcher run", exe );
+    ret = CreateProcessW( exe, cmdline, NULL, NULL, FALSE, 0, NULL, dir, &startup, &info );
+    ok( ret, "failed to run %s, error %lu\n", debugstr_w(exe), GetLastError() );
+    if (ret)
+    {
+        wait_child_process( info.hProcess );
+        CloseHandle( info.hProcess );
+        CloseHandle( info.hThread );
+    }
+
+    DeleteFileW( path );
+    DeleteFileW( exe );
+    RemoveDirectoryW( dir );
+}
+
+START_TEST(dispatcher)
+{
+    HRESULT hr;
+    char **argv;
+    int argc;
+
+    hr = RoInitialize( RO_INIT_MULTITHREADED );
+    ok( hr == S_OK, "RoInitialize failed, hr %#lx\n", hr );
+
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 3 && !strcmp( argv[2], "run" )) run_CoreDispatcher();
+    else test_CoreDispatcher();
+
+    RoUninitialize();
+}
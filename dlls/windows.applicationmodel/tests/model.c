@@ -36,6 +36,7 @@
 #include "windows.applicationmodel.h"
 #include "windows.management.deployment.h"
 
+#include "wine/appxindex.h"
 #include "wine/test.h"
 #include "winrt_test.h"
 
@@ -579,6 +580,161 @@ static void test_PackageStatics(void)
     ok( ref == 1, "got ref %ld.\n", ref );
 }
 
+static void write_manifest( const WCHAR *path, const char *data )
+{
+    DWORD written;
+    HANDLE file;
+
+    file = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "failed to create %s, error %lu\n", debugstr_w(path), GetLastError() );
+    WriteFile( file, data, strlen( data ), &written, NULL );
+    ok( written == strlen( data ), "couldn't write manifest\n" );
+    CloseHandle( file );
+}
+
+static void test_manifest_index(void)
+{
+    static const char manifest_fmt[] =
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "<Package xmlns=\"http://schemas.microsoft.com/appx/manifest/foundation/windows10\">\n"
+        "  <Identity Name=\"WineTest\" Publisher=\"CN=Wine\" Version=\"1.0.0.0\" />\n"
+        "  <Properties><DisplayName>%s</DisplayName></Properties>\n"
+        "  <Capabilities><Capability Name=\"internetClient\" /></Capabilities>\n"
+        "  <Applications><Application Id=\"WineTest\" Executable=\"application.exe\" EntryPoint=\"WineTest.App\" /></Applications>\n"
+        "  <Extensions>\n"
+        "    <Extension Category=\"windows.activatableClass.inProcessServer\">\n"
+        "      <InProcessServer>\n"
+        "        <Path>wineclass.dll</Path>\n"
+        "%s"
+        "      </InProcessServer>\n"
+        "    </Extension>\n"
+        "  </Extensions>\n"
+        "</Package>\n";
+    static const char invalid_manifest[] =
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "<Package xmlns=\"http://schemas.microsoft.com/appx/manifest/foundation/windows10\">\n"
+        "  <Properties><DisplayName>WineTest</DisplayName></Properties>\n"
+        "</Package>\n";
+    struct appx_index_header * (WINAPI *pload)( const WCHAR *package_dir );
+    HRESULT (WINAPI *pcompile)( const WCHAR *package_dir );
+    WCHAR temp[MAX_PATH], manifest[MAX_PATH], index[MAX_PATH];
+    const struct appx_index_class *class;
+    struct appx_index_header *header;
+    LARGE_INTEGER frequency, start, end;
+    char *classes, *data;
+    DWORD written;
+    HMODULE module;
+    HANDLE file;
+    HRESULT hr;
+    UINT i;
+
+    module = LoadLibraryW( L"windows.applicationmodel.dll" );
+    ok( !!module, "LoadLibraryW failed, error %lu\n", GetLastError() );
+    pcompile = (void *)GetProcAddress( module, "__wine_compile_appx_manifest" );
+    pload = (void *)GetProcAddress( module, "__wine_load_appx_index" );
+    if (!pcompile || !pload)
+    {
+        win_skip( "__wine_compile_appx_manifest not found, skipping tests.\n" );
+        FreeLibrary( module );
+        return;
+    }
+
+    GetTempPathW( ARRAY_SIZE(temp), temp );
+    GetTempFileNameW( temp, L"winetest-appx", 0, temp );
+    DeleteFileW( temp );
+    CreateDirectoryW( temp, NULL );
+    swprintf( manifest, ARRAY_SIZE(manifest), L"%s\\AppxManifest.xml", temp );
+    swprintf( index, ARRAY_SIZE(index), L"%s\\AppxManifest.wineidx", temp );
+
+    hr = pcompile( temp );
+    ok( hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), "got hr %#lx.\n", hr );
+
+    write_manifest( manifest, invalid_manifest );
+    hr = pcompile( temp );
+    ok( hr == APPX_E_INVALID_MANIFEST, "got hr %#lx.\n", hr );
+    ok( GetFileAttributesW( index ) == INVALID_FILE_ATTRIBUTES, "index was written\n" );
+
+    classes = malloc( 1000 * 80 );
+    data = malloc( 1000 * 80 + sizeof(manifest_fmt) + 64 );
+    for (classes[0] = 0, i = 0; i < 1000; i++)
+        sprintf( classes + strlen( classes ), "        <ActivatableClass ActivatableClassId=\"WineTest.Class%u\" />\n", i );
+
+    sprintf( data, manifest_fmt, "WineTest", classes );
+    write_manifest( manifest, data );
+
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &start );
+    hr = pcompile( temp );
+    QueryPerformanceCounter( &end );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    trace( "compiled a manifest with 1000 classes in %.3f ms\n",
+           (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart );
+
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < 100; i++)
+    {
+        hr = pcompile( temp );
+        if (hr != S_FALSE) break;
+    }
+    QueryPerformanceCounter( &end );
+    ok( hr == S_FALSE, "got hr %#lx.\n", hr );
+    trace( "checked an up to date index in %.3f ms\n",
+           (end.QuadPart - start.QuadPart) * 10.0 / frequency.QuadPart );
+
+    header = pload( temp );
+    ok( !!header, "failed to load the index\n" );
+    if (header)
+    {
+        ok( header->class_count == 1000, "got %lu classes\n", header->class_count );
+        ok( !wcscmp( appx_index_string( header, header->display_name ), L"WineTest" ), "got display name %s\n",
+            debugstr_w(appx_index_string( header, header->display_name )) );
+        class = appx_index_find_class( header, L"WineTest.Class500" );
+        ok( class && !wcscmp( appx_index_string( header, class->path ), L"wineclass.dll" ), "class not found\n" );
+        ok( !appx_index_find_class( header, L"WineTest.Class1000" ), "found a missing class\n" );
+        HeapFree( GetProcessHeap(), 0, header );
+    }
+
+    /* any change to the manifest size or write time makes the index stale */
+    sprintf( data, manifest_fmt, "WineTest2", classes );
+    write_manifest( manifest, data );
+    hr = pcompile( temp );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = pcompile( temp );
+    ok( hr == S_FALSE, "got hr %#lx.\n", hr );
+
+    /* and so does a damaged index */
+    if (GetFileAttributesW( index ) != INVALID_FILE_ATTRIBUTES)
+    {
+        file = CreateFileW( index, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, 0 );
+        ok( file != INVALID_HANDLE_VALUE, "failed to open %s, error %lu\n", debugstr_w(index), GetLastError() );
+        WriteFile( file, "garbage", 7, &written, NULL );
+        CloseHandle( file );
+        hr = pcompile( temp );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        hr = pcompile( temp );
+        ok( hr == S_FALSE, "got hr %#lx.\n", hr );
+
+        /* loading recompiles it as well */
+        file = CreateFileW( index, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, 0 );
+        ok( file != INVALID_HANDLE_VALUE, "failed to open %s, error %lu\n", debugstr_w(index), GetLastError() );
+        WriteFile( file, "garbage", 7, &written, NULL );
+        CloseHandle( file );
+        header = pload( temp );
+        ok( !!header, "failed to load the index\n" );
+        if (header) ok( header->class_count == 1000, "got %lu classes\n", header->class_count );
+        HeapFree( GetProcessHeap(), 0, header );
+        hr = pcompile( temp );
+        ok( hr == S_FALSE, "got hr %#lx.\n", hr );
+    }
+
+    free( data );
+    free( classes );
+    DeleteFileW( index );
+    DeleteFileW( manifest );
+    RemoveDirectoryW( temp );
+    FreeLibrary( module );
+}
+
 START_TEST(model)
 {
     HRESULT hr;
@@ -588,6 +744,7 @@ START_TEST(model)
 
     test_PackageManager();
     test_PackageStatics();
+    test_manifest_index();
 
     RoUninitialize();
 }
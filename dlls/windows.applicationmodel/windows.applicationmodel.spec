@@ -1,3 +1,5 @@
 @ stdcall -private DllCanUnloadNow()
 @ stdcall -private DllGetActivationFactory(ptr ptr)
 @ stdcall -private DllGetClassObject(ptr ptr ptr)
+@ stdcall -private __wine_compile_appx_manifest(wstr)
+@ stdcall -private __wine_load_appx_index(wstr)
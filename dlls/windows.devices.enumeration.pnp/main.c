@@ -268,7 +268,7 @@ static const struct IPnpObjectVtbl pnpobj_vtbl =
     pnpobj_Update
 };
 
-static HRESULT create_from_id_async( IInspectable *invoker, IInspectable **result )
+static HRESULT WINAPI create_from_id_async( IUnknown *invoker, IUnknown *param, IInspectable **result )
 {
     struct pnpobj_impl *impl;
     HRESULT hr;
@@ -296,7 +296,7 @@ static HRESULT create_from_id_async( IInspectable *invoker, IInspectable **resul
     return S_OK;
 }
 
-static HRESULT find_all_async( IInspectable *invoker, IInspectable **result )
+static HRESULT WINAPI find_all_async( IUnknown *invoker, IUnknown *param, IInspectable **result )
 {
     static const struct vector_iids iids =
     {
@@ -313,20 +313,20 @@ static HRESULT find_all_async( IInspectable *invoker, IInspectable **result )
 static HRESULT WINAPI pnpstatic_CreateFromIdAsync( IPnpObjectStatics *iface, PnpObjectType type, HSTRING id, IIterable_HSTRING* requestedProperties, IAsyncOperation_PnpObject** asyncOp)
 {
     FIXME( "iface %p, type %04x, id %s, requestedProperties %p, asyncOp %p semi-stub!\n", iface, type, debugstr_hstring(id), requestedProperties, asyncOp );
-    return async_operation_inspectable_create(&IID_IAsyncOperation_PnpObject, NULL, create_from_id_async, (IAsyncOperation_IInspectable **)asyncOp);
+    return async_operation_inspectable_create(&IID_IAsyncOperation_PnpObject, NULL, NULL, create_from_id_async, 0, (IAsyncOperation_IInspectable **)asyncOp);
 }
 
 static HRESULT WINAPI pnpstatic_FindAllAsync( IPnpObjectStatics *iface, PnpObjectType type, IIterable_HSTRING* requestedProperties, IAsyncOperation_PnpObjectCollection** asyncOp ) 
 {
     FIXME( "iface %p, type %04x, requestedProperties %p, asyncOp %p stub!\n", iface, type, requestedProperties, asyncOp );
-    return async_operation_inspectable_create(&IID_IAsyncOperation_PnpObjectCollection, NULL, find_all_async, (IAsyncOperation_IInspectable **)asyncOp);
+    return async_operation_inspectable_create(&IID_IAsyncOperation_PnpObjectCollection, NULL, NULL, find_all_async, 0, (IAsyncOperation_IInspectable **)asyncOp);
 }
 
 static HRESULT WINAPI pnpstatic_FindAllAsyncAqsFilter( IPnpObjectStatics *iface, PnpObjectType type, IIterable_HSTRING* requestedProperties, HSTRING aqsFilter, IAsyncOperation_PnpObjectCollection** asyncOp ) 
 {
     FIXME( "iface %p, type %04x, requestedProperties %p, aqsFilter %s, asyncOp %p stub!\n", iface, type, requestedProperties, debugstr_hstring(aqsFilter), asyncOp );
     //TODO: Filter not implemented
-    return async_operation_inspectable_create(&IID_IAsyncOperation_PnpObjectCollection, NULL, find_all_async, (IAsyncOperation_IInspectable **)asyncOp);
+    return async_operation_inspectable_create(&IID_IAsyncOperation_PnpObjectCollection, NULL, NULL, find_all_async, 0, (IAsyncOperation_IInspectable **)asyncOp);
 }
 
 static HRESULT WINAPI pnpstatic_CreateWatcher( IPnpObjectStatics *iface, PnpObjectType type, IIterable_HSTRING* requestedProperties, __x_ABI_CWindows_CDevices_CEnumeration_CPnp_CIPnpObjectWatcher** watcher)
@@ -37,16 +37,10 @@
 #include "windows.devices.sensors.h"
 
 #include "wine/list.h"
+#include "wine/winrtasync.h"
 
 extern IActivationFactory *accelerometer_factory;
 
-typedef HRESULT (*async_action_callback)( IInspectable *invoker );
-typedef HRESULT (*async_operation_inspectable_callback)( IInspectable *invoker, IInspectable **result );
-
-HRESULT async_action_create( IInspectable *invoker, async_action_callback callback, IAsyncAction **out );
-HRESULT async_operation_inspectable_create( const GUID *iid, IInspectable *invoker, async_operation_inspectable_callback callback,
-                                            IAsyncOperation_IInspectable **out );                                                           
-
 #define DEFINE_IINSPECTABLE_( pfx, iface_type, impl_type, impl_from, iface_mem, expr )             \
     static inline impl_type *impl_from( iface_type *iface )                                        \
     {                                                                                              \
@@ -601,7 +601,7 @@ static HRESULT WINAPI motor_get_SupportedAxes( IForceFeedbackMotor *iface, enum
     return hr;
 }
 
-static HRESULT WINAPI motor_load_effect_async( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+static HRESULT WINAPI motor_load_effect_async( IUnknown *invoker, IUnknown *param, UINT32 *result )
 {
     struct effect *effect = impl_from_IForceFeedbackEffect( (IForceFeedbackEffect *)param );
     IForceFeedbackMotor *motor = (IForceFeedbackMotor *)invoker;
@@ -650,10 +650,9 @@ static HRESULT WINAPI motor_load_effect_async( IUnknown *invoker, IUnknown *para
 
     LeaveCriticalSection( &effect->cs );
 
-    result->vt = VT_UI4;
-    if (SUCCEEDED(hr)) result->ulVal = ForceFeedbackLoadEffectResult_Succeeded;
-    else if (hr == DIERR_DEVICEFULL) result->ulVal = ForceFeedbackLoadEffectResult_EffectStorageFull;
-    else result->ulVal = ForceFeedbackLoadEffectResult_EffectNotSupported;
+    if (SUCCEEDED(hr)) *result = ForceFeedbackLoadEffectResult_Succeeded;
+    else if (hr == DIERR_DEVICEFULL) *result = ForceFeedbackLoadEffectResult_EffectStorageFull;
+    else *result = ForceFeedbackLoadEffectResult_EffectNotSupported;
 
     return hr;
 }
@@ -662,7 +661,10 @@ static HRESULT WINAPI motor_LoadEffectAsync( IForceFeedbackMotor *iface, IForceF
                                              IAsyncOperation_ForceFeedbackLoadEffectResult **async_op )
 {
     TRACE( "iface %p, effect %p, async_op %p.\n", iface, effect, async_op );
-    return async_operation_effect_result_create( (IUnknown *)iface, (IUnknown *)effect, motor_load_effect_async, async_op );
+    return async_operation_uint32_create( &IID_IAsyncOperation_ForceFeedbackLoadEffectResult,
+                                          L"Windows.Foundation.IAsyncOperation`1<Windows.Gaming.Input.ForceFeedback.ForceFeedbackLoadEffectResult>",
+                                          (IUnknown *)iface, (IUnknown *)effect, motor_load_effect_async, 0,
+                                          (IAsyncOperation_UINT32 **)async_op );
 }
 
 static HRESULT WINAPI motor_PauseAllEffects( IForceFeedbackMotor *iface )
@@ -692,14 +694,13 @@ static HRESULT WINAPI motor_StopAllEffects( IForceFeedbackMotor *iface )
     return IDirectInputDevice8_SendForceFeedbackCommand( impl->device, DISFFC_STOPALL );
 }
 
-static HRESULT WINAPI motor_try_disable_async( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+static HRESULT WINAPI motor_try_disable_async( IUnknown *invoker, IUnknown *param, BOOLEAN *result )
 {
     struct motor *impl = impl_from_IForceFeedbackMotor( (IForceFeedbackMotor *)invoker );
     HRESULT hr;
 
     hr = IDirectInputDevice8_SendForceFeedbackCommand( impl->device, DISFFC_SETACTUATORSOFF );
-    result->vt = VT_BOOL;
-    result->boolVal = SUCCEEDED(hr);
+    *result = SUCCEEDED(hr);
 
     return hr;
 }
@@ -707,17 +708,16 @@ static HRESULT WINAPI motor_try_disable_async( IUnknown *invoker, IUnknown *para
 static HRESULT WINAPI motor_TryDisableAsync( IForceFeedbackMotor *iface, IAsyncOperation_boolean **async_op )
 {
     TRACE( "iface %p, async_op %p.\n", iface, async_op );
-    return async_operation_boolean_create( (IUnknown *)iface, NULL, motor_try_disable_async, async_op );
+    return async_operation_boolean_create( (IUnknown *)iface, NULL, motor_try_disable_async, 0, async_op );
 }
 
-static HRESULT WINAPI motor_try_enable_async( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+static HRESULT WINAPI motor_try_enable_async( IUnknown *invoker, IUnknown *param, BOOLEAN *result )
 {
     struct motor *impl = impl_from_IForceFeedbackMotor( (IForceFeedbackMotor *)invoker );
     HRESULT hr;
 
     hr = IDirectInputDevice8_SendForceFeedbackCommand( impl->device, DISFFC_SETACTUATORSON );
-    result->vt = VT_BOOL;
-    result->boolVal = SUCCEEDED(hr);
+    *result = SUCCEEDED(hr);
 
     return hr;
 }
@@ -725,17 +725,16 @@ static HRESULT WINAPI motor_try_enable_async( IUnknown *invoker, IUnknown *param
 static HRESULT WINAPI motor_TryEnableAsync( IForceFeedbackMotor *iface, IAsyncOperation_boolean **async_op )
 {
     TRACE( "iface %p, async_op %p.\n", iface, async_op );
-    return async_operation_boolean_create( (IUnknown *)iface, NULL, motor_try_enable_async, async_op );
+    return async_operation_boolean_create( (IUnknown *)iface, NULL, motor_try_enable_async, 0, async_op );
 }
 
-static HRESULT WINAPI motor_try_reset_async( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+static HRESULT WINAPI motor_try_reset_async( IUnknown *invoker, IUnknown *param, BOOLEAN *result )
 {
     struct motor *impl = impl_from_IForceFeedbackMotor( (IForceFeedbackMotor *)invoker );
     HRESULT hr;
 
     hr = IDirectInputDevice8_SendForceFeedbackCommand( impl->device, DISFFC_RESET );
-    result->vt = VT_BOOL;
-    result->boolVal = SUCCEEDED(hr);
+    *result = SUCCEEDED(hr);
 
     return hr;
 }
@@ -743,10 +742,10 @@ static HRESULT WINAPI motor_try_reset_async( IUnknown *invoker, IUnknown *param,
 static HRESULT WINAPI motor_TryResetAsync( IForceFeedbackMotor *iface, IAsyncOperation_boolean **async_op )
 {
     TRACE( "iface %p, async_op %p.\n", iface, async_op );
-    return async_operation_boolean_create( (IUnknown *)iface, NULL, motor_try_reset_async, async_op );
+    return async_operation_boolean_create( (IUnknown *)iface, NULL, motor_try_reset_async, 0, async_op );
 }
 
-static HRESULT WINAPI motor_unload_effect_async( IUnknown *iface, IUnknown *param, PROPVARIANT *result )
+static HRESULT WINAPI motor_unload_effect_async( IUnknown *iface, IUnknown *param, BOOLEAN *result )
 {
     struct effect *effect = impl_from_IForceFeedbackEffect( (IForceFeedbackEffect *)param );
     IDirectInputEffect *dinput_effect;
@@ -764,8 +763,7 @@ static HRESULT WINAPI motor_unload_effect_async( IUnknown *iface, IUnknown *para
         IDirectInputEffect_Release( dinput_effect );
     }
 
-    result->vt = VT_BOOL;
-    result->boolVal = SUCCEEDED(hr);
+    *result = SUCCEEDED(hr);
     return hr;
 }
 
@@ -782,7 +780,7 @@ static HRESULT WINAPI motor_TryUnloadEffectAsync( IForceFeedbackMotor *iface, IF
     LeaveCriticalSection( &impl->cs );
     if (FAILED(hr)) return hr;
 
-    return async_operation_boolean_create( (IUnknown *)iface, (IUnknown *)effect, motor_unload_effect_async, async_op );
+    return async_operation_boolean_create( (IUnknown *)iface, (IUnknown *)effect, motor_unload_effect_async, 0, async_op );
 }
 
 static const struct IForceFeedbackMotorVtbl motor_vtbl =
@@ -41,6 +41,7 @@
 
 #include "wine/debug.h"
 #include "wine/list.h"
+#include "wine/winrtasync.h"
 
 #include "provider.h"
 
@@ -76,12 +77,6 @@ extern void event_handlers_notify( struct list *list, IInspectable *element );
 extern HRESULT force_feedback_motor_create( IDirectInputDevice8W *device, IForceFeedbackMotor **out );
 extern HRESULT force_feedback_effect_create( enum WineForceFeedbackEffectType type, IInspectable *outer, IWineForceFeedbackEffectImpl **out );
 
-typedef HRESULT (WINAPI *async_operation_callback)( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
-extern HRESULT async_operation_boolean_create( IUnknown *invoker, IUnknown *param, async_operation_callback callback,
-                                               IAsyncOperation_boolean **out );
-extern HRESULT async_operation_effect_result_create( IUnknown *invoker, IUnknown *param, async_operation_callback callback,
-                                                     IAsyncOperation_ForceFeedbackLoadEffectResult **out );
-
 #define DEFINE_IINSPECTABLE_( pfx, iface_type, impl_type, impl_from, iface_mem, expr )             \
     static inline impl_type *impl_from( iface_type *iface )                                        \
     {                                                                                              \
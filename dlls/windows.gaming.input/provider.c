@@ -42,6 +42,12 @@ static CRITICAL_SECTION provider_cs = { &provider_cs_debug, -1, 0, 0, 0, 0 };
 
 static struct list provider_list = LIST_INIT( provider_list );
 
+struct provider_state
+{
+    UINT64 timestamp;
+    DIJOYSTATE2 data;
+};
+
 struct provider
 {
     IWineGameControllerProvider IWineGameControllerProvider_iface;
@@ -63,6 +69,19 @@ struct provider
     BYTE haptics_report;
     HIDP_CAPS caps;
     HANDLE device;
+
+    /* offsets and WineGameControllerState indexes of the axes the device has */
+    UINT axis_count;
+    WORD axis_offsets[32];
+    BYTE axis_slots[32];
+
+    /* latest device state, updated by state_wait whenever dinput signals
+     * state_event and read without locking, state_seq is odd during updates */
+    TP_WAIT *state_wait;
+    HANDLE state_event;
+    LONG state_closing;
+    LONG state_seq;
+    struct provider_state state;
 };
 
 static inline struct provider *impl_from_IWineGameControllerProvider( IWineGameControllerProvider *iface )
@@ -113,7 +132,12 @@ static ULONG WINAPI wine_provider_Release( IWineGameControllerProvider *iface )
 
     if (!ref)
     {
+        WriteNoFence( &impl->state_closing, TRUE );
+        SetThreadpoolWait( impl->state_wait, NULL, NULL );
+        WaitForThreadpoolWaitCallbacks( impl->state_wait, TRUE );
+        CloseThreadpoolWait( impl->state_wait );
         IDirectInputDevice8_Release( impl->dinput_device );
+        CloseHandle( impl->state_event );
         HidD_FreePreparsedData( impl->preparsed );
         CloseHandle( impl->device );
         free( impl->report_buf );
@@ -217,62 +241,36 @@ static HRESULT WINAPI wine_provider_get_SwitchCount( IWineGameControllerProvider
 static HRESULT WINAPI wine_provider_get_State( IWineGameControllerProvider *iface, struct WineGameControllerState *out )
 {
     struct provider *impl = impl_from_IWineGameControllerProvider( iface );
-    DIJOYSTATE2 state = {0};
-    UINT32 i = 0;
-    HRESULT hr;
+    struct provider_state state;
+    LONG seq;
+    UINT32 i;
 
     TRACE( "iface %p, out %p.\n", iface, out );
 
-    if (FAILED(hr = IDirectInputDevice8_GetDeviceState( impl->dinput_device, sizeof(state), &state )))
+    do
     {
-        WARN( "Failed to read device state, hr %#lx\n", hr );
-        return S_OK;
-    }
+        while ((seq = ReadAcquire( &impl->state_seq )) & 1) YieldProcessor();
+        state = impl->state;
+        MemoryBarrier();
+    } while (ReadNoFence( &impl->state_seq ) != seq);
 
-    i = ARRAY_SIZE(state.rgbButtons);
-    while (i--) out->buttons[i] = (state.rgbButtons[i] != 0);
+    i = ARRAY_SIZE(state.data.rgbButtons);
+    while (i--) out->buttons[i] = (state.data.rgbButtons[i] != 0);
 
-    i = ARRAY_SIZE(state.rgdwPOV);
+    i = ARRAY_SIZE(state.data.rgdwPOV);
     while (i--)
     {
-        if (state.rgdwPOV[i] == ~0) out->switches[i] = GameControllerSwitchPosition_Center;
-        else out->switches[i] = state.rgdwPOV[i] * 8 / 36000 + 1;
+        if (state.data.rgdwPOV[i] == ~0) out->switches[i] = GameControllerSwitchPosition_Center;
+        else out->switches[i] = state.data.rgdwPOV[i] * 8 / 36000 + 1;
     }
 
-    i = 0;
-    out->axes[i++] = state.lX / 65535.;
-    out->axes[i++] = state.lY / 65535.;
-    out->axes[i++] = state.lZ / 65535.;
-    out->axes[i++] = state.lRx / 65535.;
-    out->axes[i++] = state.lRy / 65535.;
-    out->axes[i++] = state.lRz / 65535.;
-    out->axes[i++] = state.rglSlider[0] / 65535.;
-    out->axes[i++] = state.rglSlider[1] / 65535.;
-    out->axes[i++] = state.lVX / 65535.;
-    out->axes[i++] = state.lVY / 65535.;
-    out->axes[i++] = state.lVZ / 65535.;
-    out->axes[i++] = state.lVRx / 65535.;
-    out->axes[i++] = state.lVRy / 65535.;
-    out->axes[i++] = state.lVRz / 65535.;
-    out->axes[i++] = state.rglVSlider[0] / 65535.;
-    out->axes[i++] = state.rglVSlider[1] / 65535.;
-    out->axes[i++] = state.lAX / 65535.;
-    out->axes[i++] = state.lAY / 65535.;
-    out->axes[i++] = state.lAZ / 65535.;
-    out->axes[i++] = state.lARx / 65535.;
-    out->axes[i++] = state.lARy / 65535.;
-    out->axes[i++] = state.lARz / 65535.;
-    out->axes[i++] = state.rglASlider[0] / 65535.;
-    out->axes[i++] = state.rglASlider[1] / 65535.;
-    out->axes[i++] = state.lFX / 65535.;
-    out->axes[i++] = state.lFY / 65535.;
-    out->axes[i++] = state.lFZ / 65535.;
-    out->axes[i++] = state.lFRx / 65535.;
-    out->axes[i++] = state.lFRy / 65535.;
-    out->axes[i++] = state.lFRz / 65535.;
-    out->axes[i++] = state.rglFSlider[0] / 65535.;
-    out->axes[i++] = state.rglFSlider[1] / 65535.;
-    out->timestamp = GetTickCount64();
+    memset( out->axes, 0, sizeof(out->axes) );
+    for (i = 0; i < impl->axis_count; i++)
+    {
+        LONG value = *(LONG *)((BYTE *)&state.data + impl->axis_offsets[i]);
+        out->axes[impl->axis_slots[i]] = value / 65535.;
+    }
+    out->timestamp = state.timestamp;
 
     return S_OK;
 }
@@ -427,6 +425,55 @@ static const struct IGameControllerProviderVtbl game_provider_vtbl =
     game_provider_get_IsConnected,
 };
 
+static void update_state( struct provider *provider )
+{
+    LARGE_INTEGER counter, frequency;
+    DIJOYSTATE2 data;
+    HRESULT hr;
+
+    if (FAILED(hr = IDirectInputDevice8_GetDeviceState( provider->dinput_device, sizeof(data), &data )))
+    {
+        WARN( "Failed to read device state, hr %#lx\n", hr );
+        return;
+    }
+
+    QueryPerformanceCounter( &counter );
+    QueryPerformanceFrequency( &frequency );
+
+    /* there's only a single writer, the wait callback doesn't run concurrently with itself */
+    InterlockedIncrement( &provider->state_seq );
+    provider->state.data = data;
+    provider->state.timestamp = counter.QuadPart / frequency.QuadPart * 1000000
+                              + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+    InterlockedIncrement( &provider->state_seq );
+}
+
+static void CALLBACK state_wait_callback( TP_CALLBACK_INSTANCE *instance, void *context, TP_WAIT *wait, TP_WAIT_RESULT result )
+{
+    struct provider *provider = context;
+
+    update_state( provider );
+    if (!ReadNoFence( &provider->state_closing )) SetThreadpoolWait( wait, provider->state_event, NULL );
+}
+
+static BOOL CALLBACK enum_axes( const DIDEVICEOBJECTINSTANCEW *obj, void *args )
+{
+    struct provider *provider = args;
+    DWORD offset = obj->dwOfs, slot;
+
+    /* WineGameControllerState axes are in DIJOYSTATE2 order, skipping POVs and buttons */
+    if (offset < offsetof(DIJOYSTATE2, rgdwPOV)) slot = offset / sizeof(LONG);
+    else if (offset >= offsetof(DIJOYSTATE2, lVX) && offset < sizeof(DIJOYSTATE2))
+        slot = offsetof(DIJOYSTATE2, rgdwPOV) / sizeof(LONG) + (offset - offsetof(DIJOYSTATE2, lVX)) / sizeof(LONG);
+    else return DIENUM_CONTINUE;
+
+    if (provider->axis_count >= ARRAY_SIZE(provider->axis_slots)) return DIENUM_STOP;
+    provider->axis_offsets[provider->axis_count] = offset;
+    provider->axis_slots[provider->axis_count] = slot;
+    provider->axis_count++;
+    return DIENUM_CONTINUE;
+}
+
 static void check_haptics_caps( struct provider *provider, HANDLE device, PHIDP_PREPARSED_DATA preparsed,
                                 HIDP_LINK_COLLECTION_NODE *collections, HIDP_VALUE_CAPS *caps )
 {
@@ -550,6 +597,8 @@ void provider_create( const WCHAR *device_path )
     struct provider *impl, *entry;
     GUID guid = device_path_guid;
     IDirectInput8W *dinput;
+    HANDLE event = NULL;
+    TP_WAIT *wait = NULL;
     BOOL found = FALSE;
     const WCHAR *tmp;
     HRESULT hr;
@@ -568,9 +617,16 @@ void provider_create( const WCHAR *device_path )
 
     if (FAILED(hr = IDirectInputDevice8_SetCooperativeLevel( dinput_device, 0, DISCL_BACKGROUND | DISCL_NONEXCLUSIVE ))) goto done;
     if (FAILED(hr = IDirectInputDevice8_SetDataFormat( dinput_device, &c_dfDIJoystick2 ))) goto done;
+    if (!(event = CreateEventW( NULL, FALSE, FALSE, NULL ))) goto done;
+    if (FAILED(hr = IDirectInputDevice8_SetEventNotification( dinput_device, event ))) goto done;
     if (FAILED(hr = IDirectInputDevice8_Acquire( dinput_device ))) goto done;
 
     if (!(impl = calloc( 1, sizeof(*impl) ))) goto done;
+    if (!(wait = CreateThreadpoolWait( state_wait_callback, impl, NULL )))
+    {
+        free( impl );
+        goto done;
+    }
     impl->IWineGameControllerProvider_iface.lpVtbl = &wine_provider_vtbl;
     impl->IGameControllerProvider_iface.lpVtbl = &game_provider_vtbl;
     IDirectInputDevice_AddRef( dinput_device );
@@ -581,6 +637,13 @@ void provider_create( const WCHAR *device_path )
     list_init( &impl->entry );
     open_haptics_device( impl );
 
+    IDirectInputDevice8_EnumObjects( dinput_device, enum_axes, impl, DIDFT_AXIS );
+    update_state( impl );
+    impl->state_event = event;
+    impl->state_wait = wait;
+    event = NULL;
+    SetThreadpoolWait( wait, impl->state_event, NULL );
+
     provider = &impl->IGameControllerProvider_iface;
     TRACE( "created WineGameControllerProvider %p\n", provider );
 
@@ -593,6 +656,7 @@ void provider_create( const WCHAR *device_path )
     if (found) IGameControllerProvider_Release( provider );
     else manager_on_provider_created( provider );
 done:
+    if (event) CloseHandle( event );
     IDirectInputDevice_Release( dinput_device );
 }
 
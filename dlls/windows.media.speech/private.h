@@ -42,6 +42,7 @@
 #include "windows.media.speechrecognition.h"
 
 #include "wine/list.h"
+#include "wine/winrtasync.h"
 
 /*
  *
@@ -70,13 +71,6 @@ struct vector_iids
     const GUID *view;
 };
 
-typedef HRESULT (*async_action_callback)( IInspectable *invoker );
-typedef HRESULT (*async_operation_inspectable_callback)( IInspectable *invoker, IInspectable **result );
-
-HRESULT async_action_create( IInspectable *invoker, async_action_callback callback, IAsyncAction **out );
-HRESULT async_operation_inspectable_create( const GUID *iid, IInspectable *invoker, async_operation_inspectable_callback callback,
-                                            IAsyncOperation_IInspectable **out );
-
 HRESULT typed_event_handlers_append( struct list *list, ITypedEventHandler_IInspectable_IInspectable *handler, EventRegistrationToken *token );
 HRESULT typed_event_handlers_remove( struct list *list, EventRegistrationToken *token );
 HRESULT typed_event_handlers_notify( struct list *list, IInspectable *sender, IInspectable *args );
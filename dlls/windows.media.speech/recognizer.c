@@ -382,7 +382,7 @@ static HRESULT WINAPI session_set_AutoStopSilenceTimeout( ISpeechContinuousRecog
     return E_NOTIMPL;
 }
 
-static HRESULT session_start_async( IInspectable *invoker )
+static HRESULT WINAPI session_start_async( IUnknown *invoker, IUnknown *param )
 {
     return S_OK;
 }
@@ -394,7 +394,7 @@ static HRESULT WINAPI session_StartAsync( ISpeechContinuousRecognitionSession *i
 
     TRACE("iface %p, action %p.\n", iface, action);
 
-    if (FAILED(hr = async_action_create(NULL, session_start_async, action)))
+    if (FAILED(hr = async_action_create(NULL, NULL, session_start_async, 0, action)))
         return hr;
 
     EnterCriticalSection(&impl->cs);
@@ -431,7 +431,7 @@ static HRESULT WINAPI session_StartWithModeAsync( ISpeechContinuousRecognitionSe
     return E_NOTIMPL;
 }
 
-static HRESULT session_stop_async( IInspectable *invoker )
+static HRESULT WINAPI session_stop_async( IUnknown *invoker, IUnknown *param )
 {
     return S_OK;
 }
@@ -444,7 +444,7 @@ static HRESULT WINAPI session_StopAsync( ISpeechContinuousRecognitionSession *if
 
     TRACE("iface %p, action %p.\n", iface, action);
 
-    if (FAILED(hr = async_action_create(NULL, session_stop_async, action)))
+    if (FAILED(hr = async_action_create(NULL, NULL, session_stop_async, 0, action)))
         return hr;
 
     EnterCriticalSection(&impl->cs);
@@ -487,7 +487,7 @@ static HRESULT WINAPI session_CancelAsync( ISpeechContinuousRecognitionSession *
     return E_NOTIMPL;
 }
 
-static HRESULT session_pause_async( IInspectable *invoker )
+static HRESULT WINAPI session_pause_async( IUnknown *invoker, IUnknown *param )
 {
     return S_OK;
 }
@@ -501,7 +501,7 @@ static HRESULT WINAPI session_PauseAsync( ISpeechContinuousRecognitionSession *i
 
     *action = NULL;
 
-    if (FAILED(hr = async_action_create(NULL, session_pause_async, action)))
+    if (FAILED(hr = async_action_create(NULL, NULL, session_pause_async, 0, action)))
         return hr;
 
     EnterCriticalSection(&impl->cs);
@@ -725,7 +725,7 @@ static HRESULT WINAPI recognizer_get_UIOptions( ISpeechRecognizer *iface, ISpeec
     return E_NOTIMPL;
 }
 
-static HRESULT recognizer_compile_constraints_async( IInspectable *invoker, IInspectable **result )
+static HRESULT WINAPI recognizer_compile_constraints_async( IUnknown *invoker, IUnknown *param, IInspectable **result )
 {
     return compilation_result_create(SpeechRecognitionResultStatus_Success, (ISpeechRecognitionCompilationResult **) result);
 }
@@ -735,7 +735,8 @@ static HRESULT WINAPI recognizer_CompileConstraintsAsync( ISpeechRecognizer *ifa
 {
     IAsyncOperation_IInspectable **value = (IAsyncOperation_IInspectable **)operation;
     FIXME("iface %p, operation %p semi-stub!\n", iface, operation);
-    return async_operation_inspectable_create(&IID_IAsyncOperation_SpeechRecognitionCompilationResult, NULL, recognizer_compile_constraints_async, value);
+    return async_operation_inspectable_create(&IID_IAsyncOperation_SpeechRecognitionCompilationResult, NULL, NULL,
+                                              recognizer_compile_constraints_async, 0, value);
 }
 
 static HRESULT WINAPI recognizer_RecognizeAsync( ISpeechRecognizer *iface,
@@ -375,7 +375,7 @@ static HRESULT WINAPI synthesizer_GetTrustLevel( ISpeechSynthesizer *iface, Trus
     return E_NOTIMPL;
 }
 
-static HRESULT synthesizer_synthesize_text_to_stream_async( IInspectable *invoker, IInspectable **result )
+static HRESULT WINAPI synthesizer_synthesize_text_to_stream_async( IUnknown *invoker, IUnknown *param, IInspectable **result )
 {
     return synthesis_stream_create((ISpeechSynthesisStream **)result);
 }
@@ -384,11 +384,11 @@ static HRESULT WINAPI synthesizer_SynthesizeTextToStreamAsync( ISpeechSynthesize
                                                                IAsyncOperation_SpeechSynthesisStream **operation )
 {
     TRACE("iface %p, text %p, operation %p.\n", iface, text, operation);
-    return async_operation_inspectable_create(&IID_IAsyncOperation_SpeechSynthesisStream, NULL,
-                                              synthesizer_synthesize_text_to_stream_async, (IAsyncOperation_IInspectable **)operation);
+    return async_operation_inspectable_create(&IID_IAsyncOperation_SpeechSynthesisStream, NULL, NULL,
+                                              synthesizer_synthesize_text_to_stream_async, 0, (IAsyncOperation_IInspectable **)operation);
 }
 
-static HRESULT synthesizer_synthesize_ssml_to_stream_async( IInspectable *invoker, IInspectable **result )
+static HRESULT WINAPI synthesizer_synthesize_ssml_to_stream_async( IUnknown *invoker, IUnknown *param, IInspectable **result )
 {
     return synthesis_stream_create((ISpeechSynthesisStream **)result);
 }
@@ -397,8 +397,8 @@ static HRESULT WINAPI synthesizer_SynthesizeSsmlToStreamAsync( ISpeechSynthesize
                                                                IAsyncOperation_SpeechSynthesisStream **operation )
 {
     TRACE("iface %p, ssml %p, operation %p.\n", iface, ssml, operation);
-    return async_operation_inspectable_create(&IID_IAsyncOperation_SpeechSynthesisStream, NULL,
-                                              synthesizer_synthesize_ssml_to_stream_async, (IAsyncOperation_IInspectable **)operation);
+    return async_operation_inspectable_create(&IID_IAsyncOperation_SpeechSynthesisStream, NULL, NULL,
+                                              synthesizer_synthesize_ssml_to_stream_async, 0, (IAsyncOperation_IInspectable **)operation);
 }
 
 static HRESULT WINAPI synthesizer_put_Voice( ISpeechSynthesizer *iface, IVoiceInformation *value )
@@ -118,17 +118,19 @@ static const struct IActivationFactoryVtbl factory_vtbl =
 
 DEFINE_IINSPECTABLE( user_consent_verifier_statics, IUserConsentVerifierStatics, struct user_consent_verifier_statics, IActivationFactory_iface )
 
-static HRESULT WINAPI check_availability_async( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+static HRESULT WINAPI check_availability_async( IUnknown *invoker, IUnknown *param, UINT32 *result )
 {
-    result->vt = VT_UI4;
-    result->ulVal = UserConsentVerifierAvailability_DeviceNotPresent;
+    *result = UserConsentVerifierAvailability_DeviceNotPresent;
     return S_OK;
 }
 
 static HRESULT WINAPI user_consent_verifier_statics_CheckAvailabilityAsync( IUserConsentVerifierStatics *iface, IAsyncOperation_UserConsentVerifierAvailability **result )
 {
     TRACE( "iface %p, result %p\n", iface, result );
-    return async_operation_user_consent_verifier_availability_create( (IUnknown *)iface, NULL, check_availability_async, result );
+    return async_operation_uint32_create( &IID_IAsyncOperation_UserConsentVerifierAvailability,
+                                          L"Windows.Foundation.IAsyncOperation`1<Windows.Security.Credentials.UI.UserConsentVerifierAvailability>",
+                                          (IUnknown *)iface, NULL, check_availability_async, ASYNC_RUN_INLINE,
+                                          (IAsyncOperation_UINT32 **)result );
 }
 
 static HRESULT WINAPI user_consent_verifier_statics_RequestVerificationAsync( IUserConsentVerifierStatics *iface, HSTRING message,
@@ -35,11 +35,7 @@
 #define WIDL_using_Windows_Security_Credentials_UI
 #include "windows.security.credentials.ui.h"
 
-#include "provider.h"
-
-typedef HRESULT (WINAPI *async_operation_callback)( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
-extern HRESULT async_operation_user_consent_verifier_availability_create( IUnknown *invoker, IUnknown *param, async_operation_callback callback,
-                                                                          IAsyncOperation_UserConsentVerifierAvailability **out );
+#include "wine/winrtasync.h"
 
 #define DEFINE_IINSPECTABLE_( pfx, iface_type, impl_type, impl_from, iface_mem, expr )             \
     static inline impl_type *impl_from( iface_type *iface )                                        \
@@ -20,6 +20,7 @@
 #include "private.h"
 #include "wine/debug.h"
 #include "pathcch.h"
+#include "appmodel.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(data);
 
@@ -466,18 +467,52 @@ static HRESULT WINAPI application_data_ClearAsync( IApplicationData *iface, Appl
     return E_NOTIMPL;
 }
 
+/* settings are stored in %LOCALAPPDATA%\Packages\<package family or exe name>\Settings\<locality> */
+static WCHAR *get_settings_path( const WCHAR *locality )
+{
+    WCHAR name[MAX_PATH], local_appdata[MAX_PATH], *path, *ptr;
+    UINT32 len = ARRAY_SIZE(name);
+    SIZE_T size;
+
+    if (GetCurrentPackageFamilyName( &len, name ))
+    {
+        if (!GetModuleFileNameW( NULL, local_appdata, ARRAY_SIZE(local_appdata) )) return NULL;
+        if ((ptr = wcsrchr( local_appdata, '\\' ))) ptr++;
+        else ptr = local_appdata;
+        lstrcpynW( name, ptr, ARRAY_SIZE(name) );
+        if ((ptr = wcsrchr( name, '.' ))) *ptr = 0;
+    }
+    if (!GetEnvironmentVariableW( L"LOCALAPPDATA", local_appdata, ARRAY_SIZE(local_appdata) )) return NULL;
+
+    size = wcslen( local_appdata ) + wcslen( name ) + wcslen( locality ) + 20;
+    if (!(path = malloc( size * sizeof(WCHAR) ))) return NULL;
+    swprintf( path, size, L"%s\\Packages\\%s\\Settings\\%s", local_appdata, name, locality );
+    return path;
+}
+
+static HRESULT create_settings_container( const WCHAR *locality, IApplicationDataContainer **value )
+{
+    WCHAR *path;
+
+    if (!value) return E_INVALIDARG;
+    if (!(path = get_settings_path( locality ))) WARN( "no settings path, %s settings won't be saved\n", debugstr_w( locality ) );
+    *value = create_data_container( L"", path );
+    free( path );
+
+    TRACE( "created IApplicationDataContainer %p.\n", *value );
+    return *value ? S_OK : E_OUTOFMEMORY;
+}
+
 static HRESULT WINAPI application_data_get_LocalSettings( IApplicationData *iface, IApplicationDataContainer **value )
 {
-    FIXME( "iface %p, value %p semi-stub!\n", iface, value );
-    *value = create_data_container();
-    return S_OK;
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return create_settings_container( L"Local", value );
 }
 
 static HRESULT WINAPI application_data_get_RoamingSettings( IApplicationData *iface, IApplicationDataContainer **value )
 {
-    FIXME( "iface %p, value %p semi-stub!\n", iface, value );
-    *value = create_data_container();
-    return S_OK;
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return create_settings_container( L"Roaming", value );
 }
 
 static HRESULT WINAPI application_data_get_LocalFolder( IApplicationData *iface, IStorageFolder **value )
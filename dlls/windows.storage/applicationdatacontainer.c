@@ -27,6 +27,8 @@ struct appdata_container_impl
 {
     IApplicationDataContainer IApplicationDataContainer_iface;
     LONG ref;
+    WCHAR *name;
+    WCHAR *path;  /* settings directory, NULL if not persistent */
 };
 
 static inline struct appdata_container_impl *impl_from_IApplicationDataContainer( IApplicationDataContainer *iface )
@@ -67,7 +69,15 @@ static ULONG WINAPI appdata_container_Release( IApplicationDataContainer *iface
 {
     struct appdata_container_impl *impl = impl_from_IApplicationDataContainer( iface );
     ULONG ref = InterlockedDecrement( &impl->ref );
+
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+
+    if (!ref)
+    {
+        free( impl->name );
+        free( impl->path );
+        free( impl );
+    }
     return ref;
 }
 
@@ -91,8 +101,12 @@ static HRESULT WINAPI appdata_container_GetTrustLevel( IApplicationDataContainer
 
 static HRESULT WINAPI appdata_container_get_Name( IApplicationDataContainer *iface, HSTRING *value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    return E_NOTIMPL;
+    struct appdata_container_impl *impl = impl_from_IApplicationDataContainer( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    return WindowsCreateString( impl->name, wcslen( impl->name ), value );
 }
 
 static HRESULT WINAPI appdata_container_get_Locality( IApplicationDataContainer *iface, ApplicationDataLocality *value )
@@ -103,9 +117,23 @@ static HRESULT WINAPI appdata_container_get_Locality( IApplicationDataContainer
 
 static HRESULT WINAPI appdata_container_get_Values( IApplicationDataContainer *iface, IPropertySet **value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    *value = create_propertyset();
-    return S_OK;
+    struct appdata_container_impl *impl = impl_from_IApplicationDataContainer( iface );
+    WCHAR *path = NULL;
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+
+    if (impl->path)
+    {
+        if (!(path = malloc( (wcslen( impl->path ) + 12) * sizeof(WCHAR) ))) return E_OUTOFMEMORY;
+        wcscpy( path, impl->path );
+        wcscat( path, L"\\values.dat" );
+    }
+    *value = create_propertyset( path );
+    free( path );
+
+    return *value ? S_OK : E_OUTOFMEMORY;
 }
 
 static HRESULT WINAPI appdata_container_get_Containers( IApplicationDataContainer *iface, IMapView_HSTRING_ApplicationDataContainer **value )
@@ -116,9 +144,49 @@ static HRESULT WINAPI appdata_container_get_Containers( IApplicationDataContaine
 
 static HRESULT WINAPI appdata_container_CreateContainer( IApplicationDataContainer *iface, HSTRING name, ApplicationDataCreateDisposition disposition, IApplicationDataContainer **container )
 {
-    FIXME( "iface %p, name %s, disposition %d, container %p semi-stub!\n", iface, debugstr_hstring(name), disposition, container );
-    *container = create_data_container();
-    return S_OK;
+    struct appdata_container_impl *impl = impl_from_IApplicationDataContainer( iface );
+    const WCHAR *name_str;
+    WCHAR *path = NULL;
+    HRESULT hr = S_OK;
+    DWORD attrs;
+    UINT32 len;
+
+    TRACE( "iface %p, name %s, disposition %d, container %p.\n", iface, debugstr_hstring(name), disposition, container );
+
+    if (!container) return E_POINTER;
+    *container = NULL;
+
+    name_str = WindowsGetStringRawBuffer( name, &len );
+    if (!len || len > 255 || wcspbrk( name_str, L"\\/:*?\"<>|" )) return E_INVALIDARG;
+    if (disposition != ApplicationDataCreateDisposition_Always &&
+        disposition != ApplicationDataCreateDisposition_Existing)
+        return E_INVALIDARG;
+
+    /* the children of containers that aren't persistent aren't kept */
+    if (!impl->path)
+    {
+        if (disposition == ApplicationDataCreateDisposition_Existing) return HRESULT_FROM_WIN32( ERROR_FILE_NOT_FOUND );
+        return (*container = create_data_container( name_str, NULL )) ? S_OK : E_OUTOFMEMORY;
+    }
+
+    if (!(path = malloc( (wcslen( impl->path ) + len + 2) * sizeof(WCHAR) ))) return E_OUTOFMEMORY;
+    swprintf( path, wcslen( impl->path ) + len + 2, L"%s\\%s", impl->path, name_str );
+
+    /* each container is a directory, so that it exists even before it has any value */
+    attrs = GetFileAttributesW( path );
+    if (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY)) hr = E_INVALIDARG;
+    else if (attrs == INVALID_FILE_ATTRIBUTES && disposition == ApplicationDataCreateDisposition_Existing)
+        hr = HRESULT_FROM_WIN32( ERROR_FILE_NOT_FOUND );
+    else if (attrs == INVALID_FILE_ATTRIBUTES)
+    {
+        create_parent_directories( path );
+        if (!CreateDirectoryW( path, NULL ) && GetLastError() != ERROR_ALREADY_EXISTS)
+            hr = HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    if (SUCCEEDED(hr) && !(*container = create_data_container( name_str, path ))) hr = E_OUTOFMEMORY;
+    free( path );
+    return hr;
 }
 
 static HRESULT WINAPI appdata_container_DeleteContainer( IApplicationDataContainer *iface, HSTRING name )
@@ -146,11 +214,19 @@ static const struct IApplicationDataContainerVtbl appdata_container_vtbl =
     appdata_container_DeleteContainer,
 };
 
-IApplicationDataContainer *create_data_container() {
+/* create a settings container, stored in the path directory if not NULL */
+IApplicationDataContainer *create_data_container( const WCHAR *name, const WCHAR *path )
+{
     struct appdata_container_impl *object;
 
     if (!(object = calloc(1, sizeof(*object))))
         return NULL;
+    if (!(object->name = wcsdup( name )) || (path && !(object->path = wcsdup( path ))))
+    {
+        free( object->name );
+        free( object );
+        return NULL;
+    }
 
     object->IApplicationDataContainer_iface.lpVtbl = &appdata_container_vtbl;
     object->ref = 1;
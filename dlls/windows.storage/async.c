@@ -0,0 +1,127 @@
+/* WinRT Windows.Storage asynchronous operation helpers
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "private.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(data);
+
+/* All the completed handler delegates share the same layout, only their IID
+ * differs, so a single implementation is used to wait on any operation. */
+struct async_waiter
+{
+    IAsyncOperationCompletedHandler_IInspectable IAsyncOperationCompletedHandler_IInspectable_iface;
+    const GUID *iid;
+    HANDLE event;
+    AsyncStatus status;
+    LONG ref;
+};
+
+static inline struct async_waiter *impl_from_IAsyncOperationCompletedHandler_IInspectable( IAsyncOperationCompletedHandler_IInspectable *iface )
+{
+    return CONTAINING_RECORD( iface, struct async_waiter, IAsyncOperationCompletedHandler_IInspectable_iface );
+}
+
+static HRESULT WINAPI async_waiter_QueryInterface( IAsyncOperationCompletedHandler_IInspectable *iface, REFIID iid, void **out )
+{
+    struct async_waiter *impl = impl_from_IAsyncOperationCompletedHandler_IInspectable( iface );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, impl->iid ))
+    {
+        IUnknown_AddRef( iface );
+        *out = iface;
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI async_waiter_AddRef( IAsyncOperationCompletedHandler_IInspectable *iface )
+{
+    struct async_waiter *impl = impl_from_IAsyncOperationCompletedHandler_IInspectable( iface );
+    return InterlockedIncrement( &impl->ref );
+}
+
+static ULONG WINAPI async_waiter_Release( IAsyncOperationCompletedHandler_IInspectable *iface )
+{
+    struct async_waiter *impl = impl_from_IAsyncOperationCompletedHandler_IInspectable( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+
+    if (!ref)
+    {
+        CloseHandle( impl->event );
+        free( impl );
+    }
+    return ref;
+}
+
+static HRESULT WINAPI async_waiter_Invoke( IAsyncOperationCompletedHandler_IInspectable *iface,
+                                           IAsyncOperation_IInspectable *info, AsyncStatus status )
+{
+    struct async_waiter *impl = impl_from_IAsyncOperationCompletedHandler_IInspectable( iface );
+
+    TRACE( "iface %p, info %p, status %d.\n", iface, info, status );
+
+    impl->status = status;
+    SetEvent( impl->event );
+    return S_OK;
+}
+
+static const struct IAsyncOperationCompletedHandler_IInspectableVtbl async_waiter_vtbl =
+{
+    async_waiter_QueryInterface,
+    async_waiter_AddRef,
+    async_waiter_Release,
+    /* IAsyncOperationCompletedHandler<IInspectable *> methods */
+    async_waiter_Invoke,
+};
+
+HRESULT async_waiter_create( const GUID *iid, IUnknown **out )
+{
+    struct async_waiter *impl;
+
+    if (!(impl = calloc( 1, sizeof(*impl) ))) return E_OUTOFMEMORY;
+    impl->IAsyncOperationCompletedHandler_IInspectable_iface.lpVtbl = &async_waiter_vtbl;
+    impl->iid = iid;
+    impl->ref = 1;
+
+    if (!(impl->event = CreateEventW( NULL, TRUE, FALSE, NULL )))
+    {
+        free( impl );
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    *out = (IUnknown *)&impl->IAsyncOperationCompletedHandler_IInspectable_iface;
+    return S_OK;
+}
+
+/* wait for the operation the waiter has been set as completed handler on */
+AsyncStatus async_waiter_wait( IUnknown *waiter )
+{
+    struct async_waiter *impl = impl_from_IAsyncOperationCompletedHandler_IInspectable( (IAsyncOperationCompletedHandler_IInspectable *)waiter );
+
+    WaitForSingleObject( impl->event, INFINITE );
+    return impl->status;
+}
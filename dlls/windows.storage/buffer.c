@@ -0,0 +1,434 @@
+/* WinRT Windows.Storage.Streams.Buffer Implementation
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stddef.h>
+
+#include "private.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(data);
+
+struct buffer
+{
+    IBuffer IBuffer_iface;
+    IBufferByteAccess IBufferByteAccess_iface;
+    LONG ref;
+
+    /* views alias the memory of another object and keep it alive, owned
+     * buffers store their data inline, right after the structure */
+    IUnknown *owner;
+    BYTE *data;
+    UINT32 capacity;
+    UINT32 length;
+    BYTE storage[];
+};
+
+static const struct IBufferVtbl buffer_vtbl;
+
+static inline struct buffer *impl_from_IBuffer( IBuffer *iface )
+{
+    return CONTAINING_RECORD( iface, struct buffer, IBuffer_iface );
+}
+
+static HRESULT WINAPI buffer_QueryInterface( IBuffer *iface, REFIID iid, void **out )
+{
+    struct buffer *impl = impl_from_IBuffer( iface );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IBuffer ))
+    {
+        *out = &impl->IBuffer_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    if (IsEqualGUID( iid, &IID_IBufferByteAccess ))
+    {
+        *out = &impl->IBufferByteAccess_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI buffer_AddRef( IBuffer *iface )
+{
+    struct buffer *impl = impl_from_IBuffer( iface );
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "iface %p increasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static ULONG WINAPI buffer_Release( IBuffer *iface )
+{
+    struct buffer *impl = impl_from_IBuffer( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+
+    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+
+    if (!ref)
+    {
+        if (impl->owner) IUnknown_Release( impl->owner );
+        free( impl );
+    }
+    return ref;
+}
+
+static HRESULT WINAPI buffer_GetIids( IBuffer *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI buffer_GetRuntimeClassName( IBuffer *iface, HSTRING *class_name )
+{
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI buffer_GetTrustLevel( IBuffer *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI buffer_get_Capacity( IBuffer *iface, UINT32 *value )
+{
+    struct buffer *impl = impl_from_IBuffer( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->capacity;
+    return S_OK;
+}
+
+static HRESULT WINAPI buffer_get_Length( IBuffer *iface, UINT32 *value )
+{
+    struct buffer *impl = impl_from_IBuffer( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->length;
+    return S_OK;
+}
+
+static HRESULT WINAPI buffer_put_Length( IBuffer *iface, UINT32 value )
+{
+    struct buffer *impl = impl_from_IBuffer( iface );
+
+    TRACE( "iface %p, value %u.\n", iface, value );
+
+    if (value > impl->capacity) return E_INVALIDARG;
+    impl->length = value;
+    return S_OK;
+}
+
+static const struct IBufferVtbl buffer_vtbl =
+{
+    buffer_QueryInterface,
+    buffer_AddRef,
+    buffer_Release,
+    /* IInspectable methods */
+    buffer_GetIids,
+    buffer_GetRuntimeClassName,
+    buffer_GetTrustLevel,
+    /* IBuffer methods */
+    buffer_get_Capacity,
+    buffer_get_Length,
+    buffer_put_Length,
+};
+
+static inline struct buffer *impl_from_IBufferByteAccess( IBufferByteAccess *iface )
+{
+    return CONTAINING_RECORD( iface, struct buffer, IBufferByteAccess_iface );
+}
+
+static HRESULT WINAPI buffer_byte_access_QueryInterface( IBufferByteAccess *iface, REFIID iid, void **out )
+{
+    struct buffer *impl = impl_from_IBufferByteAccess( iface );
+    return IBuffer_QueryInterface( &impl->IBuffer_iface, iid, out );
+}
+
+static ULONG WINAPI buffer_byte_access_AddRef( IBufferByteAccess *iface )
+{
+    struct buffer *impl = impl_from_IBufferByteAccess( iface );
+    return IBuffer_AddRef( &impl->IBuffer_iface );
+}
+
+static ULONG WINAPI buffer_byte_access_Release( IBufferByteAccess *iface )
+{
+    struct buffer *impl = impl_from_IBufferByteAccess( iface );
+    return IBuffer_Release( &impl->IBuffer_iface );
+}
+
+static HRESULT WINAPI buffer_byte_access_get_Buffer( IBufferByteAccess *iface, BYTE **value )
+{
+    struct buffer *impl = impl_from_IBufferByteAccess( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->data;
+    return S_OK;
+}
+
+static const struct IBufferByteAccessVtbl buffer_byte_access_vtbl =
+{
+    buffer_byte_access_QueryInterface,
+    buffer_byte_access_AddRef,
+    buffer_byte_access_Release,
+    /* IBufferByteAccess methods */
+    buffer_byte_access_get_Buffer,
+};
+
+static struct buffer *buffer_alloc( SIZE_T storage )
+{
+    struct buffer *impl;
+
+    if (!(impl = calloc( 1, offsetof( struct buffer, storage[storage] ) ))) return NULL;
+    impl->IBuffer_iface.lpVtbl = &buffer_vtbl;
+    impl->IBufferByteAccess_iface.lpVtbl = &buffer_byte_access_vtbl;
+    impl->ref = 1;
+    return impl;
+}
+
+HRESULT buffer_create( UINT32 capacity, IBuffer **out )
+{
+    struct buffer *impl;
+
+    if (!(impl = buffer_alloc( capacity ))) return E_OUTOFMEMORY;
+    impl->data = impl->storage;
+    impl->capacity = capacity;
+
+    *out = &impl->IBuffer_iface;
+    TRACE( "created buffer %p, capacity %u.\n", *out, capacity );
+    return S_OK;
+}
+
+/* create a buffer aliasing memory owned by another object, which is kept
+ * alive for as long as the view exists; no data is copied */
+HRESULT buffer_create_view( IUnknown *owner, BYTE *data, UINT32 capacity, UINT32 length, IBuffer **out )
+{
+    struct buffer *impl;
+
+    if (!(impl = buffer_alloc( 0 ))) return E_OUTOFMEMORY;
+    IUnknown_AddRef( (impl->owner = owner) );
+    impl->data = data;
+    impl->capacity = capacity;
+    impl->length = length;
+
+    *out = &impl->IBuffer_iface;
+    TRACE( "created view %p of %p, data %p, capacity %u, length %u.\n", *out, owner, data, capacity, length );
+    return S_OK;
+}
+
+HRESULT buffer_get_bytes( IBuffer *buffer, BYTE **data, UINT32 *length )
+{
+    IBufferByteAccess *byte_access;
+    HRESULT hr;
+
+    if (buffer->lpVtbl == &buffer_vtbl)
+    {
+        struct buffer *impl = impl_from_IBuffer( buffer );
+        *data = impl->data;
+        *length = impl->length;
+        return S_OK;
+    }
+
+    if (FAILED(hr = IBuffer_get_Length( buffer, length ))) return hr;
+    if (FAILED(hr = IBuffer_QueryInterface( buffer, &IID_IBufferByteAccess, (void **)&byte_access ))) return hr;
+    hr = IBufferByteAccess_get_Buffer( byte_access, data );
+    IBufferByteAccess_Release( byte_access );
+    return hr;
+}
+
+/* reverse the byte order of count consecutive elements of the given size */
+void swap_byte_order( void *data, UINT32 count, UINT32 size )
+{
+    BYTE *ptr = data, *end = ptr + (SIZE_T)count * size;
+    UINT64 value64;
+    UINT32 value32;
+    UINT16 value16;
+
+    switch (size)
+    {
+    case 2:
+        for (; ptr < end; ptr += 2)
+        {
+            memcpy( &value16, ptr, 2 );
+            value16 = (value16 >> 8) | (value16 << 8);
+            memcpy( ptr, &value16, 2 );
+        }
+        break;
+    case 4:
+        for (; ptr < end; ptr += 4)
+        {
+            memcpy( &value32, ptr, 4 );
+            value32 = ((value32 & 0xff00ff00) >> 8) | ((value32 & 0x00ff00ff) << 8);
+            value32 = (value32 >> 16) | (value32 << 16);
+            memcpy( ptr, &value32, 4 );
+        }
+        break;
+    case 8:
+        for (; ptr < end; ptr += 8)
+        {
+            memcpy( &value64, ptr, 8 );
+            value64 = ((value64 & 0xff00ff00ff00ff00ull) >> 8) | ((value64 & 0x00ff00ff00ff00ffull) << 8);
+            value64 = ((value64 & 0xffff0000ffff0000ull) >> 16) | ((value64 & 0x0000ffff0000ffffull) << 16);
+            value64 = (value64 >> 32) | (value64 << 32);
+            memcpy( ptr, &value64, 8 );
+        }
+        break;
+    }
+}
+
+struct buffer_statics
+{
+    IActivationFactory IActivationFactory_iface;
+    IBufferFactory IBufferFactory_iface;
+    LONG ref;
+};
+
+static inline struct buffer_statics *impl_from_IActivationFactory( IActivationFactory *iface )
+{
+    return CONTAINING_RECORD( iface, struct buffer_statics, IActivationFactory_iface );
+}
+
+static HRESULT WINAPI factory_QueryInterface( IActivationFactory *iface, REFIID iid, void **out )
+{
+    struct buffer_statics *impl = impl_from_IActivationFactory( iface );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IActivationFactory ))
+    {
+        *out = &impl->IActivationFactory_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    if (IsEqualGUID( iid, &IID_IBufferFactory ))
+    {
+        *out = &impl->IBufferFactory_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI factory_AddRef( IActivationFactory *iface )
+{
+    struct buffer_statics *impl = impl_from_IActivationFactory( iface );
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "iface %p increasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static ULONG WINAPI factory_Release( IActivationFactory *iface )
+{
+    struct buffer_statics *impl = impl_from_IActivationFactory( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static HRESULT WINAPI factory_GetIids( IActivationFactory *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI factory_GetRuntimeClassName( IActivationFactory *iface, HSTRING *class_name )
+{
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI factory_GetTrustLevel( IActivationFactory *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI factory_ActivateInstance( IActivationFactory *iface, IInspectable **instance )
+{
+    FIXME( "iface %p, instance %p stub!\n", iface, instance );
+    return E_NOTIMPL;
+}
+
+static const struct IActivationFactoryVtbl factory_vtbl =
+{
+    factory_QueryInterface,
+    factory_AddRef,
+    factory_Release,
+    /* IInspectable methods */
+    factory_GetIids,
+    factory_GetRuntimeClassName,
+    factory_GetTrustLevel,
+    /* IActivationFactory methods */
+    factory_ActivateInstance,
+};
+
+DEFINE_IINSPECTABLE( buffer_factory, IBufferFactory, struct buffer_statics, IActivationFactory_iface )
+
+static HRESULT WINAPI buffer_factory_Create( IBufferFactory *iface, UINT32 capacity, IBuffer **value )
+{
+    TRACE( "iface %p, capacity %u, value %p.\n", iface, capacity, value );
+
+    if (!value) return E_POINTER;
+    if (capacity > 0x7fffffff) return E_INVALIDARG;
+    return buffer_create( capacity, value );
+}
+
+static const struct IBufferFactoryVtbl buffer_factory_vtbl =
+{
+    buffer_factory_QueryInterface,
+    buffer_factory_AddRef,
+    buffer_factory_Release,
+    /* IInspectable methods */
+    buffer_factory_GetIids,
+    buffer_factory_GetRuntimeClassName,
+    buffer_factory_GetTrustLevel,
+    /* IBufferFactory methods */
+    buffer_factory_Create,
+};
+
+static struct buffer_statics buffer_statics =
+{
+    {&factory_vtbl},
+    {&buffer_factory_vtbl},
+    1,
+};
+
+IActivationFactory *buffer_factory = &buffer_statics.IActivationFactory_iface;
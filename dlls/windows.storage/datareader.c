@@ -19,19 +19,186 @@
 
 #include "private.h"
 #include "wine/debug.h"
-#include "pathcch.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(datareader);
 
+/* streams are read in chunks of at least this size, so that small loads
+ * neither allocate nor hit the stream for every call */
+#define READAHEAD_SIZE 0x10000
+
+struct chunk
+{
+    struct list entry;
+    IBuffer *buffer;
+    BYTE *data;
+    UINT32 offset;   /* first unconsumed byte */
+    UINT32 length;   /* end of the loaded data */
+    UINT32 capacity; /* end of the room left for stream loads */
+};
+
 struct datareader
 {
     IDataReader IDataReader_iface;
-    IBuffer *buffer;
-    IBufferByteAccess *buffer_access;
-    UINT32 position;
+    IClosable IClosable_iface;
     LONG ref;
+
+    IInputStream *stream;
+    struct list chunks;
+    UINT32 unconsumed;
+    UnicodeEncoding encoding;
+    ByteOrder byte_order;
+    InputStreamOptions options;
+    LONG loading;
+    UINT32 load_count;
 };
 
+static struct chunk *chunk_create( struct datareader *impl, IBuffer *buffer, UINT32 capacity )
+{
+    struct chunk *chunk;
+
+    if (!(chunk = calloc( 1, sizeof(*chunk) ))) return NULL;
+    if (FAILED(buffer_get_bytes( buffer, &chunk->data, &chunk->length )))
+    {
+        free( chunk );
+        return NULL;
+    }
+    IBuffer_AddRef( (chunk->buffer = buffer) );
+    chunk->capacity = max( capacity, chunk->length );
+
+    list_add_tail( &impl->chunks, &chunk->entry );
+    impl->unconsumed += chunk->length;
+    return chunk;
+}
+
+static void chunk_destroy( struct chunk *chunk )
+{
+    list_remove( &chunk->entry );
+    IBuffer_Release( chunk->buffer );
+    free( chunk );
+}
+
+static inline struct chunk *reader_head( struct datareader *impl )
+{
+    struct list *ptr = list_head( &impl->chunks );
+    return ptr ? LIST_ENTRY( ptr, struct chunk, entry ) : NULL;
+}
+
+static void reader_clear( struct datareader *impl )
+{
+    struct chunk *chunk, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( chunk, next, &impl->chunks, struct chunk, entry )
+        chunk_destroy( chunk );
+    impl->unconsumed = 0;
+}
+
+static void reader_consume( struct datareader *impl, struct chunk *chunk, UINT32 size )
+{
+    chunk->offset += size;
+    impl->unconsumed -= size;
+
+    /* the last chunk is kept while it still has room for more loads, views
+     * handed out by ReadBuffer hold their own reference to the memory */
+    if (chunk->offset == chunk->length &&
+        (chunk->length == chunk->capacity || list_next( &impl->chunks, &chunk->entry )))
+        chunk_destroy( chunk );
+}
+
+static HRESULT reader_read( struct datareader *impl, UINT32 size, void *value )
+{
+    struct chunk *chunk;
+    BYTE *dst = value;
+    UINT32 count;
+
+    if (size > impl->unconsumed) return E_BOUNDS;
+
+    while (size)
+    {
+        chunk = reader_head( impl );
+        count = min( size, chunk->length - chunk->offset );
+        memcpy( dst, chunk->data + chunk->offset, count );
+        reader_consume( impl, chunk, count );
+        dst += count;
+        size -= count;
+    }
+
+    return S_OK;
+}
+
+static HRESULT reader_read_value( struct datareader *impl, UINT32 size, void *value )
+{
+    HRESULT hr;
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = reader_read( impl, size, value ))) return hr;
+    if (impl->byte_order == ByteOrder_BigEndian) swap_byte_order( value, 1, size );
+    return S_OK;
+}
+
+/* issue a single stream read into the room left in the last chunk */
+static HRESULT reader_fill( struct datareader *impl, UINT32 count, UINT32 *read )
+{
+    IAsyncOperationWithProgress_IBuffer_UINT32 *operation;
+    InputStreamOptions options = impl->options;
+    IBuffer *buffer, *target, *result = NULL;
+    struct chunk *tail = NULL;
+    UINT32 room, size;
+    IUnknown *waiter;
+    struct list *ptr;
+    BYTE *data;
+    HRESULT hr;
+
+    *read = 0;
+
+    if ((ptr = list_tail( &impl->chunks ))) tail = LIST_ENTRY( ptr, struct chunk, entry );
+    if (!tail || tail->capacity - tail->length < count)
+    {
+        if (tail && tail->offset == tail->length) chunk_destroy( tail );
+
+        size = max( count, READAHEAD_SIZE );
+        if (FAILED(hr = buffer_create( size, &buffer ))) return hr;
+        tail = chunk_create( impl, buffer, size );
+        IBuffer_Release( buffer );
+        if (!tail) return E_OUTOFMEMORY;
+    }
+
+    room = tail->capacity - tail->length;
+    size = count;
+    if (options & InputStreamOptions_ReadAhead)
+    {
+        size = room;
+        options |= InputStreamOptions_Partial;
+    }
+
+    if (FAILED(hr = buffer_create_view( (IUnknown *)tail->buffer, tail->data + tail->length, room, 0, &target ))) return hr;
+    hr = IInputStream_ReadAsync( impl->stream, target, size, options, &operation );
+    IBuffer_Release( target );
+    if (FAILED(hr)) return hr;
+
+    if (SUCCEEDED(hr = async_waiter_create( &IID_IAsyncOperationWithProgressCompletedHandler_IBuffer_UINT32, &waiter )))
+    {
+        hr = IAsyncOperationWithProgress_IBuffer_UINT32_put_Completed( operation, (IAsyncOperationWithProgressCompletedHandler_IBuffer_UINT32 *)waiter );
+        if (SUCCEEDED(hr)) async_waiter_wait( waiter );
+        IUnknown_Release( waiter );
+    }
+    if (SUCCEEDED(hr)) hr = IAsyncOperationWithProgress_IBuffer_UINT32_GetResults( operation, &result );
+    IAsyncOperationWithProgress_IBuffer_UINT32_Release( operation );
+    if (FAILED(hr)) return hr;
+
+    /* streams may return a buffer of their own instead of filling ours */
+    if (SUCCEEDED(hr = buffer_get_bytes( result, &data, &size )))
+    {
+        size = min( size, room );
+        if (data != tail->data + tail->length) memcpy( tail->data + tail->length, data, size );
+        tail->length += size;
+        impl->unconsumed += size;
+        *read = size;
+    }
+    IBuffer_Release( result );
+
+    return hr;
+}
+
 static inline struct datareader *impl_from_IDataReader( IDataReader *iface )
 {
     return CONTAINING_RECORD( iface, struct datareader, IDataReader_iface );
@@ -53,6 +220,13 @@ static HRESULT WINAPI datareader_QueryInterface( IDataReader *iface, REFIID iid,
         return S_OK;
     }
 
+    if (IsEqualGUID( iid, &IID_IClosable ))
+    {
+        *out = &impl->IClosable_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
     FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
     *out = NULL;
     return E_NOINTERFACE;
@@ -70,7 +244,15 @@ static ULONG WINAPI datareader_Release( IDataReader *iface )
 {
     struct datareader *impl = impl_from_IDataReader( iface );
     ULONG ref = InterlockedDecrement( &impl->ref );
+
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+
+    if (!ref)
+    {
+        reader_clear( impl );
+        if (impl->stream) IInputStream_Release( impl->stream );
+        free( impl );
+    }
     return ref;
 }
 
@@ -94,181 +276,351 @@ static HRESULT WINAPI datareader_GetTrustLevel( IDataReader *iface, TrustLevel *
 
 static HRESULT WINAPI datareader_get_UnconsumedBufferLength( IDataReader *iface, UINT32 *value )
 {
-    HRESULT ret;
     struct datareader *impl = impl_from_IDataReader( iface );
 
     TRACE( "iface %p, value %p\n", iface, value );
-    ret = impl->buffer->lpVtbl->get_Length(impl->buffer, value);
-    if (!SUCCEEDED(ret)) {
-        return ret;
-    }
 
-    *value = *value - impl->position;
+    if (!value) return E_POINTER;
+    *value = impl->unconsumed;
     return S_OK;
 }
 
 static HRESULT WINAPI datareader_get_UnicodeEncoding( IDataReader *iface, UnicodeEncoding *value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    *value = UnicodeEncoding_Utf8;
+    struct datareader *impl = impl_from_IDataReader( iface );
+
+    TRACE( "iface %p, value %p\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->encoding;
     return S_OK;
 }
 
 static HRESULT WINAPI datareader_put_UnicodeEncoding( IDataReader *iface, UnicodeEncoding value )
 {
-    FIXME( "iface %p, value %d stub!\n", iface, value );
+    struct datareader *impl = impl_from_IDataReader( iface );
+
+    TRACE( "iface %p, value %d\n", iface, value );
+
+    if (value > UnicodeEncoding_Utf16BE) return E_INVALIDARG;
+    impl->encoding = value;
     return S_OK;
 }
 
 static HRESULT WINAPI datareader_get_ByteOrder( IDataReader *iface, ByteOrder *value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    *value = ByteOrder_LittleEndian;
+    struct datareader *impl = impl_from_IDataReader( iface );
+
+    TRACE( "iface %p, value %p\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->byte_order;
     return S_OK;
 }
 
 static HRESULT WINAPI datareader_put_ByteOrder( IDataReader *iface, ByteOrder value )
 {
-    FIXME( "iface %p, value %d stub!\n", iface, value );
+    struct datareader *impl = impl_from_IDataReader( iface );
+
+    TRACE( "iface %p, value %d\n", iface, value );
+
+    if (value > ByteOrder_BigEndian) return E_INVALIDARG;
+    impl->byte_order = value;
     return S_OK;
 }
 
 static HRESULT WINAPI datareader_get_InputStreamOptions( IDataReader *iface, InputStreamOptions *value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    *value = InputStreamOptions_None;
+    struct datareader *impl = impl_from_IDataReader( iface );
+
+    TRACE( "iface %p, value %p\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->options;
     return S_OK;
 }
 
 static HRESULT WINAPI datareader_put_InputStreamOptions( IDataReader *iface, InputStreamOptions value )
 {
-    FIXME( "iface %p, value %d stub!\n", iface, value );
+    struct datareader *impl = impl_from_IDataReader( iface );
+
+    TRACE( "iface %p, value %#x\n", iface, value );
+
+    impl->options = value;
     return S_OK;
 }
 
 static HRESULT WINAPI datareader_ReadBytes( IDataReader *iface, UINT32 __valueSize, BYTE *value )
 {
-    HRESULT ret;
-    UINT32 remaining;
-    byte *buf_ptr;
     struct datareader *impl = impl_from_IDataReader( iface );
 
-    TRACE( "iface %p, __valueSize %d, value %p\n", iface, __valueSize, value );
-
-    ret = datareader_get_UnconsumedBufferLength(iface, &remaining);
-    if (!SUCCEEDED(ret)) {
-        return ret;
-    }
+    TRACE( "iface %p, __valueSize %u, value %p\n", iface, __valueSize, value );
 
-    if (__valueSize > remaining) {
-        ERR("value size %u, we only have %u", __valueSize, remaining);
-        return E_INVALIDARG;
-    } 
-
-    ret = impl->buffer_access->lpVtbl->get_Buffer(impl->buffer_access, &buf_ptr);
-    if (!SUCCEEDED(ret)) {
-        return ret;
-    }
-
-    impl->position = + __valueSize;
-    memcpy(value, buf_ptr, __valueSize);
-
-    return S_OK;
+    if (!value && __valueSize) return E_POINTER;
+    return reader_read( impl, __valueSize, value );
 }
 
 static HRESULT WINAPI datareader_ReadByte( IDataReader *iface, BYTE *value )
 {
-    return datareader_ReadBytes(iface, sizeof(BYTE), value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+
+    TRACE( "iface %p, value %p\n", iface, value );
+
+    return reader_read_value( impl, sizeof(BYTE), value );
 }
 
-static HRESULT WINAPI datareader_ReadBuffer( IDataReader *iface, UINT32 length, IBuffer** buffer )
+static HRESULT WINAPI datareader_ReadBuffer( IDataReader *iface, UINT32 length, IBuffer **buffer )
 {
-    FIXME( "iface %p, length %d, buffer %p stub!\n", iface, length, buffer );
-    return E_NOTIMPL;
+    struct datareader *impl = impl_from_IDataReader( iface );
+    struct chunk *chunk;
+    UINT32 size;
+    BYTE *data;
+    HRESULT hr;
+
+    TRACE( "iface %p, length %u, buffer %p\n", iface, length, buffer );
+
+    if (!buffer) return E_POINTER;
+    if (length > impl->unconsumed) return E_BOUNDS;
+
+    /* alias the loaded data whenever it is contiguous */
+    if (length && (chunk = reader_head( impl ))->length - chunk->offset >= length)
+    {
+        if (FAILED(hr = buffer_create_view( (IUnknown *)chunk->buffer, chunk->data + chunk->offset,
+                                            length, length, buffer )))
+            return hr;
+        reader_consume( impl, chunk, length );
+        return S_OK;
+    }
+
+    if (FAILED(hr = buffer_create( length, buffer ))) return hr;
+    buffer_get_bytes( *buffer, &data, &size );
+    reader_read( impl, length, data );
+    return IBuffer_put_Length( *buffer, length );
 }
 
 static HRESULT WINAPI datareader_ReadBoolean( IDataReader *iface, boolean *value )
 {
-    return datareader_ReadBytes(iface, sizeof(boolean), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    BYTE byte;
+    HRESULT hr;
+
+    TRACE( "iface %p, value %p\n", iface, value );
+
+    if (!value) return E_POINTER;
+    if (SUCCEEDED(hr = reader_read( impl, sizeof(byte), &byte ))) *value = !!byte;
+    return hr;
 }
 
 static HRESULT WINAPI datareader_ReadGuid( IDataReader *iface, GUID *value )
 {
-    return datareader_ReadBytes(iface, sizeof(GUID), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    HRESULT hr;
+
+    TRACE( "iface %p, value %p\n", iface, value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = reader_read( impl, sizeof(*value), value ))) return hr;
+    if (impl->byte_order == ByteOrder_BigEndian)
+    {
+        swap_byte_order( &value->Data1, 1, sizeof(value->Data1) );
+        swap_byte_order( &value->Data2, 2, sizeof(value->Data2) );
+    }
+    return S_OK;
 }
 
 static HRESULT WINAPI datareader_ReadInt16( IDataReader *iface, INT16 *value )
 {
-    return datareader_ReadBytes(iface, sizeof(INT16), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
 static HRESULT WINAPI datareader_ReadInt32( IDataReader *iface, INT32 *value )
 {
-    return datareader_ReadBytes(iface, sizeof(INT32), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
 static HRESULT WINAPI datareader_ReadInt64( IDataReader *iface, INT64 *value )
 {
-    return datareader_ReadBytes(iface, sizeof(INT64), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
 static HRESULT WINAPI datareader_ReadUInt16( IDataReader *iface, UINT16 *value )
 {
-    return datareader_ReadBytes(iface, sizeof(UINT16), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
 static HRESULT WINAPI datareader_ReadUInt32( IDataReader *iface, UINT32 *value )
 {
-    return datareader_ReadBytes(iface, sizeof(UINT32), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
 static HRESULT WINAPI datareader_ReadUInt64( IDataReader *iface, UINT64 *value )
 {
-    return datareader_ReadBytes(iface, sizeof(UINT64), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
 static HRESULT WINAPI datareader_ReadSingle( IDataReader *iface, FLOAT *value )
 {
-    return datareader_ReadBytes(iface, sizeof(FLOAT), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
 static HRESULT WINAPI datareader_ReadDouble( IDataReader *iface, DOUBLE *value )
 {
-    return datareader_ReadBytes(iface, sizeof(DOUBLE), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
-static HRESULT WINAPI datareader_ReadString( IDataReader *iface, UINT32 codeUnitCount, HSTRING* value)
+static HRESULT WINAPI datareader_ReadString( IDataReader *iface, UINT32 codeUnitCount, HSTRING *value )
 {
-    FIXME( "iface %p, codeUnitCount %u, value %p stub!\n", iface, codeUnitCount, value );
-    return E_NOTIMPL;
+    struct datareader *impl = impl_from_IDataReader( iface );
+    HSTRING_BUFFER handle;
+    struct chunk *chunk;
+    BYTE *data, *tmp = NULL;
+    WCHAR *str;
+    HRESULT hr;
+    int len;
+
+    TRACE( "iface %p, codeUnitCount %u, value %p\n", iface, codeUnitCount, value );
+
+    if (!value) return E_POINTER;
+    *value = NULL;
+
+    if (impl->encoding != UnicodeEncoding_Utf8)
+    {
+        if (codeUnitCount > impl->unconsumed / sizeof(WCHAR)) return E_BOUNDS;
+        if (!codeUnitCount) return S_OK;
+
+        if (FAILED(hr = WindowsPreallocateStringBuffer( codeUnitCount, &str, &handle ))) return hr;
+        reader_read( impl, codeUnitCount * sizeof(WCHAR), str );
+        if (impl->encoding == UnicodeEncoding_Utf16BE) swap_byte_order( str, codeUnitCount, sizeof(WCHAR) );
+        return WindowsPromoteStringBuffer( handle, value );
+    }
+
+    if (codeUnitCount > impl->unconsumed) return E_BOUNDS;
+    if (!codeUnitCount) return S_OK;
+
+    /* convert straight from the loaded data unless it spans several chunks */
+    chunk = reader_head( impl );
+    if (chunk->length - chunk->offset >= codeUnitCount) data = chunk->data + chunk->offset;
+    else
+    {
+        if (!(data = tmp = malloc( codeUnitCount ))) return E_OUTOFMEMORY;
+        reader_read( impl, codeUnitCount, tmp );
+    }
+
+    if (!(len = MultiByteToWideChar( CP_UTF8, 0, (char *)data, codeUnitCount, NULL, 0 ))) hr = S_OK;
+    else if (SUCCEEDED(hr = WindowsPreallocateStringBuffer( len, &str, &handle )))
+    {
+        MultiByteToWideChar( CP_UTF8, 0, (char *)data, codeUnitCount, str, len );
+        hr = WindowsPromoteStringBuffer( handle, value );
+    }
+
+    if (tmp) free( tmp );
+    else if (SUCCEEDED(hr)) reader_consume( impl, chunk, codeUnitCount );
+    return hr;
 }
 
 static HRESULT WINAPI datareader_ReadDateTime( IDataReader *iface, DateTime *value )
 {
-    return datareader_ReadBytes(iface, sizeof(DateTime), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
 static HRESULT WINAPI datareader_ReadTimeSpan( IDataReader *iface, TimeSpan *value )
 {
-    return datareader_ReadBytes(iface, sizeof(TimeSpan), (BYTE*)value);
+    struct datareader *impl = impl_from_IDataReader( iface );
+    TRACE( "iface %p, value %p\n", iface, value );
+    return reader_read_value( impl, sizeof(*value), value );
 }
 
-static HRESULT WINAPI datareader_LoadAsync( IDataReader *iface, UINT32 count, IAsyncOperation_UINT32** operation )
+static HRESULT WINAPI datareader_load_async( IUnknown *invoker, IUnknown *param, UINT32 *result )
 {
-    FIXME( "iface %p, count %u, operation %p stub!\n", iface, count, operation );
-    return E_NOTIMPL;
+    struct datareader *impl = impl_from_IDataReader( (IDataReader *)invoker );
+    UINT32 count = impl->load_count, total = 0, read;
+    HRESULT hr = S_OK;
+
+    while (total < count)
+    {
+        if (FAILED(hr = reader_fill( impl, count - total, &read )) || !read) break;
+        total += read;
+        if (impl->options & InputStreamOptions_Partial) break;
+    }
+
+    InterlockedExchange( &impl->loading, FALSE );
+    *result = total;
+    return hr;
 }
 
-static HRESULT WINAPI datareader_DetachBuffer( IDataReader *iface, IBuffer** buffer )
+static HRESULT WINAPI datareader_LoadAsync( IDataReader *iface, UINT32 count, IAsyncOperation_UINT32 **operation )
 {
-    FIXME( "iface %p, buffer %p stub!\n", iface, buffer );
-    return E_NOTIMPL;
+    struct datareader *impl = impl_from_IDataReader( iface );
+    HRESULT hr;
+
+    TRACE( "iface %p, count %u, operation %p\n", iface, count, operation );
+
+    if (!operation) return E_POINTER;
+    if (!impl->stream) return E_ILLEGAL_METHOD_CALL;
+    if (InterlockedCompareExchange( &impl->loading, TRUE, FALSE )) return E_ILLEGAL_METHOD_CALL;
+
+    impl->load_count = count;
+    hr = async_operation_uint32_create( &IID_IAsyncOperation_UINT32, L"Windows.Storage.Streams.DataReaderLoadOperation",
+                                        (IUnknown *)iface, NULL, datareader_load_async, 0, operation );
+    if (FAILED(hr)) InterlockedExchange( &impl->loading, FALSE );
+    return hr;
 }
 
-static HRESULT WINAPI datareader_DetachStream( IDataReader *iface, __x_ABI_CWindows_CStorage_CStreams_CIInputStream** stream )
+static HRESULT WINAPI datareader_DetachBuffer( IDataReader *iface, IBuffer **buffer )
 {
-    FIXME( "iface %p, stream %p stub!\n", iface, stream );
-    return E_NOTIMPL;
+    struct datareader *impl = impl_from_IDataReader( iface );
+    struct chunk *chunk = reader_head( impl );
+    UINT32 size;
+    BYTE *data;
+    HRESULT hr;
+
+    TRACE( "iface %p, buffer %p\n", iface, buffer );
+
+    if (!buffer) return E_POINTER;
+
+    if (chunk && chunk->length - chunk->offset == impl->unconsumed)
+        hr = buffer_create_view( (IUnknown *)chunk->buffer, chunk->data + chunk->offset,
+                                 impl->unconsumed, impl->unconsumed, buffer );
+    else if (SUCCEEDED(hr = buffer_create( impl->unconsumed, buffer )))
+    {
+        buffer_get_bytes( *buffer, &data, &size );
+        size = impl->unconsumed;
+        reader_read( impl, size, data );
+        IBuffer_put_Length( *buffer, size );
+    }
+
+    if (SUCCEEDED(hr)) reader_clear( impl );
+    return hr;
+}
+
+static HRESULT WINAPI datareader_DetachStream( IDataReader *iface, IInputStream **stream )
+{
+    struct datareader *impl = impl_from_IDataReader( iface );
+
+    TRACE( "iface %p, stream %p\n", iface, stream );
+
+    if (!stream) return E_POINTER;
+    *stream = impl->stream;
+    impl->stream = NULL;
+    return S_OK;
 }
 
 static const struct IDataReaderVtbl datareader_vtbl =
@@ -309,30 +661,61 @@ static const struct IDataReaderVtbl datareader_vtbl =
     datareader_DetachStream
 };
 
-IDataReader *create_data_reader(IBuffer *buffer) {
-    HRESULT ret;
+DEFINE_IINSPECTABLE( datareader_closable, IClosable, struct datareader, IDataReader_iface )
+
+static HRESULT WINAPI datareader_closable_Close( IClosable *iface )
+{
+    struct datareader *impl = impl_from_IClosable( iface );
+
+    TRACE( "iface %p.\n", iface );
+
+    reader_clear( impl );
+    if (impl->stream) IInputStream_Release( impl->stream );
+    impl->stream = NULL;
+    return S_OK;
+}
+
+static const struct IClosableVtbl datareader_closable_vtbl =
+{
+    datareader_closable_QueryInterface,
+    datareader_closable_AddRef,
+    datareader_closable_Release,
+    /* IInspectable methods */
+    datareader_closable_GetIids,
+    datareader_closable_GetRuntimeClassName,
+    datareader_closable_GetTrustLevel,
+    /* IClosable methods */
+    datareader_closable_Close,
+};
+
+static HRESULT datareader_create( IInputStream *stream, IBuffer *buffer, IDataReader **out )
+{
     struct datareader *object;
 
-    if (!(object = calloc(1, sizeof(*object))))
-        return NULL;
+    if (!(object = calloc( 1, sizeof(*object) ))) return E_OUTOFMEMORY;
 
     object->IDataReader_iface.lpVtbl = &datareader_vtbl;
-    object->buffer = buffer;
+    object->IClosable_iface.lpVtbl = &datareader_closable_vtbl;
+    object->ref = 1;
+    list_init( &object->chunks );
 
-    ret = IBuffer_QueryInterface(buffer, &IID_IBufferByteAccess, (void**)&object->buffer_access);
-    if (!SUCCEEDED(ret)) {
-        free(object);
-        return NULL;
+    /* readers created from a buffer read straight from its memory */
+    if (buffer && !chunk_create( object, buffer, 0 ))
+    {
+        free( object );
+        return E_INVALIDARG;
     }
+    if ((object->stream = stream)) IInputStream_AddRef( stream );
 
-    object->ref = 1;
-
-    return &object->IDataReader_iface;
+    *out = &object->IDataReader_iface;
+    TRACE( "created IDataReader %p.\n", *out );
+    return S_OK;
 }
 
 struct datareader_statics
 {
     IActivationFactory IActivationFactory_iface;
+    IDataReaderFactory IDataReaderFactory_iface;
     IDataReaderStatics IDataReaderStatics_iface;
     LONG ref;
 };
@@ -358,6 +741,13 @@ static HRESULT WINAPI factory_QueryInterface( IActivationFactory *iface, REFIID
         return S_OK;
     }
 
+    if (IsEqualGUID( iid, &IID_IDataReaderFactory ))
+    {
+        *out = &impl->IDataReaderFactory_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
     if (IsEqualGUID( iid, &IID_IDataReaderStatics ))
     {
         *out = &impl->IDataReaderStatics_iface;
@@ -423,6 +813,29 @@ static const struct IActivationFactoryVtbl factory_vtbl =
     factory_ActivateInstance,
 };
 
+DEFINE_IINSPECTABLE( datareader_factory, IDataReaderFactory, struct datareader_statics, IActivationFactory_iface )
+
+static HRESULT WINAPI datareader_factory_CreateDataReader( IDataReaderFactory *iface, IInputStream *stream, IDataReader **reader )
+{
+    TRACE( "iface %p, stream %p, reader %p\n", iface, stream, reader );
+
+    if (!stream || !reader) return E_POINTER;
+    return datareader_create( stream, NULL, reader );
+}
+
+static const struct IDataReaderFactoryVtbl datareader_factory_vtbl =
+{
+    datareader_factory_QueryInterface,
+    datareader_factory_AddRef,
+    datareader_factory_Release,
+    /* IInspectable methods */
+    datareader_factory_GetIids,
+    datareader_factory_GetRuntimeClassName,
+    datareader_factory_GetTrustLevel,
+    /* IDataReaderFactory methods */
+    datareader_factory_CreateDataReader,
+};
+
 static inline struct datareader_statics *impl_from_IDataReaderStatics( IDataReaderStatics *iface )
 {
     return CONTAINING_RECORD( iface, struct datareader_statics, IDataReaderStatics_iface );
@@ -486,8 +899,9 @@ static HRESULT WINAPI datareaderstatics_GetTrustLevel( IDataReaderStatics *iface
 static HRESULT WINAPI datareaderstatics_FromBuffer( IDataReaderStatics *iface, IBuffer *buffer, IDataReader **dataReader)
 {
     TRACE( "iface %p, buffer %p, dataReader %p\n", iface, buffer, dataReader );
-    *dataReader = create_data_reader(buffer);
-    return S_OK;
+
+    if (!buffer || !dataReader) return E_POINTER;
+    return datareader_create( NULL, buffer, dataReader );
 }
 
 static const struct IDataReaderStaticsVtbl datareaderstatics_vtbl =
@@ -506,6 +920,7 @@ static const struct IDataReaderStaticsVtbl datareaderstatics_vtbl =
 static struct datareader_statics datareader_statics =
 {
     .IActivationFactory_iface.lpVtbl = &factory_vtbl,
+    .IDataReaderFactory_iface.lpVtbl = &datareader_factory_vtbl,
     .IDataReaderStatics_iface.lpVtbl = &datareaderstatics_vtbl,
     .ref = 1,
 };
@@ -0,0 +1,797 @@
+/* WinRT Windows.Storage.Streams.DataWriter Implementation
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <limits.h>
+
+#include "private.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(data);
+
+/* unstored data is kept in a list of chunks of at least this size, so that
+ * appending never moves what has already been written */
+#define CHUNK_SIZE 0x10000
+
+struct chunk
+{
+    struct list entry;
+    IBuffer *buffer;
+    BYTE *data;
+    UINT32 length;
+    UINT32 capacity;
+};
+
+struct datawriter
+{
+    IDataWriter IDataWriter_iface;
+    IClosable IClosable_iface;
+    LONG ref;
+
+    IOutputStream *stream;
+    struct list chunks;
+    struct list storing;
+    UINT32 unstored;
+    UnicodeEncoding encoding;
+    ByteOrder byte_order;
+    LONG store_pending;
+};
+
+static void chunk_destroy( struct chunk *chunk )
+{
+    list_remove( &chunk->entry );
+    IBuffer_Release( chunk->buffer );
+    free( chunk );
+}
+
+static void chunk_list_clear( struct list *chunks )
+{
+    struct chunk *chunk, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( chunk, next, chunks, struct chunk, entry )
+        chunk_destroy( chunk );
+}
+
+static struct chunk *writer_add_chunk( struct datawriter *impl, UINT32 capacity )
+{
+    struct chunk *chunk;
+
+    if (!(chunk = calloc( 1, sizeof(*chunk) ))) return NULL;
+    if (FAILED(buffer_create( capacity, &chunk->buffer )))
+    {
+        free( chunk );
+        return NULL;
+    }
+    buffer_get_bytes( chunk->buffer, &chunk->data, &chunk->length );
+    chunk->capacity = capacity;
+
+    list_add_tail( &impl->chunks, &chunk->entry );
+    return chunk;
+}
+
+/* return room for size contiguous bytes at the end of the unstored data */
+static BYTE *writer_reserve( struct datawriter *impl, UINT32 size )
+{
+    struct chunk *chunk = NULL;
+    struct list *ptr;
+    BYTE *data;
+
+    if (size > UINT_MAX - impl->unstored) return NULL;
+
+    if ((ptr = list_tail( &impl->chunks ))) chunk = LIST_ENTRY( ptr, struct chunk, entry );
+    if (!chunk || chunk->capacity - chunk->length < size)
+    {
+        if (!(chunk = writer_add_chunk( impl, max( size, CHUNK_SIZE ) ))) return NULL;
+    }
+
+    data = chunk->data + chunk->length;
+    chunk->length += size;
+    impl->unstored += size;
+    return data;
+}
+
+static HRESULT writer_write( struct datawriter *impl, const void *value, UINT32 size )
+{
+    const BYTE *src = value;
+    struct chunk *chunk;
+    struct list *ptr;
+    UINT32 count;
+    BYTE *dst;
+
+    if (size > UINT_MAX - impl->unstored) return E_OUTOFMEMORY;
+
+    /* fill up the last chunk before appending a new one */
+    if ((ptr = list_tail( &impl->chunks )))
+    {
+        chunk = LIST_ENTRY( ptr, struct chunk, entry );
+        count = min( size, chunk->capacity - chunk->length );
+        memcpy( chunk->data + chunk->length, src, count );
+        chunk->length += count;
+        impl->unstored += count;
+        src += count;
+        size -= count;
+    }
+
+    if (!size) return S_OK;
+    if (!(dst = writer_reserve( impl, size ))) return E_OUTOFMEMORY;
+    memcpy( dst, src, size );
+    return S_OK;
+}
+
+static HRESULT writer_write_value( struct datawriter *impl, void *value, UINT32 size )
+{
+    if (impl->byte_order == ByteOrder_BigEndian) swap_byte_order( value, 1, size );
+    return writer_write( impl, value, size );
+}
+
+static UINT32 writer_measure( struct datawriter *impl, const WCHAR *str, UINT32 len )
+{
+    if (impl->encoding != UnicodeEncoding_Utf8) return len;
+    return WideCharToMultiByte( CP_UTF8, 0, str, len, NULL, 0, NULL, NULL );
+}
+
+static inline struct datawriter *impl_from_IDataWriter( IDataWriter *iface )
+{
+    return CONTAINING_RECORD( iface, struct datawriter, IDataWriter_iface );
+}
+
+static HRESULT WINAPI datawriter_QueryInterface( IDataWriter *iface, REFIID iid, void **out )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IDataWriter ))
+    {
+        *out = &impl->IDataWriter_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    if (IsEqualGUID( iid, &IID_IClosable ))
+    {
+        *out = &impl->IClosable_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI datawriter_AddRef( IDataWriter *iface )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "iface %p increasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static ULONG WINAPI datawriter_Release( IDataWriter *iface )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+
+    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+
+    if (!ref)
+    {
+        chunk_list_clear( &impl->chunks );
+        chunk_list_clear( &impl->storing );
+        if (impl->stream) IOutputStream_Release( impl->stream );
+        free( impl );
+    }
+    return ref;
+}
+
+static HRESULT WINAPI datawriter_GetIids( IDataWriter *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI datawriter_GetRuntimeClassName( IDataWriter *iface, HSTRING *class_name )
+{
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI datawriter_GetTrustLevel( IDataWriter *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI datawriter_get_UnstoredBufferLength( IDataWriter *iface, UINT32 *value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, value %p\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->unstored;
+    return S_OK;
+}
+
+static HRESULT WINAPI datawriter_get_UnicodeEncoding( IDataWriter *iface, UnicodeEncoding *value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, value %p\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->encoding;
+    return S_OK;
+}
+
+static HRESULT WINAPI datawriter_put_UnicodeEncoding( IDataWriter *iface, UnicodeEncoding value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, value %d\n", iface, value );
+
+    if (value > UnicodeEncoding_Utf16BE) return E_INVALIDARG;
+    impl->encoding = value;
+    return S_OK;
+}
+
+static HRESULT WINAPI datawriter_get_ByteOrder( IDataWriter *iface, ByteOrder *value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, value %p\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->byte_order;
+    return S_OK;
+}
+
+static HRESULT WINAPI datawriter_put_ByteOrder( IDataWriter *iface, ByteOrder value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, value %d\n", iface, value );
+
+    if (value > ByteOrder_BigEndian) return E_INVALIDARG;
+    impl->byte_order = value;
+    return S_OK;
+}
+
+static HRESULT WINAPI datawriter_WriteByte( IDataWriter *iface, BYTE value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %#x\n", iface, value );
+    return writer_write( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteBytes( IDataWriter *iface, UINT32 __valueSize, BYTE *value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, __valueSize %u, value %p\n", iface, __valueSize, value );
+
+    if (!value && __valueSize) return E_POINTER;
+    return writer_write( impl, value, __valueSize );
+}
+
+static HRESULT WINAPI datawriter_WriteBufferRange( IDataWriter *iface, IBuffer *buffer, UINT32 start, UINT32 count )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    UINT32 length;
+    BYTE *data;
+    HRESULT hr;
+
+    TRACE( "iface %p, buffer %p, start %u, count %u\n", iface, buffer, start, count );
+
+    if (!buffer) return E_POINTER;
+    if (FAILED(hr = buffer_get_bytes( buffer, &data, &length ))) return hr;
+    if (start > length || count > length - start) return E_BOUNDS;
+    return writer_write( impl, data + start, count );
+}
+
+static HRESULT WINAPI datawriter_WriteBuffer( IDataWriter *iface, IBuffer *buffer )
+{
+    UINT32 length;
+    HRESULT hr;
+
+    TRACE( "iface %p, buffer %p\n", iface, buffer );
+
+    if (!buffer) return E_POINTER;
+    if (FAILED(hr = IBuffer_get_Length( buffer, &length ))) return hr;
+    return datawriter_WriteBufferRange( iface, buffer, 0, length );
+}
+
+static HRESULT WINAPI datawriter_WriteBoolean( IDataWriter *iface, boolean value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    BYTE byte = !!value;
+
+    TRACE( "iface %p, value %d\n", iface, value );
+
+    return writer_write( impl, &byte, sizeof(byte) );
+}
+
+static HRESULT WINAPI datawriter_WriteGuid( IDataWriter *iface, GUID value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, value %s\n", iface, debugstr_guid( &value ) );
+
+    if (impl->byte_order == ByteOrder_BigEndian)
+    {
+        swap_byte_order( &value.Data1, 1, sizeof(value.Data1) );
+        swap_byte_order( &value.Data2, 2, sizeof(value.Data2) );
+    }
+    return writer_write( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteInt16( IDataWriter *iface, INT16 value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %d\n", iface, value );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteInt32( IDataWriter *iface, INT32 value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %d\n", iface, value );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteInt64( IDataWriter *iface, INT64 value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %I64d\n", iface, value );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteUInt16( IDataWriter *iface, UINT16 value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %u\n", iface, value );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteUInt32( IDataWriter *iface, UINT32 value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %u\n", iface, value );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteUInt64( IDataWriter *iface, UINT64 value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %I64u\n", iface, value );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteSingle( IDataWriter *iface, FLOAT value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %f\n", iface, value );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteDouble( IDataWriter *iface, DOUBLE value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %f\n", iface, value );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteDateTime( IDataWriter *iface, DateTime value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %I64d\n", iface, value.UniversalTime );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteTimeSpan( IDataWriter *iface, TimeSpan value )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    TRACE( "iface %p, value %I64d\n", iface, value.Duration );
+    return writer_write_value( impl, &value, sizeof(value) );
+}
+
+static HRESULT WINAPI datawriter_WriteString( IDataWriter *iface, HSTRING value, UINT32 *code_unit_count )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    const WCHAR *str;
+    UINT32 len, count;
+    BYTE *data;
+
+    TRACE( "iface %p, value %s, code_unit_count %p\n", iface, debugstr_hstring( value ), code_unit_count );
+
+    if (!code_unit_count) return E_POINTER;
+    str = WindowsGetStringRawBuffer( value, &len );
+    *code_unit_count = count = writer_measure( impl, str, len );
+    if (!count) return S_OK;
+
+    /* encode straight into the chunk memory */
+    if (impl->encoding == UnicodeEncoding_Utf8)
+    {
+        if (!(data = writer_reserve( impl, count ))) return E_OUTOFMEMORY;
+        WideCharToMultiByte( CP_UTF8, 0, str, len, (char *)data, count, NULL, NULL );
+        return S_OK;
+    }
+
+    if (count > UINT_MAX / sizeof(WCHAR) || !(data = writer_reserve( impl, count * sizeof(WCHAR) ))) return E_OUTOFMEMORY;
+    memcpy( data, str, count * sizeof(WCHAR) );
+    if (impl->encoding == UnicodeEncoding_Utf16BE) swap_byte_order( data, count, sizeof(WCHAR) );
+    return S_OK;
+}
+
+static HRESULT WINAPI datawriter_MeasureString( IDataWriter *iface, HSTRING value, UINT32 *code_unit_count )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    const WCHAR *str;
+    UINT32 len;
+
+    TRACE( "iface %p, value %s, code_unit_count %p\n", iface, debugstr_hstring( value ), code_unit_count );
+
+    if (!code_unit_count) return E_POINTER;
+    str = WindowsGetStringRawBuffer( value, &len );
+    *code_unit_count = writer_measure( impl, str, len );
+    return S_OK;
+}
+
+static HRESULT writer_store_chunk( struct datawriter *impl, struct chunk *chunk, UINT32 *written )
+{
+    IAsyncOperationWithProgress_UINT32_UINT32 *operation;
+    IUnknown *waiter;
+    HRESULT hr;
+
+    *written = 0;
+
+    IBuffer_put_Length( chunk->buffer, chunk->length );
+    if (FAILED(hr = IOutputStream_WriteAsync( impl->stream, chunk->buffer, &operation ))) return hr;
+
+    if (SUCCEEDED(hr = async_waiter_create( &IID_IAsyncOperationWithProgressCompletedHandler_UINT32_UINT32, &waiter )))
+    {
+        hr = IAsyncOperationWithProgress_UINT32_UINT32_put_Completed( operation, (IAsyncOperationWithProgressCompletedHandler_UINT32_UINT32 *)waiter );
+        if (SUCCEEDED(hr)) async_waiter_wait( waiter );
+        IUnknown_Release( waiter );
+    }
+    if (SUCCEEDED(hr)) hr = IAsyncOperationWithProgress_UINT32_UINT32_GetResults( operation, written );
+    IAsyncOperationWithProgress_UINT32_UINT32_Release( operation );
+
+    return hr;
+}
+
+static HRESULT WINAPI datawriter_store_async( IUnknown *invoker, IUnknown *param, UINT32 *result )
+{
+    struct datawriter *impl = impl_from_IDataWriter( (IDataWriter *)invoker );
+    struct chunk *chunk, *next;
+    UINT32 written, total = 0;
+    HRESULT hr = S_OK;
+
+    LIST_FOR_EACH_ENTRY_SAFE( chunk, next, &impl->storing, struct chunk, entry )
+    {
+        if (FAILED(hr = writer_store_chunk( impl, chunk, &written ))) break;
+        total += written;
+        chunk_destroy( chunk );
+    }
+    chunk_list_clear( &impl->storing );
+
+    InterlockedExchange( &impl->store_pending, FALSE );
+    *result = total;
+    return hr;
+}
+
+static HRESULT WINAPI datawriter_StoreAsync( IDataWriter *iface, IAsyncOperation_UINT32 **operation )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    HRESULT hr;
+
+    TRACE( "iface %p, operation %p\n", iface, operation );
+
+    if (!operation) return E_POINTER;
+    if (!impl->stream) return E_ILLEGAL_METHOD_CALL;
+    if (InterlockedCompareExchange( &impl->store_pending, TRUE, FALSE )) return E_ILLEGAL_METHOD_CALL;
+
+    /* the chunks are handed over as they are, writing may go on meanwhile */
+    list_move_tail( &impl->storing, &impl->chunks );
+    impl->unstored = 0;
+
+    hr = async_operation_uint32_create( &IID_IAsyncOperation_UINT32, L"Windows.Storage.Streams.DataWriterStoreOperation",
+                                        (IUnknown *)iface, NULL, datawriter_store_async, 0, operation );
+    if (FAILED(hr))
+    {
+        chunk_list_clear( &impl->storing );
+        InterlockedExchange( &impl->store_pending, FALSE );
+    }
+    return hr;
+}
+
+static HRESULT WINAPI datawriter_FlushAsync( IDataWriter *iface, IAsyncOperation_boolean **operation )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, operation %p\n", iface, operation );
+
+    if (!operation) return E_POINTER;
+    if (!impl->stream) return E_ILLEGAL_METHOD_CALL;
+    return IOutputStream_FlushAsync( impl->stream, operation );
+}
+
+static HRESULT WINAPI datawriter_DetachBuffer( IDataWriter *iface, IBuffer **buffer )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+    struct chunk *chunk;
+    struct list *ptr;
+    UINT32 size;
+    BYTE *data;
+    HRESULT hr;
+
+    TRACE( "iface %p, buffer %p\n", iface, buffer );
+
+    if (!buffer) return E_POINTER;
+
+    /* a single chunk is handed out as is, otherwise the chunks are joined */
+    if ((ptr = list_head( &impl->chunks )) && !list_next( &impl->chunks, ptr ))
+    {
+        chunk = LIST_ENTRY( ptr, struct chunk, entry );
+        IBuffer_put_Length( chunk->buffer, chunk->length );
+        IBuffer_AddRef( (*buffer = chunk->buffer) );
+    }
+    else
+    {
+        if (FAILED(hr = buffer_create( impl->unstored, buffer ))) return hr;
+        buffer_get_bytes( *buffer, &data, &size );
+        LIST_FOR_EACH_ENTRY( chunk, &impl->chunks, struct chunk, entry )
+        {
+            memcpy( data, chunk->data, chunk->length );
+            data += chunk->length;
+        }
+        IBuffer_put_Length( *buffer, impl->unstored );
+    }
+
+    chunk_list_clear( &impl->chunks );
+    impl->unstored = 0;
+    return S_OK;
+}
+
+static HRESULT WINAPI datawriter_DetachStream( IDataWriter *iface, IOutputStream **stream )
+{
+    struct datawriter *impl = impl_from_IDataWriter( iface );
+
+    TRACE( "iface %p, stream %p\n", iface, stream );
+
+    if (!stream) return E_POINTER;
+    *stream = impl->stream;
+    impl->stream = NULL;
+    return S_OK;
+}
+
+static const struct IDataWriterVtbl datawriter_vtbl =
+{
+    datawriter_QueryInterface,
+    datawriter_AddRef,
+    datawriter_Release,
+    /* IInspectable methods */
+    datawriter_GetIids,
+    datawriter_GetRuntimeClassName,
+    datawriter_GetTrustLevel,
+    /* IDataWriter methods */
+    datawriter_get_UnstoredBufferLength,
+    datawriter_get_UnicodeEncoding,
+    datawriter_put_UnicodeEncoding,
+    datawriter_get_ByteOrder,
+    datawriter_put_ByteOrder,
+    datawriter_WriteByte,
+    datawriter_WriteBytes,
+    datawriter_WriteBuffer,
+    datawriter_WriteBufferRange,
+    datawriter_WriteBoolean,
+    datawriter_WriteGuid,
+    datawriter_WriteInt16,
+    datawriter_WriteInt32,
+    datawriter_WriteInt64,
+    datawriter_WriteUInt16,
+    datawriter_WriteUInt32,
+    datawriter_WriteUInt64,
+    datawriter_WriteSingle,
+    datawriter_WriteDouble,
+    datawriter_WriteDateTime,
+    datawriter_WriteTimeSpan,
+    datawriter_WriteString,
+    datawriter_MeasureString,
+    datawriter_StoreAsync,
+    datawriter_FlushAsync,
+    datawriter_DetachBuffer,
+    datawriter_DetachStream,
+};
+
+DEFINE_IINSPECTABLE( datawriter_closable, IClosable, struct datawriter, IDataWriter_iface )
+
+static HRESULT WINAPI datawriter_closable_Close( IClosable *iface )
+{
+    struct datawriter *impl = impl_from_IClosable( iface );
+
+    TRACE( "iface %p.\n", iface );
+
+    chunk_list_clear( &impl->chunks );
+    impl->unstored = 0;
+    if (impl->stream) IOutputStream_Release( impl->stream );
+    impl->stream = NULL;
+    return S_OK;
+}
+
+static const struct IClosableVtbl datawriter_closable_vtbl =
+{
+    datawriter_closable_QueryInterface,
+    datawriter_closable_AddRef,
+    datawriter_closable_Release,
+    /* IInspectable methods */
+    datawriter_closable_GetIids,
+    datawriter_closable_GetRuntimeClassName,
+    datawriter_closable_GetTrustLevel,
+    /* IClosable methods */
+    datawriter_closable_Close,
+};
+
+static HRESULT datawriter_create( IOutputStream *stream, IDataWriter **out )
+{
+    struct datawriter *object;
+
+    if (!(object = calloc( 1, sizeof(*object) ))) return E_OUTOFMEMORY;
+
+    object->IDataWriter_iface.lpVtbl = &datawriter_vtbl;
+    object->IClosable_iface.lpVtbl = &datawriter_closable_vtbl;
+    object->ref = 1;
+    list_init( &object->chunks );
+    list_init( &object->storing );
+    if ((object->stream = stream)) IOutputStream_AddRef( stream );
+
+    *out = &object->IDataWriter_iface;
+    TRACE( "created IDataWriter %p.\n", *out );
+    return S_OK;
+}
+
+struct datawriter_statics
+{
+    IActivationFactory IActivationFactory_iface;
+    IDataWriterFactory IDataWriterFactory_iface;
+    LONG ref;
+};
+
+static inline struct datawriter_statics *impl_from_IActivationFactory( IActivationFactory *iface )
+{
+    return CONTAINING_RECORD( iface, struct datawriter_statics, IActivationFactory_iface );
+}
+
+static HRESULT WINAPI factory_QueryInterface( IActivationFactory *iface, REFIID iid, void **out )
+{
+    struct datawriter_statics *impl = impl_from_IActivationFactory( iface );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IActivationFactory ))
+    {
+        *out = &impl->IActivationFactory_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    if (IsEqualGUID( iid, &IID_IDataWriterFactory ))
+    {
+        *out = &impl->IDataWriterFactory_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI factory_AddRef( IActivationFactory *iface )
+{
+    struct datawriter_statics *impl = impl_from_IActivationFactory( iface );
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "iface %p increasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static ULONG WINAPI factory_Release( IActivationFactory *iface )
+{
+    struct datawriter_statics *impl = impl_from_IActivationFactory( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static HRESULT WINAPI factory_GetIids( IActivationFactory *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI factory_GetRuntimeClassName( IActivationFactory *iface, HSTRING *class_name )
+{
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI factory_GetTrustLevel( IActivationFactory *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI factory_ActivateInstance( IActivationFactory *iface, IInspectable **instance )
+{
+    TRACE( "iface %p, instance %p.\n", iface, instance );
+
+    if (!instance) return E_POINTER;
+    return datawriter_create( NULL, (IDataWriter **)instance );
+}
+
+static const struct IActivationFactoryVtbl factory_vtbl =
+{
+    factory_QueryInterface,
+    factory_AddRef,
+    factory_Release,
+    /* IInspectable methods */
+    factory_GetIids,
+    factory_GetRuntimeClassName,
+    factory_GetTrustLevel,
+    /* IActivationFactory methods */
+    factory_ActivateInstance,
+};
+
+DEFINE_IINSPECTABLE( datawriter_factory, IDataWriterFactory, struct datawriter_statics, IActivationFactory_iface )
+
+static HRESULT WINAPI datawriter_factory_CreateDataWriter( IDataWriterFactory *iface, IOutputStream *stream, IDataWriter **writer )
+{
+    TRACE( "iface %p, stream %p, writer %p\n", iface, stream, writer );
+
+    if (!stream || !writer) return E_POINTER;
+    return datawriter_create( stream, writer );
+}
+
+static const struct IDataWriterFactoryVtbl datawriter_factory_vtbl =
+{
+    datawriter_factory_QueryInterface,
+    datawriter_factory_AddRef,
+    datawriter_factory_Release,
+    /* IInspectable methods */
+    datawriter_factory_GetIids,
+    datawriter_factory_GetRuntimeClassName,
+    datawriter_factory_GetTrustLevel,
+    /* IDataWriterFactory methods */
+    datawriter_factory_CreateDataWriter,
+};
+
+static struct datawriter_statics datawriter_statics =
+{
+    .IActivationFactory_iface.lpVtbl = &factory_vtbl,
+    .IDataWriterFactory_iface.lpVtbl = &datawriter_factory_vtbl,
+    .ref = 1,
+};
+
+IActivationFactory *datawriter_factory = &datawriter_statics.IActivationFactory_iface;
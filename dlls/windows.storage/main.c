@@ -41,9 +41,31 @@ HRESULT WINAPI DllGetActivationFactory( HSTRING classid, IActivationFactory **fa
     if (!wcscmp( buffer, RuntimeClass_Windows_Storage_ApplicationData ))
         IActivationFactory_QueryInterface( application_data_factory, &IID_IActivationFactory, (void **)factory );
 
+    if (!wcscmp( buffer, RuntimeClass_Windows_Storage_Streams_Buffer ))
+        IActivationFactory_QueryInterface( buffer_factory, &IID_IActivationFactory, (void **)factory );
+
     if (!wcscmp( buffer, RuntimeClass_Windows_Storage_Streams_DataReader ))
         IActivationFactory_QueryInterface( datareader_factory, &IID_IActivationFactory, (void **)factory );
 
+    if (!wcscmp( buffer, RuntimeClass_Windows_Storage_Streams_DataWriter ))
+        IActivationFactory_QueryInterface( datawriter_factory, &IID_IActivationFactory, (void **)factory );
+
     if (*factory) return S_OK;
     return CLASS_E_CLASSNOTAVAILABLE;
 }
+
+BOOL WINAPI DllMain( HINSTANCE instance, DWORD reason, void *reserved )
+{
+    TRACE( "instance %p, reason %lu, reserved %p.\n", instance, reason, reserved );
+
+    switch (reason)
+    {
+    case DLL_PROCESS_ATTACH:
+        DisableThreadLibraryCalls( instance );
+        break;
+    case DLL_PROCESS_DETACH:
+        flush_propertysets( reserved != NULL );
+        break;
+    }
+    return TRUE;
+}
@@ -37,10 +37,26 @@
 #include "windows.storage.h"
 #include "windows.storage.streams.h"
 
-extern IPropertySet *create_propertyset(void);
-extern IApplicationDataContainer *create_data_container(void);
+#include "wine/list.h"
+#include "wine/winrtasync.h"
+
+extern IPropertySet *create_propertyset( const WCHAR *path );
+extern void flush_propertysets( BOOL process_exit );
+extern void create_parent_directories( const WCHAR *path );
+extern IApplicationDataContainer *create_data_container( const WCHAR *name, const WCHAR *path );
+extern UINT32 property_value_size( PropertyType type );
+extern HRESULT property_value_get_data( IPropertyValue *value, PropertyType type, void *data );
+extern HRESULT property_value_create( PropertyType type, const void *data, UINT32 size, IInspectable **out );
+extern HRESULT buffer_create( UINT32 capacity, IBuffer **out );
+extern HRESULT buffer_create_view( IUnknown *owner, BYTE *data, UINT32 capacity, UINT32 length, IBuffer **out );
+extern HRESULT buffer_get_bytes( IBuffer *buffer, BYTE **data, UINT32 *length );
+extern void swap_byte_order( void *data, UINT32 count, UINT32 size );
+extern HRESULT async_waiter_create( const GUID *iid, IUnknown **out );
+extern AsyncStatus async_waiter_wait( IUnknown *waiter );
 extern IActivationFactory *application_data_factory;
+extern IActivationFactory *buffer_factory;
 extern IActivationFactory *datareader_factory;
+extern IActivationFactory *datawriter_factory;
 
 #define DEFINE_IINSPECTABLE_( pfx, iface_type, impl_type, impl_from, iface_mem, expr )             \
     static inline impl_type *impl_from( iface_type *iface )                                        \
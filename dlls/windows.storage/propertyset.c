@@ -19,10 +19,50 @@
 
 #include "private.h"
 #include "wine/debug.h"
+#include "wine/list.h"
 #include "pathcch.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(data);
 
+/* The values are kept in an open addressing hash table keyed by the setting names. Sets
+ * with a backing file load it on first access, and changes are written back by a
+ * threadpool timer, so that a burst of Insert calls results in a single file write. */
+
+#define FLUSH_DELAY_MS 1000
+
+#define SETTINGS_MAGIC   0x53545357  /* "WSTS" */
+#define SETTINGS_VERSION 1
+
+/* settings file layout, all the records follow the header */
+struct settings_header
+{
+    UINT32 magic;
+    UINT32 version;
+    UINT32 count;
+};
+
+struct settings_record
+{
+    UINT32 key_len;    /* key length in WCHARs, the key follows */
+    UINT32 type;       /* PropertyType of the value */
+    UINT32 data_size;  /* size of the value data, following the key */
+};
+
+enum entry_state
+{
+    ENTRY_FREE = 0,
+    ENTRY_USED,
+    ENTRY_DELETED,
+};
+
+struct map_entry
+{
+    enum entry_state state;
+    UINT32 hash;
+    HSTRING key;
+    IInspectable *value;
+};
+
 struct propertyset_impl
 {
     IPropertySet IPropertySet_iface;
@@ -30,7 +70,438 @@ struct propertyset_impl
     IMap_HSTRING_IInspectable IMap_iface;
     IIterable_IKeyValuePair_HSTRING_IInspectable IIterable_iface;
     LONG ref;
+
+    CRITICAL_SECTION cs;
+    struct map_entry *entries;
+    UINT32 capacity;      /* power of two, or 0 */
+    UINT32 count;         /* used entries */
+    UINT32 deleted;       /* deleted entries, still taking a slot */
+
+    WCHAR *path;          /* backing file, NULL for in-memory sets */
+    struct list entry;    /* entry in the persistent sets list */
+    BOOL loaded;
+    BOOL flush_pending;
+    BOOL flushing;        /* a flush is writing the file */
+    PTP_TIMER flush_timer;
+    CRITICAL_SECTION flush_cs;  /* serializes the file writes */
+};
+
+/* the persistent sets, they are kept alive until the process exits */
+static struct list persistent_sets = LIST_INIT( persistent_sets );
+static CRITICAL_SECTION persistent_sets_cs;
+static CRITICAL_SECTION_DEBUG persistent_sets_cs_debug =
+{
+    0, 0, &persistent_sets_cs,
+    { &persistent_sets_cs_debug.ProcessLocksList, &persistent_sets_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": persistent_sets_cs") }
 };
+static CRITICAL_SECTION persistent_sets_cs = { &persistent_sets_cs_debug, -1, 0, 0, 0, 0 };
+
+static UINT32 hash_key( const WCHAR *str, UINT32 len )
+{
+    UINT32 hash = 2166136261u;
+
+    while (len--)
+    {
+        hash ^= *str++;
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+/* find the entry holding key, or the free slot where it would be inserted */
+static struct map_entry *find_entry( struct propertyset_impl *impl, HSTRING key, UINT32 hash )
+{
+    struct map_entry *entry, *free_entry = NULL;
+    UINT32 i, mask = impl->capacity - 1;
+    INT32 order;
+
+    if (!impl->capacity) return NULL;
+
+    for (i = hash & mask;; i = (i + 1) & mask)
+    {
+        entry = impl->entries + i;
+        if (entry->state == ENTRY_FREE) return free_entry ? free_entry : entry;
+        if (entry->state == ENTRY_DELETED)
+        {
+            if (!free_entry) free_entry = entry;
+            continue;
+        }
+        if (entry->hash == hash && SUCCEEDED(WindowsCompareStringOrdinal( entry->key, key, &order )) && !order)
+            return entry;
+    }
+}
+
+static BOOL resize_map( struct propertyset_impl *impl, UINT32 capacity )
+{
+    struct map_entry *entries = impl->entries, *entry;
+    UINT32 i, old_capacity = impl->capacity;
+
+    if (!(impl->entries = calloc( capacity, sizeof(*impl->entries) )))
+    {
+        impl->entries = entries;
+        return FALSE;
+    }
+    impl->capacity = capacity;
+    impl->deleted = 0;
+
+    for (i = 0; i < old_capacity; i++)
+    {
+        if (entries[i].state != ENTRY_USED) continue;
+        entry = find_entry( impl, entries[i].key, entries[i].hash );
+        *entry = entries[i];
+    }
+    free( entries );
+    return TRUE;
+}
+
+/* insert or replace a value, takes ownership of the value reference */
+static HRESULT map_set_value( struct propertyset_impl *impl, HSTRING key, IInspectable *value, boolean *replaced )
+{
+    UINT32 len, hash;
+    const WCHAR *str = WindowsGetStringRawBuffer( key, &len );
+    struct map_entry *entry;
+    HRESULT hr;
+
+    /* keep the load factor under 3/4, including the deleted entries */
+    if ((impl->count + impl->deleted + 1) * 4 > impl->capacity * 3)
+    {
+        UINT32 capacity = max( impl->capacity, 16 );
+        if ((impl->count + 1) * 2 > capacity) capacity *= 2;
+        if (!resize_map( impl, capacity )) return E_OUTOFMEMORY;
+    }
+
+    hash = hash_key( str, len );
+    entry = find_entry( impl, key, hash );
+    if ((*replaced = entry->state == ENTRY_USED))
+    {
+        IInspectable_Release( entry->value );
+        entry->value = value;
+        return S_OK;
+    }
+
+    if (FAILED(hr = WindowsDuplicateString( key, &entry->key ))) return hr;
+    if (entry->state == ENTRY_DELETED) impl->deleted--;
+    entry->state = ENTRY_USED;
+    entry->hash = hash;
+    entry->value = value;
+    impl->count++;
+    return S_OK;
+}
+
+static struct map_entry *map_get_entry( struct propertyset_impl *impl, HSTRING key )
+{
+    UINT32 len;
+    const WCHAR *str = WindowsGetStringRawBuffer( key, &len );
+    struct map_entry *entry = find_entry( impl, key, hash_key( str, len ) );
+
+    if (!entry || entry->state != ENTRY_USED) return NULL;
+    return entry;
+}
+
+static void map_clear( struct propertyset_impl *impl )
+{
+    UINT32 i;
+
+    for (i = 0; i < impl->capacity; i++)
+    {
+        if (impl->entries[i].state != ENTRY_USED) continue;
+        WindowsDeleteString( impl->entries[i].key );
+        IInspectable_Release( impl->entries[i].value );
+    }
+    free( impl->entries );
+    impl->entries = NULL;
+    impl->capacity = impl->count = impl->deleted = 0;
+}
+
+static void load_settings( struct propertyset_impl *impl )
+{
+    const struct settings_header *header;
+    const struct settings_record *record;
+    LARGE_INTEGER file_size;
+    const BYTE *ptr, *end;
+    IInspectable *value;
+    boolean replaced;
+    DWORD size = 0;
+    BYTE *buffer;
+    HSTRING key;
+    HANDLE file;
+    UINT32 i;
+
+    impl->loaded = TRUE;
+
+    file = CreateFileW( impl->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL );
+    if (file == INVALID_HANDLE_VALUE) return;
+
+    if (!GetFileSizeEx( file, &file_size ) || file_size.QuadPart > 0x10000000 ||
+        !(buffer = malloc( file_size.QuadPart )))
+    {
+        CloseHandle( file );
+        return;
+    }
+    if (!ReadFile( file, buffer, file_size.QuadPart, &size, NULL )) size = 0;
+    CloseHandle( file );
+
+    header = (const struct settings_header *)buffer;
+    if (size < sizeof(*header) || header->magic != SETTINGS_MAGIC || header->version != SETTINGS_VERSION)
+    {
+        WARN( "invalid settings file %s\n", debugstr_w( impl->path ) );
+        free( buffer );
+        return;
+    }
+
+    ptr = (const BYTE *)(header + 1);
+    end = buffer + size;
+    for (i = 0; i < header->count; i++)
+    {
+        record = (const struct settings_record *)ptr;
+        if ((SIZE_T)(end - ptr) < sizeof(*record)) break;
+        ptr += sizeof(*record);
+        if ((SIZE_T)(end - ptr) / sizeof(WCHAR) < record->key_len) break;
+        if ((SIZE_T)(end - ptr) - record->key_len * sizeof(WCHAR) < record->data_size) break;
+
+        if (FAILED(WindowsCreateString( (const WCHAR *)ptr, record->key_len, &key ))) break;
+        ptr += record->key_len * sizeof(WCHAR);
+
+        if (SUCCEEDED(property_value_create( record->type, ptr, record->data_size, &value )) &&
+            FAILED(map_set_value( impl, key, value, &replaced )))
+            IInspectable_Release( value );
+        WindowsDeleteString( key );
+        ptr += record->data_size;
+    }
+    if (i < header->count) WARN( "truncated settings file %s\n", debugstr_w( impl->path ) );
+
+    TRACE( "loaded %u values from %s\n", impl->count, debugstr_w( impl->path ) );
+    free( buffer );
+}
+
+static void lock_map( struct propertyset_impl *impl )
+{
+    EnterCriticalSection( &impl->cs );
+    if (impl->path && !impl->loaded) load_settings( impl );
+}
+
+static void unlock_map( struct propertyset_impl *impl )
+{
+    LeaveCriticalSection( &impl->cs );
+}
+
+static BOOL append_data( BYTE **buffer, SIZE_T *size, SIZE_T *capacity, const void *data, SIZE_T data_size )
+{
+    BYTE *tmp;
+
+    if (*size + data_size > *capacity)
+    {
+        SIZE_T new_capacity = max( *capacity * 2, *size + data_size );
+        if (!(tmp = realloc( *buffer, new_capacity ))) return FALSE;
+        *buffer = tmp;
+        *capacity = new_capacity;
+    }
+    memcpy( *buffer + *size, data, data_size );
+    *size += data_size;
+    return TRUE;
+}
+
+/* serialize the values, must be called with the map lock held */
+static BYTE *serialize_settings( struct propertyset_impl *impl, SIZE_T *size )
+{
+    struct settings_header header = {SETTINGS_MAGIC, SETTINGS_VERSION, 0};
+    struct settings_record record;
+    SIZE_T capacity = 4096;
+    IPropertyValue *value;
+    const WCHAR *key;
+    const void *data;
+    BYTE buffer[16];
+    HSTRING string;
+    BYTE *ret;
+    UINT32 i;
+    BOOL ok;
+
+    if (!(ret = malloc( capacity ))) return NULL;
+    *size = sizeof(header);
+
+    for (i = 0; i < impl->capacity; i++)
+    {
+        struct map_entry *entry = impl->entries + i;
+
+        if (entry->state != ENTRY_USED) continue;
+        if (FAILED(IInspectable_QueryInterface( entry->value, &IID_IPropertyValue, (void **)&value )))
+        {
+            WARN( "value of %s isn't a property value, not saving it\n", debugstr_hstring( entry->key ) );
+            continue;
+        }
+
+        string = NULL;
+        data = NULL;
+        if (FAILED(IPropertyValue_get_Type( value, (PropertyType *)&record.type ))) record.type = PropertyType_Empty;
+        if (record.type == PropertyType_String)
+        {
+            if (SUCCEEDED(IPropertyValue_GetString( value, &string )))
+            {
+                data = WindowsGetStringRawBuffer( string, &record.data_size );
+                record.data_size *= sizeof(WCHAR);
+            }
+        }
+        else if ((record.data_size = property_value_size( record.type )) &&
+                 SUCCEEDED(property_value_get_data( value, record.type, buffer )))
+            data = buffer;
+        IPropertyValue_Release( value );
+
+        if (!data)
+        {
+            FIXME( "value of %s has unsupported type %u, not saving it\n", debugstr_hstring( entry->key ), record.type );
+            continue;
+        }
+
+        key = WindowsGetStringRawBuffer( entry->key, &record.key_len );
+        ok = append_data( &ret, size, &capacity, &record, sizeof(record) ) &&
+             append_data( &ret, size, &capacity, key, record.key_len * sizeof(WCHAR) ) &&
+             append_data( &ret, size, &capacity, data, record.data_size );
+        WindowsDeleteString( string );
+        if (!ok)
+        {
+            free( ret );
+            return NULL;
+        }
+        header.count++;
+    }
+
+    memcpy( ret, &header, sizeof(header) );
+    return ret;
+}
+
+/* create the parent directories of path */
+void create_parent_directories( const WCHAR *path )
+{
+    WCHAR *dir = wcsdup( path ), *ptr;
+
+    if (!dir) return;
+    for (ptr = wcschr( dir, '\\' ); ptr; ptr = wcschr( ptr + 1, '\\' ))
+    {
+        if (ptr == dir || ptr[-1] == ':') continue;
+        *ptr = 0;
+        CreateDirectoryW( dir, NULL );
+        *ptr = '\\';
+    }
+    free( dir );
+}
+
+static void write_settings( struct propertyset_impl *impl, const BYTE *data, SIZE_T size )
+{
+    WCHAR *tmp_path;
+    DWORD written;
+    HANDLE file;
+    BOOL ret;
+
+    if ((tmp_path = malloc( (wcslen( impl->path ) + 5) * sizeof(WCHAR) )))
+    {
+        wcscpy( tmp_path, impl->path );
+        wcscat( tmp_path, L".tmp" );
+
+        create_parent_directories( impl->path );
+        file = CreateFileW( tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL );
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            ret = WriteFile( file, data, size, &written, NULL ) && written == size;
+            CloseHandle( file );
+            /* replace the file only once fully written, so that it's never left truncated */
+            if (ret) ret = MoveFileExW( tmp_path, impl->path, MOVEFILE_REPLACE_EXISTING );
+            if (!ret) DeleteFileW( tmp_path );
+        }
+        else ret = FALSE;
+
+        if (!ret) ERR( "failed to write settings %s, error %lu\n", debugstr_w( impl->path ), GetLastError() );
+        else TRACE( "wrote %Iu bytes to %s\n", size, debugstr_w( impl->path ) );
+        free( tmp_path );
+    }
+}
+
+static void flush_settings( struct propertyset_impl *impl )
+{
+    SIZE_T size;
+    BYTE *data;
+
+    EnterCriticalSection( &impl->flush_cs );
+    impl->flushing = TRUE;
+
+    EnterCriticalSection( &impl->cs );
+    impl->flush_pending = FALSE;
+    data = serialize_settings( impl, &size );
+    LeaveCriticalSection( &impl->cs );
+
+    if (data) write_settings( impl, data, size );
+    free( data );
+
+    impl->flushing = FALSE;
+    LeaveCriticalSection( &impl->flush_cs );
+}
+
+static void CALLBACK flush_timer_cb( TP_CALLBACK_INSTANCE *instance, void *context, TP_TIMER *timer )
+{
+    flush_settings( context );
+}
+
+/* schedule the file write, must be called with the map lock held */
+static void schedule_flush( struct propertyset_impl *impl )
+{
+    LARGE_INTEGER due;
+    FILETIME ft;
+
+    if (!impl->path || impl->flush_pending) return;
+
+    if (!impl->flush_timer && !(impl->flush_timer = CreateThreadpoolTimer( flush_timer_cb, impl, NULL )))
+    {
+        ERR( "failed to create flush timer, settings won't be saved\n" );
+        return;
+    }
+    due.QuadPart = (LONGLONG)FLUSH_DELAY_MS * -10000;
+    ft.dwLowDateTime = due.u.LowPart;
+    ft.dwHighDateTime = due.u.HighPart;
+    impl->flush_pending = TRUE;
+    SetThreadpoolTimer( impl->flush_timer, &ft, 0, 0 );
+}
+
+/* write the settings that are still waiting for their flush timer, and close the timers,
+ * called when the library is unloaded */
+void flush_propertysets( BOOL process_exit )
+{
+    struct propertyset_impl *impl;
+    SIZE_T size;
+    BOOL pending;
+    BYTE *data;
+
+    if (process_exit)
+    {
+        /* the other threads, including the thread pool, are gone and may have left the
+         * locks held, so don't take any, and write the sets that a flush was interrupted for */
+        LIST_FOR_EACH_ENTRY( impl, &persistent_sets, struct propertyset_impl, entry )
+        {
+            if (!impl->flush_pending && !impl->flushing) continue;
+            if (!(data = serialize_settings( impl, &size ))) continue;
+            write_settings( impl, data, size );
+            free( data );
+        }
+        return;
+    }
+
+    EnterCriticalSection( &persistent_sets_cs );
+    LIST_FOR_EACH_ENTRY( impl, &persistent_sets, struct propertyset_impl, entry )
+    {
+        if (impl->flush_timer)
+        {
+            SetThreadpoolTimer( impl->flush_timer, NULL, 0, 0 );
+            WaitForThreadpoolTimerCallbacks( impl->flush_timer, TRUE );
+            CloseThreadpoolTimer( impl->flush_timer );
+            impl->flush_timer = NULL;
+        }
+
+        EnterCriticalSection( &impl->cs );
+        pending = impl->flush_pending;
+        LeaveCriticalSection( &impl->cs );
+        if (pending) flush_settings( impl );
+    }
+    LeaveCriticalSection( &persistent_sets_cs );
+}
 
 static inline struct propertyset_impl *impl_from_IPropertySet( IPropertySet *iface )
 {
@@ -88,7 +559,19 @@ static ULONG WINAPI propertyset_Release( IPropertySet *iface )
 {
     struct propertyset_impl *impl = impl_from_IPropertySet( iface );
     ULONG ref = InterlockedDecrement( &impl->ref );
+
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+
+    if (!ref)
+    {
+        /* persistent sets are never released, the list holds a reference */
+        map_clear( impl );
+        impl->cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection( &impl->cs );
+        impl->flush_cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection( &impl->flush_cs );
+        free( impl );
+    }
     return ref;
 }
 
@@ -158,9 +641,7 @@ static ULONG WINAPI observable_AddRef( IObservableMap_HSTRING_IInspectable *ifac
 static ULONG WINAPI observable_Release( IObservableMap_HSTRING_IInspectable *iface )
 {
     struct propertyset_impl *impl = impl_from_IObservableMap( iface );
-    ULONG ref = InterlockedDecrement( &impl->ref );
-    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
-    return ref;
+    return IPropertySet_Release( &impl->IPropertySet_iface );
 }
 
 static HRESULT WINAPI observable_GetIids( IObservableMap_HSTRING_IInspectable *iface, ULONG *iid_count, IID **iids )
@@ -209,7 +690,7 @@ static const struct IObservableMap_HSTRING_IInspectableVtbl observable_vtbl =
 
 static inline struct propertyset_impl *impl_from_IMap( IMap_HSTRING_IInspectable *iface )
 {
-    return CONTAINING_RECORD( iface, struct propertyset_impl, IObservableMap_iface );
+    return CONTAINING_RECORD( iface, struct propertyset_impl, IMap_iface );
 }
 
 static HRESULT WINAPI map_QueryInterface( IMap_HSTRING_IInspectable *iface, REFIID iid, void **out )
@@ -251,9 +732,7 @@ static ULONG WINAPI map_AddRef( IMap_HSTRING_IInspectable *iface )
 static ULONG WINAPI map_Release( IMap_HSTRING_IInspectable *iface )
 {
     struct propertyset_impl *impl = impl_from_IMap( iface );
-    ULONG ref = InterlockedDecrement( &impl->ref );
-    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
-    return ref;
+    return IPropertySet_Release( &impl->IPropertySet_iface );
 }
 
 static HRESULT WINAPI map_GetIids( IMap_HSTRING_IInspectable *iface, ULONG *iid_count, IID **iids )
@@ -276,21 +755,53 @@ static HRESULT WINAPI map_GetTrustLevel( IMap_HSTRING_IInspectable *iface, Trust
 
 static HRESULT WINAPI map_Lookup( IMap_HSTRING_IInspectable *iface, HSTRING key, IInspectable **value )
 {
-    FIXME( "iface %p, key %s, value %p stub!\n", iface, debugstr_hstring(key), value);
-    return E_NOTIMPL;
+    struct propertyset_impl *impl = impl_from_IMap( iface );
+    struct map_entry *entry;
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, key %s, value %p.\n", iface, debugstr_hstring(key), value );
+
+    if (!value) return E_POINTER;
+
+    lock_map( impl );
+    if (!(entry = map_get_entry( impl, key )))
+    {
+        *value = NULL;
+        hr = E_BOUNDS;
+    }
+    else IInspectable_AddRef( (*value = entry->value) );
+    unlock_map( impl );
+
+    return hr;
 }
 
 static HRESULT WINAPI map_get_Size( IMap_HSTRING_IInspectable *iface, unsigned int *size )
 {
-    FIXME( "iface %p, size %p stub!\n", iface, size);
-    *size = 0;
+    struct propertyset_impl *impl = impl_from_IMap( iface );
+
+    TRACE( "iface %p, size %p.\n", iface, size );
+
+    if (!size) return E_POINTER;
+
+    lock_map( impl );
+    *size = impl->count;
+    unlock_map( impl );
+
     return S_OK;
 }
 
 static HRESULT WINAPI map_HasKey( IMap_HSTRING_IInspectable *iface, HSTRING key, boolean *found )
 {
-    FIXME( "iface %p, key %s, found %p stub!\n", iface, debugstr_hstring(key), found);
-    *found = FALSE;
+    struct propertyset_impl *impl = impl_from_IMap( iface );
+
+    TRACE( "iface %p, key %s, found %p.\n", iface, debugstr_hstring(key), found );
+
+    if (!found) return E_POINTER;
+
+    lock_map( impl );
+    *found = !!map_get_entry( impl, key );
+    unlock_map( impl );
+
     return S_OK;
 }
 
@@ -302,20 +813,60 @@ static HRESULT WINAPI map_GetView( IMap_HSTRING_IInspectable *iface, IMapView_HS
 
 static HRESULT WINAPI map_Insert( IMap_HSTRING_IInspectable *iface, HSTRING key, IInspectable *value, boolean *replaced )
 {
-    FIXME( "iface %p, key %s, value %p, replaced %p stub!\n", iface, debugstr_hstring(key), value, replaced);
-    *replaced = FALSE;
-    return S_OK;
+    struct propertyset_impl *impl = impl_from_IMap( iface );
+    HRESULT hr;
+
+    TRACE( "iface %p, key %s, value %p, replaced %p.\n", iface, debugstr_hstring(key), value, replaced );
+
+    if (!replaced) return E_POINTER;
+    if (!value || !WindowsGetStringLen( key )) return E_INVALIDARG;
+
+    IInspectable_AddRef( value );
+    lock_map( impl );
+    if (FAILED(hr = map_set_value( impl, key, value, replaced ))) IInspectable_Release( value );
+    else schedule_flush( impl );
+    unlock_map( impl );
+
+    return hr;
 }
 
 static HRESULT WINAPI map_Remove( IMap_HSTRING_IInspectable *iface, HSTRING key )
 {
-    FIXME( "iface %p, key %s stub!\n", iface, debugstr_hstring(key));
-    return S_OK;
+    struct propertyset_impl *impl = impl_from_IMap( iface );
+    struct map_entry *entry;
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, key %s.\n", iface, debugstr_hstring(key) );
+
+    lock_map( impl );
+    if (!(entry = map_get_entry( impl, key ))) hr = E_BOUNDS;
+    else
+    {
+        WindowsDeleteString( entry->key );
+        IInspectable_Release( entry->value );
+        entry->key = NULL;
+        entry->value = NULL;
+        entry->state = ENTRY_DELETED;
+        impl->count--;
+        impl->deleted++;
+        schedule_flush( impl );
+    }
+    unlock_map( impl );
+
+    return hr;
 }
 
 static HRESULT WINAPI map_Clear( IMap_HSTRING_IInspectable *iface )
 {
-    FIXME( "iface %p, stub!\n", iface);
+    struct propertyset_impl *impl = impl_from_IMap( iface );
+
+    TRACE( "iface %p.\n", iface );
+
+    lock_map( impl );
+    map_clear( impl );
+    schedule_flush( impl );
+    unlock_map( impl );
+
     return S_OK;
 }
 
@@ -376,9 +927,7 @@ static ULONG WINAPI iterable_AddRef( IIterable_IKeyValuePair_HSTRING_IInspectabl
 static ULONG WINAPI iterable_Release( IIterable_IKeyValuePair_HSTRING_IInspectable *iface )
 {
     struct propertyset_impl *impl = impl_from_IIterable( iface );
-    ULONG ref = InterlockedDecrement( &impl->ref );
-    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
-    return ref;
+    return IPropertySet_Release( &impl->IPropertySet_iface );
 }
 
 static HRESULT WINAPI iterable_GetIids( IIterable_IKeyValuePair_HSTRING_IInspectable *iface, ULONG *iid_count, IID **iids )
@@ -419,11 +968,29 @@ static const struct IIterable_IKeyValuePair_HSTRING_IInspectableVtbl iterable_vt
     iterable_First,
 };
 
-IPropertySet *create_propertyset(void) {
+/* create a property set, backed by the settings file at path if not NULL */
+IPropertySet *create_propertyset( const WCHAR *path )
+{
     struct propertyset_impl *object;
 
-    if (!(object = calloc(1, sizeof(*object))))
+    if (path)
+    {
+        EnterCriticalSection( &persistent_sets_cs );
+        LIST_FOR_EACH_ENTRY( object, &persistent_sets, struct propertyset_impl, entry )
+        {
+            if (wcsicmp( object->path, path )) continue;
+            IPropertySet_AddRef( &object->IPropertySet_iface );
+            LeaveCriticalSection( &persistent_sets_cs );
+            return &object->IPropertySet_iface;
+        }
+    }
+
+    if (!(object = calloc(1, sizeof(*object))) || (path && !(object->path = wcsdup( path ))))
+    {
+        free( object );
+        if (path) LeaveCriticalSection( &persistent_sets_cs );
         return NULL;
+    }
 
     object->IPropertySet_iface.lpVtbl = &propertyset_vtbl;
     object->IObservableMap_iface.lpVtbl = &observable_vtbl;
@@ -431,5 +998,17 @@ IPropertySet *create_propertyset(void) {
     object->IIterable_iface.lpVtbl = &iterable_vtbl;
     object->ref = 1;
 
+    InitializeCriticalSectionEx( &object->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+    object->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": propertyset.cs");
+    InitializeCriticalSectionEx( &object->flush_cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+    object->flush_cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": propertyset.flush_cs");
+
+    if (path)
+    {
+        IPropertySet_AddRef( &object->IPropertySet_iface );
+        list_add_tail( &persistent_sets, &object->entry );
+        LeaveCriticalSection( &persistent_sets_cs );
+    }
+
     return &object->IPropertySet_iface;
 }
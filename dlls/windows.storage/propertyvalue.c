@@ -0,0 +1,366 @@
+/* WinRT Windows.Storage.ApplicationData boxed setting values
+ *
+ * Copyright (C) 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "private.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(data);
+
+/* size of the scalar types we can store, 0 if unsupported */
+UINT32 property_value_size( PropertyType type )
+{
+    switch (type)
+    {
+    case PropertyType_UInt8: return sizeof(BYTE);
+    case PropertyType_Int16: return sizeof(INT16);
+    case PropertyType_UInt16: return sizeof(UINT16);
+    case PropertyType_Int32: return sizeof(INT32);
+    case PropertyType_UInt32: return sizeof(UINT32);
+    case PropertyType_Int64: return sizeof(INT64);
+    case PropertyType_UInt64: return sizeof(UINT64);
+    case PropertyType_Single: return sizeof(FLOAT);
+    case PropertyType_Double: return sizeof(DOUBLE);
+    case PropertyType_Char16: return sizeof(WCHAR);
+    case PropertyType_Boolean: return sizeof(boolean);
+    case PropertyType_DateTime: return sizeof(DateTime);
+    case PropertyType_TimeSpan: return sizeof(TimeSpan);
+    case PropertyType_Guid: return sizeof(GUID);
+    case PropertyType_Point: return sizeof(Point);
+    case PropertyType_Size: return sizeof(Size);
+    case PropertyType_Rect: return sizeof(Rect);
+    default: return 0;
+    }
+}
+
+/* read the scalar value of any IPropertyValue, data must be property_value_size( type ) bytes */
+HRESULT property_value_get_data( IPropertyValue *value, PropertyType type, void *data )
+{
+    switch (type)
+    {
+    case PropertyType_UInt8: return IPropertyValue_GetUInt8( value, data );
+    case PropertyType_Int16: return IPropertyValue_GetInt16( value, data );
+    case PropertyType_UInt16: return IPropertyValue_GetUInt16( value, data );
+    case PropertyType_Int32: return IPropertyValue_GetInt32( value, data );
+    case PropertyType_UInt32: return IPropertyValue_GetUInt32( value, data );
+    case PropertyType_Int64: return IPropertyValue_GetInt64( value, data );
+    case PropertyType_UInt64: return IPropertyValue_GetUInt64( value, data );
+    case PropertyType_Single: return IPropertyValue_GetSingle( value, data );
+    case PropertyType_Double: return IPropertyValue_GetDouble( value, data );
+    case PropertyType_Char16: return IPropertyValue_GetChar16( value, data );
+    case PropertyType_Boolean: return IPropertyValue_GetBoolean( value, data );
+    case PropertyType_DateTime: return IPropertyValue_GetDateTime( value, data );
+    case PropertyType_TimeSpan: return IPropertyValue_GetTimeSpan( value, data );
+    case PropertyType_Guid: return IPropertyValue_GetGuid( value, data );
+    case PropertyType_Point: return IPropertyValue_GetPoint( value, data );
+    case PropertyType_Size: return IPropertyValue_GetSize( value, data );
+    case PropertyType_Rect: return IPropertyValue_GetRect( value, data );
+    default: return TYPE_E_TYPEMISMATCH;
+    }
+}
+
+struct property_value
+{
+    IPropertyValue IPropertyValue_iface;
+    /* all the IReference<T> have the same layout, this is the one matching type, if any */
+    IReference_INT32 IReference_iface;
+    LONG ref;
+
+    PropertyType type;
+    HSTRING string;
+    BYTE data[16];
+};
+
+static inline struct property_value *impl_from_IPropertyValue( IPropertyValue *iface )
+{
+    return CONTAINING_RECORD( iface, struct property_value, IPropertyValue_iface );
+}
+
+static const IID *get_reference_iid( PropertyType type )
+{
+    switch (type)
+    {
+    case PropertyType_UInt8: return &IID_IReference_BYTE;
+    case PropertyType_Int32: return &IID_IReference_INT32;
+    case PropertyType_UInt32: return &IID_IReference_UINT32;
+    case PropertyType_UInt64: return &IID_IReference_UINT64;
+    case PropertyType_Single: return &IID_IReference_FLOAT;
+    case PropertyType_Double: return &IID_IReference_DOUBLE;
+    case PropertyType_DateTime: return &IID_IReference_DateTime;
+    default: return NULL;
+    }
+}
+
+static HRESULT WINAPI property_value_QueryInterface( IPropertyValue *iface, REFIID iid, void **out )
+{
+    struct property_value *impl = impl_from_IPropertyValue( iface );
+    const IID *reference_iid = get_reference_iid( impl->type );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IPropertyValue ))
+    {
+        *out = &impl->IPropertyValue_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    if (reference_iid && IsEqualGUID( iid, reference_iid ))
+    {
+        *out = &impl->IReference_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI property_value_AddRef( IPropertyValue *iface )
+{
+    struct property_value *impl = impl_from_IPropertyValue( iface );
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "iface %p increasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static ULONG WINAPI property_value_Release( IPropertyValue *iface )
+{
+    struct property_value *impl = impl_from_IPropertyValue( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+
+    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+
+    if (!ref)
+    {
+        WindowsDeleteString( impl->string );
+        free( impl );
+    }
+    return ref;
+}
+
+static HRESULT WINAPI property_value_GetIids( IPropertyValue *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI property_value_GetRuntimeClassName( IPropertyValue *iface, HSTRING *class_name )
+{
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI property_value_GetTrustLevel( IPropertyValue *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI property_value_get_Type( IPropertyValue *iface, PropertyType *value )
+{
+    struct property_value *impl = impl_from_IPropertyValue( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    *value = impl->type;
+    return S_OK;
+}
+
+static HRESULT WINAPI property_value_get_IsNumericScalar( IPropertyValue *iface, boolean *value )
+{
+    struct property_value *impl = impl_from_IPropertyValue( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    *value = impl->type >= PropertyType_UInt8 && impl->type <= PropertyType_Double;
+    return S_OK;
+}
+
+#define DEFINE_PROPERTY_VALUE_GET( name, type )                                                    \
+    static HRESULT WINAPI property_value_Get##name( IPropertyValue *iface, type *value )           \
+    {                                                                                              \
+        struct property_value *impl = impl_from_IPropertyValue( iface );                           \
+        TRACE( "iface %p, value %p.\n", iface, value );                                            \
+        if (impl->type != PropertyType_##name) return TYPE_E_TYPEMISMATCH;                         \
+        memcpy( value, impl->data, sizeof(*value) );                                               \
+        return S_OK;                                                                               \
+    }
+
+DEFINE_PROPERTY_VALUE_GET( UInt8, BYTE )
+DEFINE_PROPERTY_VALUE_GET( Int16, INT16 )
+DEFINE_PROPERTY_VALUE_GET( UInt16, UINT16 )
+DEFINE_PROPERTY_VALUE_GET( Int32, INT32 )
+DEFINE_PROPERTY_VALUE_GET( UInt32, UINT32 )
+DEFINE_PROPERTY_VALUE_GET( Int64, INT64 )
+DEFINE_PROPERTY_VALUE_GET( UInt64, UINT64 )
+DEFINE_PROPERTY_VALUE_GET( Single, FLOAT )
+DEFINE_PROPERTY_VALUE_GET( Double, DOUBLE )
+DEFINE_PROPERTY_VALUE_GET( Char16, WCHAR )
+DEFINE_PROPERTY_VALUE_GET( Boolean, boolean )
+DEFINE_PROPERTY_VALUE_GET( Guid, GUID )
+DEFINE_PROPERTY_VALUE_GET( DateTime, DateTime )
+DEFINE_PROPERTY_VALUE_GET( TimeSpan, TimeSpan )
+DEFINE_PROPERTY_VALUE_GET( Point, Point )
+DEFINE_PROPERTY_VALUE_GET( Size, Size )
+DEFINE_PROPERTY_VALUE_GET( Rect, Rect )
+
+static HRESULT WINAPI property_value_GetString( IPropertyValue *iface, HSTRING *value )
+{
+    struct property_value *impl = impl_from_IPropertyValue( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (impl->type != PropertyType_String) return TYPE_E_TYPEMISMATCH;
+    return WindowsDuplicateString( impl->string, value );
+}
+
+/* we never hold arrays */
+#define DEFINE_PROPERTY_VALUE_GET_ARRAY( name, type )                                              \
+    static HRESULT WINAPI property_value_Get##name##Array( IPropertyValue *iface, UINT32 *size,     \
+                                                            type **value )                         \
+    {                                                                                              \
+        TRACE( "iface %p, size %p, value %p.\n", iface, size, value );                             \
+        return TYPE_E_TYPEMISMATCH;                                                                \
+    }
+
+DEFINE_PROPERTY_VALUE_GET_ARRAY( UInt8, BYTE )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Int16, INT16 )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( UInt16, UINT16 )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Int32, INT32 )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( UInt32, UINT32 )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Int64, INT64 )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( UInt64, UINT64 )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Single, FLOAT )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Double, DOUBLE )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Char16, WCHAR )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Boolean, boolean )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( String, HSTRING )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Inspectable, IInspectable * )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Guid, GUID )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( DateTime, DateTime )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( TimeSpan, TimeSpan )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Point, Point )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Size, Size )
+DEFINE_PROPERTY_VALUE_GET_ARRAY( Rect, Rect )
+
+static const struct IPropertyValueVtbl property_value_vtbl =
+{
+    property_value_QueryInterface,
+    property_value_AddRef,
+    property_value_Release,
+    /* IInspectable methods */
+    property_value_GetIids,
+    property_value_GetRuntimeClassName,
+    property_value_GetTrustLevel,
+    /* IPropertyValue methods */
+    property_value_get_Type,
+    property_value_get_IsNumericScalar,
+    property_value_GetUInt8,
+    property_value_GetInt16,
+    property_value_GetUInt16,
+    property_value_GetInt32,
+    property_value_GetUInt32,
+    property_value_GetInt64,
+    property_value_GetUInt64,
+    property_value_GetSingle,
+    property_value_GetDouble,
+    property_value_GetChar16,
+    property_value_GetBoolean,
+    property_value_GetString,
+    property_value_GetGuid,
+    property_value_GetDateTime,
+    property_value_GetTimeSpan,
+    property_value_GetPoint,
+    property_value_GetSize,
+    property_value_GetRect,
+    property_value_GetUInt8Array,
+    property_value_GetInt16Array,
+    property_value_GetUInt16Array,
+    property_value_GetInt32Array,
+    property_value_GetUInt32Array,
+    property_value_GetInt64Array,
+    property_value_GetUInt64Array,
+    property_value_GetSingleArray,
+    property_value_GetDoubleArray,
+    property_value_GetChar16Array,
+    property_value_GetBooleanArray,
+    property_value_GetStringArray,
+    property_value_GetInspectableArray,
+    property_value_GetGuidArray,
+    property_value_GetDateTimeArray,
+    property_value_GetTimeSpanArray,
+    property_value_GetPointArray,
+    property_value_GetSizeArray,
+    property_value_GetRectArray,
+};
+
+DEFINE_IINSPECTABLE( reference, IReference_INT32, struct property_value, IPropertyValue_iface )
+
+static HRESULT WINAPI reference_get_Value( IReference_INT32 *iface, INT32 *value )
+{
+    struct property_value *impl = impl_from_IReference_INT32( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    memcpy( value, impl->data, property_value_size( impl->type ) );
+    return S_OK;
+}
+
+static const struct IReference_INT32Vtbl reference_vtbl =
+{
+    reference_QueryInterface,
+    reference_AddRef,
+    reference_Release,
+    /* IInspectable methods */
+    reference_GetIids,
+    reference_GetRuntimeClassName,
+    reference_GetTrustLevel,
+    /* IReference<T> methods */
+    reference_get_Value,
+};
+
+/* box a scalar or string value, for strings data is the WCHAR buffer and size its byte length */
+HRESULT property_value_create( PropertyType type, const void *data, UINT32 size, IInspectable **out )
+{
+    struct property_value *impl;
+    HRESULT hr;
+
+    if (type != PropertyType_String && (!property_value_size( type ) || size != property_value_size( type )))
+        return E_INVALIDARG;
+    if (!(impl = calloc( 1, sizeof(*impl) ))) return E_OUTOFMEMORY;
+
+    impl->IPropertyValue_iface.lpVtbl = &property_value_vtbl;
+    impl->IReference_iface.lpVtbl = &reference_vtbl;
+    impl->ref = 1;
+    impl->type = type;
+
+    if (type != PropertyType_String) memcpy( impl->data, data, size );
+    else if (FAILED(hr = WindowsCreateString( data, size / sizeof(WCHAR), &impl->string )))
+    {
+        free( impl );
+        return hr;
+    }
+
+    *out = (IInspectable *)&impl->IPropertyValue_iface;
+    return S_OK;
+}
@@ -18,6 +18,7 @@
 #define COBJMACROS
 #include "initguid.h"
 #include <stdarg.h>
+#include <stdio.h>
 
 #include "windef.h"
 #include "winbase.h"
@@ -45,6 +46,289 @@ static void check_interface_( unsigned int line, void *obj, const IID *iid )
     IUnknown_Release( unk );
 }
 
+/* a boxed INT32 or string, the settings only accept property values */
+struct test_value
+{
+    IPropertyValue IPropertyValue_iface;
+    LONG ref;
+    PropertyType type;
+    INT32 int32;
+    HSTRING string;
+};
+
+static inline struct test_value *impl_from_IPropertyValue( IPropertyValue *iface )
+{
+    return CONTAINING_RECORD( iface, struct test_value, IPropertyValue_iface );
+}
+
+static HRESULT WINAPI test_value_QueryInterface( IPropertyValue *iface, REFIID iid, void **out )
+{
+    if (IsEqualGUID( iid, &IID_IUnknown ) || IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) || IsEqualGUID( iid, &IID_IPropertyValue ))
+    {
+        *out = iface;
+        IPropertyValue_AddRef( iface );
+        return S_OK;
+    }
+
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI test_value_AddRef( IPropertyValue *iface )
+{
+    struct test_value *impl = impl_from_IPropertyValue( iface );
+    return InterlockedIncrement( &impl->ref );
+}
+
+static ULONG WINAPI test_value_Release( IPropertyValue *iface )
+{
+    struct test_value *impl = impl_from_IPropertyValue( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+
+    if (!ref)
+    {
+        WindowsDeleteString( impl->string );
+        free( impl );
+    }
+    return ref;
+}
+
+static HRESULT WINAPI test_value_GetIids( IPropertyValue *iface, ULONG *iid_count, IID **iids )
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI test_value_GetRuntimeClassName( IPropertyValue *iface, HSTRING *class_name )
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI test_value_GetTrustLevel( IPropertyValue *iface, TrustLevel *trust_level )
+{
+    *trust_level = BaseTrust;
+    return S_OK;
+}
+
+static HRESULT WINAPI test_value_get_Type( IPropertyValue *iface, PropertyType *value )
+{
+    *value = impl_from_IPropertyValue( iface )->type;
+    return S_OK;
+}
+
+static HRESULT WINAPI test_value_get_IsNumericScalar( IPropertyValue *iface, boolean *value )
+{
+    *value = impl_from_IPropertyValue( iface )->type == PropertyType_Int32;
+    return S_OK;
+}
+
+static HRESULT WINAPI test_value_GetInt32( IPropertyValue *iface, INT32 *value )
+{
+    struct test_value *impl = impl_from_IPropertyValue( iface );
+
+    if (impl->type != PropertyType_Int32) return TYPE_E_TYPEMISMATCH;
+    *value = impl->int32;
+    return S_OK;
+}
+
+static HRESULT WINAPI test_value_GetString( IPropertyValue *iface, HSTRING *value )
+{
+    struct test_value *impl = impl_from_IPropertyValue( iface );
+
+    if (impl->type != PropertyType_String) return TYPE_E_TYPEMISMATCH;
+    return WindowsDuplicateString( impl->string, value );
+}
+
+#define DEFINE_TEST_VALUE_GET( name, type ) \
+    static HRESULT WINAPI test_value_Get##name( IPropertyValue *iface, type *value ) \
+    { \
+        return TYPE_E_TYPEMISMATCH; \
+    }
+#define DEFINE_TEST_VALUE_GET_ARRAY( name, type ) \
+    static HRESULT WINAPI test_value_Get##name##Array( IPropertyValue *iface, UINT32 *size, type **value ) \
+    { \
+        return TYPE_E_TYPEMISMATCH; \
+    }
+
+DEFINE_TEST_VALUE_GET( UInt8, BYTE )
+DEFINE_TEST_VALUE_GET( Int16, INT16 )
+DEFINE_TEST_VALUE_GET( UInt16, UINT16 )
+DEFINE_TEST_VALUE_GET( UInt32, UINT32 )
+DEFINE_TEST_VALUE_GET( Int64, INT64 )
+DEFINE_TEST_VALUE_GET( UInt64, UINT64 )
+DEFINE_TEST_VALUE_GET( Single, FLOAT )
+DEFINE_TEST_VALUE_GET( Double, DOUBLE )
+DEFINE_TEST_VALUE_GET( Char16, WCHAR )
+DEFINE_TEST_VALUE_GET( Boolean, boolean )
+DEFINE_TEST_VALUE_GET( Guid, GUID )
+DEFINE_TEST_VALUE_GET( DateTime, DateTime )
+DEFINE_TEST_VALUE_GET( TimeSpan, TimeSpan )
+DEFINE_TEST_VALUE_GET( Point, Point )
+DEFINE_TEST_VALUE_GET( Size, Size )
+DEFINE_TEST_VALUE_GET( Rect, Rect )
+DEFINE_TEST_VALUE_GET_ARRAY( UInt8, BYTE )
+DEFINE_TEST_VALUE_GET_ARRAY( Int16, INT16 )
+DEFINE_TEST_VALUE_GET_ARRAY( UInt16, UINT16 )
+DEFINE_TEST_VALUE_GET_ARRAY( Int32, INT32 )
+DEFINE_TEST_VALUE_GET_ARRAY( UInt32, UINT32 )
+DEFINE_TEST_VALUE_GET_ARRAY( Int64, INT64 )
+DEFINE_TEST_VALUE_GET_ARRAY( UInt64, UINT64 )
+DEFINE_TEST_VALUE_GET_ARRAY( Single, FLOAT )
+DEFINE_TEST_VALUE_GET_ARRAY( Double, DOUBLE )
+DEFINE_TEST_VALUE_GET_ARRAY( Char16, WCHAR )
+DEFINE_TEST_VALUE_GET_ARRAY( Boolean, boolean )
+DEFINE_TEST_VALUE_GET_ARRAY( String, HSTRING )
+DEFINE_TEST_VALUE_GET_ARRAY( Inspectable, IInspectable * )
+DEFINE_TEST_VALUE_GET_ARRAY( Guid, GUID )
+DEFINE_TEST_VALUE_GET_ARRAY( DateTime, DateTime )
+DEFINE_TEST_VALUE_GET_ARRAY( TimeSpan, TimeSpan )
+DEFINE_TEST_VALUE_GET_ARRAY( Point, Point )
+DEFINE_TEST_VALUE_GET_ARRAY( Size, Size )
+DEFINE_TEST_VALUE_GET_ARRAY( Rect, Rect )
+
+#undef DEFINE_TEST_VALUE_GET
+#undef DEFINE_TEST_VALUE_GET_ARRAY
+
+static const IPropertyValueVtbl test_value_vtbl =
+{
+    test_value_QueryInterface,
+    test_value_AddRef,
+    test_value_Release,
+    /* IInspectable methods */
+    test_value_GetIids,
+    test_value_GetRuntimeClassName,
+    test_value_GetTrustLevel,
+    /* IPropertyValue methods */
+    test_value_get_Type,
+    test_value_get_IsNumericScalar,
+    test_value_GetUInt8,
+    test_value_GetInt16,
+    test_value_GetUInt16,
+    test_value_GetInt32,
+    test_value_GetUInt32,
+    test_value_GetInt64,
+    test_value_GetUInt64,
+    test_value_GetSingle,
+    test_value_GetDouble,
+    test_value_GetChar16,
+    test_value_GetBoolean,
+    test_value_GetString,
+    test_value_GetGuid,
+    test_value_GetDateTime,
+    test_value_GetTimeSpan,
+    test_value_GetPoint,
+    test_value_GetSize,
+    test_value_GetRect,
+    test_value_GetUInt8Array,
+    test_value_GetInt16Array,
+    test_value_GetUInt16Array,
+    test_value_GetInt32Array,
+    test_value_GetUInt32Array,
+    test_value_GetInt64Array,
+    test_value_GetUInt64Array,
+    test_value_GetSingleArray,
+    test_value_GetDoubleArray,
+    test_value_GetChar16Array,
+    test_value_GetBooleanArray,
+    test_value_GetStringArray,
+    test_value_GetInspectableArray,
+    test_value_GetGuidArray,
+    test_value_GetDateTimeArray,
+    test_value_GetTimeSpanArray,
+    test_value_GetPointArray,
+    test_value_GetSizeArray,
+    test_value_GetRectArray,
+};
+
+static IInspectable *create_int32_value( INT32 int32 )
+{
+    struct test_value *impl = calloc( 1, sizeof(*impl) );
+
+    impl->IPropertyValue_iface.lpVtbl = &test_value_vtbl;
+    impl->ref = 1;
+    impl->type = PropertyType_Int32;
+    impl->int32 = int32;
+    return (IInspectable *)&impl->IPropertyValue_iface;
+}
+
+static IInspectable *create_string_value( const WCHAR *str )
+{
+    struct test_value *impl = calloc( 1, sizeof(*impl) );
+
+    impl->IPropertyValue_iface.lpVtbl = &test_value_vtbl;
+    impl->ref = 1;
+    impl->type = PropertyType_String;
+    WindowsCreateString( str, wcslen( str ), &impl->string );
+    return (IInspectable *)&impl->IPropertyValue_iface;
+}
+
+#define check_int32_value( value, expect ) check_int32_value_( __LINE__, value, expect )
+static void check_int32_value_( unsigned int line, IInspectable *inspectable, INT32 expect )
+{
+    IPropertyValue *value;
+    PropertyType type;
+    INT32 int32;
+    HRESULT hr;
+
+    hr = IInspectable_QueryInterface( inspectable, &IID_IPropertyValue, (void **)&value );
+    ok_(__FILE__, line)( hr == S_OK, "got hr %#lx.\n", hr );
+    if (FAILED(hr)) return;
+    hr = IPropertyValue_get_Type( value, &type );
+    ok_(__FILE__, line)( hr == S_OK, "got hr %#lx.\n", hr );
+    ok_(__FILE__, line)( type == PropertyType_Int32, "got type %u.\n", type );
+    hr = IPropertyValue_GetInt32( value, &int32 );
+    ok_(__FILE__, line)( hr == S_OK, "got hr %#lx.\n", hr );
+    ok_(__FILE__, line)( int32 == expect, "got %d.\n", int32 );
+    IPropertyValue_Release( value );
+}
+
+static IApplicationData *get_current_application_data(void)
+{
+    static const WCHAR *application_data_statics_name = L"Windows.Storage.ApplicationData";
+    IApplicationDataStatics *application_data_statics;
+    IApplicationData *application_data = NULL;
+    IActivationFactory *factory;
+    HSTRING str;
+    HRESULT hr;
+
+    hr = WindowsCreateString( application_data_statics_name, wcslen( application_data_statics_name ), &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = RoGetActivationFactory( str, &IID_IActivationFactory, (void **)&factory );
+    WindowsDeleteString( str );
+    if (hr == REGDB_E_CLASSNOTREG)
+    {
+        win_skip( "%s runtimeclass not registered, skipping tests.\n", wine_dbgstr_w( application_data_statics_name ) );
+        return NULL;
+    }
+
+    hr = IActivationFactory_QueryInterface( factory, &IID_IApplicationDataStatics, (void **)&application_data_statics );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IApplicationDataStatics_get_Current( application_data_statics, &application_data );
+    IApplicationDataStatics_Release( application_data_statics );
+    IActivationFactory_Release( factory );
+    /* Windows only has application data for packaged processes */
+    if (!application_data) win_skip( "not running in a package, skipping settings tests.\n" );
+    return application_data;
+}
+
+static IMap_HSTRING_IInspectable *get_local_settings( IApplicationData *application_data )
+{
+    IApplicationDataContainer *container;
+    IMap_HSTRING_IInspectable *map;
+    IPropertySet *values;
+    HRESULT hr;
+
+    hr = IApplicationData_get_LocalSettings( application_data, &container );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IApplicationDataContainer_get_Values( container, &values );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IApplicationDataContainer_Release( container );
+    hr = IPropertySet_QueryInterface( values, &IID_IMap_HSTRING_IInspectable, (void **)&map );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IPropertySet_Release( values );
+    return map;
+}
+
 static void test_ApplicationDataStatics(void)
 {
     static const WCHAR *application_data_statics_name = L"Windows.Storage.ApplicationData";
@@ -87,14 +371,206 @@ static void test_ApplicationDataStatics(void)
     ok( ref == 1, "got ref %ld.\n", ref );
 }
 
+/* the child changes the settings and exits right away, before the delayed write */
+static void write_settings_and_exit(void)
+{
+    IMap_HSTRING_IInspectable *map;
+    IApplicationData *application_data;
+    IInspectable *value;
+    boolean replaced;
+    HSTRING key;
+    HRESULT hr;
+
+    if (!(application_data = get_current_application_data())) return;
+    map = get_local_settings( application_data );
+
+    WindowsCreateString( L"persistent", 10, &key );
+    value = create_int32_value( 42 );
+    hr = IMap_HSTRING_IInspectable_Insert( map, key, value, &replaced );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IInspectable_Release( value );
+    WindowsDeleteString( key );
+
+    IMap_HSTRING_IInspectable_Release( map );
+    IApplicationData_Release( application_data );
+}
+
+static void test_settings_persistence( const char *argv0 )
+{
+    IMap_HSTRING_IInspectable *map;
+    IApplicationData *application_data;
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup = {.cb = sizeof(startup)};
+    IInspectable *value;
+    char cmdline[MAX_PATH * 2];
+    HSTRING key;
+    HRESULT hr;
+    BOOL ret;
+
+    if (!(application_data = get_current_application_data())) return;
+
+    /* this must run before the settings are loaded in this process */
+    sprintf( cmdline, "\"%s\" data write_settings", argv0 );
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info );
+    ok( ret, "CreateProcessA failed, error %lu.\n", GetLastError() );
+    wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+
+    map = get_local_settings( application_data );
+    WindowsCreateString( L"persistent", 10, &key );
+    hr = IMap_HSTRING_IInspectable_Lookup( map, key, &value );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    if (hr == S_OK)
+    {
+        check_int32_value( value, 42 );
+        IInspectable_Release( value );
+    }
+    hr = IMap_HSTRING_IInspectable_Remove( map, key );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    WindowsDeleteString( key );
+
+    IMap_HSTRING_IInspectable_Release( map );
+    IApplicationData_Release( application_data );
+}
+
+static void test_ApplicationDataSettings(void)
+{
+    IMap_HSTRING_IInspectable *map, *map2;
+    IApplicationDataContainer *container;
+    IApplicationData *application_data;
+    IInspectable *value, *value2;
+    IPropertySet *values;
+    unsigned int i, size;
+    boolean found, replaced;
+    WCHAR buffer[32];
+    HSTRING str, key;
+    HRESULT hr;
+
+    if (!(application_data = get_current_application_data())) return;
+
+    hr = IApplicationData_get_LocalSettings( application_data, &container );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IApplicationDataContainer_get_Values( container, &values );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    check_interface( values, &IID_IObservableMap_HSTRING_IInspectable );
+    check_interface( values, &IID_IIterable_IKeyValuePair_HSTRING_IInspectable );
+    hr = IPropertySet_QueryInterface( values, &IID_IMap_HSTRING_IInspectable, (void **)&map );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IPropertySet_Release( values );
+    IApplicationDataContainer_Release( container );
+
+    hr = IMap_HSTRING_IInspectable_Clear( map );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+
+    WindowsCreateString( L"key", 3, &key );
+    hr = IMap_HSTRING_IInspectable_HasKey( map, key, &found );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( !found, "got found %u.\n", found );
+    value = (IInspectable *)0xdeadbeef;
+    hr = IMap_HSTRING_IInspectable_Lookup( map, key, &value );
+    ok( hr == E_BOUNDS, "got hr %#lx.\n", hr );
+    ok( !value, "got value %p.\n", value );
+    hr = IMap_HSTRING_IInspectable_Remove( map, key );
+    ok( hr == E_BOUNDS, "got hr %#lx.\n", hr );
+
+    replaced = TRUE;
+    value = create_string_value( L"string" );
+    hr = IMap_HSTRING_IInspectable_Insert( map, key, value, &replaced );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( !replaced, "got replaced %u.\n", replaced );
+    IInspectable_Release( value );
+    value = create_int32_value( 1234 );
+    hr = IMap_HSTRING_IInspectable_Insert( map, key, value, &replaced );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( replaced, "got replaced %u.\n", replaced );
+    IInspectable_Release( value );
+    hr = IMap_HSTRING_IInspectable_Lookup( map, key, &value );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    check_int32_value( value, 1234 );
+    IInspectable_Release( value );
+
+    /* many values, removing every other one */
+    for (i = 0; i < 200; i++)
+    {
+        swprintf( buffer, ARRAY_SIZE(buffer), L"value%u", i );
+        WindowsCreateString( buffer, wcslen( buffer ), &str );
+        value = create_int32_value( i );
+        hr = IMap_HSTRING_IInspectable_Insert( map, str, value, &replaced );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        IInspectable_Release( value );
+        if (i % 2)
+        {
+            hr = IMap_HSTRING_IInspectable_Remove( map, str );
+            ok( hr == S_OK, "got hr %#lx.\n", hr );
+        }
+        WindowsDeleteString( str );
+    }
+    hr = IMap_HSTRING_IInspectable_get_Size( map, &size );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( size == 101, "got size %u.\n", size );
+
+    /* the values are shared by all the instances of the container */
+    map2 = get_local_settings( application_data );
+
+    for (i = 0; i < 200; i++)
+    {
+        swprintf( buffer, ARRAY_SIZE(buffer), L"value%u", i );
+        WindowsCreateString( buffer, wcslen( buffer ), &str );
+        hr = IMap_HSTRING_IInspectable_HasKey( map2, str, &found );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        ok( found == !(i % 2), "%u: got found %u.\n", i, found );
+        if (found && !(i % 50))
+        {
+            hr = IMap_HSTRING_IInspectable_Lookup( map2, str, &value2 );
+            ok( hr == S_OK, "got hr %#lx.\n", hr );
+            check_int32_value( value2, i );
+            IInspectable_Release( value2 );
+        }
+        WindowsDeleteString( str );
+    }
+    hr = IMap_HSTRING_IInspectable_HasKey( map2, key, &found );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( found, "got found %u.\n", found );
+
+    hr = IMap_HSTRING_IInspectable_Remove( map2, key );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IMap_HSTRING_IInspectable_HasKey( map, key, &found );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( !found, "got found %u.\n", found );
+
+    hr = IMap_HSTRING_IInspectable_Clear( map2 );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IMap_HSTRING_IInspectable_get_Size( map, &size );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( !size, "got size %u.\n", size );
+
+    WindowsDeleteString( key );
+    IMap_HSTRING_IInspectable_Release( map2 );
+    IMap_HSTRING_IInspectable_Release( map );
+    IApplicationData_Release( application_data );
+}
+
 START_TEST(data)
 {
+    char **argv;
     HRESULT hr;
+    int argc;
 
     hr = RoInitialize( RO_INIT_MULTITHREADED );
     ok( hr == S_OK, "RoInitialize failed, hr %#lx\n", hr );
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 3 && !strcmp( argv[2], "write_settings" ))
+    {
+        write_settings_and_exit();
+        /* exit without uninitializing, with the write still pending */
+        return;
+    }
+
     test_ApplicationDataStatics();
+    test_settings_persistence( argv[0] );
+    test_ApplicationDataSettings();
 
     RoUninitialize();
 }
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+#define COBJMACROS
+#include "initguid.h"
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "winstring.h"
+
+#include "roapi.h"
+
+#define WIDL_using_Windows_Foundation
+#define WIDL_using_Windows_Foundation_Collections
+#include "windows.foundation.h"
+#define WIDL_using_Windows_Storage_Streams
+#include "windows.storage.streams.h"
+
+#include "wine/test.h"
+
+#define check_interface( obj, iid ) check_interface_( __LINE__, obj, iid )
+static void check_interface_( unsigned int line, void *obj, const IID *iid )
+{
+    IUnknown *iface = obj;
+    IUnknown *unk;
+    HRESULT hr;
+
+    hr = IUnknown_QueryInterface( iface, iid, (void **)&unk );
+    ok_(__FILE__, line)( hr == S_OK, "got hr %#lx.\n", hr );
+    IUnknown_Release( unk );
+}
+
+static HRESULT get_factory( const WCHAR *name, IActivationFactory **factory )
+{
+    HSTRING str;
+    HRESULT hr;
+
+    hr = WindowsCreateString( name, wcslen( name ), &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = RoGetActivationFactory( str, &IID_IActivationFactory, (void **)factory );
+    WindowsDeleteString( str );
+    return hr;
+}
+
+static BYTE *get_buffer_bytes( IBuffer *buffer )
+{
+    IBufferByteAccess *byte_access;
+    BYTE *data = NULL;
+    HRESULT hr;
+
+    hr = IBuffer_QueryInterface( buffer, &IID_IBufferByteAccess, (void **)&byte_access );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IBufferByteAccess_get_Buffer( byte_access, &data );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IBufferByteAccess_Release( byte_access );
+    return data;
+}
+
+static void test_DataWriterReader(void)
+{
+    static const BYTE expect[] =
+    {
+        0x78, 0x56, 0x34, 0x12,
+        0x12, 0x34, 0x56, 0x78,
+        0x01,
+        'h', 'e', 'l', 'l', 'o',
+        0x00, 'h', 0x00, 'i',
+    };
+    IActivationFactory *writer_factory, *reader_factory;
+    IDataReaderStatics *reader_statics;
+    IBuffer *buffer, *view;
+    IDataWriter *writer;
+    IDataReader *reader;
+    BYTE *data, bytes[4];
+    UINT32 value, length, i;
+    boolean boolean_value;
+    const WCHAR *str;
+    HSTRING hstr;
+    HRESULT hr;
+
+    hr = get_factory( L"Windows.Storage.Streams.DataWriter", &writer_factory );
+    ok( hr == S_OK || broken( hr == REGDB_E_CLASSNOTREG ), "got hr %#lx.\n", hr );
+    if (hr == REGDB_E_CLASSNOTREG)
+    {
+        win_skip( "DataWriter runtimeclass not registered, skipping tests.\n" );
+        return;
+    }
+    hr = get_factory( L"Windows.Storage.Streams.DataReader", &reader_factory );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+
+    check_interface( writer_factory, &IID_IDataWriterFactory );
+    check_interface( reader_factory, &IID_IDataReaderFactory );
+
+    hr = IActivationFactory_ActivateInstance( writer_factory, (IInspectable **)&writer );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    check_interface( writer, &IID_IDataWriter );
+    check_interface( writer, &IID_IClosable );
+
+    hr = IDataWriter_WriteUInt32( writer, 0x12345678 );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IDataWriter_put_ByteOrder( writer, ByteOrder_BigEndian );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IDataWriter_WriteUInt32( writer, 0x12345678 );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IDataWriter_WriteBoolean( writer, TRUE );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+
+    WindowsCreateString( L"hello", 5, &hstr );
+    hr = IDataWriter_WriteString( writer, hstr, &length );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( length == 5, "got length %u.\n", length );
+    WindowsDeleteString( hstr );
+
+    hr = IDataWriter_put_UnicodeEncoding( writer, UnicodeEncoding_Utf16BE );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    WindowsCreateString( L"hi", 2, &hstr );
+    hr = IDataWriter_MeasureString( writer, hstr, &length );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( length == 2, "got length %u.\n", length );
+    hr = IDataWriter_WriteString( writer, hstr, &length );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( length == 2, "got length %u.\n", length );
+    WindowsDeleteString( hstr );
+
+    hr = IDataWriter_get_UnstoredBufferLength( writer, &length );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( length == sizeof(expect), "got length %u.\n", length );
+
+    hr = IDataWriter_DetachBuffer( writer, &buffer );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IDataWriter_get_UnstoredBufferLength( writer, &length );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( length == 0, "got length %u.\n", length );
+    IDataWriter_Release( writer );
+
+    hr = IBuffer_get_Length( buffer, &length );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( length == sizeof(expect), "got length %u.\n", length );
+    data = get_buffer_bytes( buffer );
+    ok( !memcmp( data, expect, sizeof(expect) ), "unexpected data.\n" );
+
+    hr = IActivationFactory_QueryInterface( reader_factory, &IID_IDataReaderStatics, (void **)&reader_statics );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IDataReaderStatics_FromBuffer( reader_statics, buffer, &reader );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IDataReaderStatics_Release( reader_statics );
+    check_interface( reader, &IID_IClosable );
+
+    hr = IDataReader_get_UnconsumedBufferLength( reader, &length );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( length == sizeof(expect), "got length %u.\n", length );
+
+    hr = IDataReader_ReadUInt32( reader, &value );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( value == 0x12345678, "got value %#x.\n", value );
+    hr = IDataReader_put_ByteOrder( reader, ByteOrder_BigEndian );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IDataReader_ReadUInt32( reader, &value );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( value == 0x12345678, "got value %#x.\n", value );
+    hr = IDataReader_ReadBoolean( reader, &boolean_value );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( boolean_value == TRUE, "got value %d.\n", boolean_value );
+
+    hr = IDataReader_ReadString( reader, 5, &hstr );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    str = WindowsGetStringRawBuffer( hstr, &length );
+    ok( length == 5 && !wcscmp( str, L"hello" ), "got string %s.\n", debugstr_w( str ) );
+    WindowsDeleteString( hstr );
+
+    hr = IDataReader_ReadBuffer( reader, 4, &view );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IBuffer_get_Length( view, &length );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( length == 4, "got length %u.\n", length );
+    ok( !memcmp( get_buffer_bytes( view ), data + 14, 4 ), "unexpected data.\n" );
+    IBuffer_Release( view );
+
+    hr = IDataReader_get_UnconsumedBufferLength( reader, &length );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( length == 0, "got length %u.\n", length );
+    hr = IDataReader_ReadBytes( reader, sizeof(bytes), bytes );
+    ok( hr == E_BOUNDS, "got hr %#lx.\n", hr );
+    hr = IDataReader_ReadByte( reader, bytes );
+    ok( hr == E_BOUNDS, "got hr %#lx.\n", hr );
+    IDataReader_Release( reader );
+
+    /* many small reads over a larger buffer */
+    hr = IActivationFactory_ActivateInstance( writer_factory, (IInspectable **)&writer );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    for (i = 0; i < 100000; i++)
+    {
+        hr = IDataWriter_WriteUInt32( writer, i );
+        if (hr != S_OK) break;
+    }
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IBuffer_Release( buffer );
+    hr = IDataWriter_DetachBuffer( writer, &buffer );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IDataWriter_Release( writer );
+
+    hr = IActivationFactory_QueryInterface( reader_factory, &IID_IDataReaderStatics, (void **)&reader_statics );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IDataReaderStatics_FromBuffer( reader_statics, buffer, &reader );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IDataReaderStatics_Release( reader_statics );
+    for (i = 0; i < 100000; i++)
+    {
+        hr = IDataReader_ReadUInt32( reader, &value );
+        if (hr != S_OK || value != i) break;
+    }
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( i == 100000, "got %u values.\n", i );
+    IDataReader_Release( reader );
+    IBuffer_Release( buffer );
+
+    IActivationFactory_Release( reader_factory );
+    IActivationFactory_Release( writer_factory );
+}
+
+START_TEST(streams)
+{
+    HRESULT hr;
+
+    hr = RoInitialize( RO_INIT_MULTITHREADED );
+    ok( hr == S_OK, "RoInitialize failed, hr %#lx\n", hr );
+
+    test_DataWriterReader();
+
+    RoUninitialize();
+}
@@ -232,7 +232,7 @@ static const struct IJumpListVtbl jumplist_vtbl =
     jumplist_SaveAsync,
 };
 
-static HRESULT create_stub_jumplist_async( IInspectable *invoker, IInspectable **result )
+static HRESULT WINAPI create_stub_jumplist_async( IUnknown *invoker, IUnknown *param, IInspectable **result )
 {
     struct jumplist *impl;
 
@@ -256,7 +256,8 @@ DEFINE_IINSPECTABLE( jumplistsstatics, IJumpListStatics, struct jumplist_statics
 static HRESULT WINAPI jumplistsstatics_LoadCurrentAsync( IJumpListStatics *iface, IAsyncOperation_JumpList **result )
 {
     FIXME( "iface %p, result %p semi-stub!\n", iface, result );
-    return async_operation_inspectable_create(&IID_IAsyncOperation_JumpList, NULL, create_stub_jumplist_async, (IAsyncOperation_IInspectable **)result);
+    return async_operation_inspectable_create(&IID_IAsyncOperation_JumpList, NULL, NULL, create_stub_jumplist_async,
+                                              ASYNC_RUN_INLINE, (IAsyncOperation_IInspectable **)result);
 }
 
 static HRESULT WINAPI jumplistsstatics_IsSupported( IJumpListStatics *iface, boolean *result )
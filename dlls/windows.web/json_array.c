@@ -0,0 +1,779 @@
+/* WinRT Windows.Data.Json.JsonArray Implementation
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "private.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(web);
+
+struct json_element
+{
+    UINT32 node;
+    IJsonValue *value;  /* created on first access */
+};
+
+struct json_array
+{
+    IJsonArray IJsonArray_iface;
+    IJsonValue IJsonValue_iface;
+    IVector_IJsonValue IVector_IJsonValue_iface;
+    LONG ref;
+
+    SRWLOCK lock;
+    struct json_document *document;
+    struct json_element *elements;
+    UINT32 count;
+    UINT32 capacity;
+};
+
+static HRESULT get_element_value( struct json_array *impl, struct json_element *element, IJsonValue **value )
+{
+    IJsonValue *created;
+    HRESULT hr;
+
+    if (!element->value)
+    {
+        if (FAILED(hr = json_value_create( impl->document, element->node, &created ))) return hr;
+        if (InterlockedCompareExchangePointer( (void **)&element->value, created, NULL )) IJsonValue_Release( created );
+    }
+    IJsonValue_AddRef( (*value = element->value) );
+    return S_OK;
+}
+
+static HRESULT get_value_at( struct json_array *impl, UINT32 index, IJsonValue **value )
+{
+    HRESULT hr;
+
+    AcquireSRWLockShared( &impl->lock );
+    if (index >= impl->count) hr = E_BOUNDS;
+    else hr = get_element_value( impl, &impl->elements[index], value );
+    ReleaseSRWLockShared( &impl->lock );
+    return hr;
+}
+
+/* scalar elements that weren't accessed as values yet are read directly from the document */
+static HRESULT get_node_at( struct json_array *impl, UINT32 index, JsonValueType type,
+                            const struct json_node **node, IJsonValue **value )
+{
+    struct json_element *element;
+    HRESULT hr = S_OK;
+
+    *node = NULL;
+    *value = NULL;
+
+    AcquireSRWLockShared( &impl->lock );
+    if (index >= impl->count) hr = E_BOUNDS;
+    else if ((element = &impl->elements[index])->value) IJsonValue_AddRef( (*value = element->value) );
+    else if (impl->document->nodes[element->node].type != type) hr = E_ILLEGAL_METHOD_CALL;
+    else *node = &impl->document->nodes[element->node];
+    ReleaseSRWLockShared( &impl->lock );
+    return hr;
+}
+
+static BOOL reserve_elements( struct json_array *impl, UINT32 count )
+{
+    struct json_element *elements;
+    UINT32 capacity;
+
+    if (count <= impl->capacity) return TRUE;
+    capacity = max( max( impl->capacity * 2, count ), 4 );
+    if (!(elements = realloc( impl->elements, capacity * sizeof(*elements) ))) return FALSE;
+    impl->elements = elements;
+    impl->capacity = capacity;
+    return TRUE;
+}
+
+static inline struct json_array *impl_from_IJsonArray( IJsonArray *iface )
+{
+    return CONTAINING_RECORD( iface, struct json_array, IJsonArray_iface );
+}
+
+static HRESULT WINAPI json_array_QueryInterface( IJsonArray *iface, REFIID iid, void **out )
+{
+    struct json_array *impl = impl_from_IJsonArray( iface );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IJsonArray ))
+    {
+        *out = &impl->IJsonArray_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    if (IsEqualGUID( iid, &IID_IJsonValue ))
+    {
+        *out = &impl->IJsonValue_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    if (IsEqualGUID( iid, &IID_IVector_IJsonValue ))
+    {
+        *out = &impl->IVector_IJsonValue_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI json_array_AddRef( IJsonArray *iface )
+{
+    struct json_array *impl = impl_from_IJsonArray( iface );
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "iface %p, ref %lu.\n", iface, ref );
+    return ref;
+}
+
+static ULONG WINAPI json_array_Release( IJsonArray *iface )
+{
+    struct json_array *impl = impl_from_IJsonArray( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+    UINT32 i;
+
+    TRACE( "iface %p, ref %lu.\n", iface, ref );
+
+    if (!ref)
+    {
+        for (i = 0; i < impl->count; i++) if (impl->elements[i].value) IJsonValue_Release( impl->elements[i].value );
+        free( impl->elements );
+        if (impl->document) json_document_release( impl->document );
+        free( impl );
+    }
+    return ref;
+}
+
+static HRESULT WINAPI json_array_GetIids( IJsonArray *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI json_array_GetRuntimeClassName( IJsonArray *iface, HSTRING *class_name )
+{
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI json_array_GetTrustLevel( IJsonArray *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI json_array_GetObjectAt( IJsonArray *iface, UINT32 index, IJsonObject **value )
+{
+    struct json_array *impl = impl_from_IJsonArray( iface );
+    IJsonValue *element;
+    HRESULT hr;
+
+    TRACE( "iface %p, index %u, value %p.\n", iface, index, value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = get_value_at( impl, index, &element ))) return hr;
+    hr = IJsonValue_GetObject( element, value );
+    IJsonValue_Release( element );
+    return hr;
+}
+
+static HRESULT WINAPI json_array_GetArrayAt( IJsonArray *iface, UINT32 index, IJsonArray **value )
+{
+    struct json_array *impl = impl_from_IJsonArray( iface );
+    IJsonValue *element;
+    HRESULT hr;
+
+    TRACE( "iface %p, index %u, value %p.\n", iface, index, value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = get_value_at( impl, index, &element ))) return hr;
+    hr = IJsonValue_GetArray( element, value );
+    IJsonValue_Release( element );
+    return hr;
+}
+
+static HRESULT WINAPI json_array_GetStringAt( IJsonArray *iface, UINT32 index, HSTRING *value )
+{
+    struct json_array *impl = impl_from_IJsonArray( iface );
+    const struct json_node *node;
+    IJsonValue *element;
+    HRESULT hr;
+
+    TRACE( "iface %p, index %u, value %p.\n", iface, index, value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = get_node_at( impl, index, JsonValueType_String, &node, &element ))) return hr;
+    if (node) return json_node_get_string( impl->document, node - impl->document->nodes, value );
+    hr = IJsonValue_GetString( element, value );
+    IJsonValue_Release( element );
+    return hr;
+}
+
+static HRESULT WINAPI json_array_GetNumberAt( IJsonArray *iface, UINT32 index, DOUBLE *value )
+{
+    struct json_array *impl = impl_from_IJsonArray( iface );
+    const struct json_node *node;
+    IJsonValue *element;
+    HRESULT hr;
+
+    TRACE( "iface %p, index %u, value %p.\n", iface, index, value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = get_node_at( impl, index, JsonValueType_Number, &node, &element ))) return hr;
+    if (node)
+    {
+        *value = node->u.number;
+        return S_OK;
+    }
+    hr = IJsonValue_GetNumber( element, value );
+    IJsonValue_Release( element );
+    return hr;
+}
+
+static HRESULT WINAPI json_array_GetBooleanAt( IJsonArray *iface, UINT32 index, boolean *value )
+{
+    struct json_array *impl = impl_from_IJsonArray( iface );
+    const struct json_node *node;
+    IJsonValue *element;
+    HRESULT hr;
+
+    TRACE( "iface %p, index %u, value %p.\n", iface, index, value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = get_node_at( impl, index, JsonValueType_Boolean, &node, &element ))) return hr;
+    if (node)
+    {
+        *value = node->u.boolean;
+        return S_OK;
+    }
+    hr = IJsonValue_GetBoolean( element, value );
+    IJsonValue_Release( element );
+    return hr;
+}
+
+static const struct IJsonArrayVtbl json_array_vtbl =
+{
+    json_array_QueryInterface,
+    json_array_AddRef,
+    json_array_Release,
+    /* IInspectable methods */
+    json_array_GetIids,
+    json_array_GetRuntimeClassName,
+    json_array_GetTrustLevel,
+    /* IJsonArray methods */
+    json_array_GetObjectAt,
+    json_array_GetArrayAt,
+    json_array_GetStringAt,
+    json_array_GetNumberAt,
+    json_array_GetBooleanAt,
+};
+
+DEFINE_IINSPECTABLE( json_array_value, IJsonValue, struct json_array, IJsonArray_iface )
+
+static HRESULT WINAPI json_array_value_get_ValueType( IJsonValue *iface, JsonValueType *value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = JsonValueType_Array;
+    return S_OK;
+}
+
+static void write_array( struct json_writer *writer, struct json_array *impl )
+{
+    struct json_element *element;
+
+    AcquireSRWLockShared( &impl->lock );
+    json_write_chars( writer, L"[", 1 );
+    for (element = impl->elements; element < impl->elements + impl->count; element++)
+    {
+        if (element != impl->elements) json_write_chars( writer, L",", 1 );
+        if (element->value) json_write_value( writer, element->value );
+        else json_write_node( writer, impl->document, element->node );
+    }
+    json_write_chars( writer, L"]", 1 );
+    ReleaseSRWLockShared( &impl->lock );
+}
+
+static HRESULT WINAPI json_array_value_Stringify( IJsonValue *iface, HSTRING *value )
+{
+    struct json_array *impl = impl_from_IJsonValue( iface );
+    struct json_writer writer = {0};
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    write_array( &writer, impl );
+    return json_writer_get_string( &writer, value );
+}
+
+static HRESULT WINAPI json_array_value_GetString( IJsonValue *iface, HSTRING *value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return value ? E_ILLEGAL_METHOD_CALL : E_POINTER;
+}
+
+static HRESULT WINAPI json_array_value_GetNumber( IJsonValue *iface, DOUBLE *value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return value ? E_ILLEGAL_METHOD_CALL : E_POINTER;
+}
+
+static HRESULT WINAPI json_array_value_GetBoolean( IJsonValue *iface, boolean *value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return value ? E_ILLEGAL_METHOD_CALL : E_POINTER;
+}
+
+static HRESULT WINAPI json_array_value_GetArray( IJsonValue *iface, IJsonArray **value )
+{
+    struct json_array *impl = impl_from_IJsonValue( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    IJsonArray_AddRef( (*value = &impl->IJsonArray_iface) );
+    return S_OK;
+}
+
+static HRESULT WINAPI json_array_value_GetObject( IJsonValue *iface, IJsonObject **value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return value ? E_ILLEGAL_METHOD_CALL : E_POINTER;
+}
+
+static const struct IJsonValueVtbl json_array_value_vtbl =
+{
+    json_array_value_QueryInterface,
+    json_array_value_AddRef,
+    json_array_value_Release,
+    /* IInspectable methods */
+    json_array_value_GetIids,
+    json_array_value_GetRuntimeClassName,
+    json_array_value_GetTrustLevel,
+    /* IJsonValue methods */
+    json_array_value_get_ValueType,
+    json_array_value_Stringify,
+    json_array_value_GetString,
+    json_array_value_GetNumber,
+    json_array_value_GetBoolean,
+    json_array_value_GetArray,
+    json_array_value_GetObject,
+};
+
+BOOL json_array_write( struct json_writer *writer, IJsonValue *value )
+{
+    if (value->lpVtbl != &json_array_value_vtbl) return FALSE;
+    write_array( writer, impl_from_IJsonValue( value ) );
+    return TRUE;
+}
+
+DEFINE_IINSPECTABLE( json_array_vector, IVector_IJsonValue, struct json_array, IJsonArray_iface )
+
+static HRESULT WINAPI json_array_vector_GetAt( IVector_IJsonValue *iface, UINT32 index, IJsonValue **value )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+
+    TRACE( "iface %p, index %u, value %p.\n", iface, index, value );
+
+    if (!value) return E_POINTER;
+    *value = NULL;
+    return get_value_at( impl, index, value );
+}
+
+static HRESULT WINAPI json_array_vector_get_Size( IVector_IJsonValue *iface, UINT32 *value )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    AcquireSRWLockShared( &impl->lock );
+    *value = impl->count;
+    ReleaseSRWLockShared( &impl->lock );
+    return S_OK;
+}
+
+static HRESULT WINAPI json_array_vector_GetView( IVector_IJsonValue *iface, IVectorView_IJsonValue **value )
+{
+    FIXME( "iface %p, value %p stub!\n", iface, value );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI json_array_vector_IndexOf( IVector_IJsonValue *iface, IJsonValue *element, UINT32 *index, BOOLEAN *found )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+    UINT32 i;
+
+    TRACE( "iface %p, element %p, index %p, found %p.\n", iface, element, index, found );
+
+    if (!index || !found) return E_POINTER;
+
+    /* values that weren't created yet can't be the element */
+    AcquireSRWLockShared( &impl->lock );
+    for (i = 0; i < impl->count; i++) if (impl->elements[i].value == element) break;
+    if ((*found = i < impl->count)) *index = i;
+    else *index = 0;
+    ReleaseSRWLockShared( &impl->lock );
+    return S_OK;
+}
+
+static HRESULT WINAPI json_array_vector_SetAt( IVector_IJsonValue *iface, UINT32 index, IJsonValue *value )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+    IJsonValue *old = NULL;
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, index %u, value %p.\n", iface, index, value );
+
+    if (!value) return E_POINTER;
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (index >= impl->count) hr = E_BOUNDS;
+    else
+    {
+        old = impl->elements[index].value;
+        IJsonValue_AddRef( (impl->elements[index].value = value) );
+    }
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    if (old) IJsonValue_Release( old );
+    return hr;
+}
+
+static HRESULT WINAPI json_array_vector_InsertAt( IVector_IJsonValue *iface, UINT32 index, IJsonValue *value )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+    struct json_element *element;
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, index %u, value %p.\n", iface, index, value );
+
+    if (!value) return E_POINTER;
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (index > impl->count) hr = E_BOUNDS;
+    else if (!reserve_elements( impl, impl->count + 1 )) hr = E_OUTOFMEMORY;
+    else
+    {
+        element = &impl->elements[index];
+        memmove( element + 1, element, (impl->count++ - index) * sizeof(*element) );
+        element->node = 0;
+        IJsonValue_AddRef( (element->value = value) );
+    }
+    ReleaseSRWLockExclusive( &impl->lock );
+    return hr;
+}
+
+static HRESULT WINAPI json_array_vector_RemoveAt( IVector_IJsonValue *iface, UINT32 index )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+    struct json_element *element;
+    IJsonValue *old = NULL;
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, index %u.\n", iface, index );
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (index >= impl->count) hr = E_BOUNDS;
+    else
+    {
+        element = &impl->elements[index];
+        old = element->value;
+        memmove( element, element + 1, (--impl->count - index) * sizeof(*element) );
+    }
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    if (old) IJsonValue_Release( old );
+    return hr;
+}
+
+static HRESULT WINAPI json_array_vector_Append( IVector_IJsonValue *iface, IJsonValue *value )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+    struct json_element *element;
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (!reserve_elements( impl, impl->count + 1 )) hr = E_OUTOFMEMORY;
+    else
+    {
+        element = &impl->elements[impl->count++];
+        element->node = 0;
+        IJsonValue_AddRef( (element->value = value) );
+    }
+    ReleaseSRWLockExclusive( &impl->lock );
+    return hr;
+}
+
+static HRESULT WINAPI json_array_vector_RemoveAtEnd( IVector_IJsonValue *iface )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+    IJsonValue *old = NULL;
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p.\n", iface );
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (!impl->count) hr = E_BOUNDS;
+    else old = impl->elements[--impl->count].value;
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    if (old) IJsonValue_Release( old );
+    return hr;
+}
+
+static void release_elements( struct json_element *elements, UINT32 count )
+{
+    UINT32 i;
+
+    for (i = 0; i < count; i++) if (elements[i].value) IJsonValue_Release( elements[i].value );
+    free( elements );
+}
+
+static HRESULT WINAPI json_array_vector_Clear( IVector_IJsonValue *iface )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+    struct json_element *elements;
+    UINT32 count;
+
+    TRACE( "iface %p.\n", iface );
+
+    AcquireSRWLockExclusive( &impl->lock );
+    elements = impl->elements;
+    count = impl->count;
+    impl->elements = NULL;
+    impl->count = impl->capacity = 0;
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    release_elements( elements, count );
+    return S_OK;
+}
+
+static HRESULT WINAPI json_array_vector_GetMany( IVector_IJsonValue *iface, UINT32 start_index,
+                                                 UINT32 items_size, IJsonValue **items, UINT32 *count )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+    HRESULT hr = S_OK;
+    UINT32 i;
+
+    TRACE( "iface %p, start_index %u, items_size %u, items %p, count %p.\n",
+           iface, start_index, items_size, items, count );
+
+    if (!count) return E_POINTER;
+
+    AcquireSRWLockShared( &impl->lock );
+    if (start_index > impl->count) hr = E_BOUNDS;
+    for (i = 0; SUCCEEDED(hr) && i < items_size && start_index + i < impl->count; i++)
+        hr = get_element_value( impl, &impl->elements[start_index + i], &items[i] );
+    ReleaseSRWLockShared( &impl->lock );
+
+    if (FAILED(hr)) while (i) IJsonValue_Release( items[--i] );
+    *count = i;
+    return hr;
+}
+
+static HRESULT WINAPI json_array_vector_ReplaceAll( IVector_IJsonValue *iface, UINT32 count, IJsonValue **items )
+{
+    struct json_array *impl = impl_from_IVector_IJsonValue( iface );
+    struct json_element *elements = NULL, *old;
+    UINT32 i, old_count;
+
+    TRACE( "iface %p, count %u, items %p.\n", iface, count, items );
+
+    for (i = 0; i < count; i++) if (!items[i]) return E_POINTER;
+    if (count && !(elements = malloc( count * sizeof(*elements) ))) return E_OUTOFMEMORY;
+
+    for (i = 0; i < count; i++)
+    {
+        elements[i].node = 0;
+        IJsonValue_AddRef( (elements[i].value = items[i]) );
+    }
+
+    AcquireSRWLockExclusive( &impl->lock );
+    old = impl->elements;
+    old_count = impl->count;
+    impl->elements = elements;
+    impl->count = impl->capacity = count;
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    release_elements( old, old_count );
+    return S_OK;
+}
+
+static const struct IVector_IJsonValueVtbl json_array_vector_vtbl =
+{
+    json_array_vector_QueryInterface,
+    json_array_vector_AddRef,
+    json_array_vector_Release,
+    /* IInspectable methods */
+    json_array_vector_GetIids,
+    json_array_vector_GetRuntimeClassName,
+    json_array_vector_GetTrustLevel,
+    /* IVector<IJsonValue *> methods */
+    json_array_vector_GetAt,
+    json_array_vector_get_Size,
+    json_array_vector_GetView,
+    json_array_vector_IndexOf,
+    json_array_vector_SetAt,
+    json_array_vector_InsertAt,
+    json_array_vector_RemoveAt,
+    json_array_vector_Append,
+    json_array_vector_RemoveAtEnd,
+    json_array_vector_Clear,
+    json_array_vector_GetMany,
+    json_array_vector_ReplaceAll,
+};
+
+HRESULT json_array_create( struct json_document *document, UINT32 index, IJsonArray **out )
+{
+    struct json_array *impl;
+    UINT32 i, node, count = 0;
+
+    if (!(impl = calloc( 1, sizeof(*impl) ))) return E_OUTOFMEMORY;
+    impl->IJsonArray_iface.lpVtbl = &json_array_vtbl;
+    impl->IJsonValue_iface.lpVtbl = &json_array_value_vtbl;
+    impl->IVector_IJsonValue_iface.lpVtbl = &json_array_vector_vtbl;
+    impl->ref = 1;
+    InitializeSRWLock( &impl->lock );
+
+    if (document)
+    {
+        InterlockedIncrement( &document->ref );
+        impl->document = document;
+        count = document->nodes[index].u.count;
+    }
+    if (count && !(impl->elements = calloc( count, sizeof(*impl->elements) )))
+    {
+        IJsonArray_Release( &impl->IJsonArray_iface );
+        return E_OUTOFMEMORY;
+    }
+    impl->count = impl->capacity = count;
+
+    for (i = 0, node = index + 1; i < count; i++, node = document->nodes[node].next)
+        impl->elements[i].node = node;
+
+    *out = &impl->IJsonArray_iface;
+    TRACE( "created IJsonArray %p.\n", *out );
+    return S_OK;
+}
+
+struct json_array_statics
+{
+    IActivationFactory IActivationFactory_iface;
+    LONG ref;
+};
+
+static inline struct json_array_statics *impl_from_IActivationFactory( IActivationFactory *iface )
+{
+    return CONTAINING_RECORD( iface, struct json_array_statics, IActivationFactory_iface );
+}
+
+static HRESULT WINAPI factory_QueryInterface( IActivationFactory *iface, REFIID iid, void **out )
+{
+    struct json_array_statics *impl = impl_from_IActivationFactory( iface );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IActivationFactory ))
+    {
+        *out = &impl->IActivationFactory_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI factory_AddRef( IActivationFactory *iface )
+{
+    struct json_array_statics *impl = impl_from_IActivationFactory( iface );
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "iface %p increasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static ULONG WINAPI factory_Release( IActivationFactory *iface )
+{
+    struct json_array_statics *impl = impl_from_IActivationFactory( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static HRESULT WINAPI factory_GetIids( IActivationFactory *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI factory_GetRuntimeClassName( IActivationFactory *iface, HSTRING *class_name )
+{
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI factory_GetTrustLevel( IActivationFactory *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI factory_ActivateInstance( IActivationFactory *iface, IInspectable **instance )
+{
+    TRACE( "iface %p, instance %p.\n", iface, instance );
+
+    *instance = NULL;
+    return json_array_create( NULL, 0, (IJsonArray **)instance );
+}
+
+static const struct IActivationFactoryVtbl factory_vtbl =
+{
+    factory_QueryInterface,
+    factory_AddRef,
+    factory_Release,
+    /* IInspectable methods */
+    factory_GetIids,
+    factory_GetRuntimeClassName,
+    factory_GetTrustLevel,
+    /* IActivationFactory methods */
+    factory_ActivateInstance,
+};
+
+static struct json_array_statics json_array_statics =
+{
+    {&factory_vtbl},
+    1,
+};
+
+IActivationFactory *json_array_factory = &json_array_statics.IActivationFactory_iface;
@@ -22,18 +22,179 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(web);
 
+/* objects with fewer members are searched linearly */
+#define JSON_OBJECT_INDEX_MIN  8
+
+struct json_member
+{
+    HSTRING name;       /* NULL if str points into the document */
+    const WCHAR *str;
+    UINT32 len;
+    UINT32 hash;
+    UINT32 node;
+    IJsonValue *value;  /* created on first access */
+};
+
 struct json_object
 {
     IJsonObject IJsonObject_iface;
+    IJsonValue IJsonValue_iface;
+    IMap_HSTRING_IJsonValue IMap_HSTRING_IJsonValue_iface;
     LONG ref;
+
+    SRWLOCK lock;
+    struct json_document *document;
+    struct json_member *members;
+    UINT32 count;
+    UINT32 capacity;
+    UINT32 *index;      /* open addressing table of member indexes + 1 */
+    UINT32 index_size;
 };
 
+static void rebuild_index( struct json_object *impl )
+{
+    UINT32 i, j, size = 16;
+
+    free( impl->index );
+    impl->index = NULL;
+    impl->index_size = 0;
+    if (impl->count < JSON_OBJECT_INDEX_MIN) return;
+
+    while (size < impl->count * 2) size *= 2;
+    if (!(impl->index = calloc( size, sizeof(*impl->index) ))) return;  /* fall back to linear search */
+    impl->index_size = size;
+
+    for (i = 0; i < impl->count; i++)
+    {
+        for (j = impl->members[i].hash & (size - 1); impl->index[j]; j = (j + 1) & (size - 1)) {}
+        impl->index[j] = i + 1;
+    }
+}
+
+static void index_member( struct json_object *impl, UINT32 member )
+{
+    UINT32 j, mask = impl->index_size - 1;
+
+    if (impl->count * 2 > impl->index_size) rebuild_index( impl );
+    else
+    {
+        for (j = impl->members[member].hash & mask; impl->index[j]; j = (j + 1) & mask) {}
+        impl->index[j] = member + 1;
+    }
+}
+
+static struct json_member *find_member( struct json_object *impl, const WCHAR *str, UINT32 len )
+{
+    UINT32 i, hash = json_hash_string( str, len ), mask = impl->index_size - 1;
+    struct json_member *member;
+
+    if (impl->index)
+    {
+        for (i = hash & mask; impl->index[i]; i = (i + 1) & mask)
+        {
+            member = &impl->members[impl->index[i] - 1];
+            if (member->hash == hash && member->len == len && !memcmp( member->str, str, len * sizeof(WCHAR) ))
+                return member;
+        }
+        return NULL;
+    }
+
+    for (member = impl->members; member < impl->members + impl->count; member++)
+        if (member->hash == hash && member->len == len && !memcmp( member->str, str, len * sizeof(WCHAR) ))
+            return member;
+    return NULL;
+}
+
+static struct json_member *add_member( struct json_object *impl )
+{
+    struct json_member *members;
+    UINT32 capacity;
+
+    if (impl->count == impl->capacity)
+    {
+        capacity = max( impl->capacity * 2, 4 );
+        if (!(members = realloc( impl->members, capacity * sizeof(*members) ))) return NULL;
+        impl->members = members;
+        impl->capacity = capacity;
+    }
+    memset( &impl->members[impl->count], 0, sizeof(*impl->members) );
+    return &impl->members[impl->count++];
+}
+
+static void free_member( struct json_member *member )
+{
+    WindowsDeleteString( member->name );
+    if (member->value) IJsonValue_Release( member->value );
+}
+
+static HRESULT get_member_value( struct json_object *impl, struct json_member *member, IJsonValue **value )
+{
+    IJsonValue *created;
+    HRESULT hr;
+
+    if (!member->value)
+    {
+        if (FAILED(hr = json_value_create( impl->document, member->node, &created ))) return hr;
+        if (InterlockedCompareExchangePointer( (void **)&member->value, created, NULL )) IJsonValue_Release( created );
+    }
+    IJsonValue_AddRef( (*value = member->value) );
+    return S_OK;
+}
+
+static HRESULT lookup_value( struct json_object *impl, HSTRING name, IJsonValue **value )
+{
+    struct json_member *member;
+    const WCHAR *str;
+    HRESULT hr;
+    UINT32 len;
+
+    str = WindowsGetStringRawBuffer( name, &len );
+    AcquireSRWLockShared( &impl->lock );
+    if (!(member = find_member( impl, str, len ))) hr = WEB_E_JSON_VALUE_NOT_FOUND;
+    else hr = get_member_value( impl, member, value );
+    ReleaseSRWLockShared( &impl->lock );
+    return hr;
+}
+
+static HRESULT insert_value( struct json_object *impl, HSTRING name, IJsonValue *value, boolean *replaced )
+{
+    struct json_member *member;
+    IJsonValue *old = NULL;
+    BOOL found = FALSE;
+    const WCHAR *str;
+    HRESULT hr = S_OK;
+    UINT32 len;
+
+    str = WindowsGetStringRawBuffer( name, &len );
+    AcquireSRWLockExclusive( &impl->lock );
+    if ((member = find_member( impl, str, len )))
+    {
+        found = TRUE;
+        old = member->value;
+        IJsonValue_AddRef( (member->value = value) );
+    }
+    else if (!(member = add_member( impl ))) hr = E_OUTOFMEMORY;
+    else if (FAILED(hr = WindowsDuplicateString( name, &member->name ))) impl->count--;
+    else
+    {
+        member->str = WindowsGetStringRawBuffer( member->name, &member->len );
+        member->hash = json_hash_string( member->str, member->len );
+        IJsonValue_AddRef( (member->value = value) );
+        index_member( impl, member - impl->members );
+    }
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    if (old) IJsonValue_Release( old );
+    if (replaced) *replaced = found;
+    return hr;
+}
+
 static inline struct json_object *impl_from_IJsonObject( IJsonObject *iface )
 {
     return CONTAINING_RECORD( iface, struct json_object, IJsonObject_iface );
 }
 
-static HRESULT WINAPI json_object_statics_QueryInterface( IJsonObject *iface, REFIID iid, void **out )
+static HRESULT WINAPI json_object_QueryInterface( IJsonObject *iface, REFIID iid, void **out )
 {
     struct json_object *impl = impl_from_IJsonObject( iface );
 
@@ -49,12 +210,26 @@ static HRESULT WINAPI json_object_statics_QueryInterface( IJsonObject *iface, RE
         return S_OK;
     }
 
+    if (IsEqualGUID( iid, &IID_IJsonValue ))
+    {
+        *out = &impl->IJsonValue_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    if (IsEqualGUID( iid, &IID_IMap_HSTRING_IJsonValue ))
+    {
+        *out = &impl->IMap_HSTRING_IJsonValue_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
     FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
     *out = NULL;
     return E_NOINTERFACE;
 }
 
-static ULONG WINAPI json_object_statics_AddRef( IJsonObject *iface )
+static ULONG WINAPI json_object_AddRef( IJsonObject *iface )
 {
     struct json_object *impl = impl_from_IJsonObject( iface );
     ULONG ref = InterlockedIncrement( &impl->ref );
@@ -62,99 +237,485 @@ static ULONG WINAPI json_object_statics_AddRef( IJsonObject *iface )
     return ref;
 }
 
-static ULONG WINAPI json_object_statics_Release( IJsonObject *iface )
+static ULONG WINAPI json_object_Release( IJsonObject *iface )
 {
     struct json_object *impl = impl_from_IJsonObject( iface );
     ULONG ref = InterlockedDecrement( &impl->ref );
+    UINT32 i;
 
     TRACE( "iface %p, ref %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        for (i = 0; i < impl->count; i++) free_member( &impl->members[i] );
+        free( impl->members );
+        free( impl->index );
+        if (impl->document) json_document_release( impl->document );
+        free( impl );
+    }
     return ref;
 }
 
-static HRESULT WINAPI json_object_statics_GetIids( IJsonObject *iface, ULONG *iid_count, IID **iids )
+static HRESULT WINAPI json_object_GetIids( IJsonObject *iface, ULONG *iid_count, IID **iids )
 {
     FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
     return E_NOTIMPL;
 }
 
-static HRESULT WINAPI json_object_statics_GetRuntimeClassName( IJsonObject *iface, HSTRING *class_name )
+static HRESULT WINAPI json_object_GetRuntimeClassName( IJsonObject *iface, HSTRING *class_name )
 {
     FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
     return E_NOTIMPL;
 }
 
-static HRESULT WINAPI json_object_statics_GetTrustLevel( IJsonObject *iface, TrustLevel *trust_level )
+static HRESULT WINAPI json_object_GetTrustLevel( IJsonObject *iface, TrustLevel *trust_level )
 {
     FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
     return E_NOTIMPL;
 }
 
-static HRESULT WINAPI json_object_statics_GetNamedValue( IJsonObject *iface, HSTRING name, IJsonValue **value )
+static HRESULT WINAPI json_object_GetNamedValue( IJsonObject *iface, HSTRING name, IJsonValue **value )
 {
-    FIXME( "iface %p, name %s, value %p stub!\n", iface, debugstr_hstring( name ), value );
-    return E_NOTIMPL;
+    struct json_object *impl = impl_from_IJsonObject( iface );
+
+    TRACE( "iface %p, name %s, value %p.\n", iface, debugstr_hstring( name ), value );
+
+    if (!value) return E_POINTER;
+    return lookup_value( impl, name, value );
 }
 
-static HRESULT WINAPI json_object_statics_SetNamedValue( IJsonObject *iface, HSTRING name, IJsonValue *value )
+static HRESULT WINAPI json_object_SetNamedValue( IJsonObject *iface, HSTRING name, IJsonValue *value )
 {
-    FIXME( "iface %p, name %s, value %p stub!\n", iface, debugstr_hstring( name ), value );
-    return E_NOTIMPL;
+    struct json_object *impl = impl_from_IJsonObject( iface );
+
+    TRACE( "iface %p, name %s, value %p.\n", iface, debugstr_hstring( name ), value );
+
+    if (!value) return E_POINTER;
+    return insert_value( impl, name, value, NULL );
 }
 
-static HRESULT WINAPI json_object_statics_GetNamedObject( IJsonObject *iface, HSTRING name, IJsonObject **value )
+static HRESULT WINAPI json_object_GetNamedObject( IJsonObject *iface, HSTRING name, IJsonObject **value )
 {
-    FIXME( "iface %p, name %s, value %p stub!\n", iface, debugstr_hstring( name ), value );
-    return E_NOTIMPL;
+    struct json_object *impl = impl_from_IJsonObject( iface );
+    IJsonValue *member;
+    HRESULT hr;
+
+    TRACE( "iface %p, name %s, value %p.\n", iface, debugstr_hstring( name ), value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = lookup_value( impl, name, &member ))) return hr;
+    hr = IJsonValue_GetObject( member, value );
+    IJsonValue_Release( member );
+    return hr;
 }
 
-static HRESULT WINAPI json_object_statics_GetNamedArray( IJsonObject *iface, HSTRING name, IJsonArray **value )
+static HRESULT WINAPI json_object_GetNamedArray( IJsonObject *iface, HSTRING name, IJsonArray **value )
 {
-    FIXME( "iface %p, name %s, value %p stub!\n", iface, debugstr_hstring( name ), value );
-    return E_NOTIMPL;
+    struct json_object *impl = impl_from_IJsonObject( iface );
+    IJsonValue *member;
+    HRESULT hr;
+
+    TRACE( "iface %p, name %s, value %p.\n", iface, debugstr_hstring( name ), value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = lookup_value( impl, name, &member ))) return hr;
+    hr = IJsonValue_GetArray( member, value );
+    IJsonValue_Release( member );
+    return hr;
 }
 
-static HRESULT WINAPI json_object_statics_GetNamedString( IJsonObject *iface, HSTRING name, HSTRING *value )
+/* scalar members that weren't accessed as values yet are read directly from the document */
+static HRESULT get_member_node( struct json_object *impl, HSTRING name, JsonValueType type,
+                                const struct json_node **node, IJsonValue **value )
 {
-    FIXME( "iface %p, name %s, value %p stub!\n", iface, debugstr_hstring( name ), value );
-    return E_NOTIMPL;
+    struct json_member *member;
+    const WCHAR *str;
+    HRESULT hr = S_OK;
+    UINT32 len;
+
+    str = WindowsGetStringRawBuffer( name, &len );
+    *node = NULL;
+    *value = NULL;
+
+    AcquireSRWLockShared( &impl->lock );
+    if (!(member = find_member( impl, str, len ))) hr = WEB_E_JSON_VALUE_NOT_FOUND;
+    else if (member->value) IJsonValue_AddRef( (*value = member->value) );
+    else if (impl->document->nodes[member->node].type != type) hr = E_ILLEGAL_METHOD_CALL;
+    else *node = &impl->document->nodes[member->node];
+    ReleaseSRWLockShared( &impl->lock );
+    return hr;
 }
 
-static HRESULT WINAPI json_object_statics_GetNamedNumber( IJsonObject *iface, HSTRING name, DOUBLE *value )
+static HRESULT WINAPI json_object_GetNamedString( IJsonObject *iface, HSTRING name, HSTRING *value )
 {
-    FIXME( "iface %p, name %s, value %p stub!\n", iface, debugstr_hstring( name ), value );
-    return E_NOTIMPL;
+    struct json_object *impl = impl_from_IJsonObject( iface );
+    const struct json_node *node;
+    IJsonValue *member;
+    HRESULT hr;
+
+    TRACE( "iface %p, name %s, value %p.\n", iface, debugstr_hstring( name ), value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = get_member_node( impl, name, JsonValueType_String, &node, &member ))) return hr;
+    if (node) return json_node_get_string( impl->document, node - impl->document->nodes, value );
+    hr = IJsonValue_GetString( member, value );
+    IJsonValue_Release( member );
+    return hr;
 }
 
-static HRESULT WINAPI json_object_statics_GetNamedBoolean( IJsonObject *iface, HSTRING name, boolean *value )
+static HRESULT WINAPI json_object_GetNamedNumber( IJsonObject *iface, HSTRING name, DOUBLE *value )
 {
-    FIXME( "iface %p, name %s, value %p stub!\n", iface, debugstr_hstring( name ), value );
-    return E_NOTIMPL;
+    struct json_object *impl = impl_from_IJsonObject( iface );
+    const struct json_node *node;
+    IJsonValue *member;
+    HRESULT hr;
+
+    TRACE( "iface %p, name %s, value %p.\n", iface, debugstr_hstring( name ), value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = get_member_node( impl, name, JsonValueType_Number, &node, &member ))) return hr;
+    if (node)
+    {
+        *value = node->u.number;
+        return S_OK;
+    }
+    hr = IJsonValue_GetNumber( member, value );
+    IJsonValue_Release( member );
+    return hr;
 }
 
-static const struct IJsonObjectVtbl json_object_statics_vtbl =
+static HRESULT WINAPI json_object_GetNamedBoolean( IJsonObject *iface, HSTRING name, boolean *value )
 {
-    json_object_statics_QueryInterface,
-    json_object_statics_AddRef,
-    json_object_statics_Release,
+    struct json_object *impl = impl_from_IJsonObject( iface );
+    const struct json_node *node;
+    IJsonValue *member;
+    HRESULT hr;
+
+    TRACE( "iface %p, name %s, value %p.\n", iface, debugstr_hstring( name ), value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = get_member_node( impl, name, JsonValueType_Boolean, &node, &member ))) return hr;
+    if (node)
+    {
+        *value = node->u.boolean;
+        return S_OK;
+    }
+    hr = IJsonValue_GetBoolean( member, value );
+    IJsonValue_Release( member );
+    return hr;
+}
+
+static const struct IJsonObjectVtbl json_object_vtbl =
+{
+    json_object_QueryInterface,
+    json_object_AddRef,
+    json_object_Release,
     /* IInspectable methods */
-    json_object_statics_GetIids,
-    json_object_statics_GetRuntimeClassName,
-    json_object_statics_GetTrustLevel,
+    json_object_GetIids,
+    json_object_GetRuntimeClassName,
+    json_object_GetTrustLevel,
     /* IJsonObject methods */
-    json_object_statics_GetNamedValue,
-    json_object_statics_SetNamedValue,
-    json_object_statics_GetNamedObject,
-    json_object_statics_GetNamedArray,
-    json_object_statics_GetNamedString,
-    json_object_statics_GetNamedNumber,
-    json_object_statics_GetNamedBoolean,
+    json_object_GetNamedValue,
+    json_object_SetNamedValue,
+    json_object_GetNamedObject,
+    json_object_GetNamedArray,
+    json_object_GetNamedString,
+    json_object_GetNamedNumber,
+    json_object_GetNamedBoolean,
+};
+
+DEFINE_IINSPECTABLE( json_object_value, IJsonValue, struct json_object, IJsonObject_iface )
+
+static HRESULT WINAPI json_object_value_get_ValueType( IJsonValue *iface, JsonValueType *value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = JsonValueType_Object;
+    return S_OK;
+}
+
+static void write_object( struct json_writer *writer, struct json_object *impl )
+{
+    struct json_member *member;
+
+    AcquireSRWLockShared( &impl->lock );
+    json_write_chars( writer, L"{", 1 );
+    for (member = impl->members; member < impl->members + impl->count; member++)
+    {
+        if (member != impl->members) json_write_chars( writer, L",", 1 );
+        json_write_string( writer, member->str, member->len );
+        json_write_chars( writer, L":", 1 );
+        if (member->value) json_write_value( writer, member->value );
+        else json_write_node( writer, impl->document, member->node );
+    }
+    json_write_chars( writer, L"}", 1 );
+    ReleaseSRWLockShared( &impl->lock );
+}
+
+static HRESULT WINAPI json_object_value_Stringify( IJsonValue *iface, HSTRING *value )
+{
+    struct json_object *impl = impl_from_IJsonValue( iface );
+    struct json_writer writer = {0};
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    write_object( &writer, impl );
+    return json_writer_get_string( &writer, value );
+}
+
+static HRESULT WINAPI json_object_value_GetString( IJsonValue *iface, HSTRING *value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return value ? E_ILLEGAL_METHOD_CALL : E_POINTER;
+}
+
+static HRESULT WINAPI json_object_value_GetNumber( IJsonValue *iface, DOUBLE *value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return value ? E_ILLEGAL_METHOD_CALL : E_POINTER;
+}
+
+static HRESULT WINAPI json_object_value_GetBoolean( IJsonValue *iface, boolean *value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return value ? E_ILLEGAL_METHOD_CALL : E_POINTER;
+}
+
+static HRESULT WINAPI json_object_value_GetArray( IJsonValue *iface, IJsonArray **value )
+{
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return value ? E_ILLEGAL_METHOD_CALL : E_POINTER;
+}
+
+static HRESULT WINAPI json_object_value_GetObject( IJsonValue *iface, IJsonObject **value )
+{
+    struct json_object *impl = impl_from_IJsonValue( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    IJsonObject_AddRef( (*value = &impl->IJsonObject_iface) );
+    return S_OK;
+}
+
+static const struct IJsonValueVtbl json_object_value_vtbl =
+{
+    json_object_value_QueryInterface,
+    json_object_value_AddRef,
+    json_object_value_Release,
+    /* IInspectable methods */
+    json_object_value_GetIids,
+    json_object_value_GetRuntimeClassName,
+    json_object_value_GetTrustLevel,
+    /* IJsonValue methods */
+    json_object_value_get_ValueType,
+    json_object_value_Stringify,
+    json_object_value_GetString,
+    json_object_value_GetNumber,
+    json_object_value_GetBoolean,
+    json_object_value_GetArray,
+    json_object_value_GetObject,
 };
 
+BOOL json_object_write( struct json_writer *writer, IJsonValue *value )
+{
+    if (value->lpVtbl != &json_object_value_vtbl) return FALSE;
+    write_object( writer, impl_from_IJsonValue( value ) );
+    return TRUE;
+}
+
+DEFINE_IINSPECTABLE( json_object_map, IMap_HSTRING_IJsonValue, struct json_object, IJsonObject_iface )
+
+static HRESULT WINAPI json_object_map_Lookup( IMap_HSTRING_IJsonValue *iface, HSTRING key, IJsonValue **value )
+{
+    struct json_object *impl = impl_from_IMap_HSTRING_IJsonValue( iface );
+    HRESULT hr;
+
+    TRACE( "iface %p, key %s, value %p.\n", iface, debugstr_hstring( key ), value );
+
+    if (!value) return E_POINTER;
+    if ((hr = lookup_value( impl, key, value )) == WEB_E_JSON_VALUE_NOT_FOUND) hr = E_BOUNDS;
+    return hr;
+}
+
+static HRESULT WINAPI json_object_map_get_Size( IMap_HSTRING_IJsonValue *iface, unsigned int *size )
+{
+    struct json_object *impl = impl_from_IMap_HSTRING_IJsonValue( iface );
+
+    TRACE( "iface %p, size %p.\n", iface, size );
+
+    if (!size) return E_POINTER;
+    AcquireSRWLockShared( &impl->lock );
+    *size = impl->count;
+    ReleaseSRWLockShared( &impl->lock );
+    return S_OK;
+}
+
+static HRESULT WINAPI json_object_map_HasKey( IMap_HSTRING_IJsonValue *iface, HSTRING key, boolean *found )
+{
+    struct json_object *impl = impl_from_IMap_HSTRING_IJsonValue( iface );
+    const WCHAR *str;
+    UINT32 len;
+
+    TRACE( "iface %p, key %s, found %p.\n", iface, debugstr_hstring( key ), found );
+
+    if (!found) return E_POINTER;
+    str = WindowsGetStringRawBuffer( key, &len );
+    AcquireSRWLockShared( &impl->lock );
+    *found = !!find_member( impl, str, len );
+    ReleaseSRWLockShared( &impl->lock );
+    return S_OK;
+}
+
+static HRESULT WINAPI json_object_map_GetView( IMap_HSTRING_IJsonValue *iface, IMapView_HSTRING_IJsonValue **view )
+{
+    FIXME( "iface %p, view %p stub!\n", iface, view );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI json_object_map_Insert( IMap_HSTRING_IJsonValue *iface, HSTRING key, IJsonValue *value, boolean *replaced )
+{
+    struct json_object *impl = impl_from_IMap_HSTRING_IJsonValue( iface );
+
+    TRACE( "iface %p, key %s, value %p, replaced %p.\n", iface, debugstr_hstring( key ), value, replaced );
+
+    if (!value || !replaced) return E_POINTER;
+    return insert_value( impl, key, value, replaced );
+}
+
+static HRESULT WINAPI json_object_map_Remove( IMap_HSTRING_IJsonValue *iface, HSTRING key )
+{
+    struct json_object *impl = impl_from_IMap_HSTRING_IJsonValue( iface );
+    struct json_member *member, removed;
+    const WCHAR *str;
+    UINT32 len;
+
+    TRACE( "iface %p, key %s.\n", iface, debugstr_hstring( key ) );
+
+    str = WindowsGetStringRawBuffer( key, &len );
+    AcquireSRWLockExclusive( &impl->lock );
+    if ((member = find_member( impl, str, len )))
+    {
+        removed = *member;
+        memmove( member, member + 1, (impl->members + --impl->count - member) * sizeof(*member) );
+        rebuild_index( impl );
+    }
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    if (!member) return E_BOUNDS;
+    free_member( &removed );
+    return S_OK;
+}
+
+static HRESULT WINAPI json_object_map_Clear( IMap_HSTRING_IJsonValue *iface )
+{
+    struct json_object *impl = impl_from_IMap_HSTRING_IJsonValue( iface );
+    struct json_member *members;
+    UINT32 i, count;
+
+    TRACE( "iface %p.\n", iface );
+
+    AcquireSRWLockExclusive( &impl->lock );
+    members = impl->members;
+    count = impl->count;
+    impl->members = NULL;
+    impl->count = impl->capacity = 0;
+    rebuild_index( impl );
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    for (i = 0; i < count; i++) free_member( &members[i] );
+    free( members );
+    return S_OK;
+}
+
+static const struct IMap_HSTRING_IJsonValueVtbl json_object_map_vtbl =
+{
+    json_object_map_QueryInterface,
+    json_object_map_AddRef,
+    json_object_map_Release,
+    /* IInspectable methods */
+    json_object_map_GetIids,
+    json_object_map_GetRuntimeClassName,
+    json_object_map_GetTrustLevel,
+    /* IMap<HSTRING, IJsonValue *> methods */
+    json_object_map_Lookup,
+    json_object_map_get_Size,
+    json_object_map_HasKey,
+    json_object_map_GetView,
+    json_object_map_Insert,
+    json_object_map_Remove,
+    json_object_map_Clear,
+};
+
+HRESULT json_object_create( struct json_document *document, UINT32 index, IJsonObject **out )
+{
+    struct json_member *member, *existing;
+    const struct json_node *node;
+    struct json_object *impl;
+    UINT32 i, key, count = 0;
+    HRESULT hr;
+
+    if (!(impl = calloc( 1, sizeof(*impl) ))) return E_OUTOFMEMORY;
+    impl->IJsonObject_iface.lpVtbl = &json_object_vtbl;
+    impl->IJsonValue_iface.lpVtbl = &json_object_value_vtbl;
+    impl->IMap_HSTRING_IJsonValue_iface.lpVtbl = &json_object_map_vtbl;
+    impl->ref = 1;
+    InitializeSRWLock( &impl->lock );
+
+    if (document)
+    {
+        InterlockedIncrement( &document->ref );
+        impl->document = document;
+        count = document->nodes[index].u.count;
+    }
+    if (count && !(impl->members = malloc( count * sizeof(*impl->members) )))
+    {
+        IJsonObject_Release( &impl->IJsonObject_iface );
+        return E_OUTOFMEMORY;
+    }
+    impl->capacity = count;
+
+    for (i = 0, key = index + 1; i < count; i++, key = document->nodes[key + 1].next)
+    {
+        member = &impl->members[impl->count];
+        memset( member, 0, sizeof(*member) );
+        node = &document->nodes[key];
+        if (!(node->flags & JSON_NODE_ESCAPED))
+        {
+            member->str = document->text + node->u.string.start;
+            member->len = node->u.string.len;
+        }
+        else if (FAILED(hr = json_node_get_string( document, key, &member->name )))
+        {
+            IJsonObject_Release( &impl->IJsonObject_iface );
+            return hr;
+        }
+        else member->str = WindowsGetStringRawBuffer( member->name, &member->len );
+
+        /* the last of duplicate members wins */
+        if ((existing = find_member( impl, member->str, member->len )))
+        {
+            existing->node = key + 1;
+            WindowsDeleteString( member->name );
+            continue;
+        }
+        member->hash = json_hash_string( member->str, member->len );
+        member->node = key + 1;
+        impl->count++;
+        index_member( impl, member - impl->members );
+    }
+
+    *out = &impl->IJsonObject_iface;
+    TRACE( "created IJsonObject %p.\n", *out );
+    return S_OK;
+}
+
 struct json_object_statics
 {
     IActivationFactory IActivationFactory_iface;
+    IJsonObjectStatics IJsonObjectStatics_iface;
     LONG ref;
 };
 
@@ -179,6 +740,13 @@ static HRESULT WINAPI factory_QueryInterface( IActivationFactory *iface, REFIID
         return S_OK;
     }
 
+    if (IsEqualGUID( iid, &IID_IJsonObjectStatics ))
+    {
+        *out = &impl->IJsonObjectStatics_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
     FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
     *out = NULL;
     return E_NOINTERFACE;
@@ -220,18 +788,10 @@ static HRESULT WINAPI factory_GetTrustLevel( IActivationFactory *iface, TrustLev
 
 static HRESULT WINAPI factory_ActivateInstance( IActivationFactory *iface, IInspectable **instance )
 {
-    struct json_object *impl;
-
     TRACE( "iface %p, instance %p.\n", iface, instance );
 
     *instance = NULL;
-    if (!(impl = calloc( 1, sizeof(*impl) ))) return E_OUTOFMEMORY;
-
-    impl->IJsonObject_iface.lpVtbl = &json_object_statics_vtbl;
-    impl->ref = 1;
-
-    *instance = (IInspectable *)&impl->IJsonObject_iface;
-    return S_OK;
+    return json_object_create( NULL, 0, (IJsonObject **)instance );
 }
 
 static const struct IActivationFactoryVtbl factory_vtbl =
@@ -247,9 +807,53 @@ static const struct IActivationFactoryVtbl factory_vtbl =
     factory_ActivateInstance,
 };
 
+DEFINE_IINSPECTABLE( json_object_statics, IJsonObjectStatics, struct json_object_statics, IActivationFactory_iface )
+
+static HRESULT WINAPI json_object_statics_Parse( IJsonObjectStatics *iface, HSTRING input, IJsonObject **value )
+{
+    struct json_document *document;
+    HRESULT hr;
+
+    TRACE( "iface %p, input %s, value %p.\n", iface, debugstr_hstring( input ), value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = json_document_parse( input, &document ))) return hr;
+    if (document->nodes[0].type != JsonValueType_Object) hr = WEB_E_INVALID_JSON_STRING;
+    else hr = json_object_create( document, 0, value );
+    json_document_release( document );
+    return hr;
+}
+
+static HRESULT WINAPI json_object_statics_TryParse( IJsonObjectStatics *iface, HSTRING input, IJsonObject **result, boolean *succeeded )
+{
+    HRESULT hr;
+
+    TRACE( "iface %p, input %s, result %p, succeeded %p.\n", iface, debugstr_hstring( input ), result, succeeded );
+
+    if (!result || !succeeded) return E_POINTER;
+    if (FAILED(hr = json_object_statics_Parse( iface, input, result ))) *result = NULL;
+    *succeeded = SUCCEEDED(hr);
+    return hr == E_OUTOFMEMORY ? hr : S_OK;
+}
+
+static const struct IJsonObjectStaticsVtbl json_object_statics_vtbl =
+{
+    json_object_statics_QueryInterface,
+    json_object_statics_AddRef,
+    json_object_statics_Release,
+    /* IInspectable methods */
+    json_object_statics_GetIids,
+    json_object_statics_GetRuntimeClassName,
+    json_object_statics_GetTrustLevel,
+    /* IJsonObjectStatics methods */
+    json_object_statics_Parse,
+    json_object_statics_TryParse,
+};
+
 static struct json_object_statics json_object_statics =
 {
     {&factory_vtbl},
+    {&json_object_statics_vtbl},
     1,
 };
 
@@ -0,0 +1,590 @@
+/* WinRT Windows.Data.Json parser and serializer
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <locale.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "private.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(web);
+
+/*
+ * The parser makes a single pass over the text and stores the values in a flat
+ * array of nodes, in document order. A container node is followed by its
+ * children, the members of an object being stored as key and value node pairs,
+ * and its next field points past its last descendant so that siblings can be
+ * skipped in constant time. Strings are kept as ranges of the source text and
+ * only unescaped when an HSTRING is requested for them.
+ */
+
+#define JSON_MAX_DEPTH 1024
+
+struct json_parser
+{
+    const WCHAR      *text;
+    const WCHAR      *ptr;
+    const WCHAR      *end;
+    struct json_node *nodes;
+    UINT32            count;
+    UINT32            size;
+    UINT32            stack[JSON_MAX_DEPTH];  /* open containers */
+    UINT32            depth;
+};
+
+static const DOUBLE pow10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* return a pointer to the first quote, backslash or control character, or end */
+static const WCHAR *find_special_char( const WCHAR *ptr, const WCHAR *end )
+{
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi16( '"' ), backslash = _mm_set1_epi16( '\\' );
+    const __m128i control = _mm_set1_epi16( 0x1f ), zero = _mm_setzero_si128();
+
+    for (; end - ptr >= 8; ptr += 8)
+    {
+        __m128i chars = _mm_loadu_si128( (const __m128i *)ptr );
+        __m128i special = _mm_or_si128( _mm_cmpeq_epi16( chars, quote ), _mm_cmpeq_epi16( chars, backslash ) );
+        DWORD index, mask;
+
+        special = _mm_or_si128( special, _mm_cmpeq_epi16( _mm_subs_epu16( chars, control ), zero ) );
+        if (!(mask = _mm_movemask_epi8( special ))) continue;
+        BitScanForward( &index, mask );
+        return ptr + index / sizeof(WCHAR);
+    }
+#endif
+    for (; ptr < end; ptr++) if (*ptr == '"' || *ptr == '\\' || *ptr < 0x20) break;
+    return ptr;
+}
+
+static inline BOOL is_space( WCHAR ch )
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+static const WCHAR *skip_spaces( const WCHAR *ptr, const WCHAR *end )
+{
+#ifdef __SSE2__
+    /* indentation of pretty-printed documents is skipped 8 characters at a time */
+    if (end - ptr >= 8 && is_space( ptr[0] ) && is_space( ptr[1] ))
+    {
+        const __m128i space = _mm_set1_epi16( ' ' ), tab = _mm_set1_epi16( '\t' );
+        const __m128i lf = _mm_set1_epi16( '\n' ), cr = _mm_set1_epi16( '\r' );
+
+        for (; end - ptr >= 8; ptr += 8)
+        {
+            __m128i chars = _mm_loadu_si128( (const __m128i *)ptr );
+            __m128i spaces = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi16( chars, space ), _mm_cmpeq_epi16( chars, tab ) ),
+                                           _mm_or_si128( _mm_cmpeq_epi16( chars, lf ), _mm_cmpeq_epi16( chars, cr ) ) );
+            DWORD index, mask = ~_mm_movemask_epi8( spaces ) & 0xffff;
+
+            if (!mask) continue;
+            BitScanForward( &index, mask );
+            return ptr + index / sizeof(WCHAR);
+        }
+    }
+#endif
+    while (ptr < end && is_space( *ptr )) ptr++;
+    return ptr;
+}
+
+static inline int hex_value( WCHAR ch )
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+static struct json_node *add_node( struct json_parser *parser, JsonValueType type )
+{
+    struct json_node *node;
+
+    if (parser->count == parser->size)
+    {
+        UINT32 size = parser->size * 2;
+
+        if (size <= parser->size || !(node = realloc( parser->nodes, size * sizeof(*node) ))) return NULL;
+        parser->nodes = node;
+        parser->size = size;
+    }
+
+    node = &parser->nodes[parser->count++];
+    node->type = type;
+    node->flags = 0;
+    node->next = parser->count;
+    return node;
+}
+
+static HRESULT parse_string( struct json_parser *parser, struct json_node *node )
+{
+    const WCHAR *ptr = parser->ptr + 1, *start = ptr, *end = parser->end;
+    int i;
+
+    for (;;)
+    {
+        if ((ptr = find_special_char( ptr, end )) == end) return WEB_E_INVALID_JSON_STRING;
+        if (*ptr == '"') break;
+        if (*ptr != '\\') return WEB_E_INVALID_JSON_STRING;  /* unescaped control character */
+
+        node->flags |= JSON_NODE_ESCAPED;
+        if (++ptr == end) return WEB_E_INVALID_JSON_STRING;
+        switch (*ptr)
+        {
+        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+            ptr++;
+            break;
+        case 'u':
+            if (end - ptr < 5) return WEB_E_INVALID_JSON_STRING;
+            for (i = 1; i < 5; i++) if (hex_value( ptr[i] ) < 0) return WEB_E_INVALID_JSON_STRING;
+            ptr += 5;
+            break;
+        default:
+            return WEB_E_INVALID_JSON_STRING;
+        }
+    }
+
+    node->u.string.start = start - parser->text;
+    node->u.string.len = ptr - start;
+    parser->ptr = ptr + 1;
+    return S_OK;
+}
+
+/* convert a number that is too long or too large for the exact fast path */
+static HRESULT parse_number_slow( const WCHAR *start, const WCHAR *end, DOUBLE *value )
+{
+    WCHAR buffer[64], *str = buffer, *p;
+    UINT32 i, len = end - start;
+
+    if (len >= ARRAY_SIZE(buffer) && !(str = malloc( (len + 1) * sizeof(WCHAR) ))) return E_OUTOFMEMORY;
+    for (i = 0; i < len; i++) str[i] = start[i] == '.' ? *localeconv()->decimal_point : start[i];
+    str[len] = 0;
+    *value = wcstod( str, &p );
+    if (str != buffer) free( str );
+    return S_OK;
+}
+
+static HRESULT parse_number( struct json_parser *parser, DOUBLE *value )
+{
+    const WCHAR *ptr = parser->ptr, *start = ptr, *end = parser->end;
+    int digits = 0, exp10 = 0, exp = 0, neg = 0, exp_neg = 0;
+    UINT64 mantissa = 0;
+    BOOL exact = TRUE;
+
+    if (*ptr == '-' && ++ptr == end) return WEB_E_INVALID_JSON_NUMBER;
+    neg = ptr != start;
+
+    if (*ptr == '0') ptr++;
+    else if (*ptr >= '1' && *ptr <= '9')
+    {
+        for (; ptr < end && *ptr >= '0' && *ptr <= '9'; ptr++)
+        {
+            if (digits < 19) mantissa = mantissa * 10 + *ptr - '0', digits++;
+            else exp10++, exact = FALSE;
+        }
+    }
+    else return WEB_E_INVALID_JSON_NUMBER;
+
+    if (ptr < end && *ptr == '.')
+    {
+        if (++ptr == end || *ptr < '0' || *ptr > '9') return WEB_E_INVALID_JSON_NUMBER;
+        for (; ptr < end && *ptr >= '0' && *ptr <= '9'; ptr++)
+        {
+            if (!mantissa && *ptr == '0') exp10--;  /* leading zeros aren't significant */
+            else if (digits < 19) mantissa = mantissa * 10 + *ptr - '0', digits++, exp10--;
+            else exact = FALSE;
+        }
+    }
+
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+    {
+        if (++ptr < end && (*ptr == '+' || *ptr == '-')) exp_neg = *ptr++ == '-';
+        if (ptr == end || *ptr < '0' || *ptr > '9') return WEB_E_INVALID_JSON_NUMBER;
+        for (; ptr < end && *ptr >= '0' && *ptr <= '9'; ptr++) if (exp < 100000) exp = exp * 10 + *ptr - '0';
+        exp10 += exp_neg ? -exp : exp;
+    }
+
+    parser->ptr = ptr;
+
+    /* both the mantissa and the power of ten are exact doubles, so is the result */
+    if (exact && mantissa < ((UINT64)1 << 53) && exp10 >= -22 && exp10 <= 22)
+    {
+        *value = exp10 < 0 ? (DOUBLE)mantissa / pow10[-exp10] : (DOUBLE)mantissa * pow10[exp10];
+        if (neg) *value = -*value;
+        return S_OK;
+    }
+    return parse_number_slow( start, ptr, value );
+}
+
+static BOOL parse_literal( struct json_parser *parser, const WCHAR *literal, UINT32 len )
+{
+    if (parser->end - parser->ptr < len || memcmp( parser->ptr, literal, len * sizeof(WCHAR) )) return FALSE;
+    parser->ptr += len;
+    return TRUE;
+}
+
+/* parse the name of an object member and the following colon */
+static HRESULT parse_member_name( struct json_parser *parser )
+{
+    struct json_node *node;
+    HRESULT hr;
+
+    parser->ptr = skip_spaces( parser->ptr, parser->end );
+    if (parser->ptr == parser->end || *parser->ptr != '"') return WEB_E_INVALID_JSON_STRING;
+    if (!(node = add_node( parser, JsonValueType_String ))) return E_OUTOFMEMORY;
+    if (FAILED(hr = parse_string( parser, node ))) return hr;
+
+    parser->ptr = skip_spaces( parser->ptr, parser->end );
+    if (parser->ptr == parser->end || *parser->ptr != ':') return WEB_E_INVALID_JSON_STRING;
+    parser->ptr++;
+    parser->nodes[parser->stack[parser->depth - 1]].u.count++;
+    return S_OK;
+}
+
+static HRESULT parse_document( struct json_parser *parser )
+{
+    struct json_node *node;
+    JsonValueType type;
+    HRESULT hr = S_OK;
+    UINT32 top;
+    WCHAR close;
+
+    for (;;)
+    {
+        parser->ptr = skip_spaces( parser->ptr, parser->end );
+        if (parser->ptr == parser->end) return WEB_E_INVALID_JSON_STRING;
+
+        if (parser->depth && parser->nodes[(top = parser->stack[parser->depth - 1])].type == JsonValueType_Array)
+            parser->nodes[top].u.count++;
+
+        switch (*parser->ptr)
+        {
+        case '{':
+        case '[':
+            type = *parser->ptr == '{' ? JsonValueType_Object : JsonValueType_Array;
+            close = type == JsonValueType_Object ? '}' : ']';
+            if (parser->depth == JSON_MAX_DEPTH) return WEB_E_INVALID_JSON_STRING;
+            if (!(node = add_node( parser, type ))) return E_OUTOFMEMORY;
+            node->u.count = 0;
+            parser->stack[parser->depth++] = parser->count - 1;
+
+            parser->ptr = skip_spaces( parser->ptr + 1, parser->end );
+            if (parser->ptr < parser->end && *parser->ptr == close) break;  /* empty */
+            if (type == JsonValueType_Object && FAILED(hr = parse_member_name( parser ))) return hr;
+            continue;
+        case '"':
+            if (!(node = add_node( parser, JsonValueType_String ))) return E_OUTOFMEMORY;
+            hr = parse_string( parser, node );
+            break;
+        case 't':
+        case 'f':
+            if (!(node = add_node( parser, JsonValueType_Boolean ))) return E_OUTOFMEMORY;
+            if ((node->u.boolean = *parser->ptr == 't')) hr = parse_literal( parser, L"true", 4 ) ? S_OK : WEB_E_INVALID_JSON_STRING;
+            else hr = parse_literal( parser, L"false", 5 ) ? S_OK : WEB_E_INVALID_JSON_STRING;
+            break;
+        case 'n':
+            if (!(node = add_node( parser, JsonValueType_Null ))) return E_OUTOFMEMORY;
+            hr = parse_literal( parser, L"null", 4 ) ? S_OK : WEB_E_INVALID_JSON_STRING;
+            break;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+            if (!(node = add_node( parser, JsonValueType_Number ))) return E_OUTOFMEMORY;
+            hr = parse_number( parser, &node->u.number );
+            break;
+        default:
+            return WEB_E_INVALID_JSON_STRING;
+        }
+        if (FAILED(hr)) return hr;
+
+        /* close the finished containers, until the next value is expected */
+        for (;;)
+        {
+            parser->ptr = skip_spaces( parser->ptr, parser->end );
+            if (!parser->depth) return parser->ptr == parser->end ? S_OK : WEB_E_INVALID_JSON_STRING;
+            if (parser->ptr == parser->end) return WEB_E_INVALID_JSON_STRING;
+
+            top = parser->stack[parser->depth - 1];
+            type = parser->nodes[top].type;
+            if (*parser->ptr == (type == JsonValueType_Object ? '}' : ']'))
+            {
+                parser->ptr++;
+                parser->nodes[top].next = parser->count;
+                parser->depth--;
+                continue;
+            }
+            if (*parser->ptr != ',') return WEB_E_INVALID_JSON_STRING;
+            parser->ptr++;
+            if (type == JsonValueType_Object && FAILED(hr = parse_member_name( parser ))) return hr;
+            break;
+        }
+    }
+}
+
+HRESULT json_document_parse( HSTRING input, struct json_document **out )
+{
+    struct json_document *document;
+    struct json_parser *parser;
+    struct json_node *nodes;
+    UINT32 len;
+    HRESULT hr;
+
+    if (!(document = calloc( 1, sizeof(*document) ))) return E_OUTOFMEMORY;
+    document->ref = 1;
+    if (FAILED(hr = WindowsDuplicateString( input, &document->source )))
+    {
+        free( document );
+        return hr;
+    }
+    document->text = WindowsGetStringRawBuffer( document->source, &len );
+
+    if (!(parser = malloc( sizeof(*parser) )))
+    {
+        json_document_release( document );
+        return E_OUTOFMEMORY;
+    }
+    parser->text = parser->ptr = document->text;
+    parser->end = document->text + len;
+    parser->count = 0;
+    parser->size = len / 8 + 16;
+    parser->depth = 0;
+
+    if (!(parser->nodes = malloc( parser->size * sizeof(*parser->nodes) ))) hr = E_OUTOFMEMORY;
+    else hr = parse_document( parser );
+
+    if (SUCCEEDED(hr))
+    {
+        if ((nodes = realloc( parser->nodes, parser->count * sizeof(*nodes) ))) parser->nodes = nodes;
+        document->nodes = parser->nodes;
+        document->count = parser->count;
+        *out = document;
+    }
+    else
+    {
+        WARN( "failed to parse %s at offset %Iu, hr %#lx.\n", debugstr_hstring( input ),
+              (SIZE_T)(parser->ptr - parser->text), hr );
+        free( parser->nodes );
+        json_document_release( document );
+    }
+    free( parser );
+    return hr;
+}
+
+void json_document_release( struct json_document *document )
+{
+    if (InterlockedDecrement( &document->ref )) return;
+    WindowsDeleteString( document->source );
+    free( document->nodes );
+    free( document );
+}
+
+/* unescape a string into a buffer large enough for the escaped string, return its length */
+static UINT32 unescape_string( const WCHAR *str, UINT32 len, WCHAR *buffer )
+{
+    const WCHAR *end = str + len;
+    WCHAR *dst = buffer;
+
+    while (str < end)
+    {
+        if (*str != '\\')
+        {
+            *dst++ = *str++;
+            continue;
+        }
+        switch (*++str)
+        {
+        case 'b': *dst++ = '\b'; break;
+        case 'f': *dst++ = '\f'; break;
+        case 'n': *dst++ = '\n'; break;
+        case 'r': *dst++ = '\r'; break;
+        case 't': *dst++ = '\t'; break;
+        case 'u':
+            *dst++ = (hex_value( str[1] ) << 12) | (hex_value( str[2] ) << 8) | (hex_value( str[3] ) << 4) | hex_value( str[4] );
+            str += 4;
+            break;
+        default: *dst++ = *str; break;
+        }
+        str++;
+    }
+    return dst - buffer;
+}
+
+HRESULT json_node_get_string( struct json_document *document, UINT32 index, HSTRING *out )
+{
+    const struct json_node *node = &document->nodes[index];
+    const WCHAR *str = document->text + node->u.string.start;
+    WCHAR *buffer;
+    HRESULT hr;
+
+    if (!(node->flags & JSON_NODE_ESCAPED)) return WindowsCreateString( str, node->u.string.len, out );
+
+    if (!(buffer = malloc( node->u.string.len * sizeof(WCHAR) ))) return E_OUTOFMEMORY;
+    hr = WindowsCreateString( buffer, unescape_string( str, node->u.string.len, buffer ), out );
+    free( buffer );
+    return hr;
+}
+
+UINT32 json_hash_string( const WCHAR *str, UINT32 len )
+{
+    UINT32 hash = 2166136261u;  /* FNV-1a */
+
+    while (len--) hash = (hash ^ *str++) * 16777619;
+    return hash;
+}
+
+static BOOL writer_reserve( struct json_writer *writer, UINT32 len )
+{
+    WCHAR *buffer;
+    UINT32 size;
+
+    if (writer->size - writer->len >= len) return TRUE;
+    if (FAILED(writer->hr)) return FALSE;
+
+    size = max( max( writer->size * 2, writer->len + len ), 256 );
+    if (!(buffer = realloc( writer->buffer, size * sizeof(WCHAR) )))
+    {
+        writer->hr = E_OUTOFMEMORY;
+        return FALSE;
+    }
+    writer->buffer = buffer;
+    writer->size = size;
+    return TRUE;
+}
+
+void json_write_chars( struct json_writer *writer, const WCHAR *str, UINT32 len )
+{
+    if (!writer_reserve( writer, len )) return;
+    memcpy( writer->buffer + writer->len, str, len * sizeof(WCHAR) );
+    writer->len += len;
+}
+
+void json_write_string( struct json_writer *writer, const WCHAR *str, UINT32 len )
+{
+    const WCHAR *end = str + len, *special;
+    WCHAR buffer[8];
+
+    json_write_chars( writer, L"\"", 1 );
+    while (str < end)
+    {
+        special = find_special_char( str, end );
+        json_write_chars( writer, str, special - str );
+        if (special == end) break;
+
+        switch (*special)
+        {
+        case '"':  json_write_chars( writer, L"\\\"", 2 ); break;
+        case '\\': json_write_chars( writer, L"\\\\", 2 ); break;
+        case '\b': json_write_chars( writer, L"\\b", 2 ); break;
+        case '\f': json_write_chars( writer, L"\\f", 2 ); break;
+        case '\n': json_write_chars( writer, L"\\n", 2 ); break;
+        case '\r': json_write_chars( writer, L"\\r", 2 ); break;
+        case '\t': json_write_chars( writer, L"\\t", 2 ); break;
+        default:
+            swprintf( buffer, ARRAY_SIZE(buffer), L"\\u%04x", *special );
+            json_write_chars( writer, buffer, 6 );
+            break;
+        }
+        str = special + 1;
+    }
+    json_write_chars( writer, L"\"", 1 );
+}
+
+void json_write_number( struct json_writer *writer, DOUBLE value )
+{
+    WCHAR buffer[32], *ptr;
+    int precision;
+
+    if (!isfinite( value ))
+    {
+        json_write_chars( writer, L"null", 4 );
+        return;
+    }
+
+    /* use the shortest representation that converts back to the same value */
+    if (value == floor( value ) && fabs( value ) < 1e15) swprintf( buffer, ARRAY_SIZE(buffer), L"%.0f", value );
+    else for (precision = 15; precision <= 17; precision++)
+    {
+        swprintf( buffer, ARRAY_SIZE(buffer), L"%.*g", precision, value );
+        if (wcstod( buffer, NULL ) == value) break;
+    }
+    for (ptr = buffer; *ptr; ptr++) if (*ptr == *localeconv()->decimal_point) *ptr = '.';
+    json_write_chars( writer, buffer, ptr - buffer );
+}
+
+void json_write_node( struct json_writer *writer, struct json_document *document, UINT32 index )
+{
+    const struct json_node *node = &document->nodes[index];
+    UINT32 i, child = index + 1;
+
+    switch (node->type)
+    {
+    case JsonValueType_Null:
+        json_write_chars( writer, L"null", 4 );
+        break;
+    case JsonValueType_Boolean:
+        if (node->u.boolean) json_write_chars( writer, L"true", 4 );
+        else json_write_chars( writer, L"false", 5 );
+        break;
+    case JsonValueType_Number:
+        json_write_number( writer, node->u.number );
+        break;
+    case JsonValueType_String:
+        /* the source text is already escaped */
+        if (!writer_reserve( writer, node->u.string.len + 2 )) break;
+        json_write_chars( writer, L"\"", 1 );
+        json_write_chars( writer, document->text + node->u.string.start, node->u.string.len );
+        json_write_chars( writer, L"\"", 1 );
+        break;
+    case JsonValueType_Array:
+        json_write_chars( writer, L"[", 1 );
+        for (i = 0; i < node->u.count; i++, child = document->nodes[child].next)
+        {
+            if (i) json_write_chars( writer, L",", 1 );
+            json_write_node( writer, document, child );
+        }
+        json_write_chars( writer, L"]", 1 );
+        break;
+    case JsonValueType_Object:
+        json_write_chars( writer, L"{", 1 );
+        for (i = 0; i < node->u.count; i++, child = document->nodes[child + 1].next)
+        {
+            if (i) json_write_chars( writer, L",", 1 );
+            json_write_node( writer, document, child );
+            json_write_chars( writer, L":", 1 );
+            json_write_node( writer, document, child + 1 );
+        }
+        json_write_chars( writer, L"}", 1 );
+        break;
+    }
+}
+
+HRESULT json_writer_get_string( struct json_writer *writer, HSTRING *out )
+{
+    HRESULT hr = writer->hr;
+
+    if (SUCCEEDED(hr)) hr = WindowsCreateString( writer->buffer, writer->len, out );
+    free( writer->buffer );
+    return hr;
+}
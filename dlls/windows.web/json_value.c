@@ -120,7 +120,14 @@ struct json_value
     IJsonValue IJsonValue_iface;
     LONG ref;
 
+    JsonValueType type;
+    boolean boolean_value;
+    DOUBLE number_value;
     HSTRING string_value;
+
+    /* strings parsed from a document are only unescaped on request */
+    struct json_document *document;
+    UINT32 node;
 };
 
 static inline struct json_value *impl_from_IJsonValue( IJsonValue *iface )
@@ -167,6 +174,7 @@ static ULONG WINAPI json_value_Release( IJsonValue *iface )
     if (!ref)
     {
         WindowsDeleteString( impl->string_value );
+        if (impl->document) json_document_release( impl->document );
         free( impl );
     }
     return ref;
@@ -192,44 +200,114 @@ static HRESULT WINAPI json_value_GetTrustLevel( IJsonValue *iface, TrustLevel *t
 
 static HRESULT WINAPI json_value_get_ValueType( IJsonValue *iface, JsonValueType *value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    return E_NOTIMPL;
+    struct json_value *impl = impl_from_IJsonValue( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    *value = impl->type;
+    return S_OK;
+}
+
+static void json_value_write( struct json_writer *writer, struct json_value *impl )
+{
+    const WCHAR *str;
+    UINT32 len;
+
+    switch (impl->type)
+    {
+    case JsonValueType_Null:
+        json_write_chars( writer, L"null", 4 );
+        break;
+    case JsonValueType_Boolean:
+        if (impl->boolean_value) json_write_chars( writer, L"true", 4 );
+        else json_write_chars( writer, L"false", 5 );
+        break;
+    case JsonValueType_Number:
+        json_write_number( writer, impl->number_value );
+        break;
+    case JsonValueType_String:
+        if (impl->document) json_write_node( writer, impl->document, impl->node );
+        else
+        {
+            str = WindowsGetStringRawBuffer( impl->string_value, &len );
+            json_write_string( writer, str, len );
+        }
+        break;
+    default:
+        break;
+    }
 }
 
 static HRESULT WINAPI json_value_Stringify( IJsonValue *iface, HSTRING *value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    return E_NOTIMPL;
+    struct json_value *impl = impl_from_IJsonValue( iface );
+    struct json_writer writer = {0};
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    json_value_write( &writer, impl );
+    return json_writer_get_string( &writer, value );
 }
 
 static HRESULT WINAPI json_value_GetString( IJsonValue *iface, HSTRING *value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    return E_NOTIMPL;
+    struct json_value *impl = impl_from_IJsonValue( iface );
+    HSTRING str;
+    HRESULT hr;
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    if (impl->type != JsonValueType_String) return E_ILLEGAL_METHOD_CALL;
+
+    if (impl->document && !impl->string_value)
+    {
+        if (FAILED(hr = json_node_get_string( impl->document, impl->node, &str ))) return hr;
+        if (InterlockedCompareExchangePointer( (void **)&impl->string_value, str, NULL )) WindowsDeleteString( str );
+    }
+    return WindowsDuplicateString( impl->string_value, value );
 }
 
 static HRESULT WINAPI json_value_GetNumber( IJsonValue *iface, DOUBLE *value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    return E_NOTIMPL;
+    struct json_value *impl = impl_from_IJsonValue( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    if (impl->type != JsonValueType_Number) return E_ILLEGAL_METHOD_CALL;
+    *value = impl->number_value;
+    return S_OK;
 }
 
 static HRESULT WINAPI json_value_GetBoolean( IJsonValue *iface, boolean *value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    return E_NOTIMPL;
+    struct json_value *impl = impl_from_IJsonValue( iface );
+
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    if (impl->type != JsonValueType_Boolean) return E_ILLEGAL_METHOD_CALL;
+    *value = impl->boolean_value;
+    return S_OK;
 }
 
 static HRESULT WINAPI json_value_GetArray( IJsonValue *iface, IJsonArray **value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    return E_NOTIMPL;
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    return E_ILLEGAL_METHOD_CALL;
 }
 
 static HRESULT WINAPI json_value_GetObject( IJsonValue *iface, IJsonObject **value )
 {
-    FIXME( "iface %p, value %p stub!\n", iface, value );
-    return E_NOTIMPL;
+    TRACE( "iface %p, value %p.\n", iface, value );
+
+    if (!value) return E_POINTER;
+    return E_ILLEGAL_METHOD_CALL;
 }
 
 static const struct IJsonValueVtbl json_value_vtbl =
@@ -251,30 +329,132 @@ static const struct IJsonValueVtbl json_value_vtbl =
     json_value_GetObject,
 };
 
+static HRESULT create_scalar_value( JsonValueType type, IJsonValue **value, struct json_value **out )
+{
+    struct json_value *impl;
+
+    if (!value) return E_POINTER;
+    if (!(impl = calloc( 1, sizeof(*impl) ))) return E_OUTOFMEMORY;
+
+    impl->IJsonValue_iface.lpVtbl = &json_value_vtbl;
+    impl->ref = 1;
+    impl->type = type;
+
+    *value = &impl->IJsonValue_iface;
+    *out = impl;
+    return S_OK;
+}
+
+HRESULT json_value_create( struct json_document *document, UINT32 index, IJsonValue **out )
+{
+    const struct json_node *node = &document->nodes[index];
+    struct json_value *impl;
+    IJsonObject *object;
+    IJsonArray *array;
+    HRESULT hr;
+
+    switch (node->type)
+    {
+    case JsonValueType_Object:
+        if (FAILED(hr = json_object_create( document, index, &object ))) return hr;
+        hr = IJsonObject_QueryInterface( object, &IID_IJsonValue, (void **)out );
+        IJsonObject_Release( object );
+        return hr;
+    case JsonValueType_Array:
+        if (FAILED(hr = json_array_create( document, index, &array ))) return hr;
+        hr = IJsonArray_QueryInterface( array, &IID_IJsonValue, (void **)out );
+        IJsonArray_Release( array );
+        return hr;
+    }
+
+    if (FAILED(hr = create_scalar_value( node->type, out, &impl ))) return hr;
+    switch (node->type)
+    {
+    case JsonValueType_Boolean:
+        impl->boolean_value = node->u.boolean;
+        break;
+    case JsonValueType_Number:
+        impl->number_value = node->u.number;
+        break;
+    case JsonValueType_String:
+        InterlockedIncrement( &document->ref );
+        impl->document = document;
+        impl->node = index;
+        break;
+    }
+    return S_OK;
+}
+
+void json_write_value( struct json_writer *writer, IJsonValue *value )
+{
+    const WCHAR *str;
+    HSTRING string;
+    UINT32 len;
+
+    if (value->lpVtbl == &json_value_vtbl)
+    {
+        json_value_write( writer, impl_from_IJsonValue( value ) );
+        return;
+    }
+    if (json_object_write( writer, value ) || json_array_write( writer, value )) return;
+
+    /* not one of our values */
+    if (FAILED(writer->hr) || FAILED(writer->hr = IJsonValue_Stringify( value, &string ))) return;
+    str = WindowsGetStringRawBuffer( string, &len );
+    json_write_chars( writer, str, len );
+    WindowsDeleteString( string );
+}
+
 DEFINE_IINSPECTABLE( json_value_statics, IJsonValueStatics, struct json_value_statics, IActivationFactory_iface )
 
 static HRESULT WINAPI json_value_statics_Parse( IJsonValueStatics *iface, HSTRING input, IJsonValue **value )
 {
-    FIXME( "iface %p, input %s, value %p stub!\n", iface, debugstr_hstring( input ), value );
-    return E_NOTIMPL;
+    struct json_document *document;
+    HRESULT hr;
+
+    TRACE( "iface %p, input %s, value %p.\n", iface, debugstr_hstring( input ), value );
+
+    if (!value) return E_POINTER;
+    if (FAILED(hr = json_document_parse( input, &document ))) return hr;
+    hr = json_value_create( document, 0, value );
+    json_document_release( document );
+    return hr;
 }
 
 static HRESULT WINAPI json_value_statics_TryParse( IJsonValueStatics *iface, HSTRING input, IJsonValue **result, boolean *succeeded )
 {
-    FIXME( "iface %p, input %s, result %p, succeeded %p stub!\n", iface, debugstr_hstring( input ), result, succeeded );
-    return E_NOTIMPL;
+    HRESULT hr;
+
+    TRACE( "iface %p, input %s, result %p, succeeded %p.\n", iface, debugstr_hstring( input ), result, succeeded );
+
+    if (!result || !succeeded) return E_POINTER;
+    if (FAILED(hr = json_value_statics_Parse( iface, input, result ))) *result = NULL;
+    *succeeded = SUCCEEDED(hr);
+    return hr == E_OUTOFMEMORY ? hr : S_OK;
 }
 
 static HRESULT WINAPI json_value_statics_CreateBooleanValue( IJsonValueStatics *iface, boolean input, IJsonValue **value )
 {
-    FIXME( "iface %p, input %d, value %p stub!\n", iface, input, value );
-    return E_NOTIMPL;
+    struct json_value *impl;
+    HRESULT hr;
+
+    TRACE( "iface %p, input %d, value %p.\n", iface, input, value );
+
+    if (FAILED(hr = create_scalar_value( JsonValueType_Boolean, value, &impl ))) return hr;
+    impl->boolean_value = input;
+    return S_OK;
 }
 
 static HRESULT WINAPI json_value_statics_CreateNumberValue( IJsonValueStatics *iface, DOUBLE input, IJsonValue **value )
 {
-    FIXME( "iface %p, input %f, value %p stub!\n", iface, input, value );
-    return E_NOTIMPL;
+    struct json_value *impl;
+    HRESULT hr;
+
+    TRACE( "iface %p, input %f, value %p.\n", iface, input, value );
+
+    if (FAILED(hr = create_scalar_value( JsonValueType_Number, value, &impl ))) return hr;
+    impl->number_value = input;
+    return S_OK;
 }
 
 static HRESULT WINAPI json_value_statics_CreateStringValue( IJsonValueStatics *iface, HSTRING input, IJsonValue **value )
@@ -284,18 +464,14 @@ static HRESULT WINAPI json_value_statics_CreateStringValue( IJsonValueStatics *i
 
     TRACE( "iface %p, input %s, value %p\n", iface, debugstr_hstring( input ), value );
 
-    if (!value) return E_POINTER;
-    if (!(impl = calloc( 1, sizeof(*impl) ))) return E_OUTOFMEMORY;
-
-    impl->IJsonValue_iface.lpVtbl = &json_value_vtbl;
-    impl->ref = 1;
+    if (FAILED(hr = create_scalar_value( JsonValueType_String, value, &impl ))) return hr;
     if (FAILED(hr = WindowsDuplicateString( input, &impl->string_value )))
     {
          free( impl );
+         *value = NULL;
          return hr;
     }
 
-    *value = &impl->IJsonValue_iface;
     TRACE( "created IJsonValue %p.\n", *value );
     return S_OK;
 }
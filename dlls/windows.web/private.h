@@ -35,9 +35,67 @@
 #define WIDL_using_Windows_Data_Json
 #include "windows.data.json.h"
 
+extern IActivationFactory *json_array_factory;
 extern IActivationFactory *json_object_factory;
 extern IActivationFactory *json_value_factory;
 
+#define JSON_NODE_ESCAPED  0x0001
+
+/* parsed value, see json_parser.c */
+struct json_node
+{
+    UINT16 type;   /* JsonValueType */
+    UINT16 flags;
+    UINT32 next;   /* index of the next sibling */
+    union
+    {
+        DOUBLE number;
+        boolean boolean;
+        struct
+        {
+            UINT32 start;
+            UINT32 len;
+        } string;
+        UINT32 count;  /* number of array elements or object members */
+    } u;
+};
+
+/* immutable parse result, shared by the values that were created from it */
+struct json_document
+{
+    LONG ref;
+    HSTRING source;
+    const WCHAR *text;
+    struct json_node *nodes;
+    UINT32 count;
+};
+
+struct json_writer
+{
+    WCHAR *buffer;
+    UINT32 len;
+    UINT32 size;
+    HRESULT hr;
+};
+
+extern HRESULT json_document_parse( HSTRING input, struct json_document **document );
+extern void json_document_release( struct json_document *document );
+extern HRESULT json_node_get_string( struct json_document *document, UINT32 index, HSTRING *out );
+extern UINT32 json_hash_string( const WCHAR *str, UINT32 len );
+
+extern void json_write_chars( struct json_writer *writer, const WCHAR *str, UINT32 len );
+extern void json_write_string( struct json_writer *writer, const WCHAR *str, UINT32 len );
+extern void json_write_number( struct json_writer *writer, DOUBLE value );
+extern void json_write_node( struct json_writer *writer, struct json_document *document, UINT32 index );
+extern HRESULT json_writer_get_string( struct json_writer *writer, HSTRING *out );
+
+extern HRESULT json_value_create( struct json_document *document, UINT32 index, IJsonValue **out );
+extern HRESULT json_array_create( struct json_document *document, UINT32 index, IJsonArray **out );
+extern HRESULT json_object_create( struct json_document *document, UINT32 index, IJsonObject **out );
+extern BOOL json_array_write( struct json_writer *writer, IJsonValue *value );
+extern BOOL json_object_write( struct json_writer *writer, IJsonValue *value );
+extern void json_write_value( struct json_writer *writer, IJsonValue *value );
+
 #define DEFINE_IINSPECTABLE_( pfx, iface_type, impl_type, impl_from, iface_mem, expr )             \
     static inline impl_type *impl_from( iface_type *iface )                                        \
     {                                                                                              \
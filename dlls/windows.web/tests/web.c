@@ -18,6 +18,7 @@
 #define COBJMACROS
 #include "initguid.h"
 #include <stdarg.h>
+#include <stdio.h>
 
 #include "windef.h"
 #include "winbase.h"
@@ -138,6 +139,268 @@ static void test_JsonValueStatics(void)
     ok( ref == 1, "got ref %ld.\n", ref );
 }
 
+static HSTRING create_hstring( const WCHAR *str )
+{
+    HSTRING hstr;
+    HRESULT hr;
+
+    hr = WindowsCreateString( str, wcslen( str ), &hstr );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    return hstr;
+}
+
+#define check_string( hstr, expect ) check_string_( __LINE__, hstr, expect )
+static void check_string_( unsigned int line, HSTRING hstr, const WCHAR *expect )
+{
+    const WCHAR *str = WindowsGetStringRawBuffer( hstr, NULL );
+    ok_(__FILE__, line)( !wcscmp( str, expect ), "got %s, expected %s.\n", debugstr_w( str ), debugstr_w( expect ) );
+}
+
+static void test_JsonParse(void)
+{
+    static const WCHAR *json_value_name = L"Windows.Data.Json.JsonValue";
+    static const WCHAR *json_object_name = L"Windows.Data.Json.JsonObject";
+    static const WCHAR *document =
+        L" { \"name\" : \"wine\\n\\u0041\", \"version\": 9.5, \"stable\": false,\n"
+        L"   \"list\": [1, -2e3, \"x\", null, [], {}], \"nested\": {\"a\": {\"b\": true}}, \"name\": \"last\" } ";
+    static const struct
+    {
+        const WCHAR *input;
+        HRESULT hr;
+    }
+    invalid[] =
+    {
+        {L"", WEB_E_INVALID_JSON_STRING},
+        {L"{", WEB_E_INVALID_JSON_STRING},
+        {L"[1,]", WEB_E_INVALID_JSON_STRING},
+        {L"{\"a\":1,}", WEB_E_INVALID_JSON_STRING},
+        {L"{\"a\" 1}", WEB_E_INVALID_JSON_STRING},
+        {L"\"abc", WEB_E_INVALID_JSON_STRING},
+        {L"\"\\q\"", WEB_E_INVALID_JSON_STRING},
+        {L"tru", WEB_E_INVALID_JSON_STRING},
+        {L"[1] 2", WEB_E_INVALID_JSON_STRING},
+        {L"1.", WEB_E_INVALID_JSON_NUMBER},
+        {L"-", WEB_E_INVALID_JSON_NUMBER},
+        {L"1e+", WEB_E_INVALID_JSON_NUMBER},
+    };
+    IActivationFactory *value_factory, *object_factory;
+    IJsonObjectStatics *object_statics;
+    IJsonValueStatics *value_statics;
+    IJsonValue *json_value, *member;
+    IJsonObject *json_object, *nested;
+    UINT32 i, count, len;
+    LARGE_INTEGER freq, start, end;
+    IJsonArray *json_array;
+    JsonValueType type;
+    boolean succeeded, value;
+    DOUBLE number;
+    HSTRING str, name;
+    WCHAR *big, *ptr;
+    HRESULT hr;
+
+    str = create_hstring( json_value_name );
+    hr = RoGetActivationFactory( str, &IID_IActivationFactory, (void **)&value_factory );
+    WindowsDeleteString( str );
+    ok( hr == S_OK || broken( hr == REGDB_E_CLASSNOTREG ), "got hr %#lx.\n", hr );
+    if (hr == REGDB_E_CLASSNOTREG)
+    {
+        win_skip( "%s runtimeclass not registered, skipping tests.\n", wine_dbgstr_w( json_value_name ) );
+        return;
+    }
+    str = create_hstring( json_object_name );
+    hr = RoGetActivationFactory( str, &IID_IActivationFactory, (void **)&object_factory );
+    WindowsDeleteString( str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+
+    hr = IActivationFactory_QueryInterface( value_factory, &IID_IJsonValueStatics, (void **)&value_statics );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IActivationFactory_QueryInterface( object_factory, &IID_IJsonObjectStatics, (void **)&object_statics );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+
+    str = create_hstring( document );
+    hr = IJsonObjectStatics_Parse( object_statics, str, &json_object );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    WindowsDeleteString( str );
+    check_interface( json_object, &IID_IJsonValue );
+    check_interface( json_object, &IID_IMap_HSTRING_IJsonValue );
+
+    /* duplicate names keep the last value */
+    name = create_hstring( L"name" );
+    hr = IJsonObject_GetNamedString( json_object, name, &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    check_string( str, L"last" );
+    WindowsDeleteString( str );
+    hr = IJsonObject_GetNamedNumber( json_object, name, &number );
+    ok( hr == E_ILLEGAL_METHOD_CALL, "got hr %#lx.\n", hr );
+    WindowsDeleteString( name );
+
+    name = create_hstring( L"version" );
+    hr = IJsonObject_GetNamedNumber( json_object, name, &number );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( number == 9.5, "got %f.\n", number );
+    WindowsDeleteString( name );
+
+    name = create_hstring( L"stable" );
+    value = TRUE;
+    hr = IJsonObject_GetNamedBoolean( json_object, name, &value );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( !value, "got %d.\n", value );
+    WindowsDeleteString( name );
+
+    name = create_hstring( L"missing" );
+    hr = IJsonObject_GetNamedValue( json_object, name, &member );
+    ok( hr == WEB_E_JSON_VALUE_NOT_FOUND, "got hr %#lx.\n", hr );
+    WindowsDeleteString( name );
+
+    name = create_hstring( L"nested" );
+    hr = IJsonObject_GetNamedObject( json_object, name, &nested );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    WindowsDeleteString( name );
+    name = create_hstring( L"a" );
+    hr = IJsonObject_GetNamedValue( nested, name, &member );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IJsonValue_get_ValueType( member, &type );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( type == JsonValueType_Object, "got type %d.\n", type );
+    hr = IJsonValue_Stringify( member, &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    check_string( str, L"{\"b\":true}" );
+    WindowsDeleteString( str );
+    IJsonValue_Release( member );
+    WindowsDeleteString( name );
+    IJsonObject_Release( nested );
+
+    name = create_hstring( L"list" );
+    hr = IJsonObject_GetNamedArray( json_object, name, &json_array );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    WindowsDeleteString( name );
+    hr = IJsonArray_GetNumberAt( json_array, 1, &number );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    ok( number == -2000.0, "got %f.\n", number );
+    hr = IJsonArray_GetStringAt( json_array, 2, &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    check_string( str, L"x" );
+    WindowsDeleteString( str );
+    hr = IJsonArray_GetBooleanAt( json_array, 3, &value );
+    ok( hr == E_ILLEGAL_METHOD_CALL, "got hr %#lx.\n", hr );
+    hr = IJsonArray_GetNumberAt( json_array, 6, &number );
+    ok( hr == E_BOUNDS, "got hr %#lx.\n", hr );
+    IJsonArray_Release( json_array );
+    IJsonObject_Release( json_object );
+
+    str = create_hstring( L"{\"a\": [1, -2e3, \"x\\n\", null, [], {}]}" );
+    hr = IJsonObjectStatics_Parse( object_statics, str, &json_object );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    WindowsDeleteString( str );
+    hr = IJsonObject_QueryInterface( json_object, &IID_IJsonValue, (void **)&json_value );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IJsonValue_Stringify( json_value, &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    check_string( str, L"{\"a\":[1,-2000,\"x\\n\",null,[],{}]}" );
+    WindowsDeleteString( str );
+    IJsonValue_Release( json_value );
+    IJsonObject_Release( json_object );
+
+    str = create_hstring( L"{}" );
+    hr = IJsonObjectStatics_Parse( object_statics, str, &json_object );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    WindowsDeleteString( str );
+    name = create_hstring( L"added" );
+    hr = IJsonValueStatics_CreateNumberValue( value_statics, 0.5, &member );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IJsonObject_SetNamedValue( json_object, name, member );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IJsonValue_Release( member );
+    WindowsDeleteString( name );
+    hr = IJsonObject_QueryInterface( json_object, &IID_IJsonValue, (void **)&json_value );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IJsonValue_Stringify( json_value, &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    check_string( str, L"{\"added\":0.5}" );
+    WindowsDeleteString( str );
+    IJsonValue_Release( json_value );
+    IJsonObject_Release( json_object );
+
+    /* escaped strings */
+    str = create_hstring( L"\"wine\\n\\u0041\\\\\"" );
+    hr = IJsonValueStatics_Parse( value_statics, str, &json_value );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    WindowsDeleteString( str );
+    hr = IJsonValue_GetString( json_value, &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    check_string( str, L"wine\nA\\" );
+    WindowsDeleteString( str );
+    IJsonValue_Release( json_value );
+
+    for (i = 0; i < ARRAY_SIZE(invalid); i++)
+    {
+        winetest_push_context( "%u", i );
+        str = create_hstring( invalid[i].input );
+        json_value = (void *)0xdeadbeef;
+        hr = IJsonValueStatics_Parse( value_statics, str, &json_value );
+        ok( hr == invalid[i].hr, "got hr %#lx.\n", hr );
+        succeeded = TRUE;
+        hr = IJsonValueStatics_TryParse( value_statics, str, &json_value, &succeeded );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        ok( !succeeded, "got succeeded %d.\n", succeeded );
+        ok( !json_value, "got value %p.\n", json_value );
+        WindowsDeleteString( str );
+        winetest_pop_context();
+    }
+
+    /* a larger document, to measure the throughput */
+    count = 20000;
+    big = malloc( count * 128 * sizeof(WCHAR) );
+    ptr = big;
+    *ptr++ = '[';
+    for (i = 0; i < count; i++)
+        ptr += swprintf( ptr, 128, L"%s{\"id\":%u,\"name\":\"item %u\",\"tags\":[\"a\",\"b\\n\"],\"ok\":true}",
+                         i ? L"," : L"", i, i );
+    *ptr++ = ']';
+    len = ptr - big;
+    hr = WindowsCreateString( big, len, &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    hr = IJsonValueStatics_Parse( value_statics, str, &json_value );
+    QueryPerformanceCounter( &end );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    trace( "parsed %u bytes in %.2f ms.\n", len * (UINT32)sizeof(WCHAR),
+           (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart );
+
+    hr = IJsonValue_GetArray( json_value, &json_array );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    for (i = 0; i < count; i += count / 10)
+    {
+        hr = IJsonArray_GetObjectAt( json_array, i, &json_object );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        name = create_hstring( L"id" );
+        hr = IJsonObject_GetNamedNumber( json_object, name, &number );
+        ok( hr == S_OK && number == i, "got hr %#lx, number %f.\n", hr, number );
+        WindowsDeleteString( name );
+        IJsonObject_Release( json_object );
+    }
+    IJsonArray_Release( json_array );
+
+    QueryPerformanceCounter( &start );
+    hr = IJsonValue_Stringify( json_value, &name );
+    QueryPerformanceCounter( &end );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    trace( "stringified %u bytes in %.2f ms.\n", len * (UINT32)sizeof(WCHAR),
+           (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart );
+    ok( WindowsGetStringLen( name ) == len, "got length %u.\n", WindowsGetStringLen( name ) );
+    WindowsDeleteString( name );
+    IJsonValue_Release( json_value );
+    WindowsDeleteString( str );
+    free( big );
+
+    IJsonObjectStatics_Release( object_statics );
+    IJsonValueStatics_Release( value_statics );
+    IActivationFactory_Release( object_factory );
+    IActivationFactory_Release( value_factory );
+}
+
 START_TEST(web)
 {
     HRESULT hr;
@@ -147,6 +410,7 @@ START_TEST(web)
 
     test_JsonObjectStatics();
     test_JsonValueStatics();
+    test_JsonParse();
 
     RoUninitialize();
 }
@@ -18,6 +18,10 @@
  */
 
 #include <stdarg.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define COBJMACROS
 
@@ -31,6 +35,22 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* The filtered modes resample separately in each direction, with the source pixels
+ * contributing to a destination pixel and their weights precomputed at initialization. */
+struct scaler_weights
+{
+    UINT taps;      /* number of source pixels contributing to each destination pixel */
+    UINT *start;    /* first contributing source pixel, for each destination pixel */
+    short *coeffs;  /* taps weights for each destination pixel, in 2.14 fixed point */
+};
+
+#define WEIGHT_SHIFT 14
+#define INTERMEDIATE_SHIFT 6  /* fraction bits kept between the horizontal and vertical passes */
+
+/* minimum number of destination pixels, and of rows per band, to scale in parallel */
+#define PARALLEL_MIN_PIXELS (512 * 512)
+#define PARALLEL_MIN_ROWS 32
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -40,6 +60,8 @@ typedef struct BitmapScaler {
     UINT src_width, src_height;
     WICBitmapInterpolationMode mode;
     UINT bpp;
+    UINT channels; /* 8-bit channels per pixel for the filtered modes, 0 for nearest neighbor */
+    struct scaler_weights x_weights, y_weights;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
     CRITICAL_SECTION lock; /* must be held when initialized */
@@ -106,6 +128,10 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        free(This->x_weights.start);
+        free(This->x_weights.coeffs);
+        free(This->y_weights.start);
+        free(This->y_weights.coeffs);
         free(This);
     }
 
@@ -203,6 +229,338 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+static double filter_linear(double x)
+{
+    x = fabs(x);
+    return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+/* Catmull-Rom spline */
+static double filter_cubic(double x)
+{
+    x = fabs(x);
+    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+static BOOL init_scaler_weights(struct scaler_weights *weights, WICBitmapInterpolationMode mode,
+    UINT src_size, UINT dst_size)
+{
+    double scale = (double)src_size / dst_size, filter_scale = 1.0, support, center, sum, *tmp;
+    double (*filter)(double) = NULL;
+    int i, lo, hi, start, total, largest;
+    UINT dst, j, taps;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeLinear:
+        filter = filter_linear;
+        support = 1.0;
+        break;
+    case WICBitmapInterpolationModeCubic:
+        filter = filter_cubic;
+        support = 2.0;
+        break;
+    case WICBitmapInterpolationModeHighQualityCubic:
+        /* widen the kernel when downscaling, so that every source pixel contributes */
+        filter = filter_cubic;
+        filter_scale = max(scale, 1.0);
+        support = 2.0 * filter_scale;
+        break;
+    default:
+        /* Fant, averages the source area covered by each destination pixel */
+        support = max(scale, 1.0) / 2.0;
+        break;
+    }
+
+    taps = min((UINT)ceil(2.0 * support) + 2, src_size);
+    weights->taps = taps;
+    weights->start = malloc(dst_size * sizeof(*weights->start));
+    weights->coeffs = malloc((size_t)dst_size * taps * sizeof(*weights->coeffs));
+    tmp = malloc(taps * sizeof(*tmp));
+    if (!weights->start || !weights->coeffs || !tmp)
+    {
+        free(weights->start);
+        free(weights->coeffs);
+        free(tmp);
+        weights->start = NULL;
+        weights->coeffs = NULL;
+        return FALSE;
+    }
+
+    for (dst = 0; dst < dst_size; dst++)
+    {
+        short *coeffs = weights->coeffs + dst * taps;
+
+        center = (dst + 0.5) * scale;
+        if (filter)
+        {
+            lo = (int)ceil(center - 0.5 - support);
+            hi = (int)floor(center - 0.5 + support);
+        }
+        else
+        {
+            lo = (int)floor(center - support);
+            hi = (int)ceil(center + support) - 1;
+        }
+        start = min(max(lo, 0), (int)(src_size - taps));
+
+        memset(tmp, 0, taps * sizeof(*tmp));
+        for (i = lo; i <= hi; i++)
+        {
+            double w;
+
+            if (filter)
+                w = filter((i + 0.5 - center) / filter_scale);
+            else
+                w = min(center + support, i + 1.0) - max(center - support, (double)i);
+            if (w == 0.0) continue;
+            tmp[min(max(i, 0), (int)src_size - 1) - start] += w;
+        }
+
+        sum = 0.0;
+        for (j = 0; j < taps; j++) sum += tmp[j];
+        total = largest = 0;
+        for (j = 0; j < taps; j++)
+        {
+            coeffs[j] = (short)floor(tmp[j] / sum * (1 << WEIGHT_SHIFT) + 0.5);
+            total += coeffs[j];
+            if (abs(coeffs[j]) > abs(coeffs[largest])) largest = j;
+        }
+        /* make sure that the weights add up exactly */
+        coeffs[largest] += (1 << WEIGHT_SHIFT) - total;
+        weights->start[dst] = start;
+    }
+
+    free(tmp);
+    return TRUE;
+}
+
+static void Filter_GetRequiredSourceRect(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    src_rect->X = This->x_weights.start[x];
+    src_rect->Y = This->y_weights.start[y];
+    src_rect->Width = This->x_weights.taps;
+    src_rect->Height = This->y_weights.taps;
+}
+
+static inline BYTE clamp_byte(int value)
+{
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+/* resample a source row horizontally into a row of intermediate values */
+static void filter_row_horizontal(const BitmapScaler *This, const BYTE *src, UINT src_x,
+    UINT dst_x, UINT dst_width, short *dst)
+{
+    const struct scaler_weights *weights = &This->x_weights;
+    UINT channels = This->channels, taps = weights->taps;
+    const int round = 1 << (WEIGHT_SHIFT - INTERMEDIATE_SHIFT - 1);
+    UINT x, c, j;
+
+#ifdef __SSE2__
+    if (channels == 4)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        for (x = dst_x; x < dst_x + dst_width; x++)
+        {
+            const BYTE *pixel = src + (weights->start[x] - src_x) * 4;
+            const short *coeffs = weights->coeffs + x * taps;
+            __m128i acc = _mm_set1_epi32(round), p;
+
+            /* two pixels at a time, interleaved per channel to multiply-add the pairs */
+            for (j = 0; j + 1 < taps; j += 2, pixel += 8)
+            {
+                p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pixel), zero);
+                p = _mm_unpacklo_epi16(p, _mm_srli_si128(p, 8));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(p,
+                    _mm_set1_epi32((unsigned short)coeffs[j] | ((unsigned int)(unsigned short)coeffs[j + 1] << 16))));
+            }
+            if (j < taps)
+            {
+                p = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int *)pixel), zero);
+                p = _mm_unpacklo_epi16(p, zero);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(p, _mm_set1_epi32((unsigned short)coeffs[j])));
+            }
+            acc = _mm_srai_epi32(acc, WEIGHT_SHIFT - INTERMEDIATE_SHIFT);
+            _mm_storel_epi64((__m128i *)dst, _mm_packs_epi32(acc, acc));
+            dst += 4;
+        }
+        return;
+    }
+#endif
+
+    for (x = dst_x; x < dst_x + dst_width; x++)
+    {
+        const BYTE *pixel = src + (weights->start[x] - src_x) * channels;
+        const short *coeffs = weights->coeffs + x * taps;
+
+        for (c = 0; c < channels; c++)
+        {
+            int acc = round;
+
+            for (j = 0; j < taps; j++)
+                acc += pixel[j * channels + c] * coeffs[j];
+            *dst++ = acc >> (WEIGHT_SHIFT - INTERMEDIATE_SHIFT);
+        }
+    }
+}
+
+/* resample intermediate rows vertically into a destination row */
+static void filter_row_vertical(short **rows, const short *coeffs, UINT taps, UINT count, BYTE *dst)
+{
+    const int shift = WEIGHT_SHIFT + INTERMEDIATE_SHIFT, round = 1 << (shift - 1);
+    UINT i = 0, j;
+
+#ifdef __SSE2__
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i lo = _mm_set1_epi32(round), hi = lo, a, b, w;
+
+        /* two rows at a time, interleaved to multiply-add the pairs */
+        for (j = 0; j + 1 < taps; j += 2)
+        {
+            a = _mm_loadu_si128((const __m128i *)(rows[j] + i));
+            b = _mm_loadu_si128((const __m128i *)(rows[j + 1] + i));
+            w = _mm_set1_epi32((unsigned short)coeffs[j] | ((unsigned int)(unsigned short)coeffs[j + 1] << 16));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        if (j < taps)
+        {
+            a = _mm_loadu_si128((const __m128i *)(rows[j] + i));
+            w = _mm_set1_epi32((unsigned short)coeffs[j]);
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, _mm_setzero_si128()), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, _mm_setzero_si128()), w));
+        }
+        lo = _mm_packs_epi32(_mm_srai_epi32(lo, shift), _mm_srai_epi32(hi, shift));
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(lo, lo));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        int acc = round;
+
+        for (j = 0; j < taps; j++)
+            acc += rows[j][i] * coeffs[j];
+        dst[i] = clamp_byte(acc >> shift);
+    }
+}
+
+struct filter_context
+{
+    const BitmapScaler *scaler;
+    const WICRect *dest_rect;
+    const WICRect *src_rect;
+    const BYTE *src_bits;
+    UINT src_stride;
+    BYTE *dst_bits;
+    UINT dst_stride;
+    UINT band_rows;
+    LONG next_band;
+    LONG failed;
+};
+
+/* scale a band of destination rows, returns FALSE on allocation failure */
+static BOOL filter_band(const struct filter_context *ctx, UINT first, UINT count)
+{
+    const BitmapScaler *This = ctx->scaler;
+    const struct scaler_weights *weights = &This->y_weights;
+    UINT row_size = ctx->dest_rect->Width * This->channels;
+    UINT y, j, src_first, src_count, dst_y = ctx->dest_rect->Y + first;
+    short *buffer, **rows;
+
+    src_first = weights->start[dst_y];
+    src_count = weights->start[dst_y + count - 1] + weights->taps - src_first;
+
+    buffer = malloc((size_t)src_count * row_size * sizeof(*buffer));
+    rows = malloc(weights->taps * sizeof(*rows));
+    if (!buffer || !rows)
+    {
+        free(buffer);
+        free(rows);
+        return FALSE;
+    }
+
+    for (y = 0; y < src_count; y++)
+        filter_row_horizontal(This, ctx->src_bits + (src_first + y - ctx->src_rect->Y) * ctx->src_stride,
+            ctx->src_rect->X, ctx->dest_rect->X, ctx->dest_rect->Width, buffer + y * row_size);
+
+    for (y = dst_y; y < dst_y + count; y++)
+    {
+        for (j = 0; j < weights->taps; j++)
+            rows[j] = buffer + (weights->start[y] - src_first + j) * row_size;
+        filter_row_vertical(rows, weights->coeffs + y * weights->taps, weights->taps, row_size,
+            ctx->dst_bits + (y - ctx->dest_rect->Y) * ctx->dst_stride);
+    }
+
+    free(rows);
+    free(buffer);
+    return TRUE;
+}
+
+static void filter_bands(struct filter_context *ctx)
+{
+    UINT height = ctx->dest_rect->Height;
+    LONG band;
+
+    while ((band = InterlockedIncrement(&ctx->next_band) - 1) * ctx->band_rows < height)
+    {
+        UINT first = band * ctx->band_rows;
+        if (!filter_band(ctx, first, min(ctx->band_rows, height - first)))
+            InterlockedExchange(&ctx->failed, TRUE);
+    }
+}
+
+static void CALLBACK filter_bands_callback(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work)
+{
+    filter_bands(context);
+}
+
+static HRESULT Filter_CopyRect(BitmapScaler *This, const WICRect *dest_rect, const WICRect *src_rect,
+    const BYTE *src_bits, UINT src_stride, BYTE *buffer, UINT stride)
+{
+    struct filter_context ctx;
+    UINT threads = 1, i;
+    SYSTEM_INFO info;
+    TP_WORK *work;
+
+    ctx.scaler = This;
+    ctx.dest_rect = dest_rect;
+    ctx.src_rect = src_rect;
+    ctx.src_bits = src_bits;
+    ctx.src_stride = src_stride;
+    ctx.dst_bits = buffer;
+    ctx.dst_stride = stride;
+    ctx.band_rows = dest_rect->Height;
+    ctx.next_band = 0;
+    ctx.failed = FALSE;
+
+    /* split large images into bands of rows, scaled in parallel on the thread pool */
+    if ((ULONGLONG)dest_rect->Width * dest_rect->Height >= PARALLEL_MIN_PIXELS)
+    {
+        GetSystemInfo(&info);
+        threads = min(info.dwNumberOfProcessors, dest_rect->Height / PARALLEL_MIN_ROWS);
+    }
+
+    if (threads > 1 && (work = CreateThreadpoolWork(filter_bands_callback, &ctx, NULL)))
+    {
+        /* a few bands per thread to balance the load */
+        ctx.band_rows = max((dest_rect->Height + threads * 4 - 1) / (threads * 4), PARALLEL_MIN_ROWS);
+        for (i = 1; i < threads; i++) SubmitThreadpoolWork(work);
+        filter_bands(&ctx);
+        WaitForThreadpoolWorkCallbacks(work, FALSE);
+        CloseThreadpoolWork(work);
+    }
+    else filter_bands(&ctx);
+
+    return ctx.failed ? E_OUTOFMEMORY : S_OK;
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -294,7 +652,11 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
         buffer_size, src_bits);
 
-    if (SUCCEEDED(hr))
+    if (SUCCEEDED(hr) && This->channels)
+    {
+        hr = Filter_CopyRect(This, &dest_rect, &src_rect, src_bits, src_bytesperrow, pbBuffer, cbStride);
+    }
+    else if (SUCCEEDED(hr))
     {
         for (y=0; y < dest_rect.Height; y++)
         {
@@ -312,6 +674,25 @@ end:
     return hr;
 }
 
+/* formats with 8-bit channels that can be interpolated */
+static UINT get_filter_channels(const WICPixelFormatGUID *format)
+{
+    if (IsEqualGUID(format, &GUID_WICPixelFormat8bppGray) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat8bppAlpha))
+        return 1;
+    if (IsEqualGUID(format, &GUID_WICPixelFormat24bppBGR) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat24bppRGB))
+        return 3;
+    if (IsEqualGUID(format, &GUID_WICPixelFormat32bppBGR) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat32bppBGRA) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat32bppPBGRA) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat32bppRGB) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat32bppRGBA) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat32bppPRGBA))
+        return 4;
+    return 0;
+}
+
 static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     IWICBitmapSource *pISource, UINT uiWidth, UINT uiHeight,
     WICBitmapInterpolationMode mode)
@@ -351,8 +732,31 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+        case WICBitmapInterpolationModeHighQualityCubic:
+            if ((This->channels = get_filter_channels(&src_pixelformat)))
+            {
+                if (!init_scaler_weights(&This->x_weights, mode, This->src_width, This->width) ||
+                    !init_scaler_weights(&This->y_weights, mode, This->src_height, This->height))
+                {
+                    hr = E_OUTOFMEMORY;
+                    This->channels = 0;
+                    break;
+                }
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+                This->fn_get_required_source_rect = Filter_GetRequiredSourceRect;
+                This->fn_copy_scanline = NULL;
+                break;
+            }
+            FIXME("mode %i not supported for format %s, using nearest neighbor\n", mode,
+                  debugstr_guid(&src_pixelformat));
+            /* fall-through */
         default:
-            FIXME("unsupported mode %i\n", mode);
+            if (mode > WICBitmapInterpolationModeHighQualityCubic)
+                FIXME("unsupported mode %i\n", mode);
             /* fall-through */
         case WICBitmapInterpolationModeNearestNeighbor:
             if ((This->bpp % 8) == 0)
@@ -527,6 +931,9 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    This->channels = 0;
+    memset(&This->x_weights, 0, sizeof(This->x_weights));
+    memset(&This->y_weights, 0, sizeof(This->y_weights));
     InitializeCriticalSectionEx(&This->lock, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -1318,6 +1318,134 @@ static void test_bitmap_scaler(void)
     IWICBitmap_Release(bitmap);
 }
 
+static void test_bitmap_scaler_modes(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+        WICBitmapInterpolationModeHighQualityCubic,
+    };
+    static const struct
+    {
+        const GUID *format;
+        UINT bpp;
+    }
+    formats[] =
+    {
+        { &GUID_WICPixelFormat32bppBGRA, 32 },
+        { &GUID_WICPixelFormat8bppGray, 8 },
+    };
+    static const struct
+    {
+        UINT src_width, src_height, width, height;
+    }
+    sizes[] =
+    {
+        { 64, 48, 17, 13 },
+        { 17, 13, 64, 48 },
+        { 2048, 2048, 512, 512 },
+        { 512, 512, 2048, 2048 },
+    };
+    LARGE_INTEGER freq, start, end;
+    IWICBitmapScaler *scaler;
+    UINT i, j, k, x, bad;
+    IWICBitmap *bitmap;
+    BYTE *src, *dst;
+    HRESULT hr;
+
+    QueryPerformanceFrequency(&freq);
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+    {
+        UINT bytes = formats[i].bpp / 8;
+
+        for (k = 0; k < ARRAY_SIZE(sizes); k++)
+        {
+            UINT src_stride = sizes[k].src_width * bytes, stride = sizes[k].width * bytes;
+
+            src = malloc(src_stride * sizes[k].src_height);
+            dst = malloc(stride * sizes[k].height);
+            /* solid color, which all the filters must preserve */
+            memset(src, 0x80, src_stride * sizes[k].src_height);
+
+            hr = IWICImagingFactory_CreateBitmapFromMemory(factory, sizes[k].src_width, sizes[k].src_height,
+                formats[i].format, src_stride, src_stride * sizes[k].src_height, src, &bitmap);
+            ok(hr == S_OK, "Failed to create a bitmap, hr %#lx.\n", hr);
+
+            for (j = 0; j < ARRAY_SIZE(modes); j++)
+            {
+                winetest_push_context("format %u, size %u, mode %u", i, k, modes[j]);
+
+                hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+                ok(hr == S_OK, "Failed to create bitmap scaler, hr %#lx.\n", hr);
+                hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, sizes[k].width,
+                    sizes[k].height, modes[j]);
+                ok(hr == S_OK, "Failed to initialize bitmap scaler, hr %#lx.\n", hr);
+
+                memset(dst, 0, stride * sizes[k].height);
+                QueryPerformanceCounter(&start);
+                hr = IWICBitmapScaler_CopyPixels(scaler, NULL, stride, stride * sizes[k].height, dst);
+                QueryPerformanceCounter(&end);
+                ok(hr == S_OK, "Failed to copy pixels, hr %#lx.\n", hr);
+
+                for (x = bad = 0; x < stride * sizes[k].height; x++)
+                    if (abs(dst[x] - 0x80) > 1) bad++;
+                ok(!bad, "got %u unexpected values.\n", bad);
+
+                if (sizes[k].width * sizes[k].height >= 512 * 512)
+                    trace("%ux%u -> %ux%u in %lu us\n", sizes[k].src_width, sizes[k].src_height,
+                          sizes[k].width, sizes[k].height,
+                          (ULONG)((end.QuadPart - start.QuadPart) * 1000000 / freq.QuadPart));
+
+                IWICBitmapScaler_Release(scaler);
+                winetest_pop_context();
+            }
+
+            IWICBitmap_Release(bitmap);
+            free(dst);
+            free(src);
+        }
+    }
+}
+
+static void test_bitmap_scaler_fant(void)
+{
+    static const BYTE src[] =
+    {
+        0x00, 0xff, 0x00, 0xff,
+        0xff, 0x00, 0xff, 0x00,
+        0x00, 0x00, 0xff, 0xff,
+        0x00, 0x00, 0xff, 0xff,
+    };
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    BYTE dst[4];
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 4, &GUID_WICPixelFormat8bppGray,
+        4, sizeof(src), (BYTE *)src, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#lx.\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "Failed to create bitmap scaler, hr %#lx.\n", hr);
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 2, 2,
+        WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "Failed to initialize bitmap scaler, hr %#lx.\n", hr);
+
+    /* each destination pixel averages a 2x2 block */
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 2, sizeof(dst), dst);
+    ok(hr == S_OK, "Failed to copy pixels, hr %#lx.\n", hr);
+    ok(abs(dst[0] - 0x80) <= 1, "got %#x.\n", dst[0]);
+    ok(abs(dst[1] - 0x80) <= 1, "got %#x.\n", dst[1]);
+    ok(dst[2] == 0x00, "got %#x.\n", dst[2]);
+    ok(dst[3] == 0xff, "got %#x.\n", dst[3]);
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+}
+
 static LONG obj_refcount(void *obj)
 {
     IUnknown_AddRef((IUnknown *)obj);
@@ -1494,6 +1622,8 @@ START_TEST(bitmap)
     test_CreateBitmapFromHBITMAP();
     test_clipper();
     test_bitmap_scaler();
+    test_bitmap_scaler_modes();
+    test_bitmap_scaler_fant();
 
     IWICImagingFactory_Release(factory);
 
@@ -14242,6 +14242,83 @@ static void test_broadcast(void)
     closesocket(s);
 }
 
+static void test_udp_throughput(void)
+{
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    char buffer[256], data[64] = {0};
+    LARGE_INTEGER freq, start, end;
+    OVERLAPPED overlapped = {0};
+    DWORD size, flags = 0;
+    WSABUF wsabuf;
+    SOCKET server, client;
+    unsigned int i;
+    HANDLE event;
+    int ret, len;
+
+    server = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(server != INVALID_SOCKET, "got error %u.\n", WSAGetLastError());
+    ret = bind(server, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!ret, "got error %u.\n", WSAGetLastError());
+    len = sizeof(addr);
+    ret = getsockname(server, (struct sockaddr *)&addr, &len);
+    ok(!ret, "got error %u.\n", WSAGetLastError());
+
+    client = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(client != INVALID_SOCKET, "got error %u.\n", WSAGetLastError());
+    ret = connect(client, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!ret, "got error %u.\n", WSAGetLastError());
+
+    /* ping-pong over loopback, so that the kernel never drops anything */
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < 20000; i++)
+    {
+        data[0] = i;
+        if ((ret = send(client, data, sizeof(data), 0)) != sizeof(data)) break;
+        if ((ret = recv(server, buffer, sizeof(buffer), 0)) != sizeof(data) || buffer[0] != data[0]) break;
+    }
+    QueryPerformanceCounter(&end);
+    ok(i == 20000, "got %d, error %u after %u packets.\n", ret, WSAGetLastError(), i);
+    trace("udp loopback: %.0f packets/s\n", i * (double)freq.QuadPart / (end.QuadPart - start.QuadPart));
+
+    /* a pending receive is completed by the next datagram */
+    event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    overlapped.hEvent = event;
+    wsabuf.buf = buffer;
+    wsabuf.len = sizeof(buffer);
+    ret = WSARecv(server, &wsabuf, 1, NULL, &flags, &overlapped, NULL);
+    ok(ret == -1 && WSAGetLastError() == ERROR_IO_PENDING, "got %d, error %u.\n", ret, WSAGetLastError());
+    ret = send(client, "data", 4, 0);
+    ok(ret == 4, "got %d, error %u.\n", ret, WSAGetLastError());
+    ret = WaitForSingleObject(event, 1000);
+    ok(!ret, "wait timed out.\n");
+    ret = WSAGetOverlappedResult(server, &overlapped, &size, FALSE, &flags);
+    ok(ret, "got error %u.\n", WSAGetLastError());
+    ok(size == 4, "got size %lu.\n", size);
+    ok(!memcmp(buffer, "data", 4), "got %s.\n", debugstr_an(buffer, size));
+
+    /* data received before selecting events doesn't leave a stale FD_READ behind */
+    ret = send(client, "data", 4, 0);
+    ok(ret == 4, "got %d, error %u.\n", ret, WSAGetLastError());
+    ret = recv(server, buffer, sizeof(buffer), 0);
+    ok(ret == 4, "got %d, error %u.\n", ret, WSAGetLastError());
+    ResetEvent(event);
+    ret = WSAEventSelect(server, event, FD_READ);
+    ok(!ret, "got error %u.\n", WSAGetLastError());
+    ret = WaitForSingleObject(event, 100);
+    ok(ret == WAIT_TIMEOUT, "got %d.\n", ret);
+    ret = send(client, "data", 4, 0);
+    ok(ret == 4, "got %d, error %u.\n", ret, WSAGetLastError());
+    ret = WaitForSingleObject(event, 1000);
+    ok(!ret, "wait timed out.\n");
+    ret = recv(server, buffer, sizeof(buffer), 0);
+    ok(ret == 4, "got %d, error %u.\n", ret, WSAGetLastError());
+
+    CloseHandle(event);
+    closesocket(client);
+    closesocket(server);
+}
+
 START_TEST( sock )
 {
     int i;
@@ -14325,6 +14402,7 @@ START_TEST( sock )
     test_connect_udp();
     test_tcp_sendto_recvfrom();
     test_broadcast();
+    test_udp_throughput();
 
     /* There is apparently an obscure interaction between this test and
      * test_WSAGetOverlappedResult().
@@ -0,0 +1,115 @@
+/*
+ * Compiled AppxManifest.xml index
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINE_APPXINDEX_H
+#define __WINE_WINE_APPXINDEX_H
+
+/* The manifest of a package is compiled by windows.applicationmodel into a
+ * flat, read-only index, which is then used by it and by combase instead of
+ * parsing the XML on every launch. The index is stored next to the manifest,
+ * or in the prefix cache when the package directory isn't writable, and is
+ * recompiled whenever the manifest write time or size changes. Reading and
+ * validating it is done by windows.applicationmodel; other modules get it
+ * through __wine_load_appx_index.
+ *
+ * All offsets are in bytes from the start of the index, strings are null
+ * terminated UTF-16 and a zero offset means that a value is absent. */
+
+#include <wchar.h>
+
+#include "windef.h"
+
+#define APPX_INDEX_MAGIC    0x58505041 /* "APPX" */
+#define APPX_INDEX_VERSION  1
+
+#define APPX_INDEX_NAME     L"AppxManifest.wineidx"
+
+struct appx_index_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD size;                    /* total size of the index */
+    DWORD reserved;
+    FILETIME manifest_time;        /* write time of the manifest the index was compiled from */
+    ULONGLONG manifest_size;       /* size of the manifest the index was compiled from */
+    DWORD identity_name;
+    DWORD identity_publisher;
+    DWORD identity_version;
+    DWORD identity_architecture;
+    DWORD display_name;
+    DWORD publisher_display_name;
+    DWORD capability_count;
+    DWORD capabilities;            /* array of capability_count string offsets */
+    DWORD application_count;
+    DWORD applications;            /* array of application_count struct appx_index_application */
+    DWORD class_count;
+    DWORD classes;                 /* array of class_count struct appx_index_class, sorted by id */
+};
+
+struct appx_index_application
+{
+    DWORD id;
+    DWORD executable;
+    DWORD entry_point;
+};
+
+enum appx_threading_model
+{
+    APPX_THREADING_BOTH,
+    APPX_THREADING_STA,
+    APPX_THREADING_MTA,
+};
+
+/* in-package activatable class, declared by a windows.activatableClass.inProcessServer extension */
+struct appx_index_class
+{
+    DWORD id;
+    DWORD path;                    /* server path, relative to the package directory */
+    DWORD threading_model;
+};
+
+static inline const WCHAR *appx_index_string( const struct appx_index_header *index, DWORD offset )
+{
+    if (!offset) return NULL;
+    return (const WCHAR *)((const char *)index + offset);
+}
+
+static inline const void *appx_index_array( const struct appx_index_header *index, DWORD offset )
+{
+    return (const char *)index + offset;
+}
+
+static inline const struct appx_index_class *appx_index_find_class( const struct appx_index_header *index,
+                                                                    const WCHAR *id )
+{
+    const struct appx_index_class *classes = appx_index_array( index, index->classes );
+    int min = 0, max = index->class_count - 1, pos, res;
+
+    while (min <= max)
+    {
+        pos = (min + max) / 2;
+        if (!(res = wcscmp( id, appx_index_string( index, classes[pos].id ) ))) return &classes[pos];
+        if (res < 0) max = pos - 1;
+        else min = pos + 1;
+    }
+    return NULL;
+}
+
+#endif  /* __WINE_WINE_APPXINDEX_H */
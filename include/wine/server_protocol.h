@@ -271,6 +271,14 @@ typedef struct
 } async_data_t;
 
 
+typedef struct
+{
+    obj_handle_t    wait;
+    unsigned int    status;
+    apc_param_t     information;
+} async_result_t;
+
+
 
 struct hw_msg_source
 {
@@ -923,11 +931,26 @@ typedef volatile struct
     int                  keystate_lock;
 } input_shm_t;
 
+typedef volatile struct
+{
+    user_handle_t        parent;
+    user_handle_t        owner;
+    unsigned int         style;
+    unsigned int         ex_style;
+    lparam_t             id;
+    mod_handle_t         instance;
+    lparam_t             user_data;
+    unsigned int         dpi_context;
+    rectangle_t          window_rect;
+    rectangle_t          client_rect;
+} window_shm_t;
+
 typedef volatile union
 {
     desktop_shm_t        desktop;
     queue_shm_t          queue;
     input_shm_t          input;
+    window_shm_t         window;
 } object_shm_t;
 
 typedef volatile struct
@@ -944,6 +967,65 @@ typedef struct
 } obj_locator_t;
 
 
+typedef volatile struct
+{
+    int                  type;
+    int                  state;
+    int                  param;
+    int                  waiters;
+    int                  abandoned;
+    int                  generation;
+    int                  pulse;
+    int                  pulse_wake;
+} fast_sync_shm_t;
+
+enum fast_sync_type
+{
+    FAST_SYNC_EVENT = 1,
+    FAST_SYNC_SEMAPHORE,
+    FAST_SYNC_MUTEX
+};
+
+
+typedef volatile struct
+{
+    unsigned int         flags;
+    unsigned int         __pad;
+} sock_shm_t;
+
+#define SOCK_SHM_FAST_RECV 0x01
+#define SOCK_SHM_FAST_SEND 0x02
+
+
+#define REQUEST_SHM_MAX_SLOTS   64
+#define REQUEST_SHM_HEADER_SIZE 0x1000
+#define REQUEST_SHM_SLOT_SIZE   0x4000
+
+typedef volatile struct
+{
+    int                  pending;
+    unsigned int         ready[REQUEST_SHM_MAX_SLOTS / 32];
+} request_shm_header_t;
+
+typedef volatile struct
+{
+    int                  state;
+    int                  client_waiting;
+    unsigned int         index;
+    int                  __pad[13];
+    struct request_max_size request;
+    struct request_max_size reply;
+    char                 data[REQUEST_SHM_SLOT_SIZE - 3 * sizeof(struct request_max_size)];
+} request_shm_slot_t;
+
+enum request_shm_state
+{
+    REQUEST_SHM_IDLE = 0,
+    REQUEST_SHM_REQUEST,
+    REQUEST_SHM_REPLY
+};
+
+
 
 
 
@@ -1086,6 +1168,21 @@ struct init_thread_reply
 
 
 
+struct init_request_shm_request
+{
+    struct request_header __header;
+    int          mapped;
+};
+struct init_request_shm_reply
+{
+    struct reply_header __header;
+    unsigned int slot;
+    char __pad_12[4];
+    mem_size_t   size;
+};
+
+
+
 struct terminate_process_request
 {
     struct request_header __header;
@@ -1687,6 +1784,47 @@ struct open_semaphore_reply
 
 
 
+struct init_fast_sync_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct init_fast_sync_reply
+{
+    struct reply_header __header;
+    mem_size_t   size;
+};
+
+
+
+struct get_fast_sync_obj_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_fast_sync_obj_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    int          type;
+    unsigned int access;
+    unsigned int generation;
+};
+
+
+
+struct wake_fast_sync_obj_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct wake_fast_sync_obj_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct create_file_request
 {
     struct request_header __header;
@@ -1914,6 +2052,20 @@ struct send_socket_reply
 
 
 
+struct get_socket_shm_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_socket_shm_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    char __pad_12[4];
+};
+
+
+
 struct socket_get_events_request
 {
     struct request_header __header;
@@ -2082,6 +2234,22 @@ struct get_image_map_address_reply
 
 
 
+struct get_image_reloc_data_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    client_ptr_t base;
+};
+struct get_image_reloc_data_reply
+{
+    struct reply_header __header;
+    obj_handle_t data;
+    /* VARARG(pages,uints); */
+    char __pad_12[4];
+};
+
+
+
 struct map_view_request
 {
     struct request_header __header;
@@ -3140,6 +3308,33 @@ struct register_async_reply
 
 
 
+struct create_file_async_request
+{
+    struct request_header __header;
+    int          type;
+    async_data_t async;
+};
+struct create_file_async_reply
+{
+    struct reply_header __header;
+    obj_handle_t wait;
+    char __pad_12[4];
+};
+
+
+
+struct set_async_results_fd_request
+{
+    struct request_header __header;
+    int          fd;
+};
+struct set_async_results_fd_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct cancel_async_request
 {
     struct request_header __header;
@@ -3151,6 +3346,7 @@ struct cancel_async_request
 struct cancel_async_reply
 {
     struct reply_header __header;
+    /* VARARG(waits,uints); */
 };
 
 
@@ -3381,6 +3577,7 @@ struct get_window_info_reply
     int            is_unicode;
     unsigned int   dpi_context;
     char __pad_36[4];
+    obj_locator_t  locator;
 };
 
 
@@ -5326,6 +5523,56 @@ struct query_completion_reply
 
 
 
+struct create_wait_completion_packet_request
+{
+    struct request_header __header;
+    unsigned int access;
+    /* VARARG(objattr,object_attributes); */
+};
+struct create_wait_completion_packet_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    char __pad_12[4];
+};
+
+
+
+struct associate_wait_completion_packet_request
+{
+    struct request_header __header;
+    obj_handle_t  packet;
+    obj_handle_t  completion;
+    obj_handle_t  target;
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    char __pad_52[4];
+};
+struct associate_wait_completion_packet_reply
+{
+    struct reply_header __header;
+    int           signaled;
+    char __pad_12[4];
+};
+
+
+
+struct cancel_wait_completion_packet_request
+{
+    struct request_header __header;
+    obj_handle_t  packet;
+    int           remove_signaled;
+    char __pad_20[4];
+};
+struct cancel_wait_completion_packet_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct set_completion_info_request
 {
     struct request_header __header;
@@ -5732,6 +5979,7 @@ enum request
     REQ_init_process_done,
     REQ_init_first_thread,
     REQ_init_thread,
+    REQ_init_request_shm,
     REQ_terminate_process,
     REQ_terminate_thread,
     REQ_get_process_info,
@@ -5768,6 +6016,9 @@ enum request
     REQ_release_semaphore,
     REQ_query_semaphore,
     REQ_open_semaphore,
+    REQ_init_fast_sync,
+    REQ_get_fast_sync_obj,
+    REQ_wake_fast_sync_obj,
     REQ_create_file,
     REQ_open_file_object,
     REQ_alloc_file_handle,
@@ -5781,6 +6032,7 @@ enum request
     REQ_unlock_file,
     REQ_recv_socket,
     REQ_send_socket,
+    REQ_get_socket_shm,
     REQ_socket_get_events,
     REQ_socket_send_icmp_id,
     REQ_socket_get_icmp_id,
@@ -5791,6 +6043,7 @@ enum request
     REQ_open_mapping,
     REQ_get_mapping_info,
     REQ_get_image_map_address,
+    REQ_get_image_reloc_data,
     REQ_map_view,
     REQ_map_image_view,
     REQ_map_builtin_view,
@@ -5856,6 +6109,8 @@ enum request
     REQ_set_serial_info,
     REQ_cancel_sync,
     REQ_register_async,
+    REQ_create_file_async,
+    REQ_set_async_results_fd,
     REQ_cancel_async,
     REQ_get_async_result,
     REQ_set_async_direct_result,
@@ -5985,6 +6240,9 @@ enum request
     REQ_add_completion,
     REQ_remove_completion,
     REQ_query_completion,
+    REQ_create_wait_completion_packet,
+    REQ_associate_wait_completion_packet,
+    REQ_cancel_wait_completion_packet,
     REQ_set_completion_info,
     REQ_add_fd_completion,
     REQ_set_fd_completion_mode,
@@ -6025,6 +6283,7 @@ union generic_request
     struct init_process_done_request init_process_done_request;
     struct init_first_thread_request init_first_thread_request;
     struct init_thread_request init_thread_request;
+    struct init_request_shm_request init_request_shm_request;
     struct terminate_process_request terminate_process_request;
     struct terminate_thread_request terminate_thread_request;
     struct get_process_info_request get_process_info_request;
@@ -6061,6 +6320,9 @@ union generic_request
     struct release_semaphore_request release_semaphore_request;
     struct query_semaphore_request query_semaphore_request;
     struct open_semaphore_request open_semaphore_request;
+    struct init_fast_sync_request init_fast_sync_request;
+    struct get_fast_sync_obj_request get_fast_sync_obj_request;
+    struct wake_fast_sync_obj_request wake_fast_sync_obj_request;
     struct create_file_request create_file_request;
     struct open_file_object_request open_file_object_request;
     struct alloc_file_handle_request alloc_file_handle_request;
@@ -6074,6 +6336,7 @@ union generic_request
     struct unlock_file_request unlock_file_request;
     struct recv_socket_request recv_socket_request;
     struct send_socket_request send_socket_request;
+    struct get_socket_shm_request get_socket_shm_request;
     struct socket_get_events_request socket_get_events_request;
     struct socket_send_icmp_id_request socket_send_icmp_id_request;
     struct socket_get_icmp_id_request socket_get_icmp_id_request;
@@ -6084,6 +6347,7 @@ union generic_request
     struct open_mapping_request open_mapping_request;
     struct get_mapping_info_request get_mapping_info_request;
     struct get_image_map_address_request get_image_map_address_request;
+    struct get_image_reloc_data_request get_image_reloc_data_request;
     struct map_view_request map_view_request;
     struct map_image_view_request map_image_view_request;
     struct map_builtin_view_request map_builtin_view_request;
@@ -6149,6 +6413,8 @@ union generic_request
     struct set_serial_info_request set_serial_info_request;
     struct cancel_sync_request cancel_sync_request;
     struct register_async_request register_async_request;
+    struct create_file_async_request create_file_async_request;
+    struct set_async_results_fd_request set_async_results_fd_request;
     struct cancel_async_request cancel_async_request;
     struct get_async_result_request get_async_result_request;
     struct set_async_direct_result_request set_async_direct_result_request;
@@ -6278,6 +6544,9 @@ union generic_request
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
     struct query_completion_request query_completion_request;
+    struct create_wait_completion_packet_request create_wait_completion_packet_request;
+    struct associate_wait_completion_packet_request associate_wait_completion_packet_request;
+    struct cancel_wait_completion_packet_request cancel_wait_completion_packet_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
     struct set_fd_completion_mode_request set_fd_completion_mode_request;
@@ -6316,6 +6585,7 @@ union generic_reply
     struct init_process_done_reply init_process_done_reply;
     struct init_first_thread_reply init_first_thread_reply;
     struct init_thread_reply init_thread_reply;
+    struct init_request_shm_reply init_request_shm_reply;
     struct terminate_process_reply terminate_process_reply;
     struct terminate_thread_reply terminate_thread_reply;
     struct get_process_info_reply get_process_info_reply;
@@ -6352,6 +6622,9 @@ union generic_reply
     struct release_semaphore_reply release_semaphore_reply;
     struct query_semaphore_reply query_semaphore_reply;
     struct open_semaphore_reply open_semaphore_reply;
+    struct init_fast_sync_reply init_fast_sync_reply;
+    struct get_fast_sync_obj_reply get_fast_sync_obj_reply;
+    struct wake_fast_sync_obj_reply wake_fast_sync_obj_reply;
     struct create_file_reply create_file_reply;
     struct open_file_object_reply open_file_object_reply;
     struct alloc_file_handle_reply alloc_file_handle_reply;
@@ -6365,6 +6638,7 @@ union generic_reply
     struct unlock_file_reply unlock_file_reply;
     struct recv_socket_reply recv_socket_reply;
     struct send_socket_reply send_socket_reply;
+    struct get_socket_shm_reply get_socket_shm_reply;
     struct socket_get_events_reply socket_get_events_reply;
     struct socket_send_icmp_id_reply socket_send_icmp_id_reply;
     struct socket_get_icmp_id_reply socket_get_icmp_id_reply;
@@ -6375,6 +6649,7 @@ union generic_reply
     struct open_mapping_reply open_mapping_reply;
     struct get_mapping_info_reply get_mapping_info_reply;
     struct get_image_map_address_reply get_image_map_address_reply;
+    struct get_image_reloc_data_reply get_image_reloc_data_reply;
     struct map_view_reply map_view_reply;
     struct map_image_view_reply map_image_view_reply;
     struct map_builtin_view_reply map_builtin_view_reply;
@@ -6440,6 +6715,8 @@ union generic_reply
     struct set_serial_info_reply set_serial_info_reply;
     struct cancel_sync_reply cancel_sync_reply;
     struct register_async_reply register_async_reply;
+    struct create_file_async_reply create_file_async_reply;
+    struct set_async_results_fd_reply set_async_results_fd_reply;
     struct cancel_async_reply cancel_async_reply;
     struct get_async_result_reply get_async_result_reply;
     struct set_async_direct_result_reply set_async_direct_result_reply;
@@ -6569,6 +6846,9 @@ union generic_reply
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
     struct query_completion_reply query_completion_reply;
+    struct create_wait_completion_packet_reply create_wait_completion_packet_reply;
+    struct associate_wait_completion_packet_reply associate_wait_completion_packet_reply;
+    struct cancel_wait_completion_packet_reply cancel_wait_completion_packet_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
     struct set_fd_completion_mode_reply set_fd_completion_mode_reply;
@@ -6599,7 +6879,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 837
+#define SERVER_PROTOCOL_VERSION 848
 
 /* ### protocol_version end ### */
 
@@ -0,0 +1,60 @@
+/*
+ * WinRT asynchronous operation helpers
+ *
+ * Copyright 2022 Bernhard Kölbl for CodeWeavers
+ * Copyright 2022 Rémi Bernon for CodeWeavers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINE_WINRTASYNC_H
+#define __WINE_WINE_WINRTASYNC_H
+
+/* The IIDs of IAsyncInfo, IAsyncAction, IAsyncOperation<boolean> and
+ * IAsyncOperation<IInspectable *> are expected to be instantiated by the
+ * module linking this library, usually by including windows.foundation.h
+ * after initguid.h. */
+
+#include "windows.foundation.h"
+
+/* Run the callback synchronously on the creating thread instead of queuing
+ * it to the thread pool, for operations whose result is readily available.
+ * The operation is already completed when the create function returns. */
+#define ASYNC_RUN_INLINE  0x0001
+/* Don't run the callback on creation, the caller has to run it later, on the
+ * thread of its choice, with async_operation_run_deferred. The callback is
+ * skipped if the operation has been canceled in the meantime. */
+#define ASYNC_RUN_DEFERRED 0x0002
+
+typedef HRESULT (WINAPI *async_action_callback)( IUnknown *invoker, IUnknown *param );
+typedef HRESULT (WINAPI *async_operation_boolean_callback)( IUnknown *invoker, IUnknown *param, BOOLEAN *result );
+typedef HRESULT (WINAPI *async_operation_uint32_callback)( IUnknown *invoker, IUnknown *param, UINT32 *result );
+typedef HRESULT (WINAPI *async_operation_inspectable_callback)( IUnknown *invoker, IUnknown *param, IInspectable **result );
+
+extern HRESULT async_action_create( IUnknown *invoker, IUnknown *param, async_action_callback callback,
+                                    DWORD flags, IAsyncAction **out );
+extern HRESULT async_operation_boolean_create( IUnknown *invoker, IUnknown *param, async_operation_boolean_callback callback,
+                                               DWORD flags, IAsyncOperation_boolean **out );
+/* for IAsyncOperation<T> where T is a 32-bit integer or enumeration type, iid and class_name describe T */
+extern HRESULT async_operation_uint32_create( const GUID *iid, const WCHAR *class_name, IUnknown *invoker, IUnknown *param,
+                                              async_operation_uint32_callback callback, DWORD flags, IAsyncOperation_UINT32 **out );
+/* for IAsyncOperation<T> where T is a runtime class or interface, iid describes T */
+extern HRESULT async_operation_inspectable_create( const GUID *iid, IUnknown *invoker, IUnknown *param,
+                                                   async_operation_inspectable_callback callback, DWORD flags,
+                                                   IAsyncOperation_IInspectable **out );
+/* run the callback of an operation created with ASYNC_RUN_DEFERRED, exactly once */
+extern void async_operation_run_deferred( IInspectable *operation );
+
+#endif /* __WINE_WINE_WINRTASYNC_H */
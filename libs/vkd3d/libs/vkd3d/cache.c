@@ -18,6 +18,15 @@
 
 #include "vkd3d_private.h"
 
+#ifndef _WIN32
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/file.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
 struct vkd3d_cache_entry_header
 {
     uint64_t hash;
@@ -252,3 +261,1135 @@ done:
     vkd3d_shader_cache_unlock(cache);
     return ret;
 }
+
+/* Persistent shader cache.
+ *
+ * Compiled SPIR-V is stored in the directory given by VKD3D_SHADER_CACHE_PATH,
+ * shared by all processes using it. The root file, vkd3d-shader.cache, holds
+ * the current generation of the cache, whose records are in
+ * vkd3d-shader.cache.<generation>. That file starts with a header followed by
+ * records appended one after the other. Records are never modified after they
+ * are written, except for their last use time, so lookups only need the file
+ * to be mapped and an in-memory index; they take no locks. Appends are
+ * serialised within a process by a mutex and between processes by a file lock.
+ *
+ * When the file grows beyond VKD3D_SHADER_CACHE_SIZE (in MiB), a background
+ * thread writes the most recently used half of the records to the file of the
+ * next generation and makes it current. The old file is marked as retired so
+ * that other processes switch on their next append. Since other processes may
+ * still have it open and mapped, it is never renamed over or truncated; it is
+ * deleted once that succeeds, which on Windows is after the last process has
+ * unmapped it. */
+
+#define VKD3D_DISK_CACHE_MAGIC          VKD3D_MAKE_TAG('V', 'S', 'C', 'F')
+#define VKD3D_DISK_CACHE_ROOT_MAGIC     VKD3D_MAKE_TAG('V', 'S', 'C', 'R')
+#define VKD3D_DISK_CACHE_VERSION        2
+#define VKD3D_DISK_CACHE_HEADER_SIZE    4096
+#define VKD3D_DISK_CACHE_DEFAULT_SIZE   256
+#define VKD3D_DISK_CACHE_MIN_RESERVE    0x100000
+#define VKD3D_DISK_CACHE_COMPACT_RETRY  64
+
+struct vkd3d_disk_cache_root
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t generation;
+    /* the oldest generation whose file may not have been deleted yet */
+    uint32_t oldest;
+};
+
+struct vkd3d_disk_cache_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t data_end;
+    uint64_t clock;
+    uint32_t retired;
+    uint32_t padding;
+    char shader_version[64];
+};
+
+struct vkd3d_disk_cache_record
+{
+    uint64_t hash;
+    uint64_t last_use;
+    uint32_t size;
+    uint32_t key_size;
+    uint32_t value_size;
+    uint32_t checksum;
+};
+
+struct disk_cache_entry
+{
+    uint64_t hash;
+    uint64_t offset;
+    uint32_t touched;
+    struct disk_cache_entry *next;
+};
+
+struct disk_cache_index
+{
+    size_t mask;
+    size_t count;
+    struct disk_cache_index *next;
+    struct disk_cache_entry * volatile slots[];
+};
+
+struct disk_cache_map
+{
+    const uint8_t *data;
+    uint64_t size;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+    struct disk_cache_map *next;
+};
+
+#ifdef _WIN32
+typedef HANDLE disk_cache_fd;
+#else
+typedef int disk_cache_fd;
+#endif
+
+/* One generation of the cache file. Retired generations, maps and indices
+ * are kept until the cache is closed, since lookups may still use them. */
+struct disk_cache_file
+{
+    disk_cache_fd fd;
+    uint32_t generation;
+    uint64_t reserved;
+    uint64_t scanned_end;
+    struct disk_cache_map * volatile map;
+    struct disk_cache_index * volatile index;
+    struct disk_cache_entry *entries;
+    struct disk_cache_file *next;
+};
+
+struct vkd3d_shader_disk_cache
+{
+    struct vkd3d_instance *instance;
+    char *path;
+    uint64_t max_size;
+    uint64_t clock;
+
+    struct vkd3d_mutex mutex;
+    struct disk_cache_file * volatile file;
+    struct disk_cache_file *retired;
+
+    union vkd3d_thread_handle thread;
+    bool thread_started;
+    /* set while the compaction thread runs */
+    bool compacting;
+    /* appends to skip before retrying a failed compaction */
+    unsigned int compact_retry;
+};
+
+#ifdef _WIN32
+
+static bool disk_cache_open_fd(const char *path, disk_cache_fd *fd)
+{
+    *fd = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    return *fd != INVALID_HANDLE_VALUE;
+}
+
+static void disk_cache_close_fd(disk_cache_fd fd)
+{
+    CloseHandle(fd);
+}
+
+static uint64_t disk_cache_get_size(disk_cache_fd fd)
+{
+    LARGE_INTEGER size;
+
+    return GetFileSizeEx(fd, &size) ? size.QuadPart : 0;
+}
+
+static bool disk_cache_set_size(disk_cache_fd fd, uint64_t size)
+{
+    LARGE_INTEGER pos;
+
+    pos.QuadPart = size;
+    return SetFilePointerEx(fd, pos, NULL, FILE_BEGIN) && SetEndOfFile(fd);
+}
+
+static bool disk_cache_read(disk_cache_fd fd, void *data, size_t size, uint64_t offset)
+{
+    OVERLAPPED ov = {0};
+    DWORD count;
+
+    ov.Offset = offset;
+    ov.OffsetHigh = offset >> 32;
+    return ReadFile(fd, data, size, &count, &ov) && count == size;
+}
+
+static bool disk_cache_write(disk_cache_fd fd, const void *data, size_t size, uint64_t offset)
+{
+    OVERLAPPED ov = {0};
+    DWORD count;
+
+    ov.Offset = offset;
+    ov.OffsetHigh = offset >> 32;
+    return WriteFile(fd, data, size, &count, &ov) && count == size;
+}
+
+/* The lock is taken on a byte past any possible data so that it doesn't
+ * interfere with reads and writes. */
+static bool disk_cache_lock(disk_cache_fd fd, bool wait)
+{
+    OVERLAPPED ov = {0};
+
+    ov.Offset = ~0u;
+    ov.OffsetHigh = 0x7fffffff;
+    return LockFileEx(fd, LOCKFILE_EXCLUSIVE_LOCK | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY), 0, 1, 0, &ov);
+}
+
+static void disk_cache_unlock(disk_cache_fd fd)
+{
+    OVERLAPPED ov = {0};
+
+    ov.Offset = ~0u;
+    ov.OffsetHigh = 0x7fffffff;
+    UnlockFileEx(fd, 0, 1, 0, &ov);
+}
+
+static bool disk_cache_map_fd(disk_cache_fd fd, uint64_t size, struct disk_cache_map *map)
+{
+    if (!(map->mapping = CreateFileMappingA(fd, NULL, PAGE_READONLY, size >> 32, size, NULL)))
+        return false;
+    if (!(map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, size)))
+    {
+        CloseHandle(map->mapping);
+        return false;
+    }
+    map->size = size;
+    return true;
+}
+
+static void disk_cache_unmap(struct disk_cache_map *map)
+{
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+}
+
+static bool disk_cache_delete(const char *path)
+{
+    return DeleteFileA(path) || GetLastError() == ERROR_FILE_NOT_FOUND;
+}
+
+#else
+
+static bool disk_cache_open_fd(const char *path, disk_cache_fd *fd)
+{
+    return (*fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666)) != -1;
+}
+
+static void disk_cache_close_fd(disk_cache_fd fd)
+{
+    close(fd);
+}
+
+static uint64_t disk_cache_get_size(disk_cache_fd fd)
+{
+    struct stat st;
+
+    return fstat(fd, &st) ? 0 : st.st_size;
+}
+
+static bool disk_cache_set_size(disk_cache_fd fd, uint64_t size)
+{
+    return !ftruncate(fd, size);
+}
+
+static bool disk_cache_read(disk_cache_fd fd, void *data, size_t size, uint64_t offset)
+{
+    return pread(fd, data, size, offset) == size;
+}
+
+static bool disk_cache_write(disk_cache_fd fd, const void *data, size_t size, uint64_t offset)
+{
+    return pwrite(fd, data, size, offset) == size;
+}
+
+static bool disk_cache_lock(disk_cache_fd fd, bool wait)
+{
+    return !flock(fd, LOCK_EX | (wait ? 0 : LOCK_NB));
+}
+
+static void disk_cache_unlock(disk_cache_fd fd)
+{
+    flock(fd, LOCK_UN);
+}
+
+static bool disk_cache_map_fd(disk_cache_fd fd, uint64_t size, struct disk_cache_map *map)
+{
+    void *data;
+
+    if ((data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+        return false;
+    map->data = data;
+    map->size = size;
+    return true;
+}
+
+static void disk_cache_unmap(struct disk_cache_map *map)
+{
+    munmap((void *)map->data, map->size);
+}
+
+static bool disk_cache_delete(const char *path)
+{
+    return !unlink(path) || errno == ENOENT;
+}
+
+#endif
+
+static uint32_t disk_cache_checksum(const struct vkd3d_disk_cache_record *record)
+{
+    uint64_t hash = vkd3d_shader_cache_hash_key(record + 1, record->key_size + record->value_size);
+
+    return hash ^ (hash >> 32);
+}
+
+static void disk_cache_init_header(struct vkd3d_disk_cache_header *header)
+{
+    memset(header, 0, sizeof(*header));
+    header->magic = VKD3D_DISK_CACHE_MAGIC;
+    header->version = VKD3D_DISK_CACHE_VERSION;
+    header->data_end = VKD3D_DISK_CACHE_HEADER_SIZE;
+    header->clock = 1;
+    strncpy(header->shader_version, vkd3d_shader_get_version(NULL, NULL), sizeof(header->shader_version) - 1);
+}
+
+static bool disk_cache_header_is_valid(const struct vkd3d_disk_cache_header *header)
+{
+    struct vkd3d_disk_cache_header expect;
+
+    disk_cache_init_header(&expect);
+    return header->magic == expect.magic && header->version == expect.version
+            && header->data_end >= VKD3D_DISK_CACHE_HEADER_SIZE
+            && !memcmp(header->shader_version, expect.shader_version, sizeof(expect.shader_version));
+}
+
+static struct disk_cache_index *disk_cache_create_index(size_t size)
+{
+    struct disk_cache_index *index;
+
+    if (!(index = vkd3d_calloc(1, offsetof(struct disk_cache_index, slots[size]))))
+        return NULL;
+    index->mask = size - 1;
+    return index;
+}
+
+static void disk_cache_index_insert(struct disk_cache_index *index, struct disk_cache_entry *entry)
+{
+    size_t i;
+
+    for (i = entry->hash & index->mask; index->slots[i]; i = (i + 1) & index->mask)
+        ;
+    vkd3d_atomic_exchange_ptr((void * volatile *)&index->slots[i], entry);
+    ++index->count;
+}
+
+/* Add an entry for the record at the given offset, growing the index as needed.
+ * The cache mutex must be held. */
+static bool disk_cache_file_add_entry(struct disk_cache_file *file, uint64_t hash, uint64_t offset)
+{
+    struct disk_cache_index *index = file->index, *new_index;
+    struct disk_cache_entry *entry;
+    size_t i;
+
+    if ((index->count + 1) * 4 > (index->mask + 1) * 3)
+    {
+        if (!(new_index = disk_cache_create_index((index->mask + 1) * 2)))
+            return false;
+        for (i = 0; i <= index->mask; ++i)
+        {
+            if (index->slots[i])
+                disk_cache_index_insert(new_index, index->slots[i]);
+        }
+        new_index->next = index;
+        vkd3d_atomic_exchange_ptr((void * volatile *)&file->index, new_index);
+        index = new_index;
+    }
+
+    if (!(entry = vkd3d_malloc(sizeof(*entry))))
+        return false;
+    entry->hash = hash;
+    entry->offset = offset;
+    entry->touched = 0;
+    entry->next = file->entries;
+    file->entries = entry;
+    disk_cache_index_insert(index, entry);
+    return true;
+}
+
+/* Make sure the map covers at least the given size of the file.
+ * The cache mutex must be held. */
+static bool disk_cache_file_map(struct disk_cache_file *file, uint64_t size)
+{
+    struct disk_cache_map *map;
+
+    if (file->map && file->map->size >= size)
+        return true;
+
+    if (!(map = vkd3d_calloc(1, sizeof(*map))))
+        return false;
+    if (!disk_cache_map_fd(file->fd, size, map))
+    {
+        WARN("Failed to map %#"PRIx64" bytes of the shader cache.\n", size);
+        vkd3d_free(map);
+        return false;
+    }
+    map->next = file->map;
+    vkd3d_atomic_exchange_ptr((void * volatile *)&file->map, map);
+    return true;
+}
+
+/* Index the records appended since the last scan, up to the given end.
+ * The cache mutex must be held. */
+static void disk_cache_file_scan(struct disk_cache_file *file, uint64_t end)
+{
+    const struct vkd3d_disk_cache_record *record;
+    uint64_t size;
+
+    if (end <= file->scanned_end)
+        return;
+    if (file->reserved < end)
+        file->reserved = max(disk_cache_get_size(file->fd), end);
+    if (!disk_cache_file_map(file, file->reserved))
+        return;
+
+    while (end - file->scanned_end >= sizeof(*record))
+    {
+        record = (const struct vkd3d_disk_cache_record *)(file->map->data + file->scanned_end);
+        size = (uint64_t)record->key_size + record->value_size + sizeof(*record);
+        if (record->size < size || record->size > end - file->scanned_end || (record->size & 7))
+        {
+            WARN("Invalid record at %#"PRIx64" in the shader cache.\n", file->scanned_end);
+            file->scanned_end = end;
+            break;
+        }
+        if (!disk_cache_file_add_entry(file, record->hash, file->scanned_end))
+            break;
+        file->scanned_end += record->size;
+    }
+}
+
+static void disk_cache_file_destroy(struct disk_cache_file *file)
+{
+    struct disk_cache_index *index, *next_index;
+    struct disk_cache_entry *entry, *next_entry;
+    struct disk_cache_map *map, *next_map;
+
+    for (map = file->map; map; map = next_map)
+    {
+        next_map = map->next;
+        disk_cache_unmap(map);
+        vkd3d_free(map);
+    }
+    for (index = file->index; index; index = next_index)
+    {
+        next_index = index->next;
+        vkd3d_free(index);
+    }
+    for (entry = file->entries; entry; entry = next_entry)
+    {
+        next_entry = entry->next;
+        vkd3d_free(entry);
+    }
+    disk_cache_close_fd(file->fd);
+    vkd3d_free(file);
+}
+
+static char *disk_cache_get_file_path(const struct vkd3d_shader_disk_cache *cache, uint32_t generation)
+{
+    char *path;
+
+    if ((path = vkd3d_malloc(strlen(cache->path) + 12)))
+        sprintf(path, "%s.%u", cache->path, generation);
+    return path;
+}
+
+/* Open and lock the root file, resetting it if it is invalid. The root file is
+ * opened for each use, so that its lock also excludes other threads. */
+static bool disk_cache_lock_root(struct vkd3d_shader_disk_cache *cache, disk_cache_fd *fd,
+        struct vkd3d_disk_cache_root *root)
+{
+    if (!disk_cache_open_fd(cache->path, fd))
+    {
+        WARN("Failed to open shader cache %s.\n", debugstr_a(cache->path));
+        return false;
+    }
+    disk_cache_lock(*fd, true);
+
+    if (!disk_cache_read(*fd, root, sizeof(*root), 0) || root->magic != VKD3D_DISK_CACHE_ROOT_MAGIC
+            || root->version != VKD3D_DISK_CACHE_VERSION || root->oldest > root->generation)
+    {
+        TRACE("Initialising shader cache %s.\n", debugstr_a(cache->path));
+        root->magic = VKD3D_DISK_CACHE_ROOT_MAGIC;
+        root->version = VKD3D_DISK_CACHE_VERSION;
+        root->generation = 1;
+        root->oldest = 1;
+        if (!disk_cache_write(*fd, root, sizeof(*root), 0))
+        {
+            disk_cache_unlock(*fd);
+            disk_cache_close_fd(*fd);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void disk_cache_unlock_root(disk_cache_fd fd)
+{
+    disk_cache_unlock(fd);
+    disk_cache_close_fd(fd);
+}
+
+/* Delete the files of retired generations. This fails on Windows while any
+ * process still has the file mapped, in which case a later call retries.
+ * The root file must be locked. */
+static void disk_cache_delete_retired(struct vkd3d_shader_disk_cache *cache,
+        disk_cache_fd root_fd, struct vkd3d_disk_cache_root *root)
+{
+    uint32_t oldest = root->oldest;
+    bool deleted;
+    char *path;
+
+    while (root->oldest != root->generation)
+    {
+        if (!(path = disk_cache_get_file_path(cache, root->oldest)))
+            break;
+        deleted = disk_cache_delete(path);
+        vkd3d_free(path);
+        if (!deleted)
+            break;
+        ++root->oldest;
+    }
+
+    if (root->oldest != oldest)
+        disk_cache_write(root_fd, &root->oldest, sizeof(root->oldest),
+                offsetof(struct vkd3d_disk_cache_root, oldest));
+}
+
+/* Open the current generation of the cache file, resetting it if it was
+ * written by an incompatible version, and index its records. */
+static struct disk_cache_file *disk_cache_file_open(struct vkd3d_shader_disk_cache *cache)
+{
+    struct vkd3d_disk_cache_header header;
+    struct vkd3d_disk_cache_root root;
+    struct disk_cache_file *file;
+    unsigned int attempt;
+    disk_cache_fd root_fd;
+    bool opened, current;
+    char *path;
+
+    if (!(file = vkd3d_calloc(1, sizeof(*file))))
+        return NULL;
+    if (!(file->index = disk_cache_create_index(1024)))
+    {
+        vkd3d_free(file);
+        return NULL;
+    }
+
+    for (attempt = 0;; ++attempt)
+    {
+        /* Open the file with the root file locked, so that its generation
+         * can't be retired and deleted in between. Compaction locks the cache
+         * file before the root file, so it is locked after unlocking the root. */
+        if (attempt == 4 || !disk_cache_lock_root(cache, &root_fd, &root))
+            goto fail;
+        disk_cache_delete_retired(cache, root_fd, &root);
+        file->generation = root.generation;
+        path = disk_cache_get_file_path(cache, file->generation);
+        opened = path && disk_cache_open_fd(path, &file->fd);
+        vkd3d_free(path);
+        disk_cache_unlock_root(root_fd);
+        if (!opened)
+        {
+            WARN("Failed to open shader cache file %u.\n", file->generation);
+            goto fail;
+        }
+
+        disk_cache_lock(file->fd, true);
+        if (!disk_cache_read(file->fd, &header, sizeof(header), 0) || !disk_cache_header_is_valid(&header))
+        {
+            TRACE("Initialising shader cache file %u.\n", file->generation);
+            disk_cache_init_header(&header);
+            if (disk_cache_get_size(file->fd) < VKD3D_DISK_CACHE_HEADER_SIZE)
+                disk_cache_set_size(file->fd, VKD3D_DISK_CACHE_HEADER_SIZE);
+        }
+        if (!header.retired)
+            break;
+
+        /* retired in the meantime, unless the root file was reset since */
+        current = false;
+        if (disk_cache_lock_root(cache, &root_fd, &root))
+        {
+            current = root.generation == file->generation;
+            disk_cache_unlock_root(root_fd);
+        }
+        if (current)
+        {
+            disk_cache_init_header(&header);
+            break;
+        }
+        disk_cache_unlock(file->fd);
+        disk_cache_close_fd(file->fd);
+    }
+
+    cache->clock = ++header.clock;
+    disk_cache_write(file->fd, &header, sizeof(header), 0);
+    disk_cache_unlock(file->fd);
+
+    file->scanned_end = VKD3D_DISK_CACHE_HEADER_SIZE;
+    disk_cache_file_scan(file, header.data_end);
+    if (!file->map && !disk_cache_file_map(file, VKD3D_DISK_CACHE_HEADER_SIZE))
+    {
+        disk_cache_file_destroy(file);
+        return NULL;
+    }
+
+    TRACE("Opened shader cache file %u, %zu entries, %#"PRIx64" bytes.\n",
+            file->generation, file->index->count, header.data_end);
+    return file;
+
+fail:
+    vkd3d_free(file->index);
+    vkd3d_free(file);
+    return NULL;
+}
+
+/* Switch to a new generation of the cache file. The cache mutex must be held. */
+static void disk_cache_replace_file(struct vkd3d_shader_disk_cache *cache, struct disk_cache_file *file)
+{
+    struct disk_cache_file *old = cache->file;
+
+    vkd3d_atomic_exchange_ptr((void * volatile *)&cache->file, file);
+    old->next = cache->retired;
+    cache->retired = old;
+}
+
+struct disk_cache_compact_record
+{
+    uint64_t offset;
+    uint64_t last_use;
+};
+
+static int disk_cache_compare_last_use(const void *a, const void *b)
+{
+    const struct disk_cache_compact_record *ra = a, *rb = b;
+
+    return vkd3d_u64_compare(rb->last_use, ra->last_use);
+}
+
+/* Write the most recently used records to the file of the next generation and
+ * make it current. Returns false if the given file is still current. */
+static bool disk_cache_compact(struct vkd3d_shader_disk_cache *cache, struct disk_cache_file *file)
+{
+    struct disk_cache_compact_record *records = NULL;
+    const struct vkd3d_disk_cache_record *record;
+    struct vkd3d_disk_cache_header header;
+    size_t count = 0, capacity = 0, i;
+    struct vkd3d_disk_cache_root root;
+    uint64_t offset, size, total;
+    disk_cache_fd new_fd, root_fd;
+    bool written, retired = false;
+    struct disk_cache_map map;
+    char *path = NULL;
+
+    disk_cache_lock(file->fd, true);
+    if (!disk_cache_read(file->fd, &header, sizeof(header), 0))
+        goto done;
+    if (header.retired)
+    {
+        TRACE("Shader cache file %u was compacted by another process.\n", file->generation);
+        retired = true;
+        goto done;
+    }
+    if (!disk_cache_map_fd(file->fd, header.data_end, &map))
+        goto done;
+
+    for (offset = VKD3D_DISK_CACHE_HEADER_SIZE; header.data_end - offset >= sizeof(*record); offset += record->size)
+    {
+        record = (const struct vkd3d_disk_cache_record *)(map.data + offset);
+        size = (uint64_t)record->key_size + record->value_size + sizeof(*record);
+        if (record->size < size || record->size > header.data_end - offset || (record->size & 7))
+            break;
+        if (!vkd3d_array_reserve((void **)&records, &capacity, count + 1, sizeof(*records)))
+            break;
+        records[count].offset = offset;
+        records[count].last_use = record->last_use;
+        ++count;
+    }
+    qsort(records, count, sizeof(*records), disk_cache_compare_last_use);
+
+    if (!(path = disk_cache_get_file_path(cache, file->generation + 1)) || !disk_cache_open_fd(path, &new_fd))
+    {
+        WARN("Failed to create shader cache file %u.\n", file->generation + 1);
+        goto unmap;
+    }
+    /* Nobody uses the next generation before it is made current, but a
+     * previous compaction may have failed to write it. */
+    written = disk_cache_set_size(new_fd, 0);
+    offset = VKD3D_DISK_CACHE_HEADER_SIZE;
+    for (i = 0, total = 0; written && i < count; ++i)
+    {
+        record = (const struct vkd3d_disk_cache_record *)(map.data + records[i].offset);
+        if ((total += record->size) > cache->max_size / 2)
+            break;
+        if (!(written = disk_cache_write(new_fd, record, record->size, offset)))
+            break;
+        offset += record->size;
+    }
+    TRACE("Keeping %zu of %zu shader cache entries, %#"PRIx64" bytes.\n",
+            i, count, offset - VKD3D_DISK_CACHE_HEADER_SIZE);
+
+    header.data_end = offset;
+    if (written && disk_cache_write(new_fd, &header, sizeof(header), 0)
+            && disk_cache_lock_root(cache, &root_fd, &root))
+    {
+        /* if the root file was reset, the file is no longer current anyway */
+        if (root.generation != file->generation)
+            retired = true;
+        else
+        {
+            root.generation = file->generation + 1;
+            retired = disk_cache_write(root_fd, &root.generation, sizeof(root.generation),
+                    offsetof(struct vkd3d_disk_cache_root, generation));
+        }
+        if (retired)
+        {
+            header.retired = 1;
+            disk_cache_write(file->fd, &header.retired, sizeof(header.retired),
+                    offsetof(struct vkd3d_disk_cache_header, retired));
+            disk_cache_delete_retired(cache, root_fd, &root);
+        }
+        disk_cache_unlock_root(root_fd);
+    }
+    disk_cache_close_fd(new_fd);
+    if (!retired)
+    {
+        WARN("Failed to write shader cache file %u.\n", file->generation + 1);
+        disk_cache_delete(path);
+    }
+
+unmap:
+    disk_cache_unmap(&map);
+done:
+    disk_cache_unlock(file->fd);
+    vkd3d_free(records);
+    vkd3d_free(path);
+    return retired;
+}
+
+static void *disk_cache_compact_main(void *arg)
+{
+    struct vkd3d_shader_disk_cache *cache = arg;
+    struct disk_cache_file *file, *new_file = NULL;
+
+    vkd3d_set_thread_name("shader_cache");
+
+    vkd3d_mutex_lock(&cache->mutex);
+    file = cache->file;
+    vkd3d_mutex_unlock(&cache->mutex);
+
+    if (disk_cache_compact(cache, file))
+        new_file = disk_cache_file_open(cache);
+
+    vkd3d_mutex_lock(&cache->mutex);
+    if (new_file)
+        disk_cache_replace_file(cache, new_file);
+    else
+        cache->compact_retry = VKD3D_DISK_CACHE_COMPACT_RETRY;
+    cache->compacting = false;
+    vkd3d_mutex_unlock(&cache->mutex);
+    return NULL;
+}
+
+/* Start compacting the cache file, unless it is already being compacted or a
+ * recent compaction failed. The cache mutex must be held. */
+static void disk_cache_start_compaction(struct vkd3d_shader_disk_cache *cache)
+{
+    if (cache->compacting)
+        return;
+    if (cache->compact_retry)
+    {
+        --cache->compact_retry;
+        return;
+    }
+    /* the previous thread is done, or about to return */
+    if (cache->thread_started)
+        vkd3d_join_thread(cache->instance, &cache->thread);
+    cache->compacting = true;
+    if (!(cache->thread_started = SUCCEEDED(vkd3d_create_thread(cache->instance,
+            disk_cache_compact_main, cache, &cache->thread))))
+    {
+        cache->compacting = false;
+        cache->compact_retry = VKD3D_DISK_CACHE_COMPACT_RETRY;
+    }
+}
+
+struct vkd3d_shader_disk_cache *vkd3d_shader_disk_cache_open(struct vkd3d_instance *instance)
+{
+    struct vkd3d_shader_disk_cache *cache;
+    const char *dir;
+
+    if (!(dir = getenv("VKD3D_SHADER_CACHE_PATH")) || !*dir)
+        return NULL;
+
+    if (!(cache = vkd3d_calloc(1, sizeof(*cache))))
+        return NULL;
+    if (!(cache->path = vkd3d_malloc(strlen(dir) + sizeof("/vkd3d-shader.cache"))))
+    {
+        vkd3d_free(cache);
+        return NULL;
+    }
+    sprintf(cache->path, "%s/vkd3d-shader.cache", dir);
+    cache->instance = instance;
+    cache->max_size = (uint64_t)vkd3d_env_var_as_uint("VKD3D_SHADER_CACHE_SIZE",
+            VKD3D_DISK_CACHE_DEFAULT_SIZE) << 20;
+    vkd3d_mutex_init(&cache->mutex);
+
+    if (!(cache->file = disk_cache_file_open(cache)))
+    {
+        vkd3d_mutex_destroy(&cache->mutex);
+        vkd3d_free(cache->path);
+        vkd3d_free(cache);
+        return NULL;
+    }
+
+    vkd3d_mutex_lock(&cache->mutex);
+    if (cache->file->scanned_end > cache->max_size)
+        disk_cache_start_compaction(cache);
+    vkd3d_mutex_unlock(&cache->mutex);
+
+    return cache;
+}
+
+void vkd3d_shader_disk_cache_close(struct vkd3d_shader_disk_cache *cache)
+{
+    struct disk_cache_file *file, *next;
+
+    if (!cache)
+        return;
+
+    if (cache->thread_started)
+        vkd3d_join_thread(cache->instance, &cache->thread);
+
+    disk_cache_file_destroy(cache->file);
+    for (file = cache->retired; file; file = next)
+    {
+        next = file->next;
+        disk_cache_file_destroy(file);
+    }
+    vkd3d_mutex_destroy(&cache->mutex);
+    vkd3d_free(cache->path);
+    vkd3d_free(cache);
+}
+
+/* Look up a record without taking any lock. */
+static const struct vkd3d_disk_cache_record *disk_cache_find(struct vkd3d_shader_disk_cache *cache,
+        struct disk_cache_file *file, uint64_t hash, const void *key, size_t key_size)
+{
+    const struct vkd3d_disk_cache_record *record;
+    struct disk_cache_index *index = file->index;
+    struct disk_cache_entry *entry;
+    struct disk_cache_map *map;
+    size_t i;
+
+    for (i = hash & index->mask; (entry = index->slots[i]); i = (i + 1) & index->mask)
+    {
+        if (entry->hash != hash)
+            continue;
+
+        /* the map is published before the entries it covers, but may be read first */
+        map = file->map;
+        if (entry->offset + sizeof(*record) > map->size)
+            return NULL;
+        record = (const struct vkd3d_disk_cache_record *)(map->data + entry->offset);
+        if (record->size > map->size - entry->offset)
+            return NULL;
+        if (record->key_size != key_size || memcmp(record + 1, key, key_size))
+            continue;
+        if (disk_cache_checksum(record) != record->checksum)
+        {
+            WARN("Corrupted shader cache entry %#"PRIx64".\n", hash);
+            return NULL;
+        }
+
+        if (!vkd3d_atomic_exchange_u32(&entry->touched, 1))
+            disk_cache_write(file->fd, &cache->clock, sizeof(cache->clock),
+                    entry->offset + offsetof(struct vkd3d_disk_cache_record, last_use));
+        return record;
+    }
+    return NULL;
+}
+
+static bool disk_cache_get(struct vkd3d_shader_disk_cache *cache, uint64_t hash,
+        const void *key, size_t key_size, struct vkd3d_shader_code *value)
+{
+    const struct vkd3d_disk_cache_record *record;
+    struct disk_cache_file *file = cache->file;
+    const struct vkd3d_disk_cache_header *header;
+    void *data;
+
+    if (!(record = disk_cache_find(cache, file, hash, key, key_size)))
+    {
+        /* pick up the records appended by other processes since the last scan */
+        header = (const struct vkd3d_disk_cache_header *)file->map->data;
+        if (header->data_end <= file->scanned_end)
+            return false;
+        vkd3d_mutex_lock(&cache->mutex);
+        disk_cache_file_scan(file, header->data_end);
+        vkd3d_mutex_unlock(&cache->mutex);
+        if (!(record = disk_cache_find(cache, file, hash, key, key_size)))
+            return false;
+    }
+
+    if (!(data = vkd3d_memdup((const uint8_t *)(record + 1) + key_size, record->value_size)))
+        return false;
+    value->code = data;
+    value->size = record->value_size;
+    return true;
+}
+
+static void disk_cache_put(struct vkd3d_shader_disk_cache *cache, uint64_t hash,
+        const void *key, size_t key_size, const struct vkd3d_shader_code *value)
+{
+    struct vkd3d_disk_cache_record *record;
+    struct vkd3d_disk_cache_header header;
+    struct disk_cache_file *file, *new_file;
+    uint64_t size, reserve;
+
+    size = align(sizeof(*record) + key_size + value->size, 8);
+    if (size > UINT32_MAX || !(record = vkd3d_calloc(1, size)))
+        return;
+    record->hash = hash;
+    record->last_use = cache->clock;
+    record->size = size;
+    record->key_size = key_size;
+    record->value_size = value->size;
+    memcpy(record + 1, key, key_size);
+    memcpy((uint8_t *)(record + 1) + key_size, value->code, value->size);
+    record->checksum = disk_cache_checksum(record);
+
+    vkd3d_mutex_lock(&cache->mutex);
+
+    /* The compaction thread has the file locked, but that doesn't exclude
+     * other threads with flock(). Appends are best effort, so don't wait for
+     * it or for other processes. */
+    file = cache->file;
+    if (cache->compacting || !disk_cache_lock(file->fd, false))
+        goto done;
+
+    if (!disk_cache_read(file->fd, &header, sizeof(header), 0))
+        goto unlock;
+    if (header.retired)
+    {
+        disk_cache_unlock(file->fd);
+        if ((new_file = disk_cache_file_open(cache)))
+            disk_cache_replace_file(cache, new_file);
+        goto done;
+    }
+
+    disk_cache_file_scan(file, header.data_end);
+    if (disk_cache_find(cache, file, hash, key, key_size))
+        goto unlock;
+
+    if (header.data_end + size > cache->max_size)
+    {
+        disk_cache_start_compaction(cache);
+        goto unlock;
+    }
+
+    /* grow the file in large steps to avoid remapping it for each record */
+    if (header.data_end + size > file->reserved)
+    {
+        reserve = max(header.data_end + size, max(file->reserved * 2, VKD3D_DISK_CACHE_MIN_RESERVE));
+        reserve = min(reserve, max(cache->max_size, header.data_end + size));
+        if (disk_cache_get_size(file->fd) < reserve && !disk_cache_set_size(file->fd, reserve))
+            goto unlock;
+        file->reserved = reserve;
+    }
+
+    if (disk_cache_write(file->fd, record, size, header.data_end))
+    {
+        header.data_end += size;
+        disk_cache_write(file->fd, &header.data_end, sizeof(header.data_end),
+                offsetof(struct vkd3d_disk_cache_header, data_end));
+        disk_cache_file_scan(file, header.data_end);
+        TRACE("Stored shader cache entry %#"PRIx64", %#"PRIx64" bytes.\n", hash, size);
+    }
+
+unlock:
+    disk_cache_unlock(file->fd);
+done:
+    vkd3d_mutex_unlock(&cache->mutex);
+    vkd3d_free(record);
+}
+
+struct disk_cache_struct
+{
+    enum vkd3d_shader_structure_type type;
+    const void *next;
+};
+
+struct disk_cache_key
+{
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+};
+
+static void disk_cache_key_append(struct disk_cache_key *key, const void *data, size_t size)
+{
+    if (key->failed)
+        return;
+    if (!vkd3d_array_reserve((void **)&key->data, &key->capacity, key->size + size, 1))
+    {
+        key->failed = true;
+        return;
+    }
+    memcpy(key->data + key->size, data, size);
+    key->size += size;
+}
+
+static void disk_cache_key_append_u32(struct disk_cache_key *key, uint32_t value)
+{
+    disk_cache_key_append(key, &value, sizeof(value));
+}
+
+static void disk_cache_key_append_array(struct disk_cache_key *key, const void *data,
+        unsigned int count, size_t element_size)
+{
+    disk_cache_key_append_u32(key, count);
+    if (count)
+        disk_cache_key_append(key, data, count * element_size);
+}
+
+static void disk_cache_key_append_string(struct disk_cache_key *key, const char *str)
+{
+    disk_cache_key_append_array(key, str, str ? strlen(str) : 0, 1);
+}
+
+/* Serialise everything the compiler output depends on. Returns false if the
+ * compile info contains structures the cache doesn't know about. */
+static bool disk_cache_build_key(const struct vkd3d_shader_compile_info *compile_info, struct disk_cache_key *key)
+{
+    const struct vkd3d_shader_interface_info *interface_info = NULL;
+    const struct vkd3d_shader_transform_feedback_info *xfb_info;
+    const struct vkd3d_shader_descriptor_offset_info *offset_info;
+    const struct vkd3d_shader_spirv_target_info *spirv_info;
+    const struct disk_cache_struct *s;
+    unsigned int i;
+
+    memset(key, 0, sizeof(*key));
+    disk_cache_key_append_u32(key, compile_info->source_type);
+    disk_cache_key_append_u32(key, compile_info->target_type);
+    disk_cache_key_append_array(key, compile_info->options, compile_info->option_count,
+            sizeof(*compile_info->options));
+    disk_cache_key_append_array(key, compile_info->source.code, compile_info->source.size, 1);
+
+    for (s = compile_info->next; s; s = s->next)
+    {
+        disk_cache_key_append_u32(key, s->type);
+        switch (s->type)
+        {
+            case VKD3D_SHADER_STRUCTURE_TYPE_INTERFACE_INFO:
+                interface_info = (const struct vkd3d_shader_interface_info *)s;
+                disk_cache_key_append_array(key, interface_info->bindings, interface_info->binding_count,
+                        sizeof(*interface_info->bindings));
+                disk_cache_key_append_array(key, interface_info->push_constant_buffers,
+                        interface_info->push_constant_buffer_count, sizeof(*interface_info->push_constant_buffers));
+                disk_cache_key_append_array(key, interface_info->combined_samplers,
+                        interface_info->combined_sampler_count, sizeof(*interface_info->combined_samplers));
+                disk_cache_key_append_array(key, interface_info->uav_counters, interface_info->uav_counter_count,
+                        sizeof(*interface_info->uav_counters));
+                break;
+
+            case VKD3D_SHADER_STRUCTURE_TYPE_DESCRIPTOR_OFFSET_INFO:
+                /* the offset arrays are sized by the interface info */
+                if (!interface_info)
+                    return false;
+                offset_info = (const struct vkd3d_shader_descriptor_offset_info *)s;
+                disk_cache_key_append_u32(key, offset_info->descriptor_table_offset);
+                disk_cache_key_append_u32(key, offset_info->descriptor_table_count);
+                disk_cache_key_append_array(key, offset_info->binding_offsets,
+                        offset_info->binding_offsets ? interface_info->binding_count : 0,
+                        sizeof(*offset_info->binding_offsets));
+                disk_cache_key_append_array(key, offset_info->uav_counter_offsets,
+                        offset_info->uav_counter_offsets ? interface_info->uav_counter_count : 0,
+                        sizeof(*offset_info->uav_counter_offsets));
+                break;
+
+            case VKD3D_SHADER_STRUCTURE_TYPE_SPIRV_TARGET_INFO:
+                spirv_info = (const struct vkd3d_shader_spirv_target_info *)s;
+                disk_cache_key_append_string(key, spirv_info->entry_point);
+                disk_cache_key_append_u32(key, spirv_info->environment);
+                disk_cache_key_append_array(key, spirv_info->extensions, spirv_info->extension_count,
+                        sizeof(*spirv_info->extensions));
+                disk_cache_key_append_array(key, spirv_info->parameters, spirv_info->parameter_count,
+                        sizeof(*spirv_info->parameters));
+                disk_cache_key_append_u32(key, spirv_info->dual_source_blending);
+                disk_cache_key_append_array(key, spirv_info->output_swizzles, spirv_info->output_swizzle_count,
+                        sizeof(*spirv_info->output_swizzles));
+                break;
+
+            case VKD3D_SHADER_STRUCTURE_TYPE_TRANSFORM_FEEDBACK_INFO:
+                xfb_info = (const struct vkd3d_shader_transform_feedback_info *)s;
+                disk_cache_key_append_u32(key, xfb_info->element_count);
+                for (i = 0; i < xfb_info->element_count; ++i)
+                {
+                    const struct vkd3d_shader_transform_feedback_element *e = &xfb_info->elements[i];
+
+                    disk_cache_key_append_u32(key, e->stream_index);
+                    disk_cache_key_append_string(key, e->semantic_name);
+                    disk_cache_key_append_u32(key, e->semantic_index);
+                    disk_cache_key_append_u32(key, e->component_index | (e->component_count << 8)
+                            | (e->output_slot << 16));
+                }
+                disk_cache_key_append_array(key, xfb_info->buffer_strides, xfb_info->buffer_stride_count,
+                        sizeof(*xfb_info->buffer_strides));
+                break;
+
+            default:
+                TRACE("Not caching shader with structure type %#x.\n", s->type);
+                return false;
+        }
+    }
+
+    return !key->failed;
+}
+
+int vkd3d_shader_compile_cached(struct vkd3d_shader_disk_cache *cache,
+        const struct vkd3d_shader_compile_info *compile_info, struct vkd3d_shader_code *out)
+{
+    struct disk_cache_key key;
+    uint64_t hash;
+    int ret;
+
+    if (!cache)
+        return vkd3d_shader_compile(compile_info, out, NULL);
+
+    if (!disk_cache_build_key(compile_info, &key))
+    {
+        vkd3d_free(key.data);
+        return vkd3d_shader_compile(compile_info, out, NULL);
+    }
+
+    hash = vkd3d_shader_cache_hash_key(key.data, key.size);
+    if (disk_cache_get(cache, hash, key.data, key.size, out))
+    {
+        TRACE("Found shader %#"PRIx64" in the disk cache.\n", hash);
+        vkd3d_free(key.data);
+        return VKD3D_OK;
+    }
+
+    if ((ret = vkd3d_shader_compile(compile_info, out, NULL)) >= 0)
+        disk_cache_put(cache, hash, key.data, key.size, out);
+    vkd3d_free(key.data);
+    return ret;
+}
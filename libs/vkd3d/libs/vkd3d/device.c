@@ -2214,6 +2214,8 @@ static HRESULT d3d12_device_init_pipeline_cache(struct d3d12_device *device)
         device->vk_pipeline_cache = VK_NULL_HANDLE;
     }
 
+    device->shader_disk_cache = vkd3d_shader_disk_cache_open(device->vkd3d_instance);
+
     return S_OK;
 }
 
@@ -2223,6 +2225,7 @@ static void d3d12_device_destroy_pipeline_cache(struct d3d12_device *device)
 
     if (device->vk_pipeline_cache)
         VK_CALL(vkDestroyPipelineCache(device->vk_device, device->vk_pipeline_cache, NULL));
+    vkd3d_shader_disk_cache_close(device->shader_disk_cache);
 
     vkd3d_mutex_destroy(&device->pipeline_cache_mutex);
 }
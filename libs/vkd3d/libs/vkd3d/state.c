@@ -2206,7 +2206,7 @@ static HRESULT create_shader_stage(struct d3d12_device *device,
     compile_info.source_name = NULL;
 
     if ((ret = vkd3d_shader_parse_dxbc_source_type(&compile_info.source, &compile_info.source_type, NULL)) < 0
-            || (ret = vkd3d_shader_compile(&compile_info, &spirv, NULL)) < 0)
+            || (ret = vkd3d_shader_compile_cached(device->shader_disk_cache, &compile_info, &spirv)) < 0)
     {
         WARN("Failed to compile shader, vkd3d result %d.\n", ret);
         return hresult_from_vkd3d_result(ret);
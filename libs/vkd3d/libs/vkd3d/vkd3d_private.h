@@ -1543,6 +1543,7 @@ struct d3d12_device
     struct vkd3d_mutex pipeline_cache_mutex;
     struct vkd3d_render_pass_cache render_pass_cache;
     VkPipelineCache vk_pipeline_cache;
+    struct vkd3d_shader_disk_cache *shader_disk_cache;
 
     VkPhysicalDeviceMemoryProperties memory_properties;
 
@@ -1781,4 +1782,11 @@ int vkd3d_shader_cache_put(struct vkd3d_shader_cache *cache,
 int vkd3d_shader_cache_get(struct vkd3d_shader_cache *cache,
         const void *key, size_t key_size, void *value, size_t *value_size);
 
+struct vkd3d_shader_disk_cache;
+
+struct vkd3d_shader_disk_cache *vkd3d_shader_disk_cache_open(struct vkd3d_instance *instance);
+void vkd3d_shader_disk_cache_close(struct vkd3d_shader_disk_cache *cache);
+int vkd3d_shader_compile_cached(struct vkd3d_shader_disk_cache *cache,
+        const struct vkd3d_shader_compile_info *compile_info, struct vkd3d_shader_code *out);
+
 #endif  /* __VKD3D_PRIVATE_H */
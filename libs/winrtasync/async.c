@@ -0,0 +1,717 @@
+/*
+ * WinRT asynchronous operation helpers
+ *
+ * Copyright 2022 Bernhard Kölbl for CodeWeavers
+ * Copyright 2022 Rémi Bernon for CodeWeavers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COBJMACROS
+#include "windef.h"
+#include "winbase.h"
+#include "winstring.h"
+
+#include "activation.h"
+
+#define WIDL_using_Windows_Foundation
+#include "windows.foundation.h"
+
+#include "wine/winrtasync.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(winrt);
+
+#define Closed 4
+#define HANDLER_NOT_SET ((void *)~(ULONG_PTR)0)
+
+enum async_type
+{
+    ASYNC_ACTION,
+    ASYNC_OPERATION_BOOLEAN,
+    ASYNC_OPERATION_UINT32,
+    ASYNC_OPERATION_INSPECTABLE,
+};
+
+/* All the asynchronous object flavours share a single implementation, the
+ * typed interfaces differ only by their handler and GetResults signatures.
+ * Completion handlers are stored with the IInspectable type, which has the
+ * same layout as the typed handlers. */
+struct async_operation
+{
+    union
+    {
+        SLIST_ENTRY entry; /* free list link, only valid while in the pool */
+        IInspectable IInspectable_iface;
+        IAsyncAction IAsyncAction_iface;
+        IAsyncOperation_boolean IAsyncOperation_boolean_iface;
+        IAsyncOperation_UINT32 IAsyncOperation_UINT32_iface;
+        IAsyncOperation_IInspectable IAsyncOperation_IInspectable_iface;
+    };
+    IAsyncInfo IAsyncInfo_iface;
+    const GUID *iid;
+    const WCHAR *class_name;
+    LONG ref;
+
+    enum async_type type;
+    DWORD flags;
+    union
+    {
+        async_action_callback action;
+        async_operation_boolean_callback boolean;
+        async_operation_uint32_callback uint32;
+        async_operation_inspectable_callback inspectable;
+    } callback;
+    IUnknown *invoker;
+    IUnknown *param;
+
+    SRWLOCK lock;
+    IAsyncOperationCompletedHandler_IInspectable *handler;
+    union
+    {
+        BOOLEAN boolean;
+        UINT32 uint32;
+        IInspectable *inspectable;
+    } result;
+    AsyncStatus status;
+    HRESULT hr;
+};
+
+/* Released objects are kept around for reuse, as asynchronous operations are
+ * often created at a high rate and are very short lived. */
+#define ASYNC_POOL_MAX_DEPTH 64
+
+static SLIST_HEADER async_pool;
+static LONG async_pool_depth;
+
+static struct async_operation *async_operation_alloc(void)
+{
+    struct async_operation *impl;
+
+    if ((impl = (struct async_operation *)InterlockedPopEntrySList( &async_pool )))
+    {
+        InterlockedDecrement( &async_pool_depth );
+        memset( impl, 0, sizeof(*impl) );
+        return impl;
+    }
+
+    return calloc( 1, sizeof(*impl) );
+}
+
+static void async_operation_free( struct async_operation *impl )
+{
+    if (InterlockedIncrement( &async_pool_depth ) <= ASYNC_POOL_MAX_DEPTH)
+    {
+        InterlockedPushEntrySList( &async_pool, &impl->entry );
+        return;
+    }
+
+    InterlockedDecrement( &async_pool_depth );
+    free( impl );
+}
+
+static HRESULT async_operation_QueryInterface( struct async_operation *impl, REFIID iid, void **out )
+{
+    TRACE( "impl %p, iid %s, out %p.\n", impl, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, impl->iid ))
+    {
+        IInspectable_AddRef( (*out = &impl->IInspectable_iface) );
+        return S_OK;
+    }
+
+    if (IsEqualGUID( iid, &IID_IAsyncInfo ))
+    {
+        IAsyncInfo_AddRef( (*out = &impl->IAsyncInfo_iface) );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG async_operation_AddRef( struct async_operation *impl )
+{
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "impl %p, ref %lu.\n", impl, ref );
+    return ref;
+}
+
+static ULONG async_operation_Release( struct async_operation *impl )
+{
+    ULONG ref = InterlockedDecrement( &impl->ref );
+    TRACE( "impl %p, ref %lu.\n", impl, ref );
+
+    if (!ref)
+    {
+        if (impl->handler && impl->handler != HANDLER_NOT_SET) IAsyncOperationCompletedHandler_IInspectable_Release( impl->handler );
+        IAsyncInfo_Close( &impl->IAsyncInfo_iface );
+        if (impl->type == ASYNC_OPERATION_INSPECTABLE && impl->result.inspectable) IInspectable_Release( impl->result.inspectable );
+        if (impl->param) IUnknown_Release( impl->param );
+        if (impl->invoker) IUnknown_Release( impl->invoker );
+        async_operation_free( impl );
+    }
+
+    return ref;
+}
+
+static HRESULT async_operation_GetIids( struct async_operation *impl, ULONG *iid_count, IID **iids )
+{
+    FIXME( "impl %p, iid_count %p, iids %p stub!\n", impl, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT async_operation_GetRuntimeClassName( struct async_operation *impl, HSTRING *class_name )
+{
+    TRACE( "impl %p, class_name %p.\n", impl, class_name );
+
+    if (!impl->class_name)
+    {
+        FIXME( "impl %p, class_name %p stub!\n", impl, class_name );
+        return E_NOTIMPL;
+    }
+
+    return WindowsCreateString( impl->class_name, wcslen( impl->class_name ), class_name );
+}
+
+static HRESULT async_operation_GetTrustLevel( struct async_operation *impl, TrustLevel *trust_level )
+{
+    FIXME( "impl %p, trust_level %p stub!\n", impl, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT async_operation_put_Completed( struct async_operation *impl, IAsyncOperationCompletedHandler_IInspectable *handler )
+{
+    HRESULT hr = S_OK;
+
+    TRACE( "impl %p, handler %p.\n", impl, handler );
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (impl->status == Closed) hr = E_ILLEGAL_METHOD_CALL;
+    else if (impl->handler != HANDLER_NOT_SET) hr = E_ILLEGAL_DELEGATE_ASSIGNMENT;
+    else if ((impl->handler = handler))
+    {
+        IAsyncOperationCompletedHandler_IInspectable_AddRef( impl->handler );
+
+        if (impl->status > Started)
+        {
+            IAsyncOperation_IInspectable *operation = &impl->IAsyncOperation_IInspectable_iface;
+            AsyncStatus status = impl->status;
+            impl->handler = NULL; /* Prevent concurrent invoke. */
+            ReleaseSRWLockExclusive( &impl->lock );
+
+            IAsyncOperationCompletedHandler_IInspectable_Invoke( handler, operation, status );
+            IAsyncOperationCompletedHandler_IInspectable_Release( handler );
+
+            return S_OK;
+        }
+    }
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    return hr;
+}
+
+static HRESULT async_operation_get_Completed( struct async_operation *impl, IAsyncOperationCompletedHandler_IInspectable **handler )
+{
+    HRESULT hr = S_OK;
+
+    TRACE( "impl %p, handler %p.\n", impl, handler );
+
+    AcquireSRWLockShared( &impl->lock );
+    if (impl->status == Closed) hr = E_ILLEGAL_METHOD_CALL;
+    if (impl->handler == NULL || impl->handler == HANDLER_NOT_SET) *handler = NULL;
+    else IAsyncOperationCompletedHandler_IInspectable_AddRef( (*handler = impl->handler) );
+    ReleaseSRWLockShared( &impl->lock );
+
+    return hr;
+}
+
+#define DEFINE_ASYNC_OPERATION_IFACE( pfx, iface_type, handler_type )                                           \
+    static inline struct async_operation *impl_from_##iface_type( iface_type *iface )                         \
+    {                                                                                                         \
+        return CONTAINING_RECORD( iface, struct async_operation, iface_type##_iface );                         \
+    }                                                                                                         \
+    static HRESULT WINAPI pfx##_QueryInterface( iface_type *iface, REFIID iid, void **out )                   \
+    {                                                                                                         \
+        return async_operation_QueryInterface( impl_from_##iface_type( iface ), iid, out );                    \
+    }                                                                                                         \
+    static ULONG WINAPI pfx##_AddRef( iface_type *iface )                                                     \
+    {                                                                                                         \
+        return async_operation_AddRef( impl_from_##iface_type( iface ) );                                      \
+    }                                                                                                         \
+    static ULONG WINAPI pfx##_Release( iface_type *iface )                                                    \
+    {                                                                                                         \
+        return async_operation_Release( impl_from_##iface_type( iface ) );                                     \
+    }                                                                                                         \
+    static HRESULT WINAPI pfx##_GetIids( iface_type *iface, ULONG *iid_count, IID **iids )                    \
+    {                                                                                                         \
+        return async_operation_GetIids( impl_from_##iface_type( iface ), iid_count, iids );                    \
+    }                                                                                                         \
+    static HRESULT WINAPI pfx##_GetRuntimeClassName( iface_type *iface, HSTRING *class_name )                 \
+    {                                                                                                         \
+        return async_operation_GetRuntimeClassName( impl_from_##iface_type( iface ), class_name );             \
+    }                                                                                                         \
+    static HRESULT WINAPI pfx##_GetTrustLevel( iface_type *iface, TrustLevel *trust_level )                   \
+    {                                                                                                         \
+        return async_operation_GetTrustLevel( impl_from_##iface_type( iface ), trust_level );                  \
+    }                                                                                                         \
+    static HRESULT WINAPI pfx##_put_Completed( iface_type *iface, handler_type *handler )                     \
+    {                                                                                                         \
+        return async_operation_put_Completed( impl_from_##iface_type( iface ),                                 \
+                                              (IAsyncOperationCompletedHandler_IInspectable *)handler );       \
+    }                                                                                                         \
+    static HRESULT WINAPI pfx##_get_Completed( iface_type *iface, handler_type **handler )                    \
+    {                                                                                                         \
+        return async_operation_get_Completed( impl_from_##iface_type( iface ),                                 \
+                                              (IAsyncOperationCompletedHandler_IInspectable **)handler );      \
+    }
+
+DEFINE_ASYNC_OPERATION_IFACE( async_action, IAsyncAction, IAsyncActionCompletedHandler )
+
+static HRESULT WINAPI async_action_GetResults( IAsyncAction *iface )
+{
+    /* According to the docs, this function doesn't return anything, so it's left empty. */
+    TRACE( "iface %p.\n", iface );
+    return S_OK;
+}
+
+static const struct IAsyncActionVtbl async_action_vtbl =
+{
+    /* IUnknown methods */
+    async_action_QueryInterface,
+    async_action_AddRef,
+    async_action_Release,
+    /* IInspectable methods */
+    async_action_GetIids,
+    async_action_GetRuntimeClassName,
+    async_action_GetTrustLevel,
+    /* IAsyncAction methods */
+    async_action_put_Completed,
+    async_action_get_Completed,
+    async_action_GetResults,
+};
+
+DEFINE_ASYNC_OPERATION_IFACE( async_bool, IAsyncOperation_boolean, IAsyncOperationCompletedHandler_boolean )
+
+static HRESULT WINAPI async_bool_GetResults( IAsyncOperation_boolean *iface, BOOLEAN *results )
+{
+    struct async_operation *impl = impl_from_IAsyncOperation_boolean( iface );
+    HRESULT hr = E_ILLEGAL_METHOD_CALL;
+
+    TRACE( "iface %p, results %p.\n", iface, results );
+
+    *results = FALSE;
+    AcquireSRWLockShared( &impl->lock );
+    if (impl->status == Completed || impl->status == Error)
+    {
+        *results = impl->result.boolean;
+        hr = impl->hr;
+    }
+    ReleaseSRWLockShared( &impl->lock );
+
+    return hr;
+}
+
+static const struct IAsyncOperation_booleanVtbl async_bool_vtbl =
+{
+    /* IUnknown methods */
+    async_bool_QueryInterface,
+    async_bool_AddRef,
+    async_bool_Release,
+    /* IInspectable methods */
+    async_bool_GetIids,
+    async_bool_GetRuntimeClassName,
+    async_bool_GetTrustLevel,
+    /* IAsyncOperation<boolean> */
+    async_bool_put_Completed,
+    async_bool_get_Completed,
+    async_bool_GetResults,
+};
+
+DEFINE_ASYNC_OPERATION_IFACE( async_uint32, IAsyncOperation_UINT32, IAsyncOperationCompletedHandler_UINT32 )
+
+static HRESULT WINAPI async_uint32_GetResults( IAsyncOperation_UINT32 *iface, UINT32 *results )
+{
+    struct async_operation *impl = impl_from_IAsyncOperation_UINT32( iface );
+    HRESULT hr = E_ILLEGAL_METHOD_CALL;
+
+    TRACE( "iface %p, results %p.\n", iface, results );
+
+    *results = 0;
+    AcquireSRWLockShared( &impl->lock );
+    if (impl->status == Completed || impl->status == Error)
+    {
+        *results = impl->result.uint32;
+        hr = impl->hr;
+    }
+    ReleaseSRWLockShared( &impl->lock );
+
+    return hr;
+}
+
+static const struct IAsyncOperation_UINT32Vtbl async_uint32_vtbl =
+{
+    /* IUnknown methods */
+    async_uint32_QueryInterface,
+    async_uint32_AddRef,
+    async_uint32_Release,
+    /* IInspectable methods */
+    async_uint32_GetIids,
+    async_uint32_GetRuntimeClassName,
+    async_uint32_GetTrustLevel,
+    /* IAsyncOperation<UINT32> */
+    async_uint32_put_Completed,
+    async_uint32_get_Completed,
+    async_uint32_GetResults,
+};
+
+DEFINE_ASYNC_OPERATION_IFACE( async_inspectable, IAsyncOperation_IInspectable, IAsyncOperationCompletedHandler_IInspectable )
+
+static HRESULT WINAPI async_inspectable_GetResults( IAsyncOperation_IInspectable *iface, IInspectable **results )
+{
+    /* NOTE: Despite the name, this function only returns one result! */
+    struct async_operation *impl = impl_from_IAsyncOperation_IInspectable( iface );
+    HRESULT hr;
+
+    TRACE( "iface %p, results %p.\n", iface, results );
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (impl->status != Completed && impl->status != Error)
+        hr = E_ILLEGAL_METHOD_CALL;
+    else if (!impl->result.inspectable)
+        hr = E_UNEXPECTED;
+    else
+    {
+        *results = impl->result.inspectable;
+        impl->result.inspectable = NULL; /* NOTE: AsyncOperation gives up it's reference to result here! */
+        hr = impl->hr;
+    }
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    return hr;
+}
+
+static const struct IAsyncOperation_IInspectableVtbl async_inspectable_vtbl =
+{
+    /* IUnknown methods */
+    async_inspectable_QueryInterface,
+    async_inspectable_AddRef,
+    async_inspectable_Release,
+    /* IInspectable methods */
+    async_inspectable_GetIids,
+    async_inspectable_GetRuntimeClassName,
+    async_inspectable_GetTrustLevel,
+    /* IAsyncOperation<IInspectable*> */
+    async_inspectable_put_Completed,
+    async_inspectable_get_Completed,
+    async_inspectable_GetResults,
+};
+
+static inline struct async_operation *impl_from_IAsyncInfo( IAsyncInfo *iface )
+{
+    return CONTAINING_RECORD( iface, struct async_operation, IAsyncInfo_iface );
+}
+
+static HRESULT WINAPI async_info_QueryInterface( IAsyncInfo *iface, REFIID iid, void **out )
+{
+    return async_operation_QueryInterface( impl_from_IAsyncInfo( iface ), iid, out );
+}
+
+static ULONG WINAPI async_info_AddRef( IAsyncInfo *iface )
+{
+    return async_operation_AddRef( impl_from_IAsyncInfo( iface ) );
+}
+
+static ULONG WINAPI async_info_Release( IAsyncInfo *iface )
+{
+    return async_operation_Release( impl_from_IAsyncInfo( iface ) );
+}
+
+static HRESULT WINAPI async_info_GetIids( IAsyncInfo *iface, ULONG *iid_count, IID **iids )
+{
+    return async_operation_GetIids( impl_from_IAsyncInfo( iface ), iid_count, iids );
+}
+
+static HRESULT WINAPI async_info_GetRuntimeClassName( IAsyncInfo *iface, HSTRING *class_name )
+{
+    return async_operation_GetRuntimeClassName( impl_from_IAsyncInfo( iface ), class_name );
+}
+
+static HRESULT WINAPI async_info_GetTrustLevel( IAsyncInfo *iface, TrustLevel *trust_level )
+{
+    return async_operation_GetTrustLevel( impl_from_IAsyncInfo( iface ), trust_level );
+}
+
+static HRESULT WINAPI async_info_get_Id( IAsyncInfo *iface, UINT32 *id )
+{
+    struct async_operation *impl = impl_from_IAsyncInfo( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, id %p.\n", iface, id );
+
+    AcquireSRWLockShared( &impl->lock );
+    if (impl->status == Closed) hr = E_ILLEGAL_METHOD_CALL;
+    *id = 1;
+    ReleaseSRWLockShared( &impl->lock );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_info_get_Status( IAsyncInfo *iface, AsyncStatus *status )
+{
+    struct async_operation *impl = impl_from_IAsyncInfo( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, status %p.\n", iface, status );
+
+    AcquireSRWLockShared( &impl->lock );
+    if (impl->status == Closed) hr = E_ILLEGAL_METHOD_CALL;
+    *status = impl->status;
+    ReleaseSRWLockShared( &impl->lock );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_info_get_ErrorCode( IAsyncInfo *iface, HRESULT *error_code )
+{
+    struct async_operation *impl = impl_from_IAsyncInfo( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, error_code %p.\n", iface, error_code );
+
+    AcquireSRWLockShared( &impl->lock );
+    if (impl->status == Closed) *error_code = hr = E_ILLEGAL_METHOD_CALL;
+    else *error_code = impl->hr;
+    ReleaseSRWLockShared( &impl->lock );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_info_Cancel( IAsyncInfo *iface )
+{
+    struct async_operation *impl = impl_from_IAsyncInfo( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p.\n", iface );
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (impl->status == Closed) hr = E_ILLEGAL_METHOD_CALL;
+    else if (impl->status == Started) impl->status = Canceled;
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_info_Close( IAsyncInfo *iface )
+{
+    struct async_operation *impl = impl_from_IAsyncInfo( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p.\n", iface );
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (impl->status == Started) hr = E_ILLEGAL_STATE_CHANGE;
+    else impl->status = Closed;
+    ReleaseSRWLockExclusive( &impl->lock );
+
+    return hr;
+}
+
+static const struct IAsyncInfoVtbl async_info_vtbl =
+{
+    /* IUnknown methods */
+    async_info_QueryInterface,
+    async_info_AddRef,
+    async_info_Release,
+    /* IInspectable methods */
+    async_info_GetIids,
+    async_info_GetRuntimeClassName,
+    async_info_GetTrustLevel,
+    /* IAsyncInfo */
+    async_info_get_Id,
+    async_info_get_Status,
+    async_info_get_ErrorCode,
+    async_info_Cancel,
+    async_info_Close,
+};
+
+static void async_operation_run( struct async_operation *impl )
+{
+    IAsyncOperation_IInspectable *operation = &impl->IAsyncOperation_IInspectable_iface;
+    IInspectable *inspectable = NULL;
+    UINT32 uint32 = 0;
+    BOOLEAN boolean = FALSE;
+    BOOL canceled = FALSE;
+    HRESULT hr;
+
+    if (impl->flags & ASYNC_RUN_DEFERRED)
+    {
+        /* deferred operations may be canceled before they get a chance to run */
+        AcquireSRWLockExclusive( &impl->lock );
+        canceled = impl->status == Canceled || impl->status == Closed;
+        ReleaseSRWLockExclusive( &impl->lock );
+    }
+
+    if (canceled) hr = S_OK;
+    else switch (impl->type)
+    {
+    case ASYNC_ACTION: hr = impl->callback.action( impl->invoker, impl->param ); break;
+    case ASYNC_OPERATION_BOOLEAN: hr = impl->callback.boolean( impl->invoker, impl->param, &boolean ); break;
+    case ASYNC_OPERATION_UINT32: hr = impl->callback.uint32( impl->invoker, impl->param, &uint32 ); break;
+    case ASYNC_OPERATION_INSPECTABLE: hr = impl->callback.inspectable( impl->invoker, impl->param, &inspectable ); break;
+    default: hr = E_NOTIMPL; break;
+    }
+
+    AcquireSRWLockExclusive( &impl->lock );
+    if (impl->status != Closed && !canceled) impl->status = FAILED(hr) ? Error : Completed;
+    switch (impl->type)
+    {
+    case ASYNC_OPERATION_BOOLEAN: impl->result.boolean = boolean; break;
+    case ASYNC_OPERATION_UINT32: impl->result.uint32 = uint32; break;
+    case ASYNC_OPERATION_INSPECTABLE: impl->result.inspectable = inspectable; break;
+    default: break;
+    }
+    impl->hr = hr;
+
+    if (impl->handler != NULL && impl->handler != HANDLER_NOT_SET)
+    {
+        IAsyncOperationCompletedHandler_IInspectable *handler = impl->handler;
+        AsyncStatus status = impl->status;
+        impl->handler = NULL; /* Prevent concurrent invoke. */
+        ReleaseSRWLockExclusive( &impl->lock );
+
+        IAsyncOperationCompletedHandler_IInspectable_Invoke( handler, operation, status );
+        IAsyncOperationCompletedHandler_IInspectable_Release( handler );
+    }
+    else ReleaseSRWLockExclusive( &impl->lock );
+}
+
+static void CALLBACK async_operation_run_cb( TP_CALLBACK_INSTANCE *instance, void *context )
+{
+    struct async_operation *impl = context;
+
+    async_operation_run( impl );
+
+    /* release refcount acquired in async_operation_start */
+    async_operation_Release( impl );
+}
+
+static HRESULT async_operation_start( enum async_type type, const GUID *iid, const WCHAR *class_name, const void *vtbl,
+                                      IUnknown *invoker, IUnknown *param, void *callback, DWORD flags, IInspectable **out )
+{
+    struct async_operation *impl;
+    HRESULT hr;
+
+    *out = NULL;
+    if (!(impl = async_operation_alloc())) return E_OUTOFMEMORY;
+    impl->IInspectable_iface.lpVtbl = (IInspectableVtbl *)vtbl;
+    impl->IAsyncInfo_iface.lpVtbl = &async_info_vtbl;
+    impl->iid = iid;
+    impl->class_name = class_name;
+    impl->ref = 1;
+
+    impl->type = type;
+    impl->flags = flags;
+    switch (type)
+    {
+    case ASYNC_ACTION: impl->callback.action = callback; break;
+    case ASYNC_OPERATION_BOOLEAN: impl->callback.boolean = callback; break;
+    case ASYNC_OPERATION_UINT32: impl->callback.uint32 = callback; break;
+    case ASYNC_OPERATION_INSPECTABLE: impl->callback.inspectable = callback; break;
+    }
+    if ((impl->invoker = invoker)) IUnknown_AddRef( impl->invoker );
+    if ((impl->param = param)) IUnknown_AddRef( impl->param );
+
+    InitializeSRWLock( &impl->lock );
+    impl->handler = HANDLER_NOT_SET;
+    impl->status = Started;
+
+    if (flags & ASYNC_RUN_INLINE) async_operation_run( impl );
+    else if (flags & ASYNC_RUN_DEFERRED) async_operation_AddRef( impl ); /* released in async_operation_run_deferred */
+    else
+    {
+        /* keep the async alive in the callback */
+        async_operation_AddRef( impl );
+        if (!TrySubmitThreadpoolCallback( async_operation_run_cb, impl, NULL ))
+        {
+            hr = HRESULT_FROM_WIN32( GetLastError() );
+            /* drop both the callback and the caller references */
+            impl->status = Closed;
+            async_operation_Release( impl );
+            async_operation_Release( impl );
+            return hr;
+        }
+    }
+
+    *out = &impl->IInspectable_iface;
+    TRACE( "created %s %p\n", debugstr_guid( iid ), *out );
+    return S_OK;
+}
+
+void async_operation_run_deferred( IInspectable *operation )
+{
+    struct async_operation *impl = CONTAINING_RECORD( operation, struct async_operation, IInspectable_iface );
+
+    TRACE( "operation %p.\n", operation );
+
+    assert( impl->flags & ASYNC_RUN_DEFERRED );
+    async_operation_run( impl );
+    async_operation_Release( impl );
+}
+
+HRESULT async_action_create( IUnknown *invoker, IUnknown *param, async_action_callback callback,
+                             DWORD flags, IAsyncAction **out )
+{
+    TRACE( "invoker %p, param %p, callback %p, flags %#lx, out %p.\n", invoker, param, callback, flags, out );
+    return async_operation_start( ASYNC_ACTION, &IID_IAsyncAction, NULL, &async_action_vtbl,
+                                  invoker, param, callback, flags, (IInspectable **)out );
+}
+
+HRESULT async_operation_boolean_create( IUnknown *invoker, IUnknown *param, async_operation_boolean_callback callback,
+                                        DWORD flags, IAsyncOperation_boolean **out )
+{
+    TRACE( "invoker %p, param %p, callback %p, flags %#lx, out %p.\n", invoker, param, callback, flags, out );
+    return async_operation_start( ASYNC_OPERATION_BOOLEAN, &IID_IAsyncOperation_boolean,
+                                  L"Windows.Foundation.IAsyncOperation`1<Boolean>", &async_bool_vtbl,
+                                  invoker, param, callback, flags, (IInspectable **)out );
+}
+
+HRESULT async_operation_uint32_create( const GUID *iid, const WCHAR *class_name, IUnknown *invoker, IUnknown *param,
+                                       async_operation_uint32_callback callback, DWORD flags, IAsyncOperation_UINT32 **out )
+{
+    TRACE( "iid %s, class_name %s, invoker %p, param %p, callback %p, flags %#lx, out %p.\n", debugstr_guid( iid ),
+           debugstr_w( class_name ), invoker, param, callback, flags, out );
+    return async_operation_start( ASYNC_OPERATION_UINT32, iid, class_name, &async_uint32_vtbl,
+                                  invoker, param, callback, flags, (IInspectable **)out );
+}
+
+HRESULT async_operation_inspectable_create( const GUID *iid, IUnknown *invoker, IUnknown *param,
+                                            async_operation_inspectable_callback callback, DWORD flags,
+                                            IAsyncOperation_IInspectable **out )
+{
+    TRACE( "iid %s, invoker %p, param %p, callback %p, flags %#lx, out %p.\n", debugstr_guid( iid ),
+           invoker, param, callback, flags, out );
+    return async_operation_start( ASYNC_OPERATION_INSPECTABLE, iid, NULL, &async_inspectable_vtbl,
+                                  invoker, param, callback, flags, (IInspectable **)out );
+}
@@ -19,9 +19,12 @@
  */
 
 #include <assert.h>
+#include <errno.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <unistd.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -57,6 +60,7 @@ struct async
     unsigned int         canceled :1;     /* have we already queued cancellation for this async? */
     unsigned int         unknown_status :1; /* initial status is not known yet */
     unsigned int         blocking :1;     /* async is blocking */
+    unsigned int         client_io :1;    /* I/O is queued to a client worker thread */
     struct completion   *completion;      /* completion associated with fd */
     apc_param_t          comp_key;        /* completion key associated with fd */
     unsigned int         comp_flags;      /* completion flags */
@@ -277,6 +281,7 @@ struct async *create_async( struct fd *fd, struct thread *thread, const async_da
     async->canceled      = 0;
     async->unknown_status = 0;
     async->blocking      = !is_fd_overlapped( fd );
+    async->client_io     = 0;
     async->completion    = fd_get_completion( fd, &async->comp_key );
     async->comp_flags    = 0;
     async->completion_callback = NULL;
@@ -598,6 +603,36 @@ restart:
     return woken;
 }
 
+/* cancel the asyncs whose I/O is queued to client worker threads; the server can't interrupt
+ * it, so their wait handles are returned for the client to drop the requests that haven't
+ * been started yet. asyncs that don't fit in the reply are left for a further call. */
+static int cancel_client_asyncs( struct process *process, struct object *obj, struct thread *thread,
+                                 client_ptr_t iosb )
+{
+    data_size_t max = get_reply_max_size() / sizeof(obj_handle_t);
+    obj_handle_t *waits;
+    struct async *async;
+    int count = 0;
+
+    if (!max || !(waits = mem_alloc( max * sizeof(*waits) ))) return 0;
+
+    LIST_FOR_EACH_ENTRY( async, &process->asyncs, struct async, process_entry )
+    {
+        if (!async->client_io || !async->unknown_status || async->canceled) continue;
+        if (get_fd_user( async->fd ) == obj && (!thread || async->thread == thread) &&
+            (!iosb || async->data.iosb == iosb))
+        {
+            async->canceled = 1;
+            waits[count++] = async->wait_handle;
+            if (count == max) break;
+        }
+    }
+
+    if (count) set_reply_data_ptr( waits, count * sizeof(*waits) );
+    else free( waits );
+    return count;
+}
+
 static int cancel_blocking( struct process *process, struct thread *thread, client_ptr_t iosb )
 {
     struct async *async;
@@ -806,6 +841,8 @@ DECL_HANDLER(cancel_async)
     if (obj)
     {
         int count = cancel_async( current->process, obj, thread, req->iosb );
+        /* only the client knows if these can still be canceled, it decides on the status then */
+        cancel_client_asyncs( current->process, obj, thread, req->iosb );
         if (!count && req->iosb) set_error( STATUS_NOT_FOUND );
         release_object( obj );
     }
@@ -842,19 +879,22 @@ DECL_HANDLER(get_async_result)
     set_error( iosb->status );
 }
 
-/* notify direct completion of async and close the wait handle if not blocking */
-DECL_HANDLER(set_async_direct_result)
+/* hand an async off to the client for I/O that it performs on a worker thread */
+obj_handle_t async_handoff_client_io( struct async *async )
 {
-    struct async *async = (struct async *)get_handle_obj( current->process, req->handle, 0, &async_ops );
-    unsigned int status = req->status;
-
-    if (!async) return;
+    async->client_io = 1;
+    set_error( STATUS_ALERTED );
+    return async_handoff( async, NULL, 0 );
+}
 
+/* set the result of an I/O that the client performed after an async handoff, returns 0 on failure */
+static int async_set_direct_result( struct async *async, unsigned int status, apc_param_t information,
+                                    int mark_pending )
+{
     if (!async->unknown_status || !async->terminated || !async->alerted)
     {
         set_error( STATUS_INVALID_PARAMETER );
-        release_object( &async->obj );
-        return;
+        return 0;
     }
 
     if (status == STATUS_PENDING)
@@ -862,7 +902,7 @@ DECL_HANDLER(set_async_direct_result)
         async->direct_result = 0;
         async->pending = 1;
     }
-    else if (req->mark_pending)
+    else if (mark_pending)
     {
         async->pending = 1;
     }
@@ -872,7 +912,7 @@ DECL_HANDLER(set_async_direct_result)
      * therefore, we can do async_set_result() directly and let the client skip
      * waiting on wait_handle.
      */
-    async_set_result( &async->obj, status, req->information );
+    async_set_result( &async->obj, status, information );
 
     /* close wait handle here to avoid extra server round trip, if the I/O
      * either has completed, or is pending and not blocking.
@@ -882,12 +922,103 @@ DECL_HANDLER(set_async_direct_result)
         close_handle( async->thread->process, async->wait_handle );
         async->wait_handle = 0;
     }
+    return 1;
+}
+
+/* notify direct completion of async and close the wait handle if not blocking */
+DECL_HANDLER(set_async_direct_result)
+{
+    struct async *async = (struct async *)get_handle_obj( current->process, req->handle, 0, &async_ops );
+
+    if (!async) return;
 
     /* report back to the client whether the wait handle has been closed.
      * handle will be 0 if closed by us; otherwise the original value is
      * retained
      */
-    reply->handle = async->wait_handle;
+    if (async_set_direct_result( async, req->status, req->information, req->mark_pending ))
+        reply->handle = async->wait_handle;
 
     release_object( &async->obj );
 }
+
+/*
+ * Regular file I/O can't be waited for with poll(), so the clients may perform it on
+ * worker threads instead, after a create_file_async request has handed the async off
+ * to them. These threads have no server connection; they report each result through
+ * a per-process pipe, which completes the async as if set_async_direct_result had been
+ * called with mark_pending set.
+ */
+
+static void async_results_poll_event( struct fd *fd, int event );
+
+static const struct fd_ops async_results_fd_ops =
+{
+    NULL,                          /* get_poll_events */
+    async_results_poll_event,      /* poll_event */
+    NULL,                          /* flush */
+    NULL,                          /* get_fd_type */
+    NULL,                          /* ioctl */
+    NULL,                          /* queue_async */
+    NULL                           /* reselect_async */
+};
+
+static void async_results_poll_event( struct fd *fd, int event )
+{
+    struct process *process = (struct process *)get_fd_user( fd );
+    async_result_t results[64];
+    struct async *async;
+    ssize_t size;
+    unsigned int i;
+
+    if ((event & (POLLERR | POLLHUP)) && !(event & POLLIN))
+    {
+        set_fd_events( fd, -1 );
+        return;
+    }
+
+    grab_object( process );
+    /* writes of a single result are atomic, so the pipe never holds a partial one */
+    while (process->async_results == fd &&
+           (size = read( get_unix_fd( fd ), results, sizeof(results) )) > 0)
+    {
+        for (i = 0; i < size / sizeof(results[0]); i++)
+        {
+            if (!(async = (struct async *)get_handle_obj( process, results[i].wait, 0, &async_ops ))) continue;
+            async_set_direct_result( async, results[i].status, results[i].information, 1 );
+            release_object( &async->obj );
+        }
+        if (size < sizeof(results)) break;
+    }
+    clear_error();
+    release_object( process );
+}
+
+/* release the async results pipe of a process */
+void free_process_async_results( struct process *process )
+{
+    if (!process->async_results) return;
+    release_object( process->async_results );
+    process->async_results = NULL;
+}
+
+DECL_HANDLER(set_async_results_fd)
+{
+    struct process *process = current->process;
+    int unix_fd = thread_get_inflight_fd( current, req->fd );
+
+    if (unix_fd == -1)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if (process->async_results)
+    {
+        close( unix_fd );
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if (!(process->async_results = create_anonymous_fd( &async_results_fd_ops, unix_fd, &process->obj, 0 )))
+        return;
+    set_fd_events( process->async_results, POLLIN );
+}
@@ -0,0 +1,220 @@
+/*
+ * Minimal server client for the server tools
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Just enough of the client side of the protocol to send requests through the
+ * request pipe, for the tools that exercise a running server directly. This is
+ * the same handshake as server_init_process in ntdll, see there for the details.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "client.h"
+
+static int fd_socket = -1;
+static int request_fd = -1;
+static int reply_fd = -1;
+static int wait_fd = -1;
+
+void fatal_error( const char *err, ... )
+{
+    va_list args;
+
+    va_start( args, err );
+    vfprintf( stderr, err, args );
+    va_end( args );
+    exit( 1 );
+}
+
+/* connect to the server socket, returns -1 if the server isn't running */
+static int connect_server(void)
+{
+    const char *prefix = getenv( "WINEPREFIX" ), *home = getenv( "HOME" );
+    struct sockaddr_un addr;
+    char dir[PATH_MAX];
+    struct stat st;
+    int s;
+
+    if (prefix) snprintf( dir, sizeof(dir), "%s", prefix );
+    else snprintf( dir, sizeof(dir), "%s/.wine", home ? home : "" );
+    if (stat( dir, &st ) == -1) fatal_error( "cannot stat %s\n", dir );
+
+    addr.sun_family = AF_UNIX;
+    snprintf( addr.sun_path, sizeof(addr.sun_path), "/tmp/.wine-%u/server-%llx-%llx/socket", getuid(),
+              (unsigned long long)st.st_dev, (unsigned long long)st.st_ino );
+    if ((s = socket( AF_UNIX, SOCK_STREAM, 0 )) == -1) fatal_error( "socket: %s\n", strerror( errno ));
+    if (connect( s, (struct sockaddr *)&addr, sizeof(addr) ) != -1) return s;
+    close( s );
+    return -1;
+}
+
+static void send_fd( int fd )
+{
+    struct send_fd data = { 0, fd };
+    char cmsg_buffer[CMSG_SPACE( sizeof(int) )];
+    struct msghdr msghdr;
+    struct cmsghdr *cmsg;
+    struct iovec vec;
+
+    memset( &msghdr, 0, sizeof(msghdr) );
+    vec.iov_base = &data;
+    vec.iov_len  = sizeof(data);
+    msghdr.msg_iov        = &vec;
+    msghdr.msg_iovlen     = 1;
+    msghdr.msg_control    = cmsg_buffer;
+    msghdr.msg_controllen = sizeof(cmsg_buffer);
+
+    cmsg = CMSG_FIRSTHDR( &msghdr );
+    cmsg->cmsg_len   = CMSG_LEN( sizeof(fd) );
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    memcpy( CMSG_DATA(cmsg), &fd, sizeof(fd) );
+
+    if (sendmsg( fd_socket, &msghdr, 0 ) != sizeof(data)) fatal_error( "sendmsg: %s\n", strerror( errno ));
+}
+
+/* receive a file descriptor passed by the server */
+int receive_fd( obj_handle_t *handle )
+{
+    char cmsg_buffer[256];
+    struct msghdr msghdr;
+    struct cmsghdr *cmsg;
+    struct iovec vec;
+    int fd = -1;
+
+    memset( &msghdr, 0, sizeof(msghdr) );
+    vec.iov_base = handle;
+    vec.iov_len  = sizeof(*handle);
+    msghdr.msg_iov        = &vec;
+    msghdr.msg_iovlen     = 1;
+    msghdr.msg_control    = cmsg_buffer;
+    msghdr.msg_controllen = sizeof(cmsg_buffer);
+
+    if (recvmsg( fd_socket, &msghdr, 0 ) <= 0) fatal_error( "recvmsg: %s\n", strerror( errno ));
+    for (cmsg = CMSG_FIRSTHDR( &msghdr ); cmsg; cmsg = CMSG_NXTHDR( &msghdr, cmsg ))
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy( &fd, CMSG_DATA(cmsg), sizeof(fd) );
+    return fd;
+}
+
+static void read_reply_data( void *buffer, size_t size )
+{
+    ssize_t ret;
+
+    while (size)
+    {
+        if ((ret = read( reply_fd, buffer, size )) <= 0)
+        {
+            if (ret == -1 && errno == EINTR) continue;
+            fatal_error( "the server closed the connection\n" );
+        }
+        buffer = (char *)buffer + ret;
+        size -= ret;
+    }
+}
+
+void init_request( union generic_request *req, enum request type, data_size_t reply_size )
+{
+    memset( req, 0, sizeof(*req) );
+    req->request_header.req = type;
+    req->request_header.reply_size = reply_size;
+}
+
+/* send a request through the request pipe and wait for the reply */
+unsigned int server_call( union generic_request *req, union generic_reply *reply,
+                          const void *data, data_size_t size, void *reply_data )
+{
+    struct iovec vec[2];
+
+    req->request_header.request_size = size;
+    vec[0].iov_base = req;
+    vec[0].iov_len  = sizeof(*req);
+    vec[1].iov_base = (void *)data;
+    vec[1].iov_len  = size;
+    if (writev( request_fd, vec, size ? 2 : 1 ) != sizeof(*req) + size)
+        fatal_error( "write: %s\n", strerror( errno ));
+
+    read_reply_data( reply, sizeof(*reply) );
+    if (reply->reply_header.reply_size) read_reply_data( reply_data, reply->reply_header.reply_size );
+    return reply->reply_header.error;
+}
+
+/* connect to the server as the first thread of a new process, returns 0 if the server isn't running */
+int connect_client(void)
+{
+    union generic_request req;
+    union generic_reply reply;
+    unsigned short machines[8];
+    obj_handle_t version;
+    int reply_pipe[2], wait_pipe[2];
+
+    if ((fd_socket = connect_server()) == -1) return 0;
+    request_fd = receive_fd( &version );
+    if (version != SERVER_PROTOCOL_VERSION)
+        fatal_error( "version mismatch %d/%d\n", version, SERVER_PROTOCOL_VERSION );
+
+    if (pipe( reply_pipe ) == -1 || pipe( wait_pipe ) == -1) fatal_error( "pipe: %s\n", strerror( errno ));
+    send_fd( reply_pipe[1] );
+    send_fd( wait_pipe[1] );
+    reply_fd = reply_pipe[0];
+    wait_fd = wait_pipe[0];
+
+    init_request( &req, REQ_init_first_thread, sizeof(machines) );
+    req.init_first_thread_request.unix_pid = getpid();
+#ifdef __NR_gettid
+    req.init_first_thread_request.unix_tid = syscall( __NR_gettid );
+#else
+    req.init_first_thread_request.unix_tid = -1;
+#endif
+    req.init_first_thread_request.reply_fd = reply_pipe[1];
+    req.init_first_thread_request.wait_fd  = wait_pipe[1];
+    if (server_call( &req, &reply, NULL, 0, machines )) fatal_error( "init_first_thread failed\n" );
+    close( reply_pipe[1] );
+    close( wait_pipe[1] );
+    return 1;
+}
+
+/* close the connection, the server then terminates the process */
+void close_client(void)
+{
+    close( fd_socket );
+    close( request_fd );
+    close( reply_fd );
+    close( wait_fd );
+    fd_socket = request_fd = reply_fd = wait_fd = -1;
+}
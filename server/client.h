@@ -0,0 +1,42 @@
+/*
+ * Minimal server client for the server tools
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_SERVER_CLIENT_H
+#define __WINE_SERVER_CLIENT_H
+
+#include "windef.h"
+#include "wine/server_protocol.h"
+
+/* the first thread of a process connected to the server of the current prefix, without ntdll */
+
+#ifdef __GNUC__
+extern void fatal_error( const char *err, ... ) __attribute__((noreturn,format(printf,1,2)));
+#else
+extern void fatal_error( const char *err, ... );
+#endif
+
+extern int connect_client(void);
+extern void close_client(void);
+extern int receive_fd( obj_handle_t *handle );
+extern void init_request( union generic_request *req, enum request type, data_size_t reply_size );
+extern unsigned int server_call( union generic_request *req, union generic_reply *reply,
+                                 const void *data, data_size_t size, void *reply_data );
+
+#endif  /* __WINE_SERVER_CLIENT_H */
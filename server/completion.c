@@ -63,6 +63,63 @@ struct completion
     unsigned int   depth;
 };
 
+static const WCHAR wait_completion_packet_name[] = {'W','a','i','t','C','o','m','p','l','e','t','i','o','n','P','a','c','k','e','t'};
+
+#define WAIT_COMPLETION_PACKET_MODIFY_STATE 0x0001
+#define WAIT_COMPLETION_PACKET_ALL_ACCESS   (STANDARD_RIGHTS_REQUIRED | WAIT_COMPLETION_PACKET_MODIFY_STATE)
+
+struct type_descr wait_completion_packet_type =
+{
+    { wait_completion_packet_name, sizeof(wait_completion_packet_name) }, /* name */
+    WAIT_COMPLETION_PACKET_ALL_ACCESS,              /* valid_access */
+    {                                               /* mapping */
+        STANDARD_RIGHTS_READ,
+        STANDARD_RIGHTS_WRITE | WAIT_COMPLETION_PACKET_MODIFY_STATE,
+        STANDARD_RIGHTS_EXECUTE,
+        WAIT_COMPLETION_PACKET_ALL_ACCESS
+    },
+};
+
+/* A wait completion packet waits on an object on behalf of a completion port, and
+ * queues its message to the port once the object is signaled. This lets a single
+ * thread wait for any number of objects. */
+struct wait_completion_packet
+{
+    struct object            obj;
+    struct wait_queue_entry  wait;        /* entry in the wait queue of the target object */
+    int                      waiting;     /* is the entry in the wait queue? */
+    int                      lost;        /* the object has been acquired by a client before the packet */
+    struct completion       *completion;  /* port the packet is associated with */
+    struct comp_msg         *msg;         /* message to queue, or already queued to the port */
+};
+
+static void wait_completion_packet_dump( struct object *obj, int verbose );
+static void wait_completion_packet_destroy( struct object *obj );
+
+static const struct object_ops wait_completion_packet_ops =
+{
+    sizeof(struct wait_completion_packet), /* size */
+    &wait_completion_packet_type,   /* type */
+    wait_completion_packet_dump,    /* dump */
+    no_add_queue,                   /* add_queue */
+    NULL,                           /* remove_queue */
+    NULL,                           /* signaled */
+    NULL,                           /* satisfied */
+    no_signal,                      /* signal */
+    no_get_fd,                      /* get_fd */
+    default_map_access,             /* map_access */
+    default_get_sd,                 /* get_sd */
+    default_set_sd,                 /* set_sd */
+    default_get_full_name,          /* get_full_name */
+    no_lookup_name,                 /* lookup_name */
+    directory_link_name,            /* link_name */
+    default_unlink_name,            /* unlink_name */
+    no_open_file,                   /* open_file */
+    no_kernel_obj_list,             /* get_kernel_obj_list */
+    no_close_handle,                /* close_handle */
+    wait_completion_packet_destroy  /* destroy */
+};
+
 static void completion_dump( struct object*, int );
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void completion_destroy( struct object * );
@@ -98,6 +155,7 @@ struct comp_msg
     apc_param_t   cvalue;
     apc_param_t   information;
     unsigned int  status;
+    struct wait_completion_packet *packet; /* packet the message belongs to, if any */
 };
 
 static void completion_destroy( struct object *obj)
@@ -161,12 +219,114 @@ void add_completion( struct completion *completion, apc_param_t ckey, apc_param_
     msg->cvalue = cvalue;
     msg->status = status;
     msg->information = information;
+    msg->packet = NULL;
 
     list_add_tail( &completion->queue, &msg->queue_entry );
     completion->depth++;
     wake_up( &completion->obj, 1 );
 }
 
+static void wait_completion_packet_dump( struct object *obj, int verbose )
+{
+    struct wait_completion_packet *packet = (struct wait_completion_packet *)obj;
+
+    assert( obj->ops == &wait_completion_packet_ops );
+    fprintf( stderr, "WaitCompletionPacket waiting=%d queued=%d\n",
+             packet->waiting, packet->msg && !packet->waiting );
+}
+
+/* return the packet to its idle state, once its message is gone */
+static void detach_wait_completion_packet( struct wait_completion_packet *packet )
+{
+    if (packet->msg) packet->msg->packet = NULL;
+    packet->msg = NULL;
+    release_object( packet->completion );
+    packet->completion = NULL;
+}
+
+/* cancel the packet wait or queued message, return the resulting status */
+static unsigned int cancel_wait_completion_packet( struct wait_completion_packet *packet, int remove_signaled )
+{
+    struct comp_msg *msg = packet->msg;
+
+    if (!packet->completion) return STATUS_CANCELLED;
+
+    if (packet->waiting)
+    {
+        struct object *obj = packet->wait.obj;
+
+        packet->waiting = 0;
+        obj->ops->remove_queue( obj, &packet->wait );
+    }
+    else if (remove_signaled)
+    {
+        list_remove( &msg->queue_entry );
+        packet->completion->depth--;
+    }
+    else return STATUS_PENDING;
+
+    detach_wait_completion_packet( packet );
+    free( msg );
+    return STATUS_SUCCESS;
+}
+
+static void wait_completion_packet_destroy( struct object *obj )
+{
+    struct wait_completion_packet *packet = (struct wait_completion_packet *)obj;
+
+    assert( obj->ops == &wait_completion_packet_ops );
+
+    /* a message already queued stays in the port */
+    if (packet->completion && cancel_wait_completion_packet( packet, 0 ) == STATUS_PENDING)
+        detach_wait_completion_packet( packet );
+}
+
+static void queue_wait_completion_packet( struct wait_completion_packet *packet )
+{
+    struct completion *completion = packet->completion;
+
+    list_add_tail( &completion->queue, &packet->msg->queue_entry );
+    completion->depth++;
+    wake_up( &completion->obj, 1 );
+}
+
+/* called from wake_up for the wait queue entries of wait completion packets */
+int wake_wait_completion_packet( struct wait_queue_entry *entry )
+{
+    struct wait_completion_packet *packet = CONTAINING_RECORD( entry, struct wait_completion_packet, wait );
+    struct object *obj = entry->obj;
+
+    assert( packet->waiting );
+    if (!obj->ops->signaled( obj, entry )) return 0;
+    packet->lost = 0;
+    obj->ops->satisfied( obj, entry );
+    /* a fast sync object was acquired by a client in the meantime, keep waiting */
+    if (packet->lost) return 0;
+
+    packet->waiting = 0;
+    obj->ops->remove_queue( obj, entry );
+    queue_wait_completion_packet( packet );
+    return 1;
+}
+
+/* called from make_wait_lost for the wait queue entries of wait completion packets */
+void make_wait_completion_packet_lost( struct wait_queue_entry *entry )
+{
+    struct wait_completion_packet *packet = CONTAINING_RECORD( entry, struct wait_completion_packet, wait );
+
+    packet->lost = 1;
+}
+
+/* the waits of packets don't belong to any thread, so only objects whose
+ * wait semantics don't depend on one can be used */
+static int is_wait_completion_packet_target( struct object *obj )
+{
+    const struct type_descr *type = obj->ops->type;
+
+    return type == &event_type || type == &semaphore_type || type == &timer_type ||
+           type == &process_type || type == &thread_type;
+}
+
 /* create a completion */
 DECL_HANDLER(create_completion)
 {
@@ -226,6 +386,7 @@ DECL_HANDLER(remove_completion)
         list_remove( entry );
         completion->depth--;
         msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
+        if (msg->packet) detach_wait_completion_packet( msg->packet );
         reply->ckey = msg->ckey;
         reply->cvalue = msg->cvalue;
         reply->status = msg->status;
@@ -247,3 +408,98 @@ DECL_HANDLER(query_completion)
 
     release_object( completion );
 }
+
+/* create a wait completion packet */
+DECL_HANDLER(create_wait_completion_packet)
+{
+    struct wait_completion_packet *packet;
+    struct unicode_str name;
+    struct object *root;
+    const struct security_descriptor *sd;
+    const struct object_attributes *objattr = get_req_object_attributes( &sd, &name, &root );
+
+    if (!objattr) return;
+
+    if ((packet = create_named_object( root, &wait_completion_packet_ops, &name, objattr->attributes, sd )))
+    {
+        if (get_error() != STATUS_OBJECT_NAME_EXISTS)
+        {
+            packet->waiting = 0;
+            packet->lost = 0;
+            packet->completion = NULL;
+            packet->msg = NULL;
+        }
+        reply->handle = alloc_handle( current->process, packet, req->access, objattr->attributes );
+        release_object( packet );
+    }
+
+    if (root) release_object( root );
+}
+
+/* associate a wait completion packet with a port and an object to wait for */
+DECL_HANDLER(associate_wait_completion_packet)
+{
+    struct wait_completion_packet *packet;
+    struct completion *completion = NULL;
+    struct object *obj = NULL;
+    struct comp_msg *msg;
+
+    if (!(packet = (struct wait_completion_packet *)get_handle_obj( current->process, req->packet,
+                                                                    WAIT_COMPLETION_PACKET_MODIFY_STATE,
+                                                                    &wait_completion_packet_ops )))
+        return;
+
+    if (!(completion = get_completion_obj( current->process, req->completion, IO_COMPLETION_MODIFY_STATE )))
+        goto done;
+    if (!(obj = get_handle_obj( current->process, req->target, SYNCHRONIZE, NULL )))
+        goto done;
+
+    if (!is_wait_completion_packet_target( obj ))
+    {
+        set_error( STATUS_OBJECT_TYPE_MISMATCH );
+        goto done;
+    }
+    if (packet->completion)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        goto done;
+    }
+    if (!(msg = mem_alloc( sizeof(*msg) ))) goto done;
+
+    msg->ckey = req->ckey;
+    msg->cvalue = req->cvalue;
+    msg->status = req->status;
+    msg->information = req->information;
+    msg->packet = packet;
+
+    packet->wait.wait = NULL;
+    if (!obj->ops->add_queue( obj, &packet->wait ))
+    {
+        free( msg );
+        goto done;
+    }
+    packet->waiting = 1;
+    packet->completion = (struct completion *)grab_object( completion );
+    packet->msg = msg;
+
+    reply->signaled = wake_wait_completion_packet( &packet->wait );
+
+done:
+    if (obj) release_object( obj );
+    if (completion) release_object( completion );
+    release_object( packet );
+}
+
+/* cancel a wait completion packet */
+DECL_HANDLER(cancel_wait_completion_packet)
+{
+    struct wait_completion_packet *packet;
+
+    if (!(packet = (struct wait_completion_packet *)get_handle_obj( current->process, req->packet,
+                                                                    WAIT_COMPLETION_PACKET_MODIFY_STATE,
+                                                                    &wait_completion_packet_ops )))
+        return;
+
+    set_error( cancel_wait_completion_packet( packet, req->remove_signaled ));
+    release_object( packet );
+}
@@ -158,6 +158,7 @@ static struct type_descr *types[] =
     &desktop_type,
     &device_type,
     &completion_type,
+    &wait_completion_packet_type,
     &file_type,
     &mapping_type,
     &key_type,
@@ -497,6 +498,7 @@ void init_directories( struct fd *intl_fd )
     session_mapping = create_session_mapping( &dir_kernel->obj, &session_str, OBJ_PERMANENT, NULL );
     set_session_mapping( session_mapping );
     release_object( session_mapping );
+    init_sock_shm( &dir_kernel->obj );
 
     release_object( named_pipe_device );
     release_object( mailslot_device );
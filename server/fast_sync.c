@@ -0,0 +1,410 @@
+/*
+ * Server-side fast synchronization objects
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * When WINEFASTSYNC is set in the server environment, the state of events, semaphores
+ * and mutexes lives in shared memory, where the clients signal and wait on them with
+ * atomic operations and futexes. The server still creates the objects, names them,
+ * manages the handles, and implements the waits that the clients can't do alone
+ * (alertable waits, or waits mixing other kind of objects), using the same shared state.
+ * The waiters count tells the clients when they need to wake up such server side waits.
+ *
+ * Every process gets its own section, only mapped by the server and by that process,
+ * and the objects are allocated in the section of the process creating them. Other
+ * processes that get a handle to them go through the server, so that a process can
+ * never modify the state of the objects of another one. A section stays mapped in the
+ * server until its process is gone and all its objects have been destroyed.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "file.h"
+#include "handle.h"
+#include "process.h"
+#include "thread.h"
+#include "request.h"
+
+#define FAST_SYNC_MAX_OBJECTS 0x4000
+
+struct fast_sync_section
+{
+    struct list      entry;       /* entry in the sections list */
+    fast_sync_shm_t *objects;     /* objects shared memory */
+    unsigned int     refcount;    /* number of used entries, plus one while the process maps it */
+    unsigned int     used;        /* number of entries used so far */
+    unsigned int     free_head;   /* ring of freed entries, oldest first */
+    unsigned int     free_count;
+    unsigned int     free_indices[FAST_SYNC_MAX_OBJECTS];
+};
+
+static struct list fast_sync_sections = LIST_INIT( fast_sync_sections );
+#ifdef __linux__
+static int fast_sync_enabled;
+#endif
+
+/* fast sync is only enabled if WINEFASTSYNC is set */
+void init_fast_sync(void)
+{
+    const char *env = getenv( "WINEFASTSYNC" );
+
+#ifdef __linux__
+    fast_sync_enabled = env && atoi( env );
+#else
+    if (env && atoi( env )) fprintf( stderr, "wineserver: fast sync isn't supported on this platform\n" );
+#endif
+}
+
+static void release_fast_sync_section( struct fast_sync_section *section )
+{
+    if (--section->refcount) return;
+    list_remove( &section->entry );
+    munmap( (void *)section->objects, FAST_SYNC_MAX_OBJECTS * sizeof(*section->objects) );
+    free( section );
+}
+
+/* find the section containing a fast sync entry */
+static struct fast_sync_section *get_fast_sync_section( fast_sync_shm_t *shm )
+{
+    struct fast_sync_section *section;
+
+    LIST_FOR_EACH_ENTRY( section, &fast_sync_sections, struct fast_sync_section, entry )
+        if (shm >= section->objects && shm < section->objects + FAST_SYNC_MAX_OBJECTS) return section;
+    assert( 0 );
+    return NULL;
+}
+
+/* release the fast sync section of a process, the objects that outlive it keep it mapped */
+void free_process_fast_sync( struct process *process )
+{
+    struct fast_sync_section *section = process->fast_sync;
+
+    if (!section) return;
+    process->fast_sync = NULL;
+    release_fast_sync_section( section );
+}
+
+static void futex_wake_all( volatile int *addr )
+{
+#ifdef __linux__
+    /* the futex is shared between processes, it can't be private */
+    syscall( __NR_futex, addr, FUTEX_WAKE, INT_MAX, NULL, 0, 0 );
+#endif
+}
+
+/* allocate a fast sync entry in the section of the current process, returns NULL
+ * if fast sync is disabled or not mapped by the process, or if there's no free entry */
+fast_sync_shm_t *alloc_fast_sync( int type, int state, int param )
+{
+    struct fast_sync_section *section;
+    fast_sync_shm_t *shm;
+
+    if (!current || !(section = current->process->fast_sync)) return NULL;
+
+    /* reuse the oldest freed entry, stale client caches are less likely to still refer to it */
+    if (section->free_count)
+    {
+        shm = section->objects + section->free_indices[section->free_head];
+        section->free_head = (section->free_head + 1) % FAST_SYNC_MAX_OBJECTS;
+        section->free_count--;
+    }
+    else if (section->used < FAST_SYNC_MAX_OBJECTS) shm = section->objects + section->used++;
+    else return NULL;
+
+    section->refcount++;
+    shm->state     = state;
+    shm->param     = param;
+    shm->waiters   = 0;
+    shm->abandoned = 0;
+    shm->pulse_wake = 0;
+    /* clients caching the entry for a closed handle can tell that it has been reused */
+    shm->generation++;
+    __atomic_store_n( &shm->type, type, __ATOMIC_SEQ_CST );
+    return shm;
+}
+
+void free_fast_sync( fast_sync_shm_t *shm )
+{
+    struct fast_sync_section *section = get_fast_sync_section( shm );
+    unsigned int index = shm - section->objects;
+
+    __atomic_store_n( &shm->type, 0, __ATOMIC_SEQ_CST );
+    futex_wake_all( &shm->state );
+
+    section->free_indices[(section->free_head + section->free_count) % FAST_SYNC_MAX_OBJECTS] = index;
+    section->free_count++;
+    release_fast_sync_section( section );
+}
+
+void fast_sync_add_waiter( fast_sync_shm_t *shm )
+{
+    __atomic_fetch_add( &shm->waiters, 1, __ATOMIC_SEQ_CST );
+}
+
+void fast_sync_remove_waiter( fast_sync_shm_t *shm )
+{
+    __atomic_fetch_sub( &shm->waiters, 1, __ATOMIC_SEQ_CST );
+}
+
+int fast_sync_get_state( fast_sync_shm_t *shm )
+{
+    return __atomic_load_n( &shm->state, __ATOMIC_SEQ_CST );
+}
+
+/* check if a fast sync object is signaled for the given thread */
+int fast_sync_signaled( fast_sync_shm_t *shm, thread_id_t tid )
+{
+    int state = fast_sync_get_state( shm );
+
+    if (shm->type == FAST_SYNC_MUTEX) return !state || state == (int)tid;
+    return state > 0;
+}
+
+/* acquire a signaled fast sync object, returns 1 if it was an abandoned mutex, or -1 if
+ * a client acquired it since it has been found signaled and the wait must be checked again */
+int fast_sync_satisfied( fast_sync_shm_t *shm, thread_id_t tid )
+{
+    int state = fast_sync_get_state( shm );
+
+    switch (shm->type)
+    {
+    case FAST_SYNC_EVENT:
+        if (state <= 0) return -1;
+        if (!shm->param &&
+            !__atomic_compare_exchange_n( &shm->state, &state, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ))
+            return -1;
+        break;
+    case FAST_SYNC_SEMAPHORE:
+        do
+        {
+            if (state <= 0) return -1;
+        }
+        while (!__atomic_compare_exchange_n( &shm->state, &state, state - 1, 0,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+        break;
+    case FAST_SYNC_MUTEX:
+        if (state == (int)tid) __atomic_fetch_add( &shm->param, 1, __ATOMIC_SEQ_CST );
+        else
+        {
+            if (state || !__atomic_compare_exchange_n( &shm->state, &state, (int)tid, 0,
+                                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ))
+                return -1;
+            __atomic_store_n( &shm->param, 1, __ATOMIC_SEQ_CST );
+        }
+        return __atomic_exchange_n( &shm->abandoned, 0, __ATOMIC_SEQ_CST );
+    }
+    return 0;
+}
+
+/* give back an object acquired by fast_sync_satisfied, when a wait all couldn't acquire all of them */
+void fast_sync_unsatisfied( fast_sync_shm_t *shm )
+{
+    switch (shm->type)
+    {
+    case FAST_SYNC_EVENT:
+        if (shm->param) return;
+        __atomic_store_n( &shm->state, 1, __ATOMIC_SEQ_CST );
+        break;
+    case FAST_SYNC_SEMAPHORE:
+        __atomic_fetch_add( &shm->state, 1, __ATOMIC_SEQ_CST );
+        break;
+    case FAST_SYNC_MUTEX:
+        if (__atomic_sub_fetch( &shm->param, 1, __ATOMIC_SEQ_CST )) return;
+        __atomic_store_n( &shm->state, 0, __ATOMIC_SEQ_CST );
+        break;
+    }
+    futex_wake_all( &shm->state );
+}
+
+/* set the state of a fast sync event, returns the previous state */
+int fast_sync_set_event( fast_sync_shm_t *shm, int state )
+{
+    int prev = __atomic_exchange_n( &shm->state, state, __ATOMIC_SEQ_CST );
+    if (state && !prev) futex_wake_all( &shm->state );
+    return prev;
+}
+
+/* reset a pulsed event once the server side waits have been woken, and release the client
+ * waits: all of them for a manual reset event, or one if no server wait took an auto-reset one */
+void fast_sync_pulse_event( fast_sync_shm_t *shm )
+{
+    int state = 1;
+
+    if (shm->param) __atomic_store_n( &shm->state, 0, __ATOMIC_SEQ_CST );
+    else if (__atomic_compare_exchange_n( &shm->state, &state, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ))
+        __atomic_store_n( &shm->pulse_wake, 1, __ATOMIC_SEQ_CST );
+    else return;
+
+    __atomic_fetch_add( &shm->pulse, 1, __ATOMIC_SEQ_CST );
+    futex_wake_all( &shm->pulse );
+}
+
+unsigned int fast_sync_release_semaphore( fast_sync_shm_t *shm, unsigned int count, unsigned int *prev )
+{
+    int state = fast_sync_get_state( shm );
+
+    do
+    {
+        if (prev) *prev = state;
+        if ((unsigned int)state + count < (unsigned int)state ||
+            (unsigned int)state + count > (unsigned int)shm->param)
+            return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+    }
+    while (!__atomic_compare_exchange_n( &shm->state, &state, state + count, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+
+    if (!state) futex_wake_all( &shm->state );
+    return STATUS_SUCCESS;
+}
+
+unsigned int fast_sync_release_mutex( fast_sync_shm_t *shm, thread_id_t tid, unsigned int *prev )
+{
+    int count;
+
+    if (fast_sync_get_state( shm ) != (int)tid) return STATUS_MUTANT_NOT_OWNED;
+
+    do
+    {
+        if (!(count = __atomic_load_n( &shm->param, __ATOMIC_SEQ_CST ))) return STATUS_MUTANT_NOT_OWNED;
+    }
+    while (!__atomic_compare_exchange_n( &shm->param, &count, count - 1, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+
+    if (prev) *prev = count;
+    if (count == 1)
+    {
+        __atomic_store_n( &shm->state, 0, __ATOMIC_SEQ_CST );
+        futex_wake_all( &shm->state );
+    }
+    return STATUS_SUCCESS;
+}
+
+/* release a mutex owned by a terminated thread, returns 1 if it was owned by it */
+int fast_sync_abandon_mutex( fast_sync_shm_t *shm, thread_id_t tid )
+{
+    if (fast_sync_get_state( shm ) != (int)tid) return 0;
+
+    __atomic_store_n( &shm->param, 0, __ATOMIC_SEQ_CST );
+    __atomic_store_n( &shm->abandoned, 1, __ATOMIC_SEQ_CST );
+    __atomic_store_n( &shm->state, 0, __ATOMIC_SEQ_CST );
+    futex_wake_all( &shm->state );
+    return 1;
+}
+
+fast_sync_shm_t *get_obj_fast_sync( struct object *obj )
+{
+    fast_sync_shm_t *shm;
+
+    if ((shm = get_event_fast_sync( obj ))) return shm;
+    if ((shm = get_semaphore_fast_sync( obj ))) return shm;
+    return get_mutex_fast_sync( obj );
+}
+
+/* map the fast sync section of the current process */
+DECL_HANDLER(init_fast_sync)
+{
+#ifdef __linux__
+    struct process *process = current->process;
+    struct fast_sync_section *section;
+    mem_size_t size = FAST_SYNC_MAX_OBJECTS * sizeof(*section->objects);
+    void *ptr;
+    int fd;
+
+    if (!fast_sync_enabled)
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+    if (process->fast_sync)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if (!(section = mem_alloc( sizeof(*section) ))) return;
+    if ((fd = create_shared_memory( size, &ptr )) == -1)
+    {
+        free( section );
+        return;
+    }
+    section->objects    = ptr;
+    section->refcount   = 1;
+    section->used       = 0;
+    section->free_head  = 0;
+    section->free_count = 0;
+    list_add_tail( &fast_sync_sections, &section->entry );
+    process->fast_sync = section;
+
+    send_client_fd( process, fd, 0 );
+    close( fd );
+    reply->size = size;
+#else
+    set_error( STATUS_NOT_SUPPORTED );
+#endif
+}
+
+/* get the fast sync shared state of a synchronization object */
+DECL_HANDLER(get_fast_sync_obj)
+{
+    struct fast_sync_section *section = current->process->fast_sync;
+    fast_sync_shm_t *shm;
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    /* the objects of other processes aren't mapped by the client */
+    if ((shm = get_obj_fast_sync( obj )) && section && get_fast_sync_section( shm ) == section)
+    {
+        reply->index  = shm - section->objects;
+        reply->type   = shm->type;
+        reply->access = get_handle_access( current->process, req->handle );
+        reply->generation = shm->generation;
+    }
+    else set_error( STATUS_NOT_IMPLEMENTED );
+
+    release_object( obj );
+}
+
+/* wake up the server side waits on a fast sync object */
+DECL_HANDLER(wake_fast_sync_obj)
+{
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+    if (get_obj_fast_sync( obj )) wake_up( obj, 0 );
+    else set_error( STATUS_NOT_IMPLEMENTED );
+    release_object( obj );
+}
@@ -2909,6 +2909,40 @@ DECL_HANDLER(register_async)
     }
 }
 
+/* create an async for a regular file I/O that the client performs on a worker thread */
+DECL_HANDLER(create_file_async)
+{
+    unsigned int access;
+    struct async *async;
+    struct fd *fd;
+
+    switch(req->type)
+    {
+    case ASYNC_TYPE_READ:
+        access = FILE_READ_DATA;
+        break;
+    case ASYNC_TYPE_WRITE:
+        access = FILE_WRITE_DATA;
+        break;
+    default:
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+
+    if ((fd = get_handle_fd_obj( current->process, req->async.handle, access )))
+    {
+        if (!current->process->async_results || !is_fd_overlapped( fd ))
+            set_error( STATUS_NOT_SUPPORTED );
+        else if ((async = create_request_async( fd, fd->comp_flags, &req->async )))
+        {
+            /* the client will report the result through its async results pipe */
+            reply->wait = async_handoff_client_io( async );
+            release_object( async );
+        }
+        release_object( fd );
+    }
+}
+
 /* attach completion object to a fd */
 DECL_HANDLER(set_completion_info)
 {
@@ -535,6 +535,28 @@ unsigned int get_obj_handle_count( struct process *process, const struct object
     return count;
 }
 
+/* grab all the objects of the given type in the process handle table, returns NULL if there's none */
+struct object **get_process_objects( struct process *process, const struct object_ops *ops,
+                                     unsigned int *count )
+{
+    struct handle_table *table = process->handles;
+    struct handle_entry *ptr;
+    struct object **objects;
+    int i;
+
+    *count = 0;
+    if (!table) return NULL;
+
+    for (i = 0, ptr = table->entries; i <= table->last; i++, ptr++)
+        if (ptr->ptr && ptr->ptr->ops == ops) ++*count;
+    if (!*count || !(objects = mem_alloc( *count * sizeof(*objects) ))) return NULL;
+
+    *count = 0;
+    for (i = 0, ptr = table->entries; i <= table->last; i++, ptr++)
+        if (ptr->ptr && ptr->ptr->ops == ops) objects[(*count)++] = grab_object( ptr->ptr );
+    return objects;
+}
+
 /* get/set the handle reserved flags */
 /* return the old flags (or -1 on error) */
 static int set_handle_flags( struct process *process, obj_handle_t handle, int mask, int flags )
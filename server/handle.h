@@ -49,6 +49,8 @@ extern obj_handle_t open_object( struct process *process, obj_handle_t parent, u
                                  unsigned int attr );
 extern obj_handle_t find_inherited_handle( struct process *process, const struct object_ops *ops );
 extern unsigned int get_obj_handle_count( struct process *process, const struct object *obj );
+extern struct object **get_process_objects( struct process *process, const struct object_ops *ops,
+                                            unsigned int *count );
 extern void close_process_handles( struct process *process );
 extern struct handle_table *alloc_handle_table( struct process *process, int count );
 extern struct handle_table *copy_handle_table( struct process *process, struct process *parent,
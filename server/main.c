@@ -234,6 +234,8 @@ int main( int argc, char *argv[] )
     init_signals();
     init_memory();
     init_directories( load_intl_file() );
+    init_request_shm();
+    init_fast_sync();
     init_registry();
     main_loop();
     return 0;
@@ -121,6 +121,30 @@ static const struct object_ops shared_map_ops =
 
 static struct list shared_map_list = LIST_INIT( shared_map_list );
 
+/* pages of a PE image changed by relocating it, shared by the processes mapping the same file
+ * at the same address */
+struct reloc_image
+{
+    struct list     entry;           /* entry in global relocated images list, most recently used first */
+    dev_t           dev;             /* device of the image file */
+    ino_t           ino;             /* inode of the image file */
+    time_t          mtime;           /* modification time of the image file */
+    long            mtime_nsec;      /* nanoseconds of the modification time */
+    time_t          ctime;           /* status change time of the image file */
+    long            ctime_nsec;      /* nanoseconds of the status change time */
+    file_pos_t      file_size;       /* size of the image file */
+    client_ptr_t    base;            /* address the image is relocated to */
+    struct file    *file;            /* read-only temp file holding the relocated pages, NULL if not cacheable */
+    unsigned int   *pages;           /* offsets in the image of the pages in the file */
+    unsigned int    page_count;      /* number of pages in the file */
+};
+
+#define MAX_RELOC_IMAGES 256
+
+static struct list reloc_image_list = LIST_INIT( reloc_image_list );
+static unsigned int reloc_image_count;
+static int reloc_images_enabled = -1;
+
 /* memory view mapped in client address space */
 struct memory_view
 {
@@ -347,13 +371,11 @@ static int check_current_dir_for_exec(void)
     return (ret != MAP_FAILED);
 }
 
-/* create a temp file for anonymous mappings */
-static int create_temp_file( file_pos_t size )
-{
-    static int temp_dir_fd = -1;
-    char tmpfn[16];
-    int fd;
+static int temp_dir_fd = -1;
 
+/* change to the directory where temp files are created */
+static void enter_temp_dir(void)
+{
     if (temp_dir_fd == -1)
     {
         temp_dir_fd = server_dir_fd;
@@ -368,7 +390,20 @@ static int create_temp_file( file_pos_t size )
         }
     }
     else if (temp_dir_fd != server_dir_fd) fchdir( temp_dir_fd );
+}
 
+static void leave_temp_dir(void)
+{
+    if (temp_dir_fd != server_dir_fd) fchdir( server_dir_fd );
+}
+
+/* create a temp file for anonymous mappings */
+static int create_temp_file( file_pos_t size )
+{
+    char tmpfn[16];
+    int fd;
+
+    enter_temp_dir();
     fd = make_temp_file( tmpfn );
     if (fd != -1)
     {
@@ -381,10 +416,31 @@ static int create_temp_file( file_pos_t size )
     }
     else file_set_error();
 
-    if (temp_dir_fd != server_dir_fd) fchdir( server_dir_fd );
+    leave_temp_dir();
     return fd;
 }
 
+/* create a temp file holding the specified data, and return a read-only fd to it */
+static int create_readonly_temp_file( const void *data, size_t size )
+{
+    char tmpfn[16];
+    int fd, ret = -1;
+
+    enter_temp_dir();
+    fd = make_temp_file( tmpfn );
+    if (fd != -1)
+    {
+        if (pwrite( fd, data, size, 0 ) == size) ret = open( tmpfn, O_RDONLY );
+        if (ret == -1) file_set_error();
+        unlink( tmpfn );
+        close( fd );
+    }
+    else file_set_error();
+
+    leave_temp_dir();
+    return ret;
+}
+
 /* find a memory view from its base address */
 struct memory_view *find_mapped_view( struct process *process, client_ptr_t base )
 {
@@ -1242,6 +1298,405 @@ static client_ptr_t assign_map_address( struct mapping *mapping )
     return 0;
 }
 
+/* relocated images are only cached if WINERELOCCACHE is set */
+static int reloc_cache_enabled(void)
+{
+    if (reloc_images_enabled == -1)
+    {
+        const char *env = getenv( "WINERELOCCACHE" );
+        reloc_images_enabled = env && atoi( env );
+    }
+    return reloc_images_enabled;
+}
+
+/* get the nanoseconds of the modification and status change times of a file, if available */
+static void get_stat_nsec( const struct stat *st, long *mtime_nsec, long *ctime_nsec )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    *mtime_nsec = st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    *mtime_nsec = st->st_mtimespec.tv_nsec;
+#else
+    *mtime_nsec = 0;
+#endif
+#ifdef HAVE_STRUCT_STAT_ST_CTIM
+    *ctime_nsec = st->st_ctim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_CTIMESPEC)
+    *ctime_nsec = st->st_ctimespec.tv_nsec;
+#else
+    *ctime_nsec = 0;
+#endif
+}
+
+/* check whether the cached relocated pages are for the specified file */
+static int is_reloc_image_file( const struct reloc_image *reloc, const struct stat *st )
+{
+    long mtime_nsec, ctime_nsec;
+
+    /* a file rewritten in place within the same second must not match, so compare the
+     * nanoseconds too, and the change time catches the modification time being reset */
+    get_stat_nsec( st, &mtime_nsec, &ctime_nsec );
+    return (reloc->dev == st->st_dev && reloc->ino == st->st_ino &&
+            reloc->mtime == st->st_mtime && reloc->mtime_nsec == mtime_nsec &&
+            reloc->ctime == st->st_ctime && reloc->ctime_nsec == ctime_nsec &&
+            reloc->file_size == st->st_size);
+}
+
+/* find the cached relocated pages for an image mapping */
+static struct reloc_image *find_reloc_image( struct mapping *mapping, client_ptr_t base, struct stat *st )
+{
+    struct reloc_image *reloc;
+    int unix_fd;
+
+    if (!(mapping->flags & SEC_IMAGE) || mapping->shared || !mapping->fd)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return NULL;
+    }
+    if ((unix_fd = get_unix_fd( mapping->fd )) == -1) return NULL;
+    if (fstat( unix_fd, st ) == -1)
+    {
+        file_set_error();
+        return NULL;
+    }
+
+    LIST_FOR_EACH_ENTRY( reloc, &reloc_image_list, struct reloc_image, entry )
+        if (reloc->base == base && is_reloc_image_file( reloc, st )) return reloc;
+    set_error( STATUS_NOT_FOUND );
+    return NULL;
+}
+
+static void free_reloc_image( struct reloc_image *reloc )
+{
+    list_remove( &reloc->entry );
+    if (reloc->file) release_object( reloc->file );
+    free( reloc->pages );
+    free( reloc );
+    reloc_image_count--;
+}
+
+/* layout of an image file, as mapped by map_image_into_view in ntdll */
+struct image_layout
+{
+    int                   unix_fd;       /* unix fd of the image file */
+    size_t                header_size;   /* size of the headers mapped from the file */
+    size_t                total_size;    /* size of the image mapping */
+    IMAGE_SECTION_HEADER *sec;           /* section headers */
+    unsigned int          nb_sec;        /* number of sections */
+};
+
+/* load a page of the image as mapped by the client before relocation */
+static void load_image_page( const struct image_layout *layout, size_t rva, char *page )
+{
+    size_t map_size, file_size;
+    off_t file_start;
+    unsigned int i;
+
+    memset( page, 0, page_mask + 1 );
+    if (rva < layout->header_size)
+    {
+        pread( layout->unix_fd, page, min( layout->header_size - rva, page_mask + 1 ), rva );
+        return;
+    }
+    for (i = 0; i < layout->nb_sec; i++)
+    {
+        if (rva < layout->sec[i].VirtualAddress) continue;
+        get_section_sizes( &layout->sec[i], &map_size, &file_start, &file_size );
+        if (!layout->sec[i].PointerToRawData) continue;
+        if (rva - layout->sec[i].VirtualAddress >= file_size) continue;
+        /* the rest of the last page is cleared by the client, and beyond the end of file is zero anyway */
+        pread( layout->unix_fd, page, min( file_size - (rva - layout->sec[i].VirtualAddress), page_mask + 1 ),
+               file_start + rva - layout->sec[i].VirtualAddress );
+        return;
+    }
+}
+
+/* read data from the image as mapped by the client before relocation */
+static int read_image_data( const struct image_layout *layout, size_t rva, char *data, size_t size )
+{
+    char *page;
+    size_t pos, len;
+
+    if (!(page = mem_alloc( page_mask + 1 ))) return 0;
+    for (pos = 0; pos < size; pos += len)
+    {
+        load_image_page( layout, (rva + pos) & ~page_mask, page );
+        len = min( size - pos, page_mask + 1 - ((rva + pos) & page_mask) );
+        memcpy( data + pos, page + ((rva + pos) & page_mask), len );
+    }
+    free( page );
+    return 1;
+}
+
+/* size of the data changed by a relocation entry, -1 if not supported */
+static int get_reloc_size( USHORT reloc )
+{
+    switch (reloc >> 12)
+    {
+    case IMAGE_REL_BASED_ABSOLUTE:    return 0;
+    case IMAGE_REL_BASED_HIGH:        return sizeof(short);
+    case IMAGE_REL_BASED_LOW:         return sizeof(short);
+    case IMAGE_REL_BASED_HIGHLOW:     return sizeof(int);
+    case IMAGE_REL_BASED_DIR64:       return sizeof(INT64);
+    case IMAGE_REL_BASED_THUMB_MOV32: return 2 * sizeof(DWORD);
+    default:                          return -1;
+    }
+}
+
+/* apply a relocation entry, same as process_relocation_block in ntdll */
+static void apply_reloc( char *ptr, USHORT reloc, INT64 delta )
+{
+    short s;
+    int i;
+    INT64 q;
+    DWORD inst[2];
+    WORD lo, hi;
+    DWORD imm;
+
+    switch (reloc >> 12)
+    {
+    case IMAGE_REL_BASED_HIGH:
+        memcpy( &s, ptr, sizeof(s) );
+        s += HIWORD(delta);
+        memcpy( ptr, &s, sizeof(s) );
+        break;
+    case IMAGE_REL_BASED_LOW:
+        memcpy( &s, ptr, sizeof(s) );
+        s += LOWORD(delta);
+        memcpy( ptr, &s, sizeof(s) );
+        break;
+    case IMAGE_REL_BASED_HIGHLOW:
+        memcpy( &i, ptr, sizeof(i) );
+        i += delta;
+        memcpy( ptr, &i, sizeof(i) );
+        break;
+    case IMAGE_REL_BASED_DIR64:
+        memcpy( &q, ptr, sizeof(q) );
+        q += delta;
+        memcpy( ptr, &q, sizeof(q) );
+        break;
+    case IMAGE_REL_BASED_THUMB_MOV32:
+        memcpy( inst, ptr, sizeof(inst) );
+        lo = ((inst[0] << 1) & 0x0800) + ((inst[0] << 12) & 0xf000) +
+             ((inst[0] >> 20) & 0x0700) + ((inst[0] >> 16) & 0x00ff);
+        hi = ((inst[1] << 1) & 0x0800) + ((inst[1] << 12) & 0xf000) +
+             ((inst[1] >> 20) & 0x0700) + ((inst[1] >> 16) & 0x00ff);
+        imm = MAKELONG( lo, hi ) + delta;
+        lo = LOWORD( imm );
+        hi = HIWORD( imm );
+        inst[0] = (inst[0] & 0x8f00fbf0) + ((lo >> 1) & 0x0400) + ((lo >> 12) & 0x000f) +
+                                           ((lo << 20) & 0x70000000) + ((lo << 16) & 0xff0000);
+        inst[1] = (inst[1] & 0x8f00fbf0) + ((hi >> 1) & 0x0400) + ((hi >> 12) & 0x000f) +
+                                           ((hi << 20) & 0x70000000) + ((hi << 16) & 0xff0000);
+        memcpy( ptr, inst, sizeof(inst) );
+        break;
+    }
+}
+
+/* walk the relocation blocks the same way as ntdll, marking the changed pages if data is NULL,
+ * applying the relocations to the pages in data otherwise */
+static int process_reloc_dir( const struct image_layout *layout, const char *relocs, size_t dir_size,
+                              unsigned int *page_slots, char *data, INT64 delta )
+{
+    IMAGE_BASE_RELOCATION rel;
+    USHORT reloc;
+    size_t pos, rva;
+    unsigned int count, page;
+    int size;
+
+    for (pos = 0; pos + sizeof(rel) < dir_size; pos += sizeof(rel) + count * sizeof(USHORT))
+    {
+        memcpy( &rel, relocs + pos, sizeof(rel) );
+        if (!rel.SizeOfBlock || rel.VirtualAddress >= layout->total_size) break;
+        if (rel.SizeOfBlock < sizeof(rel) || rel.SizeOfBlock > dir_size - pos) return 0;
+
+        for (count = 0; count < (rel.SizeOfBlock - sizeof(rel)) / sizeof(USHORT); count++)
+        {
+            memcpy( &reloc, relocs + pos + sizeof(rel) + count * sizeof(USHORT), sizeof(reloc) );
+            if ((size = get_reloc_size( reloc )) == -1) return 1;  /* ntdll stops there too */
+            if (!size) continue;
+            rva = rel.VirtualAddress + (reloc & 0xfff);
+            if (rva + size > layout->total_size) return 0;
+            if (data)
+            {
+                /* a value crossing a page boundary is in two consecutive pages, so in consecutive slots */
+                page = rva / (page_mask + 1);
+                apply_reloc( data + (page_slots[page] - 1) * (page_mask + 1) + (rva & page_mask), reloc, delta );
+            }
+            else
+            {
+                page_slots[rva / (page_mask + 1)] = 1;
+                page_slots[(rva + size - 1) / (page_mask + 1)] = 1;
+            }
+        }
+    }
+    return 1;
+}
+
+/* check that a page is mapped from the headers or a section by the client */
+static int is_image_page_mapped( const struct image_layout *layout, size_t rva )
+{
+    size_t map_size, file_size;
+    off_t file_start;
+    unsigned int i;
+
+    if (rva < ROUND_SIZE( layout->header_size )) return 1;
+    for (i = 0; i < layout->nb_sec; i++)
+    {
+        get_section_sizes( &layout->sec[i], &map_size, &file_start, &file_size );
+        if (rva >= layout->sec[i].VirtualAddress && rva - layout->sec[i].VirtualAddress < map_size) return 1;
+    }
+    return 0;
+}
+
+/* build the pages of an image changed by relocating it to the specified base, in the same way
+ * as map_image_into_view in ntdll; returns 0 if the image can't be cached */
+static int build_reloc_image( struct reloc_image *reloc, struct mapping *mapping, int unix_fd,
+                              file_pos_t st_size )
+{
+    static const unsigned int sector_align = 0x1ff;
+    IMAGE_SECTION_HEADER sec[96];
+    IMAGE_DATA_DIRECTORY dir;
+    IMAGE_FILE_HEADER file_header;
+    struct image_layout layout;
+    char *header = NULL, *relocs = NULL, *data = NULL;
+    unsigned int *page_slots = NULL;
+    unsigned int i, page, nb_pages, count = 0;
+    size_t header_alloc, nt_pos, opt_pos, sec_pos, base_pos, dir_pos, base_size, map_size, file_size, end;
+    off_t file_start;
+    WORD magic;
+    DWORD dir_count;
+    INT64 delta = reloc->base - mapping->image.base;
+    int ret = 0, fd;
+
+    if (mapping->image.image_flags & IMAGE_FLAGS_ImageMappedFlat) return 0;
+    if ((mapping->image.map_size & page_mask) || !mapping->image.map_size) return 0;
+
+    layout.unix_fd     = unix_fd;
+    layout.header_size = min( mapping->image.header_size, st_size );
+    layout.total_size  = mapping->image.map_size;
+    layout.sec         = sec;
+    nb_pages = layout.total_size / (page_mask + 1);
+    if (!layout.header_size) return 0;
+
+    /* load the headers and locate the fields used by the relocation */
+
+    header_alloc = ROUND_SIZE( layout.header_size );
+    if (header_alloc > layout.total_size) return 0;
+    if (!(header = mem_alloc( header_alloc ))) return 0;
+    load_image_page( &layout, 0, header );
+    for (i = 1; i < header_alloc / (page_mask + 1); i++)
+        load_image_page( &layout, i * (page_mask + 1), header + i * (page_mask + 1) );
+
+    nt_pos = ((IMAGE_DOS_HEADER *)header)->e_lfanew;
+    opt_pos = nt_pos + sizeof(DWORD) + sizeof(file_header);
+    if (nt_pos >= header_alloc || opt_pos + sizeof(IMAGE_OPTIONAL_HEADER64) > header_alloc) goto done;
+    memcpy( &file_header, header + nt_pos + sizeof(DWORD), sizeof(file_header) );
+    memcpy( &magic, header + opt_pos, sizeof(magic) );
+    switch (magic)
+    {
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        base_pos = opt_pos + offsetof( IMAGE_OPTIONAL_HEADER64, ImageBase );
+        base_size = sizeof(ULONGLONG);
+        memcpy( &dir_count, header + opt_pos + offsetof( IMAGE_OPTIONAL_HEADER64, NumberOfRvaAndSizes ),
+                sizeof(dir_count) );
+        dir_pos = opt_pos + offsetof( IMAGE_OPTIONAL_HEADER64, DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC] );
+        break;
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        /* a 32-bit ntdll uses a 32-bit delta */
+        if (delta != (int)delta) goto done;
+        base_pos = opt_pos + offsetof( IMAGE_OPTIONAL_HEADER32, ImageBase );
+        base_size = sizeof(DWORD);
+        memcpy( &dir_count, header + opt_pos + offsetof( IMAGE_OPTIONAL_HEADER32, NumberOfRvaAndSizes ),
+                sizeof(dir_count) );
+        dir_pos = opt_pos + offsetof( IMAGE_OPTIONAL_HEADER32, DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC] );
+        break;
+    default:
+        goto done;
+    }
+
+    sec_pos = opt_pos + file_header.SizeOfOptionalHeader;
+    layout.nb_sec = file_header.NumberOfSections;
+    if (layout.nb_sec > ARRAY_SIZE( sec )) goto done;
+    if (sec_pos + layout.nb_sec * sizeof(*sec) > header_alloc) goto done;
+    memcpy( sec, header + sec_pos, layout.nb_sec * sizeof(*sec) );
+
+    /* only cache images with page-aligned sections in increasing order and past the headers,
+     * so that each page comes from a single place in the file; the other ones are left to the
+     * client, as are those that it would fail to load */
+
+    end = header_alloc;
+    for (i = 0; i < layout.nb_sec; i++)
+    {
+        get_section_sizes( &sec[i], &map_size, &file_start, &file_size );
+        if ((sec[i].VirtualAddress & page_mask) || sec[i].VirtualAddress < end) goto done;
+        end = sec[i].VirtualAddress + map_size;
+        if (end > layout.total_size || end < sec[i].VirtualAddress) goto done;
+        if (sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) goto done;
+        if (!sec[i].PointerToRawData || !file_size) continue;
+        if (sec[i].PointerToRawData >= st_size ||
+            file_start + file_size > ((st_size + sector_align) & ~sector_align))
+            goto done;
+    }
+
+    if (dir_count <= IMAGE_DIRECTORY_ENTRY_BASERELOC) goto done;
+    memcpy( &dir, header + dir_pos, sizeof(dir) );
+    if (!dir.Size || !dir.VirtualAddress || dir.VirtualAddress >= layout.total_size) goto done;
+    if (dir.Size > layout.total_size - dir.VirtualAddress) goto done;
+    if (dir.VirtualAddress < header_alloc) goto done;
+
+    /* find the pages changed by the relocations */
+
+    if (!(page_slots = mem_alloc( nb_pages * sizeof(*page_slots) ))) goto done;
+    memset( page_slots, 0, nb_pages * sizeof(*page_slots) );
+    if (!(relocs = mem_alloc( dir.Size ))) goto done;
+    if (!read_image_data( &layout, dir.VirtualAddress, relocs, dir.Size )) goto done;
+    page_slots[base_pos / (page_mask + 1)] = 1;
+    page_slots[(base_pos + base_size - 1) / (page_mask + 1)] = 1;
+    if (!process_reloc_dir( &layout, relocs, dir.Size, page_slots, NULL, delta )) goto done;
+
+    for (page = 0; page < nb_pages; page++)
+    {
+        if (!page_slots[page]) continue;
+        if (!is_image_page_mapped( &layout, page * (page_mask + 1) )) goto done;
+        /* the client reads the relocations from the image while relocating it */
+        if (page * (page_mask + 1) < dir.VirtualAddress + dir.Size &&
+            (page + 1) * (page_mask + 1) > dir.VirtualAddress) goto done;
+        page_slots[page] = ++count;
+    }
+
+    /* build the relocated pages */
+
+    if (!(reloc->pages = mem_alloc( count * sizeof(*reloc->pages) ))) goto done;
+    if (!(data = mem_alloc( (size_t)count * (page_mask + 1) ))) goto done;
+    for (page = 0; page < nb_pages; page++)
+    {
+        if (!page_slots[page]) continue;
+        reloc->pages[page_slots[page] - 1] = page * (page_mask + 1);
+        load_image_page( &layout, page * (page_mask + 1), data + (page_slots[page] - 1) * (page_mask + 1) );
+    }
+    memcpy( data + (page_slots[base_pos / (page_mask + 1)] - 1) * (page_mask + 1) + (base_pos & page_mask),
+            &reloc->base, base_size );
+    process_reloc_dir( &layout, relocs, dir.Size, page_slots, data, delta );
+
+    if ((fd = create_readonly_temp_file( data, (size_t)count * (page_mask + 1) )) == -1) goto done;
+    if (!(reloc->file = create_file_for_fd( fd, FILE_GENERIC_READ, 0 ))) goto done;
+    reloc->page_count = count;
+    ret = 1;
+
+done:
+    if (!ret)
+    {
+        free( reloc->pages );
+        reloc->pages = NULL;
+    }
+    free( data );
+    free( relocs );
+    free( page_slots );
+    free( header );
+    return ret;
+}
+
 /* free a PE mapping address range when the last mapping is closed */
 void free_map_addr( client_ptr_t base, mem_size_t size )
 {
@@ -1318,6 +1773,36 @@ void set_session_mapping( struct mapping *mapping )
     list_add_tail( &session.blocks, &block->entry );
 }
 
+/* create the fast sync objects mapping and map it in the server address space */
+void *create_fast_sync_mapping( struct object *root, const struct unicode_str *name, mem_size_t size )
+{
+    static const unsigned int access = FILE_READ_DATA | FILE_WRITE_DATA;
+    struct mapping *mapping;
+    void *ptr;
+
+    if (!(mapping = create_mapping( root, name, OBJ_PERMANENT, size, SEC_COMMIT, 0, access, NULL )))
+        return NULL;
+    ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    release_object( mapping );
+    if (ptr == MAP_FAILED) return NULL;
+    return ptr;
+}
+
+/* create an anonymous shared memory block, returns the unix fd to pass to the client */
+int create_shared_memory( mem_size_t size, void **ptr )
+{
+    int fd;
+
+    if ((fd = create_temp_file( size )) == -1) return -1;
+    if ((*ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        file_set_error();
+        close( fd );
+        return -1;
+    }
+    return fd;
+}
+
 static struct session_block *grow_session_mapping( mem_size_t needed )
 {
     mem_size_t old_size = session_mapping->size, new_size;
@@ -1534,6 +2019,75 @@ DECL_HANDLER(get_image_map_address)
     release_object( mapping );
 }
 
+/* get the pages of an image mapping relocated to its assigned address, building them the first time */
+DECL_HANDLER(get_image_reloc_data)
+{
+    struct reloc_image *reloc;
+    struct mapping *mapping;
+    struct stat st;
+    int unix_fd;
+
+    if (!reloc_cache_enabled())
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+    if (!(mapping = get_mapping_obj( current->process, req->handle, SECTION_MAP_READ ))) return;
+
+    if (!mapping->image.map_addr || req->base != mapping->image.map_addr)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        release_object( mapping );
+        return;
+    }
+
+    if (!(reloc = find_reloc_image( mapping, req->base, &st )) && get_error() == STATUS_NOT_FOUND &&
+        (reloc = mem_alloc( sizeof(*reloc) )))
+    {
+        clear_error();
+        reloc->dev        = st.st_dev;
+        reloc->ino        = st.st_ino;
+        reloc->mtime      = st.st_mtime;
+        reloc->ctime      = st.st_ctime;
+        get_stat_nsec( &st, &reloc->mtime_nsec, &reloc->ctime_nsec );
+        reloc->file_size  = st.st_size;
+        reloc->base       = req->base;
+        reloc->file       = NULL;
+        reloc->pages      = NULL;
+        reloc->page_count = 0;
+
+        /* images that can't be cached are remembered too, so that they are not parsed again;
+         * an image changed while building the pages is not cached at all */
+        unix_fd = get_unix_fd( mapping->fd );
+        build_reloc_image( reloc, mapping, unix_fd, st.st_size );
+        if (fstat( unix_fd, &st ) == -1 || !is_reloc_image_file( reloc, &st ))
+        {
+            if (reloc->file) release_object( reloc->file );
+            free( reloc->pages );
+            free( reloc );
+            reloc = NULL;
+        }
+        else
+        {
+            list_add_head( &reloc_image_list, &reloc->entry );
+            if (++reloc_image_count > MAX_RELOC_IMAGES)
+                free_reloc_image( LIST_ENTRY( list_tail( &reloc_image_list ), struct reloc_image, entry ));
+        }
+        clear_error();
+    }
+
+    if (reloc && reloc->file)
+    {
+        list_remove( &reloc->entry );
+        list_add_head( &reloc_image_list, &reloc->entry );
+        if (reloc->page_count * sizeof(*reloc->pages) > get_reply_max_size())
+            set_error( STATUS_BUFFER_TOO_SMALL );
+        else if ((reply->data = alloc_handle( current->process, reloc->file, FILE_READ_DATA, 0 )))
+            set_reply_data( reloc->pages, reloc->page_count * sizeof(*reloc->pages) );
+    }
+    release_object( mapping );
+}
+
 /* add a memory view in the current process */
 DECL_HANDLER(map_view)
 {
@@ -32,6 +32,7 @@
 #include "winternl.h"
 
 #include "handle.h"
+#include "process.h"
 #include "thread.h"
 #include "request.h"
 #include "security.h"
@@ -57,11 +58,15 @@ struct mutex
     unsigned int   count;           /* recursion count */
     int            abandoned;       /* has it been abandoned? */
     struct list    entry;           /* entry in owner thread mutex list */
+    fast_sync_shm_t *fast;          /* shared state, if the mutex is a fast sync object */
 };
 
 static void mutex_dump( struct object *obj, int verbose );
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void mutex_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry );
+static int mutex_close_handle( struct object *obj, struct process *process, obj_handle_t handle );
 static void mutex_destroy( struct object *obj );
 static int mutex_signal( struct object *obj, unsigned int access );
 
@@ -70,8 +75,8 @@ static const struct object_ops mutex_ops =
     sizeof(struct mutex),      /* size */
     &mutex_type,               /* type */
     mutex_dump,                /* dump */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    mutex_add_queue,           /* add_queue */
+    mutex_remove_queue,        /* remove_queue */
     mutex_signaled,            /* signaled */
     mutex_satisfied,           /* satisfied */
     mutex_signal,              /* signal */
@@ -85,7 +90,7 @@ static const struct object_ops mutex_ops =
     default_unlink_name,       /* unlink_name */
     no_open_file,              /* open_file */
     no_kernel_obj_list,        /* get_kernel_obj_list */
-    no_close_handle,           /* close_handle */
+    mutex_close_handle,        /* close_handle */
     mutex_destroy              /* destroy */
 };
 
@@ -126,19 +131,55 @@ static struct mutex *create_mutex( struct object *root, const struct unicode_str
             mutex->count = 0;
             mutex->owner = NULL;
             mutex->abandoned = 0;
-            if (owned) do_grab( mutex, current );
+            list_init( &mutex->entry );
+            mutex->fast = alloc_fast_sync( FAST_SYNC_MUTEX, owned ? current->id : 0, !!owned );
+            if (!mutex->fast && owned) do_grab( mutex, current );
         }
     }
     return mutex;
 }
 
+fast_sync_shm_t *get_mutex_fast_sync( struct object *obj )
+{
+    if (obj->ops != &mutex_ops) return NULL;
+    return ((struct mutex *)obj)->fast;
+}
+
+static void abandon_fast_mutex( struct mutex *mutex, struct thread *thread )
+{
+    if (fast_sync_abandon_mutex( mutex->fast, thread->id )) wake_up( &mutex->obj, 0 );
+}
+
 void abandon_mutexes( struct thread *thread )
 {
+    struct object **objects;
+    unsigned int i, count;
     struct list *ptr;
 
+    /* fast mutexes are acquired without the server knowing, but the thread
+     * needs a handle to acquire them, so only these can be owned by it */
+    if ((objects = get_process_objects( thread->process, &mutex_ops, &count )))
+    {
+        for (i = 0; i < count; i++)
+        {
+            struct mutex *mutex = (struct mutex *)objects[i];
+            if (mutex->fast) abandon_fast_mutex( mutex, thread );
+            release_object( mutex );
+        }
+        free( objects );
+    }
+
     while ((ptr = list_head( &thread->mutex_list )) != NULL)
     {
         struct mutex *mutex = LIST_ENTRY( ptr, struct mutex, entry );
+
+        if (mutex->fast)
+        {
+            list_remove( &mutex->entry );
+            list_init( &mutex->entry );
+            abandon_fast_mutex( mutex, thread );
+            continue;
+        }
         assert( mutex->owner == thread );
         mutex->count = 0;
         mutex->abandoned = 1;
@@ -150,13 +191,33 @@ static void mutex_dump( struct object *obj, int verbose )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
-    fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+    if (mutex->fast)
+        fprintf( stderr, "Mutex count=%u owner=%04x fast\n", mutex->fast->param, mutex->fast->state );
+    else
+        fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+}
+
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+    if (mutex->fast) fast_sync_add_waiter( mutex->fast );
+    return add_queue( obj, entry );
+}
+
+static void mutex_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+    if (mutex->fast) fast_sync_remove_waiter( mutex->fast );
+    remove_queue( obj, entry );
 }
 
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
+    if (mutex->fast) return fast_sync_signaled( mutex->fast, get_wait_queue_thread( entry )->id );
     return (!mutex->count || (mutex->owner == get_wait_queue_thread( entry )));
 }
 
@@ -165,11 +226,34 @@ static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
+    if (mutex->fast)
+    {
+        switch (fast_sync_satisfied( mutex->fast, get_wait_queue_thread( entry )->id ))
+        {
+        case 1: make_wait_abandoned( entry ); break;
+        case -1: make_wait_lost( entry ); break;
+        }
+        return;
+    }
     do_grab( mutex, get_wait_queue_thread( entry ));
     if (mutex->abandoned) make_wait_abandoned( entry );
     mutex->abandoned = 0;
 }
 
+static int release_fast_mutex( struct mutex *mutex, unsigned int *prev )
+{
+    unsigned int status, count;
+
+    if ((status = fast_sync_release_mutex( mutex->fast, current->id, &count )))
+    {
+        set_error( status );
+        return 0;
+    }
+    if (prev) *prev = count;
+    if (count == 1) wake_up( &mutex->obj, 0 );
+    return 1;
+}
+
 static int mutex_signal( struct object *obj, unsigned int access )
 {
     struct mutex *mutex = (struct mutex *)obj;
@@ -180,6 +264,7 @@ static int mutex_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
+    if (mutex->fast) return release_fast_mutex( mutex, NULL );
     if (!mutex->count || (mutex->owner != current))
     {
         set_error( STATUS_MUTANT_NOT_OWNED );
@@ -189,11 +274,38 @@ static int mutex_signal( struct object *obj, unsigned int access )
     return 1;
 }
 
+/* a fast mutex may still be owned by a thread of the process after its handles
+ * are closed, put it in the owner list so that it can be abandoned later */
+static int mutex_close_handle( struct object *obj, struct process *process, obj_handle_t handle )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    thread_id_t owner;
+    struct thread *thread;
+    assert( obj->ops == &mutex_ops );
+
+    if (!mutex->fast || !list_empty( &mutex->entry )) return 1;
+    if (!(owner = fast_sync_get_state( mutex->fast ))) return 1;
+
+    LIST_FOR_EACH_ENTRY( thread, &process->thread_list, struct thread, proc_entry )
+    {
+        if (thread->id != owner) continue;
+        list_add_tail( &thread->mutex_list, &mutex->entry );
+        break;
+    }
+    return 1;
+}
+
 static void mutex_destroy( struct object *obj )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
+    if (mutex->fast)
+    {
+        list_remove( &mutex->entry );
+        free_fast_sync( mutex->fast );
+        return;
+    }
     if (!mutex->count) return;
     mutex->count = 0;
     do_release( mutex );
@@ -240,7 +352,8 @@ DECL_HANDLER(release_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  0, &mutex_ops )))
     {
-        if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
+        if (mutex->fast) release_fast_mutex( mutex, &reply->prev_count );
+        else if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
         else
         {
             reply->prev_count = mutex->count;
@@ -258,9 +371,18 @@ DECL_HANDLER(query_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  MUTANT_QUERY_STATE, &mutex_ops )))
     {
-        reply->count = mutex->count;
-        reply->owned = (mutex->owner == current);
-        reply->abandoned = mutex->abandoned;
+        if (mutex->fast)
+        {
+            reply->owned = (fast_sync_get_state( mutex->fast ) == (int)current->id);
+            reply->count = mutex->fast->param;
+            reply->abandoned = mutex->fast->abandoned;
+        }
+        else
+        {
+            reply->count = mutex->count;
+            reply->owned = (mutex->owner == current);
+            reply->abandoned = mutex->abandoned;
+        }
 
         release_object( mutex );
     }
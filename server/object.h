@@ -216,10 +216,35 @@ extern struct event *get_event_obj( struct process *process, obj_handle_t handle
 extern struct keyed_event *get_keyed_event_obj( struct process *process, obj_handle_t handle, unsigned int access );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
+extern fast_sync_shm_t *get_event_fast_sync( struct object *obj );
 
 /* mutex functions */
 
 extern void abandon_mutexes( struct thread *thread );
+extern fast_sync_shm_t *get_mutex_fast_sync( struct object *obj );
+
+/* semaphore functions */
+
+extern fast_sync_shm_t *get_semaphore_fast_sync( struct object *obj );
+
+/* fast sync functions */
+
+extern void init_fast_sync(void);
+extern void free_process_fast_sync( struct process *process );
+extern fast_sync_shm_t *alloc_fast_sync( int type, int state, int param );
+extern void free_fast_sync( fast_sync_shm_t *shm );
+extern fast_sync_shm_t *get_obj_fast_sync( struct object *obj );
+extern void fast_sync_add_waiter( fast_sync_shm_t *shm );
+extern void fast_sync_remove_waiter( fast_sync_shm_t *shm );
+extern int fast_sync_get_state( fast_sync_shm_t *shm );
+extern int fast_sync_signaled( fast_sync_shm_t *shm, thread_id_t tid );
+extern int fast_sync_satisfied( fast_sync_shm_t *shm, thread_id_t tid );
+extern void fast_sync_unsatisfied( fast_sync_shm_t *shm );
+extern int fast_sync_set_event( fast_sync_shm_t *shm, int state );
+extern void fast_sync_pulse_event( fast_sync_shm_t *shm );
+extern unsigned int fast_sync_release_semaphore( fast_sync_shm_t *shm, unsigned int count, unsigned int *prev );
+extern unsigned int fast_sync_release_mutex( fast_sync_shm_t *shm, thread_id_t tid, unsigned int *prev );
+extern int fast_sync_abandon_mutex( fast_sync_shm_t *shm, thread_id_t tid );
 
 /* serial functions */
 
@@ -228,6 +253,7 @@ int get_serial_async_timeout(struct object *obj, int type, int count);
 /* socket functions */
 
 extern void sock_init(void);
+extern void init_sock_shm( struct object *root );
 
 /* debugger functions */
 
@@ -321,6 +347,7 @@ extern struct type_descr winstation_type;
 extern struct type_descr desktop_type;
 extern struct type_descr device_type;
 extern struct type_descr completion_type;
+extern struct type_descr wait_completion_packet_type;
 extern struct type_descr file_type;
 extern struct type_descr mapping_type;
 extern struct type_descr key_type;
@@ -654,6 +654,9 @@ struct process *create_process( int fd, struct process *parent, unsigned int fla
     process->debug_event     = NULL;
     process->handles         = NULL;
     process->msg_fd          = NULL;
+    process->request_shm     = NULL;
+    process->fast_sync       = NULL;
+    process->async_results   = NULL;
     process->sigkill_timeout = NULL;
     process->sigkill_delay   = TICKS_PER_SEC / 64;
     process->machine         = native_machine;
@@ -776,6 +779,9 @@ static void process_destroy( struct object *obj )
     }
     if (process->console) release_object( process->console );
     if (process->msg_fd) release_object( process->msg_fd );
+    free_process_request_shm( process );
+    free_process_fast_sync( process );
+    free_process_async_results( process );
     if (process->idle_event) release_object( process->idle_event );
     if (process->id) free_ptid( process->id );
     if (process->token) release_object( process->token );
@@ -965,6 +971,9 @@ static void process_killed( struct process *process )
     process->desktop = 0;
     cancel_process_asyncs( process );
     close_process_handles( process );
+    free_process_request_shm( process );
+    free_process_fast_sync( process );
+    free_process_async_results( process );
     if (process->idle_event) release_object( process->idle_event );
     process->idle_event = NULL;
     assert( !process->console );
@@ -43,6 +43,9 @@ struct process
     struct debug_event  *debug_event;     /* debug event being sent to debugger */
     struct handle_table *handles;         /* handle entries */
     struct fd           *msg_fd;          /* fd for sendmsg/recvmsg */
+    struct request_shm  *request_shm;     /* shared memory request slots */
+    struct fast_sync_section *fast_sync;  /* fast sync objects shared memory */
+    struct fd           *async_results;   /* pipe for the results of client file asyncs */
     process_id_t         id;              /* id of the process */
     process_id_t         group_id;        /* group id of the process */
     unsigned int         session_id;      /* session id */
@@ -99,6 +99,7 @@ struct key
 #define KEY_SYMLINK  0x0008  /* key is a symbolic link */
 #define KEY_WOWSHARE 0x0010  /* key is a Wow64 shared key (used for Software\Classes) */
 #define KEY_PREDEF   0x0020  /* key is marked as predefined */
+#define KEY_CHANGED  0x0040  /* key itself has been modified since the last save */
 
 #define OBJ_KEY_WOW64 0x100000 /* magic flag added to attributes for WoW64 redirection */
 
@@ -131,19 +132,45 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
+static void make_dirty( struct key *key );
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
 
+/* identification of the branch file a journal or snapshot file applies to */
+struct branch_stamp
+{
+    unsigned long long size;
+    unsigned long long mtime;
+    unsigned long long mtime_nsec;
+    unsigned long long ino;
+};
+
 /* information about where to save a registry branch */
 struct save_branch_info
 {
-    struct key  *key;
-    const char  *filename;
+    struct key          *key;
+    const char          *filename;
+    struct branch_stamp  stamp;         /* branch file at the last full save */
+    long                 journal_size;  /* size of the change journal, 0 if there is none */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
 static int save_branch_count;
 static struct save_branch_info save_branch_info[MAX_SAVE_BRANCH_INFO];
 
+/* a deleted key waiting to be written to the change journals */
+struct deleted_key
+{
+    struct list  entry;
+    WCHAR       *path;  /* full path of the key */
+    data_size_t  len;
+};
+
+static int registry_journal;  /* save the changes to journal files instead of rewriting the branches */
+static int journal_compact;   /* the pending changes can't be described in the journals */
+static struct list deleted_keys = LIST_INIT(deleted_keys);
+
+static void save_snapshot( const struct save_branch_info *branch );
+
 unsigned int supported_machines_count = 0;
 unsigned short supported_machines[8];
 unsigned short native_machine = 0;
@@ -336,6 +363,25 @@ static int grow_subkeys( struct key *key )
     return 1;
 }
 
+/* save a registry key and its values to a text file */
+static void save_key( const struct key *key, const struct key *base, FILE *f )
+{
+    int i;
+
+    fprintf( f, "\n[" );
+    if (key != base) dump_path( key, base, f );
+    fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
+    fprintf( f, "#time=%x%08x\n", (unsigned int)(key->modif >> 32), (unsigned int)key->modif );
+    if (key->class)
+    {
+        fprintf( f, "#class=\"" );
+        dump_strW( key->class, key->classlen, f, "\"\"" );
+        fprintf( f, "\"\n" );
+    }
+    if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
+    for (i = 0; i <= key->last_value; i++) dump_value( &key->values[i], f );
+}
+
 /* save a registry and all its subkeys to a text file */
 static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
 {
@@ -345,23 +391,21 @@ static void save_subkeys( const struct key *key, const struct key *base, FILE *f
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
-    {
-        fprintf( f, "\n[" );
-        if (key != base) dump_path( key, base, f );
-        fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
-        fprintf( f, "#time=%x%08x\n", (unsigned int)(key->modif >> 32), (unsigned int)key->modif );
-        if (key->class)
-        {
-            fprintf( f, "#class=\"" );
-            dump_strW( key->class, key->classlen, f, "\"\"" );
-            fprintf( f, "\"\n" );
-        }
-        if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
-        for (i = 0; i <= key->last_value; i++) dump_value( &key->values[i], f );
-    }
+        save_key( key, base, f );
     for (i = 0; i <= key->last_subkey; i++) save_subkeys( key->subkeys[i], base, f );
 }
 
+/* save the keys modified since the last save to a journal file */
+static void save_changed_keys( const struct key *key, const struct key *base, FILE *f )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(key->flags & KEY_DIRTY)) return;
+    if (key->flags & KEY_CHANGED) save_key( key, base, f );
+    for (i = 0; i <= key->last_subkey; i++) save_changed_keys( key->subkeys[i], base, f );
+}
+
 static void dump_operation( const struct key *key, const struct key_value *value, const char *op )
 {
     fprintf( stderr, "%s key ", op );
@@ -719,7 +763,7 @@ static struct key *create_key_object( struct object *parent, const struct unicod
                 release_object( key );
                 return NULL;
             }
-            else key->flags |= KEY_DIRTY;
+            else make_dirty( key );
         }
     }
     return key;
@@ -728,6 +772,7 @@ static struct key *create_key_object( struct object *parent, const struct unicod
 /* mark a key and all its parents as dirty (modified) */
 static void make_dirty( struct key *key )
 {
+    if (!(key->flags & KEY_VOLATILE)) key->flags |= KEY_CHANGED;
     while (key)
     {
         if (key->flags & (KEY_DIRTY|KEY_VOLATILE)) return;  /* nothing to do */
@@ -743,7 +788,7 @@ static void make_clean( struct key *key )
 
     if (key->flags & KEY_VOLATILE) return;
     if (!(key->flags & KEY_DIRTY)) return;
-    key->flags &= ~KEY_DIRTY;
+    key->flags &= ~(KEY_DIRTY | KEY_CHANGED);
     for (i = 0; i <= key->last_subkey; i++) make_clean( key->subkeys[i] );
 }
 
@@ -1052,9 +1097,38 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
     key->obj.name = new_name_ptr;
 
     if (debug_level > 1) dump_operation( key, NULL, "Rename" );
+    journal_compact = 1;  /* the whole subtree moved */
     touch_key( key, REG_NOTIFY_CHANGE_NAME );
 }
 
+/* remember a deleted key until the next journal save */
+static void journal_deleted_key( struct key *key )
+{
+    struct deleted_key *deleted;
+
+    if (!registry_journal || (key->flags & KEY_VOLATILE)) return;
+    if (!(deleted = malloc( sizeof(*deleted) )) || !(deleted->path = default_get_full_name( &key->obj, &deleted->len )))
+    {
+        free( deleted );
+        journal_compact = 1;
+        return;
+    }
+    list_add_tail( &deleted_keys, &deleted->entry );
+}
+
+/* forget the deleted keys once the branches are saved */
+static void clear_deleted_keys(void)
+{
+    struct deleted_key *deleted, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( deleted, next, &deleted_keys, struct deleted_key, entry )
+    {
+        list_remove( &deleted->entry );
+        free( deleted->path );
+        free( deleted );
+    }
+}
+
 /* delete a key and its values */
 static int delete_key( struct key *key, int recurse )
 {
@@ -1085,6 +1159,7 @@ static int delete_key( struct key *key, int recurse )
     }
 
     if (debug_level > 1) dump_operation( key, NULL, "Delete" );
+    journal_deleted_key( key );
     key->flags |= KEY_DELETED;
     unlink_named_object( &key->obj );
     touch_key( parent, REG_NOTIFY_CHANGE_NAME );
@@ -1784,6 +1859,304 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
     free( info.tmp );
 }
 
+/* remove all the values of a key */
+static void clear_values( struct key *key )
+{
+    int i;
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        free( key->values[i].name );
+        free( key->values[i].data );
+    }
+    key->last_value = -1;
+}
+
+/* delete a key listed in a journal file */
+static void load_deleted_key( struct key *base, const char *buffer, struct file_load_info *info )
+{
+    struct key *key = base;
+    struct unicode_str name;
+    data_size_t len;
+    int index;
+
+    if (!get_file_tmp_space( info, strlen(buffer) * sizeof(WCHAR) )) return;
+    len = info->tmplen;
+    if (parse_strW( info->tmp, &len, buffer, ']' ) == -1)
+    {
+        file_read_error( "Malformed key", info );
+        return;
+    }
+    len -= sizeof(WCHAR);  /* terminating null */
+    name.str = info->tmp;
+    while (key && len)
+    {
+        name.len = get_path_element( name.str, len );
+        key = find_subkey( key, &name, &index );
+        if (name.len < len) name.len += sizeof(WCHAR);  /* skip the backslash */
+        name.str += name.len / sizeof(WCHAR);
+        len -= name.len;
+    }
+    if (key && key != base) delete_key( key, 1 );
+}
+
+/* get the identification of a branch file */
+static void get_branch_stamp( const struct stat *st, struct branch_stamp *stamp )
+{
+    stamp->size  = st->st_size;
+    stamp->mtime = st->st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    stamp->mtime_nsec = st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    stamp->mtime_nsec = st->st_mtimespec.tv_nsec;
+#else
+    stamp->mtime_nsec = 0;
+#endif
+    stamp->ino   = st->st_ino;
+}
+
+/* apply the changes recorded in the journal of a branch after loading it */
+static void load_branch_journal( struct save_branch_info *branch )
+{
+    struct key *subkey = NULL;
+    struct file_load_info info;
+    struct branch_stamp stamp;
+    timeout_t modif = current_time;
+    char name[32];
+    long end = 0;
+    char *p;
+
+    snprintf( name, sizeof(name), "%s.journal", branch->filename );
+    if (!(info.file = fopen( name, "r" ))) return;
+
+    info.filename = name;
+    info.len    = 4;
+    info.tmplen = 4;
+    info.line   = 0;
+    info.buffer = mem_alloc( info.len );
+    info.tmp    = mem_alloc( info.tmplen );
+    if (!info.buffer || !info.tmp) goto done;
+
+    /* the journal only applies to the branch file it was started from */
+    if ((read_next_line( &info ) != 1) || strcmp( info.buffer, "WINE REGISTRY Journal 2" ) ||
+        (read_next_line( &info ) != 1) ||
+        sscanf( info.buffer, "#base=%llx,%llx,%llx,%llx", &stamp.size, &stamp.mtime, &stamp.mtime_nsec,
+                &stamp.ino ) != 4 ||
+        memcmp( &stamp, &branch->stamp, sizeof(stamp) ))
+    {
+        fprintf( stderr, "%s: ignoring journal of a different registry file\n", name );
+        goto done;
+    }
+
+    /* only apply the changes up to the last complete save */
+    while (read_next_line( &info ) == 1) if (!strcmp( info.buffer, "#commit" )) end = ftell( info.file );
+    if (fseek( info.file, 0, SEEK_SET ) || read_next_line( &info ) != 1 || read_next_line( &info ) != 1)
+        goto done;
+    info.line = 2;
+
+    while (ftell( info.file ) < end && read_next_line( &info ) == 1)
+    {
+        p = info.buffer;
+        while (*p && isspace(*p)) p++;
+        switch(*p)
+        {
+        case '[':   /* key, deleted or with its full contents */
+            if (subkey)
+            {
+                update_key_time( subkey, modif );
+                release_object( subkey );
+                subkey = NULL;
+            }
+            if (p[1] == '-') load_deleted_key( branch->key, p + 2, &info );
+            else if ((subkey = load_key( branch->key, p + 1, 0, &info, &modif )))
+            {
+                clear_values( subkey );
+                subkey->modif = 0;
+            }
+            else file_read_error( "Error creating key", &info );
+            break;
+        case '@':   /* default value */
+        case '\"':  /* value */
+            if (subkey) load_value( subkey, p, &info );
+            else file_read_error( "Value without key", &info );
+            break;
+        case '#':   /* option */
+            if (subkey) load_key_option( subkey, p, &info );
+            break;
+        case ';':   /* comment */
+        case 0:     /* empty line */
+            break;
+        default:
+            file_read_error( "Unrecognized input", &info );
+            break;
+        }
+    }
+
+    /* drop an incomplete save, the next one will be appended after the last complete one */
+    if (subkey)
+    {
+        update_key_time( subkey, modif );
+        release_object( subkey );
+    }
+    if (end && !truncate( name, end )) branch->journal_size = end;
+
+ done:
+    fclose( info.file );
+    free( info.buffer );
+    free( info.tmp );
+}
+
+/*
+ * The binary snapshot of a branch is a cache of its text file, written after
+ * each full save in journal mode. It is only used if the text file is still
+ * the one it was made from, so editing the text file by hand invalidates it.
+ * All the fields are 32-bit aligned:
+ *
+ *   header   snapshot_header
+ *   key      flags, modif (64-bit), class length, class, value count, values,
+ *            subkey count, then for each subkey its name length, name and key
+ *   value    name length, name, type, data length, data
+ */
+
+#define SNAPSHOT_MAGIC   "WINEREGB"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_LINK    0x0001  /* key is a symbolic link */
+
+struct snapshot_header
+{
+    char                magic[8];  /* SNAPSHOT_MAGIC */
+    unsigned int        version;   /* SNAPSHOT_VERSION */
+    unsigned int        arch;      /* prefix type */
+    struct branch_stamp stamp;     /* branch file the snapshot was made from */
+};
+
+struct snapshot_reader
+{
+    const char *ptr;
+    const char *end;
+};
+
+/* read a block of data from a snapshot, 32-bit aligned */
+static const void *snapshot_read( struct snapshot_reader *reader, size_t size )
+{
+    const void *ret = reader->ptr;
+    size_t aligned = (size + 3) & ~3;
+
+    if (aligned < size || aligned > (size_t)(reader->end - reader->ptr)) return NULL;
+    reader->ptr += aligned;
+    return ret;
+}
+
+static int snapshot_read_uint( struct snapshot_reader *reader, unsigned int *val )
+{
+    const void *ptr = snapshot_read( reader, sizeof(*val) );
+
+    if (!ptr) return 0;
+    memcpy( val, ptr, sizeof(*val) );
+    return 1;
+}
+
+/* read a key name or value name from a snapshot */
+static int snapshot_read_name( struct snapshot_reader *reader, struct unicode_str *name, data_size_t max_len )
+{
+    unsigned int len;
+
+    if (!snapshot_read_uint( reader, &len ) || len % sizeof(WCHAR) || len > max_len) return 0;
+    if (!(name->str = snapshot_read( reader, len ))) return 0;
+    name->len = len;
+    return 1;
+}
+
+/* load a key, its values and its subkeys from a snapshot */
+static int load_snapshot_key( struct key *key, struct snapshot_reader *reader )
+{
+    struct unicode_str name;
+    struct key_value *value;
+    struct key *subkey;
+    unsigned int i, count, flags, type, len;
+    const void *data;
+    int index, ret;
+
+    if (!snapshot_read_uint( reader, &flags )) return 0;
+    if (!(data = snapshot_read( reader, sizeof(key->modif) ))) return 0;
+    memcpy( &key->modif, data, sizeof(key->modif) );
+    if (flags & SNAPSHOT_LINK) key->flags |= KEY_SYMLINK;
+
+    if (!snapshot_read_uint( reader, &len ) || !(data = snapshot_read( reader, len ))) return 0;
+    if (len)
+    {
+        free( key->class );
+        if (!(key->class = memdup( data, len ))) len = 0;
+        key->classlen = len;
+    }
+
+    if (!snapshot_read_uint( reader, &count )) return 0;
+    for (i = 0; i < count; i++)
+    {
+        void *ptr = NULL;
+
+        if (!snapshot_read_name( reader, &name, MAX_VALUE_LEN * sizeof(WCHAR) )) return 0;
+        if (!snapshot_read_uint( reader, &type ) || !snapshot_read_uint( reader, &len )) return 0;
+        if (!(data = snapshot_read( reader, len ))) return 0;
+        if (!(value = find_value( key, &name, &index )) && !(value = insert_value( key, &name, index )))
+            return 0;
+        if (len && !(ptr = memdup( data, len ))) return 0;
+        free( value->data );
+        value->type = type;
+        value->len  = len;
+        value->data = ptr;
+    }
+
+    if (!snapshot_read_uint( reader, &count )) return 0;
+    for (i = 0; i < count; i++)
+    {
+        if (!snapshot_read_name( reader, &name, MAX_NAME_LEN * sizeof(WCHAR) )) return 0;
+        if (!name.len || get_path_element( name.str, name.len ) != name.len) return 0;
+        if (!(subkey = create_key_object( &key->obj, &name, OBJ_OPENIF, 0, 0, NULL ))) return 0;
+        ret = load_snapshot_key( subkey, reader );
+        release_object( subkey );
+        if (!ret) return 0;
+    }
+    return 1;
+}
+
+/* load a branch from its snapshot if it matches the branch file */
+static int load_snapshot( struct key *key, const char *filename, const struct branch_stamp *stamp )
+{
+    struct snapshot_header header;
+    struct snapshot_reader reader;
+    struct stat st;
+    char name[32], *buffer;
+    int fd, ret = 0;
+
+    snprintf( name, sizeof(name), "%s.bin", filename );
+    if ((fd = open( name, O_RDONLY )) == -1) return 0;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(header) ||
+        read( fd, &header, sizeof(header) ) != sizeof(header) ||
+        memcmp( header.magic, SNAPSHOT_MAGIC, sizeof(header.magic) ) ||
+        header.version != SNAPSHOT_VERSION ||
+        memcmp( &header.stamp, stamp, sizeof(*stamp) ) ||
+        (prefix_type != PREFIX_UNKNOWN && header.arch != prefix_type) ||
+        !(buffer = malloc( st.st_size - sizeof(header) )))
+    {
+        close( fd );
+        return 0;
+    }
+    if (read( fd, buffer, st.st_size - sizeof(header) ) == st.st_size - sizeof(header))
+    {
+        reader.ptr = buffer;
+        reader.end = buffer + st.st_size - sizeof(header);
+        if ((ret = load_snapshot_key( key, &reader )))
+        {
+            if (prefix_type == PREFIX_UNKNOWN) prefix_type = header.arch;
+        }
+        else fprintf( stderr, "%s: invalid registry snapshot, loading %s\n", name, filename );
+    }
+    free( buffer );
+    close( fd );
+    return ret;
+}
+
 /* load a part of the registry from a file */
 static void load_registry( struct key *key, obj_handle_t handle )
 {
@@ -1800,6 +2173,7 @@ static void load_registry( struct key *key, obj_handle_t handle )
         {
             load_keys( key, NULL, f, -1 );
             fclose( f );
+            journal_compact = 1;  /* existing keys may have changed too */
         }
         else file_set_error();
     }
@@ -1808,11 +2182,24 @@ static void load_registry( struct key *key, obj_handle_t handle )
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
+    struct save_branch_info *branch;
+    struct branch_stamp stamp;
+    struct stat st;
+    timeout_t start = monotonic_counter();
+    int snapshot = 0;
     FILE *f;
 
+    memset( &stamp, 0, sizeof(stamp) );
     if ((f = fopen( filename, "r" )))
     {
-        load_keys( key, filename, f, 0 );
+        /* snapshots are only kept in sync with the branch file when journaling */
+        if (registry_journal && !fstat( fileno( f ), &st ))
+        {
+            get_branch_stamp( &st, &stamp );
+            /* the snapshot mirrors the branch file, nothing is dirty after loading it */
+            if ((snapshot = load_snapshot( key, filename, &stamp ))) make_clean( key );
+        }
+        if (!snapshot) load_keys( key, filename, f, 0 );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
         {
@@ -1823,9 +2210,24 @@ static int load_init_registry_from_file( const char *filename, struct key *key )
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
-    save_branch_info[save_branch_count].filename = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    branch = &save_branch_info[save_branch_count++];
+    branch->filename = filename;
+    branch->key = (struct key *)grab_object( key );
+    branch->journal_size = 0;
     make_object_permanent( &key->obj );
+
+    if (f)
+    {
+        branch->stamp = stamp;
+        if (registry_journal && !snapshot) save_snapshot( branch );
+        load_branch_journal( branch );
+        clear_deleted_keys();
+        /* without the journal, the first periodic save compacts the changes into the branch file */
+        if (registry_journal) make_clean( key );
+    }
+    if (debug_level && f)
+        fprintf( stderr, "*registry* loaded %s from %s in %u ms\n", filename, snapshot ? "snapshot" : "text",
+                 (unsigned int)((monotonic_counter() - start) / 10000) );
     return (f != NULL);
 }
 
@@ -1901,6 +2303,11 @@ void init_registry(void)
 
     if (fchdir( config_dir_fd ) == -1) fatal_error( "chdir to config dir: %s\n", strerror( errno ));
 
+    /* if WINEREGJOURNAL is set, the periodic saves only append the modified keys to a
+     * journal next to each branch file, which is compacted into the branch file when it
+     * grows too large and on exit */
+    registry_journal = (p = getenv( "WINEREGJOURNAL" )) && atoi( p );
+
     /* create the root key */
     root_key = create_key_object( NULL, &root_name, OBJ_PERMANENT, 0, current_time, NULL );
     assert( root_key );
@@ -2012,6 +2419,147 @@ static void save_all_subkeys( struct key *key, FILE *f )
     save_subkeys( key, key, f );
 }
 
+/* write a block of data to a snapshot, 32-bit aligned */
+static void snapshot_write( const void *data, size_t size, FILE *f )
+{
+    static const char padding[3];
+
+    fwrite( data, 1, size, f );
+    if (size & 3) fwrite( padding, 1, 4 - (size & 3), f );
+}
+
+static void snapshot_write_uint( unsigned int val, FILE *f )
+{
+    snapshot_write( &val, sizeof(val), f );
+}
+
+/* save a key, its values and its subkeys to a snapshot */
+static void save_snapshot_key( const struct key *key, FILE *f )
+{
+    unsigned int count = 0;
+    int i;
+
+    snapshot_write_uint( (key->flags & KEY_SYMLINK) ? SNAPSHOT_LINK : 0, f );
+    snapshot_write( &key->modif, sizeof(key->modif), f );
+    snapshot_write_uint( key->class ? key->classlen : 0, f );
+    if (key->class) snapshot_write( key->class, key->classlen, f );
+
+    snapshot_write_uint( key->last_value + 1, f );
+    for (i = 0; i <= key->last_value; i++)
+    {
+        const struct key_value *value = &key->values[i];
+
+        snapshot_write_uint( value->namelen, f );
+        snapshot_write( value->name, value->namelen, f );
+        snapshot_write_uint( value->type, f );
+        snapshot_write_uint( value->len, f );
+        snapshot_write( value->data, value->len, f );
+    }
+
+    for (i = 0; i <= key->last_subkey; i++) if (!(key->subkeys[i]->flags & KEY_VOLATILE)) count++;
+    snapshot_write_uint( count, f );
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        const struct key *subkey = key->subkeys[i];
+
+        if (subkey->flags & KEY_VOLATILE) continue;
+        snapshot_write_uint( subkey->obj.name->len, f );
+        snapshot_write( subkey->obj.name->name, subkey->obj.name->len, f );
+        save_snapshot_key( subkey, f );
+    }
+}
+
+/* save the snapshot of a branch, after its file has been written or loaded */
+static void save_snapshot( const struct save_branch_info *branch )
+{
+    struct snapshot_header header;
+    char name[32], tmp[32];
+    FILE *f;
+
+    snprintf( name, sizeof(name), "%s.bin", branch->filename );
+    snprintf( tmp, sizeof(tmp), "reg%lx.bin.tmp", (long) getpid() );
+    if (!(f = fopen( tmp, "w" ))) return;
+
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.magic, SNAPSHOT_MAGIC, sizeof(header.magic) );
+    header.version = SNAPSHOT_VERSION;
+    header.arch    = prefix_type;
+    header.stamp   = branch->stamp;
+    fwrite( &header, sizeof(header), 1, f );
+    save_snapshot_key( branch->key, f );
+    if (fclose( f ) || rename( tmp, name )) unlink( tmp );
+}
+
+/* dump the path of a deleted key relative to a branch, if it belongs to it */
+static void dump_deleted_key( const struct deleted_key *deleted, const WCHAR *base, data_size_t base_len, FILE *f )
+{
+    const WCHAR *start = deleted->path + base_len / sizeof(WCHAR) + 1;
+    const WCHAR *end = deleted->path + deleted->len / sizeof(WCHAR);
+    const WCHAR *p;
+    data_size_t len;
+
+    if (deleted->len <= base_len + sizeof(WCHAR) || start[-1] != '\\') return;
+    if (memicmp_strW( deleted->path, base, base_len )) return;
+
+    fprintf( f, "\n[-" );
+    for (p = start; p < end; p += len / sizeof(WCHAR) + 1)
+    {
+        len = get_path_element( p, (end - p) * sizeof(WCHAR) );
+        if (p > start) fprintf( f, "\\\\" );
+        dump_strW( p, len, f, "[]" );
+    }
+    fprintf( f, "]\n" );
+}
+
+/* append the changes made to a branch since the last save to its journal file */
+static int save_branch_journal( struct save_branch_info *branch )
+{
+    struct deleted_key *deleted;
+    data_size_t base_len;
+    char name[32];
+    WCHAR *base;
+    long size;
+    FILE *f;
+
+    if (!(base = default_get_full_name( &branch->key->obj, &base_len ))) return 0;
+    snprintf( name, sizeof(name), "%s.journal", branch->filename );
+    if (!(f = fopen( name, branch->journal_size ? "a" : "w" )))
+    {
+        free( base );
+        return 0;
+    }
+
+    if (debug_level > 1)
+    {
+        fprintf( stderr, "%s: ", name );
+        dump_operation( branch->key, NULL, "saving changes" );
+    }
+
+    if (!branch->journal_size)
+        fprintf( f, "WINE REGISTRY Journal 2\n#base=%llx,%llx,%llx,%llx\n",
+                 branch->stamp.size, branch->stamp.mtime, branch->stamp.mtime_nsec, branch->stamp.ino );
+    LIST_FOR_EACH_ENTRY( deleted, &deleted_keys, struct deleted_key, entry )
+        dump_deleted_key( deleted, base, base_len, f );
+    save_changed_keys( branch->key, branch->key, f );
+    fprintf( f, "#commit\n" );
+    size = ftell( f );
+    free( base );
+
+    if (fclose( f ) || size <= 0) return 0;
+    branch->journal_size = size;
+    make_clean( branch->key );
+    return 1;
+}
+
+/* check if the changes to a branch can be appended to its journal instead of saving it */
+static int can_save_journal( const struct save_branch_info *branch )
+{
+    if (!registry_journal || journal_compact) return 0;
+    if (!branch->stamp.size) return 0;  /* no branch file to apply it to */
+    /* compact the journal once it grows to a quarter of the branch */
+    return branch->journal_size < max( branch->stamp.size / 4, 65536 );
+}
+
 /* save a registry branch to a file handle */
 static void save_registry( struct key *key, obj_handle_t handle )
 {
@@ -2038,14 +2586,16 @@ static void save_registry( struct key *key, obj_handle_t handle )
 }
 
 /* save a registry branch to a file */
-static int save_branch( struct key *key, const char *filename )
+static int save_branch( struct save_branch_info *branch )
 {
+    struct key *key = branch->key;
+    const char *filename = branch->filename;
     struct stat st;
     char tmp[32];
     int fd, count = 0, ret = 0;
     FILE *f;
 
-    if (!(key->flags & KEY_DIRTY))
+    if (!(key->flags & KEY_DIRTY) && !branch->journal_size)
     {
         if (debug_level > 1) dump_operation( key, NULL, "Not saving clean" );
         return 1;
@@ -2103,19 +2653,39 @@ static int save_branch( struct key *key, const char *filename )
     }
 
 done:
-    if (ret) make_clean( key );
+    if (ret)
+    {
+        make_clean( key );
+        if (!stat( filename, &st )) get_branch_stamp( &st, &branch->stamp );
+        else memset( &branch->stamp, 0, sizeof(branch->stamp) );
+        if (branch->journal_size)
+        {
+            snprintf( tmp, sizeof(tmp), "%s.journal", filename );
+            unlink( tmp );
+            branch->journal_size = 0;
+        }
+        if (registry_journal) save_snapshot( branch );
+    }
     return ret;
 }
 
 /* periodic saving of the registry */
 static void periodic_save( void *arg )
 {
-    int i;
+    int i, compact = 0;
 
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].filename );
+    {
+        struct save_branch_info *branch = &save_branch_info[i];
+
+        if (registry_journal && !(branch->key->flags & KEY_DIRTY)) continue;
+        if (can_save_journal( branch ) && save_branch_journal( branch )) continue;
+        if (!save_branch( branch )) compact = 1;
+    }
+    clear_deleted_keys();
+    journal_compact = compact;
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2135,13 +2705,14 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].filename ))
+        if (!save_branch( &save_branch_info[i] ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
                      save_branch_info[i].filename );
             perror( " " );
         }
     }
+    clear_deleted_keys();
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
 }
 
@@ -2221,7 +2792,9 @@ DECL_HANDLER(flush_key)
     struct key *key = get_hkey_obj( req->hkey, 0 );
     if (key)
     {
-        /* we don't need to do anything here with the current implementation */
+        /* appending to the journal is cheap, so flushes can make the changes durable then;
+         * otherwise we don't need to do anything here with the current implementation */
+        if (registry_journal) periodic_save( NULL );
         release_object( key );
     }
 }
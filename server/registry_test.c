@@ -0,0 +1,397 @@
+/*
+ * Registry journal and snapshot tests
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * The journal and the snapshots only matter across server restarts, which the
+ * Windows side tests can't do, so this runs its own servers in a temporary
+ * prefix with WINEREGJOURNAL set, kills them with SIGKILL to simulate crashes,
+ * and checks the registry contents through a bare client:
+ *
+ *   make server/registry_test && server/registry_test server/wineserver [keys]
+ *
+ * It also traces the save and startup times for a registry of the given size.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "client.h"
+#include "winnt.h"
+
+static const char *server_path;
+static char prefix[] = "/tmp/wine-registry-test-XXXXXX";
+static pid_t server_pid;
+static int failures, successes;
+
+#define WINE_KEY "\\Registry\\Machine\\Software\\Wine"
+#define TEST_KEY WINE_KEY "\\JournalTest"
+
+static void ok( int condition, const char *msg, ... )
+{
+    va_list args;
+
+    if (condition)
+    {
+        successes++;
+        return;
+    }
+    va_start( args, msg );
+    fprintf( stderr, "registry_test: Test failed: " );
+    vfprintf( stderr, msg, args );
+    va_end( args );
+    failures++;
+}
+
+static unsigned long long monotonic_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+static char *prefix_file( const char *name )
+{
+    static char path[sizeof(prefix) + 64];
+
+    snprintf( path, sizeof(path), "%s/%s", prefix, name );
+    return path;
+}
+
+static int file_exists( const char *name )
+{
+    struct stat st;
+    return !stat( prefix_file( name ), &st );
+}
+
+static off_t file_size( const char *name )
+{
+    struct stat st;
+    return stat( prefix_file( name ), &st ) ? -1 : st.st_size;
+}
+
+/* start a server in the test prefix and connect to it, returns the time it took in us */
+static unsigned long long start_server(void)
+{
+    unsigned long long start = monotonic_us();
+    int i;
+
+    if (!(server_pid = fork()))
+    {
+        int fd = open( "/dev/null", O_RDWR );
+        dup2( fd, 0 );
+        dup2( fd, 1 );
+        dup2( fd, 2 );
+        execl( server_path, server_path, "-f", "-p", NULL );
+        _exit( 1 );
+    }
+    if (server_pid == -1) fatal_error( "fork: %s\n", strerror( errno ));
+
+    for (i = 0; i < 10000; i++)
+    {
+        if (connect_client()) return monotonic_us() - start;
+        usleep( 1000 );
+    }
+    fatal_error( "the server didn't start\n" );
+}
+
+/* kill the server, SIGKILL leaves the registry as a crash would, SIGTERM saves it */
+static unsigned long long stop_server( int sig )
+{
+    unsigned long long start = monotonic_us();
+    int status;
+
+    close_client();
+    kill( server_pid, sig );
+    waitpid( server_pid, &status, 0 );
+    return monotonic_us() - start;
+}
+
+static data_size_t to_unicode( WCHAR *dst, const char *src )
+{
+    data_size_t i;
+
+    for (i = 0; src[i]; i++) dst[i] = (unsigned char)src[i];
+    return i * sizeof(WCHAR);
+}
+
+static obj_handle_t create_key( const char *path )
+{
+    struct
+    {
+        struct object_attributes attr;
+        WCHAR name[256];
+    } data;
+    union generic_request req;
+    union generic_reply reply;
+    unsigned int status;
+
+    memset( &data.attr, 0, sizeof(data.attr) );
+    data.attr.attributes = OBJ_CASE_INSENSITIVE | OBJ_OPENIF;
+    data.attr.name_len = to_unicode( data.name, path );
+
+    init_request( &req, REQ_create_key, 0 );
+    req.create_key_request.access = KEY_ALL_ACCESS;
+    status = server_call( &req, &reply, &data, sizeof(data.attr) + data.attr.name_len, NULL );
+    if (status && status != STATUS_OBJECT_NAME_EXISTS)
+        fatal_error( "creating %s failed %#x\n", path, status );
+    return reply.create_key_reply.hkey;
+}
+
+static void set_value( obj_handle_t hkey, const char *name, DWORD value )
+{
+    union generic_request req;
+    union generic_reply reply;
+    unsigned int status;
+    WCHAR data[64];
+    data_size_t len;
+
+    len = to_unicode( data, name );
+    memcpy( (char *)data + len, &value, sizeof(value) );
+
+    init_request( &req, REQ_set_key_value, 0 );
+    req.set_key_value_request.hkey = hkey;
+    req.set_key_value_request.type = REG_DWORD;
+    req.set_key_value_request.namelen = len;
+    if ((status = server_call( &req, &reply, data, len + sizeof(value), NULL )))
+        fatal_error( "setting %s failed %#x\n", name, status );
+}
+
+static unsigned int get_value( obj_handle_t hkey, const char *name, DWORD *value )
+{
+    union generic_request req;
+    union generic_reply reply;
+    WCHAR data[64];
+
+    *value = 0;
+    init_request( &req, REQ_get_key_value, sizeof(*value) );
+    req.get_key_value_request.hkey = hkey;
+    return server_call( &req, &reply, data, to_unicode( data, name ), value );
+}
+
+static void flush_key( obj_handle_t hkey )
+{
+    union generic_request req;
+    union generic_reply reply;
+
+    init_request( &req, REQ_flush_key, 0 );
+    req.flush_key_request.hkey = hkey;
+    server_call( &req, &reply, NULL, 0, NULL );
+}
+
+static void check_value( obj_handle_t hkey, const char *name, DWORD expect )
+{
+    unsigned int status;
+    DWORD value;
+
+    status = get_value( hkey, name, &value );
+    ok( !status, "getting %s failed %#x\n", name, status );
+    ok( value == expect, "got %s=%u, expected %u\n", name, (unsigned int)value, (unsigned int)expect );
+}
+
+static void test_journal_replay(void)
+{
+    obj_handle_t hkey;
+
+    start_server();
+    create_key( WINE_KEY );
+    hkey = create_key( TEST_KEY );
+    set_value( hkey, "a", 1 );
+    /* there's no branch file yet, this one is a full save */
+    flush_key( hkey );
+    ok( file_exists( "system.reg" ), "system.reg not saved\n" );
+    ok( file_exists( "system.reg.bin" ), "system.reg.bin not saved\n" );
+    ok( !file_exists( "system.reg.journal" ), "system.reg.journal already exists\n" );
+
+    set_value( hkey, "b", 2 );
+    flush_key( hkey );
+    ok( file_exists( "system.reg.journal" ), "system.reg.journal not saved\n" );
+    stop_server( SIGKILL );
+
+    hkey = start_server() ? create_key( TEST_KEY ) : 0;
+    check_value( hkey, "a", 1 );
+    check_value( hkey, "b", 2 );
+}
+
+static void test_crash_recovery(void)
+{
+    static const char partial[] = "\n[Software\\\\Wine\\\\JournalTest] 1\n\"d\"=dword:00000004\n";
+    obj_handle_t hkey = create_key( TEST_KEY );
+    unsigned int status;
+    off_t size;
+    DWORD value;
+    int fd;
+
+    set_value( hkey, "c", 3 );
+    flush_key( hkey );
+    set_value( hkey, "e", 5 );  /* never flushed */
+    stop_server( SIGKILL );
+
+    /* a save interrupted before its commit marker */
+    size = file_size( "system.reg.journal" );
+    ok( size > 0, "no journal\n" );
+    fd = open( prefix_file( "system.reg.journal" ), O_WRONLY | O_APPEND );
+    ok( write( fd, partial, sizeof(partial) - 1 ) == sizeof(partial) - 1, "write failed\n" );
+    close( fd );
+
+    hkey = start_server() ? create_key( TEST_KEY ) : 0;
+    check_value( hkey, "a", 1 );
+    check_value( hkey, "c", 3 );
+    status = get_value( hkey, "d", &value );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "incomplete save applied, status %#x\n", status );
+    status = get_value( hkey, "e", &value );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "unflushed change applied, status %#x\n", status );
+    ok( file_size( "system.reg.journal" ) == size, "incomplete save not truncated, size %ld, expected %ld\n",
+        (long)file_size( "system.reg.journal" ), (long)size );
+}
+
+/* replace a value in the text file without changing its size or its mtime seconds */
+static void edit_branch_file( const char *old, const char *new )
+{
+    struct timespec times[2];
+    struct stat st;
+    char buffer[65536], *p;
+    ssize_t size;
+    int fd;
+
+    fd = open( prefix_file( "system.reg" ), O_RDWR );
+    fstat( fd, &st );
+    size = read( fd, buffer, sizeof(buffer) - 1 );
+    buffer[max( size, 0 )] = 0;
+    p = strstr( buffer, old );
+    ok( p != NULL, "%s not found in system.reg\n", old );
+    if (p) pwrite( fd, new, strlen( new ), p - buffer );
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    times[0] = st.st_atim;
+    times[1] = st.st_mtim;
+#else
+    times[0].tv_sec = st.st_atime;
+    times[1].tv_sec = st.st_mtime;
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+#endif
+    times[1].tv_nsec = (times[1].tv_nsec + 1) % 1000000000;
+    futimens( fd, times );
+    close( fd );
+}
+
+static void test_snapshot_invalidation(void)
+{
+    obj_handle_t hkey;
+
+    /* compact everything into the text file, with a snapshot made from it */
+    stop_server( SIGTERM );
+    ok( !file_exists( "system.reg.journal" ), "journal not compacted\n" );
+    ok( file_exists( "system.reg.bin" ), "no snapshot\n" );
+
+    /* only the nanoseconds of the mtime tell that the file has been edited */
+    edit_branch_file( "\"a\"=dword:00000001", "\"a\"=dword:00000009" );
+
+    hkey = start_server() ? create_key( TEST_KEY ) : 0;
+    check_value( hkey, "a", 9 );
+    check_value( hkey, "c", 3 );
+}
+
+static void measure( unsigned int count )
+{
+    unsigned long long snapshot_us, text_us, journal_us, save_us;
+    obj_handle_t hkey, subkey;
+    char name[sizeof(TEST_KEY) + 16];
+    unsigned int i;
+
+    hkey = create_key( TEST_KEY );
+    for (i = 0; i < count; i++)
+    {
+        snprintf( name, sizeof(name), "%s\\%u", TEST_KEY, i );
+        subkey = create_key( name );
+        set_value( subkey, "x", i );
+        set_value( subkey, "y", i );
+    }
+    flush_key( hkey );
+
+    journal_us = monotonic_us();
+    for (i = 0; i < 100; i++)
+    {
+        set_value( hkey, "a", i );
+        flush_key( hkey );
+    }
+    journal_us = (monotonic_us() - journal_us) / 100;
+
+    /* a full save of the branch, like without the journal */
+    save_us = stop_server( SIGTERM );
+
+    snapshot_us = start_server();
+    check_value( create_key( TEST_KEY ), "a", 99 );
+    stop_server( SIGKILL );
+
+    unlink( prefix_file( "system.reg.bin" ));
+    text_us = start_server();
+    check_value( create_key( TEST_KEY ), "a", 99 );
+
+    printf( "%u keys, system.reg %ld bytes\n", count, (long)file_size( "system.reg" ));
+    printf( "flush with one changed key: %llu us with the journal\n", journal_us );
+    printf( "full save and exit: %llu us\n", save_us );
+    printf( "startup: %llu us from the snapshot, %llu us from the text file\n", snapshot_us, text_us );
+}
+
+static int remove_file( const char *path, const struct stat *st, int flag, struct FTW *ftw )
+{
+    return remove( path );
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned int count = argc > 2 ? atoi( argv[2] ) : 10000;
+
+    if (argc < 2)
+    {
+        fprintf( stderr, "usage: %s wineserver [keys]\n", argv[0] );
+        return 1;
+    }
+    server_path = argv[1];
+    if (!mkdtemp( prefix )) fatal_error( "mkdtemp: %s\n", strerror( errno ));
+    setenv( "WINEPREFIX", prefix, 1 );
+    setenv( "WINEREGJOURNAL", "1", 1 );
+
+    test_journal_replay();
+    test_crash_recovery();
+    test_snapshot_invalidation();
+    measure( count );
+    stop_server( SIGKILL );
+
+    nftw( prefix, remove_file, 16, FTW_DEPTH | FTW_PHYS );
+    printf( "registry_test: %d tests executed, %d failures\n", successes + failures, failures );
+    return failures != 0;
+}
@@ -47,6 +47,12 @@
 #ifdef __APPLE__
 # include <mach/mach_time.h>
 #endif
+#ifdef __linux__
+# include <sys/eventfd.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -128,6 +134,18 @@ int config_dir_fd = -1;    /* file descriptor for the config dir */
 static struct master_socket *master_socket;  /* the master socket object */
 static struct timeout_user *master_timeout;
 
+/* per-process shared memory request slots, see init_request_shm */
+struct request_shm
+{
+    struct fd            *fd;        /* eventfd rung by the client when queuing requests */
+    request_shm_header_t *header;    /* shared memory mapping */
+    mem_size_t            size;      /* size of the mapping */
+    int                   unix_fd;   /* file descriptor of the mapping */
+    struct thread        *slots[REQUEST_SHM_MAX_SLOTS]; /* owners of the slots */
+};
+
+static int request_shm_enabled;
+
 /* complain about a protocol error and terminate the client connection */
 void fatal_protocol_error( struct thread *thread, const char *err, ... )
 {
@@ -251,6 +269,28 @@ static void send_reply( union generic_reply *reply )
 {
     int ret;
 
+#ifdef __linux__
+    if (current->reply_slot)
+    {
+        request_shm_slot_t *slot = current->reply_slot;
+
+        if (current->reply_size > sizeof(slot->data))
+        {
+            fatal_protocol_error( current, "reply too large for slot (%u)\n", current->reply_size );
+            return;
+        }
+        memcpy( (void *)&slot->reply, reply, sizeof(*reply) );
+        if (current->reply_size) memcpy( (void *)slot->data, current->reply_data, current->reply_size );
+        free( current->reply_data );
+        current->reply_data = NULL;
+        /* pairs with the client storing client_waiting before loading the state */
+        __atomic_store_n( &slot->state, REQUEST_SHM_REPLY, __ATOMIC_SEQ_CST );
+        if (__atomic_load_n( &slot->client_waiting, __ATOMIC_SEQ_CST ))
+            syscall( __NR_futex, &slot->state, FUTEX_WAKE, 1, NULL, 0, 0 );
+        return;
+    }
+#endif
+
     if (!current->reply_size)
     {
         if ((ret = write( get_unix_fd( current->reply_fd ),
@@ -373,6 +413,219 @@ error:
         fatal_protocol_error( thread, "read: %s\n", strerror( errno ));
 }
 
+#ifdef __linux__
+
+static void request_shm_poll_event( struct fd *fd, int event );
+
+static const struct fd_ops request_shm_fd_ops =
+{
+    NULL,                          /* get_poll_events */
+    request_shm_poll_event,        /* poll_event */
+    NULL,                          /* flush */
+    NULL,                          /* get_fd_type */
+    NULL,                          /* ioctl */
+    NULL,                          /* queue_async */
+    NULL                           /* reselect_async */
+};
+
+static inline request_shm_slot_t *get_request_shm_slot( struct request_shm *shm, unsigned int index )
+{
+    return (request_shm_slot_t *)((char *)shm->header + REQUEST_SHM_HEADER_SIZE + index * REQUEST_SHM_SLOT_SIZE);
+}
+
+/* handle a request queued in a shared memory slot */
+static void handle_request_shm_slot( struct request_shm *shm, unsigned int index )
+{
+    request_shm_slot_t *slot = get_request_shm_slot( shm, index );
+    struct thread *thread = shm->slots[index];
+
+    if (!thread || thread->state == TERMINATED) return;
+    if (__atomic_load_n( &slot->state, __ATOMIC_ACQUIRE ) != REQUEST_SHM_REQUEST) return;
+    if (thread->req_toread || thread->reply_towrite)
+    {
+        fatal_protocol_error( thread, "shared memory request while a pipe request is pending\n" );
+        return;
+    }
+
+    memcpy( &thread->req, (void *)&slot->request, sizeof(thread->req) );
+    if (thread->req.request_header.request_size)
+    {
+        fatal_protocol_error( thread, "shared memory request %d with data\n", thread->req.request_header.req );
+        return;
+    }
+
+    grab_object( thread );
+    thread->reply_slot = slot;
+    call_req_handler( thread );
+    thread->reply_slot = NULL;
+    release_object( thread );
+}
+
+/* the doorbell has been rung, handle the requests queued so far in one batch; the pending
+ * count is cleared before the ready bits are read, so a request queued after that rings the
+ * doorbell again and is handled by the next poll event, without starving the other fds */
+static void request_shm_poll_event( struct fd *fd, int event )
+{
+    struct process *process = (struct process *)get_fd_user( fd );
+    struct request_shm *shm = process->request_shm;
+    unsigned int i, bits;
+    uint64_t count;
+
+    if (event & (POLLERR | POLLHUP))
+    {
+        set_fd_events( fd, -1 );
+        return;
+    }
+    if (read( get_unix_fd( fd ), &count, sizeof(count) ) == -1 && errno != EAGAIN) return;
+
+    grab_object( process );
+    if (__atomic_exchange_n( &shm->header->pending, 0, __ATOMIC_SEQ_CST ))
+    {
+        for (i = 0; i < ARRAY_SIZE(shm->header->ready) && process->request_shm == shm; i++)
+        {
+            bits = __atomic_exchange_n( &shm->header->ready[i], 0, __ATOMIC_SEQ_CST );
+            while (bits && process->request_shm == shm)
+            {
+                unsigned int bit = __builtin_ctz( bits );
+                bits &= bits - 1;
+                handle_request_shm_slot( shm, i * 32 + bit );
+            }
+        }
+    }
+    release_object( process );
+}
+
+/* create the shared memory request mapping of a process */
+static struct request_shm *create_request_shm( struct process *process )
+{
+    struct request_shm *shm;
+    void *ptr;
+    int efd;
+
+    if (!(shm = mem_alloc( sizeof(*shm) ))) return NULL;
+    memset( shm, 0, sizeof(*shm) );
+    shm->size = REQUEST_SHM_HEADER_SIZE + REQUEST_SHM_MAX_SLOTS * REQUEST_SHM_SLOT_SIZE;
+    if ((shm->unix_fd = create_shared_memory( shm->size, &ptr )) == -1)
+    {
+        free( shm );
+        return NULL;
+    }
+    shm->header = ptr;
+
+    if ((efd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC )) == -1 ||
+        !(shm->fd = create_anonymous_fd( &request_shm_fd_ops, efd, &process->obj, 0 )))
+    {
+        if (efd == -1) file_set_error();
+        munmap( ptr, shm->size );
+        close( shm->unix_fd );
+        free( shm );
+        return NULL;
+    }
+    set_fd_events( shm->fd, POLLIN );
+    return shm;
+}
+
+/* release the shared memory request slot of a thread */
+void free_request_shm_slot( struct thread *thread )
+{
+    struct request_shm *shm = thread->process->request_shm;
+
+    if (thread->request_shm_slot == -1) return;
+    if (shm) shm->slots[thread->request_shm_slot] = NULL;
+    thread->request_shm_slot = -1;
+}
+
+/* release the shared memory request mapping of a process */
+void free_process_request_shm( struct process *process )
+{
+    struct request_shm *shm = process->request_shm;
+
+    if (!shm) return;
+    process->request_shm = NULL;
+    release_object( shm->fd );
+    munmap( (void *)shm->header, shm->size );
+    close( shm->unix_fd );
+    free( shm );
+}
+
+/* requests can be passed through shared memory slots instead of the request pipe if
+ * WINESHMREQUESTS is set; the clients ring an eventfd only when the server isn't already
+ * busy with queued requests, and wait for the reply on a futex */
+void init_request_shm(void)
+{
+    const char *env = getenv( "WINESHMREQUESTS" );
+
+    request_shm_enabled = env && atoi( env );
+}
+
+#else  /* __linux__ */
+
+void free_request_shm_slot( struct thread *thread )
+{
+}
+
+void free_process_request_shm( struct process *process )
+{
+}
+
+void init_request_shm(void)
+{
+}
+
+#endif  /* __linux__ */
+
+/* allocate a shared memory request slot for the current thread */
+DECL_HANDLER(init_request_shm)
+{
+#ifdef __linux__
+    struct process *process = current->process;
+    request_shm_slot_t *slot;
+    unsigned int i;
+
+    if (!request_shm_enabled)
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+    if (!process->request_shm)
+    {
+        if (req->mapped)
+        {
+            set_error( STATUS_INVALID_PARAMETER );
+            return;
+        }
+        if (!(process->request_shm = create_request_shm( process ))) return;
+    }
+
+    if (current->request_shm_slot == -1)
+    {
+        for (i = 0; i < REQUEST_SHM_MAX_SLOTS; i++) if (!process->request_shm->slots[i]) break;
+        if (i == REQUEST_SHM_MAX_SLOTS)
+        {
+            set_error( STATUS_INSUFFICIENT_RESOURCES );
+            return;
+        }
+        process->request_shm->slots[i] = current;
+        current->request_shm_slot = i;
+    }
+
+    slot = get_request_shm_slot( process->request_shm, current->request_shm_slot );
+    slot->index = current->request_shm_slot;
+    slot->client_waiting = 0;
+    slot->state = REQUEST_SHM_IDLE;
+
+    if (!req->mapped)
+    {
+        send_client_fd( process, process->request_shm->unix_fd, 0 );
+        send_client_fd( process, get_unix_fd( process->request_shm->fd ), 0 );
+    }
+    reply->slot = current->request_shm_slot;
+    reply->size = process->request_shm->size;
+#else
+    set_error( STATUS_NOT_SUPPORTED );
+#endif
+}
+
 /* receive a file descriptor on the process socket */
 int receive_fd( struct process *process )
 {
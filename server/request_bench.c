@@ -0,0 +1,221 @@
+/*
+ * Server request latency benchmark
+ *
+ * Copyright 2024 Onni Kukkonen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Connects to the wineserver of the current prefix as a bare client, without ntdll, and
+ * times small requests through the request pipe and through the shared memory slots.
+ * The server has to be started beforehand, with WINESHMREQUESTS=1 for the slots to be
+ * available:
+ *
+ *   make server/request_bench
+ *   WINESHMREQUESTS=1 wineserver -p && server/request_bench [clients] [requests]
+ *
+ * Each client is a separate process, so that the server sees concurrent requests.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __linux__
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "client.h"
+
+#ifdef __linux__
+
+static request_shm_header_t *request_shm;
+static request_shm_slot_t *request_slot;
+static int request_shm_doorbell = -1;
+
+/* same as server_call_shm in ntdll */
+static unsigned int server_call_shm( union generic_request *req, union generic_reply *reply,
+                                     void *reply_data )
+{
+    request_shm_slot_t *slot = request_slot;
+    unsigned long long ring = 1;
+    unsigned int i;
+
+    memcpy( (void *)&slot->request, req, sizeof(*req) );
+    __atomic_store_n( &slot->state, REQUEST_SHM_REQUEST, __ATOMIC_SEQ_CST );
+    __atomic_fetch_or( &request_shm->ready[slot->index / 32], 1u << (slot->index % 32), __ATOMIC_SEQ_CST );
+    if (!__atomic_fetch_add( &request_shm->pending, 1, __ATOMIC_SEQ_CST ))
+        write( request_shm_doorbell, &ring, sizeof(ring) );
+
+    for (i = 0; i < 200; i++)
+    {
+        if (__atomic_load_n( &slot->state, __ATOMIC_ACQUIRE ) == REQUEST_SHM_REPLY) goto done;
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    __atomic_store_n( &slot->client_waiting, 1, __ATOMIC_SEQ_CST );
+    while (__atomic_load_n( &slot->state, __ATOMIC_SEQ_CST ) == REQUEST_SHM_REQUEST)
+        syscall( __NR_futex, &slot->state, FUTEX_WAIT, REQUEST_SHM_REQUEST, NULL, 0, 0 );
+    __atomic_store_n( &slot->client_waiting, 0, __ATOMIC_SEQ_CST );
+
+done:
+    memcpy( reply, (void *)&slot->reply, sizeof(*reply) );
+    if (reply->reply_header.reply_size) memcpy( reply_data, (void *)slot->data, reply->reply_header.reply_size );
+    slot->state = REQUEST_SHM_IDLE;
+    return reply->reply_header.error;
+}
+
+static int init_client_shm(void)
+{
+    union generic_request req;
+    union generic_reply reply;
+    obj_handle_t handle;
+    void *ptr;
+    int fd;
+
+    init_request( &req, REQ_init_request_shm, 0 );
+    if (server_call( &req, &reply, NULL, 0, NULL )) return 0;
+
+    fd = receive_fd( &handle );
+    request_shm_doorbell = receive_fd( &handle );
+    if (fd == -1 || request_shm_doorbell == -1) fatal_error( "missing shared memory fds\n" );
+    ptr = mmap( NULL, reply.init_request_shm_reply.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if (ptr == MAP_FAILED) fatal_error( "mmap: %s\n", strerror( errno ));
+    close( fd );
+
+    request_shm = ptr;
+    request_slot = (request_shm_slot_t *)((char *)ptr + REQUEST_SHM_HEADER_SIZE +
+                                          reply.init_request_shm_reply.slot * REQUEST_SHM_SLOT_SIZE);
+    return 1;
+}
+
+static unsigned long long monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* get_thread_times on the current thread, like NtQueryInformationThread( ThreadTimes ) */
+static void run_requests( unsigned int count, int use_shm )
+{
+    union generic_request req;
+    union generic_reply reply;
+    unsigned int i, status;
+    char data[1];
+
+    for (i = 0; i < count; i++)
+    {
+        init_request( &req, REQ_get_thread_times, 0 );
+        req.get_thread_times_request.handle = ~(obj_handle_t)1;  /* GetCurrentThread() */
+        if (use_shm) status = server_call_shm( &req, &reply, data );
+        else status = server_call( &req, &reply, NULL, 0, data );
+        if (status) fatal_error( "get_thread_times failed %#x\n", status );
+    }
+}
+
+/* run the requests from concurrent client processes, returns the time per request */
+static unsigned long long run_clients( unsigned int clients, unsigned int count, int use_shm )
+{
+    unsigned long long start, end;
+    int ready[2], go[2], status;
+    unsigned int i;
+    char c = 0;
+
+    if (pipe( ready ) == -1 || pipe( go ) == -1) fatal_error( "pipe: %s\n", strerror( errno ));
+
+    for (i = 0; i < clients; i++)
+    {
+        switch (fork())
+        {
+        case -1:
+            fatal_error( "fork: %s\n", strerror( errno ));
+        case 0:
+            close( ready[0] );
+            close( go[1] );
+            if (!connect_client()) fatal_error( "cannot connect to the server, start it first\n" );
+            if (use_shm && !init_client_shm())
+                fatal_error( "the server doesn't support shared memory requests, set WINESHMREQUESTS=1\n" );
+            run_requests( 100, use_shm );  /* warm up */
+            write( ready[1], &c, 1 );
+            read( go[0], &c, 1 );
+            run_requests( count, use_shm );
+            _exit( 0 );
+        }
+    }
+    close( ready[1] );
+    close( go[0] );
+
+    for (i = 0; i < clients; i++)
+        if (read( ready[0], &c, 1 ) != 1) fatal_error( "a client failed to start\n" );
+    start = monotonic_ns();
+    for (i = 0; i < clients; i++) write( go[1], &c, 1 );
+    for (i = 0; i < clients; i++)
+    {
+        if (wait( &status ) == -1 || !WIFEXITED( status ) || WEXITSTATUS( status ))
+            fatal_error( "a client failed\n" );
+    }
+    end = monotonic_ns();
+
+    close( ready[0] );
+    close( go[1] );
+    return (end - start) / ((unsigned long long)clients * count);
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned int max_clients = argc > 1 ? atoi( argv[1] ) : 4;
+    unsigned int count = argc > 2 ? atoi( argv[2] ) : 100000;
+    unsigned int clients;
+
+    if (!max_clients || !count)
+    {
+        fprintf( stderr, "usage: %s [clients] [requests]\n", argv[0] );
+        return 1;
+    }
+
+    printf( "clients     pipe ns/req     shm ns/req\n" );
+    for (clients = 1; clients <= max_clients; clients *= 2)
+    {
+        unsigned long long pipe_ns = run_clients( clients, count, 0 );
+        unsigned long long shm_ns = run_clients( clients, count, 1 );
+        printf( "%7u %15llu %14llu\n", clients, pipe_ns, shm_ns );
+    }
+    return 0;
+}
+
+#else  /* __linux__ */
+
+int main( int argc, char *argv[] )
+{
+    fprintf( stderr, "request_bench: shared memory requests are only supported on Linux\n" );
+    return 1;
+}
+
+#endif  /* __linux__ */
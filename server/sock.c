@@ -256,9 +256,13 @@ struct sock
     icmp_fixup_data[MAX_ICMP_HISTORY_LENGTH]; /* Sent ICMP packets history used to fixup reply id. */
     struct bound_addr  *bound_addr[2]; /* Links to the entries in bound addresses tree. */
     unsigned int        icmp_fixup_data_len;  /* Sent ICMP packets history length. */
+    sock_shm_t         *shm;         /* state shared with the clients, if any */
+    process_id_t        shm_owner;   /* process allowed to bypass the server */
+    unsigned int        shm_granted; /* SOCK_SHM_* flags granted since the last event select */
     unsigned int        rd_shutdown : 1; /* is the read end shut down? */
     unsigned int        wr_shutdown : 1; /* is the write end shut down? */
     unsigned int        wr_shutdown_pending : 1; /* is a write shutdown pending? */
+    unsigned int        shm_shared : 1; /* is the socket used by more than one process? */
     unsigned int        hangup : 1;  /* has the read end received a hangup? */
     unsigned int        aborted : 1; /* did we get a POLLERR or irregular POLLHUP? */
     unsigned int        nonblocking : 1; /* is the socket nonblocking? */
@@ -752,6 +756,101 @@ void sock_init(void)
     }
 }
 
+/*
+ * When WINEFASTSOCK is set in the server environment, each socket that a client asks for
+ * gets an entry in a mapping shared with all the clients. Its flags tell them when a
+ * send or a receive may be attempted directly on the unix socket, without a server
+ * round trip: that is when no async is queued, no event or message is selected, and
+ * nothing else needs the server to see the I/O. Only immediately successful calls are
+ * completed that way, everything else still goes through the recv_socket and
+ * send_socket requests.
+ *
+ * A direct call must not overtake an async queued after the client checked the flags.
+ * The client orders the check and its own recv_socket and send_socket requests with a
+ * lock, which only works within a process, so the flags are only ever granted to the
+ * first process using the socket.
+ */
+
+#define SOCK_SHM_MAX_OBJECTS 0x10000
+
+static sock_shm_t *sock_shm_objects;     /* sockets shared memory, NULL if disabled */
+static unsigned int sock_shm_used;       /* number of entries used so far */
+static unsigned int *sock_shm_free;      /* ring of freed entries, oldest first */
+static unsigned int sock_shm_free_head, sock_shm_free_count;
+
+/* create the shared mapping, if direct socket I/O is enabled */
+void init_sock_shm( struct object *root )
+{
+    static const WCHAR sock_shmW[] = {'_','_','w','i','n','e','_','s','o','c','k','_','s','h','m'};
+    static const struct unicode_str sock_shm_str = {sock_shmW, sizeof(sock_shmW)};
+    const char *env = getenv( "WINEFASTSOCK" );
+
+    if (!env || !atoi( env )) return;
+    if (!(sock_shm_free = mem_alloc( SOCK_SHM_MAX_OBJECTS * sizeof(*sock_shm_free) ))) return;
+    if (!(sock_shm_objects = create_fast_sync_mapping( root, &sock_shm_str,
+                                                       SOCK_SHM_MAX_OBJECTS * sizeof(*sock_shm_objects) )))
+    {
+        fprintf( stderr, "wineserver: failed to create the socket mapping, disabling direct socket I/O\n" );
+        free( sock_shm_free );
+        sock_shm_free = NULL;
+    }
+}
+
+static sock_shm_t *alloc_sock_shm(void)
+{
+    sock_shm_t *shm;
+
+    if (!sock_shm_objects) return NULL;
+
+    /* reuse the oldest freed entry, stale client caches are less likely to still refer to it */
+    if (sock_shm_free_count)
+    {
+        shm = sock_shm_objects + sock_shm_free[sock_shm_free_head];
+        sock_shm_free_head = (sock_shm_free_head + 1) % SOCK_SHM_MAX_OBJECTS;
+        sock_shm_free_count--;
+    }
+    else if (sock_shm_used < SOCK_SHM_MAX_OBJECTS) shm = sock_shm_objects + sock_shm_used++;
+    else return NULL;
+
+    __atomic_store_n( &shm->flags, 0, __ATOMIC_SEQ_CST );
+    return shm;
+}
+
+static void free_sock_shm( sock_shm_t *shm )
+{
+    __atomic_store_n( &shm->flags, 0, __ATOMIC_SEQ_CST );
+    sock_shm_free[(sock_shm_free_head + sock_shm_free_count) % SOCK_SHM_MAX_OBJECTS] = shm - sock_shm_objects;
+    sock_shm_free_count++;
+}
+
+/* tell the clients whether they may send or receive without going through the server */
+static void sock_update_shm( struct sock *sock )
+{
+    unsigned int flags = 0;
+
+    if (!sock->shm) return;
+
+    if (!sock->mask && !sock->shm_shared && sock->proto != WS_IPPROTO_ICMP &&
+        (sock->state == SOCK_CONNECTED || sock->state == SOCK_CONNECTIONLESS))
+    {
+        if (!async_queued( &sock->read_q ) && !sock->rd_shutdown && !sock->reset && !sock->accept_recv_req)
+            flags |= SOCK_SHM_FAST_RECV;
+        if (!async_queued( &sock->write_q ) && !sock->wr_shutdown && !sock->wr_shutdown_pending &&
+            (sock->type != WS_SOCK_DGRAM || sock->bound))
+            flags |= SOCK_SHM_FAST_SEND;
+    }
+    __atomic_store_n( &sock->shm->flags, flags, __ATOMIC_SEQ_CST );
+    sock->shm_granted |= flags;
+}
+
+/* stop granting direct I/O once another process uses the socket */
+static void sock_check_shm_owner( struct sock *sock )
+{
+    if (!sock->shm || sock->shm_shared || sock->shm_owner == current->process->id) return;
+    sock->shm_shared = 1;
+    sock_update_shm( sock );
+}
+
 static void sock_reselect( struct sock *sock )
 {
     int ev = sock_get_poll_events( sock->fd );
@@ -760,6 +859,7 @@ static void sock_reselect( struct sock *sock )
         fprintf(stderr,"sock_reselect(%p): new mask %x\n", sock, ev);
 
     set_fd_events( sock->fd, ev );
+    sock_update_shm( sock );
 }
 
 static unsigned int afd_poll_flag_to_win32( unsigned int flags )
@@ -1709,6 +1809,7 @@ static void sock_destroy( struct object *obj )
     free_async_queue( &sock->poll_q );
     if (sock->event) release_object( sock->event );
     if (sock->fd) release_object( sock->fd );
+    if (sock->shm) free_sock_shm( sock->shm );
 }
 
 static struct sock *create_socket(void)
@@ -1753,6 +1854,10 @@ static struct sock *create_socket(void)
     sock->rcvtimeo = 0;
     sock->sndtimeo = 0;
     sock->icmp_fixup_data_len = 0;
+    sock->shm = NULL;
+    sock->shm_owner = 0;
+    sock->shm_granted = 0;
+    sock->shm_shared = 0;
     sock->bound_addr[0] = sock->bound_addr[1] = NULL;
     init_async_queue( &sock->read_q );
     init_async_queue( &sock->write_q );
@@ -2876,6 +2981,19 @@ static void sock_ioctl( struct fd *fd, ioctl_code_t code, struct async *async )
             return;
         }
 
+        /* sends and receives may have bypassed the server, without resetting these events */
+        if (sock->shm_granted & SOCK_SHM_FAST_RECV)
+        {
+            sock->pending_events &= ~AFD_POLL_READ;
+            sock->reported_events &= ~AFD_POLL_READ;
+        }
+        if (sock->shm_granted & SOCK_SHM_FAST_SEND)
+        {
+            sock->pending_events &= ~AFD_POLL_WRITE;
+            sock->reported_events &= ~AFD_POLL_WRITE;
+        }
+        sock->shm_granted = 0;
+
         if (sock->event) release_object( sock->event );
         sock->event = event;
         sock->mask = mask;
@@ -3860,6 +3978,7 @@ DECL_HANDLER(recv_socket)
 
     if (!sock) return;
     fd = sock->fd;
+    sock_check_shm_owner( sock );
 
     if (!req->force_async && !sock->nonblocking && is_fd_overlapped( fd ))
         timeout = (timeout_t)sock->rcvtimeo * -10000;
@@ -3948,6 +4067,7 @@ DECL_HANDLER(send_socket)
 
     if (!sock) return;
     fd = sock->fd;
+    sock_check_shm_owner( sock );
 
     if (sock->type == WS_SOCK_DGRAM && !sock->bound)
     {
@@ -4041,6 +4161,25 @@ DECL_HANDLER(send_socket)
     release_object( sock );
 }
 
+DECL_HANDLER(get_socket_shm)
+{
+    struct sock *sock = (struct sock *)get_handle_obj( current->process, req->handle, 0, &sock_ops );
+
+    if (!sock) return;
+
+    if (!sock->shm && sock->fd && (sock->shm = alloc_sock_shm()))
+        sock->shm_owner = current->process->id;
+    if (sock->shm)
+    {
+        sock_check_shm_owner( sock );
+        sock_update_shm( sock );
+        reply->index = sock->shm - sock_shm_objects;
+    }
+    else set_error( STATUS_NOT_IMPLEMENTED );
+
+    release_object( sock );
+}
+
 DECL_HANDLER(socket_get_events)
 {
     struct sock *sock = (struct sock *)get_handle_obj( current->process, req->handle, 0, &sock_ops );
@@ -61,6 +61,7 @@ struct thread_wait
     int                     count;      /* count of objects */
     int                     flags;
     int                     abandoned;
+    int                     lost;       /* an object has been acquired by a client before the wait */
     enum select_op          select;
     client_ptr_t            key;        /* wait key for keyed events */
     client_ptr_t            cookie;     /* magic cookie to return to client */
@@ -237,6 +238,8 @@ static inline void init_thread_structure( struct thread *thread )
     thread->request_fd      = NULL;
     thread->reply_fd        = NULL;
     thread->wait_fd         = NULL;
+    thread->request_shm_slot = -1;
+    thread->reply_slot      = NULL;
     thread->state           = RUNNING;
     thread->exit_code       = 0;
     thread->priority        = 0;
@@ -416,6 +419,7 @@ static void cleanup_thread( struct thread *thread )
     if (thread->request_fd) release_object( thread->request_fd );
     if (thread->reply_fd) release_object( thread->reply_fd );
     if (thread->wait_fd) release_object( thread->wait_fd );
+    free_request_shm_slot( thread );
     cleanup_clipboard_thread(thread);
     destroy_thread_windows( thread );
     free_msg_queue( thread );
@@ -734,12 +738,55 @@ void make_wait_abandoned( struct wait_queue_entry *entry )
     entry->wait->abandoned = 1;
 }
 
+void make_wait_lost( struct wait_queue_entry *entry )
+{
+    /* entries without a thread wait belong to wait completion packets */
+    if (!entry->wait) make_wait_completion_packet_lost( entry );
+    else entry->wait->lost = 1;
+}
+
 void set_wait_status( struct wait_queue_entry *entry, int status )
 {
     entry->wait->status = status;
 }
 
-/* finish waiting */
+/* tell the objects that the wait is satisfied, returns 0 if a fast sync object
+ * has been acquired by a client in the meantime and the wait must be checked again */
+static int satisfy_wait( struct thread_wait *wait, unsigned int status )
+{
+    struct wait_queue_entry *entry;
+    fast_sync_shm_t *shm;
+    int i, j;
+
+    wait->status = status;
+    wait->lost = 0;
+
+    if (wait->select != SELECT_WAIT_ALL)
+    {
+        entry = wait->queues + status;
+        entry->obj->ops->satisfied( entry->obj, entry );
+        return !wait->lost;
+    }
+
+    /* acquire the fast sync objects first, so that they can be given back
+     * without having modified the other objects state */
+    for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+    {
+        if (!get_obj_fast_sync( entry->obj )) continue;
+        entry->obj->ops->satisfied( entry->obj, entry );
+        if (!wait->lost) continue;
+
+        for (j = 0; j < i; j++)
+            if ((shm = get_obj_fast_sync( wait->queues[j].obj ))) fast_sync_unsatisfied( shm );
+        wait->abandoned = 0;
+        return 0;
+    }
+    for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+        if (!get_obj_fast_sync( entry->obj )) entry->obj->ops->satisfied( entry->obj, entry );
+    return 1;
+}
+
+/* finish waiting, satisfy_wait must have been called first if the wait is satisfied */
 static unsigned int end_wait( struct thread *thread, unsigned int status )
 {
     struct thread_wait *wait = thread->wait;
@@ -749,19 +796,8 @@ static unsigned int end_wait( struct thread *thread, unsigned int status )
     assert( wait );
     thread->wait = wait->next;
 
-    if (status < wait->count)  /* wait satisfied, tell it to the objects */
+    if (status < wait->count)
     {
-        wait->status = status;
-        if (wait->select == SELECT_WAIT_ALL)
-        {
-            for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
-                entry->obj->ops->satisfied( entry->obj, entry );
-        }
-        else
-        {
-            entry = wait->queues + status;
-            entry->obj->ops->satisfied( entry->obj, entry );
-        }
         status = wait->status;
         if (wait->abandoned) status += STATUS_ABANDONED_WAIT_0;
     }
@@ -790,6 +826,7 @@ static int wait_on( const select_op_t *select_op, unsigned int count, struct obj
     wait->user    = NULL;
     wait->when = when;
     wait->abandoned = 0;
+    wait->lost    = 0;
     current->wait = wait;
 
     for (i = 0, entry = wait->queues; i < count; i++, entry++)
@@ -907,6 +944,11 @@ int wake_thread( struct thread *thread )
     for (count = 0; thread->wait; count++)
     {
         if ((signaled = check_wait( thread )) == -1) break;
+        if (signaled < thread->wait->count && !satisfy_wait( thread->wait, signaled ))
+        {
+            count--;  /* a client acquired the object first, check again */
+            continue;
+        }
 
         cookie = thread->wait->cookie;
         signaled = end_wait( thread, signaled );
@@ -933,6 +975,12 @@ int wake_thread_queue_entry( struct wait_queue_entry *entry )
 
     assert( wait->select != SELECT_WAIT_ALL );
 
+    if (!satisfy_wait( wait, entry - wait->queues ))
+    {
+        wake_thread( thread );  /* a client acquired the object first, check the others */
+        return 0;
+    }
+
     cookie = wait->cookie;
     signaled = end_wait( thread, entry - wait->queues );
     if (debug_level) fprintf( stderr, "%04x: *wakeup* signaled=%d\n", thread->id, signaled );
@@ -1035,8 +1083,9 @@ static int select_on( const select_op_t *select_op, data_size_t op_size, client_
         return 1;
     }
 
-    if ((ret = check_wait( current )) != -1)
+    while ((ret = check_wait( current )) != -1)
     {
+        if (ret < current->wait->count && !satisfy_wait( current->wait, ret )) continue;
         /* condition is already satisfied */
         set_error( end_wait( current, ret ));
         return 1;
@@ -1066,7 +1115,10 @@ void wake_up( struct object *obj, int max )
     LIST_FOR_EACH( ptr, &obj->wait_queue )
     {
         struct wait_queue_entry *entry = LIST_ENTRY( ptr, struct wait_queue_entry, entry );
-        if (!(ret = wake_thread( get_wait_queue_thread( entry )))) continue;
+        /* entries without a thread wait belong to wait completion packets */
+        if (!entry->wait) ret = wake_wait_completion_packet( entry );
+        else ret = wake_thread( get_wait_queue_thread( entry ));
+        if (!ret) continue;
         if (ret > 0 && max && !--max) break;
         /* restart at the head of the list since a wake up can change the object wait queue */
         ptr = &obj->wait_queue;
@@ -186,6 +186,7 @@ struct makefile
     struct strarray define_args;
     struct strarray unix_cflags;
     struct strarray programs;
+    struct strarray extra_programs;
     struct strarray scripts;
     struct strarray imports;
     struct strarray delayimports;
@@ -3689,15 +3690,19 @@ static void output_programs( struct makefile *make )
 {
     unsigned int i, j;
     unsigned int arch = 0;  /* programs are always native */
+    struct strarray programs = empty_strarray;
 
-    for (i = 0; i < make->programs.count; i++)
+    strarray_addall( &programs, make->programs );
+    strarray_addall( &programs, make->extra_programs );
+
+    for (i = 0; i < programs.count; i++)
     {
         char *program_installed = NULL;
-        char *program = strmake( "%s%s", make->programs.str[i], exe_ext );
-        struct strarray deps = get_local_dependencies( make, make->programs.str[i], make->in_files );
-        struct strarray all_libs = get_expanded_file_local_var( make, make->programs.str[i], "LDFLAGS" );
-        struct strarray objs     = get_expanded_file_local_var( make, make->programs.str[i], "OBJS" );
-        struct strarray symlinks = get_expanded_file_local_var( make, make->programs.str[i], "SYMLINKS" );
+        char *program = strmake( "%s%s", programs.str[i], exe_ext );
+        struct strarray deps = get_local_dependencies( make, programs.str[i], make->in_files );
+        struct strarray all_libs = get_expanded_file_local_var( make, programs.str[i], "LDFLAGS" );
+        struct strarray objs     = get_expanded_file_local_var( make, programs.str[i], "OBJS" );
+        struct strarray symlinks = get_expanded_file_local_var( make, programs.str[i], "SYMLINKS" );
 
         if (!objs.count) objs = make->object_files[arch];
         if (!strarray_exists( &all_libs, "-nodefaultlibs" ))
@@ -3715,6 +3720,13 @@ static void output_programs( struct makefile *make )
         output_filenames( all_libs );
         output_filename( "$(LDFLAGS)" );
         output( "\n" );
+
+        /* extra programs are only built on demand, and never installed */
+        if (i >= make->programs.count)
+        {
+            strarray_add( &make->clean_files, program );
+            continue;
+        }
         strarray_add( &make->all_targets[arch], program );
 
         for (j = 0; j < symlinks.count; j++)
@@ -3932,7 +3944,7 @@ static void output_sources( struct makefile *make )
         for (arch = 0; arch < archs.count; arch++)
             if (is_multiarch( arch )) output_test_module( make, arch );
     }
-    else if (make->programs.count) output_programs( make );
+    else if (make->programs.count || make->extra_programs.count) output_programs( make );
 
     for (i = 0; i < make->scripts.count; i++)
         add_install_rule( make, make->scripts.str[i], 0, make->scripts.str[i],
@@ -4367,6 +4379,7 @@ static void load_sources( struct makefile *make )
     if (unix_lib_supported) make->unixlib = get_expanded_make_variable( make, "UNIXLIB" );
 
     make->programs      = get_expanded_make_var_array( make, "PROGRAMS" );
+    make->extra_programs = get_expanded_make_var_array( make, "EXTRA_PROGRAMS" );
     make->scripts       = get_expanded_make_var_array( make, "SCRIPTS" );
     make->imports       = get_expanded_make_var_array( make, "IMPORTS" );
     make->delayimports  = get_expanded_make_var_array( make, "DELAYIMPORTS" );